@@ -0,0 +1,478 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "CpuSVGFBatchFilter.h"
+#include "SVGFKernels.h"
+#include <chrono>
+#include <cstring>
+
+namespace CpuSVGF
+{
+	namespace {
+		using Clock = std::chrono::steady_clock;
+
+		double elapsedMs(Clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+
+		size_t alignUp(size_t bytes)
+		{
+			return (bytes + HistoryPool::kAlignment - 1) & ~(HistoryPool::kAlignment - 1);
+		}
+
+		bool matchesSize(const ImageF4 *pImage, uint32_t width, uint32_t height)
+		{
+			return pImage && pImage->getWidth() == width && pImage->getHeight() == height;
+		}
+
+		// Rows per a-trous task, as in CpuSVGFFilter
+		const uint32_t kBandHeight = 8;
+	};
+
+	CpuSVGFBatchFilter::SharedPtr CpuSVGFBatchFilter::create(CpuThreadPool::SharedPtr pThreadPool, size_t poolBlockBytes)
+	{
+		return SharedPtr(new CpuSVGFBatchFilter(pThreadPool ? pThreadPool : CpuThreadPool::create(), poolBlockBytes));
+	}
+
+	CpuSVGFBatchFilter::CpuSVGFBatchFilter(CpuThreadPool::SharedPtr pThreadPool, size_t poolBlockBytes)
+		: mpThreadPool(pThreadPool), mPool(poolBlockBytes)
+	{
+	}
+
+	CpuSVGFBatchFilter::~CpuSVGFBatchFilter()
+	{
+		for (auto &pStream : mStreams)
+		{
+			if (pStream) mPool.release(pStream->pMemory);
+		}
+	}
+
+	size_t CpuSVGFBatchFilter::getStreamByteSize(uint32_t width, uint32_t height)
+	{
+		const size_t image4 = alignUp(size_t(width) * height * sizeof(float4));
+		const size_t image1 = alignUp(size_t(width) * height * sizeof(float));
+		return 2 * (3 * image4 + image1)                                                // Current and previous reprojection
+		     + 3 * image4                                                               // Filtered past and previous linear z
+		     + 2 * alignUp(PlanarImage::getByteSize(width, height, kIllumPlaneCount))  // A-trous ping-pong
+		     + alignUp(PlanarImage::getByteSize(width, height, kGeometryPlaneCount));
+	}
+
+	void CpuSVGFBatchFilter::layoutStream(Stream &stream)
+	{
+		const uint32_t w = stream.width, h = stream.height;
+		uint8_t *pNext = static_cast<uint8_t *>(stream.pMemory);
+		auto take = [&](size_t bytes)
+		{
+			uint8_t *p = pNext;
+			pNext += alignUp(bytes);
+			return p;
+		};
+
+		const size_t image4 = size_t(w) * h * sizeof(float4);
+		for (auto *pReproj : { &stream.curReproj, &stream.prevReproj })
+		{
+			pReproj->direct.wrap(w, h, reinterpret_cast<float4 *>(take(image4)));
+			pReproj->indirect.wrap(w, h, reinterpret_cast<float4 *>(take(image4)));
+			pReproj->moments.wrap(w, h, reinterpret_cast<float4 *>(take(image4)));
+			pReproj->historyLength.wrap(w, h, reinterpret_cast<float *>(take(size_t(w) * h * sizeof(float))));
+		}
+		stream.filteredPastDirect.wrap(w, h, reinterpret_cast<float4 *>(take(image4)));
+		stream.filteredPastIndirect.wrap(w, h, reinterpret_cast<float4 *>(take(image4)));
+		stream.prevLinearZ.wrap(w, h, reinterpret_cast<float4 *>(take(image4)));
+		for (PlanarImage &planar : stream.illum)
+			planar.wrap(w, h, kIllumPlaneCount, reinterpret_cast<float *>(take(PlanarImage::getByteSize(w, h, kIllumPlaneCount))));
+		stream.geometry.wrap(w, h, kGeometryPlaneCount, reinterpret_cast<float *>(take(PlanarImage::getByteSize(w, h, kGeometryPlaneCount))));
+	}
+
+	CpuSVGFBatchFilter::StreamId CpuSVGFBatchFilter::addStream(uint32_t width, uint32_t height, const Settings &settings)
+	{
+		if (width == 0 || height == 0) return kInvalidStream;
+
+		std::unique_ptr<Stream> pStream(new Stream);
+		pStream->settings = settings;
+		pStream->width    = width;
+		pStream->height   = height;
+		pStream->pMemory  = mPool.allocate(getStreamByteSize(width, height));
+		layoutStream(*pStream);
+
+		StreamId id;
+		if (mFreeIds.empty())
+		{
+			id = StreamId(mStreams.size());
+			mStreams.push_back(nullptr);
+		}
+		else
+		{
+			id = mFreeIds.back();
+			mFreeIds.pop_back();
+		}
+		mStreams[id] = std::move(pStream);
+		mStreamCount++;
+		return id;
+	}
+
+	bool CpuSVGFBatchFilter::removeStream(StreamId stream)
+	{
+		Stream *pStream = getStream(stream);
+		if (!pStream) return false;
+
+		mPool.release(pStream->pMemory);
+		mStreams[stream].reset();
+		mFreeIds.push_back(stream);
+		mStreamCount--;
+		return true;
+	}
+
+	bool CpuSVGFBatchFilter::resetStream(StreamId stream)
+	{
+		Stream *pStream = getStream(stream);
+		if (!pStream) return false;
+		pStream->needClear = true;
+		return true;
+	}
+
+	bool CpuSVGFBatchFilter::setStreamSettings(StreamId stream, const Settings &settings)
+	{
+		Stream *pStream = getStream(stream);
+		if (!pStream) return false;
+		pStream->settings = settings;
+		return true;
+	}
+
+	const CpuSVGFBatchFilter::Settings *CpuSVGFBatchFilter::getStreamSettings(StreamId stream) const
+	{
+		const Stream *pStream = getStream(stream);
+		return pStream ? &pStream->settings : nullptr;
+	}
+
+	CpuSVGFBatchFilter::Stream *CpuSVGFBatchFilter::getStream(StreamId stream) const
+	{
+		return stream < mStreams.size() ? mStreams[stream].get() : nullptr;
+	}
+
+	void CpuSVGFBatchFilter::collectTiles(const std::function<bool(const Stream &)> &pred, std::vector<WorkItem> &items) const
+	{
+		items.clear();
+		for (Stream *pStream : mBatch)
+		{
+			if (!pred(*pStream)) continue;
+			for (uint32_t y = 0; y < pStream->height; y += mTileSize)
+			{
+				for (uint32_t x = 0; x < pStream->width; x += mTileSize)
+				{
+					TileRect rect = { int(x), int(y), int(std::min(x + mTileSize, pStream->width)), int(std::min(y + mTileSize, pStream->height)) };
+					items.push_back({ pStream, rect });
+				}
+			}
+		}
+	}
+
+	void CpuSVGFBatchFilter::collectBands(const std::function<bool(const Stream &)> &pred, std::vector<WorkItem> &items) const
+	{
+		items.clear();
+		for (Stream *pStream : mBatch)
+		{
+			if (!pred(*pStream)) continue;
+			for (uint32_t y = 0; y < pStream->height; y += kBandHeight)
+			{
+				TileRect rect = { 0, int(y), int(pStream->width), int(std::min(y + kBandHeight, pStream->height)) };
+				items.push_back({ pStream, rect });
+			}
+		}
+	}
+
+	bool CpuSVGFBatchFilter::execute(const std::vector<BatchItem> &items)
+	{
+		// Check everything before touching any stream
+		std::vector<uint8_t> seen(mStreams.size(), 0);
+		for (const BatchItem &item : items)
+		{
+			const Stream *pStream = getStream(item.stream);
+			if (!pStream || seen[item.stream]++ || !item.pOutput || !item.inputs.isValid()) return false;
+
+			for (const ImageF4 *pImage : { item.inputs.directIllum, item.inputs.indirectIllum, item.inputs.linearZ, item.inputs.motionVecs,
+			                               item.inputs.miscBuf, item.inputs.dirAlbedo, item.inputs.indirAlbedo })
+			{
+				if (!matchesSize(pImage, pStream->width, pStream->height)) return false;
+			}
+		}
+
+		Clock::time_point frameStart = Clock::now();
+		mTimings = StageTimings();
+
+		mBatch.clear();
+		for (const BatchItem &item : items)
+		{
+			Stream *pStream = mStreams[item.stream].get();
+			pStream->inputs  = item.inputs;
+			pStream->pOutput = item.pOutput;
+			if (item.pOutput->getWidth() != pStream->width || item.pOutput->getHeight() != pStream->height)
+				item.pOutput->resize(pStream->width, pStream->height);
+			mBatch.push_back(pStream);
+		}
+
+		clearStreams();
+		computeReprojection();
+		computeVarianceEstimate();
+		computeAtrousDecomposition();
+		combineUnfiltered();
+
+		// Swap resources so we're ready for next frame.
+		for (Stream *pStream : mBatch)
+		{
+			if (pStream->settings.filterEnabled) std::swap(pStream->curReproj, pStream->prevReproj);
+		}
+
+		mTimings.total = elapsedMs(frameStart);
+		return true;
+	}
+
+	void CpuSVGFBatchFilter::clearStreams()
+	{
+		std::vector<Stream *> streams;
+		for (Stream *pStream : mBatch)
+		{
+			if (pStream->needClear && pStream->settings.filterEnabled) streams.push_back(pStream);
+		}
+
+		mpThreadPool->parallelFor(uint32_t(streams.size()), [&](uint32_t i)
+		{
+			// Zero is a cleared buffer for everything but linear z; this also keeps the planar row padding defined
+			Stream &stream = *streams[i];
+			std::memset(stream.pMemory, 0, getStreamByteSize(stream.width, stream.height));
+			stream.prevLinearZ.fill(float4(0.f, 0.f, 0.f, 1.f));
+			stream.needClear = false;
+		});
+	}
+
+	void CpuSVGFBatchFilter::computeReprojection()
+	{
+		Clock::time_point start = Clock::now();
+
+		collectTiles([](const Stream &stream) { return stream.settings.filterEnabled; }, mTiles);
+		mpThreadPool->parallelFor(uint32_t(mTiles.size()), [&](uint32_t t)
+		{
+			Stream &stream = *mTiles[t].pStream;
+			const TileRect &tile = mTiles[t].rect;
+
+			ReprojectSources src;
+			src.pLinearZ       = stream.inputs.linearZ;
+			src.pPrevLinearZ   = &stream.prevLinearZ;
+			src.pMotion        = stream.inputs.motionVecs;
+			src.pPrevMoments   = &stream.prevReproj.moments;
+			src.pHistoryLength = &stream.prevReproj.historyLength;
+			src.pPrevDirect    = &stream.filteredPastDirect;
+			src.pPrevIndirect  = &stream.filteredPastIndirect;
+			src.pDirect        = stream.inputs.directIllum;
+			src.pIndirect      = stream.inputs.indirectIllum;
+			src.alpha          = stream.settings.alpha;
+			src.momentsAlpha   = stream.settings.momentsAlpha;
+
+			auto &dst = stream.curReproj;
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					ReprojectOutput out = reprojectPixel(src, x, y);
+					dst.direct.at(x, y)        = out.direct;
+					dst.indirect.at(x, y)      = out.indirect;
+					dst.moments.at(x, y)       = out.moments;
+					dst.historyLength.at(x, y) = out.historyLength;
+				}
+			}
+		});
+
+		mTimings.reprojection = elapsedMs(start);
+	}
+
+	void CpuSVGFBatchFilter::computeVarianceEstimate()
+	{
+		Clock::time_point start = Clock::now();
+
+		// Reprojection is done with last frame's linear z and filtered past, so they can be replaced here
+		mpThreadPool->parallelFor(uint32_t(mTiles.size()), [&](uint32_t t)
+		{
+			Stream &stream = *mTiles[t].pStream;
+			const TileRect &tile = mTiles[t].rect;
+			const Settings &settings = stream.settings;
+
+			FilterMomentsSources src;
+			src.pDirect           = &stream.curReproj.direct;
+			src.pIndirect         = &stream.curReproj.indirect;
+			src.pMoments          = &stream.curReproj.moments;
+			src.pHistoryLength    = &stream.curReproj.historyLength;
+			src.pCompactNormDepth = stream.inputs.miscBuf;
+			src.phiColor          = settings.phiColor;
+			src.phiNormal         = settings.phiNormal;
+
+			// Without a feedback tap the reprojected color is the filtered past; without iterations it is also modulated
+			const bool reprojIsPast = settings.feedbackTap < 0 || settings.filterIterations <= 0;
+			const bool modulate     = settings.filterIterations <= 0;
+
+			float *pIllum[kIllumPlaneCount];
+			float *pGeometry[kGeometryPlaneCount];
+			for (uint32_t i = 0; i < kIllumPlaneCount; i++)    pIllum[i]    = stream.illum[0].getPlane(i);
+			for (uint32_t i = 0; i < kGeometryPlaneCount; i++) pGeometry[i] = stream.geometry.getPlane(i);
+			const uint32_t stride = stream.illum[0].getStride();
+
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					const size_t i = size_t(y) * stride + x;
+
+					float4 d, n;
+					filterMomentsPixel(src, x, y, d, n);
+					pIllum[kDirectR][i]   = d.x;  pIllum[kDirectG][i]   = d.y;  pIllum[kDirectB][i]   = d.z;  pIllum[kDirectVar][i]   = d.w;
+					pIllum[kIndirectR][i] = n.x;  pIllum[kIndirectG][i] = n.y;  pIllum[kIndirectB][i] = n.z;  pIllum[kIndirectVar][i] = n.w;
+					pIllum[kDirectLum][i]   = luminance(d.rgb());
+					pIllum[kIndirectLum][i] = luminance(n.rgb());
+
+					float3 normal;
+					float2 z;
+					fetchNormalAndLinearZ(*stream.inputs.miscBuf, x, y, normal, z);
+					pGeometry[kLinearZ][i]      = z.x;
+					pGeometry[kLinearZDeriv][i] = z.y;
+					pGeometry[kNormalX][i]      = normal.x;
+					pGeometry[kNormalY][i]      = normal.y;
+					pGeometry[kNormalZ][i]      = normal.z;
+
+					stream.prevLinearZ.at(x, y) = stream.inputs.linearZ->at(x, y);
+					if (reprojIsPast)
+					{
+						stream.filteredPastDirect.at(x, y)   = stream.curReproj.direct.at(x, y);
+						stream.filteredPastIndirect.at(x, y) = stream.curReproj.indirect.at(x, y);
+					}
+					if (modulate)
+					{
+						stream.pOutput->at(x, y) = modulatePixel(stream.curReproj.direct, stream.curReproj.indirect,
+						                                         *stream.inputs.dirAlbedo, *stream.inputs.indirAlbedo, x, y);
+					}
+				}
+			}
+		});
+
+		mTimings.varianceEstimate = elapsedMs(start);
+	}
+
+	void CpuSVGFBatchFilter::computeAtrousDecomposition()
+	{
+		Clock::time_point start = Clock::now();
+
+		int32_t maxIterations = 0;
+		for (Stream *pStream : mBatch)
+		{
+			if (pStream->settings.filterEnabled) maxIterations = std::max(maxIterations, pStream->settings.filterIterations);
+		}
+
+		// One sweep per iteration, over the streams that still have that many
+		for (int i = 0; i < maxIterations; i++)
+		{
+			collectBands([i](const Stream &stream) { return stream.settings.filterEnabled && stream.settings.filterIterations > i; }, mBands);
+			mpThreadPool->parallelFor(uint32_t(mBands.size()), [&](uint32_t b)
+			{
+				Stream &stream = *mBands[b].pStream;
+				const TileRect &band = mBands[b].rect;
+				const Settings &settings = stream.settings;
+
+				const int32_t iterations  = settings.filterIterations;
+				const bool    feedback    = i == std::min(settings.feedbackTap, iterations - 1);
+				const bool    last        = i == iterations - 1;
+
+				// Channels the a-trous leaves out keep their values in both buffers
+				const uint32_t passThrough = kBothChannels & ~settings.atrousChannels;
+				if (i == 0 && passThrough)
+				{
+					const size_t offset = size_t(band.y0) * stream.illum[0].getStride();
+					const size_t size   = size_t(band.y1 - band.y0) * stream.illum[0].getStride() * sizeof(float);
+					for (uint32_t p = 0; p < kIllumPlaneCount; p++)
+					{
+						const bool direct = p <= kDirectVar || p == kDirectLum;
+						if (passThrough & (direct ? kDirectChannel : kIndirectChannel))
+							std::memcpy(stream.illum[1].getPlane(p) + offset, stream.illum[0].getPlane(p) + offset, size);
+					}
+				}
+
+				// The last iteration modulates in the kernel, while the rows are in cache
+				AtrousSimdArgs args;
+				args.pIn       = &stream.illum[0];
+				args.pOut      = &stream.illum[1];
+				args.pGeometry = &stream.geometry;
+				args.stepSize  = 1 << i;
+				args.phiColor  = settings.phiColor;
+				args.phiNormal = settings.phiNormal;
+				args.y0        = band.y0;
+				args.y1        = band.y1;
+				args.channels  = settings.atrousChannels;
+				args.radius    = settings.atrousRadius;
+				if (last)
+				{
+					args.pModulated   = stream.pOutput;
+					args.pAlbedo      = stream.inputs.dirAlbedo;
+					args.pIndirAlbedo = stream.inputs.indirAlbedo;
+				}
+				getAtrousSimdKernel(settings.simdIsa)(args);
+
+				// The rows are final; store the feedback while they are in cache
+				if (!feedback) return;
+
+				const PlanarImage &res    = stream.illum[1];
+				const size_t       stride = res.getStride();
+				for (int y = band.y0; y < band.y1; y++)
+				{
+					for (int x = 0; x < int(stream.width); x++)
+					{
+						const size_t j = size_t(y) * stride + x;
+						float4 direct   = float4(res.getPlane(kDirectR)[j],   res.getPlane(kDirectG)[j],   res.getPlane(kDirectB)[j],   res.getPlane(kDirectVar)[j]);
+						float4 indirect = float4(res.getPlane(kIndirectR)[j], res.getPlane(kIndirectG)[j], res.getPlane(kIndirectB)[j], res.getPlane(kIndirectVar)[j]);
+						stream.filteredPastDirect.at(x, y)   = direct;
+						stream.filteredPastIndirect.at(x, y) = indirect;
+					}
+				}
+			});
+
+			for (Stream *pStream : mBatch)
+			{
+				if (pStream->settings.filterEnabled && pStream->settings.filterIterations > i) std::swap(pStream->illum[0], pStream->illum[1]);
+			}
+		}
+
+		mTimings.atrous = elapsedMs(start);
+	}
+
+	void CpuSVGFBatchFilter::combineUnfiltered()
+	{
+		Clock::time_point start = Clock::now();
+
+		// No SVGF.  Combine our unfiltered input into our output
+		std::vector<WorkItem> tiles;
+		collectTiles([](const Stream &stream) { return !stream.settings.filterEnabled; }, tiles);
+		mpThreadPool->parallelFor(uint32_t(tiles.size()), [&](uint32_t t)
+		{
+			const Stream &stream = *tiles[t].pStream;
+			const TileRect &tile = tiles[t].rect;
+			for (int y = tile.y0; y < tile.y1; y++)
+				for (int x = tile.x0; x < tile.x1; x++)
+					stream.pOutput->at(x, y) = modulatePixel(*stream.inputs.directIllum, *stream.inputs.indirectIllum,
+					                                         *stream.inputs.dirAlbedo, *stream.inputs.indirAlbedo, x, y);
+		});
+
+		mTimings.modulation = elapsedMs(start);
+	}
+}
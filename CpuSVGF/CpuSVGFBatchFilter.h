@@ -0,0 +1,166 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include "CpuSVGFFilter.h"
+#include "SVGFHistoryPool.h"
+
+namespace CpuSVGF
+{
+	/** Filters many independent, small views (cameras, users) together.  Every stream keeps its own history and
+	    settings, like a CpuSVGFFilter of its own, but all of its buffers come from one HistoryPool and each stage runs
+	    as a single thread pool sweep over the tiles of every stream in the batch, instead of one sweep per stream.
+	    Streams can have different resolutions, and adding or removing one never reallocates the others.
+
+	    The stages are those of CpuSVGFFilter with the vectorized a-trous, with the transposes folded into the
+	    neighboring stages:  the moment filter writes planar illumination and decodes the geometry directly, and the
+	    a-trous bands write the feedback and the modulated output as they finish.  For the settings it supports, the
+	    output is identical to CpuSVGFFilter's.
+	*/
+	class CpuSVGFBatchFilter
+	{
+	public:
+		using SharedPtr = std::shared_ptr<CpuSVGFBatchFilter>;
+
+		/** Per stream settings.  The CPU only options other than simdIsa (fused reprojection, storage format,
+		    blit-free, adaptive a-trous and reduced resolution indirect) are not supported and ignored.
+		*/
+		using Settings = CpuSVGFFilter::Settings;
+
+		using StreamId = uint32_t;
+		static const StreamId kInvalidStream = ~0u;
+
+		/** One stream's frame in a batch
+		*/
+		struct BatchItem
+		{
+			StreamId    stream  = kInvalidStream;
+			FrameInputs inputs;
+			ImageF4    *pOutput = nullptr;   ///< Resized to the stream's resolution if needed
+		};
+
+		/** Create a batch filter.  A null thread pool creates one using every hardware thread.
+		*/
+		static SharedPtr create(CpuThreadPool::SharedPtr pThreadPool = nullptr, size_t poolBlockBytes = HistoryPool::kDefaultBlockBytes);
+		~CpuSVGFBatchFilter();
+
+		/** Add a stream with no history.  Returns kInvalidStream for an empty resolution.
+		*/
+		StreamId addStream(uint32_t width, uint32_t height, const Settings &settings = Settings());
+
+		/** Free a stream's buffers for reuse by streams added later.  Returns false if there is no such stream.
+		*/
+		bool removeStream(StreamId stream);
+
+		/** Forget a stream's history; its next frame is filtered as if it was the first one
+		*/
+		bool resetStream(StreamId stream);
+
+		bool setStreamSettings(StreamId stream, const Settings &settings);
+		const Settings *getStreamSettings(StreamId stream) const;
+
+		uint32_t getStreamCount() const { return mStreamCount; }
+
+		/** Filter one frame of each stream in items (a stream may appear once).  Streams left out keep their history.
+		    Returns false, without filtering anything, if a stream doesn't exist or appears twice, or its inputs are
+		    incomplete or don't match its resolution.
+		*/
+		bool execute(const std::vector<BatchItem> &items);
+
+		/** Wall-clock time of each stage of the last execute(), over the whole batch.  The modulation is done by the
+		    last a-trous iteration and counted there (or by the moment filter stage when a stream has no iterations).
+		*/
+		const StageTimings &getLastTimings() const { return mTimings; }
+
+		const HistoryPool &getHistoryPool() const { return mPool; }
+
+		/** Tile edge length (in pixels) used to distribute work across threads
+		*/
+		void     setTileSize(uint32_t size) { mTileSize = std::max(8u, size); }
+		uint32_t getTileSize() const        { return mTileSize; }
+
+		/** Bytes of pooled buffers a stream of the given resolution uses
+		*/
+		static size_t getStreamByteSize(uint32_t width, uint32_t height);
+
+	protected:
+		CpuSVGFBatchFilter(CpuThreadPool::SharedPtr pThreadPool, size_t poolBlockBytes);
+
+		// A stream's buffers, all wrapping one range of the pool
+		struct Stream
+		{
+			Settings    settings;
+			uint32_t    width  = 0;
+			uint32_t    height = 0;
+			void       *pMemory = nullptr;
+			bool        needClear = true;
+
+			// Reprojection output of this frame and last frame's, swapped after each frame
+			struct
+			{
+				ImageF4 direct, indirect, moments;
+				ImageF  historyLength;
+			}           curReproj, prevReproj;
+			ImageF4     filteredPastDirect, filteredPastIndirect;
+			ImageF4     prevLinearZ;
+			PlanarImage illum[2];
+			PlanarImage geometry;
+
+			// This frame's batch item
+			FrameInputs inputs;
+			ImageF4    *pOutput = nullptr;
+		};
+
+		// Part of a stream one task of a sweep processes
+		struct WorkItem
+		{
+			Stream  *pStream;
+			TileRect rect;
+		};
+
+		CpuThreadPool::SharedPtr             mpThreadPool;
+		HistoryPool                          mPool;
+		std::vector<std::unique_ptr<Stream>> mStreams;        ///< Indexed by StreamId; removed streams leave a null slot
+		std::vector<StreamId>                mFreeIds;
+		uint32_t                             mStreamCount = 0;
+		uint32_t                             mTileSize    = 32;
+		StageTimings                         mTimings;
+
+		// Per-batch work lists
+		std::vector<Stream *>                mBatch;
+		std::vector<WorkItem>                mTiles;
+		std::vector<WorkItem>                mBands;
+
+	private:
+		Stream *getStream(StreamId stream) const;
+
+		// Carve a stream's buffers out of pMemory
+		static void layoutStream(Stream &stream);
+
+		// Append the tiles (or row bands) of the streams matching pred to items
+		void collectTiles(const std::function<bool(const Stream &)> &pred, std::vector<WorkItem> &items) const;
+		void collectBands(const std::function<bool(const Stream &)> &pred, std::vector<WorkItem> &items) const;
+
+		// Each stage is one sweep over the whole batch
+		void clearStreams();
+		void computeReprojection();
+		void computeVarianceEstimate();
+		void computeAtrousDecomposition();
+		void combineUnfiltered();
+	};
+}
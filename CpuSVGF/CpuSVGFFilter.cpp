@@ -0,0 +1,951 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// CPU implementation of the SVGF paper, following the structure of Passes/SVGFPass.cpp.  For details, see:
+//       http://research.nvidia.com/publication/2017-07_Spatiotemporal-Variance-Guided-Filtering%3A
+
+#include "CpuSVGFFilter.h"
+#include "SVGFKernels.h"
+#include "SVGFStorageFormat.h"
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+namespace CpuSVGF
+{
+	namespace {
+		using Clock = std::chrono::steady_clock;
+
+		double elapsedMs(Clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+
+		bool matchesSize(const ImageF4 *pImage, uint32_t width, uint32_t height)
+		{
+			return pImage && pImage->getWidth() == width && pImage->getHeight() == height;
+		}
+
+		// Per-pixel footprint of each group of buffers, for StageTraffic
+		const uint64_t kReprojInputBytes  = 8 * sizeof(float4) + sizeof(float);  // illum, motion, linear z (cur & prev), filtered past, moments, history length
+		const uint64_t kReprojOutputBytes = 3 * sizeof(float4) + sizeof(float);  // mCurReprojFbo
+		const uint64_t kHistoryBytes      = sizeof(float4) + sizeof(float);      // mCurReprojFbo moments and history length
+		const uint64_t kIllumBytes        = 2 * sizeof(float4);                  // direct + indirect
+		const uint64_t kGeometryBytes     = sizeof(float4);                      // SVGF_CompactNormDepth
+
+		// Radius of the moment filter footprint in SVGFFilterMoments.ps.hlsl
+		const int kMomentsRadius = 3;
+	};
+
+	CpuSVGFFilter::SharedPtr CpuSVGFFilter::create(CpuThreadPool::SharedPtr pThreadPool)
+	{
+		return SharedPtr(new CpuSVGFFilter(pThreadPool ? pThreadPool : CpuThreadPool::create()));
+	}
+
+	CpuSVGFFilter::CpuSVGFFilter(CpuThreadPool::SharedPtr pThreadPool)
+		: mpThreadPool(pThreadPool)
+	{
+	}
+
+	void CpuSVGFFilter::resize(uint32_t width, uint32_t height)
+	{
+		// Skip if we're resizing to 0 width or height.
+		if (width <= 0 || height <= 0) return;
+
+		mWidth  = width;
+		mHeight = height;
+
+		for (auto *pFbo : { &mPingPongFbo[0], &mPingPongFbo[1], &mFilteredPastFbo })
+		{
+			pFbo->direct.resize(width, height);
+			pFbo->indirect.resize(width, height);
+		}
+
+		for (auto *pFbo : { &mCurReprojFbo, &mPrevReprojFbo })
+		{
+			pFbo->direct.resize(width, height);
+			pFbo->indirect.resize(width, height);
+			pFbo->moments.resize(width, height);
+			pFbo->historyLength.resize(width, height);
+			pFbo->linearZ.resize(width, height);
+		}
+
+		// We're manually keeping a copy of our linear Z G-buffers from frame N for use in rendering frame N+1
+		mPrevLinearZ.resize(width, height);
+
+		mNeedFboClear = true;
+	}
+
+	void CpuSVGFFilter::setStageTimer(StageTimer::SharedPtr pTimer)
+	{
+		mpStageTimer = pTimer;
+		mStageIds.atrous.clear();
+		if (!pTimer) return;
+
+		// Register in pipeline order so the stages are listed that way
+		mStageIds.reprojection  = pTimer->getStageId("reprojection");
+		mStageIds.filterMoments = pTimer->getStageId("filter moments");
+		for (int i = 0; i < std::max(0, mSettings.filterIterations); i++) getAtrousStageId(i);
+		mStageIds.feedbackCopy  = pTimer->getStageId("feedback copy");
+		mStageIds.modulation    = pTimer->getStageId("modulation");
+		mStageIds.lowResIndirect = pTimer->getStageId("low-res indirect");
+		mStageIds.upsample      = pTimer->getStageId("indirect upsample");
+		mStageIds.total         = pTimer->getStageId("total");
+	}
+
+	uint32_t CpuSVGFFilter::getAtrousStageId(int i)
+	{
+		while (int(mStageIds.atrous.size()) <= i)
+			mStageIds.atrous.push_back(mpStageTimer->getStageId("a-trous " + std::to_string(mStageIds.atrous.size())));
+		return mStageIds.atrous[i];
+	}
+
+	int32_t CpuSVGFFilter::getIndirectScale() const
+	{
+		if (mIndirectOnly) return 1;
+		return mSettings.indirectScale >= 4 ? 4 : mSettings.indirectScale >= 2 ? 2 : 1;
+	}
+
+	void CpuSVGFFilter::clearFbos()
+	{
+		for (auto *pFbo : { &mPingPongFbo[0], &mPingPongFbo[1], &mFilteredPastFbo })
+		{
+			pFbo->direct.fill(float4(0.0f));
+			pFbo->indirect.fill(float4(0.0f));
+		}
+
+		for (auto *pFbo : { &mCurReprojFbo, &mPrevReprojFbo })
+		{
+			pFbo->direct.fill(float4(0.0f));
+			pFbo->indirect.fill(float4(0.0f));
+			pFbo->moments.fill(float4(0.0f));
+			pFbo->historyLength.fill(0.0f);
+			pFbo->linearZ.fill(float4(0.f, 0.f, 0.f, 1.f));
+		}
+
+		// Clear our history textures
+		mPrevLinearZ.fill(float4(0.f, 0.f, 0.f, 1.f));
+		mFilteredPastInReproj = false;
+
+		// Channels we stop filtering are never written again, so don't let the planar buffers keep old values
+		for (PlanarImage &planar : mPlanarIllum) planar = PlanarImage();
+		if (mpIndirectFilter) mpIndirectFilter->reset();
+
+		mNeedFboClear = false;
+	}
+
+	bool CpuSVGFFilter::execute(const FrameInputs &inputs, ImageF4 &output)
+	{
+		if (!inputs.isValid()) return false;
+
+		// Lazily size ourselves to the first frame we see
+		if (mWidth == 0 || mHeight == 0)
+			resize(inputs.directIllum->getWidth(), inputs.directIllum->getHeight());
+
+		for (const ImageF4 *pImage : { inputs.directIllum, inputs.indirectIllum, inputs.linearZ, inputs.motionVecs,
+		                               inputs.miscBuf, inputs.dirAlbedo, inputs.indirAlbedo })
+		{
+			if (!matchesSize(pImage, mWidth, mHeight)) return false;
+		}
+
+		if (output.getWidth() != mWidth || output.getHeight() != mHeight)
+			output.resize(mWidth, mHeight);
+
+		Clock::time_point frameStart = Clock::now();
+		mTimings = StageTimings();
+		mTraffic = StageTraffic();
+		mAdaptiveStats.activeTiles.clear();
+		if (mpStageTimer) mpStageTimer->begin(mStageIds.total);
+
+		// History kept one way can't be read the other way
+		if (mSettings.blitFree != mHistoryBlitFree)
+		{
+			mHistoryBlitFree = mSettings.blitFree;
+			mNeedFboClear    = true;
+		}
+
+		const int32_t indirectScale = getIndirectScale();
+		if (indirectScale != mHistoryIndirectScale)
+		{
+			mHistoryIndirectScale = indirectScale;
+			mNeedFboClear         = true;
+		}
+		mChannels = mIndirectOnly ? kIndirectChannel : (indirectScale > 1 ? kDirectChannel : kBothChannels);
+
+		// Do we need to clear our internal framebuffers?  If so, do it.
+		if (mNeedFboClear) clearFbos();
+
+		mInputTex = inputs;
+
+		if (mSettings.filterEnabled)
+		{
+			if (indirectScale > 1)
+				filterIndirectLowRes(indirectScale);
+
+			// Perform the major passes in SVGF filtering
+			if (mSettings.fusedReprojection)
+			{
+				computeReprojectionAndVarianceFused();
+			}
+			else
+			{
+				computeReprojection();
+				computeVarianceEstimate();
+			}
+			computeAtrousDecomposition(output);
+
+			// This performs the modulation in case there are no wavelet iterations performed
+			if (mSettings.filterIterations <= 0)
+				computeModulation(output);
+
+			// Our indirect is black; add the upsampled one, modulated
+			if (indirectScale > 1)
+				upsampleIndirect(indirectScale, output);
+
+			// Swap resources so we're ready for next frame.
+			std::swap(mCurReprojFbo, mPrevReprojFbo);
+			if (mSettings.blitFree)
+			{
+				mFilteredPastInReproj = mSettings.feedbackTap < 0 || mSettings.filterIterations <= 0;
+			}
+			else
+			{
+				mPrevLinearZ = *mInputTex.linearZ;
+				mTraffic.bytesCopied += mPrevLinearZ.getByteSize();
+			}
+		}
+		else
+		{
+			// No SVGF.  Combine our unfiltered input into our output
+			combineUnfiltered(output);
+		}
+
+		if (mpStageTimer)
+		{
+			mpStageTimer->end(mStageIds.total);
+			mpStageTimer->endFrame();
+		}
+		mTimings.total = elapsedMs(frameStart);
+		return true;
+	}
+
+	const ImageF4 &CpuSVGFFilter::getPrevLinearZ() const
+	{
+		return mSettings.blitFree ? mPrevReprojFbo.linearZ : mPrevLinearZ;
+	}
+
+	void CpuSVGFFilter::computeReprojection()
+	{
+		StageTimer::Scope scope(mpStageTimer.get(), mStageIds.reprojection);
+		Clock::time_point start = Clock::now();
+
+		// Setup textures for our reprojection pass
+		ReprojectSources src;
+		src.pLinearZ       = mInputTex.linearZ;
+		src.pPrevLinearZ   = &getPrevLinearZ();
+		src.pMotion        = mInputTex.motionVecs;
+		src.pPrevMoments   = &mPrevReprojFbo.moments;
+		src.pHistoryLength = &mPrevReprojFbo.historyLength;
+		src.pPrevDirect    = &getFilteredPastDirect();
+		src.pPrevIndirect  = &getFilteredPastIndirect();
+		src.pDirect        = mInputTex.directIllum;
+		src.pIndirect      = mInputTex.indirectIllum;
+		src.alpha          = mSettings.alpha;
+		src.momentsAlpha   = mSettings.momentsAlpha;
+		src.channels       = mChannels;
+
+		// A channel we don't filter stays zero, as it was cleared
+		const StorageFormat format = mSettings.storageFormat;
+		const bool storeLinearZ = mSettings.blitFree;
+		const bool storeDirect   = (mChannels & kDirectChannel) != 0;
+		const bool storeIndirect = (mChannels & kIndirectChannel) != 0;
+		ReprojFbo &dst = mCurReprojFbo;
+		mpThreadPool->forEachTile(mWidth, mHeight, mTileSize, [&](const TileRect &tile)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					ReprojectOutput out = reprojectPixel(src, x, y);
+					if (storeDirect)   dst.direct.at(x, y)   = quantizeIllum(format, out.direct);
+					if (storeIndirect) dst.indirect.at(x, y) = quantizeIllum(format, out.indirect);
+					dst.moments.at(x, y)       = quantizeMoments(format, out.moments);
+					dst.historyLength.at(x, y) = out.historyLength;
+					if (storeLinearZ) dst.linearZ.at(x, y) = mInputTex.linearZ->at(x, y);
+				}
+			}
+		});
+
+		const uint64_t pixels = uint64_t(mWidth) * mHeight;
+		mTraffic.bytesRead    += pixels * kReprojInputBytes;
+		mTraffic.bytesWritten += pixels * (kReprojOutputBytes + (storeLinearZ ? sizeof(float4) : 0));
+		mTimings.reprojection = elapsedMs(start);
+	}
+
+	void CpuSVGFFilter::computeVarianceEstimate()
+	{
+		StageTimer::Scope scope(mpStageTimer.get(), mStageIds.filterMoments);
+		Clock::time_point start = Clock::now();
+
+		FilterMomentsSources src;
+		src.pDirect           = &mCurReprojFbo.direct;
+		src.pIndirect         = &mCurReprojFbo.indirect;
+		src.pMoments          = &mCurReprojFbo.moments;
+		src.pHistoryLength    = &mCurReprojFbo.historyLength;
+		src.pCompactNormDepth = mInputTex.miscBuf;
+		src.phiColor          = mSettings.phiColor;
+		src.phiNormal         = mSettings.phiNormal;
+		src.channels          = mChannels;
+
+		const StorageFormat format = mSettings.storageFormat;
+		const bool storeDirect   = (mChannels & kDirectChannel) != 0;
+		const bool storeIndirect = (mChannels & kIndirectChannel) != 0;
+		IllumFbo &dst = mPingPongFbo[0];
+		mpThreadPool->forEachTile(mWidth, mHeight, mTileSize, [&](const TileRect &tile)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					float4 outDirect, outIndirect;
+					filterMomentsPixel(src, x, y, outDirect, outIndirect);
+					if (storeDirect)   dst.direct.at(x, y)   = quantizeIllum(format, outDirect);
+					if (storeIndirect) dst.indirect.at(x, y) = quantizeIllum(format, outIndirect);
+				}
+			}
+		});
+
+		const uint64_t pixels = uint64_t(mWidth) * mHeight;
+		mTraffic.bytesRead    += pixels * (kReprojOutputBytes + kGeometryBytes);
+		mTraffic.bytesWritten += pixels * kIllumBytes;
+		mTimings.varianceEstimate = elapsedMs(start);
+	}
+
+	void CpuSVGFFilter::computeReprojectionAndVarianceFused()
+	{
+		// One pass; it is reported as reprojection
+		StageTimer::Scope scope(mpStageTimer.get(), mStageIds.reprojection);
+		Clock::time_point start = Clock::now();
+
+		ReprojectSources reproj;
+		reproj.pLinearZ       = mInputTex.linearZ;
+		reproj.pPrevLinearZ   = &getPrevLinearZ();
+		reproj.pMotion        = mInputTex.motionVecs;
+		reproj.pPrevMoments   = &mPrevReprojFbo.moments;
+		reproj.pHistoryLength = &mPrevReprojFbo.historyLength;
+		reproj.pPrevDirect    = &getFilteredPastDirect();
+		reproj.pPrevIndirect  = &getFilteredPastIndirect();
+		reproj.pDirect        = mInputTex.directIllum;
+		reproj.pIndirect      = mInputTex.indirectIllum;
+		reproj.alpha          = mSettings.alpha;
+		reproj.momentsAlpha   = mSettings.momentsAlpha;
+		reproj.channels       = mChannels;
+
+		// Moments and history length feed the next frame.  The reprojected color is only needed outside this pass
+		//    when there are no a-trous iterations (modulation reads it) or no feedback tap (it becomes the filtered past).
+		const bool storeColor = mSettings.filterIterations <= 0 || mSettings.feedbackTap < 0;
+		const bool storeLinearZ = mSettings.blitFree;
+		const bool storeDirect   = (mChannels & kDirectChannel) != 0;
+		const bool storeIndirect = (mChannels & kIndirectChannel) != 0;
+		const StorageFormat format = mSettings.storageFormat;
+
+		ReprojFbo &dst = mCurReprojFbo;
+		IllumFbo  &out = mPingPongFbo[0];
+		std::atomic<uint64_t> cachedPixels(0);
+
+		mpThreadPool->forEachTile(mWidth, mHeight, mTileSize, [&](const TileRect &tile)
+		{
+			// Reproject the tile and its halo into the thread's tile buffer.  Halo pixels are recomputed by every tile
+			//    that needs them, trading a little ALU for never writing them out.
+			const int cx0 = std::max(tile.x0 - kMomentsRadius, 0);
+			const int cy0 = std::max(tile.y0 - kMomentsRadius, 0);
+			const int cx1 = std::min(tile.x1 + kMomentsRadius, int(mWidth));
+			const int cy1 = std::min(tile.y1 + kMomentsRadius, int(mHeight));
+
+			thread_local ReprojFbo cache;
+			if (cache.direct.getWidth() != uint32_t(cx1 - cx0) || cache.direct.getHeight() != uint32_t(cy1 - cy0))
+			{
+				cache.direct.resize(cx1 - cx0, cy1 - cy0);
+				cache.indirect.resize(cx1 - cx0, cy1 - cy0);
+				cache.moments.resize(cx1 - cx0, cy1 - cy0);
+				cache.historyLength.resize(cx1 - cx0, cy1 - cy0);
+			}
+
+			for (int y = cy0; y < cy1; y++)
+			{
+				for (int x = cx0; x < cx1; x++)
+				{
+					ReprojectOutput r = reprojectPixel(reproj, x, y);
+					if (storeDirect)   cache.direct.at(x - cx0, y - cy0)   = quantizeIllum(format, r.direct);
+					if (storeIndirect) cache.indirect.at(x - cx0, y - cy0) = quantizeIllum(format, r.indirect);
+					cache.moments.at(x - cx0, y - cy0)       = quantizeMoments(format, r.moments);
+					cache.historyLength.at(x - cx0, y - cy0) = r.historyLength;
+				}
+			}
+			cachedPixels += uint64_t(cx1 - cx0) * uint64_t(cy1 - cy0);
+
+			FilterMomentsSources moments;
+			moments.pDirect           = &cache.direct;
+			moments.pIndirect         = &cache.indirect;
+			moments.pMoments          = &cache.moments;
+			moments.pHistoryLength    = &cache.historyLength;
+			moments.pCompactNormDepth = mInputTex.miscBuf;
+			moments.phiColor          = mSettings.phiColor;
+			moments.phiNormal         = mSettings.phiNormal;
+			moments.channels          = mChannels;
+			moments.originX           = cx0;
+			moments.originY           = cy0;
+
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					float4 outDirect, outIndirect;
+					filterMomentsPixel(moments, x, y, outDirect, outIndirect);
+					if (storeDirect)   out.direct.at(x, y)   = quantizeIllum(format, outDirect);
+					if (storeIndirect) out.indirect.at(x, y) = quantizeIllum(format, outIndirect);
+
+					dst.moments.at(x, y)       = cache.moments.at(x - cx0, y - cy0);
+					dst.historyLength.at(x, y) = cache.historyLength.at(x - cx0, y - cy0);
+					if (storeLinearZ) dst.linearZ.at(x, y) = mInputTex.linearZ->at(x, y);
+					if (storeColor && storeDirect)   dst.direct.at(x, y)   = cache.direct.at(x - cx0, y - cy0);
+					if (storeColor && storeIndirect) dst.indirect.at(x, y) = cache.indirect.at(x - cx0, y - cy0);
+				}
+			}
+		});
+
+		// Halo pixels re-read the reprojection inputs, so those are counted per cached pixel rather than per screen pixel
+		const uint64_t pixels = uint64_t(mWidth) * mHeight;
+		mTraffic.bytesRead    += cachedPixels * kReprojInputBytes + pixels * kGeometryBytes;
+		mTraffic.bytesWritten += pixels * (kIllumBytes + (storeColor ? kReprojOutputBytes : kHistoryBytes) + (storeLinearZ ? sizeof(float4) : 0));
+
+		// Both stages are one pass now; report it all as reprojection
+		mTimings.reprojection = elapsedMs(start);
+	}
+
+	void CpuSVGFFilter::computeAtrousDecomposition(ImageF4 &output)
+	{
+		if (mSettings.simdAtrous && mSettings.filterIterations > 0)
+		{
+			computeAtrousDecompositionSimd(output);
+			return;
+		}
+
+		Clock::time_point start = Clock::now();
+
+		const int32_t iterations  = mSettings.filterIterations;
+		const int32_t feedbackTap = std::min(mSettings.feedbackTap, iterations - 1);
+
+		const StorageFormat format = mSettings.storageFormat;
+
+		AtrousSources src;
+		src.phiColor          = mSettings.phiColor;
+		src.phiNormal         = mSettings.phiNormal;
+		src.pHistoryLength    = &mCurReprojFbo.historyLength;
+		src.pCompactNormDepth = mInputTex.miscBuf;
+		src.pAlbedo           = mInputTex.dirAlbedo;
+		src.pIndirAlbedo      = mInputTex.indirAlbedo;
+
+		IllumFbo *pIn = &mPingPongFbo[0];
+		for (int i = 0; i < iterations; i++)
+		{
+			const bool lastIteration = (i == iterations - 1);
+			const bool feedback      = (i == feedbackTap);
+
+			// Send down our input images
+			src.pDirect           = &pIn->direct;
+			src.pIndirect         = &pIn->indirect;
+			src.stepSize          = 1 << i;
+
+			// Modulate in-kernel on the last iteration, unless that iteration also feeds the next frame, in which case
+			//    we need the demodulated result too (SVGFPass' GUI never allows this, but the settings don't forbid it)
+			const AtrousPixelFunc filterPixel = getAtrousPixelVariant(mChannels & mSettings.atrousChannels, lastIteration && !feedback, mSettings.atrousRadius);
+
+			// Blit-free, the feedback iteration renders straight into the filtered past, which the next iteration reads
+			const bool intoHistory = mSettings.blitFree && feedback && !lastIteration;
+			IllumFbo &dst = intoHistory ? mFilteredPastFbo : (pIn == &mPingPongFbo[1] ? mPingPongFbo[0] : mPingPongFbo[1]);
+			if (mpStageTimer) mpStageTimer->begin(getAtrousStageId(i));
+			mpThreadPool->forEachTile(mWidth, mHeight, mTileSize, [&](const TileRect &tile)
+			{
+				for (int y = tile.y0; y < tile.y1; y++)
+				{
+					for (int x = tile.x0; x < tile.x1; x++)
+					{
+						float4 outDirect, outIndirect;
+						filterPixel(src, x, y, outDirect, outIndirect);
+
+						if (!lastIteration)
+						{
+							dst.direct.at(x, y)   = quantizeIllum(format, outDirect);
+							dst.indirect.at(x, y) = quantizeIllum(format, outIndirect);
+							continue;
+						}
+
+						if (feedback)
+						{
+							mFilteredPastFbo.direct.at(x, y)   = quantizeIllum(format, outDirect);
+							mFilteredPastFbo.indirect.at(x, y) = quantizeIllum(format, outIndirect);
+							outDirect = outDirect * src.pAlbedo->at(x, y) + outIndirect * src.pIndirAlbedo->at(x, y);
+						}
+						output.at(x, y) = outDirect;
+					}
+				}
+			});
+			if (mpStageTimer) mpStageTimer->end(getAtrousStageId(i));
+
+			// store the filtered color for the feedback path
+			if (feedback && !lastIteration && !intoHistory)
+			{
+				StageTimer::Scope scope(mpStageTimer.get(), mStageIds.feedbackCopy);
+				mFilteredPastFbo.direct   = dst.direct;
+				mFilteredPastFbo.indirect = dst.indirect;
+				mTraffic.bytesCopied += dst.direct.getByteSize() + dst.indirect.getByteSize();
+			}
+
+			pIn = &dst;
+		}
+
+		// Blit-free, next frame reads the reprojected color in place
+		if ((mSettings.feedbackTap < 0 || iterations <= 0) && !mSettings.blitFree)
+		{
+			StageTimer::Scope scope(mpStageTimer.get(), mStageIds.feedbackCopy);
+			mFilteredPastFbo.direct   = mCurReprojFbo.direct;
+			mFilteredPastFbo.indirect = mCurReprojFbo.indirect;
+			mTraffic.bytesCopied += mFilteredPastFbo.direct.getByteSize() + mFilteredPastFbo.indirect.getByteSize();
+		}
+
+		mTimings.atrous = elapsedMs(start);
+	}
+
+	void CpuSVGFFilter::computeAtrousDecompositionSimd(ImageF4 &output)
+	{
+		Clock::time_point start = Clock::now();
+
+		const int32_t iterations  = mSettings.filterIterations;
+		const int32_t feedbackTap = std::min(mSettings.feedbackTap, iterations - 1);
+		const uint32_t bandHeight = 8;
+
+		// Transpose once per frame; the iterations then only touch planar data
+		CpuThreadPool &pool = *mpThreadPool;
+		illumToPlanar(pool, mPingPongFbo[0].direct, mPingPongFbo[0].indirect, mPlanarIllum[0]);
+		geometryToPlanar(pool, *mInputTex.miscBuf, mPlanarGeometry);
+		if (mPlanarIllum[1].getWidth() != mWidth || mPlanarIllum[1].getHeight() != mHeight)
+			mPlanarIllum[1].resize(mWidth, mHeight, kIllumPlaneCount);
+
+		// Geometry doesn't change between iterations:  weight every tap of every iteration up front
+		const size_t weightPlaneSize = getGeometryWeightPlaneSize(mWidth, mHeight);
+		if (mSettings.geometryWeightCache)
+		{
+			Clock::time_point weightStart = Clock::now();
+			mGeometryWeights.resize(size_t(iterations) * kAtrousTapCount * weightPlaneSize);
+
+			GeometryWeightSimdFunc weightKernel = getGeometryWeightSimdKernel(mSettings.simdIsa);
+			forEachRowBand(pool, mHeight, bandHeight, [&](int y0, int y1)
+			{
+				GeometryWeightSimdArgs band;
+				band.pGeometry  = &mPlanarGeometry;
+				band.pWeights   = mGeometryWeights.data();
+				band.iterations = iterations;
+				band.y0         = y0;
+				band.y1         = y1;
+				band.radius     = mSettings.atrousRadius;
+				weightKernel(band);
+			});
+			mTimings.geometryWeights = elapsedMs(weightStart);
+		}
+
+		// The kernel leaves the planes of channels it doesn't filter alone; give both buffers the pass-through values
+		const uint32_t passThrough = mChannels & ~mSettings.atrousChannels;
+		if (passThrough)
+		{
+			const size_t planeSize = size_t(mPlanarIllum[0].getStride()) * mHeight * sizeof(float);
+			for (uint32_t p = 0; p < kIllumPlaneCount; p++)
+			{
+				const bool direct = p <= kDirectVar || p == kDirectLum;
+				if (passThrough & (direct ? kDirectChannel : kIndirectChannel))
+					std::memcpy(mPlanarIllum[1].getPlane(p), mPlanarIllum[0].getPlane(p), planeSize);
+			}
+		}
+
+		AtrousSimdFunc kernel = getAtrousSimdKernel(mSettings.simdIsa);
+
+		AtrousSimdArgs args;
+		args.pGeometry = &mPlanarGeometry;
+		args.phiColor  = mSettings.phiColor;
+		args.phiNormal = mSettings.phiNormal;
+		args.channels  = mChannels & mSettings.atrousChannels;
+		args.radius    = mSettings.atrousRadius;
+
+		// The last iteration modulates as it goes, unless adaptive filtering skips some of its tiles
+		const bool fusedModulation = !mSettings.adaptiveAtrous;
+
+		// Adaptive:  every tile is filtered until the first iteration allowed to cull
+		const uint32_t tilesX = (mWidth + kAdaptiveTileSize - 1) / kAdaptiveTileSize;
+		const uint32_t tilesY = (mHeight + kAdaptiveTileSize - 1) / kAdaptiveTileSize;
+		if (mSettings.adaptiveAtrous)
+		{
+			mActiveTiles.resize(tilesX * tilesY);
+			for (uint32_t t = 0; t < mActiveTiles.size(); t++) mActiveTiles[t] = t;
+			mAdaptiveStats.tileCount = tilesX * tilesY;
+		}
+
+		for (int i = 0; i < iterations; i++)
+		{
+			args.pIn      = &mPlanarIllum[0];
+			args.pOut     = &mPlanarIllum[1];
+			args.stepSize = 1 << i;
+			args.pGeometryWeights = mSettings.geometryWeightCache ? mGeometryWeights.data() + size_t(i) * kAtrousTapCount * weightPlaneSize : nullptr;
+
+			// Blit-free, the feedback iteration stores its result into the filtered past as it goes
+			const bool intoHistory = mSettings.blitFree && i == feedbackTap;
+			args.pHistoryDirect   = intoHistory ? &mFilteredPastFbo.direct : nullptr;
+			args.pHistoryIndirect = intoHistory ? &mFilteredPastFbo.indirect : nullptr;
+			args.historyFormat    = mSettings.storageFormat;
+			if (fusedModulation && i == iterations - 1)
+			{
+				args.pModulated   = &output;
+				args.pAlbedo      = mInputTex.dirAlbedo;
+				args.pIndirAlbedo = mInputTex.indirAlbedo;
+			}
+
+			if (mpStageTimer) mpStageTimer->begin(getAtrousStageId(i));
+			if (mSettings.adaptiveAtrous)
+			{
+				if (i >= mSettings.adaptiveFirstIteration)
+					cullConvergedTiles(mPlanarIllum[0], mPlanarIllum[1], i <= feedbackTap && mSettings.blitFree);
+				mAdaptiveStats.activeTiles.push_back(uint32_t(mActiveTiles.size()));
+
+				pool.parallelFor(uint32_t(mActiveTiles.size()), [&](uint32_t t)
+				{
+					AtrousSimdArgs tile = args;
+					tile.x0 = int(mActiveTiles[t] % tilesX * kAdaptiveTileSize);
+					tile.y0 = int(mActiveTiles[t] / tilesX * kAdaptiveTileSize);
+					tile.x1 = std::min(tile.x0 + int(kAdaptiveTileSize), int(mWidth));
+					tile.y1 = std::min(tile.y0 + int(kAdaptiveTileSize), int(mHeight));
+					kernel(tile);
+				});
+			}
+			else
+			{
+				forEachRowBand(pool, mHeight, bandHeight, [&](int y0, int y1)
+				{
+					AtrousSimdArgs band = args;
+					band.y0 = y0;
+					band.y1 = y1;
+					kernel(band);
+				});
+			}
+
+			// Intermediate iterations round-trip through the ping-pong storage format; the last one goes to the output
+			if (i < iterations - 1)
+				quantizeIllum(pool, mSettings.storageFormat, mPlanarIllum[1]);
+			if (mpStageTimer) mpStageTimer->end(getAtrousStageId(i));
+
+			// store the filtered color for the feedback path
+			if (i == feedbackTap && !intoHistory)
+			{
+				StageTimer::Scope scope(mpStageTimer.get(), mStageIds.feedbackCopy);
+				planarToIllum(pool, mPlanarIllum[1], mFilteredPastFbo.direct, mFilteredPastFbo.indirect);
+				mTraffic.bytesCopied += mFilteredPastFbo.direct.getByteSize() + mFilteredPastFbo.indirect.getByteSize();
+				if (i == iterations - 1)
+				{
+					quantizeIllum(pool, mSettings.storageFormat, mFilteredPastFbo.direct);
+					quantizeIllum(pool, mSettings.storageFormat, mFilteredPastFbo.indirect);
+				}
+			}
+
+			// Adaptive, the kernel doesn't see every tile; modulate while converting the last iteration back to RGBA
+			if (i == iterations - 1 && !fusedModulation)
+			{
+				StageTimer::Scope scope(mpStageTimer.get(), mStageIds.modulation);
+				const PlanarImage &res   = mPlanarIllum[1];
+				const size_t       stride = res.getStride();
+				forEachRowBand(pool, mHeight, bandHeight, [&](int y0, int y1)
+				{
+					for (int y = y0; y < y1; y++)
+					{
+						for (int x = 0; x < int(mWidth); x++)
+						{
+							const size_t j = size_t(y) * stride + x;
+							float4 direct   = float4(res.getPlane(kDirectR)[j],   res.getPlane(kDirectG)[j],   res.getPlane(kDirectB)[j],   res.getPlane(kDirectVar)[j]);
+							float4 indirect = float4(res.getPlane(kIndirectR)[j], res.getPlane(kIndirectG)[j], res.getPlane(kIndirectB)[j], res.getPlane(kIndirectVar)[j]);
+							output.at(x, y) = direct * mInputTex.dirAlbedo->at(x, y) + indirect * mInputTex.indirAlbedo->at(x, y);
+						}
+					}
+				});
+			}
+
+			std::swap(mPlanarIllum[0], mPlanarIllum[1]);
+		}
+
+		if (mSettings.feedbackTap < 0 && !mSettings.blitFree)
+		{
+			StageTimer::Scope scope(mpStageTimer.get(), mStageIds.feedbackCopy);
+			mFilteredPastFbo.direct   = mCurReprojFbo.direct;
+			mFilteredPastFbo.indirect = mCurReprojFbo.indirect;
+			mTraffic.bytesCopied += mFilteredPastFbo.direct.getByteSize() + mFilteredPastFbo.indirect.getByteSize();
+		}
+
+		mTimings.atrous = elapsedMs(start);
+	}
+
+	void CpuSVGFFilter::cullConvergedTiles(const PlanarImage &in, PlanarImage &out, bool intoHistory)
+	{
+		const uint32_t tilesX = (mWidth + kAdaptiveTileSize - 1) / kAdaptiveTileSize;
+		const size_t   stride = in.getStride();
+		const ImageF  &historyLength = mCurReprojFbo.historyLength;
+		const float    minHistory    = mSettings.adaptiveMinHistory;
+		const float    threshold     = mSettings.adaptiveNoiseThreshold;
+		const float    threshold2    = threshold * threshold;
+
+		const float *pZ = mPlanarGeometry.getPlane(kLinearZ);
+		const float *pVar[2] = { in.getPlane(kDirectVar), in.getPlane(kIndirectVar) };
+		const float *pLum[2] = { in.getPlane(kDirectLum), in.getPlane(kIndirectLum) };
+
+		mTileNeedsWork.resize(mActiveTiles.size());
+		mpThreadPool->parallelFor(uint32_t(mActiveTiles.size()), [&](uint32_t t)
+		{
+			const uint32_t x0 = mActiveTiles[t] % tilesX * kAdaptiveTileSize, x1 = std::min(x0 + kAdaptiveTileSize, mWidth);
+			const uint32_t y0 = mActiveTiles[t] / tilesX * kAdaptiveTileSize, y1 = std::min(y0 + kAdaptiveTileSize, mHeight);
+
+			bool needsWork = false;
+			for (uint32_t y = y0; y < y1 && !needsWork; y++)
+			{
+				for (uint32_t x = x0; x < x1; x++)
+				{
+					const size_t j = size_t(y) * stride + x;
+					if (pZ[j] < 0.0f) continue;   // Environment map, passed through by the filter anyway
+
+					const float h = historyLength.at(int(x), int(y));
+					if (h < minHistory) { needsWork = true; break; }
+
+					// Variance of an exponential moving average with weight alpha is alpha / (2 - alpha) of its input's
+					const float alpha     = std::max(mSettings.alpha, 1.0f / std::max(h, 1.0f));
+					const float reduction = alpha / (2.0f - alpha);
+					for (int k = 0; k < 2 && !needsWork; k++)
+					{
+						if (!(mChannels & (k == 0 ? kDirectChannel : kIndirectChannel))) continue;
+						const float lum = std::max(pLum[k][j], 1e-4f);
+						needsWork = pVar[k][j] * reduction > threshold2 * lum * lum;
+					}
+					if (needsWork) break;
+				}
+			}
+			mTileNeedsWork[t] = needsWork ? 1 : 0;
+
+			// Converged:  the remaining iterations ping-pong between in and out, so one copy leaves the tile's
+			//    final value in both and it is never touched again
+			if (!needsWork)
+			{
+				for (uint32_t plane = 0; plane < kIllumPlaneCount; plane++)
+				{
+					for (uint32_t y = y0; y < y1; y++)
+					{
+						const size_t j = size_t(y) * stride + x0;
+						std::copy(in.getPlane(plane) + j, in.getPlane(plane) + j + (x1 - x0), out.getPlane(plane) + j);
+					}
+				}
+
+				// Blit-free, the feedback iteration won't visit the tile to store it into the filtered past
+				if (intoHistory)
+				{
+					for (uint32_t y = y0; y < y1; y++)
+					{
+						for (uint32_t x = x0; x < x1; x++)
+						{
+							const size_t j = size_t(y) * stride + x;
+							mFilteredPastFbo.direct.at(int(x), int(y))   = quantizeIllum(mSettings.storageFormat,
+								float4(in.getPlane(kDirectR)[j], in.getPlane(kDirectG)[j], in.getPlane(kDirectB)[j], in.getPlane(kDirectVar)[j]));
+							mFilteredPastFbo.indirect.at(int(x), int(y)) = quantizeIllum(mSettings.storageFormat,
+								float4(in.getPlane(kIndirectR)[j], in.getPlane(kIndirectG)[j], in.getPlane(kIndirectB)[j], in.getPlane(kIndirectVar)[j]));
+						}
+					}
+				}
+			}
+		});
+
+		// Compact the list, keeping it in screen order
+		size_t kept = 0;
+		for (size_t t = 0; t < mActiveTiles.size(); t++)
+		{
+			if (mTileNeedsWork[t]) mActiveTiles[kept++] = mActiveTiles[t];
+		}
+		mActiveTiles.resize(kept);
+	}
+
+	void CpuSVGFFilter::computeModulation(ImageF4 &output)
+	{
+		StageTimer::Scope scope(mpStageTimer.get(), mStageIds.modulation);
+		Clock::time_point start = Clock::now();
+
+		mpThreadPool->forEachTile(mWidth, mHeight, mTileSize, [&](const TileRect &tile)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+				for (int x = tile.x0; x < tile.x1; x++)
+					output.at(x, y) = modulatePixel(mCurReprojFbo.direct, mCurReprojFbo.indirect, *mInputTex.dirAlbedo, *mInputTex.indirAlbedo, x, y);
+		});
+
+		mTimings.modulation = elapsedMs(start);
+	}
+
+	void CpuSVGFFilter::combineUnfiltered(ImageF4 &output)
+	{
+		StageTimer::Scope scope(mpStageTimer.get(), mStageIds.modulation);
+		Clock::time_point start = Clock::now();
+
+		mpThreadPool->forEachTile(mWidth, mHeight, mTileSize, [&](const TileRect &tile)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+				for (int x = tile.x0; x < tile.x1; x++)
+					output.at(x, y) = modulatePixel(*mInputTex.directIllum, *mInputTex.indirectIllum, *mInputTex.dirAlbedo, *mInputTex.indirAlbedo, x, y);
+		});
+
+		mTimings.modulation = elapsedMs(start);
+	}
+
+	void CpuSVGFFilter::filterIndirectLowRes(int32_t scale)
+	{
+		StageTimer::Scope scope(mpStageTimer.get(), mStageIds.lowResIndirect);
+		Clock::time_point start = Clock::now();
+
+		const uint32_t width  = (mWidth + scale - 1) / scale;
+		const uint32_t height = (mHeight + scale - 1) / scale;
+		auto &lowRes = mLowRes;
+		if (!mpIndirectFilter || mpIndirectFilter->getWidth() != width || mpIndirectFilter->getHeight() != height)
+		{
+			mpIndirectFilter = SharedPtr(new CpuSVGFFilter(mpThreadPool));
+			mpIndirectFilter->mIndirectOnly = true;
+			mpIndirectFilter->resize(width, height);
+
+			for (ImageF4 *pImage : { &lowRes.indirect, &lowRes.linearZ, &lowRes.motionVecs, &lowRes.miscBuf, &lowRes.black })
+				pImage->resize(width, height, float4(0.0f));
+			lowRes.white.resize(width, height, float4(1.0f));
+		}
+
+		Settings settings = mSettings;
+		settings.indirectScale = 1;
+		mpIndirectFilter->setSettings(settings);
+		mpIndirectFilter->setTileSize(mTileSize);
+
+		// Each low resolution pixel takes its geometry from the block pixel closest to the block's mean depth, and
+		//    averages the indirect illumination of the block pixels on the same surface.  Depth derivatives are per
+		//    pixel, so they grow with the scale.
+		const ImageF4 &misc = *mInputTex.miscBuf;
+		mpThreadPool->forEachTile(width, height, mTileSize, [&](const TileRect &tile)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					const int bx0 = x * scale, bx1 = std::min(bx0 + scale, int(mWidth));
+					const int by0 = y * scale, by1 = std::min(by0 + scale, int(mHeight));
+
+					float zSum = 0.0f;
+					int   zCount = 0;
+					for (int by = by0; by < by1; by++)
+						for (int bx = bx0; bx < bx1; bx++)
+							if (misc.at(bx, by).y >= 0.0f) { zSum += misc.at(bx, by).y; zCount++; }
+
+					int   rx = bx0, ry = by0;
+					float bestDist = std::numeric_limits<float>::max();
+					for (int by = by0; by < by1 && zCount > 0; by++)
+					{
+						for (int bx = bx0; bx < bx1; bx++)
+						{
+							const float z = misc.at(bx, by).y;
+							if (z >= 0.0f && std::abs(z - zSum / zCount) < bestDist) { bestDist = std::abs(z - zSum / zCount); rx = bx; ry = by; }
+						}
+					}
+
+					const float4 &nd = misc.at(rx, ry);
+					float4 linearZ = mInputTex.linearZ->at(rx, ry);
+					float4 motion  = mInputTex.motionVecs->at(rx, ry);
+					linearZ.y *= float(scale);
+					motion.z  *= float(scale);
+					motion.w  *= float(scale);
+					lowRes.miscBuf.at(x, y)    = float4(nd.x, nd.y, nd.z * float(scale), nd.w);
+					lowRes.linearZ.at(x, y)    = linearZ;
+					lowRes.motionVecs.at(x, y) = motion;
+
+					const float zRep      = nd.y;
+					const float tolerance = 2.0f * (nd.z * float(scale) + 1e-4f);
+					float3 sum = float3(0.0f);
+					float  count = 0.0f;
+					for (int by = by0; by < by1; by++)
+					{
+						for (int bx = bx0; bx < bx1; bx++)
+						{
+							const float z = misc.at(bx, by).y;
+							const bool  sameSurface = (zRep < 0.0f) ? (z < 0.0f) : (z >= 0.0f && std::abs(z - zRep) <= tolerance);
+							if (sameSurface) { sum += mInputTex.indirectIllum->at(bx, by).rgb(); count += 1.0f; }
+						}
+					}
+					lowRes.indirect.at(x, y) = float4(sum / std::max(count, 1.0f), 0.0f);
+				}
+			}
+		});
+
+		FrameInputs inputs;
+		inputs.directIllum   = &lowRes.black;
+		inputs.indirectIllum = &lowRes.indirect;
+		inputs.linearZ       = &lowRes.linearZ;
+		inputs.motionVecs    = &lowRes.motionVecs;
+		inputs.miscBuf       = &lowRes.miscBuf;
+		inputs.dirAlbedo     = &lowRes.black;
+		inputs.indirAlbedo   = &lowRes.white;
+		mpIndirectFilter->execute(inputs, lowRes.filtered);
+
+		const StageTraffic &traffic = mpIndirectFilter->getLastTraffic();
+		mTraffic.bytesRead    += traffic.bytesRead;
+		mTraffic.bytesWritten += traffic.bytesWritten;
+		mTraffic.bytesCopied  += traffic.bytesCopied;
+		mTimings.lowResIndirect = elapsedMs(start);
+	}
+
+	void CpuSVGFFilter::upsampleIndirect(int32_t scale, ImageF4 &output)
+	{
+		StageTimer::Scope scope(mpStageTimer.get(), mStageIds.upsample);
+		Clock::time_point start = Clock::now();
+
+		// Normals and depth at both resolutions, already decoded when the vectorized a-trous ran
+		if (!mSettings.simdAtrous || mSettings.filterIterations <= 0)
+		{
+			geometryToPlanar(*mpThreadPool, *mInputTex.miscBuf, mPlanarGeometry);
+			geometryToPlanar(*mpThreadPool, mLowRes.miscBuf, mpIndirectFilter->mPlanarGeometry);
+		}
+
+		UpsampleSimdArgs args;
+		args.pGeometry    = &mPlanarGeometry;
+		args.pLowGeometry = &mpIndirectFilter->mPlanarGeometry;
+		args.pLowIndirect = &mLowRes.filtered;
+		args.pIndirAlbedo = mInputTex.indirAlbedo;
+		args.pOutput      = &output;
+		args.scale        = scale;
+
+		UpsampleSimdFunc kernel = getUpsampleSimdKernel(mSettings.simdIsa);
+		forEachRowBand(*mpThreadPool, mHeight, 8, [&](int y0, int y1)
+		{
+			UpsampleSimdArgs band = args;
+			band.y0 = y0;
+			band.y1 = y1;
+			kernel(band);
+		});
+
+		mTimings.upsample = elapsedMs(start);
+	}
+}
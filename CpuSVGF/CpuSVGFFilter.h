@@ -0,0 +1,296 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include "SVGFImage.h"
+#include "CpuThreadPool.h"
+#include "SVGFPlanar.h"
+#include "SVGFSimd.h"
+#include "SVGFStorageFormat.h"
+#include "SVGFStageTimer.h"
+#include <memory>
+
+namespace CpuSVGF
+{
+	/** Everything SVGFPass reads from the resource manager each frame.  Names mirror SVGFPass::mInputTex.
+	*/
+	struct FrameInputs
+	{
+		const ImageF4 *directIllum   = nullptr;   ///< Demodulated direct illumination ("DirectAccum")
+		const ImageF4 *indirectIllum = nullptr;   ///< Demodulated indirect illumination ("IndirectAccum")
+		const ImageF4 *linearZ       = nullptr;   ///< "SVGF_LinearZ":  linear z, max z-deriv, prev z, oct obj-space normal
+		const ImageF4 *motionVecs    = nullptr;   ///< "SVGF_MotionVecs":  motion vector, fwidth of pos & normal
+		const ImageF4 *miscBuf       = nullptr;   ///< "SVGF_CompactNormDepth":  oct normal, linear z, max z-deriv
+		const ImageF4 *dirAlbedo     = nullptr;   ///< "OutDirectAlbedo"
+		const ImageF4 *indirAlbedo   = nullptr;   ///< "OutIndirectAlbedo"
+
+		bool isValid() const
+		{
+			return directIllum && indirectIllum && linearZ && motionVecs && miscBuf && dirAlbedo && indirAlbedo;
+		}
+	};
+
+	/** Wall-clock time (in milliseconds) spent in each stage of the last execute()
+	*/
+	struct StageTimings
+	{
+		double reprojection     = 0.0;
+		double varianceEstimate = 0.0;
+		double atrous           = 0.0;
+		double modulation       = 0.0;
+		double lowResIndirect   = 0.0;   ///< Settings::indirectScale > 1:  downsampling and filtering indirect
+		double upsample         = 0.0;   ///< Settings::indirectScale > 1:  upsampling and modulating indirect
+		double geometryWeights  = 0.0;   ///< Settings::geometryWeightCache:  the pre-pass, included in atrous
+		double total            = 0.0;
+	};
+
+	/** Bytes of full-screen buffers read and written by the reprojection and moment filter stages in the last
+	    execute(), counting each buffer once per pixel touched (neighborhood re-reads are assumed to hit in cache)
+	*/
+	struct StageTraffic
+	{
+		uint64_t bytesRead    = 0;
+		uint64_t bytesWritten = 0;
+		uint64_t bytesCopied  = 0;   ///< Full-screen copies made only for bookkeeping (feedback and linear z history), whole frame
+	};
+
+	/** Work done by the adaptive a-trous (Settings::adaptiveAtrous) in the last execute()
+	*/
+	struct AdaptiveStats
+	{
+		uint32_t              tileCount = 0;    ///< Tiles covering the screen
+		std::vector<uint32_t> activeTiles;      ///< Tiles filtered by each a-trous iteration
+	};
+
+	/** A headless, multithreaded CPU implementation of SVGFPass.  It runs the same five stages (reprojection,
+	    moment filtering, a-trous decomposition, modulation or unfiltered combine) on plain float images,
+	    splitting each stage into screen tiles processed across all cores.  Internal buffers and their
+	    ping-ponging mirror the FBOs in SVGFPass so the two implementations can be compared frame by frame.
+	*/
+	class CpuSVGFFilter
+	{
+	public:
+		using SharedPtr = std::shared_ptr<CpuSVGFFilter>;
+
+		/** Same defaults and meaning as the SVGFPass member variables of the same name
+		*/
+		struct Settings
+		{
+			int32_t filterIterations = 4;
+			int32_t feedbackTap      = 1;
+			float   phiColor         = 10.0f;
+			float   phiNormal        = 128.0f;
+			float   alpha            = 0.05f;
+			float   momentsAlpha     = 0.2f;
+			bool    filterEnabled    = true;
+
+			// CPU only:  run the a-trous iterations on planar buffers with the vectorized kernel.  When false, the
+			//    per-pixel port of SVGFAtrous.ps.hlsl is used, which is the reference the SIMD path is checked against.
+			bool    simdAtrous       = true;
+			SimdIsa simdIsa          = detectSimdIsa();
+
+			// CPU only:  run reprojection and the moment filter in one tile pass.  Reprojected values are kept in a
+			//    per-thread tile buffer with a 3 pixel halo instead of going through the full-screen reprojection targets;
+			//    only what the next frame (or the other stages) read back is written out.  The output is identical.
+			bool    fusedReprojection = false;
+
+			// Emulates SVGFPass' storage format option by rounding every value written to the ping-pong, filtered past
+			//    and reprojection buffers to the precision of the matching render target format
+			StorageFormat storageFormat = StorageFormat::Full;
+
+			// Mirrors SVGFPass' blit-free mode:  the feedback iteration writes straight into the filtered past, the
+			//    previous frame's reprojected color is read in place when there is no feedback tap, and linear z
+			//    history is kept in the reprojection buffers (which are swapped) instead of copied.  The output is
+			//    identical.  Changing it drops the temporal history.
+			bool    blitFree          = false;
+
+			// Adaptive a-trous (vectorized path only).  From adaptiveFirstIteration on, iterations only run on the tiles
+			//    that still need work:  some pixel has less than adaptiveMinHistory frames of history, or the noise left
+			//    after temporal accumulation (the filtered variance times the variance reduction of the exponential
+			//    average) has a standard deviation above adaptiveNoiseThreshold relative to the luminance.  Converged
+			//    tiles are copied through once and skipped by the remaining iterations.
+			bool    adaptiveAtrous         = false;
+			int32_t adaptiveFirstIteration = 1;
+			float   adaptiveMinHistory     = 8.0f;
+			float   adaptiveNoiseThreshold = 0.02f;
+
+			// Filter indirect illumination at 1/2 or 1/4 of the resolution in each direction (1 keeps it at full
+			//    resolution).  Indirect, linear z, motion and SVGF_CompactNormDepth are downsampled, reprojected, moment
+			//    filtered and a-trous filtered with their own history, then brought back to full resolution with a
+			//    depth and normal guided upsample before modulation; the full resolution passes only filter direct.
+			//    Changing it drops the temporal history.
+			int32_t indirectScale          = 1;
+
+			// Vectorized path only:  compute the depth weight of every a-trous tap and iteration in one pre-pass per
+			//    frame, stored with 8 bits per tap (24 bytes per pixel and iteration), so the iterations only evaluate
+			//    the luminance terms and no longer read linear z around each pixel.  Quantizing the weights changes
+			//    the output slightly.
+			bool    geometryWeightCache    = false;
+
+			// Mirror SVGFPass' a-trous kernel settings:  the IllumChannels the a-trous filters (a channel left out keeps
+			//    its temporally accumulated value) and the kernel radius, 1 (3x3 taps) or 2 (5x5 taps).  Each combination,
+			//    with and without modulation, runs a kernel compiled for it.
+			uint32_t atrousChannels        = kBothChannels;
+			int32_t  atrousRadius          = 2;
+		};
+
+		/** Edge length of the tiles the adaptive a-trous culls
+		*/
+		static const uint32_t kAdaptiveTileSize = 16;
+
+		/** Create a filter.  A null thread pool creates one using every hardware thread.
+		*/
+		static SharedPtr create(CpuThreadPool::SharedPtr pThreadPool = nullptr);
+
+		/** Reallocate internal buffers.  Like SVGFPass::resize(), this drops all temporal history.
+		*/
+		void resize(uint32_t width, uint32_t height);
+
+		/** Filter one frame into output (resized if needed).  Inputs must all match the size passed to resize().
+		    Returns false if the inputs are incomplete or mis-sized.
+		*/
+		bool execute(const FrameInputs &inputs, ImageF4 &output);
+
+		/** Forget temporal history; the next frame is filtered as if it was the first one
+		*/
+		void reset() { mNeedFboClear = true; }
+
+		Settings       &getSettings()       { return mSettings; }
+		const Settings &getSettings() const { return mSettings; }
+		void setSettings(const Settings &settings) { mSettings = settings; }
+
+		const StageTimings &getLastTimings() const { return mTimings; }
+
+		/** Record each stage ("reprojection", "filter moments", "a-trous <i>", "feedback copy", "modulation",
+		    "low-res indirect", "indirect upsample" and "total") into pTimer, ending a timer frame per execute().  Pass nullptr to stop.
+		*/
+		void setStageTimer(StageTimer::SharedPtr pTimer);
+		StageTimer::SharedPtr getStageTimer() const { return mpStageTimer; }
+
+		const StageTraffic &getLastTraffic() const { return mTraffic; }
+		const AdaptiveStats &getLastAdaptiveStats() const { return mAdaptiveStats; }
+		uint32_t getWidth() const  { return mWidth; }
+		uint32_t getHeight() const { return mHeight; }
+
+		/** Tile edge length (in pixels) used to distribute work across threads
+		*/
+		void     setTileSize(uint32_t size) { mTileSize = std::max(8u, size); }
+		uint32_t getTileSize() const        { return mTileSize; }
+
+	protected:
+		CpuSVGFFilter(CpuThreadPool::SharedPtr pThreadPool);
+
+		// CPU equivalents of the SVGFPass framebuffers.  Attachment order matches the shader SV_TARGETs.
+		struct IllumFbo
+		{
+			ImageF4 direct;
+			ImageF4 indirect;
+		};
+
+		struct ReprojFbo
+		{
+			ImageF4 direct;
+			ImageF4 indirect;
+			ImageF4 moments;
+			ImageF  historyLength;
+			ImageF4 linearZ;          // Blit-free only:  this frame's linear z, the previous one once swapped
+		};
+
+		Settings                 mSettings;
+		CpuThreadPool::SharedPtr mpThreadPool;
+		uint32_t                 mTileSize = 32;
+		uint32_t                 mWidth    = 0;
+		uint32_t                 mHeight   = 0;
+
+		// Intermediate framebuffers
+		IllumFbo                 mPingPongFbo[2];
+		IllumFbo                 mFilteredPastFbo;
+		ReprojFbo                mCurReprojFbo;
+		ReprojFbo                mPrevReprojFbo;
+		ImageF4                  mPrevLinearZ;
+
+		// Structure-of-arrays copies of the ping-pong buffers and the decoded geometry for the SIMD a-trous path
+		PlanarImage              mPlanarIllum[2];
+		PlanarImage              mPlanarGeometry;
+		std::vector<uint8_t>     mGeometryWeights;   // Settings::geometryWeightCache, see GeometryWeightSimdArgs
+
+		// Adaptive a-trous:  indices of the tiles the next iteration filters, and scratch flags for culling them
+		std::vector<uint32_t>    mActiveTiles;
+		std::vector<uint8_t>     mTileNeedsWork;
+		AdaptiveStats            mAdaptiveStats;
+
+		FrameInputs              mInputTex;
+		StageTimings             mTimings;
+		StageTraffic             mTraffic;
+		bool                     mNeedFboClear = true;
+
+		// Blit-free bookkeeping:  the mode the history was built with, and whether last frame's filtered past is the
+		//    reprojected color in mPrevReprojFbo rather than mFilteredPastFbo
+		bool                     mHistoryBlitFree      = false;
+		bool                     mFilteredPastInReproj = false;
+
+		// Reduced resolution indirect (Settings::indirectScale):  the filter running on the downsampled frame, which only
+		//    filters indirect, and its inputs and output.  mChannels are the IllumChannels our own passes filter.
+		SharedPtr                mpIndirectFilter;
+		struct
+		{
+			ImageF4              indirect, linearZ, motionVecs, miscBuf;
+			ImageF4              black, white;   // Direct input and albedo, indirect albedo:  its output is filtered indirect
+			ImageF4              filtered;
+		}                        mLowRes;
+		bool                     mIndirectOnly         = false;
+		uint32_t                 mChannels             = kBothChannels;
+		int32_t                  mHistoryIndirectScale = 1;
+
+		// Optional per-stage instrumentation, with the stage ids registered in it
+		StageTimer::SharedPtr    mpStageTimer;
+		struct
+		{
+			uint32_t              total = 0, reprojection = 0, filterMoments = 0, feedbackCopy = 0, modulation = 0;
+			uint32_t              lowResIndirect = 0, upsample = 0;
+			std::vector<uint32_t> atrous;
+		} mStageIds;
+
+	private:
+		// After resizing or creating framebuffers, make sure to initialize them
+		void clearFbos();
+
+		// Id of the timer stage for a-trous iteration i, registering it on first use
+		uint32_t getAtrousStageId(int i);
+
+		// Settings::indirectScale snapped to 1, 2 or 4
+		int32_t getIndirectScale() const;
+
+		// Where reprojection finds last frame's linear z and filtered illumination
+		const ImageF4 &getPrevLinearZ() const;
+		const ImageF4 &getFilteredPastDirect() const   { return mFilteredPastInReproj ? mPrevReprojFbo.direct : mFilteredPastFbo.direct; }
+		const ImageF4 &getFilteredPastIndirect() const { return mFilteredPastInReproj ? mPrevReprojFbo.indirect : mFilteredPastFbo.indirect; }
+
+		// Encapsulate each of the passes in its own method
+		void computeReprojection();
+		void computeVarianceEstimate();
+		void computeReprojectionAndVarianceFused();
+		void computeAtrousDecomposition(ImageF4 &output);
+		void computeAtrousDecompositionSimd(ImageF4 &output);
+		void cullConvergedTiles(const PlanarImage &in, PlanarImage &out, bool intoHistory);
+		void computeModulation(ImageF4 &output);
+		void filterIndirectLowRes(int32_t scale);
+		void upsampleIndirect(int32_t scale, ImageF4 &output);
+		void combineUnfiltered(ImageF4 &output);
+	};
+}
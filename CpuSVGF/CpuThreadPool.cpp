@@ -0,0 +1,126 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "CpuThreadPool.h"
+#include <algorithm>
+
+namespace CpuSVGF
+{
+	CpuThreadPool::SharedPtr CpuThreadPool::create(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		return SharedPtr(new CpuThreadPool(threadCount));
+	}
+
+	CpuThreadPool::CpuThreadPool(uint32_t threadCount)
+	{
+		// The calling thread always participates, so we only spawn threadCount-1 workers
+		for (uint32_t i = 1; i < threadCount; i++)
+			mWorkers.emplace_back(&CpuThreadPool::workerLoop, this);
+	}
+
+	CpuThreadPool::~CpuThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQuit = true;
+		}
+		mWakeCond.notify_all();
+		for (auto &worker : mWorkers)
+			worker.join();
+	}
+
+	void CpuThreadPool::runTasks(Job &job)
+	{
+		for (;;)
+		{
+			// An index below taskCount guarantees the submitter is still waiting, so pTask is alive
+			uint32_t i = job.nextTask.fetch_add(1);
+			if (i >= job.taskCount) break;
+			(*job.pTask)(i);
+			if (job.tasksLeft.fetch_sub(1) == 1)
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mDoneCond.notify_all();
+			}
+		}
+	}
+
+	void CpuThreadPool::workerLoop()
+	{
+		uint64_t seenGeneration = 0;
+		for (;;)
+		{
+			std::shared_ptr<Job> pJob;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mWakeCond.wait(lock, [&] { return mQuit || mGeneration != seenGeneration; });
+				if (mQuit) return;
+				seenGeneration = mGeneration;
+				pJob = mpJob;
+			}
+			runTasks(*pJob);
+		}
+	}
+
+	void CpuThreadPool::parallelFor(uint32_t taskCount, const std::function<void(uint32_t)> &task)
+	{
+		if (taskCount == 0) return;
+
+		// No point waking anyone up for a single task
+		if (taskCount == 1 || mWorkers.empty())
+		{
+			for (uint32_t i = 0; i < taskCount; i++) task(i);
+			return;
+		}
+
+		std::lock_guard<std::mutex> submitLock(mSubmitMutex);
+		auto pJob = std::make_shared<Job>();
+		pJob->pTask     = &task;
+		pJob->taskCount = taskCount;
+		pJob->tasksLeft = taskCount;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mpJob = pJob;
+			mGeneration++;
+		}
+		mWakeCond.notify_all();
+
+		runTasks(*pJob);
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDoneCond.wait(lock, [&] { return pJob->tasksLeft == 0; });
+	}
+
+	void CpuThreadPool::forEachTile(uint32_t width, uint32_t height, uint32_t tileSize, const std::function<void(const TileRect &)> &task)
+	{
+		const uint32_t tilesX = (width + tileSize - 1) / tileSize;
+		const uint32_t tilesY = (height + tileSize - 1) / tileSize;
+
+		parallelFor(tilesX * tilesY, [&](uint32_t tile)
+		{
+			TileRect rect;
+			rect.x0 = int((tile % tilesX) * tileSize);
+			rect.y0 = int((tile / tilesX) * tileSize);
+			rect.x1 = std::min(rect.x0 + int(tileSize), int(width));
+			rect.y1 = std::min(rect.y0 + int(tileSize), int(height));
+			task(rect);
+		});
+	}
+}
@@ -0,0 +1,85 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CpuSVGF
+{
+	/** A screen-space rectangle [x0, x1) x [y0, y1) handed to tile callbacks
+	*/
+	struct TileRect
+	{
+		int x0, y0, x1, y1;
+	};
+
+	/** A small persistent pool of worker threads.  Work is submitted as a flat range of task indices; the
+	    calling thread participates and parallelFor() returns once every index has been processed.
+	*/
+	class CpuThreadPool
+	{
+	public:
+		using SharedPtr = std::shared_ptr<CpuThreadPool>;
+
+		/** Create a pool.  A thread count of 0 uses every hardware thread.
+		*/
+		static SharedPtr create(uint32_t threadCount = 0);
+		~CpuThreadPool();
+
+		uint32_t getThreadCount() const { return uint32_t(mWorkers.size()) + 1; }
+
+		/** Run task(i) for every i in [0, taskCount).  Concurrent callers are serialized.
+		*/
+		void parallelFor(uint32_t taskCount, const std::function<void(uint32_t)> &task);
+
+		/** Split a width x height image into tileSize x tileSize tiles and process them across all threads
+		*/
+		void forEachTile(uint32_t width, uint32_t height, uint32_t tileSize, const std::function<void(const TileRect &)> &task);
+
+	private:
+		CpuThreadPool(uint32_t threadCount);
+		// One parallelFor() submission.  Workers hold a reference, so a late worker never touches a newer job's counters.
+		struct Job
+		{
+			const std::function<void(uint32_t)> *pTask = nullptr;
+			uint32_t                             taskCount = 0;
+			std::atomic<uint32_t>                nextTask{ 0 };
+			std::atomic<uint32_t>                tasksLeft{ 0 };
+		};
+
+		void workerLoop();
+		void runTasks(Job &job);
+
+		std::vector<std::thread>               mWorkers;
+		std::mutex                             mSubmitMutex;       ///< Serializes parallelFor() callers
+		std::mutex                             mMutex;
+		std::condition_variable                mWakeCond;
+		std::condition_variable                mDoneCond;
+
+		std::shared_ptr<Job>                   mpJob;
+		uint64_t                               mGeneration = 0;
+		bool                                   mQuit = false;
+	};
+}
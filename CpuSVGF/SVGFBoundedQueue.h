@@ -0,0 +1,84 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace CpuSVGF
+{
+	/** A blocking FIFO holding at most a fixed number of items, connecting pipeline stages that run on different
+	    threads.  push() waits while the queue is full, which holds a producer back to the pace of its consumer
+	    (backpressure); pop() waits while it is empty.  close() wakes every waiter:  from then on pushes fail, and
+	    pops fail once the items already queued are drained.
+	*/
+	template <typename T>
+	class BoundedQueue
+	{
+	public:
+		explicit BoundedQueue(size_t capacity) : mCapacity(std::max<size_t>(1, capacity)) {}
+
+		BoundedQueue(const BoundedQueue &) = delete;
+		BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+		/** Returns false, dropping item, if the queue is closed
+		*/
+		bool push(T item)
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mNotFull.wait(lock, [&] { return mClosed || mItems.size() < mCapacity; });
+			if (mClosed) return false;
+			mItems.push_back(std::move(item));
+			mNotEmpty.notify_one();
+			return true;
+		}
+
+		/** Returns false once the queue is closed and empty
+		*/
+		bool pop(T &item)
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mNotEmpty.wait(lock, [&] { return mClosed || !mItems.empty(); });
+			if (mItems.empty()) return false;
+			item = std::move(mItems.front());
+			mItems.pop_front();
+			mNotFull.notify_one();
+			return true;
+		}
+
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mClosed = true;
+			mNotFull.notify_all();
+			mNotEmpty.notify_all();
+		}
+
+		size_t getCapacity() const { return mCapacity; }
+
+	private:
+		const size_t            mCapacity;
+		std::deque<T>           mItems;
+		bool                    mClosed = false;
+		std::mutex              mMutex;
+		std::condition_variable mNotFull;
+		std::condition_variable mNotEmpty;
+	};
+}
@@ -0,0 +1,717 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFBvh.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace CpuSVGF
+{
+	namespace {
+		const uint32_t kMaxLeafTriangles = 4;
+		const uint32_t kMaxBuildDepth    = TriangleBvh::kMaxStackDepth - 2;   ///< Deeper nodes become leaves, so traversal never drops one
+		const uint32_t kBinCount         = 16;
+		const uint32_t kParallelBinning  = 1u << 16;             ///< Nodes with more triangles are binned across threads
+		const float    kTraversalCost    = 1.0f;                 ///< Relative to one triangle test
+
+		// Cache file layout:  a 64 byte header, then nodes, triangle order and triangles, each 64 byte aligned
+		const char     kBvhMagic[4]     = { 'S', 'V', 'B', 'H' };
+		const uint32_t kBvhVersion      = 1;
+		const uint32_t kBvhHeaderSize   = 64;
+		const uint64_t kBvhAlignment    = 64;
+
+		static_assert(sizeof(BvhNode) == 32, "BvhNode is written to cache files as is");
+		static_assert(sizeof(float3) == 12, "float3 is written to cache files as is");
+
+		template <typename T> void putField(uint8_t *pDst, size_t offset, T value) { std::memcpy(pDst + offset, &value, sizeof(T)); }
+		template <typename T> T    getField(const uint8_t *pSrc, size_t offset)    { T value; std::memcpy(&value, pSrc + offset, sizeof(T)); return value; }
+
+		uint64_t alignUp(uint64_t offset) { return (offset + kBvhAlignment - 1) & ~(kBvhAlignment - 1); }
+
+		// Slab test; returns the entry distance, or infinity (beyond any tMax) if the box is missed
+		inline float intersectBounds(const BvhNode &node, const float3 &origin, const float3 &invDir, float tMin, float tMax)
+		{
+			const float3 t0 = (node.boundsMin - origin) * invDir;
+			const float3 t1 = (node.boundsMax - origin) * invDir;
+			const float3 lo = min(t0, t1), hi = max(t0, t1);
+			const float enter = std::max(std::max(lo.x, lo.y), std::max(lo.z, tMin));
+			const float exit  = std::min(std::min(hi.x, hi.y), std::min(hi.z, tMax));
+			return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+		}
+
+		inline float getAxis(const float3 &v, int axis) { return axis == 0 ? v.x : axis == 1 ? v.y : v.z; }
+
+		// Spread the low bits of v to every second (part1By1) or third (part1By2) bit, for Morton codes
+		inline uint32_t part1By1(uint32_t v)
+		{
+			v &= 0x0000ffffu;
+			v = (v | (v << 8)) & 0x00ff00ffu;
+			v = (v | (v << 4)) & 0x0f0f0f0fu;
+			v = (v | (v << 2)) & 0x33333333u;
+			v = (v | (v << 1)) & 0x55555555u;
+			return v;
+		}
+
+		inline uint32_t part1By2(uint32_t v)
+		{
+			v &= 0x000003ffu;
+			v = (v | (v << 16)) & 0xff0000ffu;
+			v = (v | (v << 8))  & 0x0300f00fu;
+			v = (v | (v << 4))  & 0x030c30c3u;
+			v = (v | (v << 2))  & 0x09249249u;
+			return v;
+		}
+
+		inline uint32_t quantize(float x, uint32_t levels)
+		{
+			return uint32_t(std::min(std::max(x, 0.0f), 1.0f) * float(levels - 1) + 0.5f);
+		}
+
+		// Ray stream sort key:  the octahedral direction in 8x8 cells above a 24 bit Morton code of the origin.  Finer
+		//    direction cells leave too few rays per cell for the origin order to matter.
+		uint32_t getRaySortKey(const Ray &ray, const float3 &sceneMin, const float3 &sceneInvExtent)
+		{
+			const float  l1 = std::abs(ray.dir.x) + std::abs(ray.dir.y) + std::abs(ray.dir.z);
+			float        ox = l1 > 0.0f ? ray.dir.x / l1 : 0.0f;
+			float        oy = l1 > 0.0f ? ray.dir.y / l1 : 0.0f;
+			if (ray.dir.z < 0.0f)
+			{
+				const float fx = (1.0f - std::abs(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+				const float fy = (1.0f - std::abs(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+				ox = fx;
+				oy = fy;
+			}
+			const uint32_t dirKey = part1By1(quantize(ox * 0.5f + 0.5f, 8)) | (part1By1(quantize(oy * 0.5f + 0.5f, 8)) << 1);
+
+			const float3   p = (ray.origin - sceneMin) * sceneInvExtent;
+			const uint32_t posKey = part1By2(quantize(p.x, 256)) | (part1By2(quantize(p.y, 256)) << 1) | (part1By2(quantize(p.z, 256)) << 2);
+			return (dirKey << 24) | posKey;
+		}
+
+		struct Aabb
+		{
+			float3 lo = float3(std::numeric_limits<float>::max());
+			float3 hi = float3(-std::numeric_limits<float>::max());
+
+			void grow(const float3 &p)  { lo = min(lo, p); hi = max(hi, p); }
+			void grow(const Aabb &box)  { lo = min(lo, box.lo); hi = max(hi, box.hi); }
+
+			// Half the surface area; 0 for an empty box
+			float halfArea() const
+			{
+				if (lo.x > hi.x) return 0.0f;
+				const float3 d = hi - lo;
+				return d.x * d.y + d.y * d.z + d.z * d.x;
+			}
+		};
+
+		struct Bin
+		{
+			Aabb     bounds;
+			uint32_t count = 0;
+		};
+		using BinSet = Bin[3][kBinCount];
+
+		/** A node while building; children are indices into the same vector, or -1 for a leaf
+		*/
+		struct BuildNode
+		{
+			Aabb     bounds;
+			uint32_t first = 0, count = 0;
+			int32_t  left = -1, right = -1;
+			int32_t  subtree = -1;   ///< Top level only:  index of the subtree task that continues below this node
+		};
+
+		/** Per-triangle bounds and centroids, and the triangle order the builder partitions in place
+		*/
+		struct BuildInput
+		{
+			std::vector<Aabb>   bounds;
+			std::vector<float3> centroids;
+			uint32_t           *pIds;
+			CpuThreadPool      *pPool;
+		};
+
+		/** Bounds of the triangles and of their centroids in [first, first + count)
+		*/
+		void computeBounds(const BuildInput &in, uint32_t first, uint32_t count, Aabb &bounds, Aabb &centroidBounds)
+		{
+			auto run = [&](uint32_t begin, uint32_t end, Aabb &b, Aabb &c)
+			{
+				for (uint32_t i = begin; i < end; i++)
+				{
+					b.grow(in.bounds[in.pIds[i]]);
+					c.grow(in.centroids[in.pIds[i]]);
+				}
+			};
+
+			if (!in.pPool || count < kParallelBinning)
+			{
+				run(first, first + count, bounds, centroidBounds);
+				return;
+			}
+
+			const uint32_t chunkCount = in.pPool->getThreadCount() * 4;
+			std::vector<Aabb> chunkBounds(chunkCount), chunkCentroids(chunkCount);
+			in.pPool->parallelFor(chunkCount, [&](uint32_t c)
+			{
+				run(first + uint32_t(uint64_t(count) * c / chunkCount), first + uint32_t(uint64_t(count) * (c + 1) / chunkCount), chunkBounds[c], chunkCentroids[c]);
+			});
+			for (uint32_t c = 0; c < chunkCount; c++)
+			{
+				bounds.grow(chunkBounds[c]);
+				centroidBounds.grow(chunkCentroids[c]);
+			}
+		}
+
+		struct BinMapping
+		{
+			float3 lo;
+			float3 scale;   ///< Bins per unit along each axis; 0 on axes with no extent
+
+			uint32_t getBin(const float3 &centroid, int axis) const
+			{
+				const float b = (getAxis(centroid, axis) - getAxis(lo, axis)) * getAxis(scale, axis);
+				return std::min(uint32_t(std::max(b, 0.0f)), kBinCount - 1);
+			}
+		};
+
+		void binTriangles(const BuildInput &in, uint32_t first, uint32_t count, const BinMapping &mapping, BinSet &bins)
+		{
+			auto run = [&](uint32_t begin, uint32_t end, BinSet &out)
+			{
+				for (uint32_t i = begin; i < end; i++)
+				{
+					const uint32_t id = in.pIds[i];
+					for (int axis = 0; axis < 3; axis++)
+					{
+						Bin &bin = out[axis][mapping.getBin(in.centroids[id], axis)];
+						bin.bounds.grow(in.bounds[id]);
+						bin.count++;
+					}
+				}
+			};
+
+			if (!in.pPool || count < kParallelBinning)
+			{
+				run(first, first + count, bins);
+				return;
+			}
+
+			const uint32_t chunkCount = in.pPool->getThreadCount() * 4;
+			std::vector<BinSet> chunkBins(chunkCount);
+			in.pPool->parallelFor(chunkCount, [&](uint32_t c)
+			{
+				run(first + uint32_t(uint64_t(count) * c / chunkCount), first + uint32_t(uint64_t(count) * (c + 1) / chunkCount), chunkBins[c]);
+			});
+			for (uint32_t c = 0; c < chunkCount; c++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					for (uint32_t b = 0; b < kBinCount; b++)
+					{
+						bins[axis][b].bounds.grow(chunkBins[c][axis][b].bounds);
+						bins[axis][b].count += chunkBins[c][axis][b].count;
+					}
+				}
+			}
+		}
+
+		/** Fill in the bounds of node and, unless it should be a leaf, partition its triangles and return the
+		    number that go to the left child (0 for a leaf)
+		*/
+		uint32_t splitNode(const BuildInput &in, BuildNode &node, uint32_t depth)
+		{
+			Aabb centroidBounds;
+			computeBounds(in, node.first, node.count, node.bounds, centroidBounds);
+			if (node.count <= 1 || depth >= kMaxBuildDepth) return 0;
+
+			const float3 extent = centroidBounds.hi - centroidBounds.lo;
+			BinMapping mapping;
+			mapping.lo = centroidBounds.lo;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				const float e = getAxis(extent, axis);
+				const float s = e > 0.0f ? float(kBinCount) * 0.9999f / e : 0.0f;
+				(axis == 0 ? mapping.scale.x : axis == 1 ? mapping.scale.y : mapping.scale.z) = s;
+			}
+
+			BinSet bins;
+			binTriangles(in, node.first, node.count, mapping, bins);
+
+			// Sweep each axis from both ends; a split after bin b puts bins [0, b] on the left
+			int      bestAxis = -1;
+			uint32_t bestBin = 0;
+			float    bestCost = std::numeric_limits<float>::max();
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (getAxis(mapping.scale, axis) == 0.0f) continue;
+
+				float rightCost[kBinCount];
+				Aabb box;
+				uint32_t n = 0;
+				for (uint32_t b = kBinCount - 1; b > 0; b--)
+				{
+					box.grow(bins[axis][b].bounds);
+					n += bins[axis][b].count;
+					rightCost[b - 1] = box.halfArea() * float(n);
+				}
+
+				box = Aabb();
+				n = 0;
+				for (uint32_t b = 0; b + 1 < kBinCount; b++)
+				{
+					box.grow(bins[axis][b].bounds);
+					n += bins[axis][b].count;
+					if (n == 0 || n == node.count) continue;
+					const float cost = box.halfArea() * float(n) + rightCost[b];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = b;
+					}
+				}
+			}
+
+			uint32_t *pIds = in.pIds + node.first;
+			const float parentArea = node.bounds.halfArea();
+			if (bestAxis < 0)
+			{
+				// Every centroid in one spot:  split in order, just to keep leaves small
+				return node.count <= kMaxLeafTriangles ? 0 : node.count / 2;
+			}
+
+			const float splitCost = kTraversalCost + (parentArea > 0.0f ? bestCost / parentArea : 0.0f);
+			if (node.count <= kMaxLeafTriangles && float(node.count) <= splitCost) return 0;
+
+			return uint32_t(std::partition(pIds, pIds + node.count, [&](uint32_t id) { return mapping.getBin(in.centroids[id], bestAxis) <= bestBin; }) - pIds);
+		}
+
+		/** Build the subtree below root on the calling thread, depth first
+		*/
+		void buildSubtree(const BuildInput &in, std::vector<BuildNode> &nodes, uint32_t rootDepth)
+		{
+			struct Pending { uint32_t node, depth; };
+			std::vector<Pending> pending = { { 0, rootDepth } };
+			while (!pending.empty())
+			{
+				const Pending job = pending.back();
+				pending.pop_back();
+
+				const uint32_t leftCount = splitNode(in, nodes[job.node], job.depth);
+				if (leftCount == 0) continue;
+
+				BuildNode left, right;
+				left.first  = nodes[job.node].first;
+				left.count  = leftCount;
+				right.first = left.first + leftCount;
+				right.count = nodes[job.node].count - leftCount;
+				nodes[job.node].left  = int32_t(nodes.size());
+				nodes[job.node].right = int32_t(nodes.size() + 1);
+				nodes.push_back(left);
+				nodes.push_back(right);
+				pending.push_back({ uint32_t(nodes[job.node].right), job.depth + 1 });
+				pending.push_back({ uint32_t(nodes[job.node].left), job.depth + 1 });
+			}
+		}
+
+		/** Copy a build tree into the final layout:  children in adjacent slots, allocated depth first
+		*/
+		void flatten(const std::vector<std::vector<BuildNode>> &subtrees, const std::vector<BuildNode> &tree, int32_t index,
+		             uint32_t slot, std::vector<BvhNode> &out)
+		{
+			const BuildNode &node = tree[index];
+			if (node.subtree >= 0)
+			{
+				flatten(subtrees, subtrees[node.subtree], 0, slot, out);
+				return;
+			}
+
+			out[slot].boundsMin = node.bounds.lo;
+			out[slot].boundsMax = node.bounds.hi;
+			if (node.left < 0)
+			{
+				out[slot].index = node.first;
+				out[slot].triangleCount = node.count;
+				return;
+			}
+
+			const uint32_t children = uint32_t(out.size());
+			out[slot].index = children;
+			out[slot].triangleCount = 0;
+			out.resize(out.size() + 2);
+			flatten(subtrees, tree, node.left, children, out);
+			flatten(subtrees, tree, node.right, children + 1, out);
+		}
+	};
+
+	TriangleBvh::SharedPtr TriangleBvh::build(Scene::SharedPtr pScene, CpuThreadPool::SharedPtr pThreadPool)
+	{
+		if (!pScene || pScene->getTriangleCount() == 0) return nullptr;
+		if (!pThreadPool) pThreadPool = CpuThreadPool::create();
+		SharedPtr pBvh = SharedPtr(new TriangleBvh(pScene));
+
+		const uint32_t count = pScene->getTriangleCount();
+		pBvh->mTriangleIds.resize(count);
+
+		BuildInput in;
+		in.bounds.resize(count);
+		in.centroids.resize(count);
+		in.pIds = pBvh->mTriangleIds.data();
+		in.pPool = pThreadPool.get();
+
+		const uint32_t chunkCount = pThreadPool->getThreadCount() * 4;
+		pThreadPool->parallelFor(chunkCount, [&](uint32_t c)
+		{
+			for (uint32_t i = uint32_t(uint64_t(count) * c / chunkCount); i < uint32_t(uint64_t(count) * (c + 1) / chunkCount); i++)
+			{
+				const float3 *p = pScene->getPositions(i);
+				in.bounds[i].grow(p[0]);
+				in.bounds[i].grow(p[1]);
+				in.bounds[i].grow(p[2]);
+				in.centroids[i] = (in.bounds[i].lo + in.bounds[i].hi) * 0.5f;
+				in.pIds[i] = i;
+			}
+		});
+
+		// Top of the tree:  split breadth first on this thread (binning in parallel) until every open node is small
+		//    enough to be one task of a parallel subtree build
+		const uint32_t taskSize = std::max(1024u, count / (pThreadPool->getThreadCount() * 8));
+		std::vector<BuildNode> top(1);
+		top[0].count = count;
+		struct Task { uint32_t node, depth; };
+		std::vector<Task> open = { { 0, 0 } }, tasks;
+		for (size_t i = 0; i < open.size(); i++)
+		{
+			const Task job = open[i];
+			if (top[job.node].count <= taskSize)
+			{
+				top[job.node].subtree = int32_t(tasks.size());
+				tasks.push_back(job);
+				continue;
+			}
+
+			const uint32_t leftCount = splitNode(in, top[job.node], job.depth);
+			if (leftCount == 0) continue;
+
+			BuildNode left, right;
+			left.first  = top[job.node].first;
+			left.count  = leftCount;
+			right.first = left.first + leftCount;
+			right.count = top[job.node].count - leftCount;
+			top[job.node].left  = int32_t(top.size());
+			top[job.node].right = int32_t(top.size() + 1);
+			top.push_back(left);
+			top.push_back(right);
+			open.push_back({ uint32_t(top[job.node].left), job.depth + 1 });
+			open.push_back({ uint32_t(top[job.node].right), job.depth + 1 });
+		}
+
+		// Subtrees have their own node vectors and disjoint triangle ranges; the nodes below them bin serially
+		std::vector<std::vector<BuildNode>> subtrees(tasks.size());
+		BuildInput serialIn = in;
+		serialIn.pPool = nullptr;
+		pThreadPool->parallelFor(uint32_t(tasks.size()), [&](uint32_t t)
+		{
+			subtrees[t].resize(1);
+			subtrees[t][0].first = top[tasks[t].node].first;
+			subtrees[t][0].count = top[tasks[t].node].count;
+			buildSubtree(serialIn, subtrees[t], tasks[t].depth);
+		});
+
+		size_t nodeCount = 0;
+		for (const BuildNode &node : top) nodeCount += node.subtree < 0 ? 1 : 0;
+		for (const std::vector<BuildNode> &subtree : subtrees) nodeCount += subtree.size();
+		pBvh->mNodes.reserve(nodeCount);
+		pBvh->mNodes.resize(1);
+		flatten(subtrees, top, 0, 0, pBvh->mNodes);
+
+		pBvh->mTriangles.resize(3 * size_t(count));
+		pThreadPool->parallelFor(chunkCount, [&](uint32_t c)
+		{
+			for (uint32_t i = uint32_t(uint64_t(count) * c / chunkCount); i < uint32_t(uint64_t(count) * (c + 1) / chunkCount); i++)
+			{
+				const float3 *p = pScene->getPositions(pBvh->mTriangleIds[i]);
+				pBvh->mTriangles[3 * size_t(i) + 0] = p[0];
+				pBvh->mTriangles[3 * size_t(i) + 1] = p[1] - p[0];
+				pBvh->mTriangles[3 * size_t(i) + 2] = p[2] - p[0];
+			}
+		});
+
+		pBvh->mpNodes        = pBvh->mNodes.data();
+		pBvh->mpTriangleIds  = pBvh->mTriangleIds.data();
+		pBvh->mpTriangles    = pBvh->mTriangles.data();
+		pBvh->mNodeCount     = uint32_t(pBvh->mNodes.size());
+		pBvh->mTriangleCount = count;
+		pBvh->mAlphaTest     = pScene->hasAlphaTest();
+		return pBvh;
+	}
+
+	std::string TriangleBvh::getCachePath(const Scene &scene, const std::string &cacheDir)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.svgfbvh", (unsigned long long)scene.getGeometryHash());
+		return cacheDir.empty() ? std::string(name) : cacheDir + "/" + name;
+	}
+
+	bool TriangleBvh::save(const std::string &path) const
+	{
+		const uint64_t nodesOffset     = kBvhHeaderSize;
+		const uint64_t idsOffset       = alignUp(nodesOffset + uint64_t(mNodeCount) * sizeof(BvhNode));
+		const uint64_t trianglesOffset = alignUp(idsOffset + uint64_t(mTriangleCount) * sizeof(uint32_t));
+		const uint64_t fileSize        = trianglesOffset + uint64_t(mTriangleCount) * 3 * sizeof(float3);
+
+		uint8_t header[kBvhHeaderSize] = {};
+		std::memcpy(header, kBvhMagic, 4);
+		putField<uint32_t>(header, 4, kBvhVersion);
+		putField<uint64_t>(header, 8, mpScene->getGeometryHash());
+		putField<uint32_t>(header, 16, mTriangleCount);
+		putField<uint32_t>(header, 20, mNodeCount);
+		putField<uint64_t>(header, 24, nodesOffset);
+		putField<uint64_t>(header, 32, idsOffset);
+		putField<uint64_t>(header, 40, trianglesOffset);
+		putField<uint64_t>(header, 48, fileSize);
+
+		// Write under a temporary name, so a reader never maps a half written file
+		const std::string tempPath = path + ".tmp";
+		FILE *pFile = std::fopen(tempPath.c_str(), "wb");
+		if (!pFile) return false;
+
+		const uint8_t padding[kBvhAlignment] = {};
+		auto write = [&](const void *pData, uint64_t size) { return size == 0 || std::fwrite(pData, 1, size_t(size), pFile) == size; };
+		auto pad = [&](uint64_t offset) { return write(padding, alignUp(offset) - offset); };
+		bool ok = write(header, kBvhHeaderSize) &&
+		          write(mpNodes, uint64_t(mNodeCount) * sizeof(BvhNode)) && pad(nodesOffset + uint64_t(mNodeCount) * sizeof(BvhNode)) &&
+		          write(mpTriangleIds, uint64_t(mTriangleCount) * sizeof(uint32_t)) && pad(idsOffset + uint64_t(mTriangleCount) * sizeof(uint32_t)) &&
+		          write(mpTriangles, uint64_t(mTriangleCount) * 3 * sizeof(float3));
+		ok = (std::fclose(pFile) == 0) && ok;
+
+		if (ok)
+		{
+			std::remove(path.c_str());
+			ok = std::rename(tempPath.c_str(), path.c_str()) == 0;
+		}
+		if (!ok) std::remove(tempPath.c_str());
+		return ok;
+	}
+
+	TriangleBvh::SharedPtr TriangleBvh::load(Scene::SharedPtr pScene, const std::string &path)
+	{
+		if (!pScene || pScene->getTriangleCount() == 0) return nullptr;
+		MappedFile::SharedPtr pMapping = MappedFile::open(path);
+		if (!pMapping || pMapping->getSize() < kBvhHeaderSize) return nullptr;
+
+		const uint8_t *pData = pMapping->getData();
+		if (std::memcmp(pData, kBvhMagic, 4) != 0 || getField<uint32_t>(pData, 4) != kBvhVersion) return nullptr;
+		if (getField<uint64_t>(pData, 8) != pScene->getGeometryHash()) return nullptr;
+
+		const uint32_t triangleCount   = getField<uint32_t>(pData, 16);
+		const uint32_t nodeCount       = getField<uint32_t>(pData, 20);
+		const uint64_t nodesOffset     = getField<uint64_t>(pData, 24);
+		const uint64_t idsOffset       = getField<uint64_t>(pData, 32);
+		const uint64_t trianglesOffset = getField<uint64_t>(pData, 40);
+		if (triangleCount != pScene->getTriangleCount() || nodeCount == 0 || getField<uint64_t>(pData, 48) != pMapping->getSize()) return nullptr;
+		if (nodesOffset + uint64_t(nodeCount) * sizeof(BvhNode) > idsOffset ||
+		    idsOffset + uint64_t(triangleCount) * sizeof(uint32_t) > trianglesOffset ||
+		    trianglesOffset + uint64_t(triangleCount) * 3 * sizeof(float3) > pMapping->getSize()) return nullptr;
+
+		SharedPtr pBvh = SharedPtr(new TriangleBvh(pScene));
+		pBvh->mpNodes        = reinterpret_cast<const BvhNode *>(pData + nodesOffset);
+		pBvh->mpTriangleIds  = reinterpret_cast<const uint32_t *>(pData + idsOffset);
+		pBvh->mpTriangles    = reinterpret_cast<const float3 *>(pData + trianglesOffset);
+		pBvh->mNodeCount     = nodeCount;
+		pBvh->mTriangleCount = triangleCount;
+		pBvh->mAlphaTest     = pScene->hasAlphaTest();
+		pBvh->mpMapping      = pMapping;
+		return pBvh;
+	}
+
+	TriangleBvh::SharedPtr TriangleBvh::buildCached(Scene::SharedPtr pScene, const std::string &cacheDir, CpuThreadPool::SharedPtr pThreadPool, bool *pLoaded)
+	{
+		if (pLoaded) *pLoaded = false;
+		if (!pScene) return nullptr;
+
+		const std::string path = getCachePath(*pScene, cacheDir);
+		SharedPtr pBvh = load(pScene, path);
+		if (pBvh)
+		{
+			if (pLoaded) *pLoaded = true;
+			return pBvh;
+		}
+
+		pBvh = build(pScene, pThreadPool);
+		if (pBvh) pBvh->save(path);
+		return pBvh;
+	}
+
+	double TriangleBvh::getSahCost() const
+	{
+		auto halfArea = [](const BvhNode &node)
+		{
+			const float3 d = node.boundsMax - node.boundsMin;
+			return double(d.x) * d.y + double(d.y) * d.z + double(d.z) * d.x;
+		};
+
+		const double rootArea = halfArea(mpNodes[0]);
+		if (rootArea <= 0.0) return 0.0;
+		double cost = 0.0;
+		for (uint32_t i = 0; i < mNodeCount; i++)
+		{
+			const BvhNode &node = mpNodes[i];
+			cost += halfArea(node) / rootArea * (node.triangleCount > 0 ? double(node.triangleCount) : double(kTraversalCost));
+		}
+		return cost;
+	}
+
+	uint64_t TriangleBvh::getMemorySize() const
+	{
+		return uint64_t(mNodeCount) * sizeof(BvhNode) + uint64_t(mTriangleCount) * (sizeof(uint32_t) + 3 * sizeof(float3));
+	}
+
+	template <bool kAnyHit>
+	bool TriangleBvh::traverse(const Ray &ray, RayHit &hit) const
+	{
+		const float3 invDir(1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z);
+		float    tMax = ray.tMax;
+		bool     found = false;
+		uint32_t stack[kMaxStackDepth];
+		uint32_t stackSize = 0;
+		uint32_t nodeIndex = 0;
+		if (intersectBounds(mpNodes[0], ray.origin, invDir, ray.tMin, tMax) > tMax) return false;
+
+		for (;;)
+		{
+			const BvhNode &node = mpNodes[nodeIndex];
+			if (node.triangleCount > 0)
+			{
+				for (uint32_t i = node.index; i < node.index + node.triangleCount; i++)
+				{
+					// Moller-Trumbore
+					const float3 &v0 = mpTriangles[3 * size_t(i)], &e1 = mpTriangles[3 * size_t(i) + 1], &e2 = mpTriangles[3 * size_t(i) + 2];
+					const float3 pvec = cross(ray.dir, e2);
+					const float  det  = dot(e1, pvec);
+					if (det == 0.0f) continue;
+					const float  invDet = 1.0f / det;
+					const float3 tvec = ray.origin - v0;
+					const float  u = dot(tvec, pvec) * invDet;
+					if (u < 0.0f || u > 1.0f) continue;
+					const float3 qvec = cross(tvec, e1);
+					const float  v = dot(ray.dir, qvec) * invDet;
+					if (v < 0.0f || u + v > 1.0f) continue;
+					const float  t = dot(e2, qvec) * invDet;
+					if (t < ray.tMin || t > tMax) continue;
+					if (mAlphaTest && mpScene->alphaTestFails(mpTriangleIds[i], u, v)) continue;
+
+					found = true;
+					if (kAnyHit) return true;
+					tMax = t;
+					hit.t = t;
+					hit.triangle = mpTriangleIds[i];
+					hit.u = u;
+					hit.v = v;
+				}
+			}
+			else
+			{
+				// Visit the nearer child first; the other waits on the stack
+				const uint32_t left = node.index, right = node.index + 1;
+				const float tLeft  = intersectBounds(mpNodes[left], ray.origin, invDir, ray.tMin, tMax);
+				const float tRight = intersectBounds(mpNodes[right], ray.origin, invDir, ray.tMin, tMax);
+				const bool hitLeft = tLeft <= tMax, hitRight = tRight <= tMax;
+				if (hitLeft && hitRight)
+				{
+					const bool leftFirst = tLeft <= tRight;
+					if (stackSize < kMaxStackDepth) stack[stackSize++] = leftFirst ? right : left;
+					nodeIndex = leftFirst ? left : right;
+					continue;
+				}
+				if (hitLeft || hitRight)
+				{
+					nodeIndex = hitLeft ? left : right;
+					continue;
+				}
+			}
+
+			if (stackSize == 0) break;
+			nodeIndex = stack[--stackSize];
+		}
+		return found;
+	}
+
+	bool TriangleBvh::intersect(const Ray &ray, RayHit &hit) const
+	{
+		return traverse<false>(ray, hit);
+	}
+
+	bool TriangleBvh::occluded(const Ray &ray) const
+	{
+		RayHit hit;
+		return traverse<true>(ray, hit);
+	}
+
+	BvhPacketArgs TriangleBvh::getPacketArgs(const Ray *pRays, uint32_t count, RayHit *pHits, uint8_t *pFound) const
+	{
+		BvhPacketArgs args;
+		args.pNodes = mpNodes;
+		args.pTriangles = mpTriangles;
+		args.pTriangleIds = mpTriangleIds;
+		args.pAlphaScene = mAlphaTest ? mpScene.get() : nullptr;
+		args.pRays = pRays;
+		args.pOrder = nullptr;
+		args.count = count;
+		args.pHits = pHits;
+		args.pFound = pFound;
+		return args;
+	}
+
+	void TriangleBvh::intersectPacket(const Ray *pRays, uint32_t count, RayHit *pHits, uint8_t *pFound, SimdIsa isa) const
+	{
+		if (count == 0) return;
+		getBvhPacketKernel(isa)(getPacketArgs(pRays, count, pHits, pFound));
+	}
+
+	void TriangleBvh::occludedPacket(const Ray *pRays, uint32_t count, uint8_t *pOccluded, SimdIsa isa) const
+	{
+		if (count == 0) return;
+		getBvhPacketKernel(isa)(getPacketArgs(pRays, count, nullptr, pOccluded));
+	}
+
+	void TriangleBvh::intersectStream(const Ray *pRays, uint32_t count, RayHit *pHits, uint8_t *pFound, SimdIsa isa) const
+	{
+		if (count == 0) return;
+
+		const float3 sceneMin = mpNodes[0].boundsMin;
+		const float3 extent = mpNodes[0].boundsMax - mpNodes[0].boundsMin;
+		const float3 invExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+		// Key above index, so one sort orders the rays and keeps equal keys in a fixed order
+		std::vector<uint64_t> keys(count);
+		for (uint32_t i = 0; i < count; i++) keys[i] = (uint64_t(getRaySortKey(pRays[i], sceneMin, invExtent)) << 32) | i;
+		std::sort(keys.begin(), keys.end());
+
+		std::vector<uint32_t> order(count);
+		for (uint32_t i = 0; i < count; i++) order[i] = uint32_t(keys[i]);
+
+		BvhPacketArgs args = getPacketArgs(pRays, count, pHits, pFound);
+		args.pOrder = order.data();
+		getBvhPacketKernel(isa)(args);
+	}
+}
@@ -0,0 +1,151 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// A bounding volume hierarchy over the triangles of a Scene, for the CPU reference path tracer
+
+#pragma once
+#include "CpuThreadPool.h"
+#include "SVGFMappedFile.h"
+#include "SVGFScene.h"
+#include "SVGFSimd.h"
+
+namespace CpuSVGF
+{
+	struct Ray
+	{
+		float3 origin;
+		float3 dir;
+		float  tMin = 0.0f;
+		float  tMax = 1e38f;
+	};
+
+	/** Closest hit of a ray; u and v are the barycentric weights of the triangle's second and third vertex
+	*/
+	struct RayHit
+	{
+		float    t = 0.0f;
+		uint32_t triangle = ~0u;
+		float    u = 0.0f, v = 0.0f;
+	};
+
+	/** A node of the flattened tree (32 bytes, two to a cache line).  The children of an interior node are
+	    adjacent, at index and index + 1, and the tree is laid out depth first; a leaf holds triangleCount
+	    triangles starting at index in the BVH's triangle order.
+	*/
+	struct BvhNode
+	{
+		float3   boundsMin;
+		uint32_t index;
+		float3   boundsMax;
+		uint32_t triangleCount;   ///< 0 for interior nodes
+	};
+
+	class TriangleBvh
+	{
+	public:
+		using SharedPtr = std::shared_ptr<TriangleBvh>;
+
+		static const uint32_t kMaxStackDepth = 64;   ///< Traversal stack entries; build() keeps leaves shallower than this
+
+		/** Build over every triangle of the scene with a binned surface area heuristic.  Large nodes near the root
+		    are binned across the pool's threads; once the top of the tree is split into enough pieces, the
+		    subtrees below them are built in parallel.
+		*/
+		static SharedPtr build(Scene::SharedPtr pScene, CpuThreadPool::SharedPtr pThreadPool = nullptr);
+
+		/** Map a BVH written by save() and use it in place.  Returns nullptr if the file is missing, truncated,
+		    from another version of the builder or built for other geometry (see Scene::getGeometryHash()).
+		*/
+		static SharedPtr load(Scene::SharedPtr pScene, const std::string &path);
+
+		/** Load the scene's BVH from cacheDir if it is there, else build it and save it there; failing to save
+		    only loses the cache.  pLoaded (if given) tells which happened.
+		*/
+		static SharedPtr buildCached(Scene::SharedPtr pScene, const std::string &cacheDir, CpuThreadPool::SharedPtr pThreadPool = nullptr, bool *pLoaded = nullptr);
+
+		/** <cacheDir>/<geometry hash>.svgfbvh
+		*/
+		static std::string getCachePath(const Scene &scene, const std::string &cacheDir);
+
+		/** Write the tree in the layout load() maps.  Returns false on a write error.
+		*/
+		bool save(const std::string &path) const;
+
+		/** Closest hit in [tMin, tMax].  Like the any-hit shaders, hits that fail the alpha test are ignored.
+		*/
+		bool intersect(const Ray &ray, RayHit &hit) const;
+
+		/** True if anything (that passes the alpha test) lies in [tMin, tMax]; stops at the first such hit
+		*/
+		bool occluded(const Ray &ray) const;
+
+		/** intersect() for count rays, traced in packets of the instruction set's width.  pFound[i] tells whether
+		    pHits[i] was written.  Packets are formed from consecutive rays, which should be coherent:  the camera
+		    rays of a tile, or shadow rays from nearby points toward one light.
+		*/
+		void intersectPacket(const Ray *pRays, uint32_t count, RayHit *pHits, uint8_t *pFound, SimdIsa isa) const;
+
+		/** occluded() for count rays, in packets like intersectPacket()
+		*/
+		void occludedPacket(const Ray *pRays, uint32_t count, uint8_t *pOccluded, SimdIsa isa) const;
+
+		/** intersectPacket() for large batches of incoherent rays, such as the diffuse bounces of a whole frame:  the
+		    rays are first sorted by direction, then by origin, and packets are formed in that order.  Hits are
+		    returned in the order of pRays.  Sorting only pays for itself over thousands of rays whose origins are
+		    scattered; the bounces of one tile trace faster as plain packets.
+		*/
+		void intersectStream(const Ray *pRays, uint32_t count, RayHit *pHits, uint8_t *pFound, SimdIsa isa) const;
+
+		uint32_t getNodeCount() const { return mNodeCount; }
+		const Scene::SharedPtr &getScene() const { return mpScene; }
+
+		/** True if the nodes and triangles live in a mapping of a cache file
+		*/
+		bool isMapped() const { return mpMapping != nullptr; }
+
+		/** Expected cost of a random ray, in units of one triangle test:  the surface area heuristic summed over
+		    the tree, counting a node visit as one test
+		*/
+		double getSahCost() const;
+
+		/** Bytes of the nodes, triangle order and triangle data
+		*/
+		uint64_t getMemorySize() const;
+
+	private:
+		TriangleBvh(Scene::SharedPtr pScene) : mpScene(pScene) {}
+
+		template <bool kAnyHit> bool traverse(const Ray &ray, RayHit &hit) const;
+		BvhPacketArgs getPacketArgs(const Ray *pRays, uint32_t count, RayHit *pHits, uint8_t *pFound) const;
+
+		Scene::SharedPtr      mpScene;
+		bool                  mAlphaTest = false;
+
+		// Point into the vectors below after build(), or into the mapping after load()
+		const BvhNode        *mpNodes = nullptr;
+		const uint32_t       *mpTriangleIds = nullptr;   ///< Scene triangle of each triangle in leaf order
+		const float3         *mpTriangles = nullptr;     ///< Vertex 0 and the two edges from it, per triangle in leaf order
+		uint32_t              mNodeCount = 0;
+		uint32_t              mTriangleCount = 0;
+
+		std::vector<BvhNode>  mNodes;
+		std::vector<uint32_t> mTriangleIds;
+		std::vector<float3>   mTriangles;
+		MappedFile::SharedPtr mpMapping;
+	};
+}
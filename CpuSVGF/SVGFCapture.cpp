@@ -0,0 +1,383 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFCapture.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace CpuSVGF
+{
+	namespace {
+		const char     kCaptureMagic[4] = { 'S', 'V', 'C', 'P' };
+		const uint32_t kCaptureVersion  = 1;
+		const uint32_t kHeaderSize      = 64;
+		const uint32_t kChunkAlignment  = 64;
+		const uint32_t kIndexEntrySize  = 24;
+
+		enum ChunkCodec : uint32_t
+		{
+			kCodecRaw        = 0,
+			kCodecDeltaRle   = 1,
+		};
+
+		const char *kChannelNames[kCaptureChannelCount] = { "DirectAccum", "IndirectAccum", "SVGF_LinearZ", "SVGF_MotionVecs",
+		                                                    "SVGF_CompactNormDepth", "OutDirectAlbedo", "OutIndirectAlbedo" };
+
+		// Little endian field access; the format is only used on little endian hosts (x86, ARM)
+		template <typename T> void putField(uint8_t *pDst, size_t offset, T value) { std::memcpy(pDst + offset, &value, sizeof(T)); }
+		template <typename T> T    getField(const uint8_t *pSrc, size_t offset)    { T value; std::memcpy(&value, pSrc + offset, sizeof(T)); return value; }
+
+		void putVarint(std::vector<uint8_t> &out, uint64_t value)
+		{
+			while (value >= 0x80) { out.push_back(uint8_t(value | 0x80)); value >>= 7; }
+			out.push_back(uint8_t(value));
+		}
+
+		bool getVarint(const uint8_t *pData, size_t size, size_t &pos, uint64_t &value)
+		{
+			value = 0;
+			for (uint32_t shift = 0; shift < 64; shift += 7)
+			{
+				if (pos >= size) return false;
+				uint8_t b = pData[pos++];
+				value |= uint64_t(b & 0x7F) << shift;
+				if ((b & 0x80) == 0) return true;
+			}
+			return false;
+		}
+
+		const ImageF4 *getChannel(const FrameInputs &inputs, uint32_t channel)
+		{
+			switch (channel)
+			{
+			case kCaptureDirectIllum:      return inputs.directIllum;
+			case kCaptureIndirectIllum:    return inputs.indirectIllum;
+			case kCaptureLinearZ:          return inputs.linearZ;
+			case kCaptureMotionVecs:       return inputs.motionVecs;
+			case kCaptureCompactNormDepth: return inputs.miscBuf;
+			case kCaptureDirAlbedo:        return inputs.dirAlbedo;
+			case kCaptureIndirAlbedo:      return inputs.indirAlbedo;
+			default:                       return nullptr;
+			}
+		}
+	};
+
+	const char *getCaptureChannelName(uint32_t channel)
+	{
+		return channel < kCaptureChannelCount ? kChannelNames[channel] : "unknown";
+	}
+
+	// ---- Codec ----
+
+	void compressChunk(const uint8_t *pData, size_t size, std::vector<uint8_t> &out)
+	{
+		// Byte planes, delta coded along each plane
+		const size_t words = size / 4;
+		std::vector<uint8_t> stream(size);
+		for (size_t plane = 0; plane < 4; plane++)
+		{
+			uint8_t *pPlane = stream.data() + plane * words;
+			uint8_t  prev   = 0;
+			for (size_t i = 0; i < words; i++)
+			{
+				const uint8_t cur = pData[i * 4 + plane];
+				pPlane[i] = uint8_t(cur - prev);
+				prev = cur;
+			}
+		}
+
+		// Tokens of { varint literal count, literals, varint zero count }.  Zero runs shorter than 3 stay literals.
+		out.clear();
+		size_t k = 0;
+		while (k < size)
+		{
+			const size_t literalStart = k;
+			size_t run = 0;
+			while (k < size)
+			{
+				if (stream[k] != 0) { k++; continue; }
+				run = 0;
+				while (k + run < size && stream[k + run] == 0) run++;
+				if (run >= 3 || k + run == size) break;
+				k += run;
+				run = 0;
+			}
+
+			putVarint(out, k - literalStart);
+			out.insert(out.end(), stream.begin() + literalStart, stream.begin() + k);
+			putVarint(out, run);
+			k += run;
+		}
+	}
+
+	bool decompressChunk(const uint8_t *pData, size_t storedSize, uint8_t *pOut, size_t size)
+	{
+		std::vector<uint8_t> stream(size);
+		size_t pos = 0, k = 0;
+		while (k < size)
+		{
+			uint64_t literals, zeros;
+			if (!getVarint(pData, storedSize, pos, literals)) return false;
+			if (literals > size - k || literals > storedSize - pos) return false;
+			std::memcpy(stream.data() + k, pData + pos, size_t(literals));
+			pos += size_t(literals);
+			k   += size_t(literals);
+
+			if (!getVarint(pData, storedSize, pos, zeros)) return false;
+			if (zeros > size - k) return false;
+			std::memset(stream.data() + k, 0, size_t(zeros));
+			k += size_t(zeros);
+		}
+		if (pos != storedSize) return false;
+
+		// Undo the delta coding and interleave the planes back into words
+		const size_t words = size / 4;
+		for (size_t plane = 0; plane < 4; plane++)
+		{
+			const uint8_t *pPlane = stream.data() + plane * words;
+			uint8_t prev = 0;
+			for (size_t i = 0; i < words; i++)
+			{
+				prev = uint8_t(prev + pPlane[i]);
+				pOut[i * 4 + plane] = prev;
+			}
+		}
+		return true;
+	}
+
+	// ---- Writer ----
+
+	CaptureWriter::SharedPtr CaptureWriter::create(const std::string &path, uint32_t width, uint32_t height, bool compress)
+	{
+		if (width == 0 || height == 0) return nullptr;
+
+		FILE *pFile = std::fopen(path.c_str(), "wb");
+		if (!pFile) return nullptr;
+
+		SharedPtr pWriter = SharedPtr(new CaptureWriter());
+		pWriter->mpFile    = pFile;
+		pWriter->mWidth    = width;
+		pWriter->mHeight   = height;
+		pWriter->mCompress = compress;
+
+		// Placeholder header; close() rewrites it once the frame count and index offset are known
+		uint8_t header[kHeaderSize] = {};
+		if (!pWriter->writeBytes(header, sizeof(header))) return nullptr;
+		return pWriter;
+	}
+
+	CaptureWriter::~CaptureWriter()
+	{
+		close();
+	}
+
+	bool CaptureWriter::writeBytes(const void *pData, size_t size)
+	{
+		if (mFailed || std::fwrite(pData, 1, size, mpFile) != size)
+		{
+			mFailed = true;
+			return false;
+		}
+		mOffset += size;
+		return true;
+	}
+
+	bool CaptureWriter::padToAlignment()
+	{
+		static const uint8_t zeros[kChunkAlignment] = {};
+		const size_t pad = size_t((kChunkAlignment - mOffset % kChunkAlignment) % kChunkAlignment);
+		return writeBytes(zeros, pad);
+	}
+
+	bool CaptureWriter::addFrame(const FrameInputs &inputs)
+	{
+		if (!mpFile || mFailed || !inputs.isValid()) return false;
+
+		for (uint32_t c = 0; c < kCaptureChannelCount; c++)
+		{
+			const ImageF4 *pImage = getChannel(inputs, c);
+			if (pImage->getWidth() != mWidth || pImage->getHeight() != mHeight) return false;
+		}
+
+		for (uint32_t c = 0; c < kCaptureChannelCount; c++)
+		{
+			const ImageF4 *pImage = getChannel(inputs, c);
+			const uint8_t *pBytes = reinterpret_cast<const uint8_t *>(pImage->getData());
+			const size_t   size   = pImage->getByteSize();
+
+			ChunkEntry entry = { mOffset, size, kCodecRaw };
+			if (mCompress)
+			{
+				compressChunk(pBytes, size, mScratch);
+				if (mScratch.size() < size)
+				{
+					entry.size  = mScratch.size();
+					entry.codec = kCodecDeltaRle;
+				}
+			}
+
+			if (!writeBytes(entry.codec == kCodecRaw ? pBytes : mScratch.data(), size_t(entry.size)) || !padToAlignment()) return false;
+			mIndex.push_back(entry);
+			mRawBytes    += size;
+			mStoredBytes += entry.size;
+		}
+		return true;
+	}
+
+	bool CaptureWriter::close()
+	{
+		if (!mpFile) return !mFailed;
+
+		const uint64_t indexOffset = mOffset;
+		for (const ChunkEntry &entry : mIndex)
+		{
+			uint8_t bytes[kIndexEntrySize] = {};
+			putField<uint64_t>(bytes, 0, entry.offset);
+			putField<uint64_t>(bytes, 8, entry.size);
+			putField<uint32_t>(bytes, 16, entry.codec);
+			writeBytes(bytes, sizeof(bytes));
+		}
+
+		uint8_t header[kHeaderSize] = {};
+		std::memcpy(header, kCaptureMagic, 4);
+		putField<uint32_t>(header, 4, kCaptureVersion);
+		putField<uint32_t>(header, 8, mWidth);
+		putField<uint32_t>(header, 12, mHeight);
+		putField<uint32_t>(header, 16, kCaptureChannelCount);
+		putField<uint32_t>(header, 20, getFrameCount());
+		putField<uint64_t>(header, 24, indexOffset);
+		putField<uint32_t>(header, 32, mCompress ? 1u : 0u);
+
+		if (std::fseek(mpFile, 0, SEEK_SET) != 0 || std::fwrite(header, 1, sizeof(header), mpFile) != sizeof(header))
+			mFailed = true;
+		if (std::fclose(mpFile) != 0)
+			mFailed = true;
+		mpFile = nullptr;
+		return !mFailed;
+	}
+
+	// ---- Reader ----
+
+	CaptureReader::SharedPtr CaptureReader::open(const std::string &path)
+	{
+		SharedPtr pReader = SharedPtr(new CaptureReader());
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return nullptr;
+		pReader->mFileHandle = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart < kHeaderSize) return nullptr;
+		pReader->mSize = uint64_t(size.QuadPart);
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		if (!mapping) return nullptr;
+		pReader->mMappingHandle = mapping;
+
+		pReader->mpBase = static_cast<uint8_t *>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+		if (!pReader->mpBase) return nullptr;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return nullptr;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size < off_t(kHeaderSize)) { ::close(fd); return nullptr; }
+		pReader->mSize = uint64_t(st.st_size);
+
+		void *pMap = mmap(nullptr, size_t(pReader->mSize), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (pMap == MAP_FAILED) return nullptr;
+		pReader->mpBase = static_cast<uint8_t *>(pMap);
+#endif
+
+		const uint8_t *pHeader = pReader->mpBase;
+		if (std::memcmp(pHeader, kCaptureMagic, 4) != 0 || getField<uint32_t>(pHeader, 4) != kCaptureVersion) return nullptr;
+		if (getField<uint32_t>(pHeader, 16) != kCaptureChannelCount) return nullptr;
+
+		pReader->mWidth       = getField<uint32_t>(pHeader, 8);
+		pReader->mHeight      = getField<uint32_t>(pHeader, 12);
+		pReader->mFrameCount  = getField<uint32_t>(pHeader, 20);
+		pReader->mIndexOffset = getField<uint64_t>(pHeader, 24);
+
+		const uint64_t indexSize = uint64_t(pReader->mFrameCount) * kCaptureChannelCount * kIndexEntrySize;
+		if (pReader->mIndexOffset < kHeaderSize || pReader->mIndexOffset + indexSize > pReader->mSize) return nullptr;
+		return pReader;
+	}
+
+	CaptureReader::~CaptureReader()
+	{
+#ifdef _WIN32
+		if (mpBase) UnmapViewOfFile(mpBase);
+		if (mMappingHandle) CloseHandle(mMappingHandle);
+		if (mFileHandle) CloseHandle(mFileHandle);
+#else
+		if (mpBase) munmap(mpBase, size_t(mSize));
+#endif
+	}
+
+	bool CaptureReader::readFrame(uint32_t frame, CaptureFrame &out) const
+	{
+		if (frame >= mFrameCount) return false;
+
+		const size_t rawSize = size_t(mWidth) * mHeight * sizeof(float4);
+		for (uint32_t c = 0; c < kCaptureChannelCount; c++)
+		{
+			const uint8_t *pEntry = mpBase + mIndexOffset + (uint64_t(frame) * kCaptureChannelCount + c) * kIndexEntrySize;
+			const uint64_t offset = getField<uint64_t>(pEntry, 0);
+			const uint64_t size   = getField<uint64_t>(pEntry, 8);
+			const uint32_t codec  = getField<uint32_t>(pEntry, 16);
+			if (offset > mSize || size > mSize - offset) return false;
+
+			ImageF4 &image = out.images[c];
+			if (codec == kCodecRaw)
+			{
+				if (size != rawSize || offset % alignof(float4) != 0) return false;
+				image.wrap(mWidth, mHeight, reinterpret_cast<float4 *>(mpBase + offset));
+			}
+			else if (codec == kCodecDeltaRle)
+			{
+				if (image.isWrapping() || image.getWidth() != mWidth || image.getHeight() != mHeight)
+					image.resize(mWidth, mHeight);
+				if (!decompressChunk(mpBase + offset, size_t(size), reinterpret_cast<uint8_t *>(image.getData()), rawSize)) return false;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		out.inputs.directIllum   = &out.images[kCaptureDirectIllum];
+		out.inputs.indirectIllum = &out.images[kCaptureIndirectIllum];
+		out.inputs.linearZ       = &out.images[kCaptureLinearZ];
+		out.inputs.motionVecs    = &out.images[kCaptureMotionVecs];
+		out.inputs.miscBuf       = &out.images[kCaptureCompactNormDepth];
+		out.inputs.dirAlbedo     = &out.images[kCaptureDirAlbedo];
+		out.inputs.indirAlbedo   = &out.images[kCaptureIndirAlbedo];
+		return true;
+	}
+}
@@ -0,0 +1,152 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include "CpuSVGFFilter.h"
+#include <cstdio>
+#include <string>
+
+namespace CpuSVGF
+{
+	/** Everything SVGFPass reads per frame, in the order chunks are stored in a capture
+	*/
+	enum CaptureChannel : uint32_t
+	{
+		kCaptureDirectIllum,        ///< "DirectAccum"
+		kCaptureIndirectIllum,      ///< "IndirectAccum"
+		kCaptureLinearZ,            ///< "SVGF_LinearZ"
+		kCaptureMotionVecs,         ///< "SVGF_MotionVecs"
+		kCaptureCompactNormDepth,   ///< "SVGF_CompactNormDepth"
+		kCaptureDirAlbedo,          ///< "OutDirectAlbedo"
+		kCaptureIndirAlbedo,        ///< "OutIndirectAlbedo"
+		kCaptureChannelCount
+	};
+
+	/** Resource manager name of a capture channel
+	*/
+	const char *getCaptureChannelName(uint32_t channel);
+
+	/** Writes a frame capture (.svgfcap).  The layout, all little endian:
+	        header     64 bytes:  "SVCP", uint32 version, width, height, channel count, frame count,
+	                              uint64 index offset, uint32 flags, zero padding
+	        chunks     one per channel per frame, each starting on a 64-byte boundary.  A raw chunk is the
+	                   width * height RGBA32F texels, so it can be used straight from a memory mapping;
+	                   a compressed chunk holds the same texels run through compressChunk().
+	        index      frame count * channel count entries of { uint64 offset, uint64 size, uint32 codec, uint32 0 }
+	    The index is written last by close(), so a capture cut short (e.g. by a crash) is not readable.
+	*/
+	class CaptureWriter
+	{
+	public:
+		using SharedPtr = std::shared_ptr<CaptureWriter>;
+
+		/** Start a capture; every frame must be width x height.  Returns nullptr if the file can't be created.
+		*/
+		static SharedPtr create(const std::string &path, uint32_t width, uint32_t height, bool compress);
+		~CaptureWriter();
+
+		/** Append a frame.  Returns false if the inputs are incomplete or mis-sized, or on a write error.
+		*/
+		bool addFrame(const FrameInputs &inputs);
+
+		/** Write the index and close the file (also done by the destructor).  Returns false on a write error.
+		*/
+		bool close();
+
+		uint32_t getFrameCount() const   { return uint32_t(mIndex.size() / kCaptureChannelCount); }
+		uint64_t getRawBytes() const     { return mRawBytes; }
+		uint64_t getStoredBytes() const  { return mStoredBytes; }
+
+	private:
+		CaptureWriter() = default;
+
+		struct ChunkEntry
+		{
+			uint64_t offset;
+			uint64_t size;
+			uint32_t codec;
+		};
+
+		bool writeBytes(const void *pData, size_t size);
+		bool padToAlignment();
+
+		FILE                   *mpFile = nullptr;
+		uint32_t                mWidth = 0, mHeight = 0;
+		bool                    mCompress = false;
+		bool                    mFailed = false;
+		uint64_t                mOffset = 0;
+		uint64_t                mRawBytes = 0, mStoredBytes = 0;
+		std::vector<ChunkEntry> mIndex;
+		std::vector<uint8_t>    mScratch;
+	};
+
+	/** A loaded capture frame.  Raw chunks are wrapped straight out of the file mapping (no copy); compressed
+	    chunks are decoded into the images, whose storage is reused from frame to frame.
+	*/
+	struct CaptureFrame
+	{
+		ImageF4     images[kCaptureChannelCount];
+		FrameInputs inputs;
+	};
+
+	/** Memory-maps a capture for random access.  The mapping is copy-on-write, so images wrapping it can be
+	    modified without touching the file.
+	*/
+	class CaptureReader
+	{
+	public:
+		using SharedPtr = std::shared_ptr<CaptureReader>;
+
+		/** Returns nullptr if the file is missing, truncated or not a capture
+		*/
+		static SharedPtr open(const std::string &path);
+		~CaptureReader();
+
+		uint32_t getWidth() const      { return mWidth; }
+		uint32_t getHeight() const     { return mHeight; }
+		uint32_t getFrameCount() const { return mFrameCount; }
+		uint64_t getFileSize() const   { return mSize; }
+
+		/** Fetch one frame.  Images from the previous call on the same CaptureFrame are invalidated.
+		    Returns false if the index is out of range or a chunk is corrupt.
+		*/
+		bool readFrame(uint32_t frame, CaptureFrame &out) const;
+
+	private:
+		CaptureReader() = default;
+
+		uint8_t  *mpBase = nullptr;
+		uint64_t  mSize = 0;
+		uint32_t  mWidth = 0, mHeight = 0, mFrameCount = 0;
+		uint64_t  mIndexOffset = 0;
+#ifdef _WIN32
+		void     *mFileHandle = nullptr;
+		void     *mMappingHandle = nullptr;
+#endif
+	};
+
+	/** Lossless codec for float texels:  the bytes of each 32-bit word are split into four planes, each plane is
+	    delta coded, and runs of zero deltas (flat regions, constant channels) are run-length coded.  Cheap to
+	    decode, and needs no external library.  size must be a multiple of 4.
+	*/
+	void compressChunk(const uint8_t *pData, size_t size, std::vector<uint8_t> &out);
+
+	/** Returns false if the stream is corrupt or doesn't decode to exactly size bytes
+	*/
+	bool decompressChunk(const uint8_t *pData, size_t storedSize, uint8_t *pOut, size_t size);
+}
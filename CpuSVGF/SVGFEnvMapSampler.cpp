@@ -0,0 +1,265 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFEnvMapSampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace CpuSVGF
+{
+	namespace {
+		const float kPi = 3.14159265f;
+
+		// Cache file layout:  a 64 byte header, then the marginal and the conditional CDFs, each 64 byte aligned
+		const char     kEnvMagic[4]    = { 'S', 'V', 'E', 'M' };
+		const uint32_t kEnvVersion     = 1;
+		const uint32_t kEnvHeaderSize  = 64;
+		const uint64_t kEnvAlignment   = 64;
+
+		template <typename T> void putField(uint8_t *pDst, size_t offset, T value) { std::memcpy(pDst + offset, &value, sizeof(T)); }
+		template <typename T> T    getField(const uint8_t *pSrc, size_t offset)    { T value; std::memcpy(&value, pSrc + offset, sizeof(T)); return value; }
+
+		uint64_t alignUp(uint64_t offset) { return (offset + kEnvAlignment - 1) & ~(kEnvAlignment - 1); }
+
+		/** Index of the first entry of an inclusive CDF above u, and where u falls within that entry in [0, 1)
+		*/
+		uint32_t findInterval(const float *pCdf, uint32_t count, float u, float &offset)
+		{
+			const uint32_t i = std::min(uint32_t(std::upper_bound(pCdf, pCdf + count, u) - pCdf), count - 1);
+			const float lo = i > 0 ? pCdf[i - 1] : 0.0f;
+			const float width = pCdf[i] - lo;
+			offset = width > 0.0f ? std::min(std::max((u - lo) / width, 0.0f), 0.99999994f) : 0.5f;
+			return i;
+		}
+
+		/** Fill cdf with the inclusive prefix sums of weights scaled to end at 1 (evenly spaced if they sum to 0), and
+		    return the sum
+		*/
+		double buildCdf(const double *pWeights, uint32_t count, float *pCdf)
+		{
+			double sum = 0.0;
+			for (uint32_t i = 0; i < count; i++) sum += pWeights[i];
+			double prefix = 0.0;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				prefix += pWeights[i];
+				pCdf[i] = sum > 0.0 ? float(prefix / sum) : float(double(i + 1) / double(count));
+			}
+			pCdf[count - 1] = 1.0f;
+			return sum;
+		}
+	};
+
+	float3 latLongToWsVector(const float2 &uv)
+	{
+		const float phi = (2.0f * uv.x - 1.0f) * kPi;
+		const float theta = uv.y * kPi;
+		const float sinTheta = std::sin(theta);
+		return float3(sinTheta * std::sin(phi), std::cos(theta), -sinTheta * std::cos(phi));
+	}
+
+	EnvMapSampler::SharedPtr EnvMapSampler::create(const ImageF4 &envMap, CpuThreadPool::SharedPtr pThreadPool)
+	{
+		if (envMap.getWidth() == 0 || envMap.getHeight() == 0) return nullptr;
+		return build(envMap, pThreadPool, getHash(envMap));
+	}
+
+	EnvMapSampler::SharedPtr EnvMapSampler::build(const ImageF4 &envMap, CpuThreadPool::SharedPtr pThreadPool, uint64_t hash)
+	{
+		const uint32_t width = envMap.getWidth(), height = envMap.getHeight();
+		SharedPtr pSampler = SharedPtr(new EnvMapSampler());
+		pSampler->mWidth = width;
+		pSampler->mHeight = height;
+		pSampler->mHash = hash;
+		pSampler->mConditional.resize(size_t(width) * height);
+		pSampler->mMarginal.resize(height);
+
+		// A texel's weight is its luminance times its solid angle, which shrinks with sin(theta) toward the poles
+		std::vector<double> rowSums(height);
+		auto buildRow = [&](uint32_t y)
+		{
+			std::vector<double> weights(width);
+			const double sinTheta = std::sin((double(y) + 0.5) / double(height) * double(kPi));
+			for (uint32_t x = 0; x < width; x++)
+			{
+				const float lum = luminance(envMap.at(x, y).rgb());
+				weights[x] = (std::isfinite(lum) && lum > 0.0f) ? double(lum) * sinTheta : 0.0;
+			}
+			rowSums[y] = buildCdf(weights.data(), width, &pSampler->mConditional[size_t(y) * width]);
+		};
+		if (pThreadPool) pThreadPool->parallelFor(height, buildRow);
+		else for (uint32_t y = 0; y < height; y++) buildRow(y);
+
+		if (buildCdf(rowSums.data(), height, pSampler->mMarginal.data()) <= 0.0) return nullptr;
+		pSampler->mpMarginal = pSampler->mMarginal.data();
+		pSampler->mpConditional = pSampler->mConditional.data();
+		return pSampler;
+	}
+
+	uint64_t EnvMapSampler::getHash(const ImageF4 &envMap)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		auto add = [&](uint32_t word) { hash = (hash ^ word) * 0x100000001b3ull; };
+		add(envMap.getWidth());
+		add(envMap.getHeight());
+		for (uint32_t y = 0; y < envMap.getHeight(); y++)
+		{
+			for (uint32_t x = 0; x < envMap.getWidth(); x++)
+			{
+				const float4 &texel = envMap.at(x, y);
+				add(asuint(texel.x));
+				add(asuint(texel.y));
+				add(asuint(texel.z));
+			}
+		}
+		return hash;
+	}
+
+	std::string EnvMapSampler::getCachePath(const ImageF4 &envMap, const std::string &cacheDir)
+	{
+		return getCachePath(getHash(envMap), cacheDir);
+	}
+
+	std::string EnvMapSampler::getCachePath(uint64_t hash, const std::string &cacheDir)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.svgfenv", (unsigned long long)hash);
+		return cacheDir.empty() ? std::string(name) : cacheDir + "/" + name;
+	}
+
+	bool EnvMapSampler::save(const std::string &path) const
+	{
+		const uint64_t marginalOffset    = kEnvHeaderSize;
+		const uint64_t conditionalOffset = alignUp(marginalOffset + uint64_t(mHeight) * sizeof(float));
+		const uint64_t fileSize          = conditionalOffset + uint64_t(mWidth) * mHeight * sizeof(float);
+
+		uint8_t header[kEnvHeaderSize] = {};
+		std::memcpy(header, kEnvMagic, 4);
+		putField<uint32_t>(header, 4, kEnvVersion);
+		putField<uint64_t>(header, 8, mHash);
+		putField<uint32_t>(header, 16, mWidth);
+		putField<uint32_t>(header, 20, mHeight);
+		putField<uint64_t>(header, 24, marginalOffset);
+		putField<uint64_t>(header, 32, conditionalOffset);
+		putField<uint64_t>(header, 40, fileSize);
+
+		// Write under a temporary name, so a reader never maps a half written file
+		const std::string tempPath = path + ".tmp";
+		FILE *pFile = std::fopen(tempPath.c_str(), "wb");
+		if (!pFile) return false;
+
+		const uint8_t padding[kEnvAlignment] = {};
+		auto write = [&](const void *pData, uint64_t size) { return size == 0 || std::fwrite(pData, 1, size_t(size), pFile) == size; };
+		bool ok = write(header, kEnvHeaderSize) &&
+		          write(mpMarginal, uint64_t(mHeight) * sizeof(float)) &&
+		          write(padding, conditionalOffset - (marginalOffset + uint64_t(mHeight) * sizeof(float))) &&
+		          write(mpConditional, uint64_t(mWidth) * mHeight * sizeof(float));
+		ok = (std::fclose(pFile) == 0) && ok;
+
+		if (ok)
+		{
+			std::remove(path.c_str());
+			ok = std::rename(tempPath.c_str(), path.c_str()) == 0;
+		}
+		if (!ok) std::remove(tempPath.c_str());
+		return ok;
+	}
+
+	EnvMapSampler::SharedPtr EnvMapSampler::load(const ImageF4 &envMap, const std::string &path)
+	{
+		if (envMap.getWidth() == 0 || envMap.getHeight() == 0) return nullptr;
+		return map(path, envMap.getWidth(), envMap.getHeight(), getHash(envMap));
+	}
+
+	EnvMapSampler::SharedPtr EnvMapSampler::map(const std::string &path, uint32_t width, uint32_t height, uint64_t hash)
+	{
+		MappedFile::SharedPtr pMapping = MappedFile::open(path);
+		if (!pMapping || pMapping->getSize() < kEnvHeaderSize) return nullptr;
+
+		const uint8_t *pData = pMapping->getData();
+		if (std::memcmp(pData, kEnvMagic, 4) != 0 || getField<uint32_t>(pData, 4) != kEnvVersion) return nullptr;
+		if (getField<uint64_t>(pData, 8) != hash) return nullptr;
+
+		const uint64_t marginalOffset    = getField<uint64_t>(pData, 24);
+		const uint64_t conditionalOffset = getField<uint64_t>(pData, 32);
+		if (getField<uint32_t>(pData, 16) != width || getField<uint32_t>(pData, 20) != height) return nullptr;
+		if (getField<uint64_t>(pData, 40) != pMapping->getSize() ||
+		    marginalOffset + uint64_t(height) * sizeof(float) > conditionalOffset ||
+		    conditionalOffset + uint64_t(width) * height * sizeof(float) > pMapping->getSize()) return nullptr;
+
+		SharedPtr pSampler = SharedPtr(new EnvMapSampler());
+		pSampler->mWidth         = width;
+		pSampler->mHeight        = height;
+		pSampler->mHash          = hash;
+		pSampler->mpMarginal     = reinterpret_cast<const float *>(pData + marginalOffset);
+		pSampler->mpConditional  = reinterpret_cast<const float *>(pData + conditionalOffset);
+		pSampler->mpMapping      = pMapping;
+		return pSampler;
+	}
+
+	EnvMapSampler::SharedPtr EnvMapSampler::createCached(const ImageF4 &envMap, const std::string &cacheDir, CpuThreadPool::SharedPtr pThreadPool, bool *pLoaded)
+	{
+		if (pLoaded) *pLoaded = false;
+		if (envMap.getWidth() == 0 || envMap.getHeight() == 0) return nullptr;
+
+		const uint64_t hash = getHash(envMap);
+		const std::string path = getCachePath(hash, cacheDir);
+		SharedPtr pSampler = map(path, envMap.getWidth(), envMap.getHeight(), hash);
+		if (pSampler)
+		{
+			if (pLoaded) *pLoaded = true;
+			return pSampler;
+		}
+
+		pSampler = build(envMap, pThreadPool, hash);
+		if (pSampler) pSampler->save(path);
+		return pSampler;
+	}
+
+	float EnvMapSampler::getTexelProbability(uint32_t x, uint32_t y) const
+	{
+		const float *pRow = mpConditional + size_t(y) * mWidth;
+		const float py = mpMarginal[y] - (y > 0 ? mpMarginal[y - 1] : 0.0f);
+		const float px = pRow[x] - (x > 0 ? pRow[x - 1] : 0.0f);
+		return py * px;
+	}
+
+	float3 EnvMapSampler::sample(const float2 &randVal, float &pdf) const
+	{
+		float fy, fx;
+		const uint32_t y = findInterval(mpMarginal, mHeight, randVal.x, fy);
+		const uint32_t x = findInterval(mpConditional + size_t(y) * mWidth, mWidth, randVal.y, fx);
+		const float2 uv = float2((float(x) + fx) / float(mWidth), (float(y) + fy) / float(mHeight));
+
+		// Uniform within the texel in (u, v), which spans 2 pi^2 sin(theta) / (width * height) steradians per unit area
+		const float sinTheta = std::sin(uv.y * kPi);
+		pdf = sinTheta > 0.0f ? getTexelProbability(x, y) * float(mWidth) * float(mHeight) / (2.0f * kPi * kPi * sinTheta) : 0.0f;
+		return latLongToWsVector(uv);
+	}
+
+	float EnvMapSampler::evalPdf(const float3 &dir) const
+	{
+		const float2 uv = wsVectorToLatLong(dir);
+		const uint32_t x = std::min(uint32_t(uv.x * float(mWidth)), mWidth - 1);
+		const uint32_t y = std::min(uint32_t(uv.y * float(mHeight)), mHeight - 1);
+		const float sinTheta = std::sin(uv.y * kPi);
+		return sinTheta > 0.0f ? getTexelProbability(x, y) * float(mWidth) * float(mHeight) / (2.0f * kPi * kPi * sinTheta) : 0.0f;
+	}
+}
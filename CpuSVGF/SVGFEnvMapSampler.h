@@ -0,0 +1,115 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Importance sampling of a lat-long environment map (the wsVectorToLatLong() mapping) for the GI pass' indirect rays,
+//     shared with the CPU tracer; the HLSL side is Data/SVGFSampleOtherPasses/envMapSampling.hlsli
+
+#pragma once
+#include "CpuThreadPool.h"
+#include "SVGFMappedFile.h"
+#include "SVGFScene.h"
+
+namespace CpuSVGF
+{
+	/** Probability with which an indirect ray samples the environment map instead of the BRDF, when it is sampled
+	*/
+	static const float kEnvMapSampleProbability = 0.5f;
+
+	/** Picks texels of a lat-long map in proportion to their luminance times their solid angle, from a marginal CDF
+	    over rows and a conditional CDF within each row, then a uniform point in the texel.  The lookups of
+	    Scene::evalEnvironment() and IndirectMiss are nearest texel, so this matches the map exactly.
+
+	    Both CDFs are inclusive (entry i sums weights 0 .. i, the last is 1).  GGXGlobalIlluminationPass uploads the
+	    marginal CDF as a height x 1 and the conditional CDFs as a width x height R32Float texture.
+	*/
+	class EnvMapSampler
+	{
+	public:
+		using SharedPtr = std::shared_ptr<EnvMapSampler>;
+
+		/** Returns nullptr if the map is empty or black everywhere, when there is nothing to sample.  Rows are built
+		    in parallel on pThreadPool, if given.
+		*/
+		static SharedPtr create(const ImageF4 &envMap, CpuThreadPool::SharedPtr pThreadPool = nullptr);
+
+		/** Map the tables saved by save() for this map, or nullptr if path is missing or was saved for another map
+		*/
+		static SharedPtr load(const ImageF4 &envMap, const std::string &path);
+
+		/** Load the map's tables from cacheDir if they are there, else build and save them there; failing to save only
+		    loses the cache.  pLoaded (if given) tells which happened.
+		*/
+		static SharedPtr createCached(const ImageF4 &envMap, const std::string &cacheDir, CpuThreadPool::SharedPtr pThreadPool = nullptr,
+		                              bool *pLoaded = nullptr);
+
+		/** <cacheDir>/<getHash()>.svgfenv
+		*/
+		static std::string getCachePath(const ImageF4 &envMap, const std::string &cacheDir);
+
+		/** 64-bit FNV-1a hash of the size and rgb texels of the map
+		*/
+		static uint64_t getHash(const ImageF4 &envMap);
+
+		/** Write the tables in the layout load() maps.  Returns false on a write error.
+		*/
+		bool save(const std::string &path) const;
+
+		/** A direction for randVal in [0, 1)^2, and its probability density per unit solid angle
+		*/
+		float3 sample(const float2 &randVal, float &pdf) const;
+
+		/** Probability density per unit solid angle with which sample() returns dir
+		*/
+		float evalPdf(const float3 &dir) const;
+
+		uint32_t getWidth() const  { return mWidth; }
+		uint32_t getHeight() const { return mHeight; }
+		const float *getMarginalCdf() const    { return mpMarginal; }
+		const float *getConditionalCdf() const { return mpConditional; }
+
+		/** getHash() of the map the tables were built for
+		*/
+		uint64_t getMapHash() const { return mHash; }
+
+		/** True if the tables live in a mapping of a cache file
+		*/
+		bool isMapped() const { return mpMapping != nullptr; }
+
+	private:
+		EnvMapSampler() = default;
+
+		static SharedPtr build(const ImageF4 &envMap, CpuThreadPool::SharedPtr pThreadPool, uint64_t hash);
+		static SharedPtr map(const std::string &path, uint32_t width, uint32_t height, uint64_t hash);
+		static std::string getCachePath(uint64_t hash, const std::string &cacheDir);
+
+		float getTexelProbability(uint32_t x, uint32_t y) const;
+
+		uint32_t              mWidth = 0;
+		uint32_t              mHeight = 0;
+		uint64_t              mHash = 0;
+		const float          *mpMarginal = nullptr;      ///< mHeight entries
+		const float          *mpConditional = nullptr;   ///< mWidth entries per row
+		std::vector<float>    mMarginal;
+		std::vector<float>    mConditional;
+		MappedFile::SharedPtr mpMapping;
+	};
+
+	/** Inverse of wsVectorToLatLong()
+	*/
+	float3 latLongToWsVector(const float2 &uv);
+}
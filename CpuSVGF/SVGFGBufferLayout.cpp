@@ -0,0 +1,96 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFGBufferLayout.h"
+
+namespace CpuSVGF
+{
+	const char *getGBufferLayoutName(GBufferLayout layout)
+	{
+		switch (layout)
+		{
+		case GBufferLayout::Full:    return "full";
+		case GBufferLayout::Compact: return "compact";
+		default:                     return "unknown";
+		}
+	}
+
+	std::vector<GBufferTarget> getGBufferTargets(GBufferLayout layout)
+	{
+		// Formats as requested in GBufferForSVGF::initialize(); the resource manager's default is RGBA32F
+		std::vector<GBufferTarget> targets;
+		if (layout == GBufferLayout::Full)
+		{
+			targets.push_back({ "WorldPosition",     "RGBA32F", 16 });
+			targets.push_back({ "WorldNormal",       "RGBA16F",  8 });
+			targets.push_back({ "MaterialDiffuse",   "RGBA16F",  8 });
+			targets.push_back({ "MaterialSpecRough", "RGBA16F",  8 });
+		}
+		targets.push_back({ "SVGF_LinearZ",          "RGBA32F", 16 });
+		targets.push_back({ "SVGF_MotionVecs",       "RGBA16F",  8 });
+		targets.push_back({ "SVGF_CompactNormDepth", "RGBA32F", 16 });
+		if (layout == GBufferLayout::Compact)
+			targets.push_back({ "SVGF_PackedMaterial", "RG32U",  8 });
+		targets.push_back({ "Z-Buffer",              "D24S8",    4 });
+		return targets;
+	}
+
+	uint32_t getGBufferBytesPerPixel(GBufferLayout layout)
+	{
+		uint32_t bytes = 0;
+		for (const GBufferTarget &target : getGBufferTargets(layout)) bytes += target.bytesPerPixel;
+		return bytes;
+	}
+
+	float3 getPrimaryRayDir(const GBufferCamera &camera, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+	{
+		const float u = (float(x) + 0.5f) / float(width) - camera.jitterX;
+		const float v = (float(y) + 0.5f) / float(height) + camera.jitterY;
+		const float2 ndc(2.0f * u - 1.0f, -2.0f * v + 1.0f);
+		return normalize(camera.cameraU * ndc.x + camera.cameraV * ndc.y + camera.cameraW);
+	}
+
+	CompactGBufferPixel encodeCompactGBuffer(const GBufferSample &sample, const GBufferCamera &camera)
+	{
+		CompactGBufferPixel pixel;
+		if (!sample.valid) return pixel;   // What clearGBuffer.ps.hlsl leaves behind
+		pixel.octNormal = dirToOct(sample.normal);
+		pixel.hitDist   = distance(sample.posW, camera.posW);
+		pixel.diffuse   = packMaterialColor(sample.diffuse, sample.opacity);
+		pixel.specRough = packMaterialColor(sample.specular, sample.linearRoughness);
+		return pixel;
+	}
+
+	GBufferSample decodeCompactGBuffer(const CompactGBufferPixel &pixel, const GBufferCamera &camera, uint32_t x, uint32_t y,
+	                                   uint32_t width, uint32_t height)
+	{
+		GBufferSample sample;
+		sample.valid = pixel.hitDist > 0.0f;
+		sample.posW  = camera.posW + getPrimaryRayDir(camera, x, y, width, height) * pixel.hitDist;
+		if (!sample.valid) return sample;
+
+		const float4 diffuse  = unpackMaterialColor(pixel.diffuse);
+		const float4 specular = unpackMaterialColor(pixel.specRough);
+		sample.normal          = octToDir(pixel.octNormal);
+		sample.diffuse         = diffuse.rgb();
+		sample.opacity         = diffuse.w;
+		sample.specular        = specular.rgb();
+		sample.linearRoughness = specular.w;
+		return sample;
+	}
+}
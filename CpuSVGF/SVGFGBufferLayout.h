@@ -0,0 +1,119 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// The render targets GBufferForSVGF writes in each layout, and a C++ port of the packing in
+//     Data/SVGFSampleOtherPasses/compactGBuffer.hlsli so the compact layout's precision can be checked on the CPU.
+
+#pragma once
+#include "SVGFMath.h"
+#include <vector>
+
+namespace CpuSVGF
+{
+	/** Which targets GBufferForSVGF writes.  GGXGlobalIlluminationPass has to be created with the same layout;
+	    SVGFPass only reads the SVGF_* targets, which both layouts write.
+	*/
+	enum class GBufferLayout : uint32_t
+	{
+		Full,       ///< WorldPosition, WorldNormal, MaterialDiffuse, MaterialSpecRough and the SVGF_* targets (the original layout)
+		Compact,    ///< Only the SVGF_* targets and one packed material target; position is rebuilt from the camera distance
+		Count
+	};
+
+	const char *getGBufferLayoutName(GBufferLayout layout);
+
+	/** One target of a layout
+	*/
+	struct GBufferTarget
+	{
+		const char *name;
+		const char *format;
+		uint32_t    bytesPerPixel;
+	};
+
+	/** The color targets of a layout in SV_Target order, followed by the depth buffer
+	*/
+	std::vector<GBufferTarget> getGBufferTargets(GBufferLayout layout);
+
+	/** Sum of getGBufferTargets(), depth buffer included
+	*/
+	uint32_t getGBufferBytesPerPixel(GBufferLayout layout);
+
+	/** Port of packMaterialColor() from compactGBuffer.hlsli:  RGBA8 with a square root curve on the color
+	*/
+	inline uint32_t packMaterialColor(const float3 &color, float alpha)
+	{
+		auto q = [](float v) { return uint32_t(std::round(saturate(v) * 255.0f)); };
+		return q(std::sqrt(saturate(color.x))) | (q(std::sqrt(saturate(color.y))) << 8) | (q(std::sqrt(saturate(color.z))) << 16) | (q(alpha) << 24);
+	}
+
+	/** Port of unpackMaterialColor() from compactGBuffer.hlsli
+	*/
+	inline float4 unpackMaterialColor(uint32_t packed)
+	{
+		const float r = (packed & 0xFF) / 255.0f, g = ((packed >> 8) & 0xFF) / 255.0f, b = ((packed >> 16) & 0xFF) / 255.0f;
+		return float4(r * r, g * g, b * b, (packed >> 24) / 255.0f);
+	}
+
+	/** The camera parameters compactGBuffer.hlsli reads from gCamera
+	*/
+	struct GBufferCamera
+	{
+		float3 posW;
+		float3 cameraU, cameraV, cameraW;   ///< Scaled so ndc.x * U + ndc.y * V + W spans the view frustum
+		float  jitterX = 0.0f, jitterY = 0.0f;
+	};
+
+	/** Port of getPrimaryRayDir() from compactGBuffer.hlsli
+	*/
+	float3 getPrimaryRayDir(const GBufferCamera &camera, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+	/** One pixel of what the ray tracing pass reads from the G-buffer
+	*/
+	struct GBufferSample
+	{
+		float3 posW;
+		bool   valid = false;        ///< False for background pixels
+		float3 normal;
+		float3 diffuse;
+		float  opacity = 1.0f;
+		float3 specular;
+		float  linearRoughness = 0.0f;
+	};
+
+	/** The compact layout's share of a pixel beyond what the full layout also stores:  SVGF_CompactNormDepth .x and .w,
+	    and both words of the packed material target
+	*/
+	struct CompactGBufferPixel
+	{
+		uint32_t octNormal = 0;
+		float    hitDist = 0.0f;
+		uint32_t diffuse = 0;
+		uint32_t specRough = 0;
+	};
+
+	/** What gBufferSVGF.ps.hlsl writes for a sample in the compact layout
+	*/
+	CompactGBufferPixel encodeCompactGBuffer(const GBufferSample &sample, const GBufferCamera &camera);
+
+	/** What ggxGlobalIllumination.rt.hlsl reads back from the compact layout at pixel (x, y).  The background color
+	    of invalid pixels comes from the environment map there and is left black here.
+	*/
+	GBufferSample decodeCompactGBuffer(const CompactGBufferPixel &pixel, const GBufferCamera &camera, uint32_t x, uint32_t y,
+	                                   uint32_t width, uint32_t height);
+}
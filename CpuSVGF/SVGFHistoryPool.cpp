@@ -0,0 +1,95 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFHistoryPool.h"
+#include <algorithm>
+#include <iterator>
+
+namespace CpuSVGF
+{
+	void *HistoryPool::allocate(size_t bytes)
+	{
+		const size_t size = (std::max<size_t>(bytes, 1) + kAlignment - 1) & ~(kAlignment - 1);
+
+		// First fit, in the order the blocks were added
+		for (uint32_t b = 0; b < mBlocks.size(); b++)
+		{
+			Block &block = mBlocks[b];
+			for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it)
+			{
+				if (it->second < size) continue;
+
+				const size_t offset = it->first, rest = it->second - size;
+				block.freeRanges.erase(it);
+				if (rest) block.freeRanges[offset + size] = rest;
+
+				void *p = block.pBase + offset;
+				mAllocations[p] = { b, offset, size };
+				mUsedBytes += size;
+				return p;
+			}
+		}
+
+		// Nothing fits; add a block
+		Block block;
+		block.size    = std::max(size, mBlockBytes);
+		block.storage.reset(new uint8_t[block.size + kAlignment]);
+		block.pBase   = reinterpret_cast<uint8_t *>((reinterpret_cast<uintptr_t>(block.storage.get()) + kAlignment - 1) & ~uintptr_t(kAlignment - 1));
+		if (block.size > size) block.freeRanges[size] = block.size - size;
+		mReservedBytes += block.size;
+		mBlocks.push_back(std::move(block));
+
+		void *p = mBlocks.back().pBase;
+		mAllocations[p] = { uint32_t(mBlocks.size() - 1), 0, size };
+		mUsedBytes += size;
+		return p;
+	}
+
+	bool HistoryPool::release(void *p)
+	{
+		auto found = mAllocations.find(p);
+		if (found == mAllocations.end()) return false;
+
+		const Allocation allocation = found->second;
+		mAllocations.erase(found);
+		mUsedBytes -= allocation.size;
+
+		// Merge with the free ranges on either side
+		std::map<size_t, size_t> &ranges = mBlocks[allocation.block].freeRanges;
+		size_t offset = allocation.offset, size = allocation.size;
+
+		auto next = ranges.lower_bound(offset);
+		if (next != ranges.end() && next->first == offset + size)
+		{
+			size += next->second;
+			next = ranges.erase(next);
+		}
+		if (next != ranges.begin())
+		{
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset)
+			{
+				offset = prev->first;
+				size  += prev->second;
+				ranges.erase(prev);
+			}
+		}
+		ranges[offset] = size;
+		return true;
+	}
+}
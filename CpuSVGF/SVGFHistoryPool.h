@@ -0,0 +1,77 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace CpuSVGF
+{
+	/** Hands out 64-byte aligned ranges of a few large blocks.  A new block is only added when no existing one has a
+	    free range big enough, and blocks never move or shrink, so releasing or adding a range never touches the
+	    memory of the others.  Released ranges are merged with their free neighbors and reused first-fit.
+	*/
+	class HistoryPool
+	{
+	public:
+		static const size_t kDefaultBlockBytes = size_t(64) << 20;
+		static const size_t kAlignment         = 64;
+
+		/** Blocks are blockBytes long, or as long as the request that needs a new one if that is bigger
+		*/
+		explicit HistoryPool(size_t blockBytes = kDefaultBlockBytes) : mBlockBytes(blockBytes) {}
+
+		HistoryPool(const HistoryPool &) = delete;
+		HistoryPool &operator=(const HistoryPool &) = delete;
+
+		/** A range of at least bytes bytes, valid until released.  Its contents are undefined.
+		*/
+		void *allocate(size_t bytes);
+
+		/** Return a range from allocate().  Returns false if p isn't one.
+		*/
+		bool release(void *p);
+
+		size_t   getReservedBytes() const { return mReservedBytes; }   ///< Total size of the blocks
+		size_t   getUsedBytes() const     { return mUsedBytes; }       ///< Total size of the ranges handed out
+		uint32_t getBlockCount() const    { return uint32_t(mBlocks.size()); }
+
+	private:
+		struct Block
+		{
+			std::unique_ptr<uint8_t[]> storage;
+			uint8_t                   *pBase = nullptr;   ///< storage, aligned
+			size_t                     size  = 0;
+			std::map<size_t, size_t>   freeRanges;        ///< Offset -> size, sorted so neighbors can be merged
+		};
+
+		struct Allocation
+		{
+			uint32_t block;
+			size_t   offset, size;
+		};
+
+		size_t                      mBlockBytes;
+		std::vector<Block>          mBlocks;
+		std::map<void *, Allocation> mAllocations;
+		size_t                      mReservedBytes = 0;
+		size_t                      mUsedBytes     = 0;
+	};
+}
@@ -0,0 +1,118 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include "SVGFMath.h"
+#include <vector>
+
+namespace CpuSVGF
+{
+	/** A plain, row-major 2D image.  This is the CPU stand-in for the Texture2D / render targets the
+	    SVGF shaders read and write.  It normally owns its texels, but can also wrap memory owned elsewhere (e.g. a
+	    memory-mapped capture file) without copying; copies of a wrapping image always own their data.
+	*/
+	template <typename T>
+	class Image
+	{
+	public:
+		Image() = default;
+		Image(uint32_t width, uint32_t height, const T &value = T()) { resize(width, height, value); }
+
+		Image(const Image &other) { *this = other; }
+		Image(Image &&other) noexcept { *this = std::move(other); }
+
+		Image &operator=(const Image &other)
+		{
+			if (this == &other) return *this;
+			mWidth  = other.mWidth;
+			mHeight = other.mHeight;
+			mData.assign(other.mpData, other.mpData + other.getPixelCount());
+			mpData  = mData.data();
+			return *this;
+		}
+
+		Image &operator=(Image &&other) noexcept
+		{
+			if (this == &other) return *this;
+			const bool wrapped = other.isWrapping();
+			mWidth  = other.mWidth;
+			mHeight = other.mHeight;
+			mData   = std::move(other.mData);
+			mpData  = wrapped ? other.mpData : mData.data();
+			other.mWidth = other.mHeight = 0;
+			other.mData.clear();
+			other.mpData = nullptr;
+			return *this;
+		}
+
+		void resize(uint32_t width, uint32_t height, const T &value = T())
+		{
+			mWidth  = width;
+			mHeight = height;
+			mData.assign(size_t(width) * size_t(height), value);
+			mpData  = mData.data();
+		}
+
+		/** Use width * height texels at pData, which must outlive this image (or the next resize() / wrap()),
+		    instead of owning storage
+		*/
+		void wrap(uint32_t width, uint32_t height, T *pData)
+		{
+			mWidth  = width;
+			mHeight = height;
+			mData.clear();
+			mData.shrink_to_fit();
+			mpData  = pData;
+		}
+
+		bool isWrapping() const { return mpData != nullptr && mpData != mData.data(); }
+
+		void fill(const T &value) { std::fill(mpData, mpData + getPixelCount(), value); }
+
+		uint32_t getWidth() const  { return mWidth; }
+		uint32_t getHeight() const { return mHeight; }
+		size_t   getPixelCount() const { return size_t(mWidth) * size_t(mHeight); }
+		bool     empty() const     { return getPixelCount() == 0; }
+		size_t   getByteSize() const { return getPixelCount() * sizeof(T); }
+
+		T       *getData()       { return mpData; }
+		const T *getData() const { return mpData; }
+
+		T       &at(int x, int y)       { return mpData[size_t(y) * mWidth + size_t(x)]; }
+		const T &at(int x, int y) const { return mpData[size_t(y) * mWidth + size_t(x)]; }
+
+		bool inside(int x, int y) const { return x >= 0 && y >= 0 && x < int(mWidth) && y < int(mHeight); }
+
+		/** Mirrors Texture2D.Load() / operator[] semantics:  out of bounds reads return zero
+		*/
+		T load(int x, int y) const { return inside(x, y) ? at(x, y) : T(); }
+
+	private:
+		uint32_t       mWidth  = 0;
+		uint32_t       mHeight = 0;
+		std::vector<T> mData;
+		T             *mpData  = nullptr;   ///< mData.data(), or wrapped memory
+	};
+
+	using ImageF  = Image<float>;
+	using ImageF4 = Image<float4>;
+
+	/** 8-bit RGBA texels packed red in the low byte, the memory layout of DXGI_FORMAT_R8G8B8A8_UNORM
+	*/
+	using ImageRGBA8 = Image<uint32_t>;
+}
@@ -0,0 +1,965 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFImageDecode.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace CpuSVGF
+{
+	namespace {
+		uint32_t packRGBA8(uint32_t r, uint32_t g, uint32_t b, uint32_t a) { return r | (g << 8) | (b << 16) | (a << 24); }
+
+		uint32_t readBigEndian32(const uint8_t *p) { return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]); }
+		uint32_t readBigEndian16(const uint8_t *p) { return (uint32_t(p[0]) << 8) | uint32_t(p[1]); }
+
+		// ---- Inflate (RFC 1950 / 1951) ----
+
+		const uint32_t kMaxCodeLength = 15;
+		const uint32_t kFastBits      = 10;
+
+		/** Canonical Huffman code of a deflate block.  Codes up to kFastBits long resolve with one lookup of the next
+		    bits (deflate packs codes most significant bit first into a least significant bit first stream, hence the
+		    reversal); longer ones fall back to walking the code lengths.
+		*/
+		struct InflateHuffman
+		{
+			uint16_t fast[1 << kFastBits];        ///< symbol << 4 | length, or 0 if the code is longer
+			uint16_t counts[kMaxCodeLength + 1];
+			uint16_t symbols[288];
+
+			bool build(const uint8_t *pLengths, uint32_t count)
+			{
+				std::memset(fast, 0, sizeof(fast));
+				std::memset(counts, 0, sizeof(counts));
+				for (uint32_t i = 0; i < count; i++) counts[pLengths[i]]++;
+				counts[0] = 0;
+
+				// Over-subscribed sets are malformed; incomplete ones are allowed (e.g. a single distance code)
+				int left = 1;
+				for (uint32_t len = 1; len <= kMaxCodeLength; len++)
+				{
+					left = (left << 1) - counts[len];
+					if (left < 0) return false;
+				}
+
+				uint16_t offsets[kMaxCodeLength + 2] = {};
+				for (uint32_t len = 1; len <= kMaxCodeLength; len++) offsets[len + 1] = offsets[len] + counts[len];
+
+				uint32_t nextCode[kMaxCodeLength + 1] = {};
+				uint32_t code = 0;
+				for (uint32_t len = 1; len <= kMaxCodeLength; len++)
+				{
+					code = (code + counts[len - 1]) << 1;
+					nextCode[len] = code;
+				}
+				for (uint32_t symbol = 0; symbol < count; symbol++)
+				{
+					const uint32_t len = pLengths[symbol];
+					if (len == 0) continue;
+					symbols[offsets[len]++] = uint16_t(symbol);
+					const uint32_t c = nextCode[len]++;
+					if (len > kFastBits) continue;
+					uint32_t reversed = 0;
+					for (uint32_t i = 0; i < len; i++) reversed |= ((c >> i) & 1u) << (len - 1 - i);
+					for (uint32_t fill = reversed; fill < (1u << kFastBits); fill += 1u << len)
+						fast[fill] = uint16_t((symbol << 4) | len);
+				}
+				return true;
+			}
+		};
+
+		class InflateStream
+		{
+		public:
+			InflateStream(const uint8_t *pData, size_t size) : mpData(pData), mpEnd(pData + size) {}
+
+			/** Inflate a zlib stream into out, which must come to exactly expectedSize bytes
+			*/
+			bool inflate(std::vector<uint8_t> &out, size_t expectedSize);
+
+		private:
+			void refill()
+			{
+				while (mBitCount <= 56)
+				{
+					uint64_t byte = 0;
+					if (mpData < mpEnd) byte = *mpData++;
+					else mPaddingBits += 8;
+					mBits |= byte << mBitCount;
+					mBitCount += 8;
+				}
+			}
+
+			uint32_t getBits(uint32_t count)
+			{
+				if (count == 0) return 0;
+				if (mBitCount < count) refill();
+				const uint32_t value = uint32_t(mBits & ((1ull << count) - 1));
+				mBits >>= count;
+				mBitCount -= count;
+				return value;
+			}
+
+			/** The next symbol of h, or -1 for a code h doesn't contain
+			*/
+			int decode(const InflateHuffman &h)
+			{
+				if (mBitCount < kMaxCodeLength) refill();
+				const uint16_t entry = h.fast[mBits & ((1u << kFastBits) - 1)];
+				if (entry)
+				{
+					mBits >>= entry & 15;
+					mBitCount -= entry & 15;
+					return entry >> 4;
+				}
+				int code = 0, first = 0, index = 0;
+				for (uint32_t len = 1; len <= kMaxCodeLength; len++)
+				{
+					code |= int(mBits & 1);
+					mBits >>= 1;
+					mBitCount--;
+					const int count = h.counts[len];
+					if (code - count < first) return h.symbols[index + (code - first)];
+					index += count;
+					first = (first + count) << 1;
+					code <<= 1;
+				}
+				return -1;
+			}
+
+			/** True if decoding read past the end of the data
+			*/
+			bool overran() const { return mPaddingBits > mBitCount; }
+
+			bool inflateBlock(const InflateHuffman &lengths, const InflateHuffman &distances, uint8_t *pOut, size_t &written, size_t expectedSize);
+			bool readDynamicCodes(InflateHuffman &lengths, InflateHuffman &distances);
+
+			const uint8_t *mpData;
+			const uint8_t *mpEnd;
+			uint64_t       mBits = 0;
+			uint32_t       mBitCount = 0;
+			uint32_t       mPaddingBits = 0;   ///< Zero bits refill() made up past the end
+		};
+
+		const uint16_t kLengthBase[29]  = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		const uint8_t  kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		const uint16_t kDistBase[30]    = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+		                                    4097, 6145, 8193, 12289, 16385, 24577 };
+		const uint8_t  kDistExtra[30]   = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		bool InflateStream::inflateBlock(const InflateHuffman &lengths, const InflateHuffman &distances, uint8_t *pOut, size_t &written, size_t expectedSize)
+		{
+			for (;;)
+			{
+				const int symbol = decode(lengths);
+				if (symbol < 0) return false;
+				if (symbol < 256)
+				{
+					if (written >= expectedSize) return false;
+					pOut[written++] = uint8_t(symbol);
+					continue;
+				}
+				if (symbol == 256) return !overran();
+				if (symbol > 285) return false;
+
+				const uint32_t length = kLengthBase[symbol - 257] + getBits(kLengthExtra[symbol - 257]);
+				const int distSymbol = decode(distances);
+				if (distSymbol < 0 || distSymbol > 29) return false;
+				const size_t distance = kDistBase[distSymbol] + getBits(kDistExtra[distSymbol]);
+				if (distance > written || written + length > expectedSize || overran()) return false;
+
+				// Byte by byte, since the source may overlap what is being written
+				const uint8_t *pFrom = pOut + written - distance;
+				uint8_t *pTo = pOut + written;
+				for (uint32_t i = 0; i < length; i++) pTo[i] = pFrom[i];
+				written += length;
+			}
+		}
+
+		bool InflateStream::readDynamicCodes(InflateHuffman &lengths, InflateHuffman &distances)
+		{
+			static const uint8_t kOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+			const uint32_t lengthCount   = getBits(5) + 257;
+			const uint32_t distanceCount = getBits(5) + 1;
+			const uint32_t codeCount     = getBits(4) + 4;
+			if (lengthCount > 286 || distanceCount > 30) return false;
+
+			uint8_t codeLengths[19] = {};
+			for (uint32_t i = 0; i < codeCount; i++) codeLengths[kOrder[i]] = uint8_t(getBits(3));
+			InflateHuffman codes;
+			if (!codes.build(codeLengths, 19)) return false;
+
+			uint8_t all[286 + 30] = {};
+			for (uint32_t i = 0; i < lengthCount + distanceCount;)
+			{
+				const int symbol = decode(codes);
+				if (symbol < 0) return false;
+				if (symbol < 16) { all[i++] = uint8_t(symbol); continue; }
+
+				uint8_t value = 0;
+				uint32_t repeat;
+				if (symbol == 16)
+				{
+					if (i == 0) return false;
+					value = all[i - 1];
+					repeat = 3 + getBits(2);
+				}
+				else if (symbol == 17) repeat = 3 + getBits(3);
+				else repeat = 11 + getBits(7);
+				if (i + repeat > lengthCount + distanceCount) return false;
+				while (repeat--) all[i++] = value;
+			}
+			if (all[256] == 0) return false;   // No end of block code
+			return !overran() && lengths.build(all, lengthCount) && distances.build(all + lengthCount, distanceCount);
+		}
+
+		bool InflateStream::inflate(std::vector<uint8_t> &out, size_t expectedSize)
+		{
+			// zlib header:  deflate, no preset dictionary, and a valid check value
+			if (mpEnd - mpData < 2) return false;
+			const uint32_t cmf = mpData[0], flags = mpData[1];
+			if ((cmf & 15) != 8 || (flags & 32) != 0 || ((cmf << 8) | flags) % 31 != 0) return false;
+			mpData += 2;
+
+			out.resize(expectedSize);
+			size_t written = 0;
+			InflateHuffman lengths, distances;
+			bool last = false;
+			while (!last)
+			{
+				last = getBits(1) != 0;
+				const uint32_t type = getBits(2);
+				if (type == 0)
+				{
+					getBits(mBitCount & 7);
+					const uint32_t length = getBits(16);
+					if ((getBits(16) ^ 0xFFFFu) != length || written + length > expectedSize) return false;
+					for (uint32_t i = 0; i < length; i++) out[written++] = uint8_t(getBits(8));
+					if (overran()) return false;
+				}
+				else if (type == 1)
+				{
+					uint8_t fixed[288 + 30];
+					std::fill(fixed, fixed + 144, uint8_t(8));
+					std::fill(fixed + 144, fixed + 256, uint8_t(9));
+					std::fill(fixed + 256, fixed + 280, uint8_t(7));
+					std::fill(fixed + 280, fixed + 288, uint8_t(8));
+					std::fill(fixed + 288, fixed + 318, uint8_t(5));
+					if (!lengths.build(fixed, 288) || !distances.build(fixed + 288, 30)) return false;
+					if (!inflateBlock(lengths, distances, out.data(), written, expectedSize)) return false;
+				}
+				else if (type == 2)
+				{
+					if (!readDynamicCodes(lengths, distances)) return false;
+					if (!inflateBlock(lengths, distances, out.data(), written, expectedSize)) return false;
+				}
+				else return false;
+			}
+			return written == expectedSize;
+		}
+
+		// ---- PNG ----
+
+		const uint8_t kPngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+		uint8_t paeth(int a, int b, int c)
+		{
+			const int p = a + b - c;
+			const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+			if (pa <= pb && pa <= pc) return uint8_t(a);
+			return uint8_t(pb <= pc ? b : c);
+		}
+
+		/** Undo the filter of one row in place; prev is the previous unfiltered row (zeros for the first)
+		*/
+		bool unfilterRow(uint32_t filter, uint8_t *pRow, const uint8_t *pPrev, size_t rowBytes, size_t bpp)
+		{
+			switch (filter)
+			{
+			case 0: break;
+			case 1: for (size_t i = bpp; i < rowBytes; i++) pRow[i] = uint8_t(pRow[i] + pRow[i - bpp]); break;
+			case 2: for (size_t i = 0; i < rowBytes; i++) pRow[i] = uint8_t(pRow[i] + pPrev[i]); break;
+			case 3:
+				for (size_t i = 0; i < bpp; i++) pRow[i] = uint8_t(pRow[i] + (pPrev[i] >> 1));
+				for (size_t i = bpp; i < rowBytes; i++) pRow[i] = uint8_t(pRow[i] + ((uint32_t(pRow[i - bpp]) + pPrev[i]) >> 1));
+				break;
+			case 4:
+				for (size_t i = 0; i < bpp; i++) pRow[i] = uint8_t(pRow[i] + pPrev[i]);
+				for (size_t i = bpp; i < rowBytes; i++) pRow[i] = uint8_t(pRow[i] + paeth(pRow[i - bpp], pPrev[i], pPrev[i - bpp]));
+				break;
+			default: return false;
+			}
+			return true;
+		}
+
+		// ---- JPEG ----
+
+		const uint8_t kZigZag[64] = {
+			 0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+			12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+			35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+			58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+
+		const uint32_t kJpegFastBits = 9;
+
+		/** A JPEG Huffman table.  Codes are read most significant bit first; those up to kJpegFastBits long resolve
+		    with one lookup.
+		*/
+		struct JpegHuffman
+		{
+			uint16_t fast[1 << kJpegFastBits];   ///< length << 8 | symbol, or 0 if the code is longer
+			int32_t  maxCode[18];                 ///< Largest code of each length, -1 if none
+			int32_t  valueOffset[17];             ///< Index in values of a length's first code, minus that code
+			uint8_t  values[256];
+			bool     defined = false;
+
+			bool build(const uint8_t counts[16], const uint8_t *pValues, uint32_t valueCount)
+			{
+				std::memcpy(values, pValues, valueCount);
+				std::memset(fast, 0, sizeof(fast));
+				int32_t code = 0;
+				uint32_t index = 0;
+				for (uint32_t len = 1; len <= 16; len++)
+				{
+					valueOffset[len] = int32_t(index) - code;
+					for (uint32_t i = 0; i < counts[len - 1]; i++, index++, code++)
+					{
+						if (len > kJpegFastBits) continue;
+						const uint32_t shift = kJpegFastBits - len;
+						for (uint32_t fill = 0; fill < (1u << shift); fill++)
+							fast[(uint32_t(code) << shift) | fill] = uint16_t((len << 8) | values[index]);
+					}
+					maxCode[len] = counts[len - 1] ? code - 1 : -1;
+					if (code > (1 << len)) return false;
+					code <<= 1;
+				}
+				maxCode[17] = 0x7FFFFFFF;
+				defined = true;
+				return true;
+			}
+		};
+
+		/** Reads the entropy coded data of a scan, removing the 0x00 stuffed after 0xFF bytes.  At a marker it stops
+		    and feeds zero bits, leaving the data pointer on the marker.
+		*/
+		class JpegBitReader
+		{
+		public:
+			JpegBitReader(const uint8_t *pData, const uint8_t *pEnd) : mpData(pData), mpEnd(pEnd) {}
+
+			const uint8_t *getPosition() const { return mpData; }
+
+			/** Drop buffered bits and skip to just past the next restart marker
+			*/
+			void restart()
+			{
+				mBits = 0;
+				mBitCount = 0;
+				mAtMarker = false;
+				while (mpData + 1 < mpEnd && !(mpData[0] == 0xFF && mpData[1] >= 0xD0 && mpData[1] <= 0xD7)) mpData++;
+				mpData = std::min(mpData + 2, mpEnd);
+			}
+
+			uint32_t getBits(uint32_t count)
+			{
+				if (count == 0) return 0;
+				if (mBitCount < count) refill();
+				const uint32_t value = mBits >> (32 - count);
+				mBits <<= count;
+				mBitCount -= count;
+				return value;
+			}
+
+			/** Read count bits as a signed coefficient (JPEG's EXTEND())
+			*/
+			int32_t getSigned(uint32_t count)
+			{
+				const int32_t value = int32_t(getBits(count));
+				return value < (1 << (count - 1)) ? value - (1 << count) + 1 : value;
+			}
+
+			int decode(const JpegHuffman &h)
+			{
+				if (mBitCount < 16) refill();
+				const uint16_t entry = h.fast[mBits >> (32 - kJpegFastBits)];
+				if (entry)
+				{
+					const uint32_t len = entry >> 8;
+					mBits <<= len;
+					mBitCount -= len;
+					return entry & 0xFF;
+				}
+				uint32_t len = kJpegFastBits + 1;
+				while (len <= 16 && int32_t(mBits >> (32 - len)) > h.maxCode[len]) len++;
+				if (len > 16) return -1;
+				const int32_t code = int32_t(mBits >> (32 - len));
+				mBits <<= len;
+				mBitCount -= len;
+				return h.values[h.valueOffset[len] + code];
+			}
+
+		private:
+			void refill()
+			{
+				while (mBitCount <= 24)
+				{
+					uint32_t byte = 0;
+					if (!mAtMarker && mpData < mpEnd)
+					{
+						byte = *mpData;
+						if (byte == 0xFF)
+						{
+							const uint32_t next = mpData + 1 < mpEnd ? mpData[1] : 0xD9;
+							if (next == 0x00) mpData += 2;
+							else { mAtMarker = true; byte = 0; }
+						}
+						else mpData++;
+					}
+					mBits |= byte << (24 - mBitCount);
+					mBitCount += 8;
+				}
+			}
+
+			const uint8_t *mpData;
+			const uint8_t *mpEnd;
+			uint32_t       mBits = 0;       ///< Next bits, most significant first
+			uint32_t       mBitCount = 0;
+			bool           mAtMarker = false;
+		};
+
+		struct JpegComponent
+		{
+			uint32_t             id = 0;
+			uint32_t             h = 1, v = 1;       ///< Sampling factors
+			uint32_t             quantTable = 0;
+			uint32_t             dcTable = 0, acTable = 0;
+			uint32_t             planeWidth = 0;     ///< Whole blocks, padded to whole MCUs
+			uint32_t             planeHeight = 0;
+			int32_t              dcPred = 0;
+			std::vector<uint8_t> plane;
+		};
+
+		/** idctBasis[x][u] = C(u) / 2 * cos((2x + 1) u pi / 16)
+		*/
+		struct IdctBasis
+		{
+			float b[8][8];
+			IdctBasis()
+			{
+				for (int x = 0; x < 8; x++)
+					for (int u = 0; u < 8; u++)
+						b[x][u] = (u == 0 ? 0.35355339f : 0.5f) * float(std::cos(double((2 * x + 1) * u) * 3.14159265358979 / 16.0));
+			}
+		};
+
+		/** Inverse DCT of dequantized coefficients (natural order) into 8x8 samples at pDst
+		*/
+		void idctBlock(const float coef[64], uint8_t *pDst, size_t stride)
+		{
+			static const IdctBasis basis;
+			float rows[64];
+			for (int v = 0; v < 8; v++)
+			{
+				const float *pIn = coef + v * 8;
+				if (pIn[1] == 0.0f && pIn[2] == 0.0f && pIn[3] == 0.0f && pIn[4] == 0.0f && pIn[5] == 0.0f && pIn[6] == 0.0f && pIn[7] == 0.0f)
+				{
+					// Most rows of a quantized block are flat, if not zero
+					const float flat = basis.b[0][0] * pIn[0];
+					for (int x = 0; x < 8; x++) rows[v * 8 + x] = flat;
+					continue;
+				}
+				for (int x = 0; x < 8; x++)
+				{
+					float sum = 0.0f;
+					for (int u = 0; u < 8; u++) sum += basis.b[x][u] * pIn[u];
+					rows[v * 8 + x] = sum;
+				}
+			}
+			for (int x = 0; x < 8; x++)
+			{
+				for (int y = 0; y < 8; y++)
+				{
+					float sum = 0.0f;
+					for (int v = 0; v < 8; v++) sum += basis.b[y][v] * rows[v * 8 + x];
+					pDst[size_t(y) * stride + x] = uint8_t(std::min(std::max(sum + 128.5f, 0.0f), 255.0f));
+				}
+			}
+		}
+
+		class JpegDecoder
+		{
+		public:
+			bool decode(const uint8_t *pData, size_t size, ImageRGBA8 &image);
+
+		private:
+			bool readFrame(const uint8_t *pSegment, uint32_t length);
+			bool readScan(const uint8_t *pSegment, uint32_t length, const uint8_t *pEnd, const uint8_t *&pNext);
+			bool decodeBlock(JpegBitReader &bits, JpegComponent &c, uint32_t blockX, uint32_t blockY);
+			void writeImage(ImageRGBA8 &image) const;
+
+			uint16_t                   mQuant[4][64] = {};   ///< Zigzag order
+			JpegHuffman                mDc[4], mAc[4];
+			std::vector<JpegComponent> mComponents;
+			uint32_t                   mWidth = 0, mHeight = 0;
+			uint32_t                   mMaxH = 1, mMaxV = 1;
+			uint32_t                   mMcusX = 0, mMcusY = 0;
+			uint32_t                   mRestartInterval = 0;
+			int                        mAdobeTransform = -1;
+		};
+
+		bool JpegDecoder::readFrame(const uint8_t *p, uint32_t length)
+		{
+			if (length < 6 || p[0] != 8) return false;
+			mHeight = readBigEndian16(p + 1);
+			mWidth = readBigEndian16(p + 3);
+			const uint32_t count = p[5];
+			if (mWidth == 0 || mHeight == 0 || (count != 1 && count != 3) || length < 6 + 3 * count) return false;
+
+			mComponents.resize(count);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				JpegComponent &c = mComponents[i];
+				c.id = p[6 + 3 * i];
+				c.h = p[7 + 3 * i] >> 4;
+				c.v = p[7 + 3 * i] & 15;
+				c.quantTable = p[8 + 3 * i];
+				if (c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4 || c.quantTable > 3) return false;
+				mMaxH = std::max(mMaxH, c.h);
+				mMaxV = std::max(mMaxV, c.v);
+			}
+			mMcusX = (mWidth + 8 * mMaxH - 1) / (8 * mMaxH);
+			mMcusY = (mHeight + 8 * mMaxV - 1) / (8 * mMaxV);
+			for (JpegComponent &c : mComponents)
+			{
+				c.planeWidth = mMcusX * c.h * 8;
+				c.planeHeight = mMcusY * c.v * 8;
+				c.plane.assign(size_t(c.planeWidth) * c.planeHeight, uint8_t(128));
+			}
+			return true;
+		}
+
+		bool JpegDecoder::decodeBlock(JpegBitReader &bits, JpegComponent &c, uint32_t blockX, uint32_t blockY)
+		{
+			const JpegHuffman &dc = mDc[c.dcTable], &ac = mAc[c.acTable];
+			const uint16_t *pQuant = mQuant[c.quantTable];
+			float coef[64] = {};
+
+			const int dcBits = bits.decode(dc);
+			if (dcBits < 0 || dcBits > 16) return false;
+			c.dcPred += dcBits ? bits.getSigned(uint32_t(dcBits)) : 0;
+			coef[0] = float(c.dcPred * int32_t(pQuant[0]));
+
+			for (uint32_t k = 1; k < 64;)
+			{
+				const int rs = bits.decode(ac);
+				if (rs < 0) return false;
+				const uint32_t run = uint32_t(rs) >> 4, magnitude = uint32_t(rs) & 15;
+				if (magnitude == 0)
+				{
+					if (run != 15) break;   // End of block
+					k += 16;
+					continue;
+				}
+				k += run;
+				if (k > 63) return false;
+				coef[kZigZag[k]] = float(bits.getSigned(magnitude) * int32_t(pQuant[k]));
+				k++;
+			}
+
+			uint8_t *pDst = &c.plane[size_t(blockY) * 8 * c.planeWidth + size_t(blockX) * 8];
+			idctBlock(coef, pDst, c.planeWidth);
+			return true;
+		}
+
+		bool JpegDecoder::readScan(const uint8_t *p, uint32_t length, const uint8_t *pEnd, const uint8_t *&pNext)
+		{
+			if (mComponents.empty() || length < 1) return false;
+			const uint32_t count = p[0];
+			if (count < 1 || count > mComponents.size() || length < 4 + 2 * count) return false;
+
+			std::vector<JpegComponent *> scan;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const uint32_t id = p[1 + 2 * i];
+				JpegComponent *pComponent = nullptr;
+				for (JpegComponent &c : mComponents) if (c.id == id) pComponent = &c;
+				if (!pComponent) return false;
+				pComponent->dcTable = p[2 + 2 * i] >> 4;
+				pComponent->acTable = p[2 + 2 * i] & 15;
+				if (pComponent->dcTable > 3 || pComponent->acTable > 3) return false;
+				if (!mDc[pComponent->dcTable].defined || !mAc[pComponent->acTable].defined) return false;
+				pComponent->dcPred = 0;
+				scan.push_back(pComponent);
+			}
+
+			JpegBitReader bits(p + length, pEnd);
+			uint32_t mcusLeft = mRestartInterval;
+			auto nextMcu = [&]()
+			{
+				if (mRestartInterval == 0) return;
+				if (mcusLeft == 0)
+				{
+					bits.restart();
+					for (JpegComponent *pComponent : scan) pComponent->dcPred = 0;
+					mcusLeft = mRestartInterval;
+				}
+				mcusLeft--;
+			};
+
+			if (count == 1)
+			{
+				// A non-interleaved scan walks the component's own blocks, covering just the image
+				JpegComponent &c = *scan[0];
+				const uint32_t blocksX = ((mWidth * c.h + mMaxH - 1) / mMaxH + 7) / 8;
+				const uint32_t blocksY = ((mHeight * c.v + mMaxV - 1) / mMaxV + 7) / 8;
+				for (uint32_t by = 0; by < blocksY; by++)
+				{
+					for (uint32_t bx = 0; bx < blocksX; bx++)
+					{
+						nextMcu();
+						if (!decodeBlock(bits, c, bx, by)) return false;
+					}
+				}
+			}
+			else
+			{
+				for (uint32_t my = 0; my < mMcusY; my++)
+				{
+					for (uint32_t mx = 0; mx < mMcusX; mx++)
+					{
+						nextMcu();
+						for (JpegComponent *pComponent : scan)
+							for (uint32_t v = 0; v < pComponent->v; v++)
+								for (uint32_t h = 0; h < pComponent->h; h++)
+									if (!decodeBlock(bits, *pComponent, mx * pComponent->h + h, my * pComponent->v + v)) return false;
+					}
+				}
+			}
+
+			// Continue at the marker that ends the scan
+			pNext = bits.getPosition();
+			while (pNext + 1 < pEnd && !(pNext[0] == 0xFF && pNext[1] != 0x00 && !(pNext[1] >= 0xD0 && pNext[1] <= 0xD7))) pNext++;
+			return true;
+		}
+
+		void JpegDecoder::writeImage(ImageRGBA8 &image) const
+		{
+			image.resize(mWidth, mHeight);
+
+			// Centered bilinear upsampling of each component to the full resolution, row by row:  blend the two
+			// nearest component rows, then interpolate that across, with the horizontal taps worked out up front
+			const uint32_t count = uint32_t(mComponents.size());
+			std::vector<std::vector<float>> rows(count, std::vector<float>(mWidth));
+			std::vector<std::vector<uint32_t>> taps(count);
+			std::vector<std::vector<float>> tapWeights(count);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const JpegComponent &c = mComponents[i];
+				if (c.h == mMaxH) continue;
+				const uint32_t compWidth = (mWidth * c.h + mMaxH - 1) / mMaxH;
+				taps[i].resize(mWidth);
+				tapWeights[i].resize(mWidth);
+				for (uint32_t x = 0; x < mWidth; x++)
+				{
+					const float sx = std::min(std::max((float(x) + 0.5f) * float(c.h) / float(mMaxH) - 0.5f, 0.0f), float(compWidth - 1));
+					taps[i][x] = uint32_t(sx);
+					tapWeights[i][x] = sx - float(uint32_t(sx));
+				}
+			}
+			std::vector<float> blended(mWidth + 1);
+
+			for (uint32_t y = 0; y < mHeight; y++)
+			{
+				for (uint32_t i = 0; i < count; i++)
+				{
+					const JpegComponent &c = mComponents[i];
+					float *pRow = rows[i].data();
+					const uint32_t compWidth = (mWidth * c.h + mMaxH - 1) / mMaxH;
+					const uint32_t compHeight = (mHeight * c.v + mMaxV - 1) / mMaxV;
+					const float sy = std::min(std::max((float(y) + 0.5f) * float(c.v) / float(mMaxV) - 0.5f, 0.0f), float(compHeight - 1));
+					const uint32_t y0 = uint32_t(sy), y1 = std::min(y0 + 1, compHeight - 1);
+					const float fy = sy - float(y0);
+					const uint8_t *pRow0 = &c.plane[size_t(y0) * c.planeWidth];
+					const uint8_t *pRow1 = &c.plane[size_t(y1) * c.planeWidth];
+
+					float *pBlended = c.h == mMaxH ? pRow : blended.data();
+					for (uint32_t x = 0; x < compWidth; x++) pBlended[x] = float(pRow0[x]) + (float(pRow1[x]) - float(pRow0[x])) * fy;
+					if (c.h == mMaxH) continue;
+
+					pBlended[compWidth] = pBlended[compWidth - 1];
+					const uint32_t *pTaps = taps[i].data();
+					const float *pWeights = tapWeights[i].data();
+					for (uint32_t x = 0; x < mWidth; x++)
+					{
+						const float left = pBlended[pTaps[x]];
+						pRow[x] = left + (pBlended[pTaps[x] + 1] - left) * pWeights[x];
+					}
+				}
+
+				auto toByte = [](float value) { return uint32_t(std::min(std::max(value + 0.5f, 0.0f), 255.0f)); };
+				uint32_t *pDst = &image.at(0, y);
+				if (count == 1)
+				{
+					for (uint32_t x = 0; x < mWidth; x++)
+					{
+						const uint32_t g = toByte(rows[0][x]);
+						pDst[x] = packRGBA8(g, g, g, 255);
+					}
+				}
+				else if (mAdobeTransform == 0)
+				{
+					for (uint32_t x = 0; x < mWidth; x++) pDst[x] = packRGBA8(toByte(rows[0][x]), toByte(rows[1][x]), toByte(rows[2][x]), 255);
+				}
+				else
+				{
+					for (uint32_t x = 0; x < mWidth; x++)
+					{
+						const float luma = rows[0][x], cb = rows[1][x] - 128.0f, cr = rows[2][x] - 128.0f;
+						pDst[x] = packRGBA8(toByte(luma + 1.402f * cr), toByte(luma - 0.344136f * cb - 0.714136f * cr), toByte(luma + 1.772f * cb), 255);
+					}
+				}
+			}
+		}
+
+		bool JpegDecoder::decode(const uint8_t *pData, size_t size, ImageRGBA8 &image)
+		{
+			const uint8_t *pEnd = pData + size;
+			if (size < 4 || pData[0] != 0xFF || pData[1] != 0xD8) return false;
+			const uint8_t *p = pData + 2;
+			bool scanned = false;
+
+			while (p + 1 < pEnd)
+			{
+				if (p[0] != 0xFF) { p++; continue; }
+				const uint32_t marker = p[1];
+				p += 2;
+				if (marker == 0xFF || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) { if (marker == 0xFF) p--; continue; }
+				if (marker == 0xD9) break;
+
+				if (p + 2 > pEnd) return false;
+				const uint32_t length = readBigEndian16(p);
+				if (length < 2 || p + length > pEnd) return false;
+				const uint8_t *pSegment = p + 2;
+				const uint32_t segmentLength = length - 2;
+				p += length;
+
+				switch (marker)
+				{
+				case 0xC0: case 0xC1:
+					if (!readFrame(pSegment, segmentLength)) return false;
+					break;
+				case 0xC2: case 0xC3: case 0xC5: case 0xC6: case 0xC7:
+				case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+					return false;   // Progressive, lossless, hierarchical or arithmetic coding
+				case 0xC4:
+					for (uint32_t offset = 0; offset < segmentLength;)
+					{
+						if (offset + 17 > segmentLength) return false;
+						const uint32_t tableClass = pSegment[offset] >> 4, id = pSegment[offset] & 15;
+						const uint8_t *pCounts = pSegment + offset + 1;
+						uint32_t valueCount = 0;
+						for (int i = 0; i < 16; i++) valueCount += pCounts[i];
+						if (tableClass > 1 || id > 3 || valueCount > 256 || offset + 17 + valueCount > segmentLength) return false;
+						if (!(tableClass == 0 ? mDc : mAc)[id].build(pCounts, pSegment + offset + 17, valueCount)) return false;
+						offset += 17 + valueCount;
+					}
+					break;
+				case 0xDB:
+					for (uint32_t offset = 0; offset < segmentLength;)
+					{
+						const uint32_t precision = pSegment[offset] >> 4, id = pSegment[offset] & 15;
+						const uint32_t tableSize = precision ? 128 : 64;
+						if (precision > 1 || id > 3 || offset + 1 + tableSize > segmentLength) return false;
+						for (uint32_t k = 0; k < 64; k++)
+							mQuant[id][k] = uint16_t(precision ? readBigEndian16(pSegment + offset + 1 + 2 * k) : pSegment[offset + 1 + k]);
+						offset += 1 + tableSize;
+					}
+					break;
+				case 0xDD:
+					if (segmentLength < 2) return false;
+					mRestartInterval = readBigEndian16(pSegment);
+					break;
+				case 0xEE:
+					if (segmentLength >= 12 && std::memcmp(pSegment, "Adobe", 5) == 0) mAdobeTransform = pSegment[11];
+					break;
+				case 0xDA:
+					if (!readScan(pSegment, segmentLength, pEnd, p)) return false;
+					scanned = true;
+					break;
+				default:
+					break;   // APPn, COM, DNL and the like
+				}
+			}
+
+			if (!scanned) return false;
+			writeImage(image);
+			return true;
+		}
+	};
+
+	bool decodePng(const uint8_t *pData, size_t size, ImageRGBA8 &image)
+	{
+		if (size < 8 || std::memcmp(pData, kPngSignature, 8) != 0) return false;
+
+		uint32_t width = 0, height = 0, depth = 0, colorType = 0;
+		bool haveHeader = false;
+		std::vector<uint8_t> compressed;
+		uint32_t palette[256];
+		uint32_t paletteSize = 0;
+		for (uint32_t i = 0; i < 256; i++) palette[i] = packRGBA8(0, 0, 0, 255);
+		const uint8_t *pKey = nullptr;     // tRNS color key of gray and RGB images
+		uint32_t keySize = 0;
+
+		for (size_t offset = 8; offset + 12 <= size;)
+		{
+			const uint32_t length = readBigEndian32(pData + offset);
+			const uint8_t *pType = pData + offset + 4;
+			const uint8_t *pChunk = pData + offset + 8;
+			if (length > size - offset - 12) return false;
+			offset += 12 + size_t(length);
+
+			if (std::memcmp(pType, "IHDR", 4) == 0)
+			{
+				if (length < 13) return false;
+				width = readBigEndian32(pChunk);
+				height = readBigEndian32(pChunk + 4);
+				depth = pChunk[8];
+				colorType = pChunk[9];
+				if (pChunk[10] != 0 || pChunk[11] != 0 || pChunk[12] != 0) return false;   // Deflate, adaptive filters, not interlaced
+				haveHeader = true;
+			}
+			else if (std::memcmp(pType, "PLTE", 4) == 0)
+			{
+				paletteSize = std::min(length / 3, 256u);
+				for (uint32_t i = 0; i < paletteSize; i++) palette[i] = packRGBA8(pChunk[3 * i], pChunk[3 * i + 1], pChunk[3 * i + 2], 255);
+			}
+			else if (std::memcmp(pType, "tRNS", 4) == 0)
+			{
+				if (colorType == 3)
+				{
+					for (uint32_t i = 0; i < std::min(length, 256u); i++) palette[i] = (palette[i] & 0x00FFFFFFu) | (uint32_t(pChunk[i]) << 24);
+				}
+				else
+				{
+					pKey = pChunk;
+					keySize = length;
+				}
+			}
+			else if (std::memcmp(pType, "IDAT", 4) == 0) compressed.insert(compressed.end(), pChunk, pChunk + length);
+			else if (std::memcmp(pType, "IEND", 4) == 0) break;
+		}
+		if (!haveHeader || width == 0 || height == 0 || width > (1u << 16) || height > (1u << 16)) return false;
+
+		uint32_t channels;
+		switch (colorType)
+		{
+		case 0: channels = 1; break;
+		case 2: channels = 3; break;
+		case 3: channels = 1; break;
+		case 4: channels = 2; break;
+		case 6: channels = 4; break;
+		default: return false;
+		}
+		const bool validDepth = (depth == 8) || (depth == 16 && colorType != 3) || ((depth == 1 || depth == 2 || depth == 4) && (colorType == 0 || colorType == 3));
+		if (!validDepth || (colorType == 3 && paletteSize == 0)) return false;
+
+		const size_t bitsPerPixel = size_t(channels) * depth;
+		const size_t rowBytes = (size_t(width) * bitsPerPixel + 7) / 8;
+		const size_t bpp = std::max<size_t>(1, bitsPerPixel / 8);
+		std::vector<uint8_t> raw;
+		InflateStream stream(compressed.data(), compressed.size());
+		if (!stream.inflate(raw, (rowBytes + 1) * height)) return false;
+
+		// Color key, at the image's bit depth
+		const bool useKey = pKey && ((colorType == 0 && keySize >= 2) || (colorType == 2 && keySize >= 6));
+		uint32_t key[3] = {};
+		if (useKey) for (uint32_t c = 0; c < (colorType == 0 ? 1u : 3u); c++) key[c] = readBigEndian16(pKey + 2 * c);
+
+		image.resize(width, height);
+		std::vector<uint8_t> zeros(rowBytes, 0);
+		const uint8_t *pPrev = zeros.data();
+		const uint32_t maxValue = (1u << depth) - 1;
+		for (uint32_t y = 0; y < height; y++)
+		{
+			uint8_t *pRow = &raw[y * (rowBytes + 1)];
+			if (!unfilterRow(pRow[0], pRow + 1, pPrev, rowBytes, bpp)) return false;
+			pRow++;
+			pPrev = pRow;
+
+			uint32_t *pDst = &image.at(0, y);
+			if (depth < 8)
+			{
+				for (uint32_t x = 0; x < width; x++)
+				{
+					const size_t bit = size_t(x) * depth;
+					const uint32_t value = (pRow[bit >> 3] >> (8 - depth - (bit & 7))) & maxValue;
+					if (colorType == 3) pDst[x] = palette[value];
+					else
+					{
+						const uint32_t g = value * 255 / maxValue;
+						pDst[x] = packRGBA8(g, g, g, (useKey && value == key[0]) ? 0 : 255);
+					}
+				}
+				continue;
+			}
+
+			const size_t stride = depth / 8;   // Bytes per channel; 16-bit channels keep their high byte
+			for (uint32_t x = 0; x < width; x++)
+			{
+				const uint8_t *pPixel = pRow + size_t(x) * channels * stride;
+				auto sample = [&](uint32_t c) { return stride == 2 ? readBigEndian16(pPixel + 2 * c) : uint32_t(pPixel[c]); };
+				auto byte = [&](uint32_t c) { return uint32_t(pPixel[c * stride]); };
+				switch (colorType)
+				{
+				case 0:
+					pDst[x] = packRGBA8(byte(0), byte(0), byte(0), (useKey && sample(0) == key[0]) ? 0 : 255);
+					break;
+				case 2:
+					pDst[x] = packRGBA8(byte(0), byte(1), byte(2), (useKey && sample(0) == key[0] && sample(1) == key[1] && sample(2) == key[2]) ? 0 : 255);
+					break;
+				case 3:
+					pDst[x] = palette[pPixel[0]];
+					break;
+				case 4:
+					pDst[x] = packRGBA8(byte(0), byte(0), byte(0), byte(1));
+					break;
+				default:
+					pDst[x] = packRGBA8(byte(0), byte(1), byte(2), byte(3));
+					break;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool decodeJpeg(const uint8_t *pData, size_t size, ImageRGBA8 &image)
+	{
+		JpegDecoder decoder;
+		return decoder.decode(pData, size, image);
+	}
+
+	bool decodeImage(const uint8_t *pData, size_t size, ImageRGBA8 &image)
+	{
+		if (size >= 8 && std::memcmp(pData, kPngSignature, 8) == 0) return decodePng(pData, size, image);
+		if (size >= 3 && pData[0] == 0xFF && pData[1] == 0xD8 && pData[2] == 0xFF) return decodeJpeg(pData, size, image);
+		return false;
+	}
+}
@@ -0,0 +1,42 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// In-memory decoders for the PNG and JPEG textures Falcor scenes reference, so the CPU side can load them without
+//     an image library
+
+#pragma once
+#include "SVGFImage.h"
+#include <cstddef>
+
+namespace CpuSVGF
+{
+	/** Decode a non-interlaced PNG of any color type, at 1 to 16 bits per channel (16-bit channels keep their high
+	    byte), applying tRNS transparency.  Returns false if the data is malformed or unsupported.
+	*/
+	bool decodePng(const uint8_t *pData, size_t size, ImageRGBA8 &image);
+
+	/** Decode a baseline or extended sequential Huffman JPEG with one (gray) or three (YCbCr, or RGB if an Adobe
+	    marker says so) components and any sampling factors.  Subsampled chroma is upsampled bilinearly, which is what
+	    libjpeg does for the usual 2x subsampling.  Progressive, arithmetic coded, lossless and CMYK files return false.
+	*/
+	bool decodeJpeg(const uint8_t *pData, size_t size, ImageRGBA8 &image);
+
+	/** Decode a PNG or JPEG, told apart by their signatures.  Returns false for anything else.
+	*/
+	bool decodeImage(const uint8_t *pData, size_t size, ImageRGBA8 &image);
+}
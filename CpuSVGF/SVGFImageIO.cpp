@@ -0,0 +1,153 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFImageIO.h"
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+namespace CpuSVGF
+{
+	namespace {
+		const char kSfbMagic[4] = { 'S', 'F', 'B', '1' };
+
+		bool hasExtension(const std::string &path, const char *ext)
+		{
+			size_t len = std::strlen(ext);
+			if (path.size() < len) return false;
+			for (size_t i = 0; i < len; i++)
+				if (std::tolower((unsigned char)path[path.size() - len + i]) != ext[i]) return false;
+			return true;
+		}
+
+		bool hostIsLittleEndian()
+		{
+			const uint32_t one = 1;
+			uint8_t first;
+			std::memcpy(&first, &one, 1);
+			return first == 1;
+		}
+
+		bool loadPfm(FILE *pFile, ImageF4 &image)
+		{
+			char type[3] = {};
+			int width = 0, height = 0;
+			float scale = 0.0f;
+			if (std::fscanf(pFile, "%2s %d %d %f", type, &width, &height, &scale) != 4) return false;
+			std::fgetc(pFile);  // Single whitespace before the raster
+
+			const bool color = (std::strcmp(type, "PF") == 0);
+			if (!color && std::strcmp(type, "Pf") != 0) return false;
+			if (width <= 0 || height <= 0) return false;
+
+			const int channels = color ? 3 : 1;
+			const bool swapBytes = (scale < 0.0f) != hostIsLittleEndian();
+
+			std::vector<float> row(size_t(width) * channels);
+			image.resize(uint32_t(width), uint32_t(height));
+
+			// PFM stores rows bottom to top
+			for (int y = height - 1; y >= 0; y--)
+			{
+				if (std::fread(row.data(), sizeof(float), row.size(), pFile) != row.size()) return false;
+				for (int x = 0; x < width; x++)
+				{
+					float c[3];
+					for (int ch = 0; ch < channels; ch++)
+					{
+						uint32_t bits = asuint(row[size_t(x) * channels + ch]);
+						if (swapBytes)
+							bits = (bits >> 24) | ((bits >> 8) & 0xFF00u) | ((bits << 8) & 0xFF0000u) | (bits << 24);
+						c[ch] = asfloat(bits);
+					}
+					image.at(x, y) = color ? float4(c[0], c[1], c[2], 1.0f) : float4(c[0], c[0], c[0], 1.0f);
+				}
+			}
+			return true;
+		}
+
+		bool savePfm(FILE *pFile, const ImageF4 &image)
+		{
+			std::fprintf(pFile, "PF\n%u %u\n%s\n", image.getWidth(), image.getHeight(), hostIsLittleEndian() ? "-1.0" : "1.0");
+
+			std::vector<float> row(size_t(image.getWidth()) * 3);
+			for (int y = int(image.getHeight()) - 1; y >= 0; y--)
+			{
+				for (int x = 0; x < int(image.getWidth()); x++)
+				{
+					const float4 &c = image.at(x, y);
+					row[size_t(x) * 3 + 0] = c.x;
+					row[size_t(x) * 3 + 1] = c.y;
+					row[size_t(x) * 3 + 2] = c.z;
+				}
+				if (std::fwrite(row.data(), sizeof(float), row.size(), pFile) != row.size()) return false;
+			}
+			return true;
+		}
+
+		bool loadSfb(FILE *pFile, ImageF4 &image)
+		{
+			char magic[4];
+			uint32_t size[2];
+			if (std::fread(magic, 1, 4, pFile) != 4 || std::memcmp(magic, kSfbMagic, 4) != 0) return false;
+			if (std::fread(size, sizeof(uint32_t), 2, pFile) != 2) return false;
+			if (size[0] == 0 || size[1] == 0) return false;
+
+			image.resize(size[0], size[1]);
+			size_t count = size_t(size[0]) * size[1];
+			return std::fread(image.getData(), sizeof(float4), count, pFile) == count;
+		}
+
+		bool saveSfb(FILE *pFile, const ImageF4 &image)
+		{
+			uint32_t size[2] = { image.getWidth(), image.getHeight() };
+			size_t count = size_t(size[0]) * size[1];
+			return std::fwrite(kSfbMagic, 1, 4, pFile) == 4 &&
+			       std::fwrite(size, sizeof(uint32_t), 2, pFile) == 2 &&
+			       std::fwrite(image.getData(), sizeof(float4), count, pFile) == count;
+		}
+	};
+
+	bool loadImage(const std::string &path, ImageF4 &image)
+	{
+		FILE *pFile = std::fopen(path.c_str(), "rb");
+		if (!pFile) return false;
+
+		bool ok = false;
+		if (hasExtension(path, ".pfm"))      ok = loadPfm(pFile, image);
+		else if (hasExtension(path, ".sfb")) ok = loadSfb(pFile, image);
+
+		std::fclose(pFile);
+		return ok;
+	}
+
+	bool saveImage(const std::string &path, const ImageF4 &image)
+	{
+		if (image.empty()) return false;
+
+		FILE *pFile = std::fopen(path.c_str(), "wb");
+		if (!pFile) return false;
+
+		bool ok = false;
+		if (hasExtension(path, ".pfm"))      ok = savePfm(pFile, image);
+		else if (hasExtension(path, ".sfb")) ok = saveSfb(pFile, image);
+
+		ok = (std::fclose(pFile) == 0) && ok;
+		return ok;
+	}
+}
@@ -0,0 +1,678 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Per-pixel CPU ports of the SVGF shaders in Data/SVGF.  Each function follows its HLSL counterpart
+//     line-for-line (same names, same order of operations) so that the CPU and GPU filters can be
+//     compared and kept in sync.  Texture reads go through Image::load(), which returns 0 out of bounds
+//     exactly like Texture2D.Load().
+
+#pragma once
+#include "SVGFImage.h"
+#include "SVGFPlanar.h"
+
+namespace CpuSVGF
+{
+	// ---- SVGFEdgeStoppingFunctions.h ----
+
+	inline float normalDistanceCos(const float3 & /*n1*/, const float3 & /*n2*/, float /*power*/)
+	{
+		//return pow(max(0.0, dot(n1, n2)), 128.0);
+		//return pow( saturate(dot(n1,n2)), power);
+		return 1.0f;
+	}
+
+	inline float2 computeWeight(
+		float depthCenter, float depthP, float phiDepth,
+		const float3 &normalCenter, const float3 &normalP, float normPower,
+		float luminanceDirectCenter, float luminanceDirectP, float phiDirect,
+		float luminanceIndirectCenter, float luminanceIndirectP, float phiIndirect)
+	{
+		const float wNormal    = normalDistanceCos(normalCenter, normalP, normPower);
+		const float wZ         = (phiDepth == 0) ? 0.0f : std::abs(depthCenter - depthP) / phiDepth;
+		const float wLdirect   = std::abs(luminanceDirectCenter - luminanceDirectP) / phiDirect;
+		const float wLindirect = std::abs(luminanceIndirectCenter - luminanceIndirectP) / phiIndirect;
+
+		const float wDirect   = std::exp(0.0f - std::max(wLdirect, 0.0f)   - std::max(wZ, 0.0f)) * wNormal;
+		const float wIndirect = std::exp(0.0f - std::max(wLindirect, 0.0f) - std::max(wZ, 0.0f)) * wNormal;
+
+		return float2(wDirect, wIndirect);
+	}
+
+	// ---- SVGFPackNormal.h ----
+
+	inline void fetchNormalAndLinearZ(const ImageF4 &ndTexture, int x, int y, float3 &norm, float2 &zLinear)
+	{
+		float4 nd = ndTexture.load(x, y);
+		norm      = normalize(octToDir(asuint(nd.x)));
+		zLinear   = float2(nd.y, nd.z);
+	}
+
+	// ---- SVGFReproject.ps.hlsl ----
+
+	/** Textures and constants bound to SVGFReproject.ps.hlsl
+	*/
+	struct ReprojectSources
+	{
+		const ImageF4 *pMotion;
+		const ImageF4 *pDirect;
+		const ImageF4 *pIndirect;
+		const ImageF4 *pPrevDirect;
+		const ImageF4 *pPrevIndirect;
+		const ImageF4 *pPrevMoments;
+		const ImageF4 *pLinearZ;
+		const ImageF4 *pPrevLinearZ;
+		const ImageF  *pHistoryLength;
+		float          alpha;
+		float          momentsAlpha;
+
+		// CPU only:  IllumChannels to reproject.  A channel left out reads as black, so its outputs are zero.
+		uint32_t       channels = kBothChannels;
+	};
+
+	/** The four render targets written by SVGFReproject.ps.hlsl
+	*/
+	struct ReprojectOutput
+	{
+		float4 direct;
+		float4 indirect;
+		float4 moments;
+		float  historyLength;
+	};
+
+	inline bool isReprjValid(const ReprojectSources &src, int coordX, int coordY, float Z, float Zprev, float fwidthZ,
+		const float3 &normal, const float3 &normalPrev, float fwidthNormal)
+	{
+		const int imageDimX = int(src.pDirect->getWidth());
+		const int imageDimY = int(src.pDirect->getHeight());
+		// check whether reprojected pixel is inside of the screen
+		if (coordX < 1 || coordY < 1 || coordX > imageDimX - 1 || coordY > imageDimY - 1) return false;
+		// check if deviation of depths is acceptable
+		if (std::abs(Zprev - Z) / (fwidthZ + 1e-4f) > 2.0f) return false;
+		// check normals for compatibility
+		if (distance(normal, normalPrev) / (fwidthNormal + 1e-2f) > 16.0f) return false;
+
+		return true;
+	}
+
+	inline bool loadPrevData(const ReprojectSources &src, int x, int y, float4 &prevDirect, float4 &prevIndirect, float4 &prevMoments, float &historyLength)
+	{
+		const float2 imageDim = float2(float(src.pDirect->getWidth()), float(src.pDirect->getHeight()));
+
+		// xy = motion, z = length(fwidth(pos)), w = length(fwidth(normal))
+		float4 motion = src.pMotion->load(x, y);
+
+		// +0.5 to account for texel center offset
+		const int iposPrevX = int(float(x) + motion.x * imageDim.x + 0.5f);
+		const int iposPrevY = int(float(y) + motion.y * imageDim.y + 0.5f);
+
+		// stores: Z, fwidth(z), z_prev
+		float4 depth  = src.pLinearZ->load(x, y);
+		float3 normal = octToDir(asuint(depth.w));
+
+		prevDirect   = float4(0, 0, 0, 0);
+		prevIndirect = float4(0, 0, 0, 0);
+		prevMoments  = float4(0, 0, 0, 0);
+
+		bool v[4];
+		const float2 posPrev = float2(float(x) + motion.x * imageDim.x, float(y) + motion.y * imageDim.y);
+		const int offset[4][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+
+		// check for all 4 taps of the bilinear filter for validity
+		bool valid = false;
+		for (int sampleIdx = 0; sampleIdx < 4; sampleIdx++)
+		{
+			int locX = int(posPrev.x) + offset[sampleIdx][0];
+			int locY = int(posPrev.y) + offset[sampleIdx][1];
+			v[sampleIdx] = false;
+			if (!src.pPrevLinearZ->inside(locX, locY)) continue;   // isTapInside()
+
+			float4 depthPrev  = src.pPrevLinearZ->load(locX, locY);
+			float3 normalPrev = octToDir(asuint(depthPrev.w));
+
+			v[sampleIdx] = isReprjValid(src, iposPrevX, iposPrevY, depth.z, depthPrev.x, depth.y, normal, normalPrev, motion.w);
+
+			valid = valid || v[sampleIdx];
+		}
+
+		if (valid)
+		{
+			float sumw = 0;
+			float fx = frac(posPrev.x);
+			float fy = frac(posPrev.y);
+
+			// bilinear weights
+			float w[4] = { (1 - fx) * (1 - fy),
+			                    fx  * (1 - fy),
+			               (1 - fx) *      fy,
+			                    fx  *      fy };
+
+			prevDirect   = float4(0, 0, 0, 0);
+			prevIndirect = float4(0, 0, 0, 0);
+			prevMoments  = float4(0, 0, 0, 0);
+
+			// perform the actual bilinear interpolation
+			for (int sampleIdx = 0; sampleIdx < 4; sampleIdx++)
+			{
+				int locX = int(posPrev.x) + offset[sampleIdx][0];
+				int locY = int(posPrev.y) + offset[sampleIdx][1];
+				if (v[sampleIdx])
+				{
+					if (src.channels & kDirectChannel)   prevDirect   += w[sampleIdx] * src.pPrevDirect->load(locX, locY);
+					if (src.channels & kIndirectChannel) prevIndirect += w[sampleIdx] * src.pPrevIndirect->load(locX, locY);
+					prevMoments  += w[sampleIdx] * src.pPrevMoments->load(locX, locY);
+					sumw         += w[sampleIdx];
+				}
+			}
+
+			// redistribute weights in case not all taps were used
+			valid = (sumw >= 0.01f);
+			prevDirect   = valid ? prevDirect / sumw   : float4(0, 0, 0, 0);
+			prevIndirect = valid ? prevIndirect / sumw : float4(0, 0, 0, 0);
+			prevMoments  = valid ? prevMoments / sumw  : float4(0, 0, 0, 0);
+		}
+
+		if (!valid) // perform cross-bilateral filter in the hope to find some suitable samples somewhere
+		{
+			float cnt = 0.0f;
+
+			// this code performs a binary descision for each tap of the cross-bilateral filter
+			const int radius = 1;
+			for (int yy = -radius; yy <= radius; yy++)
+			{
+				for (int xx = -radius; xx <= radius; xx++)
+				{
+					int pX = iposPrevX + xx;
+					int pY = iposPrevY + yy;
+					if (!src.pPrevLinearZ->inside(pX, pY)) continue;
+
+					float4 depthFilter  = src.pPrevLinearZ->load(pX, pY);
+					float3 normalFilter = octToDir(asuint(depthFilter.w));
+
+					if (isReprjValid(src, iposPrevX, iposPrevY, depth.z, depthFilter.x, depth.y, normal, normalFilter, motion.w))
+					{
+						if (src.channels & kDirectChannel)   prevDirect   += src.pPrevDirect->load(pX, pY);
+						if (src.channels & kIndirectChannel) prevIndirect += src.pPrevIndirect->load(pX, pY);
+						prevMoments  += src.pPrevMoments->load(pX, pY);
+						cnt += 1.0f;
+					}
+				}
+			}
+			if (cnt > 0)
+			{
+				valid = true;
+				prevDirect   /= cnt;
+				prevIndirect /= cnt;
+				prevMoments  /= cnt;
+			}
+		}
+
+		if (valid)
+		{
+			// crude, fixme
+			historyLength = src.pHistoryLength->load(iposPrevX, iposPrevY);
+		}
+		else
+		{
+			prevDirect    = float4(0, 0, 0, 0);
+			prevIndirect  = float4(0, 0, 0, 0);
+			prevMoments   = float4(0, 0, 0, 0);
+			historyLength = 0;
+		}
+
+		return valid;
+	}
+
+	inline ReprojectOutput reprojectPixel(const ReprojectSources &src, int x, int y)
+	{
+		float3 direct   = (src.channels & kDirectChannel)   ? src.pDirect->load(x, y).rgb()   : float3(0.0f, 0.0f, 0.0f);
+		float3 indirect = (src.channels & kIndirectChannel) ? src.pIndirect->load(x, y).rgb() : float3(0.0f, 0.0f, 0.0f);
+
+		float historyLength;
+		float4 prevDirect, prevIndirect, prevMoments;
+		bool success  = loadPrevData(src, x, y, prevDirect, prevIndirect, prevMoments, historyLength);
+		historyLength = std::min(32.0f, success ? historyLength + 1.0f : 1.0f);
+
+		// this adjusts the alpha for the case where insufficient history is available.
+		// It boosts the temporal accumulation to give the samples equal weights in
+		// the beginning.
+		const float alpha        = success ? std::max(src.alpha,        1.0f / historyLength) : 1.0f;
+		const float alphaMoments = success ? std::max(src.momentsAlpha, 1.0f / historyLength) : 1.0f;
+
+		// compute first two moments of luminance
+		float4 moments;
+		moments.x = luminance(direct);
+		moments.z = luminance(indirect);
+		moments.y = moments.x * moments.x;
+		moments.w = moments.z * moments.z;
+
+		// temporal integration of the moments
+		moments = lerp(prevMoments, moments, alphaMoments);
+
+		ReprojectOutput out;
+		out.moments       = moments;
+		out.historyLength = historyLength;
+
+		float2 variance = float2(std::max(0.0f, moments.y - moments.x * moments.x),
+		                         std::max(0.0f, moments.w - moments.z * moments.z));
+
+		// temporal integration of direct and indirect illumination
+		out.direct   = lerp(prevDirect,   float4(direct,   0), alpha);
+		out.indirect = lerp(prevIndirect, float4(indirect, 0), alpha);
+
+		// variance is propagated through the alpha channel
+		out.direct.w   = variance.x;
+		out.indirect.w = variance.y;
+
+		return out;
+	}
+
+	// ---- SVGFFilterMoments.ps.hlsl ----
+
+	/** Textures and constants bound to SVGFFilterMoments.ps.hlsl
+	*/
+	struct FilterMomentsSources
+	{
+		const ImageF4 *pDirect;
+		const ImageF4 *pIndirect;
+		const ImageF4 *pMoments;
+		const ImageF  *pHistoryLength;
+		const ImageF4 *pCompactNormDepth;
+		float          phiColor;
+		float          phiNormal;
+
+		// CPU only:  IllumChannels to filter.  The output of a channel left out is zero, as its input is.
+		uint32_t       channels = kBothChannels;
+
+		// Screen position of texel (0, 0) of the four reprojection images.  Non-zero when they only hold a window of
+		//    the screen, as in the fused reprojection tile pass; that window must cover the 7x7 footprint of every
+		//    pixel filtered.  pCompactNormDepth always covers the full screen.
+		int            originX = 0;
+		int            originY = 0;
+	};
+
+	inline void filterMomentsPixel(const FilterMomentsSources &src, int x, int y, float4 &outDirect, float4 &outIndirect)
+	{
+		const int ox = src.originX, oy = src.originY;
+		const bool filterDirect   = (src.channels & kDirectChannel) != 0;
+		const bool filterIndirect = (src.channels & kIndirectChannel) != 0;
+		float h = src.pHistoryLength->load(x - ox, y - oy);
+		const int screenSizeX = int(src.pCompactNormDepth->getWidth());
+		const int screenSizeY = int(src.pCompactNormDepth->getHeight());
+
+		if (h < 4.0f) // not enough temporal history available
+		{
+			float  sumWDirect   = 0.0f;
+			float  sumWIndirect = 0.0f;
+			float3 sumDirect    = float3(0.0f, 0.0f, 0.0f);
+			float3 sumIndirect  = float3(0.0f, 0.0f, 0.0f);
+			float4 sumMoments   = float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+			const float4 directCenter    = filterDirect   ? src.pDirect->load(x - ox, y - oy)   : float4(0.0f);
+			const float4 indirectCenter  = filterIndirect ? src.pIndirect->load(x - ox, y - oy) : float4(0.0f);
+			const float  lDirectCenter   = luminance(directCenter.rgb());
+			const float  lIndirectCenter = luminance(indirectCenter.rgb());
+
+			float3 normalCenter;
+			float2 zCenter;
+			fetchNormalAndLinearZ(*src.pCompactNormDepth, x, y, normalCenter, zCenter);
+
+			if (zCenter.x < 0)
+			{
+				// current pixel does not a valid depth => must be envmap => do nothing
+				outDirect   = directCenter;
+				outIndirect = indirectCenter;
+				return;
+			}
+
+			const float phiLDirect   = src.phiColor;
+			const float phiLIndirect = src.phiColor;
+			const float phiDepth     = std::max(zCenter.y, 1e-8f) * 3.0f;
+
+			// compute first and second moment spatially. This code also applies cross-bilateral
+			// filtering on the input color samples
+			const int radius = 3;
+
+			for (int yy = -radius; yy <= radius; yy++)
+			{
+				for (int xx = -radius; xx <= radius; xx++)
+				{
+					const int  pX     = x + xx;
+					const int  pY     = y + yy;
+					const bool inside = pX >= 0 && pY >= 0 && pX < screenSizeX && pY < screenSizeY;
+
+					if (inside)
+					{
+						const float3 directP   = filterDirect   ? src.pDirect->at(pX - ox, pY - oy).rgb()   : float3(0.0f);
+						const float3 indirectP = filterIndirect ? src.pIndirect->at(pX - ox, pY - oy).rgb() : float3(0.0f);
+						const float4 momentsP  = src.pMoments->at(pX - ox, pY - oy);
+
+						const float lDirectP   = luminance(directP);
+						const float lIndirectP = luminance(indirectP);
+
+						float3 normalP;
+						float2 zP;
+						fetchNormalAndLinearZ(*src.pCompactNormDepth, pX, pY, normalP, zP);
+
+						const float2 w = computeWeight(
+							zCenter.x, zP.x, phiDepth * length(float2(float(xx), float(yy))),
+							normalCenter, normalP, src.phiNormal,
+							lDirectCenter, lDirectP, phiLDirect,
+							lIndirectCenter, lIndirectP, phiLIndirect);
+
+						const float wDirect   = w.x;
+						const float wIndirect = w.y;
+
+						sumWDirect   += wDirect;
+						sumDirect    += directP * wDirect;
+
+						sumWIndirect += wIndirect;
+						sumIndirect  += indirectP * wIndirect;
+
+						sumMoments   += momentsP * float4(wDirect, wDirect, wIndirect, wIndirect);
+					}
+				}
+			}
+
+			// Clamp sums to >0 to avoid NaNs.
+			sumWDirect   = std::max(sumWDirect, 1e-6f);
+			sumWIndirect = std::max(sumWIndirect, 1e-6f);
+
+			sumDirect   = sumDirect / sumWDirect;
+			sumIndirect = sumIndirect / sumWIndirect;
+			sumMoments  = sumMoments / float4(sumWDirect, sumWDirect, sumWIndirect, sumWIndirect);
+
+			// compute variance for direct and indirect illumination using first and second moments
+			float2 variance = float2(sumMoments.y - sumMoments.x * sumMoments.x,
+			                         sumMoments.w - sumMoments.z * sumMoments.z);
+
+			// give the variance a boost for the first frames
+			variance = variance * (4.0f / h);
+
+			outDirect   = float4(sumDirect, variance.x);
+			outIndirect = float4(sumIndirect, variance.y);
+		}
+		else
+		{
+			// do nothing, pass data unmodified
+			outDirect   = filterDirect   ? src.pDirect->load(x - ox, y - oy)   : float4(0.0f);
+			outIndirect = filterIndirect ? src.pIndirect->load(x - ox, y - oy) : float4(0.0f);
+		}
+	}
+
+	// ---- SVGFAtrous.ps.hlsl ----
+
+	/** Textures and constants bound to SVGFAtrous.ps.hlsl
+	*/
+	struct AtrousSources
+	{
+		const ImageF4 *pDirect;
+		const ImageF4 *pIndirect;
+		const ImageF4 *pCompactNormDepth;
+		const ImageF  *pHistoryLength;
+		const ImageF4 *pAlbedo;
+		const ImageF4 *pIndirAlbedo;
+		int            stepSize;
+		float          phiColor;
+		float          phiNormal;
+	};
+
+	// computes a 3x3 gaussian blur of the variance, centered around
+	// the current pixel
+	template <bool kDirect, bool kIndirect>
+	inline float2 computeVarianceCenter(int x, int y, const ImageF4 &sDirect, const ImageF4 &sIndirect)
+	{
+		float2 sum = float2(0.0f, 0.0f);
+
+		const float kernel[2][2] = {
+			{ 1.0f / 4.0f, 1.0f / 8.0f  },
+			{ 1.0f / 8.0f, 1.0f / 16.0f }
+		};
+
+		const int radius = 1;
+		for (int yy = -radius; yy <= radius; yy++)
+		{
+			for (int xx = -radius; xx <= radius; xx++)
+			{
+				float k = kernel[std::abs(xx)][std::abs(yy)];
+
+				if (kDirect)   sum.x += sDirect.load(x + xx, y + yy).w * k;
+				if (kIndirect) sum.y += sIndirect.load(x + xx, y + yy).w * k;
+			}
+		}
+
+		return sum;
+	}
+
+	/** SVGFAtrous.ps.hlsl compiled with ATROUS_CHANNELS = kDirect | kIndirect << 1, ATROUS_MODULATE = kModulate and
+	    ATROUS_RADIUS = kRadius.  A channel left out passes through.
+	*/
+	template <bool kDirect, bool kIndirect, bool kModulate, int kRadius>
+	inline void atrousPixel(const AtrousSources &src, int x, int y, float4 &outDirect, float4 &outIndirect)
+	{
+		const int screenSizeX = int(src.pDirect->getWidth());
+		const int screenSizeY = int(src.pDirect->getHeight());
+
+		const float epsVariance      = 1e-10f;
+		const float kernelWeights[3] = { 1.0f, kRadius == 1 ? 1.0f / 2.0f : 2.0f / 3.0f, 1.0f / 6.0f };
+
+		const float4 directCenter    = src.pDirect->load(x, y);
+		const float4 indirectCenter  = src.pIndirect->load(x, y);
+		const float  lDirectCenter   = luminance(directCenter.rgb());
+		const float  lIndirectCenter = luminance(indirectCenter.rgb());
+
+		// variance for direct and indirect, filtered using 3x3 gaussin blur
+		const float2 var = computeVarianceCenter<kDirect, kIndirect>(x, y, *src.pDirect, *src.pIndirect);
+
+		float3 normalCenter;
+		float2 zCenter;
+		fetchNormalAndLinearZ(*src.pCompactNormDepth, x, y, normalCenter, zCenter);
+
+		if (zCenter.x < 0)
+		{
+			// not a valid depth => must be envmap => do not filter
+			outDirect   = directCenter;
+			outIndirect = indirectCenter;
+			return;
+		}
+
+		const float phiLDirect   = src.phiColor * std::sqrt(std::max(0.0f, epsVariance + var.x));
+		const float phiLIndirect = src.phiColor * std::sqrt(std::max(0.0f, epsVariance + var.y));
+		const float phiDepth     = std::max(zCenter.y, 1e-8f) * float(src.stepSize);
+
+		// explicitly store/accumulate center pixel with weight 1 to prevent issues
+		// with the edge-stopping functions
+		float  sumWDirect   = 1.0f;
+		float  sumWIndirect = 1.0f;
+		float4 sumDirect    = directCenter;
+		float4 sumIndirect  = indirectCenter;
+
+		for (int yy = -kRadius; yy <= kRadius; yy++)
+		{
+			for (int xx = -kRadius; xx <= kRadius; xx++)
+			{
+				const int  pX     = x + xx * src.stepSize;
+				const int  pY     = y + yy * src.stepSize;
+				const bool inside = pX >= 0 && pY >= 0 && pX < screenSizeX && pY < screenSizeY;
+
+				const float kernel = kernelWeights[std::abs(xx)] * kernelWeights[std::abs(yy)];
+
+				if (inside && (xx != 0 || yy != 0)) // skip center pixel, it is already accumulated
+				{
+					const float4 directP   = kDirect   ? src.pDirect->at(pX, pY)   : float4(0.0f, 0.0f, 0.0f, 0.0f);
+					const float4 indirectP = kIndirect ? src.pIndirect->at(pX, pY) : float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+					float3 normalP;
+					float2 zP;
+					fetchNormalAndLinearZ(*src.pCompactNormDepth, pX, pY, normalP, zP);
+					const float lDirectP   = luminance(directP.rgb());
+					const float lIndirectP = luminance(indirectP.rgb());
+
+					// compute the edge-stopping functions
+					const float2 w = computeWeight(
+						zCenter.x, zP.x, phiDepth * length(float2(float(xx), float(yy))),
+						normalCenter, normalP, src.phiNormal,
+						lDirectCenter, lDirectP, phiLDirect,
+						lIndirectCenter, lIndirectP, phiLIndirect);
+
+					const float wDirect   = w.x * kernel;
+					const float wIndirect = w.y * kernel;
+
+					// alpha channel contains the variance, therefore the weights need to be squared, see paper for the formula
+					if (kDirect)
+					{
+						sumWDirect   += wDirect;
+						sumDirect    += float4(wDirect, wDirect, wDirect, wDirect * wDirect) * directP;
+					}
+					if (kIndirect)
+					{
+						sumWIndirect += wIndirect;
+						sumIndirect  += float4(wIndirect, wIndirect, wIndirect, wIndirect * wIndirect) * indirectP;
+					}
+				}
+			}
+		}
+
+		// renormalization is different for variance, check paper for the formula.  The sums of a channel left out are
+		//    its center with weight 1, so it passes through.
+		outDirect   = sumDirect   / float4(sumWDirect,   sumWDirect,   sumWDirect,   sumWDirect   * sumWDirect);
+		outIndirect = sumIndirect / float4(sumWIndirect, sumWIndirect, sumWIndirect, sumWIndirect * sumWIndirect);
+
+		// do the demodulation in the last iteration to save memory bandwidth
+		if (kModulate)
+		{
+			outDirect = outDirect * src.pAlbedo->load(x, y) + outIndirect * src.pIndirAlbedo->load(x, y);
+		}
+	}
+
+	using AtrousPixelFunc = void (*)(const AtrousSources &src, int x, int y, float4 &outDirect, float4 &outIndirect);
+
+	/** The atrousPixel() variant for a set of IllumChannels, with or without modulation, for a radius of 1 or 2
+	*/
+	template <bool kModulate, int kRadius>
+	inline AtrousPixelFunc getAtrousPixelVariant(uint32_t channels)
+	{
+		switch (channels & kBothChannels)
+		{
+		case kDirectChannel:   return atrousPixel<true, false, kModulate, kRadius>;
+		case kIndirectChannel: return atrousPixel<false, true, kModulate, kRadius>;
+		case kBothChannels:    return atrousPixel<true, true, kModulate, kRadius>;
+		default:               return atrousPixel<false, false, kModulate, kRadius>;
+		}
+	}
+
+	inline AtrousPixelFunc getAtrousPixelVariant(uint32_t channels, bool modulate, int radius)
+	{
+		if (radius == 1) return modulate ? getAtrousPixelVariant<true, 1>(channels) : getAtrousPixelVariant<false, 1>(channels);
+		return modulate ? getAtrousPixelVariant<true, 2>(channels) : getAtrousPixelVariant<false, 2>(channels);
+	}
+
+	// ---- SVGFModulate.ps.hlsl / SVGFCombineUnfiltered.ps.hlsl ----
+
+	inline float4 modulatePixel(const ImageF4 &direct, const ImageF4 &indirect, const ImageF4 &dirAlbedo, const ImageF4 &indirAlbedo, int x, int y)
+	{
+		return direct.load(x, y) * dirAlbedo.load(x, y) + indirect.load(x, y) * indirAlbedo.load(x, y);
+	}
+
+	// ---- SVGFTemporalAA.ps.hlsl ----
+
+	/** Textures and constants bound to SVGFTemporalAA.ps.hlsl
+	*/
+	struct TemporalAASources
+	{
+		const ImageF4 *pColor;
+		const ImageF4 *pMotion;
+		const ImageF4 *pHistory;
+		float          alpha;
+		bool           hasHistory;
+	};
+
+	inline float3 rgbToYCoCg(const float3 &c)
+	{
+		return float3( 0.25f * c.x + 0.5f * c.y + 0.25f * c.z,
+		               0.5f  * c.x              - 0.5f  * c.z,
+		              -0.25f * c.x + 0.5f * c.y - 0.25f * c.z);
+	}
+
+	inline float3 yCoCgToRgb(const float3 &c)
+	{
+		return float3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+	}
+
+	inline const float4 &loadClampedToScreen(const ImageF4 &image, int x, int y)
+	{
+		return image.at(std::min(std::max(x, 0), int(image.getWidth()) - 1), std::min(std::max(y, 0), int(image.getHeight()) - 1));
+	}
+
+	inline float3 loadHistory(const ImageF4 &history, const float2 &posPrev)
+	{
+		const float2 p0 = float2(std::floor(posPrev.x), std::floor(posPrev.y));
+		const float2 f  = posPrev - p0;
+		const int    ix = int(p0.x), iy = int(p0.y);
+
+		const float4 &h00 = loadClampedToScreen(history, ix,     iy);
+		const float4 &h10 = loadClampedToScreen(history, ix + 1, iy);
+		const float4 &h01 = loadClampedToScreen(history, ix,     iy + 1);
+		const float4 &h11 = loadClampedToScreen(history, ix + 1, iy + 1);
+
+		const float3 top    = float3(h00.x, h00.y, h00.z) + (float3(h10.x, h10.y, h10.z) - float3(h00.x, h00.y, h00.z)) * f.x;
+		const float3 bottom = float3(h01.x, h01.y, h01.z) + (float3(h11.x, h11.y, h11.z) - float3(h01.x, h01.y, h01.z)) * f.x;
+		return top + (bottom - top) * f.y;
+	}
+
+	/** Where pixel (x, y) was last frame, and whether that is on screen (the shader's posPrev and onScreen)
+	*/
+	inline bool getTemporalAAPrevPos(const ImageF4 &motion, int x, int y, float2 &posPrev)
+	{
+		const float2 imageDim = float2(float(motion.getWidth()), float(motion.getHeight()));
+		const float4 m = motion.load(x, y);
+		posPrev = float2(float(x) + m.x * imageDim.x, float(y) + m.y * imageDim.y);
+		return posPrev.x > -0.5f && posPrev.y > -0.5f && posPrev.x < imageDim.x - 0.5f && posPrev.y < imageDim.y - 0.5f;
+	}
+
+	/** Returns both the color and history target
+	*/
+	inline float4 temporalAAPixel(const TemporalAASources &src, int x, int y)
+	{
+		const float4 color   = src.pColor->load(x, y);
+		const float3 current = rgbToYCoCg(float3(color.x, color.y, color.z));
+
+		float3 boxMin = current;
+		float3 boxMax = current;
+		for (int yy = -1; yy <= 1; yy++)
+		{
+			for (int xx = -1; xx <= 1; xx++)
+			{
+				const float4 &n = loadClampedToScreen(*src.pColor, x + xx, y + yy);
+				const float3  c = rgbToYCoCg(float3(n.x, n.y, n.z));
+				boxMin = min(boxMin, c);
+				boxMax = max(boxMax, c);
+			}
+		}
+
+		float2 posPrev;
+		const bool onScreen = getTemporalAAPrevPos(*src.pMotion, x, y, posPrev);
+		const bool valid    = src.hasHistory && onScreen;
+
+		const float3 history = valid ? min(max(rgbToYCoCg(loadHistory(*src.pHistory, posPrev)), boxMin), boxMax) : current;
+		const float  alpha   = valid ? src.alpha : 1.0f;
+		const float3 result  = history + (current - history) * alpha;
+
+		const float3 rgb = yCoCgToRgb(result);
+		return float4(rgb.x, rgb.y, rgb.z, color.w);
+	}
+}
@@ -0,0 +1,113 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFLightSampler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace CpuSVGF
+{
+	namespace {
+		const float kPi = 3.14159265f;
+	};
+
+	const char *getLightSelectionName(LightSelection selection)
+	{
+		switch (selection)
+		{
+		case LightSelection::Uniform: return "uniform";
+		case LightSelection::Power:   return "power";
+		default:                      return "unknown";
+		}
+	}
+
+	float getLightPower(bool directional, const float3 &intensity, float openingAngle)
+	{
+		const float cone = directional ? 1.0f : 0.5f * (1.0f - std::cos(std::min(std::max(openingAngle, 0.0f), kPi)));
+		const float power = luminance(intensity) * cone;
+		return std::isfinite(power) ? std::max(power, 0.0f) : 0.0f;
+	}
+
+	float getLightPower(const SceneLight &light)
+	{
+		return getLightPower(light.type == SceneLightType::Directional, light.intensity, light.openingAngle);
+	}
+
+	bool LightAliasTable::update(const std::vector<float> &weights)
+	{
+		if (mBuildCount > 0 && weights == mWeights) return false;
+		mWeights = weights;
+		build();
+		return true;
+	}
+
+	bool LightAliasTable::update(const std::vector<SceneLight> &lights)
+	{
+		std::vector<float> weights(lights.size());
+		for (size_t i = 0; i < lights.size(); i++) weights[i] = getLightPower(lights[i]);
+		return update(weights);
+	}
+
+	void LightAliasTable::build()
+	{
+		mBuildCount++;
+		const uint32_t count = uint32_t(mWeights.size());
+		mEntries.assign(count, LightAliasEntry());
+		if (count == 0) return;
+
+		double sum = 0.0;
+		for (float w : mWeights) sum += double(w);
+		if (!(sum > 0.0))
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				mEntries[i].alias = i;
+				mEntries[i].invPdf = float(count);
+			}
+			return;
+		}
+
+		// Vose:  scale the weights to average 1, then fill each under-full entry from one over-full entry
+		mScaled.resize(count);
+		mSmall.clear();
+		mLarge.clear();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			mScaled[i] = float(double(mWeights[i]) * double(count) / sum);
+			mEntries[i].alias  = i;
+			mEntries[i].invPdf = mWeights[i] > 0.0f ? float(sum / double(mWeights[i])) : 0.0f;
+			(mScaled[i] < 1.0f ? mSmall : mLarge).push_back(i);
+		}
+		while (!mSmall.empty() && !mLarge.empty())
+		{
+			const uint32_t small = mSmall.back(), large = mLarge.back();
+			mSmall.pop_back();
+			mEntries[small].threshold = mScaled[small];
+			mEntries[small].alias     = large;
+			mScaled[large] = (mScaled[large] + mScaled[small]) - 1.0f;
+			if (mScaled[large] < 1.0f)
+			{
+				mLarge.pop_back();
+				mSmall.push_back(large);
+			}
+		}
+		// Whatever is left is 1 up to rounding and keeps its own light
+		for (uint32_t i : mSmall) mEntries[i].threshold = 1.0f;
+		for (uint32_t i : mLarge) mEntries[i].threshold = 1.0f;
+	}
+}
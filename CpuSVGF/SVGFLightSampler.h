@@ -0,0 +1,97 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Power proportional light selection for the GI pass' direct lighting, shared with the CPU tracer (the HLSL side is
+//     Data/SVGFSampleOtherPasses/lightSelection.hlsli)
+
+#pragma once
+#include "SVGFScene.h"
+#include <algorithm>
+#include <vector>
+
+namespace CpuSVGF
+{
+	/** How the GI pass picks the one light it samples per pixel
+	*/
+	enum class LightSelection : uint32_t
+	{
+		Uniform,   ///< Every light equally often (the original)
+		Power,     ///< In proportion to getLightPower(), through a LightAliasTable
+		Count
+	};
+
+	const char *getLightSelectionName(LightSelection selection);
+
+	/** Selection weight of a light:  the luminance of its intensity times the share of directions it lights (its cone's
+	    solid angle over the sphere's; 1 for point and directional lights).  Falcor's lights are punctual, so this is what
+	    the light contributes at unit distance, not an emitted power comparable between point and directional lights.
+	*/
+	float getLightPower(bool directional, const float3 &intensity, float openingAngle);
+	float getLightPower(const SceneLight &light);
+
+	/** One entry of the alias table.  GGXGlobalIlluminationPass uploads the table as an RGBA32Uint texture of one row,
+	    so the layout is fixed at 16 bytes.
+	*/
+	struct LightAliasEntry
+	{
+		float    threshold = 1.0f;   ///< Keep this entry's light if the fractional part of u * count is below this ...
+		uint32_t alias = 0;          ///< ... else take this one
+		float    invPdf = 1.0f;      ///< Reciprocal of the probability of picking this entry's own light
+		uint32_t pad = 0;
+	};
+	static_assert(sizeof(LightAliasEntry) == 16, "lightSelection.hlsli reads LightAliasEntry as a uint4");
+
+	/** Walker's alias table, built with Vose's method in O(n):  picks light i with probability weights[i] / sum(weights)
+	    from one random number in O(1).  Without any positive weight every light is equally likely.
+	*/
+	class LightAliasTable
+	{
+	public:
+		/** Rebuild for new weights, unless they are the ones the table was built for.  Returns true if it was rebuilt,
+		    so callers only upload the entries after a change.
+		*/
+		bool update(const std::vector<float> &weights);
+
+		/** Weights of the scene's lights from getLightPower(), then update()
+		*/
+		bool update(const std::vector<SceneLight> &lights);
+
+		/** The light for u in [0, 1), and the reciprocal of its probability
+		*/
+		uint32_t sample(float u, float &invPdf) const
+		{
+			const float scaled = u * float(mEntries.size());
+			uint32_t index = std::min(uint32_t(scaled), uint32_t(mEntries.size()) - 1);
+			if (scaled - float(index) >= mEntries[index].threshold) index = mEntries[index].alias;
+			invPdf = mEntries[index].invPdf;
+			return index;
+		}
+
+		const std::vector<LightAliasEntry> &getEntries() const { return mEntries; }
+		uint32_t getBuildCount() const { return mBuildCount; }
+
+	private:
+		void build();
+
+		std::vector<float>           mWeights;
+		std::vector<float>           mScaled;     ///< Scratch space of build(), kept to avoid reallocating
+		std::vector<uint32_t>        mSmall, mLarge;
+		std::vector<LightAliasEntry> mEntries;
+		uint32_t                     mBuildCount = 0;
+	};
+}
@@ -0,0 +1,184 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// A tiny subset of HLSL vector types and intrinsics, so the CPU port of the SVGF shaders can be read
+//     side-by-side with the code in Data/SVGF.  Only what the filter actually uses is provided.
+
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+namespace CpuSVGF
+{
+	struct float2
+	{
+		float x, y;
+		float2() : x(0.0f), y(0.0f) {}
+		float2(float v) : x(v), y(v) {}
+		float2(float x_, float y_) : x(x_), y(y_) {}
+	};
+
+	struct float3
+	{
+		float x, y, z;
+		float3() : x(0.0f), y(0.0f), z(0.0f) {}
+		float3(float v) : x(v), y(v), z(v) {}
+		float3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+	};
+
+	struct float4
+	{
+		float x, y, z, w;
+		float4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+		float4(float v) : x(v), y(v), z(v), w(v) {}
+		float4(float x_, float y_, float z_, float w_) : x(x_), y(y_), z(z_), w(w_) {}
+		float4(const float3 &v, float w_) : x(v.x), y(v.y), z(v.z), w(w_) {}
+		float3 rgb() const { return float3(x, y, z); }
+	};
+
+	inline float2 operator+(const float2 &a, const float2 &b) { return float2(a.x + b.x, a.y + b.y); }
+	inline float2 operator-(const float2 &a, const float2 &b) { return float2(a.x - b.x, a.y - b.y); }
+	inline float2 operator*(const float2 &a, float s)         { return float2(a.x * s, a.y * s); }
+
+	inline float3 operator+(const float3 &a, const float3 &b) { return float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	inline float3 operator-(const float3 &a, const float3 &b) { return float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline float3 operator*(const float3 &a, const float3 &b) { return float3(a.x * b.x, a.y * b.y, a.z * b.z); }
+	inline float3 operator*(const float3 &a, float s)         { return float3(a.x * s, a.y * s, a.z * s); }
+	inline float3 operator/(const float3 &a, float s)         { return float3(a.x / s, a.y / s, a.z / s); }
+	inline float3 operator/(const float3 &a, const float3 &b) { return float3(a.x / b.x, a.y / b.y, a.z / b.z); }
+	inline float3 operator-(const float3 &a)                  { return float3(-a.x, -a.y, -a.z); }
+	inline float3 &operator+=(float3 &a, const float3 &b)     { a = a + b; return a; }
+
+	inline float4 operator+(const float4 &a, const float4 &b) { return float4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+	inline float4 operator-(const float4 &a, const float4 &b) { return float4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); }
+	inline float4 operator*(const float4 &a, const float4 &b) { return float4(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w); }
+	inline float4 operator/(const float4 &a, const float4 &b) { return float4(a.x / b.x, a.y / b.y, a.z / b.z, a.w / b.w); }
+	inline float4 operator*(float s, const float4 &a)         { return float4(a.x * s, a.y * s, a.z * s, a.w * s); }
+	inline float4 operator*(const float4 &a, float s)         { return float4(a.x * s, a.y * s, a.z * s, a.w * s); }
+	inline float4 operator/(const float4 &a, float s)         { return float4(a.x / s, a.y / s, a.z / s, a.w / s); }
+	inline float4 &operator+=(float4 &a, const float4 &b)     { a = a + b; return a; }
+	inline float4 &operator/=(float4 &a, float s)             { a = a / s; return a; }
+
+	inline float3 min(const float3 &a, const float3 &b)       { return float3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)); }
+	inline float3 max(const float3 &a, const float3 &b)       { return float3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)); }
+
+	inline float  dot(const float3 &a, const float3 &b)       { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float3 cross(const float3 &a, const float3 &b)     { return float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+	inline float  length(const float2 &v)                     { return std::sqrt(v.x * v.x + v.y * v.y); }
+	inline float  length(const float3 &v)                     { return std::sqrt(dot(v, v)); }
+	inline float  distance(const float3 &a, const float3 &b)  { return length(a - b); }
+	inline float3 normalize(const float3 &v)                  { return v / length(v); }
+	inline float  frac(float v)                               { return v - std::floor(v); }
+	inline float  saturate(float v)                           { return std::min(std::max(v, 0.0f), 1.0f); }
+	inline float  lerp(float a, float b, float t)             { return a + (b - a) * t; }
+	inline float4 lerp(const float4 &a, const float4 &b, float t) { return a + (b - a) * t; }
+
+	/** Same weights as Falcor's luminance() in Helpers.slang
+	*/
+	inline float luminance(const float3 &rgb)
+	{
+		return dot(rgb, float3(0.2126f, 0.7152f, 0.0722f));
+	}
+
+	inline uint32_t asuint(float f)    { uint32_t u; std::memcpy(&u, &f, sizeof(u)); return u; }
+	inline float    asfloat(uint32_t u) { float f; std::memcpy(&f, &u, sizeof(f)); return f; }
+
+	/** Equivalent of HLSL f16tof32() on the low 16 bits of the input
+	*/
+	inline float f16tof32(uint32_t h)
+	{
+		uint32_t sign = (h & 0x8000u) << 16;
+		uint32_t exp  = (h >> 10) & 0x1Fu;
+		uint32_t mant = h & 0x3FFu;
+
+		if (exp == 0x1Fu)                 // Inf / NaN
+			return asfloat(sign | 0x7F800000u | (mant << 13));
+		if (exp != 0)                     // Normalized
+			return asfloat(sign | ((exp + 112u) << 23) | (mant << 13));
+		if (mant == 0)                    // Signed zero
+			return asfloat(sign);
+
+		// Denormalized half, renormalize it as a float
+		exp = 113u;
+		while ((mant & 0x400u) == 0) { mant <<= 1; exp--; }
+		return asfloat(sign | (exp << 23) | ((mant & 0x3FFu) << 13));
+	}
+
+	/** Equivalent of HLSL f32tof16(), round to nearest even
+	*/
+	inline uint32_t f32tof16(float f)
+	{
+		uint32_t u    = asuint(f);
+		uint32_t sign = (u >> 16) & 0x8000u;
+		int32_t  exp  = int32_t((u >> 23) & 0xFFu) - 127 + 15;
+		uint32_t mant = u & 0x7FFFFFu;
+
+		if (((u >> 23) & 0xFFu) == 0xFFu) // Inf / NaN
+			return sign | 0x7C00u | (mant ? 0x200u : 0u);
+		if (exp >= 0x1F)                  // Overflow to Inf
+			return sign | 0x7C00u;
+		if (exp <= 0)                     // Denormal or zero
+		{
+			if (exp < -10) return sign;
+			mant |= 0x800000u;
+			uint32_t shift = uint32_t(14 - exp);
+			uint32_t half  = mant >> shift;
+			uint32_t rem   = mant & ((1u << shift) - 1u);
+			uint32_t mid   = 1u << (shift - 1);
+			if (rem > mid || (rem == mid && (half & 1u))) half++;
+			return sign | half;
+		}
+
+		uint32_t half = sign | (uint32_t(exp) << 10) | (mant >> 13);
+		uint32_t rem  = mant & 0x1FFFu;
+		if (rem > 0x1000u || (rem == 0x1000u && (half & 1u))) half++;
+		return half;
+	}
+
+	/** Port of octToDir() from SVGFPackNormal.h
+	*/
+	inline float3 octToDir(uint32_t octo)
+	{
+		float2 e = float2(f16tof32(octo & 0xFFFF), f16tof32((octo >> 16) & 0xFFFF));
+		float3 v = float3(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+		if (v.z < 0.0f)
+		{
+			float vx = v.x, vy = v.y;
+			v.x = (1.0f - std::abs(vy)) * (vx >= 0.0f ? 1.0f : -1.0f);
+			v.y = (1.0f - std::abs(vx)) * (vy >= 0.0f ? 1.0f : -1.0f);
+		}
+		return normalize(v);
+	}
+
+	/** Port of dirToOct() from SVGFPackNormal.h
+	*/
+	inline uint32_t dirToOct(const float3 &normal)
+	{
+		float  invL1 = 1.0f / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+		float2 p     = float2(normal.x * invL1, normal.y * invL1);
+		float2 e     = p;
+		if (!(normal.z > 0.0f))
+		{
+			e.x = (1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f);
+			e.y = (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		return (f32tof16(e.y) << 16) + f32tof16(e.x);
+	}
+}
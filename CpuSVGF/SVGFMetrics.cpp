@@ -0,0 +1,367 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFMetrics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace CpuSVGF
+{
+	namespace {
+		const double kPi = 3.14159265358979323846;
+
+		enum ReferencePlane : uint32_t
+		{
+			kRefR, kRefG, kRefB,                // Linear rgb
+			kRefLuma,                           // sRGB encoded luminance of the display image
+			kRefLabL, kRefLabA, kRefLabB,       // Filtered, Hunt-adjusted L*a*b*
+			kRefEdge, kRefPoint,                // Feature magnitudes
+			kRefMeanLuma, kRefMeanLuma2,        // SSIM window means of luma and luma^2
+			kReferencePlaneCount
+		};
+
+		/** Outputs of the horizontal passes, over the whole image so the vertical passes can read across bands
+		*/
+		enum RowPlane : uint32_t
+		{
+			kRowOppY, kRowOppCx, kRowOppCz0, kRowOppCz1,
+			kRowGaussian, kRowEdge, kRowPoint,
+			kRowLuma, kRowLuma2, kRowLumaCross,
+			kRowPlaneCount
+		};
+
+		/** Per-thread planes of one band of rows.  The first pass uses the first set, the second pass the second.
+		*/
+		enum BandPlane : uint32_t
+		{
+			kBandR = 0, kBandG, kBandB, kBandOppY, kBandOppCx, kBandOppCz, kBandLuminance, kBandLuma,
+			kBandFilteredY = 0, kBandFilteredCx, kBandFilteredCz, kBandEdgeX, kBandEdgeY, kBandPointX, kBandPointY,
+			kBandMeanLuma, kBandMeanLuma2, kBandMeanCross,
+			kBandPlaneCount
+		};
+
+		const uint32_t kBandHeight = 16;
+
+		PlanarImage &getBandPlanes(uint32_t width)
+		{
+			thread_local PlanarImage planes;
+			if (planes.getWidth() != width) planes.resize(width, kBandHeight, kBandPlaneCount);
+			return planes;
+		}
+
+		/** exp(-x^2 / (2 sigma^2)) for x in [-radius, radius]
+		*/
+		std::vector<double> gaussian(double sigma, int radius)
+		{
+			std::vector<double> g(2 * radius + 1);
+			for (int x = -radius; x <= radius; x++) g[x + radius] = std::exp(-double(x * x) / (2.0 * sigma * sigma));
+			return g;
+		}
+
+		/** Scale positive taps to sum to 1 and negative taps to -1, like FLIP's feature detectors
+		*/
+		std::vector<double> normalizeSigned(std::vector<double> taps)
+		{
+			double positive = 0.0, negative = 0.0;
+			for (double t : taps) (t > 0.0 ? positive : negative) += t;
+			for (double &t : taps) t = t > 0.0 ? t / positive : t / -negative;
+			return taps;
+		}
+
+		std::vector<float> toWeights(const std::vector<double> &taps, double scale)
+		{
+			std::vector<float> weights(taps.size());
+			for (size_t i = 0; i < taps.size(); i++) weights[i] = float(taps[i] * scale);
+			return weights;
+		}
+
+		double sum(const std::vector<double> &taps)
+		{
+			double s = 0.0;
+			for (double t : taps) s += t;
+			return s;
+		}
+
+		/** Hunt-adjusted L*a*b* of a linear rgb color; the scalar twin of SimdKernels::filteredToHuntLab()
+		*/
+		void rgbToHuntLab(const double rgb[3], double lab[3])
+		{
+			const double toXyz[3][3] = { { 10135552.0 / 23359437.0, 8788810.0 / 23359437.0, 4435075.0 / 23359437.0 },
+			                             { 2613072.0 / 12288897.0,  8788810.0 / 12288897.0, 887015.0 / 12288897.0 },
+			                             { 1425312.0 / 80288307.0,  8788810.0 / 80288307.0, 70074185.0 / 80288307.0 } };
+			double f[3];
+			for (int c = 0; c < 3; c++)
+			{
+				const double t = toXyz[c][0] * rgb[0] + toXyz[c][1] * rgb[1] + toXyz[c][2] * rgb[2];
+				f[c] = t > 216.0 / 24389.0 ? std::cbrt(t) : t * 841.0 / 108.0 + 4.0 / 29.0;
+			}
+			lab[0] = 116.0 * f[1] - 16.0;
+			lab[1] = 500.0 * (f[0] - f[1]) * 0.01 * lab[0];
+			lab[2] = 200.0 * (f[1] - f[2]) * 0.01 * lab[0];
+		}
+	}
+
+	MetricsEvaluator::SharedPtr MetricsEvaluator::create(const Settings &settings, CpuThreadPool::SharedPtr pThreadPool)
+	{
+		return SharedPtr(new MetricsEvaluator(settings, pThreadPool ? pThreadPool : CpuThreadPool::create()));
+	}
+
+	MetricsEvaluator::MetricsEvaluator(const Settings &settings, CpuThreadPool::SharedPtr pThreadPool)
+		: mSettings(settings), mpThreadPool(pThreadPool)
+	{
+		mConvolve = getConvolveSimdKernel(settings.simdIsa);
+		mMetrics  = getMetricsSimdKernel(settings.simdIsa);
+
+		// Contrast sensitivity filters:  sums of terms a * sqrt(pi / b) * exp(-pi^2 d^2 / b), d in degrees, each a
+		//    Gaussian of standard deviation sqrt(b / (2 pi^2)) * ppd pixels.  FLIP cuts every filter off at 3 deviations
+		//    of the widest term; the narrow ones are cut at 4 of their own, where they have decayed to under 1e-3.
+		const double ppd = std::max(double(settings.pixelsPerDegree), 1.0);
+		const int    flipRadius = int(std::ceil(3.0 * std::sqrt(0.04 / (2.0 * kPi * kPi)) * ppd));
+		struct CsfTerm { double a, b; };
+		auto makeTerm = [&](CsfTerm term, std::vector<double> &taps) -> double
+		{
+			const double sigma = std::sqrt(term.b / (2.0 * kPi * kPi)) * ppd;
+			const int radius = std::min({ flipRadius, int(std::ceil(4.0 * sigma)), kMaxConvolveRadius });
+			taps = gaussian(sigma, radius);
+			const double s = sum(taps);
+			for (double &t : taps) t /= s;
+			return term.a * std::sqrt(kPi / term.b) * s * s;    // The term's weight in the 2D filter
+		};
+
+		std::vector<double> taps;
+		makeTerm({ 1.0, 0.0047 }, taps);
+		mCsfLuminance = { toWeights(taps, 1.0), int(taps.size() / 2) };
+		makeTerm({ 1.0, 0.0053 }, taps);
+		mCsfRedGreen = { toWeights(taps, 1.0), int(taps.size() / 2) };
+
+		std::vector<double> blueYellow[2];
+		const double share0 = makeTerm({ 34.1, 0.04 }, blueYellow[0]);
+		const double share1 = makeTerm({ 13.5, 0.025 }, blueYellow[1]);
+		for (int i = 0; i < 2; i++)
+		{
+			mCsfBlueYellow[i]  = { toWeights(blueYellow[i], 1.0), int(blueYellow[i].size() / 2) };
+			mCsfBlueYellowV[i] = { toWeights(blueYellow[i], (i == 0 ? share0 : share1) / (share0 + share1)), int(blueYellow[i].size() / 2) };
+		}
+
+		// Feature detectors:  the first and second derivative of a Gaussian across, the Gaussian along
+		const double featureSigma = 0.5 * 0.082 * ppd;
+		const int featureRadius = std::min(int(std::ceil(3.0 * featureSigma)), kMaxConvolveRadius);
+		std::vector<double> g = gaussian(featureSigma, featureRadius), edge(g.size()), point(g.size());
+		for (int x = -featureRadius; x <= featureRadius; x++)
+		{
+			edge[x + featureRadius]  = -x * g[x + featureRadius];
+			point[x + featureRadius] = (x * x / (featureSigma * featureSigma) - 1.0) * g[x + featureRadius];
+		}
+		mFeatureGaussian = { toWeights(g, 1.0 / sum(g)), featureRadius };
+		mFeatureEdge     = { toWeights(normalizeSigned(edge), 1.0), featureRadius };
+		mFeaturePoint    = { toWeights(normalizeSigned(point), 1.0), featureRadius };
+
+		const std::vector<double> window = gaussian(1.5, 5);
+		mSsimWindow = { toWeights(window, 1.0 / sum(window)), 5 };
+
+		// The largest color difference, green against blue
+		const double green[3] = { 0.0, 1.0, 0.0 }, blue[3] = { 0.0, 0.0, 1.0 };
+		double greenLab[3], blueLab[3];
+		rgbToHuntLab(green, greenLab);
+		rgbToHuntLab(blue, blueLab);
+		const double hyab = std::abs(greenLab[0] - blueLab[0]) + std::hypot(greenLab[1] - blueLab[1], greenLab[2] - blueLab[2]);
+		mFlipCMax = float(std::pow(hyab, 0.7));
+	}
+
+	void MetricsEvaluator::convolve(const Filter &filter, bool vertical, const float *pIn, const float *pInScale, float *pOut, int y0, int y1, int height, bool accumulate) const
+	{
+		ConvolveSimdArgs args;
+		args.pIn        = pIn;
+		args.pInScale   = pInScale;
+		args.pOut       = pOut;
+		args.width      = int(mRowPlanes.getWidth());
+		args.height     = height;
+		args.stride     = int(mRowPlanes.getStride());
+		args.pWeights   = filter.weights.data();
+		args.radius     = filter.radius;
+		args.vertical   = vertical;
+		args.accumulate = accumulate;
+		args.y0         = y0;
+		args.y1         = y1;
+		mConvolve(args);
+	}
+
+	MetricsSimdSums MetricsEvaluator::analyse(const ImageF4 &image, const MetricsReference *pReference, MetricsSequence *pSequence, MetricsReference *pPrepare)
+	{
+		const uint32_t width = image.getWidth(), height = image.getHeight();
+		if (mRowPlanes.getWidth() != width || mRowPlanes.getHeight() != height) mRowPlanes.resize(width, height, kRowPlaneCount);
+		const size_t stride = mRowPlanes.getStride();
+
+		const MetricsReference &reference = pReference ? *pReference : *pPrepare;
+		auto refPlane = [&](uint32_t plane, int y) { return const_cast<float *>(reference.mPlanes.getPlane(plane)) + y * stride; };
+		auto rowPlane = [&](uint32_t plane, int y) { return mRowPlanes.getPlane(plane) + y * stride; };
+
+		std::vector<MetricsSimdSums> sums((height + kBandHeight - 1) / kBandHeight);
+
+		// First pass:  the display image's opponent colors, luminance and luma per band, filtered along the rows
+		forEachRowBand(*mpThreadPool, height, kBandHeight, [&](int y0, int y1)
+		{
+			PlanarImage &band = getBandPlanes(width);
+			const int rows = y1 - y0;
+
+			float *pColor[3];
+			for (uint32_t c = 0; c < 3; c++) pColor[c] = pPrepare ? refPlane(kRefR + c, y0) : band.getPlane(kBandR + c);
+			for (int row = 0; row < rows; row++)
+			{
+				const float4 *pSrc = &image.at(0, y0 + row);
+				float *pR = pColor[0] + row * stride, *pG = pColor[1] + row * stride, *pB = pColor[2] + row * stride;
+				for (uint32_t x = 0; x < width; x++)
+				{
+					pR[x] = pSrc[x].x;
+					pG[x] = pSrc[x].y;
+					pB[x] = pSrc[x].z;
+				}
+			}
+
+			MetricsSimdArgs args;
+			args.stage         = MetricsSimdStage::Prepare;
+			args.width         = int(width);
+			args.rowCount      = rows;
+			args.stride        = int(stride);
+			args.pSums         = &sums[y0 / kBandHeight];
+			args.exposure      = mSettings.exposure;
+			args.relMseEpsilon = mSettings.relMseEpsilon;
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				args.pColor[c]    = pColor[c];
+				args.pOpponent[c] = band.getPlane(kBandOppY + c);
+				if (pReference) args.pRefColor[c] = refPlane(kRefR + c, y0);
+			}
+			args.pLuminance = band.getPlane(kBandLuminance);
+			args.pLuma      = pPrepare ? refPlane(kRefLuma, y0) : band.getPlane(kBandLuma);
+			if (pReference)
+			{
+				args.pRefLuma        = refPlane(kRefLuma, y0);
+				args.pPrevDifference = pSequence->mPrevDifference.getPlane(0) + y0 * stride;
+				args.hasPrevious     = pSequence->mHasPrevious;
+			}
+			mMetrics(args);
+
+			convolve(mCsfLuminance,    false, band.getPlane(kBandOppY),  nullptr, rowPlane(kRowOppY, y0),  0, rows, rows);
+			convolve(mCsfRedGreen,     false, band.getPlane(kBandOppCx), nullptr, rowPlane(kRowOppCx, y0), 0, rows, rows);
+			convolve(mCsfBlueYellow[0], false, band.getPlane(kBandOppCz), nullptr, rowPlane(kRowOppCz0, y0), 0, rows, rows);
+			convolve(mCsfBlueYellow[1], false, band.getPlane(kBandOppCz), nullptr, rowPlane(kRowOppCz1, y0), 0, rows, rows);
+			convolve(mFeatureGaussian, false, band.getPlane(kBandLuminance), nullptr, rowPlane(kRowGaussian, y0), 0, rows, rows);
+			convolve(mFeatureEdge,     false, band.getPlane(kBandLuminance), nullptr, rowPlane(kRowEdge, y0),     0, rows, rows);
+			convolve(mFeaturePoint,    false, band.getPlane(kBandLuminance), nullptr, rowPlane(kRowPoint, y0),    0, rows, rows);
+			convolve(mSsimWindow,      false, args.pLuma, nullptr,    rowPlane(kRowLuma, y0),  0, rows, rows);
+			convolve(mSsimWindow,      false, args.pLuma, args.pLuma, rowPlane(kRowLuma2, y0), 0, rows, rows);
+			if (pReference) convolve(mSsimWindow, false, args.pLuma, args.pRefLuma, rowPlane(kRowLumaCross, y0), 0, rows, rows);
+		});
+
+		// Second pass:  filtered along the columns into the band, then compared or kept as the reference
+		forEachRowBand(*mpThreadPool, height, kBandHeight, [&](int y0, int y1)
+		{
+			PlanarImage &band = getBandPlanes(width);
+			const int h = int(height);
+
+			convolve(mCsfLuminance,      true, rowPlane(kRowOppY, 0),   nullptr, band.getPlane(kBandFilteredY),  y0, y1, h);
+			convolve(mCsfRedGreen,       true, rowPlane(kRowOppCx, 0),  nullptr, band.getPlane(kBandFilteredCx), y0, y1, h);
+			convolve(mCsfBlueYellowV[0], true, rowPlane(kRowOppCz0, 0), nullptr, band.getPlane(kBandFilteredCz), y0, y1, h);
+			convolve(mCsfBlueYellowV[1], true, rowPlane(kRowOppCz1, 0), nullptr, band.getPlane(kBandFilteredCz), y0, y1, h, true);
+			convolve(mFeatureGaussian,   true, rowPlane(kRowEdge, 0),     nullptr, band.getPlane(kBandEdgeX),  y0, y1, h);
+			convolve(mFeatureEdge,       true, rowPlane(kRowGaussian, 0), nullptr, band.getPlane(kBandEdgeY),  y0, y1, h);
+			convolve(mFeatureGaussian,   true, rowPlane(kRowPoint, 0),    nullptr, band.getPlane(kBandPointX), y0, y1, h);
+			convolve(mFeaturePoint,      true, rowPlane(kRowGaussian, 0), nullptr, band.getPlane(kBandPointY), y0, y1, h);
+
+			MetricsSimdArgs args;
+			args.stage    = pReference ? MetricsSimdStage::Compare : MetricsSimdStage::FinishReference;
+			args.width    = int(width);
+			args.rowCount = y1 - y0;
+			args.stride   = int(stride);
+			args.pSums    = &sums[y0 / kBandHeight];
+			args.flipCMax = mFlipCMax;
+			for (uint32_t c = 0; c < 3; c++) args.pFiltered[c] = band.getPlane(kBandFilteredY + c);
+			for (uint32_t k = 0; k < 4; k++) args.pFeatures[k] = band.getPlane(kBandEdgeX + k);
+
+			if (pReference)
+			{
+				convolve(mSsimWindow, true, rowPlane(kRowLuma, 0),      nullptr, band.getPlane(kBandMeanLuma),  y0, y1, h);
+				convolve(mSsimWindow, true, rowPlane(kRowLuma2, 0),     nullptr, band.getPlane(kBandMeanLuma2), y0, y1, h);
+				convolve(mSsimWindow, true, rowPlane(kRowLumaCross, 0), nullptr, band.getPlane(kBandMeanCross), y0, y1, h);
+				for (uint32_t c = 0; c < 3; c++) args.pRefLab[c] = refPlane(kRefLabL + c, y0);
+				for (uint32_t k = 0; k < 2; k++) args.pRefFeatureMagnitude[k] = refPlane(kRefEdge + k, y0);
+				for (uint32_t k = 0; k < 3; k++) args.pMoments[k] = band.getPlane(kBandMeanLuma + k);
+				for (uint32_t k = 0; k < 2; k++) args.pRefMoments[k] = refPlane(kRefMeanLuma + k, y0);
+			}
+			else
+			{
+				convolve(mSsimWindow, true, rowPlane(kRowLuma, 0),  nullptr, refPlane(kRefMeanLuma, y0),  y0, y1, h);
+				convolve(mSsimWindow, true, rowPlane(kRowLuma2, 0), nullptr, refPlane(kRefMeanLuma2, y0), y0, y1, h);
+				for (uint32_t c = 0; c < 3; c++) args.pLab[c] = refPlane(kRefLabL + c, y0);
+				for (uint32_t k = 0; k < 2; k++) args.pFeatureMagnitude[k] = refPlane(kRefEdge + k, y0);
+			}
+			mMetrics(args);
+		});
+
+		MetricsSimdSums total;
+		for (const MetricsSimdSums &band : sums)
+		{
+			total.squaredError    += band.squaredError;
+			total.relSquaredError += band.relSquaredError;
+			total.flicker         += band.flicker;
+			total.flip            += band.flip;
+			total.ssim            += band.ssim;
+		}
+		return total;
+	}
+
+	void MetricsEvaluator::prepareReference(const ImageF4 &image, MetricsReference &reference)
+	{
+		PlanarImage &planes = reference.mPlanes;
+		if (planes.getWidth() != image.getWidth() || planes.getHeight() != image.getHeight())
+			planes.resize(image.getWidth(), image.getHeight(), kReferencePlaneCount);
+		if (!image.empty()) analyse(image, nullptr, nullptr, &reference);
+	}
+
+	bool MetricsEvaluator::evaluate(const ImageF4 &image, const MetricsReference &reference, MetricsSequence &sequence, FrameMetrics &metrics)
+	{
+		if (image.getWidth() != reference.getWidth() || image.getHeight() != reference.getHeight()) return false;
+		metrics = FrameMetrics();
+		if (image.empty()) return true;
+
+		PlanarImage &prevDifference = sequence.mPrevDifference;
+		if (prevDifference.getWidth() != image.getWidth() || prevDifference.getHeight() != image.getHeight())
+		{
+			prevDifference.resize(image.getWidth(), image.getHeight(), 1);
+			sequence.mHasPrevious = false;
+		}
+
+		const MetricsSimdSums sums = analyse(image, &reference, &sequence, nullptr);
+		const double pixels = double(image.getPixelCount());
+		metrics.rmse    = std::sqrt(sums.squaredError / (3.0 * pixels));
+		metrics.relMse  = sums.relSquaredError / (3.0 * pixels);
+		metrics.ssim    = sums.ssim / pixels;
+		metrics.flip    = sums.flip / pixels;
+		metrics.flicker = sequence.mHasPrevious ? std::sqrt(sums.flicker / pixels) : 0.0;
+		sequence.mHasPrevious = true;
+		return true;
+	}
+
+	bool MetricsEvaluator::evaluate(const ImageF4 &image, const ImageF4 &reference, FrameMetrics &metrics)
+	{
+		if (image.getWidth() != reference.getWidth() || image.getHeight() != reference.getHeight()) return false;
+		prepareReference(reference, mReference);
+		return evaluate(image, mReference, metrics);
+	}
+}
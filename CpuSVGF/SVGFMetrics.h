@@ -0,0 +1,160 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Image quality and temporal stability metrics of a frame sequence against a reference sequence, for trading the
+//     filter's cost against its quality
+
+#pragma once
+#include "SVGFPlanar.h"
+#include "SVGFSimd.h"
+
+namespace CpuSVGF
+{
+	/** Quality of one frame against its reference.  RMSE and relMSE are of the linear rgb values; the others are of
+	    the display image, the colors scaled by the exposure and clamped to [0, 1] like SimpleToneMappingPass' Clamp
+	    operator, and sRGB encoded where the metric wants perceptually uniform values.
+	*/
+	struct FrameMetrics
+	{
+		double rmse    = 0.0;
+		double relMse  = 0.0;   ///< Mean of (a - b)^2 / (b^2 + 0.01) over the rgb values, b being the reference
+		double ssim    = 1.0;   ///< Mean SSIM of the sRGB encoded luminance; 1 is identical
+		double flip    = 0.0;   ///< Mean FLIP-style perceptual error, in [0, 1]; 0 is identical
+		double flicker = 0.0;   ///< RMS of the frame to frame change of the sRGB encoded luminance that the reference
+		                        ///  doesn't have; 0 for the first frame of a sequence
+	};
+
+	/** The analysis of one reference frame that MetricsEvaluator compares images against.  Comparing several images
+	    (e.g. filter settings) against the same reference prepares it once.
+	*/
+	class MetricsReference
+	{
+	public:
+		uint32_t getWidth() const  { return mPlanes.getWidth(); }
+		uint32_t getHeight() const { return mPlanes.getHeight(); }
+
+	private:
+		friend class MetricsEvaluator;
+		PlanarImage mPlanes;
+	};
+
+	/** What flicker is measured against:  the previous frame of a sequence.  MetricsEvaluator keeps one for evaluate()
+	    without a sequence; measuring several sequences at once (e.g. one per filter setting) needs one each.
+	*/
+	class MetricsSequence
+	{
+	public:
+		/** Start over:  the next frame has no previous frame to measure flicker against
+		*/
+		void reset() { mHasPrevious = false; }
+
+	private:
+		friend class MetricsEvaluator;
+		PlanarImage mPrevDifference;   ///< Luma of the previous frame minus its reference's
+		bool        mHasPrevious = false;
+	};
+
+	/** Computes FrameMetrics on a thread pool with the vectorized kernels of SVGFSimd.h.  Every metric is computed in
+	    two passes over bands of rows:  the first converts the image and runs the horizontal halves of the separable
+	    filters, the second runs the vertical halves and the per-pixel comparison, without writing the vertical
+	    results out.
+
+	    SSIM uses an 11x11 Gaussian window with a standard deviation of 1.5 pixels and the usual constants for values in
+	    [0, 1].  The FLIP-style error follows LDR-FLIP (Andersson et al. 2020):  the contrast sensitivity filters in
+	    YCxCz, the HyAB distance of Hunt-adjusted L*a*b* colors, and edge and point features of the luminance.  Its
+	    filters are separable sums of Gaussians, each cut off at 4 standard deviations instead of at the widest
+	    filter's radius, which changes the result by about 1e-7.  Every filter clamps its taps to the image.
+	*/
+	class MetricsEvaluator
+	{
+	public:
+		using SharedPtr = std::shared_ptr<MetricsEvaluator>;
+
+		struct Settings
+		{
+			float   exposure        = 1.0f;     ///< Scale applied to the colors before clamping them for display
+			float   pixelsPerDegree = 67.0f;    ///< Viewing distance for FLIP:  a 0.7 m wide 4K display seen from 0.7 m
+			float   relMseEpsilon   = 1e-2f;
+			SimdIsa simdIsa         = detectSimdIsa();
+		};
+
+		/** Runs on pThreadPool, or on a pool of its own if it's nullptr
+		*/
+		static SharedPtr create(const Settings &settings, CpuThreadPool::SharedPtr pThreadPool = nullptr);
+
+		const Settings &getSettings() const { return mSettings; }
+
+		/** Analyse a reference frame for evaluate()
+		*/
+		void prepareReference(const ImageF4 &image, MetricsReference &reference);
+
+		/** Measure image against reference.  Calls between resetSequence() are consecutive frames of a sequence, and
+		    the flicker of each is measured against the call before it.  Returns false if the sizes differ.
+		*/
+		bool evaluate(const ImageF4 &image, const MetricsReference &reference, FrameMetrics &metrics) { return evaluate(image, reference, mSequence, metrics); }
+
+		/** Measure image against reference as the next frame of sequence
+		*/
+		bool evaluate(const ImageF4 &image, const MetricsReference &reference, MetricsSequence &sequence, FrameMetrics &metrics);
+
+		/** Prepare reference and measure image against it
+		*/
+		bool evaluate(const ImageF4 &image, const ImageF4 &reference, FrameMetrics &metrics);
+
+		/** Start a new sequence:  the next frame has no previous frame to measure flicker against
+		*/
+		void resetSequence() { mSequence.reset(); }
+
+	private:
+		MetricsEvaluator(const Settings &settings, CpuThreadPool::SharedPtr pThreadPool);
+
+		/** Taps of a 1D filter
+		*/
+		struct Filter
+		{
+			std::vector<float> weights;
+			int                radius = 0;
+		};
+
+		/** Both passes over image:  comparing it with pReference as the next frame of pSequence, or analysing it into
+		    pPrepare.  Returns the sums of every band of rows, added up in order.
+		*/
+		MetricsSimdSums analyse(const ImageF4 &image, const MetricsReference *pReference, MetricsSequence *pSequence, MetricsReference *pPrepare);
+
+		/** One pass of filter over rows [y0, y1) of a plane of height rows laid out like mRowPlanes.  Output row y goes
+		    to pOut + (y - y0) * stride.
+		*/
+		void convolve(const Filter &filter, bool vertical, const float *pIn, const float *pInScale, float *pOut, int y0, int y1, int height, bool accumulate = false) const;
+
+		Settings                 mSettings;
+		CpuThreadPool::SharedPtr mpThreadPool;
+		ConvolveSimdFunc         mConvolve = nullptr;
+		MetricsSimdFunc          mMetrics = nullptr;
+
+		Filter                   mCsfLuminance, mCsfRedGreen;
+		Filter                   mCsfBlueYellow[2];     ///< Both terms of the blue-yellow filter; the vertical taps are
+		Filter                   mCsfBlueYellowV[2];    ///  scaled by each term's share of the 2D filter
+		Filter                   mFeatureGaussian, mFeatureEdge, mFeaturePoint;
+		Filter                   mSsimWindow;
+		float                    mFlipCMax = 1.0f;
+
+		PlanarImage              mRowPlanes;            ///< Results of the horizontal passes
+		MetricsSequence          mSequence;             ///< For evaluate() without a sequence
+		MetricsReference         mReference;            ///< For evaluate() with an image as reference
+	};
+}
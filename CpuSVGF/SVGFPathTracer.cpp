@@ -0,0 +1,539 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFPathTracer.h"
+#include "SVGFSampler.h"
+#include "SVGFSyntheticFrames.h"
+#include <atomic>
+#include <chrono>
+
+namespace CpuSVGF
+{
+	namespace {
+		const float kPi = 3.14159265f;
+
+		/** What simplePrepareShadingData() / prepareShadingData() return for a hit, reduced to what the GI pass reads
+		*/
+		struct HitShading
+		{
+			float3 posW;
+			float3 N;
+			float3 diffuse;
+			float3 specular;
+			float  linearRoughness;
+		};
+
+		HitShading getHitShadingData(const Scene &scene, const RayHit &hit, const float3 &camPosW)
+		{
+			const float3 *p = scene.getPositions(hit.triangle);
+			const TriangleAttributes &attribs = scene.getAttributes(hit.triangle);
+			const SceneMaterial &material = scene.getMaterial(attribs.materialId);
+			const float w = 1.0f - hit.u - hit.v;
+
+			HitShading sd;
+			sd.posW = p[0] * w + p[1] * hit.u + p[2] * hit.v;
+			sd.N = normalize(attribs.normals[0] * w + attribs.normals[1] * hit.u + attribs.normals[2] * hit.v);
+			sd.diffuse = material.diffuse;
+			sd.specular = material.specular;
+			sd.linearRoughness = material.linearRoughness;
+			if (material.pDiffuseTexture || material.pSpecularTexture)
+			{
+				const float2 uv = scene.getTexCoords(hit.triangle, hit.u, hit.v);
+				if (material.pDiffuseTexture) sd.diffuse = material.pDiffuseTexture->sample(uv).rgb();
+				if (material.pSpecularTexture)
+				{
+					const float4 specGloss = material.pSpecularTexture->sample(uv);
+					sd.specular = specGloss.rgb();
+					sd.linearRoughness = 1.0f - specGloss.w;
+				}
+			}
+			sd.linearRoughness = std::max(0.08f, sd.linearRoughness);
+
+			// Flip the normal if it's backfacing
+			float NdotV = dot(sd.N, normalize(camPosW - sd.posW));
+			if (NdotV <= 0.0f && material.doubleSided) sd.N = -sd.N;
+			return sd;
+		}
+
+		// Ports of the sampling and BRDF helpers in ggxGlobalIlluminationUtils.hlsli
+
+		float3 getPerpendicularVector(const float3 &u)
+		{
+			float3 a = float3(std::abs(u.x), std::abs(u.y), std::abs(u.z));
+			uint32_t xm = ((a.x - a.y) < 0 && (a.x - a.z) < 0) ? 1 : 0;
+			uint32_t ym = (a.y - a.z) < 0 ? (1 ^ xm) : 0;
+			uint32_t zm = 1 ^ (xm | ym);
+			return cross(u, float3(float(xm), float(ym), float(zm)));
+		}
+
+		float3 getCosHemisphereSample(const float2 &randVal, const float3 &hitNorm)
+		{
+			float3 bitangent = getPerpendicularVector(hitNorm);
+			float3 tangent = cross(bitangent, hitNorm);
+			float r = std::sqrt(randVal.x);
+			float phi = 2.0f * kPi * randVal.y;
+			return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + hitNorm * std::sqrt(std::max(0.0f, 1.0f - randVal.x));
+		}
+
+		float ggxNormalDistribution(float NdotH, float roughness)
+		{
+			float a2 = roughness * roughness;
+			float d = ((NdotH * a2 - NdotH) * NdotH + 1);
+			return a2 / std::max(0.001f, d * d * kPi);
+		}
+
+		float ggxSmithMaskingTerm(float NdotL, float NdotV, float roughness)
+		{
+			float a2 = roughness * roughness;
+			float lambdaV = NdotL * std::sqrt(std::max(0.0f, (-NdotV * a2 + NdotV) * NdotV + a2));
+			float lambdaL = NdotV * std::sqrt(std::max(0.0f, (-NdotL * a2 + NdotL) * NdotL + a2));
+			return 0.5f / (lambdaV + lambdaL);
+		}
+
+		float3 schlickFresnel(const float3 &f0, float u)
+		{
+			return f0 + (float3(1.0f) - f0) * std::pow(1.0f - u, 5.0f);
+		}
+
+		float3 getGGXColor(const float3 &V, const float3 &L, const float3 &N, float NdotV, const float3 &specColor, float roughness, bool evalDirect)
+		{
+			float3 H = normalize(V + L);
+			float NdotL = saturate(dot(N, L));
+			float NdotH = saturate(dot(N, H));
+			float LdotH = saturate(dot(L, H));
+
+			float D = ggxNormalDistribution(NdotH, roughness);
+			float G = ggxSmithMaskingTerm(NdotL, NdotV, roughness) * 4 * NdotL;
+			float3 F = schlickFresnel(specColor, LdotH);
+
+			float3 outColor = evalDirect ? F * (G * D * NdotV) : F * (G * LdotH / std::max(0.001f, NdotH));
+			return (NdotV * NdotL * LdotH <= 0.0f) ? float3(0.0f) : outColor;
+		}
+
+		float3 getGGXSampleDir(const float2 &randVal, float roughness, const float3 &hitNorm, const float3 &inVec)
+		{
+			float3 B = getPerpendicularVector(hitNorm);
+			float3 T = cross(B, hitNorm);
+
+			float a2 = roughness * roughness;
+			float cosThetaH = std::sqrt(std::max(0.0f, (1.0f - randVal.x) / ((a2 - 1.0f) * randVal.x + 1.0f)));
+			float sinThetaH = std::sqrt(std::max(0.0f, 1.0f - cosThetaH * cosThetaH));
+			float phiH = randVal.y * kPi * 2.0f;
+
+			float3 H = T * (sinThetaH * std::cos(phiH)) + B * (sinThetaH * std::sin(phiH)) + hitNorm * cosThetaH;
+			return normalize(H * (2.0f * dot(inVec, H)) - inVec);
+		}
+
+		/** Density per unit solid angle with which getGGXSampleDir() returns L:  D(H) (N.H) / (4 (L.H))
+		*/
+		float getGGXSamplePdf(const float3 &V, const float3 &L, const float3 &N, float roughness)
+		{
+			float3 H = normalize(V + L);
+			float NdotH = saturate(dot(N, H));
+			float LdotH = saturate(dot(L, H));
+			return LdotH > 0.0f ? ggxNormalDistribution(NdotH, roughness) * NdotH / (4.0f * LdotH) : 0.0f;
+		}
+
+		float probabilityToSampleDiffuse(const float3 &difColor, const float3 &specColor)
+		{
+			float lumDiffuse = std::max(0.01f, luminance(difColor));
+			float lumSpecular = std::max(0.01f, luminance(specColor));
+			return lumDiffuse / (lumDiffuse + lumSpecular);
+		}
+
+		/** getLightData():  evalDirectionalLight() / evalPointLight() with an inverse square falloff and a spot cone
+		*/
+		void getLightData(const SceneLight &light, const float3 &hitPos, float3 &toLight, float3 &lightIntensity, float &distToLight)
+		{
+			if (light.type == SceneLightType::Directional)
+			{
+				toLight = normalize(-light.dirW);
+				lightIntensity = light.intensity;
+				distToLight = 1e30f;
+				return;
+			}
+
+			float3 L = light.posW - hitPos;
+			float  distSquared = std::max(1e-8f, dot(L, L));
+			distToLight = std::sqrt(distSquared);
+			toLight = L / distToLight;
+
+			float falloff = 1.0f / distSquared;
+			if (light.openingAngle < kPi)
+			{
+				float angle = std::acos(std::min(1.0f, std::max(-1.0f, -dot(toLight, normalize(light.dirW)))));
+				if (angle > light.openingAngle) falloff = 0.0f;
+				else if (light.penumbraAngle > 0.0f) falloff *= saturate((light.openingAngle - angle) / light.penumbraAngle);
+			}
+			lightIntensity = light.intensity * falloff;
+		}
+
+		bool isNan(const float3 &v) { return std::isnan(v.x) || std::isnan(v.y) || std::isnan(v.z); }
+
+		/** The camera of one frame; u / v / w as in Falcor's CameraData
+		*/
+		struct FrameCamera
+		{
+			float3 posW, u, v, w, fwd;
+
+			FrameCamera(const SceneCamera &camera, float pan, float aspect)
+			{
+				camera.getBasis(aspect, u, v, w);
+				posW = camera.posW + normalize(u) * pan;
+				fwd = normalize(w);
+			}
+
+			float3 rayDir(float s, float t) const
+			{
+				return normalize(u * (2.0f * s - 1.0f) + v * (1.0f - 2.0f * t) + w);
+			}
+
+			float2 project(const float3 &p, float &depth) const
+			{
+				float3 d = p - posW;
+				depth = dot(d, fwd);
+				float3 un = normalize(u), vn = normalize(v);
+				float px = dot(d, un) / depth / length(u);
+				float py = dot(d, vn) / depth / length(v);
+				return float2((px + 1.0f) * 0.5f, (1.0f - py) * 0.5f);
+			}
+		};
+	};
+
+	CpuPathTracer::SharedPtr CpuPathTracer::create(TriangleBvh::SharedPtr pBvh, uint32_t width, uint32_t height, CpuThreadPool::SharedPtr pThreadPool)
+	{
+		if (!pBvh || width == 0 || height == 0) return nullptr;
+		return SharedPtr(new CpuPathTracer(pBvh, width, height, pThreadPool ? pThreadPool : CpuThreadPool::create()));
+	}
+
+	CpuPathTracer::CpuPathTracer(TriangleBvh::SharedPtr pBvh, uint32_t width, uint32_t height, CpuThreadPool::SharedPtr pThreadPool)
+		: mpBvh(pBvh), mWidth(width), mHeight(height), mpThreadPool(pThreadPool)
+	{
+		mWorldPos.resize(width, height);
+		mWorldNorm.resize(width, height);
+		for (ImageF4 *pImage : { &mDirectIllum, &mIndirectIllum, &mLinearZ, &mMotionVecs, &mCompactNormDepth, &mDirAlbedo, &mIndirAlbedo })
+			pImage->resize(width, height);
+
+		mInputs.directIllum   = &mDirectIllum;
+		mInputs.indirectIllum = &mIndirectIllum;
+		mInputs.linearZ       = &mLinearZ;
+		mInputs.motionVecs    = &mMotionVecs;
+		mInputs.miscBuf       = &mCompactNormDepth;
+		mInputs.dirAlbedo     = &mDirAlbedo;
+		mInputs.indirAlbedo   = &mIndirAlbedo;
+	}
+
+	const FrameInputs &CpuPathTracer::renderFrame(uint32_t frameIndex)
+	{
+		using Clock = std::chrono::steady_clock;
+		Clock::time_point start = Clock::now();
+
+		const Scene &scene = *mpBvh->getScene();
+		const TriangleBvh &bvh = *mpBvh;
+		const std::vector<SceneLight> &lights = scene.getLights();
+		const int lightsCount = int(lights.size());
+		const uint32_t spp = std::max(1u, mSettings.samplesPerPixel);
+		const float minT = mSettings.minT;
+		const bool doDirectGI = mSettings.doDirectGI && lightsCount > 0;
+		const bool doIndirectGI = mSettings.doIndirectGI;
+		const bool powerLightSelection = mSettings.lightSelection == LightSelection::Power;
+		if (doDirectGI && powerLightSelection) mLightTable.update(lights);
+		if (doIndirectGI && mSettings.envMapSampling && !mEnvSamplerChecked)
+		{
+			mpEnvSampler = EnvMapSampler::create(scene.getEnvironmentMap(), mpThreadPool);
+			mEnvSamplerChecked = true;
+		}
+		const EnvMapSampler *pEnvSampler = mSettings.envMapSampling ? mpEnvSampler.get() : nullptr;
+
+		const float aspect = float(mWidth) / float(mHeight);
+		const FrameCamera camera(scene.getCamera(), mSettings.cameraPan * float(frameIndex), aspect);
+		const FrameCamera prevCamera(scene.getCamera(), mSettings.cameraPan * float(frameIndex > 0 ? frameIndex - 1 : 0), aspect);
+		const float2 invSize = float2(1.0f / float(mWidth), 1.0f / float(mHeight));
+
+		std::atomic<uint64_t> primaryRays(0), shadowRays(0), indirectRays(0);
+
+		// Rays are generated and shaded a tile at a time, so they can be traced in packets.  Even the bounces of a tile
+		//    start from nearby points, which makes plain packets faster than sorting them (see intersectStream()).
+		//    Both modes find the same hits.
+		const bool packets = mSettings.packetTraversal;
+		const SimdIsa isa = mSettings.simdIsa;
+		auto traceClosest = [&](const std::vector<Ray> &rays, std::vector<RayHit> &hits, std::vector<uint8_t> &found)
+		{
+			const uint32_t count = uint32_t(rays.size());
+			if (!packets)
+			{
+				for (uint32_t i = 0; i < count; i++) found[i] = bvh.intersect(rays[i], hits[i]) ? 1 : 0;
+			}
+			else bvh.intersectPacket(rays.data(), count, hits.data(), found.data(), isa);
+		};
+		auto traceOccluded = [&](const std::vector<Ray> &rays, std::vector<uint8_t> &occluded)
+		{
+			const uint32_t count = uint32_t(rays.size());
+			if (!packets)
+			{
+				for (uint32_t i = 0; i < count; i++) occluded[i] = bvh.occluded(rays[i]) ? 1 : 0;
+			}
+			else bvh.occludedPacket(rays.data(), count, occluded.data(), isa);
+		};
+
+		/** A pixel whose primary ray hit, and its sums over the samples
+		*/
+		struct PixelState
+		{
+			int        x, y;
+			HitShading sd;
+			float      roughness;
+			float3     toCamera;
+			float      NdotV;
+			float3     directSum = float3(0.0f), directAlbedoSum = float3(0.0f), indirectSum = float3(0.0f);
+			float3     indirAlbedo = float3(1.0f);
+		};
+
+		/** What a sample needs once its shadow and indirect rays are traced
+		*/
+		struct SampleState
+		{
+			float3 lightIntensity;
+			float  lightInvPdf;
+			float  NdotL;
+			float3 directAlbedo;
+			float  probDiffuse;
+			bool   chooseDiffuse;
+			bool   chooseEnvMap;
+		};
+
+		// Pass 1:  G-buffer from the primary hit, then spp samples of SimpleDiffuseGIRayGen()
+		mpThreadPool->forEachTile(mWidth, mHeight, std::max(1u, mSettings.tileSize), [&](const TileRect &tile)
+		{
+			const uint32_t tileWidth = uint32_t(tile.x1 - tile.x0);
+			const uint32_t pixelCount = tileWidth * uint32_t(tile.y1 - tile.y0);
+			uint64_t tileShadowRays = 0, tileIndirectRays = 0;
+
+			std::vector<Ray>     rays(pixelCount);
+			std::vector<RayHit>  hits(pixelCount);
+			std::vector<uint8_t> found(pixelCount);
+			for (uint32_t i = 0; i < pixelCount; i++)
+			{
+				const int x = tile.x0 + int(i % tileWidth), y = tile.y0 + int(i / tileWidth);
+				rays[i].origin = camera.posW;
+				rays[i].dir = camera.rayDir((float(x) + 0.5f) * invSize.x, (float(y) + 0.5f) * invSize.y);
+			}
+			traceClosest(rays, hits, found);
+
+			std::vector<PixelState> pixels;
+			pixels.reserve(pixelCount);
+			for (uint32_t i = 0; i < pixelCount; i++)
+			{
+				const int x = tile.x0 + int(i % tileWidth), y = tile.y0 + int(i / tileWidth);
+				if (!found[i])
+				{
+					// Background, as written by clearGBuffer.ps.hlsl and the GI pass' miss path
+					mWorldPos.at(x, y)         = float3(0.0f);
+					mWorldNorm.at(x, y)        = float3(0.0f);
+					mLinearZ.at(x, y)          = float4(0.0f);
+					mMotionVecs.at(x, y)       = float4(0.0f);
+					mCompactNormDepth.at(x, y) = float4(0.0f, -1.0f, 0.0f, 0.0f);
+					mDirectIllum.at(x, y)      = float4(scene.evalEnvironment(rays[i].dir), 1.0f);
+					mIndirectIllum.at(x, y)    = float4(0.0f, 0.0f, 0.0f, 1.0f);
+					mDirAlbedo.at(x, y)        = float4(1.0f);
+					mIndirAlbedo.at(x, y)      = float4(1.0f);
+					continue;
+				}
+
+				PixelState pixel;
+				pixel.x = x;
+				pixel.y = y;
+				pixel.sd = getHitShadingData(scene, hits[i], camera.posW);
+				pixel.roughness = pixel.sd.linearRoughness * pixel.sd.linearRoughness;
+				pixel.toCamera = normalize(camera.posW - pixel.sd.posW);
+				pixel.NdotV = dot(pixel.sd.N, pixel.toCamera);
+				pixels.push_back(pixel);
+			}
+
+			const uint32_t hitCount = uint32_t(pixels.size());
+			std::vector<SampleState> samples(hitCount);
+			std::vector<Ray>         shadowRayBatch(doDirectGI ? hitCount : 0), indirectRayBatch(doIndirectGI ? hitCount : 0);
+			std::vector<uint8_t>     occluded(shadowRayBatch.size()), bounceFound(indirectRayBatch.size());
+			std::vector<RayHit>      bounceHits(indirectRayBatch.size());
+			for (uint32_t sample = 0; sample < spp && hitCount > 0; sample++)
+			{
+				// Draw the random numbers in the GPU pass' order and set up both rays of each pixel
+				for (uint32_t k = 0; k < hitCount; k++)
+				{
+					const PixelState &pixel = pixels[k];
+					const HitShading &sd = pixel.sd;
+					SampleState &state = samples[k];
+					SampleSequence sequence(mSettings.sampler, uint32_t(pixel.x), uint32_t(pixel.y), mWidth, 0x1337u + frameIndex * spp + sample, frameIndex * spp + sample);
+
+					if (doDirectGI)
+					{
+						int lightToSample;
+						if (powerLightSelection)
+						{
+							lightToSample = int(mLightTable.sample(sequence.next(), state.lightInvPdf));
+						}
+						else
+						{
+							lightToSample = std::min(int(sequence.next() * float(lightsCount)), lightsCount - 1);
+							state.lightInvPdf = float(lightsCount);
+						}
+
+						float distToLight;
+						float3 toLight;
+						getLightData(lights[lightToSample], sd.posW, toLight, state.lightIntensity, distToLight);
+						state.NdotL = saturate(dot(sd.N, toLight));
+
+						Ray &shadowRay = shadowRayBatch[k];
+						shadowRay.origin = sd.posW;
+						shadowRay.dir = toLight;
+						shadowRay.tMin = minT;
+						shadowRay.tMax = distToLight;
+
+						float3 ggxTerm = getGGXColor(pixel.toCamera, toLight, sd.N, pixel.NdotV, sd.specular, pixel.roughness, true);
+						state.directAlbedo = ggxTerm + sd.diffuse / kPi;
+					}
+
+					if (doIndirectGI)
+					{
+						state.probDiffuse = probabilityToSampleDiffuse(sd.diffuse, sd.specular);
+
+						// With environment sampling, the same number first picks between the map and the BRDF
+						float lobe = sequence.next();
+						state.chooseEnvMap = pEnvSampler && lobe < kEnvMapSampleProbability;
+						if (pEnvSampler && !state.chooseEnvMap) lobe = (lobe - kEnvMapSampleProbability) / (1.0f - kEnvMapSampleProbability);
+						state.chooseDiffuse = (lobe < state.probDiffuse);
+
+						float2 randVal;
+						randVal.x = sequence.next();
+						randVal.y = sequence.next();
+
+						Ray &indirectRay = indirectRayBatch[k];
+						indirectRay.origin = sd.posW;
+						float envPdf;
+						indirectRay.dir = state.chooseEnvMap  ? pEnvSampler->sample(randVal, envPdf)
+						                : state.chooseDiffuse ? getCosHemisphereSample(randVal, sd.N)
+						                                      : getGGXSampleDir(randVal, pixel.roughness, sd.N, pixel.toCamera);
+						indirectRay.tMin = minT;
+					}
+				}
+
+				if (doDirectGI)
+				{
+					traceOccluded(shadowRayBatch, occluded);
+					tileShadowRays += hitCount;
+				}
+				if (doIndirectGI)
+				{
+					traceClosest(indirectRayBatch, bounceHits, bounceFound);
+					tileIndirectRays += hitCount;
+				}
+
+				for (uint32_t k = 0; k < hitCount; k++)
+				{
+					PixelState &pixel = pixels[k];
+					const HitShading &sd = pixel.sd;
+					const SampleState &state = samples[k];
+
+					if (doDirectGI)
+					{
+						float visibility = occluded[k] ? 0.0f : 1.0f;
+						float shadowMult = state.lightInvPdf * visibility;
+
+						float3 directColor = state.lightIntensity * (shadowMult * state.NdotL);
+						if (!isNan(directColor) && !isNan(state.directAlbedo))
+						{
+							pixel.directSum = pixel.directSum + directColor;
+							pixel.directAlbedoSum = pixel.directAlbedoSum + state.directAlbedo;
+						}
+					}
+
+					if (doIndirectGI)
+					{
+						// shootIndirectRay():  the closest hit returns the hit's diffuse color, a miss the environment
+						const float3 &bounceDir = indirectRayBatch[k].dir;
+						float3 bounceColor = bounceFound[k] ? getHitShadingData(scene, bounceHits[k], camera.posW).diffuse
+						                                    : scene.evalEnvironment(bounceDir);
+
+						float  NdotL = saturate(dot(sd.N, bounceDir));
+						float3 difTerm = max(float3(5e-3f), sd.diffuse / kPi);
+						float3 ggxTerm = getGGXColor(pixel.toCamera, bounceDir, sd.N, pixel.NdotV, sd.specular, pixel.roughness, false) * NdotL;
+
+						float3 shadeColor;
+						if (pEnvSampler)
+						{
+							// One sample MIS (balance heuristic):  both lobes' integrands over the density of the mixture of
+							//    environment, diffuse and GGX sampling, whichever of the three picked the direction
+							float ggxPdf = getGGXSamplePdf(pixel.toCamera, bounceDir, sd.N, pixel.roughness);
+							float pdf = kEnvMapSampleProbability * pEnvSampler->evalPdf(bounceDir) +
+							            (1.0f - kEnvMapSampleProbability) * (state.probDiffuse * NdotL / kPi + (1.0f - state.probDiffuse) * ggxPdf);
+							float3 integrand = float3(NdotL / kPi) + ggxTerm * ggxPdf / difTerm;
+							shadeColor = pdf > 0.0f ? bounceColor * integrand / pdf : float3(0.0f);
+						}
+						else
+						{
+							float3 difFinal = float3(1.0f / state.probDiffuse);
+							float3 ggxFinal = ggxTerm / (difTerm * (1.0f - state.probDiffuse));
+							shadeColor = bounceColor * (state.chooseDiffuse ? difFinal : ggxFinal);
+						}
+
+						if (!isNan(shadeColor)) pixel.indirectSum = pixel.indirectSum + shadeColor;
+						pixel.indirAlbedo = difTerm;
+					}
+				}
+			}
+
+			for (const PixelState &pixel : pixels)
+			{
+				// G-buffer data, in the layout of gBufferSVGF.ps.hlsl
+				const int    x = pixel.x, y = pixel.y;
+				const float3 worldPos = pixel.sd.posW;
+				const float3 worldNorm = pixel.sd.N;
+				const float  s = (float(x) + 0.5f) * invSize.x;
+				const float  t = (float(y) + 0.5f) * invSize.y;
+				float prevDepth;
+				float2 prevUV = prevCamera.project(worldPos, prevDepth);
+				float  linearZ = dot(worldPos - camera.posW, camera.fwd);
+				float  octNorm = asfloat(dirToOct(worldNorm));
+				const float invSpp = 1.0f / float(spp);
+
+				mWorldPos.at(x, y)         = worldPos;
+				mWorldNorm.at(x, y)        = worldNorm;
+				mLinearZ.at(x, y)          = float4(linearZ, 0.0f, prevDepth, octNorm);
+				mMotionVecs.at(x, y)       = float4(prevUV.x - s, prevUV.y - t, 0.0f, 0.0f);
+				mCompactNormDepth.at(x, y) = float4(octNorm, linearZ, 0.0f, 0.0f);
+				mDirectIllum.at(x, y)      = float4(pixel.directSum * invSpp, 1.0f);
+				mIndirectIllum.at(x, y)    = float4(pixel.indirectSum * invSpp, 1.0f);
+				mDirAlbedo.at(x, y)        = float4(pixel.directAlbedoSum * invSpp, 1.0f);
+				mIndirAlbedo.at(x, y)      = float4(pixel.indirAlbedo, 1.0f);
+			}
+
+			primaryRays += pixelCount;
+			shadowRays += tileShadowRays;
+			indirectRays += tileIndirectRays;
+		});
+
+		// Pass 2:  screen-space derivatives
+		computeGBufferDerivatives(*mpThreadPool, mWorldPos, mWorldNorm, mLinearZ, mMotionVecs, mCompactNormDepth);
+
+		mStats.primaryRays  = primaryRays;
+		mStats.shadowRays   = shadowRays;
+		mStats.indirectRays = indirectRays;
+		mStats.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		return mInputs;
+	}
+}
@@ -0,0 +1,113 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// A multithreaded CPU port of GBufferForSVGF and GGXGlobalIlluminationPass (SimpleDiffuseGIRayGen):  renders a Scene
+//     into the seven channels SVGFPass reads, so the CPU filter can run on path traced frames and converged
+//     reference images can be rendered without a GPU.
+
+#pragma once
+#include "SVGFBvh.h"
+#include "SVGFEnvMapSampler.h"
+#include "SVGFLightSampler.h"
+#include "SVGFSampler.h"
+#include "CpuSVGFFilter.h"
+
+namespace CpuSVGF
+{
+	class CpuPathTracer
+	{
+	public:
+		using SharedPtr = std::shared_ptr<CpuPathTracer>;
+
+		struct Settings
+		{
+			uint32_t samplesPerPixel = 1;      ///< Direct / indirect samples averaged per pixel; the G-buffer is traced once, through the pixel center
+			bool     doDirectGI = true;        ///< Same as the "Shoot shadow rays" checkbox of the GI pass
+			bool     doIndirectGI = true;      ///< Same as the "Shoot indirect rays" checkbox
+			float    minT = 1e-4f;             ///< Ray offset, as ResourceManager::getMinTDist()
+			float    cameraPan = 0.0f;         ///< Sideways camera translation per frame (in scene units), to get motion vectors
+			uint32_t tileSize = 16;
+			bool     packetTraversal = true;   ///< Trace each tile's rays in packets rather than one at a time; same image
+			SimdIsa  simdIsa = detectSimdIsa();  ///< Packet width, see getBvhPacketKernel()
+			SamplerType sampler = SamplerType::WhiteNoise;   ///< Same as the GI pass' "Sampler" dropdown
+			LightSelection lightSelection = LightSelection::Power;   ///< Same as the GI pass' "Light selection" dropdown
+			bool     envMapSampling = true;    ///< Same as the GI pass' "Sample environment map" checkbox; needs an environment map
+		};
+
+		/** Ray counts and wall-clock time of the last renderFrame()
+		*/
+		struct Stats
+		{
+			uint64_t primaryRays = 0;
+			uint64_t shadowRays = 0;
+			uint64_t indirectRays = 0;
+			double   milliseconds = 0.0;
+
+			uint64_t getRayCount() const { return primaryRays + shadowRays + indirectRays; }
+			double getRaysPerSecond() const { return milliseconds > 0.0 ? double(getRayCount()) * 1000.0 / milliseconds : 0.0; }
+		};
+
+		/** Returns nullptr if the size is zero or the BVH is missing
+		*/
+		static SharedPtr create(TriangleBvh::SharedPtr pBvh, uint32_t width, uint32_t height, CpuThreadPool::SharedPtr pThreadPool = nullptr);
+
+		void setSettings(const Settings &settings) { mSettings = settings; }
+		const Settings &getSettings() const { return mSettings; }
+
+		/** Render the given frame and return views of the internal buffers (valid until the next call).  The random
+		    sequence of each pixel is seeded like the GPU pass with a frame counter of 0x1337 + frameIndex * spp + sample
+		    and a sample index of frameIndex * spp + sample.
+		*/
+		const FrameInputs &renderFrame(uint32_t frameIndex);
+
+		/** Tables to importance sample the scene's environment map with, such as EnvMapSampler::createCached()'s.
+		    Otherwise the first renderFrame() that needs them builds them.
+		*/
+		void setEnvMapSampler(EnvMapSampler::SharedPtr pSampler) { mpEnvSampler = pSampler; mEnvSamplerChecked = true; }
+
+		const Stats &getStats() const { return mStats; }
+		const TriangleBvh::SharedPtr &getBvh() const { return mpBvh; }
+		uint32_t getWidth() const  { return mWidth; }
+		uint32_t getHeight() const { return mHeight; }
+
+	private:
+		CpuPathTracer(TriangleBvh::SharedPtr pBvh, uint32_t width, uint32_t height, CpuThreadPool::SharedPtr pThreadPool);
+
+		TriangleBvh::SharedPtr   mpBvh;
+		uint32_t                 mWidth;
+		uint32_t                 mHeight;
+		CpuThreadPool::SharedPtr mpThreadPool;
+		Settings                 mSettings;
+		Stats                    mStats;
+		LightAliasTable          mLightTable;   ///< Rebuilt by renderFrame() when the scene's lights change
+		EnvMapSampler::SharedPtr mpEnvSampler;  ///< nullptr if the scene has no environment map (or a black one)
+		bool                     mEnvSamplerChecked = false;
+
+		Image<float3>            mWorldPos;
+		Image<float3>            mWorldNorm;
+
+		ImageF4                  mDirectIllum;
+		ImageF4                  mIndirectIllum;
+		ImageF4                  mLinearZ;
+		ImageF4                  mMotionVecs;
+		ImageF4                  mCompactNormDepth;
+		ImageF4                  mDirAlbedo;
+		ImageF4                  mIndirAlbedo;
+		FrameInputs              mInputs;
+	};
+}
@@ -0,0 +1,133 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFPlanar.h"
+#include "SVGFKernels.h"
+
+namespace CpuSVGF
+{
+	void PlanarImage::resize(uint32_t width, uint32_t height, uint32_t planeCount)
+	{
+		mWidth      = width;
+		mHeight     = height;
+		mStride     = getStride(width);
+		mPlaneCount = planeCount;
+
+		// Over-allocate by one cache line so the first plane can start 64-byte aligned
+		mStorage.assign(size_t(mStride) * height * planeCount + 16, 0.0f);
+		uintptr_t base = reinterpret_cast<uintptr_t>(mStorage.data());
+		mpBase = reinterpret_cast<float *>((base + 63u) & ~uintptr_t(63u));
+	}
+
+	void PlanarImage::wrap(uint32_t width, uint32_t height, uint32_t planeCount, float *pData)
+	{
+		mWidth      = width;
+		mHeight     = height;
+		mStride     = getStride(width);
+		mPlaneCount = planeCount;
+		mStorage.clear();
+		mStorage.shrink_to_fit();
+		mpBase      = pData;
+	}
+
+	void forEachRowBand(CpuThreadPool &pool, uint32_t height, uint32_t bandHeight, const std::function<void(int, int)> &rowTask)
+	{
+		const uint32_t bands = (height + bandHeight - 1) / bandHeight;
+		pool.parallelFor(bands, [&](uint32_t band)
+		{
+			int y0 = int(band * bandHeight);
+			rowTask(y0, std::min(y0 + int(bandHeight), int(height)));
+		});
+	}
+
+	void illumToPlanar(CpuThreadPool &pool, const ImageF4 &direct, const ImageF4 &indirect, PlanarImage &planar)
+	{
+		if (planar.getWidth() != direct.getWidth() || planar.getHeight() != direct.getHeight() || planar.getPlaneCount() != kIllumPlaneCount)
+			planar.resize(direct.getWidth(), direct.getHeight(), kIllumPlaneCount);
+
+		float *p[kIllumPlaneCount];
+		for (uint32_t i = 0; i < kIllumPlaneCount; i++) p[i] = planar.getPlane(i);
+		const uint32_t stride = planar.getStride();
+
+		forEachRowBand(pool, direct.getHeight(), 16, [&](int y0, int y1)
+		{
+			for (int y = y0; y < y1; y++)
+			{
+				for (int x = 0; x < int(direct.getWidth()); x++)
+				{
+					const size_t i = size_t(y) * stride + x;
+					const float4 &d = direct.at(x, y);
+					const float4 &n = indirect.at(x, y);
+					p[kDirectR][i]   = d.x;  p[kDirectG][i]   = d.y;  p[kDirectB][i]   = d.z;  p[kDirectVar][i]   = d.w;
+					p[kIndirectR][i] = n.x;  p[kIndirectG][i] = n.y;  p[kIndirectB][i] = n.z;  p[kIndirectVar][i] = n.w;
+					p[kDirectLum][i]   = luminance(d.rgb());
+					p[kIndirectLum][i] = luminance(n.rgb());
+				}
+			}
+		});
+	}
+
+	void planarToIllum(CpuThreadPool &pool, const PlanarImage &planar, ImageF4 &direct, ImageF4 &indirect)
+	{
+		const float *p[kIllumPlaneCount];
+		for (uint32_t i = 0; i < kIllumPlaneCount; i++) p[i] = planar.getPlane(i);
+		const uint32_t stride = planar.getStride();
+
+		forEachRowBand(pool, planar.getHeight(), 16, [&](int y0, int y1)
+		{
+			for (int y = y0; y < y1; y++)
+			{
+				for (int x = 0; x < int(planar.getWidth()); x++)
+				{
+					const size_t i = size_t(y) * stride + x;
+					direct.at(x, y)   = float4(p[kDirectR][i],   p[kDirectG][i],   p[kDirectB][i],   p[kDirectVar][i]);
+					indirect.at(x, y) = float4(p[kIndirectR][i], p[kIndirectG][i], p[kIndirectB][i], p[kIndirectVar][i]);
+				}
+			}
+		});
+	}
+
+	void geometryToPlanar(CpuThreadPool &pool, const ImageF4 &compactNormDepth, PlanarImage &planar)
+	{
+		if (planar.getWidth() != compactNormDepth.getWidth() || planar.getHeight() != compactNormDepth.getHeight() || planar.getPlaneCount() != kGeometryPlaneCount)
+			planar.resize(compactNormDepth.getWidth(), compactNormDepth.getHeight(), kGeometryPlaneCount);
+
+		float *p[kGeometryPlaneCount];
+		for (uint32_t i = 0; i < kGeometryPlaneCount; i++) p[i] = planar.getPlane(i);
+		const uint32_t stride = planar.getStride();
+
+		forEachRowBand(pool, compactNormDepth.getHeight(), 16, [&](int y0, int y1)
+		{
+			for (int y = y0; y < y1; y++)
+			{
+				for (int x = 0; x < int(compactNormDepth.getWidth()); x++)
+				{
+					const size_t i = size_t(y) * stride + x;
+					float3 normal;
+					float2 z;
+					fetchNormalAndLinearZ(compactNormDepth, x, y, normal, z);
+					p[kLinearZ][i]      = z.x;
+					p[kLinearZDeriv][i] = z.y;
+					p[kNormalX][i]      = normal.x;
+					p[kNormalY][i]      = normal.y;
+					p[kNormalZ][i]      = normal.z;
+				}
+			}
+		});
+	}
+}
@@ -0,0 +1,103 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include "SVGFImage.h"
+#include "CpuThreadPool.h"
+
+namespace CpuSVGF
+{
+	/** A float plane per channel, rows padded to a multiple of 16 floats and 64-byte aligned, so vector kernels
+	    can use full-width loads and stores on every row (the padding is never read as valid data).
+	*/
+	class PlanarImage
+	{
+	public:
+		PlanarImage() = default;
+		PlanarImage(PlanarImage &&) = default;
+		PlanarImage &operator=(PlanarImage &&) = default;
+
+		// Copies would keep pointing at the source's storage (moving a vector keeps its buffer, so moves are fine)
+		PlanarImage(const PlanarImage &) = delete;
+		PlanarImage &operator=(const PlanarImage &) = delete;
+
+		void resize(uint32_t width, uint32_t height, uint32_t planeCount);
+
+		/** Use getByteSize(width, height, planeCount) bytes at pData, 64-byte aligned and outliving this image (or the
+		    next resize() / wrap()), instead of owning storage
+		*/
+		void wrap(uint32_t width, uint32_t height, uint32_t planeCount, float *pData);
+
+		static uint32_t getStride(uint32_t width) { return (width + 15u) & ~15u; }
+		static size_t   getByteSize(uint32_t width, uint32_t height, uint32_t planeCount) { return size_t(getStride(width)) * height * planeCount * sizeof(float); }
+
+		uint32_t getWidth() const      { return mWidth; }
+		uint32_t getHeight() const     { return mHeight; }
+		uint32_t getStride() const     { return mStride; }
+		uint32_t getPlaneCount() const { return mPlaneCount; }
+		size_t   getByteSize() const   { return size_t(mStride) * mHeight * mPlaneCount * sizeof(float); }
+
+		float       *getPlane(uint32_t plane)       { return mpBase + size_t(plane) * mStride * mHeight; }
+		const float *getPlane(uint32_t plane) const { return mpBase + size_t(plane) * mStride * mHeight; }
+
+	private:
+		uint32_t           mWidth = 0, mHeight = 0, mStride = 0, mPlaneCount = 0;
+		std::vector<float> mStorage;
+		float             *mpBase = nullptr;
+	};
+
+	/** Planes of the direct / indirect illumination the a-trous iterations ping-pong between.  Luminance is
+	    stored alongside the color so each tap reads it instead of recomputing it from rgb.
+	*/
+	enum IllumPlane : uint32_t
+	{
+		kDirectR, kDirectG, kDirectB, kDirectVar,
+		kIndirectR, kIndirectG, kIndirectB, kIndirectVar,
+		kDirectLum, kIndirectLum,
+		kIllumPlaneCount
+	};
+
+	/** Bit mask of the illumination channels a pass works on.  Channels left out are neither read nor written
+	    (CpuSVGFFilter filters indirect illumination separately when Settings::indirectScale > 1).
+	*/
+	enum IllumChannels : uint32_t
+	{
+		kDirectChannel   = 1,
+		kIndirectChannel = 2,
+		kBothChannels    = kDirectChannel | kIndirectChannel,
+	};
+
+	/** Per-frame geometry planes decoded once from SVGF_CompactNormDepth
+	*/
+	enum GeometryPlane : uint32_t
+	{
+		kLinearZ, kLinearZDeriv,
+		kNormalX, kNormalY, kNormalZ,
+		kGeometryPlaneCount
+	};
+
+	/** Conversions between the RGBA (array-of-structures) images and planar layout, split in row bands over the pool
+	*/
+	void illumToPlanar(CpuThreadPool &pool, const ImageF4 &direct, const ImageF4 &indirect, PlanarImage &planar);
+	void planarToIllum(CpuThreadPool &pool, const PlanarImage &planar, ImageF4 &direct, ImageF4 &indirect);
+	void geometryToPlanar(CpuThreadPool &pool, const ImageF4 &compactNormDepth, PlanarImage &planar);
+
+	/** Run rowTask(y0, y1) over bands of rows covering [0, height)
+	*/
+	void forEachRowBand(CpuThreadPool &pool, uint32_t height, uint32_t bandHeight, const std::function<void(int, int)> &rowTask);
+}
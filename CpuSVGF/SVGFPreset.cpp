@@ -0,0 +1,84 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFPreset.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace CpuSVGF
+{
+	bool loadPreset(const std::string &path, FilterPreset &preset, std::string &error)
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			error = "cannot open " + path;
+			return false;
+		}
+
+		FilterPreset result = preset;
+		std::string  line;
+		for (uint32_t lineNumber = 1; std::getline(file, line); lineNumber++)
+		{
+			const size_t comment = line.find('#');
+			if (comment != std::string::npos) line.resize(comment);
+
+			std::istringstream ss(line);
+			std::string key;
+			if (!(ss >> key)) continue;
+
+			bool parsed = false;
+			if      (key == "iterations")    parsed = bool(ss >> result.filterIterations);
+			else if (key == "feedback")      parsed = bool(ss >> result.feedbackTap);
+			else if (key == "phi-color")     parsed = bool(ss >> result.phiColor);
+			else if (key == "phi-normal")    parsed = bool(ss >> result.phiNormal);
+			else if (key == "alpha")         parsed = bool(ss >> result.alpha);
+			else if (key == "moments-alpha") parsed = bool(ss >> result.momentsAlpha);
+
+			std::string rest;
+			if (!parsed || ss >> rest)
+			{
+				error = path + ":" + std::to_string(lineNumber) + ": cannot parse \"" + line + "\"";
+				return false;
+			}
+		}
+
+		preset = result;
+		return true;
+	}
+
+	bool savePreset(const std::string &path, const FilterPreset &preset, const std::string &comment)
+	{
+		FILE *pFile = std::fopen(path.c_str(), "w");
+		if (!pFile) return false;
+
+		std::istringstream lines(comment);
+		std::string line;
+		while (std::getline(lines, line)) std::fprintf(pFile, "# %s\n", line.c_str());
+
+		// Enough digits to read back the same floats
+		std::fprintf(pFile, "iterations %d\n", preset.filterIterations);
+		std::fprintf(pFile, "feedback %d\n", preset.feedbackTap);
+		std::fprintf(pFile, "phi-color %.9g\n", preset.phiColor);
+		std::fprintf(pFile, "phi-normal %.9g\n", preset.phiNormal);
+		std::fprintf(pFile, "alpha %.9g\n", preset.alpha);
+		std::fprintf(pFile, "moments-alpha %.9g\n", preset.momentsAlpha);
+		return std::fclose(pFile) == 0;
+	}
+}
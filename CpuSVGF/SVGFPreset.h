@@ -0,0 +1,49 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace CpuSVGF
+{
+	/** The SVGFPass GUI sliders, as stored in a preset file.  Same defaults and meaning as the SVGFPass member
+	    variables (and CpuSVGFFilter::Settings fields) of the same name.
+	*/
+	struct FilterPreset
+	{
+		int32_t filterIterations = 4;
+		int32_t feedbackTap      = 1;
+		float   phiColor         = 10.0f;
+		float   phiNormal        = 128.0f;
+		float   alpha            = 0.05f;
+		float   momentsAlpha     = 0.2f;
+	};
+
+	/** Read a preset file:  text, one "<name> <value>" per line with the names of the SVGFCli options ("iterations",
+	    "feedback", "phi-color", "phi-normal", "alpha", "moments-alpha"), and '#' starting a comment.  Settings the
+	    file doesn't name keep the value they have in preset.  Returns false, describing the problem in error, if the
+	    file can't be read or has a line it doesn't understand; preset is only changed on success.
+	*/
+	bool loadPreset(const std::string &path, FilterPreset &preset, std::string &error);
+
+	/** Write preset in the format loadPreset() reads, with comment (which may span lines) at the top.  Returns false
+	    if the file can't be written.
+	*/
+	bool savePreset(const std::string &path, const FilterPreset &preset, const std::string &comment = "");
+}
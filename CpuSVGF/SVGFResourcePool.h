@@ -0,0 +1,159 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// A pool of render targets (or any other 2D resources) in size classes, so that a pass whose resolution keeps
+//     changing reuses what it already has instead of recreating everything on every resize.
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace CpuSVGF
+{
+	/** Extent a resource of the given width or height is allocated with:  the next of 4, 5, 6 or 7 times a power
+	    of two (at most 25% larger), rounded up to a multiple of 8
+	*/
+	inline uint32_t getSizeClass(uint32_t extent)
+	{
+		if (extent <= 8) return 8;
+		uint32_t power = 1;
+		while (power * 8 < extent) power *= 2;
+		uint32_t size = 4 * power;
+		while (size < extent) size += power;
+		return (size + 7u) & ~7u;
+	}
+
+	/** Whether resources allocated at allocWidth x allocHeight are worth keeping for width x height:  they are large
+	    enough, and no more than twice the size of the ones width x height would get on their own
+	*/
+	inline bool isGoodFit(uint32_t allocWidth, uint32_t allocHeight, uint32_t width, uint32_t height)
+	{
+		if (allocWidth < width || allocHeight < height) return false;
+		return uint64_t(allocWidth) * allocHeight <= 2 * uint64_t(getSizeClass(width)) * getSizeClass(height);
+	}
+
+	struct ResourcePoolStats
+	{
+		uint64_t allocations    = 0;   ///< Resources created
+		uint64_t reuses         = 0;   ///< Requests served with a released resource
+		uint64_t releases       = 0;
+		uint64_t evictions      = 0;   ///< Released resources destroyed by trim()
+		uint32_t liveCount      = 0;   ///< Resources handed out and not released
+		uint32_t freeCount      = 0;   ///< Released resources kept for reuse
+		uint64_t liveBytes      = 0;
+		uint64_t freeBytes      = 0;
+		uint64_t highWaterBytes = 0;   ///< Most liveBytes + freeBytes held at once
+		uint64_t liveHighWaterBytes = 0;   ///< Most liveBytes held at once
+	};
+
+	/** Hands out resources by kind (key, e.g. a format) and size class, recycling released ones.  Every resource
+	    requested at a size of the same class has the same extent, so ones acquired together can be bound together
+	    (e.g. as the attachments of one FBO).  Resource is a handle (e.g. a shared pointer); the pool creates
+	    resources with the factory and destroys them by dropping it.
+	*/
+	template <typename Resource>
+	class ResourcePool
+	{
+	public:
+		using Factory = std::function<Resource(uint32_t key, uint32_t width, uint32_t height)>;
+
+		struct Allocation
+		{
+			Resource resource = Resource();
+			uint32_t key    = 0;
+			uint32_t width  = 0;   ///< Allocated extent; at least the requested one
+			uint32_t height = 0;
+			uint64_t bytes  = 0;
+		};
+
+		explicit ResourcePool(Factory factory) : mFactory(factory) {}
+
+		/** A resource of the given kind and the size class of width x height:  a released one if there is one, a
+		    new one otherwise
+		*/
+		Allocation acquire(uint32_t key, uint32_t bytesPerPixel, uint32_t width, uint32_t height)
+		{
+			const uint32_t classWidth = getSizeClass(width), classHeight = getSizeClass(height);
+			size_t best = 0;
+			while (best < mFree.size() && (mFree[best].key != key || mFree[best].width != classWidth || mFree[best].height != classHeight))
+				best++;
+
+			Allocation allocation;
+			if (best < mFree.size())
+			{
+				allocation = mFree[best];
+				mFree.erase(mFree.begin() + best);
+				mStats.freeCount--;
+				mStats.freeBytes -= allocation.bytes;
+				mStats.reuses++;
+			}
+			else
+			{
+				allocation.key      = key;
+				allocation.width    = classWidth;
+				allocation.height   = classHeight;
+				allocation.bytes    = uint64_t(allocation.width) * allocation.height * bytesPerPixel;
+				allocation.resource = mFactory(key, allocation.width, allocation.height);
+				mStats.allocations++;
+			}
+
+			mStats.liveCount++;
+			mStats.liveBytes += allocation.bytes;
+			mStats.liveHighWaterBytes = std::max(mStats.liveHighWaterBytes, mStats.liveBytes);
+			mStats.highWaterBytes = std::max(mStats.highWaterBytes, mStats.liveBytes + mStats.freeBytes);
+			return allocation;
+		}
+
+		/** Give a resource back for reuse; allocation is left empty
+		*/
+		void release(Allocation &allocation)
+		{
+			mStats.liveCount--;
+			mStats.liveBytes -= allocation.bytes;
+			mStats.freeCount++;
+			mStats.freeBytes += allocation.bytes;
+			mStats.releases++;
+			mFree.push_back(allocation);
+			allocation = Allocation();
+		}
+
+		/** Destroy released resources, oldest first, until at most maxFreeBytes are kept
+		*/
+		void trim(uint64_t maxFreeBytes)
+		{
+			size_t evicted = 0;
+			while (evicted < mFree.size() && mStats.freeBytes > maxFreeBytes)
+			{
+				mStats.freeBytes -= mFree[evicted].bytes;
+				mStats.freeCount--;
+				mStats.evictions++;
+				evicted++;
+			}
+			mFree.erase(mFree.begin(), mFree.begin() + evicted);
+		}
+
+		const ResourcePoolStats &getStats() const { return mStats; }
+
+	private:
+		Factory                 mFactory;
+		std::vector<Allocation> mFree;    ///< Released resources, oldest first
+		ResourcePoolStats       mStats;
+	};
+}
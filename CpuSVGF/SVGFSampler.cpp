@@ -0,0 +1,224 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFSampler.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace CpuSVGF
+{
+	namespace {
+		// Sobol direction numbers of the first four dimensions (Joe and Kuo), as in sampleSequence.hlsli
+		const uint32_t kSobolDirections[4][32] =
+		{
+			{ 0x80000000, 0x40000000, 0x20000000, 0x10000000, 0x08000000, 0x04000000, 0x02000000, 0x01000000,
+			  0x00800000, 0x00400000, 0x00200000, 0x00100000, 0x00080000, 0x00040000, 0x00020000, 0x00010000,
+			  0x00008000, 0x00004000, 0x00002000, 0x00001000, 0x00000800, 0x00000400, 0x00000200, 0x00000100,
+			  0x00000080, 0x00000040, 0x00000020, 0x00000010, 0x00000008, 0x00000004, 0x00000002, 0x00000001 },
+			{ 0x80000000, 0xc0000000, 0xa0000000, 0xf0000000, 0x88000000, 0xcc000000, 0xaa000000, 0xff000000,
+			  0x80800000, 0xc0c00000, 0xa0a00000, 0xf0f00000, 0x88880000, 0xcccc0000, 0xaaaa0000, 0xffff0000,
+			  0x80008000, 0xc000c000, 0xa000a000, 0xf000f000, 0x88008800, 0xcc00cc00, 0xaa00aa00, 0xff00ff00,
+			  0x80808080, 0xc0c0c0c0, 0xa0a0a0a0, 0xf0f0f0f0, 0x88888888, 0xcccccccc, 0xaaaaaaaa, 0xffffffff },
+			{ 0x80000000, 0xc0000000, 0x60000000, 0x90000000, 0xe8000000, 0x5c000000, 0x8e000000, 0xc5000000,
+			  0x68800000, 0x9cc00000, 0xee600000, 0x55900000, 0x80680000, 0xc09c0000, 0x60ee0000, 0x90550000,
+			  0xe8808000, 0x5cc0c000, 0x8e606000, 0xc5909000, 0x6868e800, 0x9c9c5c00, 0xeeee8e00, 0x5555c500,
+			  0x8000e880, 0xc0005cc0, 0x60008e60, 0x9000c590, 0xe8006868, 0x5c009c9c, 0x8e00eeee, 0xc5005555 },
+			{ 0x80000000, 0xc0000000, 0x20000000, 0x50000000, 0xf8000000, 0x74000000, 0xa2000000, 0x93000000,
+			  0xd8800000, 0x25400000, 0x59e00000, 0xe6d00000, 0x78080000, 0xb40c0000, 0x82020000, 0xc3050000,
+			  0x208f8000, 0x51474000, 0xfbea2000, 0x75d93000, 0xa0858800, 0x914e5400, 0xdbe79e00, 0x25db6d00,
+			  0x58800080, 0xe54000c0, 0x79e00020, 0xb6d00050, 0x800800f8, 0xc00c0074, 0x200200a2, 0x50050093 },
+		};
+
+		uint32_t reverseBits(uint32_t v)
+		{
+			v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+			v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+			v = ((v >> 4) & 0x0f0f0f0fu) | ((v & 0x0f0f0f0fu) << 4);
+			v = ((v >> 8) & 0x00ff00ffu) | ((v & 0x00ff00ffu) << 8);
+			return (v >> 16) | (v << 16);
+		}
+
+		// Burley, "Practical Hash-based Owen Scrambling":  a nested uniform scramble of the bits of x
+		uint32_t owenScramble(uint32_t x, uint32_t seed)
+		{
+			x = reverseBits(x);
+			x += seed;
+			x ^= x * 0x6c50b47cu;
+			x ^= x * 0xb82f1e52u;
+			x ^= x * 0xc7afe638u;
+			x ^= x * 0x8d22f6e6u;
+			return reverseBits(x);
+		}
+
+		uint32_t hashCombine(uint32_t seed, uint32_t v)
+		{
+			return seed ^ (v + (seed << 6) + (seed >> 2));
+		}
+
+		uint32_t sobol(uint32_t index, uint32_t dim)
+		{
+			uint32_t x = 0;
+			for (uint32_t bit = 0; index != 0; bit++, index >>= 1)
+			{
+				if (index & 1u) x ^= kSobolDirections[dim][bit];
+			}
+			return x;
+		}
+
+		// 32 bit fixed point to [0, 1), keeping the 24 bits a float holds
+		float toUnitFloat(uint32_t x)
+		{
+			return float(x >> 8) / float(0x01000000);
+		}
+
+		/** Void and cluster (Ulichney 1993) on a torus with a Gaussian of sigma 1.9:  ranks a random tenth of the
+		    pixels after relaxing them, then fills in the largest voids one by one.
+		*/
+		std::vector<uint16_t> buildBlueNoiseTile()
+		{
+			const int n = int(kBlueNoiseTileSize), count = n * n;
+			std::vector<float> kernel(count);
+			for (int y = 0; y < n; y++)
+			{
+				for (int x = 0; x < n; x++)
+				{
+					const int dx = std::min(x, n - x), dy = std::min(y, n - y);
+					kernel[y * n + x] = std::exp(-float(dx * dx + dy * dy) / (2.0f * 1.9f * 1.9f));
+				}
+			}
+
+			std::vector<uint8_t> ones(count, 0);
+			std::vector<float>   energy(count, 0.0f);
+			auto splat = [&](int p, float sign)
+			{
+				const int px = p % n, py = p / n;
+				for (int y = 0; y < n; y++)
+				{
+					const float *pRow = &kernel[((y - py + n) % n) * n];
+					float *pEnergy = &energy[y * n];
+					for (int x = 0; x < n; x++) pEnergy[x] += sign * pRow[(x - px + n) % n];
+				}
+			};
+			auto tightestCluster = [&]() { int best = -1; for (int p = 0; p < count; p++) if (ones[p] && (best < 0 || energy[p] > energy[best])) best = p; return best; };
+			auto largestVoid     = [&]() { int best = -1; for (int p = 0; p < count; p++) if (!ones[p] && (best < 0 || energy[p] < energy[best])) best = p; return best; };
+
+			// Initial pattern:  a tenth of the pixels at random, relaxed until the tightest cluster is the largest void
+			uint32_t seed = 0x5eed;
+			const int initialCount = count / 10;
+			for (int placed = 0; placed < initialCount;)
+			{
+				const int p = int(nextRand(seed) * float(count)) % count;
+				if (ones[p]) continue;
+				ones[p] = 1;
+				splat(p, 1.0f);
+				placed++;
+			}
+			for (;;)
+			{
+				const int cluster = tightestCluster();
+				ones[cluster] = 0;
+				splat(cluster, -1.0f);
+				const int gap = largestVoid();
+				ones[gap] = 1;
+				splat(gap, 1.0f);
+				if (gap == cluster) break;
+			}
+
+			std::vector<uint16_t> ranks(count);
+			const std::vector<uint8_t> prototype = ones;
+			const std::vector<float>   prototypeEnergy = energy;
+			for (int rank = initialCount - 1; rank >= 0; rank--)
+			{
+				const int cluster = tightestCluster();
+				ones[cluster] = 0;
+				splat(cluster, -1.0f);
+				ranks[cluster] = uint16_t(rank);
+			}
+
+			// With a linear energy, the tightest cluster of zeros past the half way point is also the largest void
+			ones = prototype;
+			energy = prototypeEnergy;
+			for (int rank = initialCount; rank < count; rank++)
+			{
+				const int gap = largestVoid();
+				ones[gap] = 1;
+				splat(gap, 1.0f);
+				ranks[gap] = uint16_t(rank);
+			}
+			return ranks;
+		}
+	}
+
+	const char *getSamplerTypeName(SamplerType type)
+	{
+		switch (type)
+		{
+		case SamplerType::WhiteNoise: return "white";
+		case SamplerType::BlueNoise:  return "blue-noise";
+		case SamplerType::Sobol:      return "sobol";
+		default:                      return "unknown";
+		}
+	}
+
+	const uint16_t *getBlueNoiseTile()
+	{
+		static const std::vector<uint16_t> tile = buildBlueNoiseTile();
+		return tile.data();
+	}
+
+	SampleSequence::SampleSequence(SamplerType type, uint32_t x, uint32_t y, uint32_t width, uint32_t frameCount, uint32_t sampleIndex)
+		: mType(type), mX(x), mY(y), mIndex(sampleIndex)
+	{
+		switch (type)
+		{
+		case SamplerType::WhiteNoise:
+			mSeed = initRand(x + y * width, frameCount, 16);
+			break;
+		case SamplerType::Sobol:
+			mSeed = initRand(x + y * width, 0, 16);
+			mIndex = owenScramble(sampleIndex, mSeed);
+			break;
+		default:
+			mSeed = 0;
+			break;
+		}
+	}
+
+	float SampleSequence::next()
+	{
+		const uint32_t dim = mDim++;
+		switch (mType)
+		{
+		case SamplerType::BlueNoise:
+		{
+			// Shift the tile by an R2 sequence step per dimension; over time each pixel walks the golden ratio sequence
+			const uint32_t mask = kBlueNoiseTileSize - 1;
+			const uint32_t tx = (mX + ((dim * 0xc13fa9a9u) >> 26)) & mask;
+			const uint32_t ty = (mY + ((dim * 0x91e10da5u) >> 26)) & mask;
+			const uint32_t rank = getBlueNoiseTile()[ty * kBlueNoiseTileSize + tx];
+			return toUnitFloat((rank << 20) + mIndex * 0x9e3779b9u);
+		}
+		case SamplerType::Sobol:
+			if (dim < 4) return toUnitFloat(owenScramble(sobol(mIndex, dim), hashCombine(mSeed, dim)));
+			return toUnitFloat(owenScramble(mIndex, hashCombine(mSeed, dim)));
+		default:
+			return nextRand(mSeed);
+		}
+	}
+}
@@ -0,0 +1,66 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// The per-pixel random sequences of the GI pass, and a C++ port of Data/SVGFSampleOtherPasses/sampleSequence.hlsli
+//     so the CPU reference tracer draws the same numbers as the GPU.
+
+#pragma once
+#include "SVGFRandom.h"
+
+namespace CpuSVGF
+{
+	/** Where the GI pass' random numbers come from.  Each sample draws them in the same order:  the light, the lobe,
+	    then two for the bounce direction.
+	*/
+	enum class SamplerType : uint32_t
+	{
+		WhiteNoise,   ///< initRand() / nextRand():  an LCG seeded by a hash of pixel and frame (the original)
+		BlueNoise,    ///< A blue noise tile, shifted per dimension and advanced by the golden ratio each sample index
+		Sobol,        ///< Owen scrambled Sobol points, shuffled per pixel (four dimensions, then hashed noise)
+		Count
+	};
+
+	const char *getSamplerTypeName(SamplerType type);
+
+	static const uint32_t kBlueNoiseTileSize = 64;
+
+	/** A kBlueNoiseTileSize^2 tile of ranks 0 .. size^2 - 1 (row major) from void and cluster, the same every run;
+	    GGXGlobalIlluminationPass uploads it as an R16Uint texture.  Built on first use.
+	*/
+	const uint16_t *getBlueNoiseTile();
+
+	/** Port of SampleSequence:  the random numbers of one pixel and sample.  sampleIndex counts samples from the
+	    first frame (frame * samples per frame + sample); the white noise sequence seeds from frameCount as before.
+	*/
+	class SampleSequence
+	{
+	public:
+		SampleSequence(SamplerType type, uint32_t x, uint32_t y, uint32_t width, uint32_t frameCount, uint32_t sampleIndex);
+
+		/** The next number in [0, 1)
+		*/
+		float next();
+
+	private:
+		SamplerType mType;
+		uint32_t    mX, mY;
+		uint32_t    mIndex;   ///< Sample index; shuffled for Sobol
+		uint32_t    mSeed;    ///< LCG state for white noise, per-pixel scramble seed for Sobol
+		uint32_t    mDim = 0;
+	};
+}
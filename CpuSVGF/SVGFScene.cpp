@@ -0,0 +1,789 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFScene.h"
+#include "SVGFImageIO.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace CpuSVGF
+{
+	namespace {
+		const float kPi = 3.14159265f;
+
+		std::string getDirectory(const std::string &path)
+		{
+			const size_t slash = path.find_last_of("/\\");
+			return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+		}
+
+		std::string getExtension(const std::string &path)
+		{
+			const size_t dot = path.find_last_of('.');
+			if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos) return std::string();
+			std::string ext = path.substr(dot + 1);
+			for (char &c : ext) c = char(std::tolower((unsigned char)c));
+			return ext;
+		}
+
+		bool readFile(const std::string &path, std::string &contents)
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (!file) return false;
+			std::ostringstream ss;
+			ss << file.rdbuf();
+			contents = ss.str();
+			return true;
+		}
+
+		/** Just enough JSON for .fscene files
+		*/
+		struct JsonValue
+		{
+			enum class Type { Null, Bool, Number, String, Array, Object };
+			Type                                           type = Type::Null;
+			bool                                           boolean = false;
+			double                                         number = 0.0;
+			std::string                                    string;
+			std::vector<JsonValue>                         array;
+			std::vector<std::pair<std::string, JsonValue>> object;
+
+			const JsonValue *find(const char *key) const
+			{
+				for (const auto &member : object)
+					if (member.first == key) return &member.second;
+				return nullptr;
+			}
+
+			float getFloat(const char *key, float def) const
+			{
+				const JsonValue *pValue = find(key);
+				return (pValue && pValue->type == Type::Number) ? float(pValue->number) : def;
+			}
+
+			float3 getFloat3(const char *key, const float3 &def) const
+			{
+				const JsonValue *pValue = find(key);
+				if (!pValue || pValue->type != Type::Array || pValue->array.size() < 3) return def;
+				return float3(float(pValue->array[0].number), float(pValue->array[1].number), float(pValue->array[2].number));
+			}
+
+			std::string getString(const char *key) const
+			{
+				const JsonValue *pValue = find(key);
+				return (pValue && pValue->type == Type::String) ? pValue->string : std::string();
+			}
+		};
+
+		class JsonParser
+		{
+		public:
+			JsonParser(const std::string &text) : mpCur(text.c_str()), mpEnd(text.c_str() + text.size()) {}
+
+			bool parse(JsonValue &value)
+			{
+				if (!parseValue(value, 0)) return false;
+				skipSpace();
+				return mpCur == mpEnd;
+			}
+
+		private:
+			void skipSpace()
+			{
+				while (mpCur < mpEnd && std::isspace((unsigned char)*mpCur)) mpCur++;
+			}
+
+			bool match(const char *literal)
+			{
+				const size_t n = std::strlen(literal);
+				if (size_t(mpEnd - mpCur) < n || std::strncmp(mpCur, literal, n) != 0) return false;
+				mpCur += n;
+				return true;
+			}
+
+			bool parseString(std::string &s)
+			{
+				if (*mpCur++ != '"') return false;
+				while (mpCur < mpEnd && *mpCur != '"')
+				{
+					char c = *mpCur++;
+					if (c == '\\' && mpCur < mpEnd)
+					{
+						c = *mpCur++;
+						switch (c)
+						{
+						case 'n': c = '\n'; break;
+						case 't': c = '\t'; break;
+						case 'r': c = '\r'; break;
+						case 'b': c = '\b'; break;
+						case 'f': c = '\f'; break;
+						case 'u': c = '?'; mpCur = std::min(mpCur + 4, mpEnd); break;   // Not needed for file names
+						default: break;                                                   // \" \\ \/
+						}
+					}
+					s.push_back(c);
+				}
+				if (mpCur == mpEnd) return false;
+				mpCur++;
+				return true;
+			}
+
+			bool parseValue(JsonValue &value, int depth)
+			{
+				skipSpace();
+				if (mpCur == mpEnd || depth > 64) return false;
+				const char c = *mpCur;
+				if (c == '{')
+				{
+					value.type = JsonValue::Type::Object;
+					mpCur++;
+					skipSpace();
+					if (mpCur < mpEnd && *mpCur == '}') { mpCur++; return true; }
+					for (;;)
+					{
+						skipSpace();
+						std::pair<std::string, JsonValue> member;
+						if (mpCur == mpEnd || !parseString(member.first)) return false;
+						skipSpace();
+						if (mpCur == mpEnd || *mpCur++ != ':') return false;
+						if (!parseValue(member.second, depth + 1)) return false;
+						value.object.push_back(std::move(member));
+						skipSpace();
+						if (mpCur == mpEnd) return false;
+						if (*mpCur == ',') { mpCur++; continue; }
+						if (*mpCur++ == '}') return true;
+						return false;
+					}
+				}
+				if (c == '[')
+				{
+					value.type = JsonValue::Type::Array;
+					mpCur++;
+					skipSpace();
+					if (mpCur < mpEnd && *mpCur == ']') { mpCur++; return true; }
+					for (;;)
+					{
+						value.array.emplace_back();
+						if (!parseValue(value.array.back(), depth + 1)) return false;
+						skipSpace();
+						if (mpCur == mpEnd) return false;
+						if (*mpCur == ',') { mpCur++; continue; }
+						if (*mpCur++ == ']') return true;
+						return false;
+					}
+				}
+				if (c == '"')
+				{
+					value.type = JsonValue::Type::String;
+					return parseString(value.string);
+				}
+				if (match("true"))  { value.type = JsonValue::Type::Bool; value.boolean = true;  return true; }
+				if (match("false")) { value.type = JsonValue::Type::Bool; value.boolean = false; return true; }
+				if (match("null"))  { value.type = JsonValue::Type::Null; return true; }
+
+				char *pNumberEnd = nullptr;
+				value.type   = JsonValue::Type::Number;
+				value.number = std::strtod(mpCur, &pNumberEnd);
+				if (pNumberEnd == mpCur) return false;
+				mpCur = pNumberEnd;
+				return true;
+			}
+
+			const char *mpCur;
+			const char *mpEnd;
+		};
+
+		/** Scale, then rotate (Euler angles applied about x, then y, then z), then translate
+		*/
+		struct InstanceTransform
+		{
+			float3 translation = float3(0.0f);
+			float3 scaling = float3(1.0f);
+			float3 rows[3] = { float3(1.0f, 0.0f, 0.0f), float3(0.0f, 1.0f, 0.0f), float3(0.0f, 0.0f, 1.0f) };
+
+			void setRotation(const float3 &radians)
+			{
+				const float cx = std::cos(radians.x), sx = std::sin(radians.x);
+				const float cy = std::cos(radians.y), sy = std::sin(radians.y);
+				const float cz = std::cos(radians.z), sz = std::sin(radians.z);
+				// Rz * Ry * Rx
+				rows[0] = float3(cz * cy, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx);
+				rows[1] = float3(sz * cy, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx);
+				rows[2] = float3(-sy,     cy * sx,                cy * cx);
+			}
+
+			float3 rotate(const float3 &v) const { return float3(dot(rows[0], v), dot(rows[1], v), dot(rows[2], v)); }
+			float3 applyToPoint(const float3 &p) const  { return rotate(p * scaling) + translation; }
+			float3 applyToNormal(const float3 &n) const { return normalize(rotate(n / scaling)); }
+		};
+
+		void loadMtl(const std::string &path, std::map<std::string, uint32_t> &materialIds, Scene &scene)
+		{
+			std::ifstream file(path);
+			if (!file) return;   // Missing libraries leave the default material, like most OBJ importers
+
+			const std::string dir = getDirectory(path);
+			SceneMaterial material;
+			bool          open = false;
+			auto flush = [&]()
+			{
+				if (open) materialIds[material.name] = scene.addMaterial(material);
+				open = false;
+			};
+
+			std::string line;
+			while (std::getline(file, line))
+			{
+				std::istringstream ss(line);
+				std::string key;
+				ss >> key;
+				if (key == "newmtl")
+				{
+					flush();
+					material = SceneMaterial();
+					ss >> material.name;
+					open = true;
+				}
+				else if (key == "Kd") ss >> material.diffuse.x >> material.diffuse.y >> material.diffuse.z;
+				else if (key == "Ks") ss >> material.specular.x >> material.specular.y >> material.specular.z;
+				else if (key == "Ns")
+				{
+					// The usual Phong exponent to microfacet alpha mapping, alpha = sqrt(2 / (Ns + 2)); roughness = sqrt(alpha)
+					float ns = 0.0f;
+					ss >> ns;
+					material.linearRoughness = std::sqrt(std::sqrt(2.0f / (std::max(ns, 0.0f) + 2.0f)));
+				}
+				else if (key == "Pr") ss >> material.linearRoughness;
+				else if (key == "d")  ss >> material.opacity;
+				else if (key == "Tr") { float tr = 0.0f; ss >> tr; material.opacity = 1.0f - tr; }
+				else if (key == "map_Kd") { std::string name; ss >> name; material.diffuseTexture = dir + name; }
+				else if (key == "map_Ks") { std::string name; ss >> name; material.specularTexture = dir + name; }
+			}
+			flush();
+		}
+
+		/** Resolve a 1-based (or negative, relative) OBJ index; returns false if out of range
+		*/
+		bool resolveIndex(long index, size_t count, size_t &resolved)
+		{
+			if (index > 0 && size_t(index) <= count) { resolved = size_t(index - 1); return true; }
+			if (index < 0 && size_t(-index) <= count) { resolved = count - size_t(-index); return true; }
+			return false;
+		}
+
+		bool loadObj(const std::string &path, const InstanceTransform &transform, Scene &scene, std::string &error)
+		{
+			std::string text;
+			if (!readFile(path, text))
+			{
+				error = "Cannot read " + path;
+				return false;
+			}
+
+			std::vector<float3> positions, normals;
+			std::vector<float2> texCoords;
+			std::map<std::string, uint32_t> materialIds;
+			uint32_t currentMaterial = ~0u;
+			auto getDefaultMaterial = [&]()
+			{
+				auto it = materialIds.find("");
+				if (it != materialIds.end()) return it->second;
+				SceneMaterial material;
+				material.name = "default";
+				return materialIds[""] = scene.addMaterial(material);
+			};
+
+			const std::string dir = getDirectory(path);
+			uint32_t lineNumber = 0;
+			const char *p = text.c_str(), *pEnd = p + text.size();
+			while (p < pEnd)
+			{
+				const char *pLineEnd = static_cast<const char *>(std::memchr(p, '\n', size_t(pEnd - p)));
+				if (!pLineEnd) pLineEnd = pEnd;
+				std::string line(p, pLineEnd);
+				p = pLineEnd + 1;
+				lineNumber++;
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+
+				const char *s = line.c_str();
+				while (*s == ' ' || *s == '\t') s++;
+				char *pNext = nullptr;
+				if (s[0] == 'v' && (s[1] == ' ' || s[1] == '\t'))
+				{
+					float3 v;
+					v.x = std::strtof(s + 2, &pNext);
+					v.y = std::strtof(pNext, &pNext);
+					v.z = std::strtof(pNext, &pNext);
+					positions.push_back(transform.applyToPoint(v));
+				}
+				else if (s[0] == 'v' && s[1] == 'n')
+				{
+					float3 n;
+					n.x = std::strtof(s + 2, &pNext);
+					n.y = std::strtof(pNext, &pNext);
+					n.z = std::strtof(pNext, &pNext);
+					normals.push_back(transform.applyToNormal(n));
+				}
+				else if (s[0] == 'v' && s[1] == 't')
+				{
+					float2 t;
+					t.x = std::strtof(s + 2, &pNext);
+					t.y = std::strtof(pNext, &pNext);
+					texCoords.push_back(t);
+				}
+				else if (s[0] == 'f' && (s[1] == ' ' || s[1] == '\t'))
+				{
+					// Polygons are triangulated as a fan; each corner is v, v/vt, v//vn or v/vt/vn
+					struct Corner { size_t v; size_t vt; size_t vn; bool hasVt, hasVn; };
+					std::vector<Corner> corners;
+					const char *c = s + 1;
+					for (;;)
+					{
+						while (*c == ' ' || *c == '\t') c++;
+						if (*c == '\0') break;
+						Corner corner = {};
+						if (!resolveIndex(std::strtol(c, &pNext, 10), positions.size(), corner.v))
+						{
+							error = path + ":" + std::to_string(lineNumber) + ": bad vertex index";
+							return false;
+						}
+						c = pNext;
+						if (*c == '/')
+						{
+							c++;
+							if (*c != '/') corner.hasVt = resolveIndex(std::strtol(c, &pNext, 10), texCoords.size(), corner.vt), c = pNext;
+							if (*c == '/') c++, corner.hasVn = resolveIndex(std::strtol(c, &pNext, 10), normals.size(), corner.vn), c = pNext;
+						}
+						corners.push_back(corner);
+						while (*c && *c != ' ' && *c != '\t') c++;
+					}
+
+					const uint32_t materialId = currentMaterial != ~0u ? currentMaterial : getDefaultMaterial();
+					for (size_t i = 2; i < corners.size(); i++)
+					{
+						const Corner *tri[3] = { &corners[0], &corners[i - 1], &corners[i] };
+						float3 pos[3], nrm[3];
+						float2 uv[3];
+						bool   hasNormals = true, hasTexCoords = true;
+						for (int k = 0; k < 3; k++)
+						{
+							pos[k] = positions[tri[k]->v];
+							hasNormals   = hasNormals && tri[k]->hasVn;
+							hasTexCoords = hasTexCoords && tri[k]->hasVt;
+							if (tri[k]->hasVn) nrm[k] = normals[tri[k]->vn];
+							if (tri[k]->hasVt) uv[k]  = texCoords[tri[k]->vt];
+						}
+						scene.addTriangle(pos, hasNormals ? nrm : nullptr, hasTexCoords ? uv : nullptr, materialId);
+					}
+				}
+				else if (std::strncmp(s, "usemtl", 6) == 0)
+				{
+					std::istringstream ss(s + 6);
+					std::string name;
+					ss >> name;
+					auto it = materialIds.find(name);
+					currentMaterial = it != materialIds.end() ? it->second : getDefaultMaterial();
+				}
+				else if (std::strncmp(s, "mtllib", 6) == 0)
+				{
+					std::istringstream ss(s + 6);
+					std::string name;
+					while (ss >> name) loadMtl(dir + name, materialIds, scene);
+				}
+			}
+			return true;
+		}
+
+		bool loadFscene(const std::string &path, Scene &scene, std::string &error)
+		{
+			std::string text;
+			if (!readFile(path, text))
+			{
+				error = "Cannot read " + path;
+				return false;
+			}
+			JsonValue root;
+			if (!JsonParser(text).parse(root) || root.type != JsonValue::Type::Object)
+			{
+				error = path + " is not valid JSON";
+				return false;
+			}
+
+			const std::string dir = getDirectory(path);
+			if (const JsonValue *pModels = root.find("models"))
+			{
+				for (const JsonValue &model : pModels->array)
+				{
+					// Only .obj geometry can be read here; for other formats (pink_room.fbx) look for an .obj export
+					std::string file = dir + model.getString("file");
+					if (getExtension(file) != "obj")
+					{
+						const std::string objFile = file.substr(0, file.size() - getExtension(file).size()) + "obj";
+						if (!std::ifstream(objFile))
+						{
+							error = file + ": only .obj models can be loaded; export it as " + objFile;
+							return false;
+						}
+						file = objFile;
+					}
+
+					const JsonValue *pInstances = model.find("instances");
+					std::vector<JsonValue> defaultInstance(1);
+					for (const JsonValue &instance : (pInstances && !pInstances->array.empty()) ? pInstances->array : defaultInstance)
+					{
+						InstanceTransform transform;
+						transform.translation = instance.getFloat3("translation", float3(0.0f));
+						transform.scaling     = instance.getFloat3("scaling", float3(1.0f));
+						transform.setRotation(instance.getFloat3("rotation", float3(0.0f)) * (kPi / 180.0f));
+						if (!loadObj(file, transform, scene, error)) return false;
+					}
+				}
+			}
+
+			if (const JsonValue *pLights = root.find("lights"))
+			{
+				for (const JsonValue &entry : pLights->array)
+				{
+					const std::string type = entry.getString("type");
+					if (type != "dir_light" && type != "point_light") continue;   // Area lights etc. aren't in gLights either
+					SceneLight light;
+					light.name          = entry.getString("name");
+					light.type          = type == "dir_light" ? SceneLightType::Directional : SceneLightType::Point;
+					light.intensity     = entry.getFloat3("intensity", float3(1.0f));
+					light.posW          = entry.getFloat3("pos", float3(0.0f));
+					light.dirW          = normalize(entry.getFloat3("direction", float3(0.0f, -1.0f, 0.0f)));
+					light.openingAngle  = entry.getFloat("opening_angle", 180.0f) * (kPi / 180.0f);
+					light.penumbraAngle = entry.getFloat("penumbra_angle", 0.0f) * (kPi / 180.0f);
+					scene.addLight(light);
+				}
+			}
+
+			if (const JsonValue *pCameras = root.find("cameras"))
+			{
+				const std::string active = root.getString("active_camera");
+				for (const JsonValue &entry : pCameras->array)
+				{
+					if (!active.empty() && entry.getString("name") != active && &entry != &pCameras->array.front()) continue;
+					SceneCamera &camera = scene.getCamera();
+					camera.posW        = entry.getFloat3("pos", camera.posW);
+					camera.target      = entry.getFloat3("target", camera.target);
+					camera.up          = entry.getFloat3("up", camera.up);
+					camera.focalLength = entry.getFloat("focal_length", camera.focalLength);
+				}
+			}
+
+			// Environment maps in a format we can read replace the default color; others are ignored
+			const std::string envMap = root.getString("env_map");
+			ImageF4 envImage;
+			if (!envMap.empty() && loadImage(dir + envMap, envImage)) scene.setEnvironmentMap(envImage);
+			return true;
+		}
+
+		// Building blocks for the test room; quads are lit on the side cross(e1, e2) points to
+		void addQuad(Scene &scene, const float3 &origin, const float3 &e1, const float3 &e2, uint32_t materialId)
+		{
+			const float3 a[3] = { origin, origin + e1, origin + e1 + e2 };
+			const float3 b[3] = { origin, origin + e1 + e2, origin + e2 };
+			scene.addTriangle(a, nullptr, nullptr, materialId);
+			scene.addTriangle(b, nullptr, nullptr, materialId);
+		}
+
+		void addBox(Scene &scene, const float3 &lo, const float3 &hi, uint32_t materialId)
+		{
+			const float3 dx(hi.x - lo.x, 0.0f, 0.0f), dy(0.0f, hi.y - lo.y, 0.0f), dz(0.0f, 0.0f, hi.z - lo.z);
+			addQuad(scene, lo, dz, dy, materialId);
+			addQuad(scene, float3(hi.x, lo.y, lo.z), dy, dz, materialId);
+			addQuad(scene, lo, dx, dz, materialId);
+			addQuad(scene, float3(lo.x, hi.y, lo.z), dz, dx, materialId);
+			addQuad(scene, lo, dy, dx, materialId);
+			addQuad(scene, float3(lo.x, lo.y, hi.z), dx, dy, materialId);
+		}
+
+		void addSphere(Scene &scene, const float3 &center, float radius, uint32_t materialId)
+		{
+			const int rings = 24, segments = 48;
+			auto point = [&](int ring, int segment)
+			{
+				const float theta = kPi * float(ring) / float(rings), phi = 2.0f * kPi * float(segment) / float(segments);
+				return float3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			};
+			for (int r = 0; r < rings; r++)
+			{
+				for (int s = 0; s < segments; s++)
+				{
+					const float3 n[4] = { point(r, s), point(r + 1, s), point(r + 1, s + 1), point(r, s + 1) };
+					const float3 na[3] = { n[0], n[2], n[1] }, nb[3] = { n[0], n[3], n[2] };
+					const float3 pa[3] = { center + na[0] * radius, center + na[1] * radius, center + na[2] * radius };
+					const float3 pb[3] = { center + nb[0] * radius, center + nb[1] * radius, center + nb[2] * radius };
+					if (r > 0)         scene.addTriangle(pa, na, nullptr, materialId);
+					if (r < rings - 1) scene.addTriangle(pb, nb, nullptr, materialId);
+				}
+			}
+		}
+	};
+
+	void SceneCamera::getBasis(float aspectRatio, float3 &u, float3 &v, float3 &w) const
+	{
+		const float tanHalfFovY = 0.5f * 24.0f / focalLength;
+		w = normalize(target - posW);
+		u = normalize(cross(w, up));
+		v = normalize(cross(u, w));
+		u = u * (tanHalfFovY * aspectRatio);
+		v = v * tanHalfFovY;
+	}
+
+	Scene::SharedPtr Scene::load(const std::string &path, std::string &error)
+	{
+		SharedPtr pScene = create();
+		const std::string ext = getExtension(path);
+		if (ext == "fscene")
+		{
+			if (!loadFscene(path, *pScene, error)) return nullptr;
+		}
+		else if (ext == "obj")
+		{
+			if (!loadObj(path, InstanceTransform(), *pScene, error)) return nullptr;
+		}
+		else
+		{
+			error = path + ": unsupported scene format (expected .fscene or .obj)";
+			return nullptr;
+		}
+
+		if (pScene->getTriangleCount() == 0)
+		{
+			error = path + " contains no triangles";
+			return nullptr;
+		}
+
+		const std::string dir = CpuSVGF::getDirectory(path);
+		if (dir.size() > 1) pScene->mDirectory = dir.substr(0, dir.size() - 1);
+		else if (!dir.empty()) pScene->mDirectory = dir;
+		return pScene;
+	}
+
+	Scene::SharedPtr Scene::createTestRoom()
+	{
+		SharedPtr pScene = create();
+		Scene &scene = *pScene;
+
+		auto material = [&](const char *name, const float3 &diffuse, const float3 &specular, float roughness)
+		{
+			SceneMaterial m;
+			m.name = name;
+			m.diffuse = diffuse;
+			m.specular = specular;
+			m.linearRoughness = roughness;
+			return scene.addMaterial(m);
+		};
+		const uint32_t walls   = material("walls",   float3(0.85f, 0.55f, 0.55f), float3(0.04f), 0.8f);
+		const uint32_t ceiling = material("ceiling", float3(0.8f),                 float3(0.04f), 0.9f);
+		const uint32_t floor   = material("floor",   float3(0.45f, 0.3f, 0.2f),    float3(0.04f), 0.35f);
+		const uint32_t fabric  = material("fabric",  float3(0.75f, 0.35f, 0.4f),   float3(0.02f), 0.95f);
+		const uint32_t wood    = material("wood",    float3(0.35f, 0.22f, 0.12f),  float3(0.05f), 0.5f);
+		const uint32_t brass   = material("brass",   float3(0.02f),                float3(0.9f, 0.75f, 0.45f), 0.2f);
+
+		// Room:  x in [-6.5, 1.5], y in [0, 2.8], z in [-4.5, 3.5], lit faces inward.  The back wall has a window
+		//    the directional light shines through.
+		addQuad(scene, float3(-6.5f, 0.0f, -4.5f), float3(0.0f, 0.0f, 8.0f), float3(8.0f, 0.0f, 0.0f), floor);
+		addQuad(scene, float3(-6.5f, 2.8f, -4.5f), float3(8.0f, 0.0f, 0.0f), float3(0.0f, 0.0f, 8.0f), ceiling);
+		addQuad(scene, float3(-6.5f, 0.0f, -4.5f), float3(0.0f, 2.8f, 0.0f), float3(0.0f, 0.0f, 8.0f), walls);
+		addQuad(scene, float3( 1.5f, 0.0f, -4.5f), float3(0.0f, 0.0f, 8.0f), float3(0.0f, 2.8f, 0.0f), walls);
+		addQuad(scene, float3(-6.5f, 0.0f,  3.5f), float3(0.0f, 2.8f, 0.0f), float3(8.0f, 0.0f, 0.0f), walls);
+		addQuad(scene, float3(-6.5f, 0.0f, -4.5f), float3(8.0f, 0.0f, 0.0f), float3(0.0f, 1.0f, 0.0f), walls);
+		addQuad(scene, float3(-6.5f, 2.3f, -4.5f), float3(8.0f, 0.0f, 0.0f), float3(0.0f, 0.5f, 0.0f), walls);
+		addQuad(scene, float3(-6.5f, 1.0f, -4.5f), float3(1.5f, 0.0f, 0.0f), float3(0.0f, 1.3f, 0.0f), walls);
+		addQuad(scene, float3(-2.5f, 1.0f, -4.5f), float3(4.0f, 0.0f, 0.0f), float3(0.0f, 1.3f, 0.0f), walls);
+
+		// A couch, a table with legs and a polished ball on it
+		addBox(scene, float3(-5.8f, 0.0f, 1.5f),  float3(-3.8f, 0.45f, 2.6f), fabric);
+		addBox(scene, float3(-5.8f, 0.45f, 2.3f), float3(-3.8f, 0.9f, 2.6f),  fabric);
+		addBox(scene, float3(-3.2f, 0.45f, -0.5f), float3(-1.8f, 0.5f, 0.6f), wood);
+		for (float x : { -3.15f, -1.9f })
+			for (float z : { -0.45f, 0.5f })
+				addBox(scene, float3(x, 0.0f, z), float3(x + 0.05f, 0.45f, z + 0.05f), wood);
+		addSphere(scene, float3(-2.5f, 0.75f, 0.05f), 0.25f, brass);
+
+		// Camera and lights from pink_room.fscene
+		SceneCamera &camera = scene.getCamera();
+		camera.posW        = float3(-2.706775665f, 0.852941096f, -3.112438679f);
+		camera.target      = float3(-2.347264528f, 0.738329768f, -2.186362982f);
+		camera.up          = float3(0.038521841f, 0.993395030f, 0.107981369f);
+		camera.focalLength = 21.0f;
+
+		SceneLight sun;
+		sun.name      = "dirLight0";
+		sun.type      = SceneLightType::Directional;
+		sun.intensity = float3(1.0f, 1.0f, 0.984313786f);
+		sun.dirW      = normalize(float3(0.364226580f, -0.545265198f, 0.754999995f));
+		scene.addLight(sun);
+		for (const float3 &pos : { float3(-4.645481586f, 1.542750835f, -1.488459826f), float3(-1.016136885f, 1.474027038f, -1.425623536f) })
+		{
+			SceneLight point;
+			point.name = "pointLight";
+			point.posW = pos;
+			scene.addLight(point);
+		}
+		return pScene;
+	}
+
+	uint32_t Scene::addMaterial(const SceneMaterial &material)
+	{
+		mMaterials.push_back(material);
+		return uint32_t(mMaterials.size() - 1);
+	}
+
+	void Scene::addTriangle(const float3 positions[3], const float3 *pNormals, const float2 *pTexCoords, uint32_t materialId)
+	{
+		TriangleAttributes attributes;
+		const float3 faceNormal = normalize(cross(positions[1] - positions[0], positions[2] - positions[0]));
+		for (int k = 0; k < 3; k++)
+		{
+			mPositions.push_back(positions[k]);
+			attributes.normals[k]   = pNormals ? pNormals[k] : faceNormal;
+			attributes.texCoords[k] = pTexCoords ? pTexCoords[k] : float2(0.0f);
+		}
+		attributes.materialId = materialId;
+		mAttributes.push_back(attributes);
+	}
+
+	bool Scene::loadTextures(const std::string &cacheDir, CpuThreadPool::SharedPtr pThreadPool, TextureLoadStats *pStats)
+	{
+		std::vector<TextureDesc> descs;
+		std::map<std::pair<std::string, bool>, size_t> indices;
+		auto add = [&](const std::string &path, bool srgb)
+		{
+			if (path.empty()) return ~size_t(0);
+			auto inserted = indices.emplace(std::make_pair(path, srgb), descs.size());
+			if (inserted.second)
+			{
+				TextureDesc desc;
+				desc.path = path;
+				desc.srgb = srgb;
+				descs.push_back(desc);
+			}
+			return inserted.first->second;
+		};
+
+		// Diffuse colors are sRGB, specular ones linear, as Falcor loads them
+		std::vector<size_t> diffuseIds(mMaterials.size()), specularIds(mMaterials.size());
+		for (size_t i = 0; i < mMaterials.size(); i++)
+		{
+			diffuseIds[i] = add(mMaterials[i].diffuseTexture, true);
+			specularIds[i] = add(mMaterials[i].specularTexture, false);
+		}
+		if (descs.empty())
+		{
+			if (pStats) *pStats = TextureLoadStats();
+			return true;
+		}
+		const std::vector<CpuTexture::SharedPtr> textures = CpuTexture::loadAllCached(descs, cacheDir, pThreadPool, pStats);
+
+		std::vector<float> minAlpha(textures.size(), -1.0f);
+		bool ok = true;
+		for (size_t i = 0; i < mMaterials.size(); i++)
+		{
+			SceneMaterial &material = mMaterials[i];
+			if (diffuseIds[i] != ~size_t(0))
+			{
+				material.pDiffuseTexture = textures[diffuseIds[i]];
+				ok = ok && material.pDiffuseTexture;
+			}
+			if (specularIds[i] != ~size_t(0))
+			{
+				material.pSpecularTexture = textures[specularIds[i]];
+				ok = ok && material.pSpecularTexture;
+			}
+
+			material.minTextureAlpha = 1.0f;
+			if (!material.pDiffuseTexture) continue;
+			float &alpha = minAlpha[diffuseIds[i]];
+			if (alpha < 0.0f)
+			{
+				const ImageRGBA8 &mip = material.pDiffuseTexture->getMip(0);
+				uint32_t lowest = 255;
+				for (size_t t = 0; t < mip.getPixelCount() && lowest > 0; t++) lowest = std::min(lowest, mip.getData()[t] >> 24);
+				alpha = float(lowest) / 255.0f;
+			}
+			material.minTextureAlpha = alpha;
+		}
+		return ok;
+	}
+
+	float2 Scene::getTexCoords(uint32_t triangle, float u, float v) const
+	{
+		const TriangleAttributes &attribs = mAttributes[triangle];
+		return attribs.texCoords[0] * (1.0f - u - v) + attribs.texCoords[1] * u + attribs.texCoords[2] * v;
+	}
+
+	bool Scene::alphaTestFails(uint32_t triangle, float u, float v) const
+	{
+		const SceneMaterial &material = mMaterials[mAttributes[triangle].materialId];
+		float opacity = material.opacity;
+		if (material.pDiffuseTexture)
+		{
+			if (opacity * material.minTextureAlpha >= material.alphaThreshold) return false;
+			opacity *= material.pDiffuseTexture->sample(getTexCoords(triangle, u, v)).w;
+		}
+		return opacity < material.alphaThreshold;
+	}
+
+	bool Scene::hasAlphaTest() const
+	{
+		for (const SceneMaterial &material : mMaterials)
+			if (material.opacity * material.minTextureAlpha < material.alphaThreshold) return true;
+		return false;
+	}
+
+	uint64_t Scene::getGeometryHash() const
+	{
+		// One 32-bit word at a time rather than byte by byte; hashing then costs little next to building anything
+		uint64_t hash = 0xcbf29ce484222325ull;
+		auto add = [&](uint32_t word) { hash = (hash ^ word) * 0x100000001b3ull; };
+		add(uint32_t(mPositions.size()));
+		for (const float3 &p : mPositions)
+		{
+			add(asuint(p.x));
+			add(asuint(p.y));
+			add(asuint(p.z));
+		}
+		return hash;
+	}
+
+	float3 Scene::evalEnvironment(const float3 &dir) const
+	{
+		if (mEnvMap.getWidth() == 0) return mEnvColor;
+		const float2 uv = wsVectorToLatLong(dir);
+		const uint32_t x = std::min(uint32_t(uv.x * mEnvMap.getWidth()), mEnvMap.getWidth() - 1);
+		const uint32_t y = std::min(uint32_t(uv.y * mEnvMap.getHeight()), mEnvMap.getHeight() - 1);
+		return mEnvMap.at(x, y).rgb();
+	}
+
+	float2 wsVectorToLatLong(const float3 &dir)
+	{
+		const float3 p = normalize(dir);
+		const float  u = (1.0f + std::atan2(p.x, -p.z) / kPi) * 0.5f;
+		const float  v = std::acos(std::min(std::max(p.y, -1.0f), 1.0f)) / kPi;
+		return float2(u, v);
+	}
+}
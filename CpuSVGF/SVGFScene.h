@@ -0,0 +1,184 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// The triangle scene the CPU reference path tracer (SVGFPathTracer.h) renders:  geometry, materials, lights, camera
+//     and environment, loaded from a Falcor .fscene or a Wavefront .obj.
+
+#pragma once
+#include "SVGFImage.h"
+#include "SVGFTexture.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CpuSVGF
+{
+	/** Material parameters as simplePrepareShadingData() in ggxGlobalIlluminationUtils.hlsli leaves them, after
+	    the shading model has been resolved
+	*/
+	struct SceneMaterial
+	{
+		std::string name;
+		float3      diffuse = float3(0.5f);
+		float3      specular = float3(0.04f);
+		float       linearRoughness = 0.5f;      ///< The shaders clamp it to at least 0.08
+		float       opacity = 1.0f;              ///< Base color alpha; hits with opacity < alphaThreshold are ignored
+		float       alphaThreshold = 0.5f;
+		bool        doubleSided = false;
+		std::string diffuseTexture;              ///< Texture file names from the scene, relative to the scene file
+		std::string specularTexture;
+
+		/** Set by Scene::loadTextures().  The diffuse texture replaces diffuse and scales opacity by its alpha; the
+		    specular texture replaces specular, and linearRoughness by 1 - alpha, as Falcor's spec-gloss model reads it.
+		*/
+		CpuTexture::SharedPtr pDiffuseTexture;
+		CpuTexture::SharedPtr pSpecularTexture;
+		float                 minTextureAlpha = 1.0f;   ///< Lowest alpha in pDiffuseTexture
+	};
+
+	enum class SceneLightType : uint32_t
+	{
+		Directional,
+		Point,
+	};
+
+	struct SceneLight
+	{
+		std::string    name;
+		SceneLightType type = SceneLightType::Point;
+		float3         intensity = float3(1.0f);
+		float3         posW;
+		float3         dirW = float3(0.0f, -1.0f, 0.0f);
+		float          openingAngle = 3.14159265f;   ///< Half angle of a spot light's cone in radians; pi lights every direction
+		float          penumbraAngle = 0.0f;
+	};
+
+	/** Falcor's perspective camera; the vertical field of view follows from the focal length and a 24 mm film
+	*/
+	struct SceneCamera
+	{
+		float3 posW = float3(0.0f);
+		float3 target = float3(0.0f, 0.0f, -1.0f);
+		float3 up = float3(0.0f, 1.0f, 0.0f);
+		float  focalLength = 21.0f;
+
+		/** Same as cameraU/V/W in Falcor's CameraData (with a focal distance of 1):  ndc.x * u + ndc.y * v + w spans
+		    the view frustum, with ndc = (-1, 1) at the top left corner
+		*/
+		void getBasis(float aspectRatio, float3 &u, float3 &v, float3 &w) const;
+	};
+
+	/** Per-vertex attributes of one triangle, kept apart from the positions the BVH reads
+	*/
+	struct TriangleAttributes
+	{
+		float3   normals[3];
+		float2   texCoords[3];
+		uint32_t materialId;
+	};
+
+	class Scene
+	{
+	public:
+		using SharedPtr = std::shared_ptr<Scene>;
+
+		static SharedPtr create() { return SharedPtr(new Scene()); }
+
+		/** Load a Falcor .fscene (camera, lights and model instances) or a Wavefront .obj (with its .mtl).  An .fscene
+		    model in a format other than .obj is read from the .obj of the same name next to it.  Returns nullptr and
+		    describes the problem in error on failure.
+		*/
+		static SharedPtr load(const std::string &path, std::string &error);
+
+		/** A closed room with a window, some furniture and the camera and lights of pink_room.fscene, for when the
+		    pink_room model is not available
+		*/
+		static SharedPtr createTestRoom();
+
+		/** Load the diffuse and specular textures the materials name, with CpuTexture::loadAllCached(), so that hits
+		    sample them.  Each file is loaded once however many materials use it.  Returns false if any failed to load;
+		    the materials of those keep their constant colors.  Call before building the BVH, which needs to know
+		    whether the textures' alpha can fail the alpha test.
+		*/
+		bool loadTextures(const std::string &cacheDir, CpuThreadPool::SharedPtr pThreadPool = nullptr, TextureLoadStats *pStats = nullptr);
+
+		/** Directory of the file the scene was loaded from, which its texture cache defaults to; "." for a scene
+		    built in code
+		*/
+		const std::string &getDirectory() const { return mDirectory; }
+
+		uint32_t addMaterial(const SceneMaterial &material);
+
+		/** Add a triangle in world space; missing normals (nullptr) default to the face normal
+		*/
+		void addTriangle(const float3 positions[3], const float3 *pNormals, const float2 *pTexCoords, uint32_t materialId);
+
+		void addLight(const SceneLight &light) { mLights.push_back(light); }
+
+		uint32_t getTriangleCount() const                             { return uint32_t(mAttributes.size()); }
+		const float3 *getPositions(uint32_t triangle) const            { return &mPositions[3 * size_t(triangle)]; }
+		const TriangleAttributes &getAttributes(uint32_t triangle) const { return mAttributes[triangle]; }
+		const SceneMaterial &getMaterial(uint32_t id) const            { return mMaterials[id]; }
+		SceneMaterial &getMaterial(uint32_t id)                        { return mMaterials[id]; }
+		uint32_t getMaterialCount() const                             { return uint32_t(mMaterials.size()); }
+		const std::vector<SceneLight> &getLights() const               { return mLights; }
+
+		/** Texture coordinates of a hit at barycentrics (u, v)
+		*/
+		float2 getTexCoords(uint32_t triangle, float u, float v) const;
+
+		/** Port of alphaTestFails() for a hit at barycentrics (u, v)
+		*/
+		bool alphaTestFails(uint32_t triangle, float u, float v) const;
+
+		/** True if any material can fail the alpha test, so traversal has to evaluate it
+		*/
+		bool hasAlphaTest() const;
+
+		/** 64-bit FNV-1a hash of the triangle positions, in order; keys caches of data derived from the geometry
+		*/
+		uint64_t getGeometryHash() const;
+
+		SceneCamera &getCamera()             { return mCamera; }
+		const SceneCamera &getCamera() const { return mCamera; }
+
+		/** Lat-long environment map the indirect rays that miss look up (wsVectorToLatLong()).  Without one, they see
+		    a constant color, like Falcor's default environment.
+		*/
+		void setEnvironmentMap(const ImageF4 &envMap) { mEnvMap = envMap; }
+		void setEnvironmentColor(const float3 &color) { mEnvColor = color; }
+		const ImageF4 &getEnvironmentMap() const { return mEnvMap; }
+		float3 evalEnvironment(const float3 &dir) const;
+
+	private:
+		Scene() = default;
+
+		std::vector<float3>             mPositions;     ///< Three per triangle
+		std::vector<TriangleAttributes> mAttributes;
+		std::vector<SceneMaterial>      mMaterials;
+		std::vector<SceneLight>         mLights;
+		SceneCamera                     mCamera;
+		ImageF4                         mEnvMap;
+		float3                          mEnvColor = float3(0.5f, 0.5f, 1.0f);
+		std::string                     mDirectory = ".";
+	};
+
+	/** Port of wsVectorToLatLong() from ggxGlobalIlluminationUtils.hlsli
+	*/
+	float2 wsVectorToLatLong(const float3 &dir);
+}
@@ -0,0 +1,289 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFBvh.h"
+#include "SVGFSimd.h"
+#include "SVGFSimdKernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SVGF_SIMD_X64 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace CpuSVGF
+{
+	namespace
+	{
+		/** One-lane wrapper, used as reference for the vector builds and on non-x64 targets
+		*/
+		struct ScalarOps
+		{
+			static const int kWidth = 1;
+			using V = float;
+			using M = bool;
+
+			static V    load(const float *p)        { return *p; }
+			static void store(float *p, V v)        { *p = v; }
+			static V    loadU8(const uint8_t *p)    { return float(*p); }
+			static void storeU8(uint8_t *p, V v)    { *p = uint8_t(std::nearbyint(v)); }
+			static V    set1(float v)               { return v; }
+			static V    lane()                      { return 0.0f; }
+			static V    add(V a, V b)               { return a + b; }
+			static V    sub(V a, V b)               { return a - b; }
+			static V    mul(V a, V b)               { return a * b; }
+			static V    mulRounded(V a, V b)        { return a * b; }
+			static V    div(V a, V b)               { return a / b; }
+			static V    min(V a, V b)               { return std::min(a, b); }
+			static V    max(V a, V b)               { return std::max(a, b); }
+			static V    abs(V a)                    { return std::abs(a); }
+			static V    sqrt(V a)                   { return std::sqrt(a); }
+			static V    floor(V a)                  { return std::floor(a); }
+			static V    pow2i(V n)                  { return asfloat(uint32_t(int32_t(n) + 127) << 23); }
+			static V    exponent(V a)               { return float(int32_t((asuint(a) >> 23) & 0xFFu) - 127); }
+			static V    mantissa(V a)               { return asfloat((asuint(a) & 0x007FFFFFu) | 0x3F800000u); }
+			static M    lt(V a, V b)                { return a < b; }
+			static M    ge(V a, V b)                { return a >= b; }
+			static M    andMask(M a, M b)           { return a && b; }
+			static V    select(M m, V a, V b)       { return m ? a : b; }
+			static uint32_t maskBits(M m)           { return m ? 1u : 0u; }
+			static M    fromBits(uint32_t bits)     { return (bits & 1u) != 0; }
+		};
+
+#ifdef SVGF_SIMD_X64
+		void cpuid(int leaf, int subLeaf, uint32_t regs[4])
+		{
+#ifdef _MSC_VER
+			int r[4];
+			__cpuidex(r, leaf, subLeaf);
+			for (int i = 0; i < 4; i++) regs[i] = uint32_t(r[i]);
+#else
+			__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		}
+
+		uint64_t xgetbv0()
+		{
+#ifdef _MSC_VER
+			return _xgetbv(0);
+#else
+			uint32_t lo, hi;
+			__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+			return (uint64_t(hi) << 32) | lo;
+#endif
+		}
+#endif
+	}
+
+	void atrousSimdScalar(const AtrousSimdArgs &args)
+	{
+		SimdKernels::atrousRows<ScalarOps>(args);
+	}
+
+	void geometryWeightsSimdScalar(const GeometryWeightSimdArgs &args)
+	{
+		SimdKernels::geometryWeightRows<ScalarOps>(args);
+	}
+
+	void upsampleSimdScalar(const UpsampleSimdArgs &args)
+	{
+		SimdKernels::upsampleIndirectRows<ScalarOps>(args);
+	}
+
+	void bvhPacketSimdScalar(const BvhPacketArgs &args)
+	{
+		SimdKernels::bvhPackets<ScalarOps>(args);
+	}
+
+	void convolveSimdScalar(const ConvolveSimdArgs &args)
+	{
+		SimdKernels::convolveRows<ScalarOps>(args);
+	}
+
+	void metricsSimdScalar(const MetricsSimdArgs &args)
+	{
+		SimdKernels::metricsRows<ScalarOps>(args);
+	}
+
+	void temporalAASimdScalar(const TemporalAASimdArgs &args)
+	{
+		SimdKernels::temporalAARows<ScalarOps>(args);
+	}
+
+	const char *getSimdIsaName(SimdIsa isa)
+	{
+		switch (isa)
+		{
+		case SimdIsa::Scalar: return "scalar";
+		case SimdIsa::SSE41:  return "sse4.1";
+		case SimdIsa::AVX2:   return "avx2";
+		case SimdIsa::AVX512: return "avx512";
+		default:              return "unknown";
+		}
+	}
+
+	SimdIsa detectSimdIsa()
+	{
+		static const SimdIsa sIsa = []()
+		{
+#ifdef SVGF_SIMD_X64
+			uint32_t r[4];
+			cpuid(0, 0, r);
+			const uint32_t maxLeaf = r[0];
+
+			cpuid(1, 0, r);
+			const bool sse41   = (r[2] & (1u << 19)) != 0;
+			const bool osxsave = (r[2] & (1u << 27)) != 0;
+			const bool avx     = (r[2] & (1u << 28)) != 0;
+			const bool fma     = (r[2] & (1u << 12)) != 0;
+			if (!sse41) return SimdIsa::Scalar;
+			if (!osxsave || !avx || maxLeaf < 7) return SimdIsa::SSE41;
+
+			// The OS must save the YMM (and for AVX-512, opmask and ZMM) state on context switches
+			const uint64_t xcr0 = xgetbv0();
+			const bool ymmState = (xcr0 & 0x6) == 0x6;
+			const bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+			cpuid(7, 0, r);
+			const bool avx2     = (r[1] & (1u << 5)) != 0;
+			const bool avx512f  = (r[1] & (1u << 16)) != 0;
+			const bool avx512dq = (r[1] & (1u << 17)) != 0;
+
+			if (avx512f && avx512dq && zmmState) return SimdIsa::AVX512;
+			if (avx2 && fma && ymmState)         return SimdIsa::AVX2;
+			return SimdIsa::SSE41;
+#else
+			return SimdIsa::Scalar;
+#endif
+		}();
+		return sIsa;
+	}
+
+	bool isSimdIsaSupported(SimdIsa isa)
+	{
+		return uint32_t(isa) <= uint32_t(detectSimdIsa());
+	}
+
+	AtrousSimdFunc getAtrousSimdKernel(SimdIsa isa)
+	{
+		if (!isSimdIsaSupported(isa)) return atrousSimdScalar;
+
+		switch (isa)
+		{
+#ifdef SVGF_SIMD_X64
+		case SimdIsa::SSE41:  return atrousSimdSSE41;
+		case SimdIsa::AVX2:   return atrousSimdAVX2;
+		case SimdIsa::AVX512: return atrousSimdAVX512;
+#endif
+		default:              return atrousSimdScalar;
+		}
+	}
+
+	GeometryWeightSimdFunc getGeometryWeightSimdKernel(SimdIsa isa)
+	{
+		if (!isSimdIsaSupported(isa)) return geometryWeightsSimdScalar;
+
+		switch (isa)
+		{
+#ifdef SVGF_SIMD_X64
+		case SimdIsa::SSE41:  return geometryWeightsSimdSSE41;
+		case SimdIsa::AVX2:   return geometryWeightsSimdAVX2;
+		case SimdIsa::AVX512: return geometryWeightsSimdAVX512;
+#endif
+		default:              return geometryWeightsSimdScalar;
+		}
+	}
+
+	UpsampleSimdFunc getUpsampleSimdKernel(SimdIsa isa)
+	{
+		if (!isSimdIsaSupported(isa)) return upsampleSimdScalar;
+
+		switch (isa)
+		{
+#ifdef SVGF_SIMD_X64
+		case SimdIsa::SSE41:  return upsampleSimdSSE41;
+		case SimdIsa::AVX2:   return upsampleSimdAVX2;
+		case SimdIsa::AVX512: return upsampleSimdAVX512;
+#endif
+		default:              return upsampleSimdScalar;
+		}
+	}
+
+	BvhPacketFunc getBvhPacketKernel(SimdIsa isa)
+	{
+		if (!isSimdIsaSupported(isa)) return bvhPacketSimdScalar;
+
+		switch (isa)
+		{
+#ifdef SVGF_SIMD_X64
+		case SimdIsa::SSE41:  return bvhPacketSimdSSE41;
+		case SimdIsa::AVX2:   return bvhPacketSimdAVX2;
+		case SimdIsa::AVX512: return bvhPacketSimdAVX512;
+#endif
+		default:              return bvhPacketSimdScalar;
+		}
+	}
+
+	ConvolveSimdFunc getConvolveSimdKernel(SimdIsa isa)
+	{
+		if (!isSimdIsaSupported(isa)) return convolveSimdScalar;
+
+		switch (isa)
+		{
+#ifdef SVGF_SIMD_X64
+		case SimdIsa::SSE41:  return convolveSimdSSE41;
+		case SimdIsa::AVX2:   return convolveSimdAVX2;
+		case SimdIsa::AVX512: return convolveSimdAVX512;
+#endif
+		default:              return convolveSimdScalar;
+		}
+	}
+
+	MetricsSimdFunc getMetricsSimdKernel(SimdIsa isa)
+	{
+		if (!isSimdIsaSupported(isa)) return metricsSimdScalar;
+
+		switch (isa)
+		{
+#ifdef SVGF_SIMD_X64
+		case SimdIsa::SSE41:  return metricsSimdSSE41;
+		case SimdIsa::AVX2:   return metricsSimdAVX2;
+		case SimdIsa::AVX512: return metricsSimdAVX512;
+#endif
+		default:              return metricsSimdScalar;
+		}
+	}
+
+	TemporalAASimdFunc getTemporalAASimdKernel(SimdIsa isa)
+	{
+		if (!isSimdIsaSupported(isa)) return temporalAASimdScalar;
+
+		switch (isa)
+		{
+#ifdef SVGF_SIMD_X64
+		case SimdIsa::SSE41:  return temporalAASimdSSE41;
+		case SimdIsa::AVX2:   return temporalAASimdAVX2;
+		case SimdIsa::AVX512: return temporalAASimdAVX512;
+#endif
+		default:              return temporalAASimdScalar;
+		}
+	}
+}
@@ -0,0 +1,304 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include "SVGFPlanar.h"
+#include "SVGFStorageFormat.h"
+
+namespace CpuSVGF
+{
+	/** Instruction sets the vectorized kernels are compiled for.  Scalar is a one-lane build of the same kernel.
+	*/
+	enum class SimdIsa : uint32_t
+	{
+		Scalar,
+		SSE41,
+		AVX2,
+		AVX512,
+		Count
+	};
+
+	const char *getSimdIsaName(SimdIsa isa);
+
+	/** The widest instruction set supported by both the CPU and the OS
+	*/
+	SimdIsa detectSimdIsa();
+
+	/** Whether kernels for isa were compiled in and can run on this machine
+	*/
+	bool isSimdIsaSupported(SimdIsa isa);
+
+	/** Arguments for one a-trous iteration over the planar buffers.  channels, radius and whether pModulated and
+	    pGeometryWeights are set pick a kernel variant compiled for them (see SVGFAtrous.ps.hlsl's ATROUS_* defines).
+	*/
+	struct AtrousSimdArgs
+	{
+		const PlanarImage *pIn;          ///< kIllumPlaneCount planes, luminance planes filled in
+		PlanarImage       *pOut;         ///< Same layout; luminance of the result is written too
+		const PlanarImage *pGeometry;    ///< kGeometryPlaneCount planes
+		int                stepSize;
+		float              phiColor;
+		float              phiNormal;
+		int                y0, y1;       ///< Rows to process
+		int                x0 = 0;       ///< Columns to process; x0 and x1 must be multiples of 16 unless x1 >= width
+		int                x1 = INT32_MAX;
+		uint32_t           channels = kBothChannels;   ///< IllumChannels to filter; the planes of the others are left untouched
+		int                radius   = 2;               ///< 1 (3x3 taps) or 2 (5x5 taps)
+		ImageF4           *pModulated   = nullptr;     ///< Optional:  also write the result modulated with the albedos here,
+		const ImageF4     *pAlbedo      = nullptr;     ///  for the columns and rows processed
+		const ImageF4     *pIndirAlbedo = nullptr;
+		const uint8_t     *pGeometryWeights = nullptr; ///< Optional:  this iteration's planes of the geometry weight cache, in
+		                                               ///  which case the depth term isn't recomputed (see GeometryWeightSimdArgs)
+		ImageF4           *pHistoryDirect   = nullptr; ///< Optional:  also write the demodulated result, rounded to historyFormat,
+		ImageF4           *pHistoryIndirect = nullptr; ///  here (the feedback iteration in blit-free mode)
+		StorageFormat      historyFormat    = StorageFormat::Full;
+	};
+
+	using AtrousSimdFunc = void (*)(const AtrousSimdArgs &args);
+
+	/** Vectorized port of SVGFAtrous.ps.hlsl.  The returned function dispatches each call to the variant for its
+	    arguments.  Returns the Scalar build if isa is not supported.
+	*/
+	AtrousSimdFunc getAtrousSimdKernel(SimdIsa isa);
+
+	/** Taps of the 5x5 a-trous kernel besides the center.  The geometry weight cache has a plane per tap and iteration.
+	*/
+	static const uint32_t kAtrousTapCount = 24;
+
+	/** Bytes of one plane of the geometry weight cache; rows are padded like PlanarImage's
+	*/
+	inline size_t getGeometryWeightPlaneSize(uint32_t width, uint32_t height) { return size_t(PlanarImage::getStride(width)) * height; }
+
+	/** Arguments for filling the geometry weight cache.  For every a-trous iteration and tap, the cache holds the
+	    edge-stopping weight the geometry alone gives that tap (exp(-wZ), normalDistanceCos() being a constant 1),
+	    quantized to 8 bits, and 0 where the tap is off screen.  Iteration i owns kAtrousTapCount planes starting
+	    at pWeights + i * kAtrousTapCount * getGeometryWeightPlaneSize(), ordered like the taps of the 5x5 kernel.
+	*/
+	struct GeometryWeightSimdArgs
+	{
+		const PlanarImage *pGeometry;    ///< kGeometryPlaneCount planes
+		uint8_t           *pWeights;
+		int                iterations;
+		int                y0, y1;       ///< Rows to process
+		int                radius = 2;   ///< Taps outside the a-trous kernel's radius are left out
+	};
+
+	using GeometryWeightSimdFunc = void (*)(const GeometryWeightSimdArgs &args);
+
+	/** Pre-pass computing the geometry weights of every iteration at once.  Returns the Scalar build if isa is not
+	    supported.
+	*/
+	GeometryWeightSimdFunc getGeometryWeightSimdKernel(SimdIsa isa);
+
+	/** Arguments for upsampling indirect illumination filtered at 1/scale of the resolution (Settings::indirectScale).
+	    Each pixel takes the bilinear weights of the four nearest low resolution pixels, scaled down by their
+	    difference in depth (relative to the depth slope across a low resolution pixel) and normal (cos^32).  When
+	    every tap is rejected, the one closest in depth is used.
+	*/
+	struct UpsampleSimdArgs
+	{
+		const PlanarImage *pGeometry;      ///< kGeometryPlaneCount planes at full resolution
+		const PlanarImage *pLowGeometry;   ///< kGeometryPlaneCount planes at reduced resolution
+		const ImageF4     *pLowIndirect;   ///< Filtered indirect at reduced resolution
+		const ImageF4     *pIndirAlbedo;
+		ImageF4           *pOutput;        ///< The indirect is modulated and added to it
+		int                scale;
+		int                y0, y1;         ///< Rows to process
+	};
+
+	using UpsampleSimdFunc = void (*)(const UpsampleSimdArgs &args);
+
+	/** Returns the Scalar build if isa is not supported
+	*/
+	UpsampleSimdFunc getUpsampleSimdKernel(SimdIsa isa);
+
+	struct BvhNode;
+	struct Ray;
+	struct RayHit;
+	class Scene;
+
+	/** Arguments for tracing rays through a TriangleBvh in packets of the instruction set's width.  Each packet
+	    traverses the tree together, visiting a node if any of its live rays hits the node's bounds.
+	*/
+	struct BvhPacketArgs
+	{
+		const BvhNode  *pNodes;
+		const float3   *pTriangles;      ///< TriangleBvh's leaf order data:  vertex 0 and two edges per triangle
+		const uint32_t *pTriangleIds;
+		const Scene    *pAlphaScene;     ///< Set if hits must pass Scene::alphaTestFails(), else nullptr
+		const Ray      *pRays;
+		const uint32_t *pOrder;          ///< Optional:  trace pRays[pOrder[i]], so that packets are formed in this order
+		uint32_t        count;
+		RayHit         *pHits;           ///< Closest hit per ray; nullptr for an any-hit (occlusion) query
+		uint8_t        *pFound;          ///< 1 per ray that hit anything, else 0
+	};
+
+	using BvhPacketFunc = void (*)(const BvhPacketArgs &args);
+
+	/** Packet traversal with the same hits as TriangleBvh::intersect() / occluded().  Returns the Scalar build (one
+	    ray per packet) if isa is not supported.
+	*/
+	BvhPacketFunc getBvhPacketKernel(SimdIsa isa);
+
+	/** Largest radius ConvolveSimdArgs takes
+	*/
+	static const int kMaxConvolveRadius = 64;
+
+	/** Arguments for a 1D convolution of a float plane along rows (horizontal) or columns (vertical), clamping
+	    taps to the edge.  Row y of the input starts at pIn + y * stride, and output row y at pOut + (y - y0) * stride.
+	*/
+	struct ConvolveSimdArgs
+	{
+		const float *pIn;
+		const float *pInScale = nullptr; ///< Optional:  convolve pIn * pInScale (same layout as pIn); horizontal only
+		float       *pOut;
+		int          width, height, stride;
+		const float *pWeights;           ///< 2 * radius + 1 taps, from -radius to radius
+		int          radius;
+		bool         vertical;
+		bool         accumulate = false; ///< Add to pOut instead of overwriting it
+		int          y0, y1;             ///< Rows to write
+	};
+
+	using ConvolveSimdFunc = void (*)(const ConvolveSimdArgs &args);
+
+	/** Separable filter pass for the image metrics (see SVGFMetrics.h).  Returns the Scalar build if isa is not
+	    supported.
+	*/
+	ConvolveSimdFunc getConvolveSimdKernel(SimdIsa isa);
+
+	/** Pixel passes of MetricsEvaluator, each over a band of rows
+	*/
+	enum class MetricsSimdStage : uint32_t
+	{
+		Prepare,            ///< Linear rgb to the display image's YCxCz, luminance and luma; error and flicker sums
+		FinishReference,    ///< Filtered YCxCz and features of the reference to Hunt-adjusted L*a*b* and feature magnitudes
+		Compare,            ///< FLIP and SSIM sums of an image against the finished reference
+	};
+
+	/** Sums over a band of rows; each stage adds to the ones it computes
+	*/
+	struct MetricsSimdSums
+	{
+		double squaredError    = 0.0;   ///< Prepare, when pRefColor is set:  over rgb
+		double relSquaredError = 0.0;   ///< Prepare, when pRefColor is set:  (a - b)^2 / (b^2 + relMseEpsilon) over rgb
+		double flicker         = 0.0;   ///< Prepare, when hasPrevious is set:  squared luma change not in the reference
+		double flip            = 0.0;   ///< Compare
+		double ssim            = 0.0;   ///< Compare
+	};
+
+	/** Arguments for one metrics pass.  Every plane has width valid floats per row, rowCount rows and rows stride
+	    floats apart, starting at the pointer given (so planes of a whole image are passed offset to the band).
+	*/
+	struct MetricsSimdArgs
+	{
+		MetricsSimdStage stage;
+		int              width, rowCount, stride;
+		MetricsSimdSums *pSums;
+
+		// Prepare
+		float        exposure = 1.0f;           ///< Display mapping:  clamp(exposure * rgb, 0, 1)
+		float        relMseEpsilon = 1e-2f;
+		const float *pColor[3]    = {};         ///< Linear rgb
+		const float *pRefColor[3] = {};         ///< Optional:  linear rgb of the reference, for the error sums
+		float       *pOpponent[3] = {};         ///< Out:  YCxCz of the display image
+		float       *pLuminance   = nullptr;    ///< Out:  its luminance, Y / Yn
+		float       *pLuma        = nullptr;    ///< Out:  its luminance sRGB encoded
+		const float *pRefLuma     = nullptr;    ///< Optional, flicker:  the reference's pLuma
+		float       *pPrevDifference = nullptr; ///< Optional, flicker:  the previous frame's luma minus its reference's,
+		                                        ///  replaced by this frame's
+		bool         hasPrevious  = false;      ///< Whether pPrevDifference holds a frame yet
+
+		// FinishReference and Compare
+		const float *pFiltered[3] = {};         ///< YCxCz after the contrast sensitivity filters
+		const float *pFeatures[4] = {};         ///< Edge x, edge y, point x, point y responses of the luminance
+		float       *pLab[3]      = {};         ///< FinishReference out:  Hunt-adjusted L*a*b* of pFiltered
+		float       *pFeatureMagnitude[2] = {}; ///  and the edge and point magnitudes
+		const float *pRefLab[3]   = {};         ///< Compare:  the reference's pLab
+		const float *pRefFeatureMagnitude[2] = {};
+		const float *pMoments[3]  = {};         ///< Compare:  local mean of luma, luma^2 and luma * reference luma
+		const float *pRefMoments[2] = {};       ///  and of the reference's luma and luma^2
+		float        flipCMax     = 1.0f;       ///< HyAB distance of green and blue raised to 0.7, FLIP's cmax
+	};
+
+	using MetricsSimdFunc = void (*)(const MetricsSimdArgs &args);
+
+	/** Pixel passes of the image metrics (see SVGFMetrics.h).  Returns the Scalar build if isa is not supported.
+	*/
+	MetricsSimdFunc getMetricsSimdKernel(SimdIsa isa);
+
+	/** Pixel passes of TemporalAA (see SVGFTemporalAA.h), each over a band of rows
+	*/
+	enum class TemporalAASimdStage : uint32_t
+	{
+		ToYCoCg,            ///< This frame's color to YCoCg planes
+		Resolve,            ///< Clamp the reprojected history to each pixel's neighborhood and blend this frame in
+	};
+
+	/** Arguments for one pass of the vectorized port of SVGFTemporalAA.ps.hlsl
+	*/
+	struct TemporalAASimdArgs
+	{
+		TemporalAASimdStage stage;
+		const ImageF4 *pColor;           ///< This frame, linear rgb
+		PlanarImage   *pYCoCg;           ///< 3 planes:  written by ToYCoCg, read by Resolve
+		const ImageF4 *pMotion  = nullptr;   ///< Resolve:  "SVGF_MotionVecs"
+		const ImageF4 *pHistory = nullptr;   ///< Resolve:  last frame's output, nullptr on the first frame
+		ImageF4       *pOutput  = nullptr;   ///< Resolve:  the shader's color and history targets, which are the same
+		ImageF4       *pNewHistory = nullptr;
+		float          alpha = 0.1f;
+		int            y0, y1;           ///< Rows to process
+	};
+
+	using TemporalAASimdFunc = void (*)(const TemporalAASimdArgs &args);
+
+	/** Returns the Scalar build if isa is not supported.  Its output is bit-identical to temporalAAPixel() for
+	    every instruction set.
+	*/
+	TemporalAASimdFunc getTemporalAASimdKernel(SimdIsa isa);
+
+	// Per-ISA entry points, each compiled in its own translation unit with the matching code generation flags
+	void atrousSimdScalar(const AtrousSimdArgs &args);
+	void atrousSimdSSE41(const AtrousSimdArgs &args);
+	void atrousSimdAVX2(const AtrousSimdArgs &args);
+	void atrousSimdAVX512(const AtrousSimdArgs &args);
+	void geometryWeightsSimdScalar(const GeometryWeightSimdArgs &args);
+	void geometryWeightsSimdSSE41(const GeometryWeightSimdArgs &args);
+	void geometryWeightsSimdAVX2(const GeometryWeightSimdArgs &args);
+	void geometryWeightsSimdAVX512(const GeometryWeightSimdArgs &args);
+	void upsampleSimdScalar(const UpsampleSimdArgs &args);
+	void upsampleSimdSSE41(const UpsampleSimdArgs &args);
+	void upsampleSimdAVX2(const UpsampleSimdArgs &args);
+	void upsampleSimdAVX512(const UpsampleSimdArgs &args);
+	void bvhPacketSimdScalar(const BvhPacketArgs &args);
+	void bvhPacketSimdSSE41(const BvhPacketArgs &args);
+	void bvhPacketSimdAVX2(const BvhPacketArgs &args);
+	void bvhPacketSimdAVX512(const BvhPacketArgs &args);
+	void convolveSimdScalar(const ConvolveSimdArgs &args);
+	void convolveSimdSSE41(const ConvolveSimdArgs &args);
+	void convolveSimdAVX2(const ConvolveSimdArgs &args);
+	void convolveSimdAVX512(const ConvolveSimdArgs &args);
+	void metricsSimdScalar(const MetricsSimdArgs &args);
+	void metricsSimdSSE41(const MetricsSimdArgs &args);
+	void metricsSimdAVX2(const MetricsSimdArgs &args);
+	void metricsSimdAVX512(const MetricsSimdArgs &args);
+	void temporalAASimdScalar(const TemporalAASimdArgs &args);
+	void temporalAASimdSSE41(const TemporalAASimdArgs &args);
+	void temporalAASimdAVX2(const TemporalAASimdArgs &args);
+	void temporalAASimdAVX512(const TemporalAASimdArgs &args);
+}
@@ -0,0 +1,113 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include "SVGFBvh.h"
+#include "SVGFSimd.h"
+#include <immintrin.h>
+
+// Everything shared with the other translation units is included above, so only the kernel templates and the
+//     wrapper below get compiled for the wider instruction set.  MSVC needs no flag for the intrinsics.
+#if defined(__GNUC__) && !defined(__AVX2__)
+#pragma GCC target("avx2,fma")
+#endif
+#include "SVGFSimdKernels.h"
+
+namespace CpuSVGF
+{
+	namespace
+	{
+		// GCC fuses a multiply and a dependent add into an FMA unless it can't see the product; MSVC doesn't fuse intrinsics
+		template <typename T> inline T opaque(T v)
+		{
+#ifdef __GNUC__
+			__asm__("" : "+v"(v));
+#endif
+			return v;
+		}
+
+		struct AVX2Ops
+		{
+			static const int kWidth = 8;
+			using V = __m256;
+			using M = __m256;
+
+			static V    load(const float *p)        { return _mm256_loadu_ps(p); }
+			static void store(float *p, V v)        { _mm256_storeu_ps(p, v); }
+			static V    loadU8(const uint8_t *p)    { return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p))); }
+			static void storeU8(uint8_t *p, V v)    { __m256i i = _mm256_cvtps_epi32(v); __m128i w = _mm_packus_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1)); _mm_storel_epi64((__m128i *)p, _mm_packus_epi16(w, w)); }
+			static V    set1(float v)               { return _mm256_set1_ps(v); }
+			static V    lane()                      { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+			static V    add(V a, V b)               { return _mm256_add_ps(a, b); }
+			static V    sub(V a, V b)               { return _mm256_sub_ps(a, b); }
+			static V    mul(V a, V b)               { return _mm256_mul_ps(a, b); }
+			static V    mulRounded(V a, V b)        { return opaque(_mm256_mul_ps(a, b)); }
+			static V    div(V a, V b)               { return _mm256_div_ps(a, b); }
+			static V    min(V a, V b)               { return _mm256_min_ps(a, b); }
+			static V    max(V a, V b)               { return _mm256_max_ps(a, b); }
+			static V    abs(V a)                    { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+			static V    sqrt(V a)                   { return _mm256_sqrt_ps(a); }
+			static V    floor(V a)                  { return _mm256_floor_ps(a); }
+			static V    pow2i(V n)                  { return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(n), _mm256_set1_epi32(127)), 23)); }
+			static V    exponent(V a)               { return _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_and_si256(_mm256_srli_epi32(_mm256_castps_si256(a), 23), _mm256_set1_epi32(0xFF)), _mm256_set1_epi32(127))); }
+			static V    mantissa(V a)               { return _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(_mm256_castps_si256(a), _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000))); }
+			static M    lt(V a, V b)                { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+			static M    ge(V a, V b)                { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+			static M    andMask(M a, M b)           { return _mm256_and_ps(a, b); }
+			static V    select(M m, V a, V b)       { return _mm256_blendv_ps(b, a, m); }
+			static uint32_t maskBits(M m)           { return uint32_t(_mm256_movemask_ps(m)); }
+			static M    fromBits(uint32_t bits)     { const __m256i b = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128); return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(int(bits)), b), b)); }
+		};
+	}
+
+	void atrousSimdAVX2(const AtrousSimdArgs &args)
+	{
+		SimdKernels::atrousRows<AVX2Ops>(args);
+	}
+
+	void geometryWeightsSimdAVX2(const GeometryWeightSimdArgs &args)
+	{
+		SimdKernels::geometryWeightRows<AVX2Ops>(args);
+	}
+
+	void upsampleSimdAVX2(const UpsampleSimdArgs &args)
+	{
+		SimdKernels::upsampleIndirectRows<AVX2Ops>(args);
+	}
+
+	void bvhPacketSimdAVX2(const BvhPacketArgs &args)
+	{
+		SimdKernels::bvhPackets<AVX2Ops>(args);
+	}
+
+	void convolveSimdAVX2(const ConvolveSimdArgs &args)
+	{
+		SimdKernels::convolveRows<AVX2Ops>(args);
+	}
+
+	void metricsSimdAVX2(const MetricsSimdArgs &args)
+	{
+		SimdKernels::metricsRows<AVX2Ops>(args);
+	}
+
+	void temporalAASimdAVX2(const TemporalAASimdArgs &args)
+	{
+		SimdKernels::temporalAARows<AVX2Ops>(args);
+	}
+}
+#endif
@@ -0,0 +1,113 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include "SVGFBvh.h"
+#include "SVGFSimd.h"
+#include <immintrin.h>
+
+// Everything shared with the other translation units is included above, so only the kernel templates and the
+//     wrapper below get compiled for the wider instruction set.  MSVC needs no flag for the intrinsics.
+#if defined(__GNUC__) && !defined(__AVX512F__)
+#pragma GCC target("avx512f,avx512dq")
+#endif
+#include "SVGFSimdKernels.h"
+
+namespace CpuSVGF
+{
+	namespace
+	{
+		// GCC fuses a multiply and a dependent add into an FMA unless it can't see the product; MSVC doesn't fuse intrinsics
+		template <typename T> inline T opaque(T v)
+		{
+#ifdef __GNUC__
+			__asm__("" : "+v"(v));
+#endif
+			return v;
+		}
+
+		struct AVX512Ops
+		{
+			static const int kWidth = 16;
+			using V = __m512;
+			using M = __mmask16;
+
+			static V    load(const float *p)        { return _mm512_loadu_ps(p); }
+			static void store(float *p, V v)        { _mm512_storeu_ps(p, v); }
+			static V    loadU8(const uint8_t *p)    { return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)p))); }
+			static void storeU8(uint8_t *p, V v)    { _mm_storeu_si128((__m128i *)p, _mm512_cvtusepi32_epi8(_mm512_cvtps_epi32(v))); }
+			static V    set1(float v)               { return _mm512_set1_ps(v); }
+			static V    lane()                      { return _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f); }
+			static V    add(V a, V b)               { return _mm512_add_ps(a, b); }
+			static V    sub(V a, V b)               { return _mm512_sub_ps(a, b); }
+			static V    mul(V a, V b)               { return _mm512_mul_ps(a, b); }
+			static V    mulRounded(V a, V b)        { return opaque(_mm512_mul_ps(a, b)); }
+			static V    div(V a, V b)               { return _mm512_div_ps(a, b); }
+			static V    min(V a, V b)               { return _mm512_min_ps(a, b); }
+			static V    max(V a, V b)               { return _mm512_max_ps(a, b); }
+			static V    abs(V a)                    { return _mm512_abs_ps(a); }
+			static V    sqrt(V a)                   { return _mm512_sqrt_ps(a); }
+			static V    floor(V a)                  { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+			static V    pow2i(V n)                  { return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(_mm512_cvttps_epi32(n), _mm512_set1_epi32(127)), 23)); }
+			static V    exponent(V a)               { return _mm512_getexp_ps(a); }
+			static V    mantissa(V a)               { return _mm512_getmant_ps(a, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src); }
+			static M    lt(V a, V b)                { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+			static M    ge(V a, V b)                { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+			static M    andMask(M a, M b)           { return M(a & b); }
+			static V    select(M m, V a, V b)       { return _mm512_mask_blend_ps(m, b, a); }
+			static uint32_t maskBits(M m)           { return uint32_t(m); }
+			static M    fromBits(uint32_t bits)     { return M(bits); }
+		};
+	}
+
+	void atrousSimdAVX512(const AtrousSimdArgs &args)
+	{
+		SimdKernels::atrousRows<AVX512Ops>(args);
+	}
+
+	void geometryWeightsSimdAVX512(const GeometryWeightSimdArgs &args)
+	{
+		SimdKernels::geometryWeightRows<AVX512Ops>(args);
+	}
+
+	void upsampleSimdAVX512(const UpsampleSimdArgs &args)
+	{
+		SimdKernels::upsampleIndirectRows<AVX512Ops>(args);
+	}
+
+	void bvhPacketSimdAVX512(const BvhPacketArgs &args)
+	{
+		SimdKernels::bvhPackets<AVX512Ops>(args);
+	}
+
+	void convolveSimdAVX512(const ConvolveSimdArgs &args)
+	{
+		SimdKernels::convolveRows<AVX512Ops>(args);
+	}
+
+	void metricsSimdAVX512(const MetricsSimdArgs &args)
+	{
+		SimdKernels::metricsRows<AVX512Ops>(args);
+	}
+
+	void temporalAASimdAVX512(const TemporalAASimdArgs &args)
+	{
+		SimdKernels::temporalAARows<AVX512Ops>(args);
+	}
+}
+#endif
@@ -0,0 +1,1317 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Width-agnostic kernels shared by the SVGFSimd*.cpp translation units.  Each of those defines a wrapper type
+//     (S) around its intrinsics and instantiates the templates below.  Do not include this anywhere else:
+//     the code must be compiled with the instruction set of the wrapper it's instantiated with.
+//
+//     The wrapper provides:  S::kWidth, S::V (float vector), S::M (lane mask), and static functions
+//     load, store, set1, lane (0, 1, 2, ...), add, sub, mul, mulRounded (a product the compiler may not fuse into an
+//     FMA, for results that must match scalar code bit for bit), div, min, max, abs, sqrt, floor,
+//     pow2i (2^n for integral n), exponent / mantissa (e and m of a = m * 2^e, m in [1, 2), for positive normal a),
+//     lt, ge, andMask, select, maskBits / fromBits (lane mask to and from the low W bits of an integer), and
+//     loadU8 / storeU8 (W bytes to and from floats in [0, 255], rounding to nearest).
+
+#pragma once
+#include "SVGFBvh.h"
+#include "SVGFKernels.h"
+#include "SVGFSimd.h"
+
+namespace CpuSVGF
+{
+	namespace SimdKernels
+	{
+		/** Cephes-style expf():  2^n * p(r), r in [-ln2/2, ln2/2].  Relative error is within a couple of ulps of
+		    std::exp over the range the edge-stopping functions produce (always <= 0).
+		*/
+		template <typename S>
+		typename S::V expApprox(typename S::V x)
+		{
+			using V = typename S::V;
+			x = S::max(x, S::set1(-87.3f));
+			x = S::min(x, S::set1(88.3f));
+
+			V n = S::floor(S::add(S::mul(x, S::set1(1.44269504088896341f)), S::set1(0.5f)));
+			V r = S::sub(x, S::mul(n, S::set1(0.693359375f)));
+			r   = S::sub(r, S::mul(n, S::set1(-2.12194440e-4f)));
+
+			V p = S::set1(1.9875691500E-4f);
+			p = S::add(S::mul(p, r), S::set1(1.3981999507E-3f));
+			p = S::add(S::mul(p, r), S::set1(8.3334519073E-3f));
+			p = S::add(S::mul(p, r), S::set1(4.1665795894E-2f));
+			p = S::add(S::mul(p, r), S::set1(1.6666665459E-1f));
+			p = S::add(S::mul(p, r), S::set1(5.0000001201E-1f));
+			p = S::add(S::add(S::mul(S::mul(p, r), r), r), S::set1(1.0f));
+
+			return S::mul(p, S::pow2i(n));
+		}
+
+		/** exp() to about 6e-4 relative error, for weights that are stored with 8 bits anyway:  2^n * 2^f with a cubic
+		    for 2^f, f in [-1/2, 1/2].  Valid for x <= 0.
+		*/
+		template <typename S>
+		typename S::V expCoarse(typename S::V x)
+		{
+			using V = typename S::V;
+			V t = S::mul(S::max(x, S::set1(-87.3f)), S::set1(1.44269504088896341f));
+			V n = S::floor(S::add(t, S::set1(0.5f)));
+			V f = S::sub(t, n);
+
+			V p = S::set1(5.5504109e-2f);
+			p = S::add(S::mul(p, f), S::set1(2.4022651e-1f));
+			p = S::add(S::mul(p, f), S::set1(6.9314718e-1f));
+			p = S::add(S::mul(p, f), S::set1(1.0f));
+			return S::mul(p, S::pow2i(n));
+		}
+
+		/** Load W consecutive floats starting at column x0 of a row; lanes outside [0, width) read zero,
+		    like an out of bounds Texture2D.Load()
+		*/
+		template <typename S>
+		typename S::V loadRow(const float *pRow, int x0, int width)
+		{
+			if (x0 >= 0 && x0 + S::kWidth <= width)
+				return S::load(pRow + x0);
+
+			alignas(64) float tmp[S::kWidth];
+			for (int lane = 0; lane < S::kWidth; lane++)
+			{
+				int x = x0 + lane;
+				tmp[lane] = (x >= 0 && x < width) ? pRow[x] : 0.0f;
+			}
+			return S::load(tmp);
+		}
+
+		/** Plane of tap (xx, yy) of the 5x5 kernel in the geometry weight cache:  row-major, skipping the center
+		*/
+		inline int getAtrousTapIndex(int xx, int yy)
+		{
+			const int i = (yy + 2) * 5 + (xx + 2);
+			return i > 12 ? i - 1 : i;
+		}
+
+		/** length(float2(xx, yy)) for every tap, exactly as the shader computes it
+		*/
+		struct AtrousTapLengths
+		{
+			float v[5][5];
+			AtrousTapLengths()
+			{
+				for (int yy = -2; yy <= 2; yy++)
+					for (int xx = -2; xx <= 2; xx++)
+						v[yy + 2][xx + 2] = length(float2(float(xx), float(yy)));
+			}
+		};
+
+		/** Fill the geometry weight cache for args' rows; see GeometryWeightSimdArgs.  The weights are the depth term
+		    of atrousRowsChannels() for each iteration's step size, with the division replaced by a reciprocal:  the
+		    rounding to 8 bits hides the difference.  Each plane's row is written in one sweep.
+		*/
+		template <typename S>
+		void geometryWeightRows(const GeometryWeightSimdArgs &args)
+		{
+			using V = typename S::V;
+			const int W = S::kWidth;
+
+			const PlanarImage &geom = *args.pGeometry;
+			const int width  = int(geom.getWidth());
+			const int height = int(geom.getHeight());
+			const int stride = int(geom.getStride());
+			const size_t planeSize = getGeometryWeightPlaneSize(uint32_t(width), uint32_t(height));
+
+			const float *pZ      = geom.getPlane(kLinearZ);
+			const float *pZDeriv = geom.getPlane(kLinearZDeriv);
+			const AtrousTapLengths tapLength;
+
+			const V zero   = S::set1(0.0f);
+			const V one    = S::set1(1.0f);
+			const V scale  = S::set1(255.0f);
+			const V widthV = S::set1(float(width));
+
+			// 1 / max(zDeriv, 1e-8) of the current row
+			std::vector<float> rcpDeriv(stride);
+
+			for (int y = args.y0; y < args.y1; y++)
+			{
+				const size_t rowStart = size_t(y) * stride;
+				for (int x0 = 0; x0 < width; x0 += W)
+					S::store(rcpDeriv.data() + x0, S::div(one, S::max(S::load(pZDeriv + rowStart + x0), S::set1(1e-8f))));
+
+				for (int i = 0; i < args.iterations; i++)
+				{
+					const int step = 1 << i;
+					uint8_t *pPlanes = args.pWeights + size_t(i) * kAtrousTapCount * planeSize;
+
+					for (int yy = -args.radius; yy <= args.radius; yy++)
+					{
+						// Rows off screen are skipped by the a-trous kernel, so their weights are never read
+						const int py = y + yy * step;
+						if (py < 0 || py >= height) continue;
+						const size_t row = size_t(py) * stride;
+
+						for (int xx = -args.radius; xx <= args.radius; xx++)
+						{
+							if (xx == 0 && yy == 0) continue;
+							uint8_t *pDst = pPlanes + getAtrousTapIndex(xx, yy) * planeSize + rowStart;
+							const V rcpStep = S::set1(1.0f / (float(step) * tapLength.v[yy + 2][xx + 2]));
+
+							for (int x0 = 0; x0 < width; x0 += W)
+							{
+								const int px0 = x0 + xx * step;
+								if (px0 >= width || px0 + W <= 0)
+								{
+									S::storeU8(pDst + x0, zero);
+									continue;
+								}
+
+								const V zP = loadRow<S>(pZ + row, px0, width);
+								const V wZ = S::mul(S::mul(S::abs(S::sub(S::load(pZ + rowStart + x0), zP)), S::load(rcpDeriv.data() + x0)), rcpStep);
+								V w = S::mul(expCoarse<S>(S::sub(zero, S::max(wZ, zero))), scale);
+								if (px0 < 0 || px0 + W > width)
+								{
+									const V pxV = S::add(S::set1(float(px0)), S::lane());
+									w = S::select(S::andMask(S::ge(pxV, zero), S::lt(pxV, widthV)), w, zero);
+								}
+								S::storeU8(pDst + x0, w);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		/** One a-trous iteration over args' rows, specialized like SVGFAtrous.ps.hlsl's ATROUS_* defines:  for the
+		    channels enabled at compile time (they share the geometry loads and depth weight; a disabled channel costs
+		    nothing), with or without modulating into args.pModulated, and for a kernel of kRadius.  With
+		    kCachedGeometry the depth weight comes from args.pGeometryWeights, and only the luminance terms are
+		    evaluated per tap.
+		*/
+		template <typename S, bool kDirect, bool kIndirect, bool kModulate, int kRadius, bool kCachedGeometry>
+		void atrousRowsVariant(const AtrousSimdArgs &args)
+		{
+			using V = typename S::V;
+			using M = typename S::M;
+			const int W = S::kWidth;
+
+			const PlanarImage &in   = *args.pIn;
+			const PlanarImage &geom = *args.pGeometry;
+			PlanarImage       &out  = *args.pOut;
+
+			const int width  = int(in.getWidth());
+			const int height = int(in.getHeight());
+			const int stride = int(in.getStride());
+			const int step   = args.stepSize;
+
+			const float *src[kIllumPlaneCount];
+			float       *dst[kIllumPlaneCount];
+			for (uint32_t i = 0; i < kIllumPlaneCount; i++) { src[i] = in.getPlane(i); dst[i] = out.getPlane(i); }
+			const float *pZ      = geom.getPlane(kLinearZ);
+			const float *pZDeriv = geom.getPlane(kLinearZDeriv);
+			const size_t planeSize = getGeometryWeightPlaneSize(uint32_t(width), uint32_t(height));
+
+			const float epsVariance      = 1e-10f;
+			const float kernelWeights[3] = { 1.0f, kRadius == 1 ? 1.0f / 2.0f : 2.0f / 3.0f, 1.0f / 6.0f };
+			const float varKernel[2][2]  = { { 1.0f / 4.0f, 1.0f / 8.0f }, { 1.0f / 8.0f, 1.0f / 16.0f } };
+			const AtrousTapLengths tapLength;
+
+			const V zero     = S::set1(0.0f);
+			const V one      = S::set1(1.0f);
+			const V widthV   = S::set1(float(width));
+			const V lumR     = S::set1(0.2126f), lumG = S::set1(0.7152f), lumB = S::set1(0.0722f);
+
+			const int xEnd = std::min(args.x1, width);
+			for (int y = args.y0; y < args.y1; y++)
+			{
+				for (int x0 = args.x0; x0 < xEnd; x0 += W)
+				{
+					const size_t c = size_t(y) * stride + x0;
+
+					V dirR = zero, dirG = zero, dirB = zero, dirVar = zero, lDirectCenter = zero;
+					V indR = zero, indG = zero, indB = zero, indVar = zero, lIndirectCenter = zero;
+					if (kDirect)
+					{
+						dirR = S::load(src[kDirectR] + c); dirG = S::load(src[kDirectG] + c); dirB = S::load(src[kDirectB] + c); dirVar = S::load(src[kDirectVar] + c);
+						lDirectCenter = S::load(src[kDirectLum] + c);
+					}
+					if (kIndirect)
+					{
+						indR = S::load(src[kIndirectR] + c); indG = S::load(src[kIndirectG] + c); indB = S::load(src[kIndirectB] + c); indVar = S::load(src[kIndirectVar] + c);
+						lIndirectCenter = S::load(src[kIndirectLum] + c);
+					}
+					const V zCenter         = S::load(pZ + c);
+					const V zCenterDeriv    = S::load(pZDeriv + c);
+
+					// variance for direct and indirect, filtered using 3x3 gaussian blur
+					V varDirect = zero, varIndirect = zero;
+					for (int yy = -1; yy <= 1; yy++)
+					{
+						const int py = y + yy;
+						if (py < 0 || py >= height) continue;   // Out of bounds taps read zero
+						for (int xx = -1; xx <= 1; xx++)
+						{
+							const V k = S::set1(varKernel[std::abs(xx)][std::abs(yy)]);
+							if (kDirect)   varDirect   = S::add(varDirect,   S::mul(loadRow<S>(src[kDirectVar]   + size_t(py) * stride, x0 + xx, width), k));
+							if (kIndirect) varIndirect = S::add(varIndirect, S::mul(loadRow<S>(src[kIndirectVar] + size_t(py) * stride, x0 + xx, width), k));
+						}
+					}
+
+					const V phiColor     = S::set1(args.phiColor);
+					const V phiLDirect   = S::mul(phiColor, S::sqrt(S::max(zero, S::add(S::set1(epsVariance), varDirect))));
+					const V phiLIndirect = S::mul(phiColor, S::sqrt(S::max(zero, S::add(S::set1(epsVariance), varIndirect))));
+					const V phiDepth     = S::mul(S::max(zCenterDeriv, S::set1(1e-8f)), S::set1(float(step)));
+
+					// explicitly accumulate center pixel with weight 1
+					V sumWDirect = one, sumWIndirect = one;
+					V sumDR = dirR, sumDG = dirG, sumDB = dirB, sumDVar = dirVar;
+					V sumIR = indR, sumIG = indG, sumIB = indB, sumIVar = indVar;
+
+					for (int yy = -kRadius; yy <= kRadius; yy++)
+					{
+						const int py = y + yy * step;
+						if (py < 0 || py >= height) continue;
+						const size_t row = size_t(py) * stride;
+
+						for (int xx = -kRadius; xx <= kRadius; xx++)
+						{
+							if (xx == 0 && yy == 0) continue;
+							const int px0 = x0 + xx * step;
+							if (px0 >= width || px0 + W <= 0) continue;   // Every lane outside the screen
+
+							const float kernelWeight = kernelWeights[std::abs(xx)] * kernelWeights[std::abs(yy)];
+							const V kernel = S::set1(kernelWeight);
+
+							// computeWeight().  normalDistanceCos() is currently a constant 1, so the normal planes aren't read.
+							//    Cached weights are already 0 off screen; fold the kernel into them as well.
+							M inside;
+							V wZClamped, wGeometry;
+							if (kCachedGeometry)
+							{
+								wGeometry = S::mul(S::loadU8(args.pGeometryWeights + getAtrousTapIndex(xx, yy) * planeSize + c), S::set1(kernelWeight / 255.0f));
+							}
+							else
+							{
+								const V pxV = S::add(S::set1(float(px0)), S::lane());
+								const V zP  = loadRow<S>(pZ + row, px0, width);
+								const V wZ  = S::div(S::abs(S::sub(zCenter, zP)), S::mul(phiDepth, S::set1(tapLength.v[yy + 2][xx + 2])));
+								inside    = S::andMask(S::ge(pxV, zero), S::lt(pxV, widthV));
+								wZClamped = S::max(wZ, zero);
+							}
+
+							// variance is weighted by the squared weights, see paper
+							if (kDirect)
+							{
+								const V pDR = loadRow<S>(src[kDirectR] + row, px0, width),   pDG = loadRow<S>(src[kDirectG] + row, px0, width);
+								const V pDB = loadRow<S>(src[kDirectB] + row, px0, width),   pDV = loadRow<S>(src[kDirectVar] + row, px0, width);
+								const V lDirectP = loadRow<S>(src[kDirectLum] + row, px0, width);
+								const V wLdirect = S::div(S::abs(S::sub(lDirectCenter, lDirectP)), phiLDirect);
+
+								V wDirect;
+								if (kCachedGeometry)
+									wDirect = S::mul(expApprox<S>(S::sub(zero, S::max(wLdirect, zero))), wGeometry);
+								else
+									wDirect = S::select(inside, S::mul(expApprox<S>(S::sub(S::sub(zero, S::max(wLdirect, zero)), wZClamped)), kernel), zero);
+
+								sumWDirect = S::add(sumWDirect, wDirect);
+								sumDR   = S::add(sumDR, S::mul(wDirect, pDR));
+								sumDG   = S::add(sumDG, S::mul(wDirect, pDG));
+								sumDB   = S::add(sumDB, S::mul(wDirect, pDB));
+								sumDVar = S::add(sumDVar, S::mul(S::mul(wDirect, wDirect), pDV));
+							}
+							if (kIndirect)
+							{
+								const V pIR = loadRow<S>(src[kIndirectR] + row, px0, width), pIG = loadRow<S>(src[kIndirectG] + row, px0, width);
+								const V pIB = loadRow<S>(src[kIndirectB] + row, px0, width), pIV = loadRow<S>(src[kIndirectVar] + row, px0, width);
+								const V lIndirectP = loadRow<S>(src[kIndirectLum] + row, px0, width);
+								const V wLindirect = S::div(S::abs(S::sub(lIndirectCenter, lIndirectP)), phiLIndirect);
+
+								V wIndirect;
+								if (kCachedGeometry)
+									wIndirect = S::mul(expApprox<S>(S::sub(zero, S::max(wLindirect, zero))), wGeometry);
+								else
+									wIndirect = S::select(inside, S::mul(expApprox<S>(S::sub(S::sub(zero, S::max(wLindirect, zero)), wZClamped)), kernel), zero);
+
+								sumWIndirect = S::add(sumWIndirect, wIndirect);
+								sumIR   = S::add(sumIR, S::mul(wIndirect, pIR));
+								sumIG   = S::add(sumIG, S::mul(wIndirect, pIG));
+								sumIB   = S::add(sumIB, S::mul(wIndirect, pIB));
+								sumIVar = S::add(sumIVar, S::mul(S::mul(wIndirect, wIndirect), pIV));
+							}
+						}
+					}
+
+					// renormalization is different for variance; pixels without valid depth (envmap) pass through
+					const M envMap = S::lt(zCenter, zero);
+					if (kDirect)
+					{
+						V outDR = S::select(envMap, dirR,   S::div(sumDR, sumWDirect));
+						V outDG = S::select(envMap, dirG,   S::div(sumDG, sumWDirect));
+						V outDB = S::select(envMap, dirB,   S::div(sumDB, sumWDirect));
+						V outDV = S::select(envMap, dirVar, S::div(sumDVar, S::mul(sumWDirect, sumWDirect)));
+						S::store(dst[kDirectR] + c, outDR);   S::store(dst[kDirectG] + c, outDG);
+						S::store(dst[kDirectB] + c, outDB);   S::store(dst[kDirectVar] + c, outDV);
+						S::store(dst[kDirectLum] + c, S::add(S::add(S::mul(outDR, lumR), S::mul(outDG, lumG)), S::mul(outDB, lumB)));
+					}
+					if (kIndirect)
+					{
+						V outIR = S::select(envMap, indR,   S::div(sumIR, sumWIndirect));
+						V outIG = S::select(envMap, indG,   S::div(sumIG, sumWIndirect));
+						V outIB = S::select(envMap, indB,   S::div(sumIB, sumWIndirect));
+						V outIV = S::select(envMap, indVar, S::div(sumIVar, S::mul(sumWIndirect, sumWIndirect)));
+						S::store(dst[kIndirectR] + c, outIR); S::store(dst[kIndirectG] + c, outIG);
+						S::store(dst[kIndirectB] + c, outIB); S::store(dst[kIndirectVar] + c, outIV);
+						S::store(dst[kIndirectLum] + c, S::add(S::add(S::mul(outIR, lumR), S::mul(outIG, lumG)), S::mul(outIB, lumB)));
+					}
+
+					// Blit-free, the feedback iteration's result goes straight to the filtered past too
+					if (args.pHistoryDirect)
+					{
+						const int lanes = std::min(W, width - x0);
+						for (int lane = 0; lane < lanes; lane++)
+						{
+							const size_t j = c + lane;
+							const int    x = x0 + lane;
+							args.pHistoryDirect->at(x, y)   = quantizeIllum(args.historyFormat, float4(dst[kDirectR][j], dst[kDirectG][j], dst[kDirectB][j], dst[kDirectVar][j]));
+							args.pHistoryIndirect->at(x, y) = quantizeIllum(args.historyFormat, float4(dst[kIndirectR][j], dst[kIndirectG][j], dst[kIndirectB][j], dst[kIndirectVar][j]));
+						}
+					}
+
+					// do the demodulation in the last iteration while the result is in cache.  A disabled channel's
+					//    planes hold what the caller left there.
+					if (kModulate)
+					{
+						const int lanes = std::min(W, width - x0);
+						for (int lane = 0; lane < lanes; lane++)
+						{
+							const size_t j = c + lane;
+							const int    x = x0 + lane;
+							float4 direct   = float4(dst[kDirectR][j],   dst[kDirectG][j],   dst[kDirectB][j],   dst[kDirectVar][j]);
+							float4 indirect = float4(dst[kIndirectR][j], dst[kIndirectG][j], dst[kIndirectB][j], dst[kIndirectVar][j]);
+							args.pModulated->at(x, y) = direct * args.pAlbedo->at(x, y) + indirect * args.pIndirAlbedo->at(x, y);
+						}
+					}
+				}
+			}
+		}
+
+		/** Dispatch on the run-time arguments that pick a variant
+		*/
+		template <typename S, bool kDirect, bool kIndirect>
+		void atrousRowsChannels(const AtrousSimdArgs &args)
+		{
+			const bool modulate = args.pModulated != nullptr;
+			const bool cached   = args.pGeometryWeights != nullptr;
+			switch ((modulate ? 4 : 0) | (args.radius == 1 ? 2 : 0) | (cached ? 1 : 0))
+			{
+			case 0: atrousRowsVariant<S, kDirect, kIndirect, false, 2, false>(args); break;
+			case 1: atrousRowsVariant<S, kDirect, kIndirect, false, 2, true>(args);  break;
+			case 2: atrousRowsVariant<S, kDirect, kIndirect, false, 1, false>(args); break;
+			case 3: atrousRowsVariant<S, kDirect, kIndirect, false, 1, true>(args);  break;
+			case 4: atrousRowsVariant<S, kDirect, kIndirect, true,  2, false>(args); break;
+			case 5: atrousRowsVariant<S, kDirect, kIndirect, true,  2, true>(args);  break;
+			case 6: atrousRowsVariant<S, kDirect, kIndirect, true,  1, false>(args); break;
+			default: atrousRowsVariant<S, kDirect, kIndirect, true, 1, true>(args);  break;
+			}
+		}
+
+		template <typename S>
+		void atrousRows(const AtrousSimdArgs &args)
+		{
+			switch (args.channels & kBothChannels)
+			{
+			case kDirectChannel:   atrousRowsChannels<S, true, false>(args);  break;
+			case kIndirectChannel: atrousRowsChannels<S, false, true>(args);  break;
+			case kBothChannels:    atrousRowsChannels<S, true, true>(args);   break;
+			default:               atrousRowsChannels<S, false, false>(args); break;
+			}
+		}
+
+		/** Joint bilateral upsample of reduced resolution indirect over args' rows; see UpsampleSimdArgs.  The taps'
+		    geometry and color are fetched lane by lane, the weights computed a vector at a time.
+		*/
+		template <typename S>
+		void upsampleIndirectRows(const UpsampleSimdArgs &args)
+		{
+			using V = typename S::V;
+			using M = typename S::M;
+			const int W = S::kWidth;
+
+			const PlanarImage &geom    = *args.pGeometry;
+			const PlanarImage &lowGeom = *args.pLowGeometry;
+			const ImageF4     &lowIndirect = *args.pLowIndirect;
+			const int width     = int(geom.getWidth());
+			const int stride    = int(geom.getStride());
+			const int lowWidth  = int(lowGeom.getWidth());
+			const int lowHeight = int(lowGeom.getHeight());
+			const int lowStride = int(lowGeom.getStride());
+			const float *pLowZ = lowGeom.getPlane(kLinearZ);
+			const float *pLowN[3] = { lowGeom.getPlane(kNormalX), lowGeom.getPlane(kNormalY), lowGeom.getPlane(kNormalZ) };
+
+			const V zero = S::set1(0.0f), one = S::set1(1.0f), half = S::set1(0.5f);
+			const V invScale = S::set1(1.0f / float(args.scale));
+			const V scale    = S::set1(float(args.scale));
+			const V farAway  = S::set1(std::numeric_limits<float>::max());
+
+			alignas(64) float tapX[S::kWidth];
+			alignas(64) float taps[4][8][S::kWidth];   // [tap][z, normal xyz, indirect rgb, variance]
+			alignas(64) float result[4][S::kWidth];
+			for (int y = args.y0; y < args.y1; y++)
+			{
+				const size_t row = size_t(y) * stride;
+				const float  v   = (float(y) + 0.5f) / float(args.scale) - 0.5f;
+				const int    ty0 = int(std::floor(v));
+				const V      fy  = S::set1(v - float(ty0));
+				const int    tapRows[2] = { std::min(std::max(ty0, 0), lowHeight - 1), std::min(std::max(ty0 + 1, 0), lowHeight - 1) };
+
+				for (int x0 = 0; x0 < width; x0 += W)
+				{
+					const int lanes = std::min(W, width - x0);
+					const V u  = S::sub(S::mul(S::add(S::add(S::set1(float(x0)), S::lane()), half), invScale), half);
+					const V uf = S::floor(u);
+					const V fx = S::sub(u, uf);
+					S::store(tapX, uf);
+
+					for (int lane = 0; lane < W; lane++)
+					{
+						const int tx0 = lane < lanes ? int(tapX[lane]) : 0;
+						for (int tap = 0; tap < 4; tap++)
+						{
+							const int tx = std::min(std::max(tx0 + (tap & 1), 0), lowWidth - 1);
+							const int ty = tapRows[tap >> 1];
+							const size_t j = size_t(ty) * lowStride + tx;
+							const float4 &color = lowIndirect.at(tx, ty);
+							taps[tap][0][lane] = pLowZ[j];
+							taps[tap][1][lane] = pLowN[0][j];
+							taps[tap][2][lane] = pLowN[1][j];
+							taps[tap][3][lane] = pLowN[2][j];
+							taps[tap][4][lane] = color.x;
+							taps[tap][5][lane] = color.y;
+							taps[tap][6][lane] = color.z;
+							taps[tap][7][lane] = color.w;
+						}
+					}
+
+					const V z  = S::load(geom.getPlane(kLinearZ) + row + x0);
+					const V nx = S::load(geom.getPlane(kNormalX) + row + x0);
+					const V ny = S::load(geom.getPlane(kNormalY) + row + x0);
+					const V nz = S::load(geom.getPlane(kNormalZ) + row + x0);
+					const V invPhiDepth = S::div(one, S::mul(S::max(S::load(geom.getPlane(kLinearZDeriv) + row + x0), S::set1(1e-8f)), scale));
+					const M envMap = S::lt(z, zero);
+
+					V sum[4] = { zero, zero, zero, zero }, nearest[4];
+					V sumW = zero, bestDist = zero;
+					for (int tap = 0; tap < 4; tap++)
+					{
+						const V bilinear = S::mul((tap & 1) ? fx : S::sub(one, fx), (tap >> 1) ? fy : S::sub(one, fy));
+						const V tapZ = S::load(taps[tap][0]);
+						const M tapEnvMap = S::lt(tapZ, zero);
+
+						// Environment map pixels only take environment map taps
+						V cosine = S::add(S::add(S::mul(nx, S::load(taps[tap][1])), S::mul(ny, S::load(taps[tap][2]))), S::mul(nz, S::load(taps[tap][3])));
+						cosine = S::max(cosine, zero);
+						for (int i = 0; i < 5; i++) cosine = S::mul(cosine, cosine);
+						const V depthDist = S::abs(S::sub(z, tapZ));
+						const V surfaceW  = S::mul(S::mul(bilinear, expApprox<S>(S::sub(zero, S::mul(depthDist, invPhiDepth)))), cosine);
+
+						const V w    = S::select(envMap, S::select(tapEnvMap, bilinear, zero), S::select(tapEnvMap, zero, surfaceW));
+						const V dist = S::select(envMap, S::select(tapEnvMap, zero, farAway), S::select(tapEnvMap, farAway, depthDist));
+
+						const M closer = tap == 0 ? S::ge(dist, dist) : S::lt(dist, bestDist);
+						bestDist = S::select(closer, dist, bestDist);
+						for (int c = 0; c < 4; c++)
+						{
+							const V color = S::load(taps[tap][4 + c]);
+							sum[c]     = S::add(sum[c], S::mul(color, w));
+							nearest[c] = tap == 0 ? color : S::select(closer, color, nearest[c]);
+						}
+						sumW = S::add(sumW, w);
+					}
+
+					const M weighted = S::lt(S::set1(1e-4f), sumW);
+					for (int c = 0; c < 4; c++)
+						S::store(result[c], S::select(weighted, S::div(sum[c], sumW), nearest[c]));
+
+					for (int lane = 0; lane < lanes; lane++)
+					{
+						const int x = x0 + lane;
+						args.pOutput->at(x, y) += float4(result[0][lane], result[1][lane], result[2][lane], result[3][lane]) * args.pIndirAlbedo->at(x, y);
+					}
+				}
+			}
+		}
+
+		inline uint32_t countBits(uint32_t v)
+		{
+			v = v - ((v >> 1) & 0x55555555u);
+			v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+			return (((v + (v >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24;
+		}
+
+		inline uint32_t lowestBit(uint32_t v)
+		{
+			uint32_t i = 0;
+			while (!(v & 1u)) { v >>= 1; i++; }
+			return i;
+		}
+
+		/** The rays of one packet in structure of arrays form
+		*/
+		template <typename S>
+		struct RayPacket
+		{
+			typename S::V ox, oy, oz, dx, dy, dz, ix, iy, iz, tMin, tMax;
+		};
+
+		/** Slab test of one node against every lane, like TriangleBvh's intersectBounds().  Returns the lanes that hit;
+		    their entry distances go to enter.
+		*/
+		template <typename S>
+		uint32_t intersectBoundsPacket(const BvhNode &node, const RayPacket<S> &r, typename S::V &enter)
+		{
+			using V = typename S::V;
+			const V t0x = S::mul(S::sub(S::set1(node.boundsMin.x), r.ox), r.ix);
+			const V t0y = S::mul(S::sub(S::set1(node.boundsMin.y), r.oy), r.iy);
+			const V t0z = S::mul(S::sub(S::set1(node.boundsMin.z), r.oz), r.iz);
+			const V t1x = S::mul(S::sub(S::set1(node.boundsMax.x), r.ox), r.ix);
+			const V t1y = S::mul(S::sub(S::set1(node.boundsMax.y), r.oy), r.iy);
+			const V t1z = S::mul(S::sub(S::set1(node.boundsMax.z), r.oz), r.iz);
+			enter = S::max(S::max(S::min(t0x, t1x), S::min(t0y, t1y)), S::max(S::min(t0z, t1z), r.tMin));
+			const V exit = S::min(S::min(S::max(t0x, t1x), S::max(t0y, t1y)), S::min(S::max(t0z, t1z), r.tMax));
+			return S::maskBits(S::ge(exit, enter));
+		}
+
+		/** Trace up to kWidth rays together.  The packet descends into a node with the mask of its lanes whose rays
+		    hit the node's bounds, and takes the child most of them reach first; the triangle test is the same
+		    Moller-Trumbore arithmetic as the single ray traversal, so each ray gets the same hits.
+		*/
+		template <typename S, bool kAnyHit>
+		void tracePacket(const BvhPacketArgs &args, const uint32_t *pRayIndices, uint32_t laneCount)
+		{
+			using V = typename S::V;
+			const int W = S::kWidth;
+
+			alignas(64) float ox[W], oy[W], oz[W], dx[W], dy[W], dz[W], tMin[W], tMax[W];
+			for (int i = 0; i < W; i++)
+			{
+				// Idle lanes repeat the first ray but are never in a mask
+				const Ray &ray = args.pRays[pRayIndices[uint32_t(i) < laneCount ? i : 0]];
+				ox[i] = ray.origin.x; oy[i] = ray.origin.y; oz[i] = ray.origin.z;
+				dx[i] = ray.dir.x;    dy[i] = ray.dir.y;    dz[i] = ray.dir.z;
+				tMin[i] = ray.tMin;   tMax[i] = ray.tMax;
+			}
+
+			RayPacket<S> r;
+			r.ox = S::load(ox); r.oy = S::load(oy); r.oz = S::load(oz);
+			r.dx = S::load(dx); r.dy = S::load(dy); r.dz = S::load(dz);
+			r.ix = S::div(S::set1(1.0f), r.dx);
+			r.iy = S::div(S::set1(1.0f), r.dy);
+			r.iz = S::div(S::set1(1.0f), r.dz);
+			r.tMin = S::load(tMin);
+			r.tMax = S::load(tMax);
+
+			alignas(64) float    hitT[W], hitU[W], hitV[W], laneT[W], laneU[W], laneV[W];
+			uint32_t             hitTriangle[W];
+			for (int i = 0; i < W; i++)
+			{
+				hitT[i] = hitU[i] = hitV[i] = 0.0f;
+				hitTriangle[i] = ~0u;
+			}
+
+			const uint32_t allLanes = laneCount >= 32 ? ~0u : (1u << laneCount) - 1u;
+			uint32_t found = 0;
+			uint32_t live  = allLanes;   // Any-hit lanes retire at their first hit
+
+			struct Entry { uint32_t node, lanes; };
+			Entry    stack[TriangleBvh::kMaxStackDepth];
+			uint32_t stackSize = 0;
+			uint32_t nodeIndex = 0;
+			V        enter;
+			uint32_t lanes = intersectBoundsPacket<S>(args.pNodes[0], r, enter) & live;
+
+			while (lanes != 0 || stackSize > 0)
+			{
+				if (lanes == 0)
+				{
+					const Entry &entry = stack[--stackSize];
+					nodeIndex = entry.node;
+					lanes = entry.lanes & live;
+					continue;
+				}
+
+				const BvhNode &node = args.pNodes[nodeIndex];
+				if (node.triangleCount > 0)
+				{
+					for (uint32_t i = node.index; i < node.index + node.triangleCount && lanes != 0; i++)
+					{
+						const float3 &v0 = args.pTriangles[3 * size_t(i)], &e1 = args.pTriangles[3 * size_t(i) + 1], &e2 = args.pTriangles[3 * size_t(i) + 2];
+						const V e1x = S::set1(e1.x), e1y = S::set1(e1.y), e1z = S::set1(e1.z);
+						const V e2x = S::set1(e2.x), e2y = S::set1(e2.y), e2z = S::set1(e2.z);
+
+						// pvec = cross(dir, e2), det = dot(e1, pvec)
+						const V px = S::sub(S::mulRounded(r.dy, e2z), S::mulRounded(r.dz, e2y));
+						const V py = S::sub(S::mulRounded(r.dz, e2x), S::mulRounded(r.dx, e2z));
+						const V pz = S::sub(S::mulRounded(r.dx, e2y), S::mulRounded(r.dy, e2x));
+						const V det = S::add(S::add(S::mulRounded(e1x, px), S::mulRounded(e1y, py)), S::mulRounded(e1z, pz));
+						const V invDet = S::div(S::set1(1.0f), det);
+
+						// tvec = origin - v0, u = dot(tvec, pvec) / det
+						const V tx = S::sub(r.ox, S::set1(v0.x)), ty = S::sub(r.oy, S::set1(v0.y)), tz = S::sub(r.oz, S::set1(v0.z));
+						const V u = S::mulRounded(S::add(S::add(S::mulRounded(tx, px), S::mulRounded(ty, py)), S::mulRounded(tz, pz)), invDet);
+
+						// qvec = cross(tvec, e1), v = dot(dir, qvec) / det, t = dot(e2, qvec) / det
+						const V qx = S::sub(S::mulRounded(ty, e1z), S::mulRounded(tz, e1y));
+						const V qy = S::sub(S::mulRounded(tz, e1x), S::mulRounded(tx, e1z));
+						const V qz = S::sub(S::mulRounded(tx, e1y), S::mulRounded(ty, e1x));
+						const V v = S::mulRounded(S::add(S::add(S::mulRounded(r.dx, qx), S::mulRounded(r.dy, qy)), S::mulRounded(r.dz, qz)), invDet);
+						const V t = S::mulRounded(S::add(S::add(S::mulRounded(e2x, qx), S::mulRounded(e2y, qy)), S::mulRounded(e2z, qz)), invDet);
+
+						// The single ray test's early outs, as lanes to reject
+						const V zero = S::set1(0.0f), one = S::set1(1.0f);
+						uint32_t reject = S::maskBits(S::ge(zero, S::abs(det)));
+						reject |= S::maskBits(S::lt(u, zero)) | S::maskBits(S::lt(one, u));
+						reject |= S::maskBits(S::lt(v, zero)) | S::maskBits(S::lt(one, S::add(u, v)));
+						reject |= S::maskBits(S::lt(t, r.tMin)) | S::maskBits(S::lt(r.tMax, t));
+						uint32_t accept = lanes & ~reject;
+						if (accept == 0) continue;
+
+						if (args.pAlphaScene)
+						{
+							S::store(laneU, u);
+							S::store(laneV, v);
+							for (uint32_t bits = accept; bits != 0; bits &= bits - 1)
+							{
+								const uint32_t lane = lowestBit(bits);
+								if (args.pAlphaScene->alphaTestFails(args.pTriangleIds[i], laneU[lane], laneV[lane])) accept &= ~(1u << lane);
+							}
+							if (accept == 0) continue;
+						}
+
+						found |= accept;
+						if (kAnyHit)
+						{
+							live  &= ~accept;
+							lanes &= ~accept;
+							continue;
+						}
+
+						r.tMax = S::select(S::fromBits(accept), t, r.tMax);
+						S::store(laneT, t);
+						S::store(laneU, u);
+						S::store(laneV, v);
+						for (uint32_t bits = accept; bits != 0; bits &= bits - 1)
+						{
+							const uint32_t lane = lowestBit(bits);
+							hitT[lane] = laneT[lane];
+							hitU[lane] = laneU[lane];
+							hitV[lane] = laneV[lane];
+							hitTriangle[lane] = args.pTriangleIds[i];
+						}
+					}
+					if (kAnyHit && live == 0) break;
+					lanes = 0;
+					continue;
+				}
+
+				// Go on with the child most of the lanes that hit both enter first; the other waits on the stack
+				const uint32_t left = node.index, right = node.index + 1;
+				V enterLeft, enterRight;
+				const uint32_t lanesLeft  = intersectBoundsPacket<S>(args.pNodes[left], r, enterLeft) & lanes;
+				const uint32_t lanesRight = intersectBoundsPacket<S>(args.pNodes[right], r, enterRight) & lanes;
+				if (lanesLeft != 0 && lanesRight != 0)
+				{
+					const uint32_t both = lanesLeft & lanesRight;
+					const uint32_t leftNearer = S::maskBits(S::ge(enterRight, enterLeft)) & both;
+					const bool leftFirst = 2 * countBits(leftNearer) >= countBits(both);
+					if (stackSize < TriangleBvh::kMaxStackDepth) stack[stackSize++] = leftFirst ? Entry{ right, lanesRight } : Entry{ left, lanesLeft };
+					nodeIndex = leftFirst ? left : right;
+					lanes     = leftFirst ? lanesLeft : lanesRight;
+				}
+				else
+				{
+					nodeIndex = lanesLeft != 0 ? left : right;
+					lanes     = lanesLeft | lanesRight;
+				}
+			}
+
+			for (uint32_t i = 0; i < laneCount; i++)
+			{
+				const uint32_t ray = pRayIndices[i];
+				const bool     hit = (found >> i) & 1u;
+				args.pFound[ray] = hit ? 1 : 0;
+				if (!kAnyHit && hit)
+				{
+					RayHit &dst = args.pHits[ray];
+					dst.t = hitT[i];
+					dst.triangle = hitTriangle[i];
+					dst.u = hitU[i];
+					dst.v = hitV[i];
+				}
+			}
+		}
+
+		template <typename S, bool kAnyHit>
+		void tracePackets(const BvhPacketArgs &args)
+		{
+			const uint32_t W = uint32_t(S::kWidth);
+			uint32_t indices[S::kWidth];
+			for (uint32_t first = 0; first < args.count; first += W)
+			{
+				const uint32_t laneCount = std::min(W, args.count - first);
+				for (uint32_t i = 0; i < laneCount; i++) indices[i] = args.pOrder ? args.pOrder[first + i] : first + i;
+				tracePacket<S, kAnyHit>(args, indices, laneCount);
+			}
+		}
+
+		template <typename S>
+		void bvhPackets(const BvhPacketArgs &args)
+		{
+			if (args.pHits) tracePackets<S, false>(args);
+			else            tracePackets<S, true>(args);
+		}
+
+		/** Cephes-style logf() for positive, normal x:  x = m * 2^e with m in [sqrt(1/2), sqrt(2)), and a polynomial
+		    for log(m).  Within a few ulps.
+		*/
+		template <typename S>
+		typename S::V logApprox(typename S::V x)
+		{
+			using V = typename S::V;
+			V e = S::exponent(x);
+			V m = S::mantissa(x);
+			const typename S::M high = S::ge(m, S::set1(1.41421356f));
+			m = S::select(high, S::mul(m, S::set1(0.5f)), m);
+			e = S::select(high, S::add(e, S::set1(1.0f)), e);
+
+			const V f = S::sub(m, S::set1(1.0f));
+			const V z = S::mul(f, f);
+			V p = S::set1(7.0376836292E-2f);
+			p = S::add(S::mul(p, f), S::set1(-1.1514610310E-1f));
+			p = S::add(S::mul(p, f), S::set1(1.1676998740E-1f));
+			p = S::add(S::mul(p, f), S::set1(-1.2420140846E-1f));
+			p = S::add(S::mul(p, f), S::set1(1.4249322787E-1f));
+			p = S::add(S::mul(p, f), S::set1(-1.6668057665E-1f));
+			p = S::add(S::mul(p, f), S::set1(2.0000714765E-1f));
+			p = S::add(S::mul(p, f), S::set1(-2.4999993993E-1f));
+			p = S::add(S::mul(p, f), S::set1(3.3333331174E-1f));
+
+			V y = S::mul(S::mul(p, f), z);
+			y = S::add(y, S::mul(e, S::set1(-2.12194440e-4f)));
+			y = S::sub(y, S::mul(z, S::set1(0.5f)));
+			return S::add(S::add(f, y), S::mul(e, S::set1(0.693359375f)));
+		}
+
+		/** x^y for x > 0, and 0 where x is zero (or too small to matter)
+		*/
+		template <typename S>
+		typename S::V powApprox(typename S::V x, typename S::V y)
+		{
+			const typename S::V tiny = S::set1(1e-30f);
+			return S::select(S::ge(x, tiny), expApprox<S>(S::mul(y, logApprox<S>(S::max(x, tiny)))), S::set1(0.0f));
+		}
+
+		/** The sRGB transfer function, for x in [0, 1]
+		*/
+		template <typename S>
+		typename S::V srgbEncode(typename S::V x)
+		{
+			const typename S::V curve = S::sub(S::mul(S::set1(1.055f), powApprox<S>(x, S::set1(1.0f / 2.4f))), S::set1(0.055f));
+			return S::select(S::lt(x, S::set1(0.0031308f)), S::mul(x, S::set1(12.92f)), curve);
+		}
+
+		/** Lanes of the W columns starting at x that lie inside a row of width columns
+		*/
+		template <typename S>
+		typename S::M columnMask(int x, int width)
+		{
+			return S::lt(S::add(S::lane(), S::set1(float(x))), S::set1(float(width)));
+		}
+
+		template <typename S>
+		double sumLanes(typename S::V v)
+		{
+			alignas(64) float lanes[S::kWidth];
+			S::store(lanes, v);
+			double sum = 0.0;
+			for (int i = 0; i < S::kWidth; i++) sum += lanes[i];
+			return sum;
+		}
+
+		/** One pass of a separable filter; see ConvolveSimdArgs.  Horizontal passes copy each row with its borders
+		    clamped first, so that every tap is a plain unaligned load.  Vertical passes sum the taps of four vectors
+		    of an output row at a time in registers.
+		*/
+		template <typename S>
+		void convolveRows(const ConvolveSimdArgs &args)
+		{
+			using V = typename S::V;
+			const int W = S::kWidth;
+			const int radius = std::min(args.radius, kMaxConvolveRadius);
+			const int taps   = 2 * radius + 1;
+			const int width  = args.width;
+			const int end    = (width + W - 1) / W * W;   // Within the row padding
+
+			V weights[2 * kMaxConvolveRadius + 1];
+			for (int k = 0; k < taps; k++) weights[k] = S::set1(args.pWeights[k]);
+
+			if (args.vertical)
+			{
+				const float *pRows[2 * kMaxConvolveRadius + 1];
+				for (int y = args.y0; y < args.y1; y++)
+				{
+					for (int k = 0; k < taps; k++)
+						pRows[k] = args.pIn + size_t(std::min(std::max(y + k - radius, 0), args.height - 1)) * args.stride;
+
+					float *pOut = args.pOut + size_t(y - args.y0) * args.stride;
+					int x = 0;
+					for (; x + 4 * W <= end; x += 4 * W)
+					{
+						V s0 = S::set1(0.0f), s1 = s0, s2 = s0, s3 = s0;
+						for (int k = 0; k < taps; k++)
+						{
+							const float *pIn = pRows[k] + x;
+							s0 = S::add(s0, S::mul(S::load(pIn),         weights[k]));
+							s1 = S::add(s1, S::mul(S::load(pIn + W),     weights[k]));
+							s2 = S::add(s2, S::mul(S::load(pIn + 2 * W), weights[k]));
+							s3 = S::add(s3, S::mul(S::load(pIn + 3 * W), weights[k]));
+						}
+						if (args.accumulate)
+						{
+							s0 = S::add(s0, S::load(pOut + x));
+							s1 = S::add(s1, S::load(pOut + x + W));
+							s2 = S::add(s2, S::load(pOut + x + 2 * W));
+							s3 = S::add(s3, S::load(pOut + x + 3 * W));
+						}
+						S::store(pOut + x, s0);
+						S::store(pOut + x + W, s1);
+						S::store(pOut + x + 2 * W, s2);
+						S::store(pOut + x + 3 * W, s3);
+					}
+					for (; x < end; x += W)
+					{
+						V sum = args.accumulate ? S::load(pOut + x) : S::set1(0.0f);
+						for (int k = 0; k < taps; k++) sum = S::add(sum, S::mul(S::load(pRows[k] + x), weights[k]));
+						S::store(pOut + x, sum);
+					}
+				}
+				return;
+			}
+
+			std::vector<float> padded(size_t(end + 2 * radius + W));
+			float *pPadded = padded.data() + radius;
+			for (int y = args.y0; y < args.y1; y++)
+			{
+				const float *pIn = args.pIn + size_t(y) * args.stride;
+				if (args.pInScale)
+				{
+					const float *pScale = args.pInScale + size_t(y) * args.stride;
+					for (int x = 0; x < end; x += W) S::store(pPadded + x, S::mul(S::load(pIn + x), S::load(pScale + x)));
+				}
+				else
+				{
+					for (int x = 0; x < end; x += W) S::store(pPadded + x, S::load(pIn + x));
+				}
+				for (int x = -radius; x < 0; x++) pPadded[x] = pPadded[0];
+				for (int x = width; x < end + radius; x++) pPadded[x] = pPadded[width - 1];
+
+				float *pOut = args.pOut + size_t(y - args.y0) * args.stride;
+				for (int x = 0; x < end; x += W)
+				{
+					V sum = args.accumulate ? S::load(pOut + x) : S::set1(0.0f);
+					for (int k = 0; k < taps; k++) sum = S::add(sum, S::mul(S::load(pPadded + x + k - radius), weights[k]));
+					S::store(pOut + x, sum);
+				}
+			}
+		}
+
+		/** Linear rgb to CIE XYZ divided by the white point (rgb = 1), as exact fractions like FLIP's reference code
+		*/
+		constexpr float kRgbToWhiteXyz[3][3] = { { 10135552.0f / 23359437.0f, 8788810.0f / 23359437.0f, 4435075.0f / 23359437.0f },
+		                                         { 2613072.0f / 12288897.0f,  8788810.0f / 12288897.0f, 887015.0f / 12288897.0f },
+		                                         { 1425312.0f / 80288307.0f,  8788810.0f / 80288307.0f, 70074185.0f / 80288307.0f } };
+
+		/** FLIP's color pipeline after the spatial filter:  YCxCz back to linear rgb, clamped to the displayable range,
+		    then CIE L*a*b* with the Hunt adjustment (a* and b* scaled by L* / 100).  XYZ is relative to the white of
+		    sRGB's primaries.
+		*/
+		template <typename S>
+		void filteredToHuntLab(typename S::V oppY, typename S::V oppCx, typename S::V oppCz, typename S::V lab[3])
+		{
+			using V = typename S::V;
+			const V zero = S::set1(0.0f), one = S::set1(1.0f);
+			const float xn = 23359437.0f / 24577794.0f, zn = 80288307.0f / 73733382.0f;
+
+			const V yy = S::mul(S::add(oppY, S::set1(16.0f)), S::set1(1.0f / 116.0f));
+			const V cx = S::mul(S::add(S::mul(oppCx, S::set1(1.0f / 500.0f)), yy), S::set1(xn));
+			const V cz = S::mul(S::sub(yy, S::mul(oppCz, S::set1(1.0f / 200.0f))), S::set1(zn));
+
+			V rgb[3];
+			const float toRgb[3][3] = { { 3.241003275f, -1.537398934f, -0.498615861f }, { -0.969224334f, 1.875930071f, 0.041554224f }, { 0.055639423f, -0.204011202f, 1.057148933f } };
+			for (int c = 0; c < 3; c++)
+			{
+				const V v = S::add(S::add(S::mul(cx, S::set1(toRgb[c][0])), S::mul(yy, S::set1(toRgb[c][1]))), S::mul(cz, S::set1(toRgb[c][2])));
+				rgb[c] = S::min(S::max(v, zero), one);
+			}
+
+			// L*a*b*'s f(t) of XYZ / white:  the cube root above (6/29)^3, a line below
+			V f[3];
+			for (int c = 0; c < 3; c++)
+			{
+				const V t = S::add(S::add(S::mul(rgb[0], S::set1(kRgbToWhiteXyz[c][0])), S::mul(rgb[1], S::set1(kRgbToWhiteXyz[c][1]))), S::mul(rgb[2], S::set1(kRgbToWhiteXyz[c][2])));
+				const V root = powApprox<S>(t, S::set1(1.0f / 3.0f));
+				const V line = S::add(S::mul(t, S::set1(841.0f / 108.0f)), S::set1(4.0f / 29.0f));
+				f[c] = S::select(S::ge(t, S::set1(216.0f / 24389.0f)), root, line);
+			}
+
+			const V L = S::sub(S::mul(f[1], S::set1(116.0f)), S::set1(16.0f));
+			const V hunt = S::mul(L, S::set1(0.01f));
+			lab[0] = L;
+			lab[1] = S::mul(S::mul(S::sub(f[0], f[1]), S::set1(500.0f)), hunt);
+			lab[2] = S::mul(S::mul(S::sub(f[1], f[2]), S::set1(200.0f)), hunt);
+		}
+
+		/** MetricsSimdStage::Prepare.  Columns past the width are computed too (the rows are padded) but left out of
+		    the sums.
+		*/
+		template <typename S>
+		void metricsPrepareRows(const MetricsSimdArgs &args)
+		{
+			using V = typename S::V;
+			const int W = S::kWidth;
+			const V zero = S::set1(0.0f), one = S::set1(1.0f);
+			const V exposure = S::set1(args.exposure), epsilon = S::set1(args.relMseEpsilon);
+
+			for (int row = 0; row < args.rowCount; row++)
+			{
+				const size_t offset = size_t(row) * args.stride;
+				V sumSq = zero, sumRelSq = zero, sumFlicker = zero;
+				for (int x = 0; x < args.width; x += W)
+				{
+					const size_t i = offset + x;
+					const typename S::M inside = columnMask<S>(x, args.width);
+
+					V rgb[3];
+					for (int c = 0; c < 3; c++)
+					{
+						const V v = S::load(args.pColor[c] + i);
+						if (args.pRefColor[0])
+						{
+							const V ref = S::load(args.pRefColor[c] + i);
+							const V d = S::sub(v, ref);
+							const V d2 = S::mul(d, d);
+							sumSq    = S::add(sumSq, S::select(inside, d2, zero));
+							sumRelSq = S::add(sumRelSq, S::select(inside, S::div(d2, S::add(S::mul(ref, ref), epsilon)), zero));
+						}
+						rgb[c] = S::min(S::max(S::mul(v, exposure), zero), one);
+					}
+
+					V xyz[3];
+					for (int c = 0; c < 3; c++)
+						xyz[c] = S::add(S::add(S::mul(rgb[0], S::set1(kRgbToWhiteXyz[c][0])), S::mul(rgb[1], S::set1(kRgbToWhiteXyz[c][1]))), S::mul(rgb[2], S::set1(kRgbToWhiteXyz[c][2])));
+
+					S::store(args.pOpponent[0] + i, S::sub(S::mul(xyz[1], S::set1(116.0f)), S::set1(16.0f)));
+					S::store(args.pOpponent[1] + i, S::mul(S::sub(xyz[0], xyz[1]), S::set1(500.0f)));
+					S::store(args.pOpponent[2] + i, S::mul(S::sub(xyz[1], xyz[2]), S::set1(200.0f)));
+					S::store(args.pLuminance + i, xyz[1]);
+
+					const V luma = srgbEncode<S>(S::min(xyz[1], one));
+					S::store(args.pLuma + i, luma);
+
+					if (args.pPrevDifference)
+					{
+						const V difference = S::sub(luma, S::load(args.pRefLuma + i));
+						if (args.hasPrevious)
+						{
+							const V d = S::sub(difference, S::load(args.pPrevDifference + i));
+							sumFlicker = S::add(sumFlicker, S::select(inside, S::mul(d, d), zero));
+						}
+						S::store(args.pPrevDifference + i, difference);
+					}
+				}
+				args.pSums->squaredError    += sumLanes<S>(sumSq);
+				args.pSums->relSquaredError += sumLanes<S>(sumRelSq);
+				args.pSums->flicker         += sumLanes<S>(sumFlicker);
+			}
+		}
+
+		/** MetricsSimdStage::FinishReference and Compare, which share the conversion of the filtered colors
+		*/
+		template <typename S>
+		void metricsCompareRows(const MetricsSimdArgs &args)
+		{
+			using V = typename S::V;
+			const int W = S::kWidth;
+			const bool compare = args.stage == MetricsSimdStage::Compare;
+			const V zero = S::set1(0.0f), one = S::set1(1.0f);
+
+			// FLIP's redistribution of the color error:  [0, pc * cmax) to [0, pt), the rest to [pt, 1]
+			const float pc = 0.4f, pt = 0.95f;
+			const V pcCMax = S::set1(pc * args.flipCMax);
+			const V lowScale = S::set1(pt / (pc * args.flipCMax)), highScale = S::set1((1.0f - pt) / ((1.0f - pc) * args.flipCMax));
+			const V c1 = S::set1(0.01f * 0.01f), c2 = S::set1(0.03f * 0.03f);
+
+			for (int row = 0; row < args.rowCount; row++)
+			{
+				const size_t offset = size_t(row) * args.stride;
+				V sumFlip = zero, sumSsim = zero;
+				for (int x = 0; x < args.width; x += W)
+				{
+					const size_t i = offset + x;
+					V lab[3];
+					filteredToHuntLab<S>(S::load(args.pFiltered[0] + i), S::load(args.pFiltered[1] + i), S::load(args.pFiltered[2] + i), lab);
+
+					V f[4];
+					for (int k = 0; k < 4; k++) f[k] = S::load(args.pFeatures[k] + i);
+					const V edge  = S::sqrt(S::add(S::mul(f[0], f[0]), S::mul(f[1], f[1])));
+					const V point = S::sqrt(S::add(S::mul(f[2], f[2]), S::mul(f[3], f[3])));
+
+					if (!compare)
+					{
+						for (int c = 0; c < 3; c++) S::store(args.pLab[c] + i, lab[c]);
+						S::store(args.pFeatureMagnitude[0] + i, edge);
+						S::store(args.pFeatureMagnitude[1] + i, point);
+						continue;
+					}
+
+					// HyAB distance, ^0.7 and redistributed
+					const V dL = S::sub(lab[0], S::load(args.pRefLab[0] + i));
+					const V da = S::sub(lab[1], S::load(args.pRefLab[1] + i));
+					const V db = S::sub(lab[2], S::load(args.pRefLab[2] + i));
+					const V hyab = S::add(S::abs(dL), S::sqrt(S::add(S::mul(da, da), S::mul(db, db))));
+					const V p = powApprox<S>(hyab, S::set1(0.7f));
+					const V colorError = S::select(S::lt(p, pcCMax), S::mul(p, lowScale), S::add(S::set1(pt), S::mul(S::sub(p, pcCMax), highScale)));
+
+					// Feature difference, (d / sqrt(2))^0.5
+					const V dEdge  = S::abs(S::sub(edge, S::load(args.pRefFeatureMagnitude[0] + i)));
+					const V dPoint = S::abs(S::sub(point, S::load(args.pRefFeatureMagnitude[1] + i)));
+					const V featureError = S::sqrt(S::mul(S::max(dEdge, dPoint), S::set1(0.70710678f)));
+
+					const V flip = powApprox<S>(colorError, S::sub(one, featureError));
+
+					const V mx = S::load(args.pMoments[0] + i), my = S::load(args.pRefMoments[0] + i);
+					const V vx = S::sub(S::load(args.pMoments[1] + i), S::mul(mx, mx));
+					const V vy = S::sub(S::load(args.pRefMoments[1] + i), S::mul(my, my));
+					const V cov = S::sub(S::load(args.pMoments[2] + i), S::mul(mx, my));
+					const V num = S::mul(S::add(S::mul(S::set1(2.0f), S::mul(mx, my)), c1), S::add(S::mul(S::set1(2.0f), cov), c2));
+					const V den = S::mul(S::add(S::add(S::mul(mx, mx), S::mul(my, my)), c1), S::add(S::add(vx, vy), c2));
+
+					const typename S::M inside = columnMask<S>(x, args.width);
+					sumFlip = S::add(sumFlip, S::select(inside, flip, zero));
+					sumSsim = S::add(sumSsim, S::select(inside, S::div(num, den), zero));
+				}
+				if (compare)
+				{
+					args.pSums->flip += sumLanes<S>(sumFlip);
+					args.pSums->ssim += sumLanes<S>(sumSsim);
+				}
+			}
+		}
+
+		/** The pixel passes of MetricsEvaluator; see MetricsSimdArgs
+		*/
+		template <typename S>
+		void metricsRows(const MetricsSimdArgs &args)
+		{
+			if (args.stage == MetricsSimdStage::Prepare) metricsPrepareRows<S>(args);
+			else                                         metricsCompareRows<S>(args);
+		}
+
+		/** Like loadRow(), but lanes left or right of the row read its first or last column, like the shader's
+		    clampToScreen()
+		*/
+		template <typename S>
+		typename S::V loadRowClamped(const float *pRow, int x0, int width)
+		{
+			if (x0 >= 0 && x0 + S::kWidth <= width)
+				return S::load(pRow + x0);
+
+			alignas(64) float tmp[S::kWidth];
+			for (int lane = 0; lane < S::kWidth; lane++)
+				tmp[lane] = pRow[std::min(std::max(x0 + lane, 0), width - 1)];
+			return S::load(tmp);
+		}
+
+		/** rgbToYCoCg() with the same order of operations.  The factors are powers of two, so the products are exact
+		    and fusing them into FMAs changes nothing.
+		*/
+		template <typename S>
+		void rgbToYCoCg(typename S::V r, typename S::V g, typename S::V b, typename S::V out[3])
+		{
+			out[0] = S::add(S::add(S::mul(r, S::set1(0.25f)), S::mul(g, S::set1(0.5f))), S::mul(b, S::set1(0.25f)));
+			out[1] = S::sub(S::mul(r, S::set1(0.5f)), S::mul(b, S::set1(0.5f)));
+			out[2] = S::sub(S::add(S::mul(r, S::set1(-0.25f)), S::mul(g, S::set1(0.5f))), S::mul(b, S::set1(0.25f)));
+		}
+
+		/** TemporalAASimdStage::ToYCoCg.  Columns past the width are set to zero.
+		*/
+		template <typename S>
+		void temporalAAToYCoCgRows(const TemporalAASimdArgs &args)
+		{
+			using V = typename S::V;
+			const int W = S::kWidth;
+			const ImageF4 &color = *args.pColor;
+			PlanarImage   &ycocg = *args.pYCoCg;
+			const int width  = int(color.getWidth());
+			const int stride = int(ycocg.getStride());
+
+			alignas(64) float rgb[3][S::kWidth];
+			for (int y = args.y0; y < args.y1; y++)
+			{
+				const float4 *pRow = &color.at(0, y);
+				float *pOut[3];
+				for (uint32_t c = 0; c < 3; c++) pOut[c] = ycocg.getPlane(c) + size_t(y) * stride;
+
+				for (int x0 = 0; x0 < width; x0 += W)
+				{
+					for (int lane = 0; lane < W; lane++)
+					{
+						const bool inside = x0 + lane < width;
+						rgb[0][lane] = inside ? pRow[x0 + lane].x : 0.0f;
+						rgb[1][lane] = inside ? pRow[x0 + lane].y : 0.0f;
+						rgb[2][lane] = inside ? pRow[x0 + lane].z : 0.0f;
+					}
+					V out[3];
+					rgbToYCoCg<S>(S::load(rgb[0]), S::load(rgb[1]), S::load(rgb[2]), out);
+					for (int c = 0; c < 3; c++) S::store(pOut[c] + x0, out[c]);
+				}
+			}
+		}
+
+		/** TemporalAASimdStage::Resolve, following temporalAAPixel().  The neighborhood bounds, clamp and blend are
+		    vectorized; the history is reprojected and bilinearly fetched a lane at a time with the scalar port's code.
+		*/
+		template <typename S>
+		void temporalAAResolveRows(const TemporalAASimdArgs &args)
+		{
+			using V = typename S::V;
+			using M = typename S::M;
+			const int W = S::kWidth;
+			const ImageF4     &color = *args.pColor;
+			const PlanarImage &ycocg = *args.pYCoCg;
+			const int width  = int(color.getWidth());
+			const int height = int(color.getHeight());
+			const int stride = int(ycocg.getStride());
+			const V alpha = S::set1(args.alpha), one = S::set1(1.0f);
+			const V dimX = S::set1(float(width)), dimY = S::set1(float(height));
+			const V minPos = S::set1(-0.5f), maxX = S::set1(float(width) - 0.5f), maxY = S::set1(float(height) - 0.5f);
+
+			alignas(64) float motion[2][S::kWidth];
+			alignas(64) float taps[4][3][S::kWidth];   // [h00, h10, h01, h11][channel]
+			alignas(64) float result[3][S::kWidth];
+			for (int y = args.y0; y < args.y1; y++)
+			{
+				const float *pRows[3][3];   // [plane][row - y + 1]
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					for (int yy = -1; yy <= 1; yy++)
+						pRows[c][yy + 1] = ycocg.getPlane(c) + size_t(std::min(std::max(y + yy, 0), height - 1)) * stride;
+				}
+
+				for (int x0 = 0; x0 < width; x0 += W)
+				{
+					V current[3], boxMin[3], boxMax[3];
+					for (int c = 0; c < 3; c++)
+					{
+						current[c] = S::load(pRows[c][1] + x0);
+						boxMin[c]  = current[c];
+						boxMax[c]  = current[c];
+						for (int yy = 0; yy < 3; yy++)
+						{
+							for (int xx = -1; xx <= 1; xx++)
+							{
+								const V n = loadRowClamped<S>(pRows[c][yy], x0 + xx, width);
+								boxMin[c] = S::min(boxMin[c], n);
+								boxMax[c] = S::max(boxMax[c], n);
+							}
+						}
+					}
+
+					// getTemporalAAPrevPos() and loadHistory(), with the products kept apart from the sums as in the
+					//    per-pixel port; only the taps are fetched lane by lane
+					const int laneCount = std::min(W, width - x0);
+					for (int lane = 0; lane < W; lane++)
+					{
+						const float4 m = lane < laneCount ? args.pMotion->at(x0 + lane, y) : float4(0.0f);
+						motion[0][lane] = m.x;
+						motion[1][lane] = m.y;
+					}
+					const V posX = S::add(S::add(S::set1(float(x0)), S::lane()), S::mulRounded(S::load(motion[0]), dimX));
+					const V posY = S::add(S::set1(float(y)), S::mulRounded(S::load(motion[1]), dimY));
+					const M onScreen = S::andMask(S::andMask(S::lt(minPos, posX), S::lt(minPos, posY)),
+					                              S::andMask(S::lt(posX, maxX), S::lt(posY, maxY)));
+					const uint32_t validBits = args.pHistory ? S::maskBits(onScreen) & ((1u << laneCount) - 1u) : 0u;
+
+					const V p0x = S::floor(posX), p0y = S::floor(posY);
+					S::store(motion[0], p0x);
+					S::store(motion[1], p0y);
+					for (int lane = 0; lane < W; lane++)
+					{
+						const bool tapsValid = (validBits >> lane) & 1u;
+						const int  ix = tapsValid ? int(motion[0][lane]) : 0, iy = tapsValid ? int(motion[1][lane]) : 0;
+						for (int t = 0; t < 4; t++)
+						{
+							const float4 h = tapsValid ? loadClampedToScreen(*args.pHistory, ix + (t & 1), iy + (t >> 1)) : float4(0.0f);
+							taps[t][0][lane] = h.x;
+							taps[t][1][lane] = h.y;
+							taps[t][2][lane] = h.z;
+						}
+					}
+
+					const V fx = S::sub(posX, p0x), fy = S::sub(posY, p0y);
+					V history[3];
+					for (int c = 0; c < 3; c++)
+					{
+						const V h00 = S::load(taps[0][c]), h10 = S::load(taps[1][c]), h01 = S::load(taps[2][c]), h11 = S::load(taps[3][c]);
+						const V top    = S::add(h00, S::mulRounded(S::sub(h10, h00), fx));
+						const V bottom = S::add(h01, S::mulRounded(S::sub(h11, h01), fx));
+						history[c] = S::add(top, S::mulRounded(S::sub(bottom, top), fy));
+					}
+					rgbToYCoCg<S>(history[0], history[1], history[2], history);
+
+					const M valid = S::fromBits(validBits);
+					const V blend = S::select(valid, alpha, one);
+					V ycocgResult[3];
+					for (int c = 0; c < 3; c++)
+					{
+						const V clamped = S::min(S::max(history[c], boxMin[c]), boxMax[c]);
+						const V h = S::select(valid, clamped, current[c]);
+						ycocgResult[c] = S::add(h, S::mulRounded(S::sub(current[c], h), blend));
+					}
+
+					// yCoCgToRgb()
+					S::store(result[0], S::sub(S::add(ycocgResult[0], ycocgResult[1]), ycocgResult[2]));
+					S::store(result[1], S::add(ycocgResult[0], ycocgResult[2]));
+					S::store(result[2], S::sub(S::sub(ycocgResult[0], ycocgResult[1]), ycocgResult[2]));
+
+					for (int lane = 0; lane < laneCount; lane++)
+					{
+						const int x = x0 + lane;
+						const float4 out = float4(result[0][lane], result[1][lane], result[2][lane], color.at(x, y).w);
+						args.pOutput->at(x, y)     = out;
+						args.pNewHistory->at(x, y) = out;
+					}
+				}
+			}
+		}
+
+		template <typename S>
+		void temporalAARows(const TemporalAASimdArgs &args)
+		{
+			if (args.stage == TemporalAASimdStage::ToYCoCg) temporalAAToYCoCgRows<S>(args);
+			else                                            temporalAAResolveRows<S>(args);
+		}
+	}
+}
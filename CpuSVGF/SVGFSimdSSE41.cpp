@@ -0,0 +1,104 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include "SVGFBvh.h"
+#include "SVGFSimd.h"
+#include <smmintrin.h>
+
+// Everything shared with the other translation units is included above, so only the kernel templates and the
+//     wrapper below get compiled for the wider instruction set.  MSVC needs no flag for the intrinsics.
+#if defined(__GNUC__) && !defined(__SSE4_1__)
+#pragma GCC target("sse4.1")
+#endif
+#include "SVGFSimdKernels.h"
+
+namespace CpuSVGF
+{
+	namespace
+	{
+		struct SSE41Ops
+		{
+			static const int kWidth = 4;
+			using V = __m128;
+			using M = __m128;
+
+			static V    load(const float *p)        { return _mm_loadu_ps(p); }
+			static void store(float *p, V v)        { _mm_storeu_ps(p, v); }
+			static V    loadU8(const uint8_t *p)    { int32_t v; std::memcpy(&v, p, 4); return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(v))); }
+			static void storeU8(uint8_t *p, V v)    { __m128i i = _mm_cvtps_epi32(v); i = _mm_packus_epi16(_mm_packus_epi32(i, i), i); int32_t b = _mm_cvtsi128_si32(i); std::memcpy(p, &b, 4); }
+			static V    set1(float v)               { return _mm_set1_ps(v); }
+			static V    lane()                      { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+			static V    add(V a, V b)               { return _mm_add_ps(a, b); }
+			static V    sub(V a, V b)               { return _mm_sub_ps(a, b); }
+			static V    mul(V a, V b)               { return _mm_mul_ps(a, b); }
+			static V    mulRounded(V a, V b)        { return _mm_mul_ps(a, b); }
+			static V    div(V a, V b)               { return _mm_div_ps(a, b); }
+			static V    min(V a, V b)               { return _mm_min_ps(a, b); }
+			static V    max(V a, V b)               { return _mm_max_ps(a, b); }
+			static V    abs(V a)                    { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+			static V    sqrt(V a)                   { return _mm_sqrt_ps(a); }
+			static V    floor(V a)                  { return _mm_floor_ps(a); }
+			static V    pow2i(V n)                  { return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23)); }
+			static V    exponent(V a)               { return _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(_mm_castps_si128(a), 23), _mm_set1_epi32(0xFF)), _mm_set1_epi32(127))); }
+			static V    mantissa(V a)               { return _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(_mm_castps_si128(a), _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000))); }
+			static M    lt(V a, V b)                { return _mm_cmplt_ps(a, b); }
+			static M    ge(V a, V b)                { return _mm_cmpge_ps(a, b); }
+			static M    andMask(M a, M b)           { return _mm_and_ps(a, b); }
+			static V    select(M m, V a, V b)       { return _mm_blendv_ps(b, a, m); }
+			static uint32_t maskBits(M m)           { return uint32_t(_mm_movemask_ps(m)); }
+			static M    fromBits(uint32_t bits)     { const __m128i b = _mm_setr_epi32(1, 2, 4, 8); return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(int(bits)), b), b)); }
+		};
+	}
+
+	void atrousSimdSSE41(const AtrousSimdArgs &args)
+	{
+		SimdKernels::atrousRows<SSE41Ops>(args);
+	}
+
+	void geometryWeightsSimdSSE41(const GeometryWeightSimdArgs &args)
+	{
+		SimdKernels::geometryWeightRows<SSE41Ops>(args);
+	}
+
+	void upsampleSimdSSE41(const UpsampleSimdArgs &args)
+	{
+		SimdKernels::upsampleIndirectRows<SSE41Ops>(args);
+	}
+
+	void bvhPacketSimdSSE41(const BvhPacketArgs &args)
+	{
+		SimdKernels::bvhPackets<SSE41Ops>(args);
+	}
+
+	void convolveSimdSSE41(const ConvolveSimdArgs &args)
+	{
+		SimdKernels::convolveRows<SSE41Ops>(args);
+	}
+
+	void metricsSimdSSE41(const MetricsSimdArgs &args)
+	{
+		SimdKernels::metricsRows<SSE41Ops>(args);
+	}
+
+	void temporalAASimdSSE41(const TemporalAASimdArgs &args)
+	{
+		SimdKernels::temporalAARows<SSE41Ops>(args);
+	}
+}
+#endif
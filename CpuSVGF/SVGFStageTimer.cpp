@@ -0,0 +1,149 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFStageTimer.h"
+#include <algorithm>
+#include <chrono>
+
+namespace CpuSVGF
+{
+	TimerBackend::SharedPtr ClockTimerBackend::create(Clock clock)
+	{
+		if (!clock)
+		{
+			clock = []()
+			{
+				return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			};
+		}
+		return TimerBackend::SharedPtr(new ClockTimerBackend(clock));
+	}
+
+	void ClockTimerBackend::begin(uint32_t stage)
+	{
+		if (stage >= mIntervals.size()) mIntervals.resize(stage + 1);
+		mIntervals[stage].start = mClock();
+	}
+
+	void ClockTimerBackend::end(uint32_t stage)
+	{
+		if (stage >= mIntervals.size()) return;
+		Interval &interval = mIntervals[stage];
+
+		// A stage that runs several times in a frame reports the sum
+		const double elapsed = mClock() - interval.start;
+		interval.elapsed = interval.pending ? interval.elapsed + elapsed : elapsed;
+		interval.pending = true;
+	}
+
+	bool ClockTimerBackend::resolve(uint32_t stage, double &ms)
+	{
+		if (stage >= mIntervals.size() || !mIntervals[stage].pending) return false;
+		ms = mIntervals[stage].elapsed;
+		mIntervals[stage].pending = false;
+		return true;
+	}
+
+	StageTimer::SharedPtr StageTimer::create(TimerBackend::SharedPtr pBackend, uint32_t historyLength)
+	{
+		return SharedPtr(new StageTimer(pBackend ? pBackend : ClockTimerBackend::create(), std::max(1u, historyLength)));
+	}
+
+	StageTimer::StageTimer(TimerBackend::SharedPtr pBackend, uint32_t historyLength)
+		: mpBackend(pBackend), mHistoryLength(historyLength)
+	{
+	}
+
+	uint32_t StageTimer::getStageId(const std::string &name)
+	{
+		uint32_t stage;
+		if (findStage(name, stage)) return stage;
+
+		mStages.emplace_back();
+		mStages.back().name = name;
+		return uint32_t(mStages.size() - 1);
+	}
+
+	bool StageTimer::findStage(const std::string &name, uint32_t &stage) const
+	{
+		for (uint32_t i = 0; i < mStages.size(); i++)
+		{
+			if (mStages[i].name == name)
+			{
+				stage = i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void StageTimer::addSample(uint32_t stage, double ms)
+	{
+		Stage &s = mStages[stage];
+		if (s.samples.size() < mHistoryLength)
+			s.samples.push_back(ms);
+		else
+			s.samples[s.next] = ms;
+		s.next      = (s.next + 1) % mHistoryLength;
+		s.lastFrame = mFrameCount + 1;    // The frame endFrame() is about to close
+	}
+
+	void StageTimer::endFrame()
+	{
+		for (uint32_t i = 0; i < mStages.size(); i++)
+		{
+			double ms;
+			if (mpBackend->resolve(i, ms)) addSample(i, ms);
+		}
+		mpBackend->endFrame();
+		mFrameCount++;
+	}
+
+	StageTimer::Stats StageTimer::getStats(uint32_t stage) const
+	{
+		Stats stats;
+		const Stage &s = mStages[stage];
+		if (s.samples.empty()) return stats;
+
+		std::vector<double> sorted = s.samples;
+		std::sort(sorted.begin(), sorted.end());
+
+		double sum = 0.0;
+		for (double ms : sorted) sum += ms;
+
+		const size_t n = sorted.size();
+		stats.count  = uint32_t(n);
+		stats.lastMs = s.samples[(s.next + n - 1) % n];
+		stats.minMs  = sorted.front();
+		stats.maxMs  = sorted.back();
+		stats.avgMs  = sum / double(n);
+		stats.p99Ms  = sorted[(99 * n + 99) / 100 - 1];   // ceil(0.99 n) - 1
+		return stats;
+	}
+
+	void StageTimer::reset()
+	{
+		for (Stage &s : mStages)
+		{
+			s.samples.clear();
+			s.next      = 0;
+			s.lastFrame = 0;
+		}
+		mFrameCount = 0;
+	}
+}
@@ -0,0 +1,186 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CpuSVGF
+{
+	/** Measures how long a stage took.  StageTimer doesn't care what "time" is:  CPU builds use a clock,
+	    SVGFPass uses GPU timestamp queries whose results only arrive a frame later.
+	*/
+	class TimerBackend
+	{
+	public:
+		using SharedPtr = std::shared_ptr<TimerBackend>;
+		virtual ~TimerBackend() = default;
+
+		virtual void begin(uint32_t stage) = 0;
+		virtual void end(uint32_t stage) = 0;
+
+		/** Milliseconds between the last begin() / end() pair of the stage that hasn't been resolved yet.  Returns
+		    false if there is none, or its result isn't available yet.
+		*/
+		virtual bool resolve(uint32_t stage, double &ms) = 0;
+
+		/** Called once all of a frame's stages have been resolved
+		*/
+		virtual void endFrame() {}
+	};
+
+	/** Times stages by reading a clock (in milliseconds) at begin() and end().  Results resolve immediately.
+	*/
+	class ClockTimerBackend : public TimerBackend
+	{
+	public:
+		using Clock = std::function<double()>;
+
+		/** A null clock uses std::chrono::steady_clock
+		*/
+		static SharedPtr create(Clock clock = nullptr);
+
+		void begin(uint32_t stage) override;
+		void end(uint32_t stage) override;
+		bool resolve(uint32_t stage, double &ms) override;
+
+	protected:
+		ClockTimerBackend(Clock clock) : mClock(clock) {}
+
+		struct Interval
+		{
+			double start   = 0.0;
+			double elapsed = 0.0;
+			bool   pending = false;
+		};
+
+		Clock                 mClock;
+		std::vector<Interval> mIntervals;
+	};
+
+	/** A clock that only moves when told to, for checking StageTimer against known durations
+	*/
+	class ManualClock
+	{
+	public:
+		using SharedPtr = std::shared_ptr<ManualClock>;
+		static SharedPtr create() { return SharedPtr(new ManualClock()); }
+
+		void   advance(double ms) { mNowMs += ms; }
+		double now() const        { return mNowMs; }
+
+		/** A ClockTimerBackend::Clock reading this clock (which it keeps alive)
+		*/
+		static ClockTimerBackend::Clock bind(SharedPtr pClock) { return [pClock]() { return pClock->now(); }; }
+
+	private:
+		ManualClock() = default;
+		double mNowMs = 0.0;
+	};
+
+	/** Named stages with a rolling history of their durations.  Wrap each stage in a Scope, and call endFrame()
+	    once per frame to move the backend's results into the history.  Stages nest and may be skipped on some frames.
+	*/
+	class StageTimer
+	{
+	public:
+		using SharedPtr = std::shared_ptr<StageTimer>;
+
+		/** Statistics over the stage's history, in milliseconds
+		*/
+		struct Stats
+		{
+			uint32_t count  = 0;      ///< Samples in the history
+			double   lastMs = 0.0;
+			double   minMs  = 0.0;
+			double   avgMs  = 0.0;
+			double   p99Ms  = 0.0;    ///< Nearest-rank 99th percentile
+			double   maxMs  = 0.0;
+		};
+
+		/** Keep the last historyLength samples of each stage.  A null backend times with the steady clock.
+		*/
+		static SharedPtr create(TimerBackend::SharedPtr pBackend = nullptr, uint32_t historyLength = 128);
+
+		/** Id of the named stage, registering it on first use.  Stages are listed in registration order.
+		*/
+		uint32_t getStageId(const std::string &name);
+
+		/** Returns false if no stage has that name
+		*/
+		bool findStage(const std::string &name, uint32_t &stage) const;
+
+		void begin(uint32_t stage) { mpBackend->begin(stage); }
+		void end(uint32_t stage)   { mpBackend->end(stage); }
+
+		/** Record a duration measured some other way
+		*/
+		void addSample(uint32_t stage, double ms);
+
+		/** Resolve every stage's pending result into its history
+		*/
+		void endFrame();
+
+		uint32_t           getStageCount() const                { return uint32_t(mStages.size()); }
+		const std::string &getStageName(uint32_t stage) const   { return mStages[stage].name; }
+		Stats              getStats(uint32_t stage) const;
+
+		/** True if the stage got a sample in the last endFrame().  Stages that stopped running (say, a-trous
+		    iterations past a lowered iteration count) keep their history but are no longer active.
+		*/
+		bool isActive(uint32_t stage) const { return mStages[stage].lastFrame == mFrameCount && mFrameCount > 0; }
+
+		/** Drop all history, keeping the registered stages
+		*/
+		void reset();
+
+		/** Times the enclosing block.  A null timer makes this a no-op, so instrumentation can stay in place.
+		*/
+		class Scope
+		{
+		public:
+			Scope(StageTimer *pTimer, uint32_t stage) : mpTimer(pTimer), mStage(stage) { if (mpTimer) mpTimer->begin(mStage); }
+			~Scope() { if (mpTimer) mpTimer->end(mStage); }
+			Scope(const Scope &) = delete;
+			Scope &operator=(const Scope &) = delete;
+
+		private:
+			StageTimer *mpTimer;
+			uint32_t    mStage;
+		};
+
+	protected:
+		StageTimer(TimerBackend::SharedPtr pBackend, uint32_t historyLength);
+
+		struct Stage
+		{
+			std::string         name;
+			std::vector<double> samples;      ///< Ring buffer of up to mHistoryLength durations
+			uint32_t            next      = 0;
+			uint64_t            lastFrame = 0;
+		};
+
+		TimerBackend::SharedPtr mpBackend;
+		uint32_t                mHistoryLength;
+		uint64_t                mFrameCount = 0;
+		std::vector<Stage>      mStages;
+	};
+}
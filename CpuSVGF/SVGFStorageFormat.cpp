@@ -0,0 +1,103 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFStorageFormat.h"
+
+namespace CpuSVGF
+{
+	const char *getStorageFormatName(StorageFormat format)
+	{
+		switch (format)
+		{
+		case StorageFormat::Full:    return "full";
+		case StorageFormat::Half:    return "half";
+		case StorageFormat::Compact: return "compact";
+		default:                     return "unknown";
+		}
+	}
+
+	StorageFootprint getStorageFootprint(StorageFormat format)
+	{
+		switch (format)
+		{
+		case StorageFormat::Half:    return { 8, 8, 8, 2 };
+		case StorageFormat::Compact: return { 4 + 2, 4, 2 * 4, 1 };
+		default:                     return { 16, 16, 16, 2 };
+		}
+	}
+
+	uint32_t getFilterStateBytesPerPixel(StorageFormat format)
+	{
+		const StorageFootprint f = getStorageFootprint(format);
+		const uint32_t pingPong  = 2 * 2 * f.illum;                                  // 2 FBOs, direct + indirect
+		const uint32_t past      = 2 * f.filteredPast;
+		const uint32_t reproj    = 2 * (2 * f.illum + f.moments + f.historyLength);  // current and previous frame
+		const uint32_t fixed     = 16 + 16;                                          // prev linear z and output, always RGBA32F
+		return pingPong + past + reproj + fixed;
+	}
+
+	void quantizeIllum(CpuThreadPool &pool, StorageFormat format, ImageF4 &image)
+	{
+		if (format == StorageFormat::Full) return;
+		forEachRowBand(pool, image.getHeight(), 16, [&](int y0, int y1)
+		{
+			for (int y = y0; y < y1; y++)
+				for (int x = 0; x < int(image.getWidth()); x++)
+					image.at(x, y) = quantizeIllum(format, image.at(x, y));
+		});
+	}
+
+	void quantizeIllum(CpuThreadPool &pool, StorageFormat format, PlanarImage &planar)
+	{
+		if (format == StorageFormat::Full) return;
+
+		float *p[kIllumPlaneCount];
+		for (uint32_t i = 0; i < kIllumPlaneCount; i++) p[i] = planar.getPlane(i);
+		const uint32_t stride = planar.getStride();
+
+		forEachRowBand(pool, planar.getHeight(), 16, [&](int y0, int y1)
+		{
+			for (int y = y0; y < y1; y++)
+			{
+				for (int x = 0; x < int(planar.getWidth()); x++)
+				{
+					const size_t i = size_t(y) * stride + x;
+					float4 d = quantizeIllum(format, float4(p[kDirectR][i],   p[kDirectG][i],   p[kDirectB][i],   p[kDirectVar][i]));
+					float4 n = quantizeIllum(format, float4(p[kIndirectR][i], p[kIndirectG][i], p[kIndirectB][i], p[kIndirectVar][i]));
+					p[kDirectR][i]   = d.x;  p[kDirectG][i]   = d.y;  p[kDirectB][i]   = d.z;  p[kDirectVar][i]   = d.w;
+					p[kIndirectR][i] = n.x;  p[kIndirectG][i] = n.y;  p[kIndirectB][i] = n.z;  p[kIndirectVar][i] = n.w;
+
+					// The kernel reads luminance from its own planes; keep it consistent with the stored color
+					p[kDirectLum][i]   = luminance(d.rgb());
+					p[kIndirectLum][i] = luminance(n.rgb());
+				}
+			}
+		});
+	}
+
+	void quantizeMoments(CpuThreadPool &pool, StorageFormat format, ImageF4 &image)
+	{
+		if (format == StorageFormat::Full) return;
+		forEachRowBand(pool, image.getHeight(), 16, [&](int y0, int y1)
+		{
+			for (int y = y0; y < y1; y++)
+				for (int x = 0; x < int(image.getWidth()); x++)
+					image.at(x, y) = quantizeMoments(format, image.at(x, y));
+		});
+	}
+}
@@ -0,0 +1,112 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Emulates the reduced precision render target formats SVGFPass can store its history and ping-pong buffers in,
+//     so the CPU filter can measure the error each one introduces against full precision.
+
+#pragma once
+#include "SVGFPlanar.h"
+
+namespace CpuSVGF
+{
+	/** Same modes, in the same order, as SVGFPass::StorageFormat
+	*/
+	enum class StorageFormat : uint32_t
+	{
+		Full,       ///< Illumination and moments RGBA32F, history length R16F (the original layout)
+		Half,       ///< Illumination and moments RGBA16F, history length R16F
+		Compact,    ///< Color R11G11B10F with variance in its own R16F, moments as two RG16F, history length R8
+		Count
+	};
+
+	const char *getStorageFormatName(StorageFormat format);
+
+	/** Bytes per pixel of one buffer of each kind for a storage format
+	*/
+	struct StorageFootprint
+	{
+		uint32_t illum;          ///< Color + variance (ping-pong and reprojected illumination)
+		uint32_t filteredPast;   ///< Color only; the reprojection never reads the variance of the filtered past
+		uint32_t moments;
+		uint32_t historyLength;
+	};
+
+	StorageFootprint getStorageFootprint(StorageFormat format);
+
+	/** Bytes per pixel of all the filter state SVGFPass::resize() allocates:  ping-pong, filtered past, both
+	    reprojection buffers, the previous linear z copy and the output target
+	*/
+	uint32_t getFilterStateBytesPerPixel(StorageFormat format);
+
+	/** Round to the nearest value representable by an unsigned float with a 5 bit exponent and the given mantissa
+	    bits (6 for R11F, 5 for B10F), the way render target writes convert.  Negative values and NaN become 0.
+	*/
+	inline float quantizeSmallFloat(float v, uint32_t mantissaBits)
+	{
+		if (!(v > 0.0f)) return 0.0f;
+
+		const float maxValue = (2.0f - std::ldexp(1.0f, -int(mantissaBits))) * 32768.0f;
+		if (v >= maxValue) return maxValue;
+
+		// Below the smallest normal the spacing is fixed
+		if (v < std::ldexp(1.0f, -14))
+		{
+			const float step = std::ldexp(1.0f, -14 - int(mantissaBits));
+			return std::nearbyint(v / step) * step;
+		}
+
+		const uint32_t shift = 23 - mantissaBits;
+		uint32_t u   = asuint(v);
+		uint32_t rem = u & ((1u << shift) - 1u);
+		u -= rem;
+		if (rem > (1u << (shift - 1)) || (rem == (1u << (shift - 1)) && ((u >> shift) & 1u))) u += 1u << shift;
+		return std::min(asfloat(u), maxValue);
+	}
+
+	inline float quantizeHalf(float v) { return f16tof32(f32tof16(v)); }
+
+	/** Value read back after storing illumination (rgb + variance in w) in the given format
+	*/
+	inline float4 quantizeIllum(StorageFormat format, const float4 &v)
+	{
+		switch (format)
+		{
+		case StorageFormat::Half:    return float4(quantizeHalf(v.x), quantizeHalf(v.y), quantizeHalf(v.z), quantizeHalf(v.w));
+		case StorageFormat::Compact: return float4(quantizeSmallFloat(v.x, 6), quantizeSmallFloat(v.y, 6), quantizeSmallFloat(v.z, 5), quantizeHalf(v.w));
+		default:                     return v;
+		}
+	}
+
+	/** Value read back after storing luminance moments in the given format.  Compact keeps them as two RG16F pairs,
+	    so it has the same precision as Half.
+	*/
+	inline float4 quantizeMoments(StorageFormat format, const float4 &v)
+	{
+		if (format == StorageFormat::Full) return v;
+		return float4(quantizeHalf(v.x), quantizeHalf(v.y), quantizeHalf(v.z), quantizeHalf(v.w));
+	}
+
+	// History length is an integer in [1, 32], exact in R16F and in R8 (SVGFPass stores it scaled by 1/255 in
+	//    R8Unorm), so it needs no emulation.
+
+	/** Apply quantizeIllum() to whole buffers
+	*/
+	void quantizeIllum(CpuThreadPool &pool, StorageFormat format, ImageF4 &image);
+	void quantizeIllum(CpuThreadPool &pool, StorageFormat format, PlanarImage &planar);
+	void quantizeMoments(CpuThreadPool &pool, StorageFormat format, ImageF4 &image);
+}
@@ -0,0 +1,272 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFSyntheticFrames.h"
+#include "SVGFRandom.h"
+
+namespace CpuSVGF
+{
+	namespace {
+		const float kPi        = 3.14159265f;
+		const float kTanHalfFovY = 0.4663f;                         // 50 degree vertical field of view
+		const float3 kSkyColor = float3(0.6f, 0.7f, 0.9f);
+		const float3 kLightPos = float3(1.0f, 3.0f, 2.0f);
+		const float  kLightSize = 1.0f;
+		const float  kLightIntensity = 12.0f;
+
+		struct Sphere { float3 center; float radius; float3 albedo; };
+		const Sphere kSpheres[3] = {
+			{ float3(-0.8f, 0.5f,  0.0f),  0.5f,  float3(0.8f, 0.2f, 0.2f) },
+			{ float3( 0.7f, 0.35f, 0.6f),  0.35f, float3(0.2f, 0.8f, 0.3f) },
+			{ float3( 0.3f, 0.9f, -1.6f),  0.9f,  float3(0.7f, 0.7f, 0.75f) },
+		};
+
+		struct Hit { float t; float3 pos; float3 normal; float3 albedo; };
+
+		bool intersectScene(const float3 &origin, const float3 &dir, float maxT, Hit &hit)
+		{
+			hit.t = maxT;
+			bool found = false;
+
+			for (const Sphere &s : kSpheres)
+			{
+				float3 oc = origin - s.center;
+				float b = dot(oc, dir);
+				float c = dot(oc, oc) - s.radius * s.radius;
+				float disc = b * b - c;
+				if (disc < 0.0f) continue;
+				float t = -b - std::sqrt(disc);
+				if (t > 1e-3f && t < hit.t)
+				{
+					hit.t      = t;
+					hit.pos    = origin + dir * t;
+					hit.normal = (hit.pos - s.center) / s.radius;
+					hit.albedo = s.albedo;
+					found = true;
+				}
+			}
+
+			// Floor at y = 0, with a checkerboard
+			if (dir.y < 0.0f)
+			{
+				float t = -origin.y / dir.y;
+				if (t > 1e-3f && t < hit.t)
+				{
+					hit.t      = t;
+					hit.pos    = origin + dir * t;
+					hit.normal = float3(0.0f, 1.0f, 0.0f);
+					bool odd   = ((int(std::floor(hit.pos.x * 2.0f)) + int(std::floor(hit.pos.z * 2.0f))) & 1) != 0;
+					hit.albedo = odd ? float3(0.8f, 0.8f, 0.8f) : float3(0.3f, 0.3f, 0.35f);
+					found = true;
+				}
+			}
+
+			// Back wall at z = -3
+			if (dir.z < 0.0f)
+			{
+				float t = (-3.0f - origin.z) / dir.z;
+				if (t > 1e-3f && t < hit.t)
+				{
+					hit.t      = t;
+					hit.pos    = origin + dir * t;
+					hit.normal = float3(0.0f, 0.0f, 1.0f);
+					hit.albedo = float3(0.7f, 0.6f, 0.5f);
+					found = true;
+				}
+			}
+			return found;
+		}
+
+		struct Camera
+		{
+			float3 pos, right, up, fwd;
+			float  aspect;
+
+			Camera(float panX, float aspect_) : aspect(aspect_)
+			{
+				pos   = float3(panX, 1.2f, 4.0f);
+				fwd   = normalize(float3(0.0f, -0.15f, -1.0f));
+				right = normalize(cross(fwd, float3(0.0f, 1.0f, 0.0f)));
+				up    = cross(right, fwd);
+			}
+
+			float3 rayDir(float u, float v) const
+			{
+				float px = (2.0f * u - 1.0f) * kTanHalfFovY * aspect;
+				float py = (1.0f - 2.0f * v) * kTanHalfFovY;
+				return normalize(fwd + right * px + up * py);
+			}
+
+			// Returns screen uv of a world point, and its view depth
+			float2 project(const float3 &p, float &depth) const
+			{
+				float3 d = p - pos;
+				depth = dot(d, fwd);
+				float px = dot(d, right) / depth / (kTanHalfFovY * aspect);
+				float py = dot(d, up) / depth / kTanHalfFovY;
+				return float2((px + 1.0f) * 0.5f, (1.0f - py) * 0.5f);
+			}
+		};
+	};
+
+	SyntheticFrameSource::SharedPtr SyntheticFrameSource::create(uint32_t width, uint32_t height, float cameraPan, CpuThreadPool::SharedPtr pThreadPool)
+	{
+		if (width == 0 || height == 0) return nullptr;
+		return SharedPtr(new SyntheticFrameSource(width, height, cameraPan, pThreadPool ? pThreadPool : CpuThreadPool::create()));
+	}
+
+	SyntheticFrameSource::SyntheticFrameSource(uint32_t width, uint32_t height, float cameraPan, CpuThreadPool::SharedPtr pThreadPool)
+		: mWidth(width), mHeight(height), mCameraPan(cameraPan), mpThreadPool(pThreadPool)
+	{
+		mWorldPos.resize(width, height);
+		mWorldNorm.resize(width, height);
+		for (ImageF4 *pImage : { &mDirectIllum, &mIndirectIllum, &mLinearZ, &mMotionVecs, &mCompactNormDepth, &mDirAlbedo, &mIndirAlbedo })
+			pImage->resize(width, height);
+
+		mInputs.directIllum   = &mDirectIllum;
+		mInputs.indirectIllum = &mIndirectIllum;
+		mInputs.linearZ       = &mLinearZ;
+		mInputs.motionVecs    = &mMotionVecs;
+		mInputs.miscBuf       = &mCompactNormDepth;
+		mInputs.dirAlbedo     = &mDirAlbedo;
+		mInputs.indirAlbedo   = &mIndirAlbedo;
+	}
+
+	const FrameInputs &SyntheticFrameSource::renderFrame(uint32_t frameIndex)
+	{
+		const float aspect = float(mWidth) / float(mHeight);
+		const Camera camera(mCameraPan * float(frameIndex), aspect);
+		const Camera prevCamera(mCameraPan * float(frameIndex > 0 ? frameIndex - 1 : 0), aspect);
+		const float2 invSize = float2(1.0f / float(mWidth), 1.0f / float(mHeight));
+
+		// Pass 1:  primary visibility, G-buffer and one noisy sample of direct / indirect light
+		mpThreadPool->forEachTile(mWidth, mHeight, 32, [&](const TileRect &tile)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					const float u = (float(x) + 0.5f) * invSize.x;
+					const float v = (float(y) + 0.5f) * invSize.y;
+					const float3 dir = camera.rayDir(u, v);
+
+					Hit hit;
+					if (!intersectScene(camera.pos, dir, 1e30f, hit))
+					{
+						// Background, as written by clearGBuffer.ps.hlsl and the GI pass' miss path
+						mWorldPos.at(x, y)         = float3(0.0f);
+						mWorldNorm.at(x, y)        = float3(0.0f);
+						mLinearZ.at(x, y)          = float4(0.0f);
+						mMotionVecs.at(x, y)       = float4(0.0f);
+						mCompactNormDepth.at(x, y) = float4(0.0f, -1.0f, 0.0f, 0.0f);
+						mDirectIllum.at(x, y)      = float4(kSkyColor, 1.0f);
+						mIndirectIllum.at(x, y)    = float4(0.0f, 0.0f, 0.0f, 1.0f);
+						mDirAlbedo.at(x, y)        = float4(1.0f);
+						mIndirAlbedo.at(x, y)      = float4(1.0f);
+						continue;
+					}
+
+					uint32_t randSeed = initRand(uint32_t(x + y * int(mWidth)), frameIndex + 0x1337u, 16);
+
+					// Direct light from a random point on a square area light
+					float3 lightPt = kLightPos + float3((nextRand(randSeed) - 0.5f) * kLightSize, 0.0f, (nextRand(randSeed) - 0.5f) * kLightSize);
+					float3 toLight = lightPt - hit.pos;
+					float  distToLight = length(toLight);
+					toLight = toLight / distToLight;
+					Hit shadowHit;
+					float visibility = intersectScene(hit.pos + hit.normal * 1e-3f, toLight, distToLight, shadowHit) ? 0.0f : 1.0f;
+					float NdotL = saturate(dot(hit.normal, toLight));
+					float3 directColor = float3(kLightIntensity * NdotL * visibility / (distToLight * distToLight));
+
+					// One cosine-weighted bounce; the hit returns its diffuse color, like IndirectClosestHit
+					float r1 = nextRand(randSeed), r2 = nextRand(randSeed);
+					float3 b = normalize(std::abs(hit.normal.y) < 0.9f ? cross(hit.normal, float3(0.0f, 1.0f, 0.0f)) : cross(hit.normal, float3(1.0f, 0.0f, 0.0f)));
+					float3 t = cross(b, hit.normal);
+					float  r = std::sqrt(r1), phi = 2.0f * kPi * r2;
+					float3 bounceDir = t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + hit.normal * std::sqrt(std::max(0.0f, 1.0f - r1));
+					Hit bounceHit;
+					float3 bounceColor = intersectScene(hit.pos + hit.normal * 1e-3f, bounceDir, 1e30f, bounceHit) ? bounceHit.albedo : kSkyColor;
+
+					float3 difTerm = hit.albedo / kPi;
+					float3 indirAlbedo = float3(std::max(5e-3f, difTerm.x), std::max(5e-3f, difTerm.y), std::max(5e-3f, difTerm.z));
+
+					// G-buffer data, in the layout of gBufferSVGF.ps.hlsl
+					float prevDepth;
+					float2 prevUV = prevCamera.project(hit.pos, prevDepth);
+					float  linearZ = dot(hit.pos - camera.pos, camera.fwd);
+					float  octNorm = asfloat(dirToOct(hit.normal));
+
+					mWorldPos.at(x, y)         = hit.pos;
+					mWorldNorm.at(x, y)        = hit.normal;
+					mLinearZ.at(x, y)          = float4(linearZ, 0.0f, prevDepth, octNorm);
+					mMotionVecs.at(x, y)       = float4(prevUV.x - u, prevUV.y - v, 0.0f, 0.0f);
+					mCompactNormDepth.at(x, y) = float4(octNorm, linearZ, 0.0f, 0.0f);
+					mDirectIllum.at(x, y)      = float4(directColor, 1.0f);
+					mIndirectIllum.at(x, y)    = float4(bounceColor, 1.0f);
+					mDirAlbedo.at(x, y)        = float4(difTerm, 1.0f);
+					mIndirAlbedo.at(x, y)      = float4(indirAlbedo, 1.0f);
+				}
+			}
+		});
+
+		// Pass 2:  screen-space derivatives
+		computeGBufferDerivatives(*mpThreadPool, mWorldPos, mWorldNorm, mLinearZ, mMotionVecs, mCompactNormDepth);
+
+		return mInputs;
+	}
+
+	void computeGBufferDerivatives(CpuThreadPool &pool, const Image<float3> &worldPos, const Image<float3> &worldNorm,
+	                               ImageF4 &linearZ, ImageF4 &motionVecs, ImageF4 &compactNormDepth)
+	{
+		const uint32_t width = linearZ.getWidth(), height = linearZ.getHeight();
+		pool.forEachTile(width, height, 32, [&](const TileRect &tile)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					if (compactNormDepth.at(x, y).y < 0.0f) continue;
+
+					int qx = std::min(x & ~1, int(width) - 2);
+					int qy = std::min(y & ~1, int(height) - 2);
+					int nx = (x == qx) ? qx + 1 : qx;
+					int ny = (y == qy) ? qy + 1 : qy;
+					bool validX = nx >= 0 && compactNormDepth.at(nx, y).y >= 0.0f;
+					bool validY = ny >= 0 && compactNormDepth.at(x, ny).y >= 0.0f;
+
+					float  z = linearZ.at(x, y).x;
+					float  dzx = validX ? std::abs(linearZ.at(nx, y).x - z) : 0.0f;
+					float  dzy = validY ? std::abs(linearZ.at(x, ny).x - z) : 0.0f;
+					float3 dpx = validX ? worldPos.at(nx, y) - worldPos.at(x, y) : float3(0.0f);
+					float3 dpy = validY ? worldPos.at(x, ny) - worldPos.at(x, y) : float3(0.0f);
+					float3 dnx = validX ? worldNorm.at(nx, y) - worldNorm.at(x, y) : float3(0.0f);
+					float3 dny = validY ? worldNorm.at(x, ny) - worldNorm.at(x, y) : float3(0.0f);
+
+					float maxChangeZ = std::max(dzx, dzy);
+					float fwidthPos  = length(float3(std::abs(dpx.x) + std::abs(dpy.x), std::abs(dpx.y) + std::abs(dpy.y), std::abs(dpx.z) + std::abs(dpy.z)));
+					float fwidthNorm = length(float3(std::abs(dnx.x) + std::abs(dny.x), std::abs(dnx.y) + std::abs(dny.y), std::abs(dnx.z) + std::abs(dny.z)));
+
+					linearZ.at(x, y).y          = maxChangeZ;
+					compactNormDepth.at(x, y).z = maxChangeZ;
+					motionVecs.at(x, y).z       = fwidthPos;
+					motionVecs.at(x, y).w       = fwidthNorm;
+				}
+			}
+		});
+	}
+}
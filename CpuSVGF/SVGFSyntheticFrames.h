@@ -0,0 +1,72 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include "CpuSVGFFilter.h"
+
+namespace CpuSVGF
+{
+	/** Procedurally renders plausible SVGF inputs (a floor, a wall and three spheres lit by an area light, at
+	    one noisy sample per pixel) in the same layout GBufferForSVGF and GGXGlobalIlluminationPass produce.
+	    Used to exercise and benchmark the CPU filter when no captured frames are available.
+	*/
+	class SyntheticFrameSource
+	{
+	public:
+		using SharedPtr = std::shared_ptr<SyntheticFrameSource>;
+
+		/** cameraPan is the sideways camera translation per frame (in scene units); 0 gives a static camera
+		*/
+		static SharedPtr create(uint32_t width, uint32_t height, float cameraPan = 0.0f, CpuThreadPool::SharedPtr pThreadPool = nullptr);
+
+		/** Render the given frame and return views of the internal buffers (valid until the next call)
+		*/
+		const FrameInputs &renderFrame(uint32_t frameIndex);
+
+		uint32_t getWidth() const  { return mWidth; }
+		uint32_t getHeight() const { return mHeight; }
+
+	private:
+		SyntheticFrameSource(uint32_t width, uint32_t height, float cameraPan, CpuThreadPool::SharedPtr pThreadPool);
+
+		uint32_t                 mWidth;
+		uint32_t                 mHeight;
+		float                    mCameraPan;
+		CpuThreadPool::SharedPtr mpThreadPool;
+
+		// Per-pixel world position / normal; only needed to compute screen-space derivatives
+		Image<float3>            mWorldPos;
+		Image<float3>            mWorldNorm;
+
+		ImageF4                  mDirectIllum;
+		ImageF4                  mIndirectIllum;
+		ImageF4                  mLinearZ;
+		ImageF4                  mMotionVecs;
+		ImageF4                  mCompactNormDepth;
+		ImageF4                  mDirAlbedo;
+		ImageF4                  mIndirAlbedo;
+		FrameInputs              mInputs;
+	};
+
+	/** Fill in the screen-space derivative terms of the G-buffer channels (max z-deriv in linearZ.y and
+	    compactNormDepth.z, fwidth of position and normal in motionVecs.zw) from per-pixel world position, normal and
+	    linear z, using 2x2 quads the way ddx() / ddy() do on the GPU.  Background pixels have compactNormDepth.y < 0.
+	*/
+	void computeGBufferDerivatives(CpuThreadPool &pool, const Image<float3> &worldPos, const Image<float3> &worldNorm,
+	                               ImageF4 &linearZ, ImageF4 &motionVecs, ImageF4 &compactNormDepth);
+}
@@ -0,0 +1,124 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFTemporalAA.h"
+#include "SVGFKernels.h"
+#include <algorithm>
+#include <chrono>
+
+namespace CpuSVGF
+{
+	namespace
+	{
+		const uint32_t kBandHeight = 16;
+	}
+
+	TemporalAA::SharedPtr TemporalAA::create(CpuThreadPool::SharedPtr pThreadPool)
+	{
+		return SharedPtr(new TemporalAA(pThreadPool ? pThreadPool : CpuThreadPool::create()));
+	}
+
+	TemporalAA::TemporalAA(CpuThreadPool::SharedPtr pThreadPool)
+		: mpThreadPool(pThreadPool)
+	{
+	}
+
+	bool TemporalAA::execute(const ImageF4 &color, const ImageF4 &motionVecs, ImageF4 &output)
+	{
+		const uint32_t width  = color.getWidth();
+		const uint32_t height = color.getHeight();
+		if (color.empty() || motionVecs.getWidth() != width || motionVecs.getHeight() != height) return false;
+
+		auto start = std::chrono::steady_clock::now();
+		if (output.getWidth() != width || output.getHeight() != height)
+			output.resize(width, height);
+
+		if (!mSettings.enabled)
+		{
+			std::copy(color.getData(), color.getData() + color.getPixelCount(), output.getData());
+			mHasHistory = false;
+			mLastTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			return true;
+		}
+
+		// Like TemporalAAPass::resize(), a new size starts over
+		if (mHistory[0].getWidth() != width || mHistory[0].getHeight() != height)
+		{
+			for (ImageF4 &history : mHistory) history.resize(width, height);
+			mHasHistory = false;
+		}
+
+		const ImageF4 &history    = mHistory[mCurrent];
+		ImageF4       &newHistory = mHistory[mCurrent ^ 1];
+
+		if (mSettings.simd)
+		{
+			if (mYCoCg.getWidth() != width || mYCoCg.getHeight() != height) mYCoCg.resize(width, height, 3);
+
+			const TemporalAASimdFunc kernel = getTemporalAASimdKernel(mSettings.simdIsa);
+			TemporalAASimdArgs args;
+			args.pColor      = &color;
+			args.pYCoCg      = &mYCoCg;
+			args.pMotion     = &motionVecs;
+			args.pHistory    = mHasHistory ? &history : nullptr;
+			args.pOutput     = &output;
+			args.pNewHistory = &newHistory;
+			args.alpha       = mSettings.alpha;
+
+			// The neighborhoods span bands, so the whole frame is converted first
+			for (TemporalAASimdStage stage : { TemporalAASimdStage::ToYCoCg, TemporalAASimdStage::Resolve })
+			{
+				forEachRowBand(*mpThreadPool, height, kBandHeight, [&](int y0, int y1)
+				{
+					TemporalAASimdArgs bandArgs = args;
+					bandArgs.stage = stage;
+					bandArgs.y0    = y0;
+					bandArgs.y1    = y1;
+					kernel(bandArgs);
+				});
+			}
+		}
+		else
+		{
+			TemporalAASources src;
+			src.pColor     = &color;
+			src.pMotion    = &motionVecs;
+			src.pHistory   = &history;
+			src.alpha      = mSettings.alpha;
+			src.hasHistory = mHasHistory;
+
+			forEachRowBand(*mpThreadPool, height, kBandHeight, [&](int y0, int y1)
+			{
+				for (int y = y0; y < y1; y++)
+				{
+					for (int x = 0; x < int(width); x++)
+					{
+						const float4 result = temporalAAPixel(src, x, y);
+						output.at(x, y)     = result;
+						newHistory.at(x, y) = result;
+					}
+				}
+			});
+		}
+
+		mCurrent ^= 1;
+		mHasHistory = true;
+		mLastTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return true;
+	}
+}
@@ -0,0 +1,89 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Temporal anti-aliasing after the filter, the CPU counterpart of TemporalAAPass
+
+#pragma once
+#include "SVGFImage.h"
+#include "CpuThreadPool.h"
+#include "SVGFPlanar.h"
+#include "SVGFSimd.h"
+#include <memory>
+
+namespace CpuSVGF
+{
+	/** Runs SVGFTemporalAA.ps.hlsl over CpuSVGFFilter's output:  each pixel blends this frame into the previous
+	    output, reprojected with SVGF_MotionVecs and clamped to the pixel's 3x3 neighborhood in YCoCg.  This evens
+	    out the flicker the a-trous iterations leave, which can make one of them unnecessary (SVGFCli bench-taa
+	    measures both).  Like TemporalAAPass, it keeps the previous output in a history buffer of its own.
+	*/
+	class TemporalAA
+	{
+	public:
+		using SharedPtr = std::shared_ptr<TemporalAA>;
+
+		/** Same defaults and meaning as the TemporalAAPass member variables of the same name
+		*/
+		struct Settings
+		{
+			float   alpha   = 0.1f;     ///< Weight of the current frame; 1 outputs it unchanged
+			bool    enabled = true;     ///< When false, the color is copied through and the history dropped
+
+			// CPU only:  run the vectorized kernel rather than the per-pixel port of the shader.  The output is identical.
+			bool    simd    = true;
+			SimdIsa simdIsa = detectSimdIsa();
+		};
+
+		/** Create a stage.  A null thread pool creates one using every hardware thread.
+		*/
+		static SharedPtr create(CpuThreadPool::SharedPtr pThreadPool = nullptr);
+
+		/** Resolve one frame into output (resized if needed).  The motion vectors must have the size of the color; a
+		    new size drops the history.  Returns false if they don't.
+		*/
+		bool execute(const ImageF4 &color, const ImageF4 &motionVecs, ImageF4 &output);
+
+		/** Forget the history; the next frame is output unchanged
+		*/
+		void reset() { mHasHistory = false; }
+
+		Settings       &getSettings()       { return mSettings; }
+		const Settings &getSettings() const { return mSettings; }
+		void setSettings(const Settings &settings) { mSettings = settings; }
+
+		/** Wall-clock time (in milliseconds) of the last execute()
+		*/
+		double getLastTimeMs() const { return mLastTimeMs; }
+
+	protected:
+		TemporalAA(CpuThreadPool::SharedPtr pThreadPool);
+
+		Settings                 mSettings;
+		CpuThreadPool::SharedPtr mpThreadPool;
+
+		// The shader's history targets:  mHistory[mCurrent] holds the last output, the next one is written to the other
+		ImageF4                  mHistory[2];
+		uint32_t                 mCurrent    = 0;
+		bool                     mHasHistory = false;
+
+		// The vectorized path's YCoCg copy of the frame, which the neighborhoods are read from
+		PlanarImage              mYCoCg;
+
+		double                   mLastTimeMs = 0.0;
+	};
+}
@@ -0,0 +1,420 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFTexture.h"
+#include "SVGFImageDecode.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+namespace CpuSVGF
+{
+	namespace {
+		// Cache file layout:  a 64 byte header, then every mip from the largest down, each 64 byte aligned
+		const char     kTexMagic[4]    = { 'S', 'V', 'T', 'X' };
+		const uint32_t kTexVersion     = 1;
+		const uint32_t kTexHeaderSize  = 64;
+		const uint64_t kTexAlignment   = 64;
+
+		template <typename T> void putField(uint8_t *pDst, size_t offset, T value) { std::memcpy(pDst + offset, &value, sizeof(T)); }
+		template <typename T> T    getField(const uint8_t *pSrc, size_t offset)    { T value; std::memcpy(&value, pSrc + offset, sizeof(T)); return value; }
+
+		uint64_t alignUp(uint64_t offset) { return (offset + kTexAlignment - 1) & ~(kTexAlignment - 1); }
+
+		uint32_t getFullMipCount(uint32_t width, uint32_t height)
+		{
+			uint32_t count = 1;
+			while ((std::max(width, height) >> count) != 0) count++;
+			return count;
+		}
+
+		uint32_t getMipSize(uint32_t size, uint32_t level) { return std::max(1u, size >> level); }
+
+		/** Offset of each mip in a cache file, and the file's size at the end
+		*/
+		std::vector<uint64_t> getMipOffsets(uint32_t width, uint32_t height, uint32_t mipCount)
+		{
+			std::vector<uint64_t> offsets(mipCount + 1);
+			uint64_t offset = kTexHeaderSize;
+			for (uint32_t level = 0; level < mipCount; level++)
+			{
+				offsets[level] = offset;
+				offset = alignUp(offset + uint64_t(getMipSize(width, level)) * getMipSize(height, level) * sizeof(uint32_t));
+			}
+			offsets[mipCount] = offset;
+			return offsets;
+		}
+
+		uint64_t hashBytes(const uint8_t *pData, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+		{
+			for (size_t i = 0; i < size; i++) hash = (hash ^ pData[i]) * 0x100000001b3ull;
+			return hash;
+		}
+
+		uint64_t getKeyHash(const TextureDesc &desc)
+		{
+			const uint8_t srgb = desc.srgb ? 1 : 0;
+			return hashBytes(&srgb, 1, hashBytes(reinterpret_cast<const uint8_t *>(desc.path.data()), desc.path.size()));
+		}
+
+		/** sRGB decoding of each 8-bit value, and the linear values at which rounding the encoding moves up a step
+		*/
+		struct SrgbTables
+		{
+			float toLinear[256];
+			float thresholds[255];
+
+			SrgbTables()
+			{
+				auto decode = [](double v) { return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4); };
+				for (int i = 0; i < 256; i++) toLinear[i] = float(decode(i / 255.0));
+				for (int i = 0; i < 255; i++) thresholds[i] = float(decode((i + 0.5) / 255.0));
+			}
+
+			uint32_t encode(float linear) const { return uint32_t(std::upper_bound(thresholds, thresholds + 255, linear) - thresholds); }
+		};
+
+		const SrgbTables &getSrgbTables()
+		{
+			static const SrgbTables tables;
+			return tables;
+		}
+
+		double elapsedMs(std::chrono::steady_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+	};
+
+	bool CpuTexture::statSource(const std::string &path, SourceInfo &info)
+	{
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0) return false;
+		info.size = uint64_t(st.st_size);
+		info.modifiedTime = int64_t(st.st_mtime);
+		return true;
+	}
+
+	bool CpuTexture::readSource(const std::string &path, std::vector<uint8_t> &data, SourceInfo &info)
+	{
+		FILE *pFile = std::fopen(path.c_str(), "rb");
+		if (!pFile) return false;
+		bool ok = statSource(path, info);
+		if (ok)
+		{
+			data.resize(size_t(info.size));
+			ok = data.empty() || std::fread(data.data(), 1, data.size(), pFile) == data.size();
+		}
+		std::fclose(pFile);
+		info.hash = hashBytes(data.data(), data.size());
+		return ok;
+	}
+
+	CpuTexture::SharedPtr CpuTexture::decode(const TextureDesc &desc, const std::vector<uint8_t> &data, const SourceInfo &info)
+	{
+		SharedPtr pTexture = SharedPtr(new CpuTexture());
+		pTexture->mDesc = desc;
+		pTexture->mSource = info;
+		pTexture->mMips.resize(1);
+		if (!decodeImage(data.data(), data.size(), pTexture->mMips[0])) return nullptr;
+		return pTexture;
+	}
+
+	CpuTexture::SharedPtr CpuTexture::create(const TextureDesc &desc)
+	{
+		std::vector<uint8_t> data;
+		SourceInfo info;
+		if (!readSource(desc.path, data, info)) return nullptr;
+		SharedPtr pTexture = decode(desc, data, info);
+		if (!pTexture) return nullptr;
+
+		pTexture->allocateMips();
+		for (uint32_t level = 1; level < pTexture->getMipCount(); level++)
+			pTexture->downsampleRows(level, 0, pTexture->mMips[level].getHeight());
+		return pTexture;
+	}
+
+	void CpuTexture::allocateMips()
+	{
+		const uint32_t width = getWidth(), height = getHeight();
+		mMips.resize(getFullMipCount(width, height));
+		for (uint32_t level = 1; level < mMips.size(); level++)
+			mMips[level].resize(getMipSize(width, level), getMipSize(height, level));
+	}
+
+	void CpuTexture::downsampleRows(uint32_t level, uint32_t y0, uint32_t y1)
+	{
+		const SrgbTables &srgb = getSrgbTables();
+		const ImageRGBA8 &src = mMips[level - 1];
+		ImageRGBA8 &dst = mMips[level];
+		const uint32_t srcWidth = src.getWidth(), srcHeight = src.getHeight();
+
+		for (uint32_t y = y0; y < y1; y++)
+		{
+			const uint32_t *pRow0 = &src.at(0, std::min(2 * y, srcHeight - 1));
+			const uint32_t *pRow1 = &src.at(0, std::min(2 * y + 1, srcHeight - 1));
+			uint32_t *pDst = &dst.at(0, y);
+			for (uint32_t x = 0; x < dst.getWidth(); x++)
+			{
+				const uint32_t x0 = std::min(2 * x, srcWidth - 1), x1 = std::min(2 * x + 1, srcWidth - 1);
+				const uint32_t a = pRow0[x0], b = pRow0[x1], c = pRow1[x0], d = pRow1[x1];
+
+				// Even and odd bytes summed in separate 16-bit lanes, with 2 added to each for rounding
+				const uint32_t even = (a & 0x00FF00FFu) + (b & 0x00FF00FFu) + (c & 0x00FF00FFu) + (d & 0x00FF00FFu) + 0x00020002u;
+				const uint32_t odd = ((a >> 8) & 0x00FF00FFu) + ((b >> 8) & 0x00FF00FFu) + ((c >> 8) & 0x00FF00FFu) + ((d >> 8) & 0x00FF00FFu) + 0x00020002u;
+				uint32_t result = ((even >> 2) & 0x00FF00FFu) | (((odd >> 2) & 0x00FF00FFu) << 8);
+				if (mDesc.srgb)
+				{
+					result &= 0xFF000000u;
+					for (uint32_t shift = 0; shift < 24; shift += 8)
+					{
+						const float sum = srgb.toLinear[(a >> shift) & 0xFF] + srgb.toLinear[(b >> shift) & 0xFF] +
+						                  srgb.toLinear[(c >> shift) & 0xFF] + srgb.toLinear[(d >> shift) & 0xFF];
+						result |= srgb.encode(0.25f * sum) << shift;
+					}
+				}
+				pDst[x] = result;
+			}
+		}
+	}
+
+	float4 CpuTexture::sample(const float2 &uv) const
+	{
+		const SrgbTables &srgb = getSrgbTables();
+		const ImageRGBA8 &mip = mMips[0];
+		const int width = int(mip.getWidth()), height = int(mip.getHeight());
+		auto fetch = [&](int x, int y)
+		{
+			const uint32_t texel = mip.at(x, y);
+			const float a = float(texel >> 24) / 255.0f;
+			if (mDesc.srgb) return float4(srgb.toLinear[texel & 0xFF], srgb.toLinear[(texel >> 8) & 0xFF], srgb.toLinear[(texel >> 16) & 0xFF], a);
+			return float4(float(texel & 0xFF) / 255.0f, float((texel >> 8) & 0xFF) / 255.0f, float((texel >> 16) & 0xFF) / 255.0f, a);
+		};
+		auto wrap = [](float i, int size)
+		{
+			const int wrapped = int(i - std::floor(i / float(size)) * float(size));
+			return std::min(wrapped, size - 1);
+		};
+
+		// Texel centers are at half integers
+		const float fx = uv.x * float(width) - 0.5f, fy = uv.y * float(height) - 0.5f;
+		if (!std::isfinite(fx) || !std::isfinite(fy)) return fetch(0, 0);
+		const float x0f = std::floor(fx), y0f = std::floor(fy);
+		const int x0 = wrap(x0f, width), y0 = wrap(y0f, height);
+		const int x1 = x0 + 1 < width ? x0 + 1 : 0, y1 = y0 + 1 < height ? y0 + 1 : 0;
+		const float tx = fx - x0f, ty = fy - y0f;
+		return lerp(lerp(fetch(x0, y0), fetch(x1, y0), tx), lerp(fetch(x0, y1), fetch(x1, y1), tx), ty);
+	}
+
+	std::string CpuTexture::getCachePath(const TextureDesc &desc, const std::string &cacheDir)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.svgftex", (unsigned long long)getKeyHash(desc));
+		return cacheDir.empty() ? std::string(name) : cacheDir + "/" + name;
+	}
+
+	bool CpuTexture::save(const std::string &path) const
+	{
+		const uint32_t width = getWidth(), height = getHeight(), mipCount = getMipCount();
+		const std::vector<uint64_t> offsets = getMipOffsets(width, height, mipCount);
+
+		uint8_t header[kTexHeaderSize] = {};
+		std::memcpy(header, kTexMagic, 4);
+		putField<uint32_t>(header, 4, kTexVersion);
+		putField<uint64_t>(header, 8, getKeyHash(mDesc));
+		putField<uint64_t>(header, 16, mSource.size);
+		putField<int64_t>(header, 24, mSource.modifiedTime);
+		putField<uint64_t>(header, 32, mSource.hash);
+		putField<uint32_t>(header, 40, width);
+		putField<uint32_t>(header, 44, height);
+		putField<uint32_t>(header, 48, mipCount);
+		putField<uint32_t>(header, 52, mDesc.srgb ? 1 : 0);
+		putField<uint64_t>(header, 56, offsets[mipCount]);
+
+		// Write under a temporary name, so a reader never maps a half written file
+		const std::string tempPath = path + ".tmp";
+		FILE *pFile = std::fopen(tempPath.c_str(), "wb");
+		if (!pFile) return false;
+
+		const uint8_t padding[kTexAlignment] = {};
+		auto write = [&](const void *pData, uint64_t size) { return size == 0 || std::fwrite(pData, 1, size_t(size), pFile) == size; };
+		bool ok = write(header, kTexHeaderSize);
+		for (uint32_t level = 0; ok && level < mipCount; level++)
+		{
+			const uint64_t size = mMips[level].getByteSize();
+			ok = write(mMips[level].getData(), size) && write(padding, offsets[level + 1] - offsets[level] - size);
+		}
+		ok = (std::fclose(pFile) == 0) && ok;
+
+		if (ok)
+		{
+			std::remove(path.c_str());
+			ok = std::rename(tempPath.c_str(), path.c_str()) == 0;
+		}
+		if (!ok) std::remove(tempPath.c_str());
+		return ok;
+	}
+
+	CpuTexture::SharedPtr CpuTexture::map(const TextureDesc &desc, const std::string &path, const SourceInfo &source, bool compareHash)
+	{
+		MappedFile::SharedPtr pMapping = MappedFile::open(path);
+		if (!pMapping || pMapping->getSize() < kTexHeaderSize) return nullptr;
+
+		const uint8_t *pData = pMapping->getData();
+		if (std::memcmp(pData, kTexMagic, 4) != 0 || getField<uint32_t>(pData, 4) != kTexVersion) return nullptr;
+		if (getField<uint64_t>(pData, 8) != getKeyHash(desc) || getField<uint32_t>(pData, 52) != (desc.srgb ? 1u : 0u)) return nullptr;
+
+		const bool unchanged = getField<uint64_t>(pData, 16) == source.size && getField<int64_t>(pData, 24) == source.modifiedTime;
+		const bool sameContents = compareHash && getField<uint64_t>(pData, 16) == source.size && getField<uint64_t>(pData, 32) == source.hash;
+		if (!unchanged && !sameContents) return nullptr;
+
+		const uint32_t width = getField<uint32_t>(pData, 40), height = getField<uint32_t>(pData, 44);
+		const uint32_t mipCount = getField<uint32_t>(pData, 48);
+		if (width == 0 || height == 0 || mipCount != getFullMipCount(width, height)) return nullptr;
+		const std::vector<uint64_t> offsets = getMipOffsets(width, height, mipCount);
+		if (getField<uint64_t>(pData, 56) != pMapping->getSize() || offsets[mipCount] != pMapping->getSize()) return nullptr;
+
+		SharedPtr pTexture = SharedPtr(new CpuTexture());
+		pTexture->mDesc = desc;
+		pTexture->mSource.size = getField<uint64_t>(pData, 16);
+		pTexture->mSource.modifiedTime = getField<int64_t>(pData, 24);
+		pTexture->mSource.hash = getField<uint64_t>(pData, 32);
+		pTexture->mMips.resize(mipCount);
+		for (uint32_t level = 0; level < mipCount; level++)
+		{
+			// The mapping is read only; CpuTexture only hands out const mips
+			uint32_t *pTexels = reinterpret_cast<uint32_t *>(const_cast<uint8_t *>(pData + offsets[level]));
+			pTexture->mMips[level].wrap(getMipSize(width, level), getMipSize(height, level), pTexels);
+		}
+		pTexture->mpMapping = pMapping;
+		return pTexture;
+	}
+
+	CpuTexture::SharedPtr CpuTexture::load(const TextureDesc &desc, const std::string &path)
+	{
+		SourceInfo source;
+		if (!statSource(desc.path, source)) return nullptr;
+		SharedPtr pTexture = map(desc, path, source, false);
+		if (pTexture) return pTexture;
+
+		std::vector<uint8_t> data;
+		if (!readSource(desc.path, data, source)) return nullptr;
+		return map(desc, path, source, true);
+	}
+
+	std::vector<CpuTexture::SharedPtr> CpuTexture::loadAllCached(const std::vector<TextureDesc> &descs, const std::string &cacheDir,
+	                                                             CpuThreadPool::SharedPtr pThreadPool, TextureLoadStats *pStats)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const uint32_t count = uint32_t(descs.size());
+		const bool useCache = !cacheDir.empty();
+		std::vector<SharedPtr> textures(count);
+		auto parallelFor = [&](uint32_t taskCount, const std::function<void(uint32_t)> &task)
+		{
+			if (pThreadPool) pThreadPool->parallelFor(taskCount, task);
+			else for (uint32_t i = 0; i < taskCount; i++) task(i);
+		};
+
+		// Largest files first, so one big texture doesn't start last and hold up the rest
+		std::vector<SourceInfo> sources(count);
+		std::vector<uint8_t> found(count);
+		for (uint32_t i = 0; i < count; i++) found[i] = statSource(descs[i].path, sources[i]) ? 1 : 0;
+		std::vector<uint32_t> order(count);
+		for (uint32_t i = 0; i < count; i++) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sources[a].size > sources[b].size; });
+
+		std::vector<uint8_t> decoded(count);
+		parallelFor(count, [&](uint32_t task)
+		{
+			const uint32_t i = order[task];
+			if (!found[i]) return;
+			const std::string cachePath = useCache ? getCachePath(descs[i], cacheDir) : std::string();
+			if (useCache && (textures[i] = map(descs[i], cachePath, sources[i], false))) return;
+
+			std::vector<uint8_t> data;
+			if (!readSource(descs[i].path, data, sources[i])) return;
+			if (useCache && (textures[i] = map(descs[i], cachePath, sources[i], true))) return;
+			textures[i] = decode(descs[i], data, sources[i]);
+			decoded[i] = textures[i] ? 1 : 0;
+		});
+		const auto mipStart = std::chrono::steady_clock::now();
+		const double readMs = elapsedMs(start);
+
+		// Mips level by level across every decoded texture, in bands of rows of about the same number of texels
+		const uint32_t kTexelsPerTask = 1 << 16;
+		uint32_t maxMipCount = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (!decoded[i]) continue;
+			textures[i]->allocateMips();
+			maxMipCount = std::max(maxMipCount, textures[i]->getMipCount());
+		}
+		struct MipTask { uint32_t texture, y0, y1; };
+		std::vector<MipTask> tasks;
+		for (uint32_t level = 1; level < maxMipCount; level++)
+		{
+			tasks.clear();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!decoded[i] || level >= textures[i]->getMipCount()) continue;
+				const ImageRGBA8 &mip = textures[i]->mMips[level];
+				const uint32_t rows = std::max(1u, kTexelsPerTask / mip.getWidth());
+				for (uint32_t y = 0; y < mip.getHeight(); y += rows)
+					tasks.push_back({ i, y, std::min(y + rows, mip.getHeight()) });
+			}
+			parallelFor(uint32_t(tasks.size()), [&](uint32_t t) { textures[tasks[t].texture]->downsampleRows(level, tasks[t].y0, tasks[t].y1); });
+		}
+		const auto saveStart = std::chrono::steady_clock::now();
+		const double mipMs = elapsedMs(mipStart);
+
+		if (useCache)
+		{
+			parallelFor(count, [&](uint32_t i)
+			{
+				if (decoded[i]) textures[i]->save(getCachePath(descs[i], cacheDir));
+			});
+		}
+		const double saveMs = elapsedMs(saveStart);
+
+		if (pStats)
+		{
+			*pStats = TextureLoadStats();
+			pStats->textureCount = count;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!textures[i]) { pStats->failedCount++; continue; }
+				if (decoded[i])
+				{
+					pStats->decodedCount++;
+					pStats->sourceBytes += sources[i].size;
+				}
+				else pStats->mappedCount++;
+				for (uint32_t level = 0; level < textures[i]->getMipCount(); level++) pStats->texelBytes += textures[i]->getMip(level).getByteSize();
+			}
+			pStats->readMs = readMs;
+			pStats->mipMs = mipMs;
+			pStats->saveMs = saveMs;
+			pStats->totalMs = elapsedMs(start);
+		}
+		return textures;
+	}
+}
@@ -0,0 +1,133 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Scene textures on the CPU:  decoded PNG / JPEG files with their mip chains, loaded in parallel and cached in files
+//     that later runs map instead of decoding
+
+#pragma once
+#include "CpuThreadPool.h"
+#include "SVGFImage.h"
+#include "SVGFMappedFile.h"
+#include <string>
+#include <vector>
+
+namespace CpuSVGF
+{
+	struct TextureDesc
+	{
+		std::string path;
+		bool        srgb = false;   ///< Mips average the linear values of sRGB textures, as Falcor's generateMips() does
+	};
+
+	/** What CpuTexture::loadAllCached() did, and how long each of its stages took on the wall clock
+	*/
+	struct TextureLoadStats
+	{
+		uint32_t textureCount = 0;
+		uint32_t mappedCount = 0;      ///< Mapped from the cache
+		uint32_t decodedCount = 0;     ///< Decoded from their files, and then cached
+		uint32_t failedCount = 0;
+		uint64_t sourceBytes = 0;      ///< Size of the files that were decoded
+		uint64_t texelBytes = 0;       ///< Size of every mip of every texture
+		double   readMs = 0.0;         ///< Checking the cache and mapping it, or reading and decoding the files
+		double   mipMs = 0.0;
+		double   saveMs = 0.0;
+		double   totalMs = 0.0;
+	};
+
+	/** A texture in RGBA8 with its full mip chain, down to 1x1.  Each mip halves the size of the one before,
+	    rounding down, and averages 2x2 blocks of its texels; the last row or column of an odd size is dropped.
+	*/
+	class CpuTexture
+	{
+	public:
+		using SharedPtr = std::shared_ptr<CpuTexture>;
+
+		/** Decode a PNG or JPEG file and build its mips.  Returns nullptr if the file can't be read or decoded.
+		*/
+		static SharedPtr create(const TextureDesc &desc);
+
+		/** Map a texture written by save() and use it in place.  Returns nullptr if the file is missing or truncated,
+		    from another version of the loader, or was saved for another source file than desc's or an older version
+		    of it.  The source is up to date if its size and modification time are those it had when it was decoded;
+		    failing that, its contents are hashed and compared.
+		*/
+		static SharedPtr load(const TextureDesc &desc, const std::string &path);
+
+		/** Load every texture, mapping those that are in cacheDir and decoding the others, and save the decoded ones
+		    to cacheDir; failing to save only loses the cache.  An empty cacheDir skips the cache.  Files are read and
+		    decoded on pThreadPool (if given), largest first, then the mips of all textures are built together level
+		    by level, so a single large texture also uses every thread.  The result has an entry per desc, nullptr
+		    for those that failed to load.
+		*/
+		static std::vector<SharedPtr> loadAllCached(const std::vector<TextureDesc> &descs, const std::string &cacheDir,
+		                                            CpuThreadPool::SharedPtr pThreadPool = nullptr, TextureLoadStats *pStats = nullptr);
+
+		/** <cacheDir>/<hash of the path and color space>.svgftex
+		*/
+		static std::string getCachePath(const TextureDesc &desc, const std::string &cacheDir);
+
+		/** Write the mips in the layout load() maps, along with the size, modification time and hash the source
+		    file had when it was decoded.  Returns false on a write error.
+		*/
+		bool save(const std::string &path) const;
+
+		uint32_t getWidth() const    { return mMips[0].getWidth(); }
+		uint32_t getHeight() const   { return mMips[0].getHeight(); }
+		uint32_t getMipCount() const { return uint32_t(mMips.size()); }
+		const ImageRGBA8 &getMip(uint32_t level) const { return mMips[level]; }
+		const TextureDesc &getDesc() const { return mDesc; }
+
+		/** Bilinear lookup in the largest mip with wrap addressing, like Falcor's default sampler at level 0 (ray traced
+		    hits have no derivatives to pick a mip from).  sRGB textures are converted to linear before filtering.
+		*/
+		float4 sample(const float2 &uv) const;
+
+		/** True if the mips live in a mapping of a cache file
+		*/
+		bool isMapped() const { return mpMapping != nullptr; }
+
+	private:
+		CpuTexture() = default;
+
+		/** What identifies a version of a source file
+		*/
+		struct SourceInfo
+		{
+			uint64_t size = 0;
+			int64_t  modifiedTime = 0;   ///< Seconds since the epoch
+			uint64_t hash = 0;           ///< FNV-1a hash of the contents, when they have been read
+		};
+
+		static bool statSource(const std::string &path, SourceInfo &info);
+		static bool readSource(const std::string &path, std::vector<uint8_t> &data, SourceInfo &info);
+		static SharedPtr decode(const TextureDesc &desc, const std::vector<uint8_t> &data, const SourceInfo &info);
+
+		/** load() with the source's size and modification time known; its contents are compared only if compareHash
+		*/
+		static SharedPtr map(const TextureDesc &desc, const std::string &path, const SourceInfo &source, bool compareHash);
+
+		void allocateMips();
+		void downsampleRows(uint32_t level, uint32_t y0, uint32_t y1);
+
+		TextureDesc             mDesc;
+		std::vector<ImageRGBA8> mMips;
+		SourceInfo              mSource;
+		MappedFile::SharedPtr   mpMapping;
+	};
+}
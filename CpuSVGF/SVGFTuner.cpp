@@ -0,0 +1,497 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "SVGFTuner.h"
+#include "SVGFKernels.h"
+#include "SVGFStorageFormat.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace CpuSVGF
+{
+	namespace {
+		using Clock = std::chrono::steady_clock;
+
+		double elapsedMs(Clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+
+		const uint32_t kNoCandidate = ~0u;
+
+		// CpuSVGFFilter's default tile size and a-trous band height, so the stages are timed like they run there
+		const uint32_t kTileSize   = 32;
+		const uint32_t kBandHeight = 8;
+
+		template <typename T>
+		std::vector<T> sortedUnique(std::vector<T> values)
+		{
+			std::sort(values.begin(), values.end());
+			values.erase(std::unique(values.begin(), values.end()), values.end());
+			return values;
+		}
+
+		double getObjective(TuningObjective objective, const FrameMetrics &metrics)
+		{
+			switch (objective)
+			{
+			case TuningObjective::RelMse:  return metrics.relMse;
+			case TuningObjective::Rmse:    return metrics.rmse;
+			case TuningObjective::Ssim:    return 1.0 - metrics.ssim;
+			case TuningObjective::Flicker: return metrics.flicker;
+			default:                       return metrics.flip;
+			}
+		}
+	};
+
+	const char *getTuningObjectiveName(TuningObjective objective)
+	{
+		static const char *kNames[] = { "flip", "relmse", "rmse", "ssim", "flicker" };
+		return uint32_t(objective) < uint32_t(TuningObjective::Count) ? kNames[uint32_t(objective)] : "unknown";
+	}
+
+	FilterPreset getPreset(const CpuSVGFFilter::Settings &settings)
+	{
+		FilterPreset preset;
+		preset.filterIterations = settings.filterIterations;
+		preset.feedbackTap      = settings.feedbackTap;
+		preset.phiColor         = settings.phiColor;
+		preset.phiNormal        = settings.phiNormal;
+		preset.alpha            = settings.alpha;
+		preset.momentsAlpha     = settings.momentsAlpha;
+		return preset;
+	}
+
+	void applyPreset(const FilterPreset &preset, CpuSVGFFilter::Settings &settings)
+	{
+		settings.filterIterations = preset.filterIterations;
+		settings.feedbackTap      = preset.feedbackTap;
+		settings.phiColor         = preset.phiColor;
+		settings.phiNormal        = preset.phiNormal;
+		settings.alpha            = preset.alpha;
+		settings.momentsAlpha     = preset.momentsAlpha;
+	}
+
+	ParameterTuner::SharedPtr ParameterTuner::create(const Settings &settings, CpuThreadPool::SharedPtr pThreadPool)
+	{
+		return SharedPtr(new ParameterTuner(settings, pThreadPool ? pThreadPool : CpuThreadPool::create()));
+	}
+
+	ParameterTuner::ParameterTuner(const Settings &settings, CpuThreadPool::SharedPtr pThreadPool)
+		: mSettings(settings), mpThreadPool(pThreadPool)
+	{
+		mpEvaluator = MetricsEvaluator::create(settings.metrics, pThreadPool);
+
+		CpuSVGFFilter::Settings base = settings.base;
+		base.filterEnabled       = true;
+		base.simdAtrous          = true;
+		base.adaptiveAtrous      = false;
+		base.indirectScale       = 1;
+		base.geometryWeightCache = false;
+
+		// Every negative tap means no feedback
+		std::vector<int32_t> taps = settings.space.feedbackTaps;
+		for (int32_t &tap : taps) tap = std::max(tap, -1);
+
+		const TuningSpace &space = settings.space;
+		const std::vector<int32_t> iterationCounts = sortedUnique(space.filterIterations);
+		const std::vector<float>   phiColors       = sortedUnique(space.phiColors);
+		const std::vector<float>   phiNormals      = sortedUnique(space.phiNormals);
+
+		// A chain of every valid iteration count with the given phi color, adding the candidates of every phi normal to it
+		auto addChain = [&](History &history, float phiColor)
+		{
+			AtrousChain chain;
+			chain.phiColor  = phiColor;
+			chain.phiNormal = phiNormals.empty() ? base.phiNormal : phiNormals[0];
+			for (int32_t count : iterationCounts)
+			{
+				if (count < 1 || history.feedbackTap > count - 2) continue;
+
+				chain.candidatesByCount.resize(count + 1);
+				for (float phiNormal : phiNormals)
+				{
+					Candidate candidate;
+					candidate.settings                  = base;
+					candidate.settings.filterIterations = count;
+					candidate.settings.feedbackTap      = history.feedbackTap;
+					candidate.settings.phiColor         = phiColor;
+					candidate.settings.phiNormal        = phiNormal;
+					candidate.settings.alpha            = history.alpha;
+					candidate.settings.momentsAlpha     = history.momentsAlpha;
+					candidate.sums.ssim                 = 0.0;
+
+					chain.candidatesByCount[count].push_back(uint32_t(mCandidates.size()));
+					chain.iterations = count;
+					mCandidates.push_back(std::move(candidate));
+				}
+			}
+			if (chain.iterations > 0) history.chains.push_back(chain);
+		};
+
+		for (float alpha : sortedUnique(space.alphas))
+		{
+			for (float momentsAlpha : sortedUnique(space.momentsAlphas))
+			{
+				for (int32_t tap : sortedUnique(taps))
+				{
+					History history;
+					history.alpha        = alpha;
+					history.momentsAlpha = momentsAlpha;
+					history.feedbackTap  = tap;
+
+					// Without feedback phi color only acts after reprojection; with it, it shapes the history too
+					for (float phiColor : phiColors)
+					{
+						addChain(history, phiColor);
+						if (tap >= 0 && !history.chains.empty())
+						{
+							mHistories.push_back(history);
+							history.chains.clear();
+						}
+					}
+					if (!history.chains.empty()) mHistories.push_back(history);
+				}
+			}
+		}
+	}
+
+	void ParameterTuner::recordTime(StageTime &time, std::chrono::steady_clock::time_point start)
+	{
+		if (mFrameCount >= mSettings.warmupFrames) time.add(elapsedMs(start));
+	}
+
+	void ParameterTuner::reproject(History &history)
+	{
+		Clock::time_point start = Clock::now();
+
+		ReprojectSources src;
+		src.pLinearZ       = mInputTex.linearZ;
+		src.pPrevLinearZ   = &mPrevLinearZ;
+		src.pMotion        = mInputTex.motionVecs;
+		src.pPrevMoments   = &history.moments;
+		src.pHistoryLength = &history.historyLength;
+		src.pPrevDirect    = &history.filteredPastDirect;
+		src.pPrevIndirect  = &history.filteredPastIndirect;
+		src.pDirect        = mInputTex.directIllum;
+		src.pIndirect      = mInputTex.indirectIllum;
+		src.alpha          = history.alpha;
+		src.momentsAlpha   = history.momentsAlpha;
+		src.channels       = kBothChannels;
+
+		const StorageFormat format = mSettings.base.storageFormat;
+		mpThreadPool->forEachTile(mWidth, mHeight, kTileSize, [&](const TileRect &tile)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					ReprojectOutput out = reprojectPixel(src, x, y);
+					mCurReproj.direct.at(x, y)        = quantizeIllum(format, out.direct);
+					mCurReproj.indirect.at(x, y)      = quantizeIllum(format, out.indirect);
+					mCurReproj.moments.at(x, y)       = quantizeMoments(format, out.moments);
+					mCurReproj.historyLength.at(x, y) = out.historyLength;
+				}
+			}
+		});
+
+		recordTime(mReprojectionTime, start);
+		mStageCounts.reprojection++;
+	}
+
+	void ParameterTuner::filterMoments(float phiColor, float phiNormal)
+	{
+		Clock::time_point start = Clock::now();
+
+		FilterMomentsSources src;
+		src.pDirect           = &mCurReproj.direct;
+		src.pIndirect         = &mCurReproj.indirect;
+		src.pMoments          = &mCurReproj.moments;
+		src.pHistoryLength    = &mCurReproj.historyLength;
+		src.pCompactNormDepth = mInputTex.miscBuf;
+		src.phiColor          = phiColor;
+		src.phiNormal         = phiNormal;
+
+		const StorageFormat format = mSettings.base.storageFormat;
+		mpThreadPool->forEachTile(mWidth, mHeight, kTileSize, [&](const TileRect &tile)
+		{
+			for (int y = tile.y0; y < tile.y1; y++)
+			{
+				for (int x = tile.x0; x < tile.x1; x++)
+				{
+					float4 outDirect, outIndirect;
+					filterMomentsPixel(src, x, y, outDirect, outIndirect);
+					mMomentsDirect.at(x, y)   = quantizeIllum(format, outDirect);
+					mMomentsIndirect.at(x, y) = quantizeIllum(format, outIndirect);
+				}
+			}
+		});
+
+		recordTime(mMomentsTime, start);
+		mStageCounts.moments++;
+	}
+
+	void ParameterTuner::filterChain(History &history, const AtrousChain &chain, bool evaluate)
+	{
+		const CpuSVGFFilter::Settings &base = mSettings.base;
+		CpuThreadPool &pool = *mpThreadPool;
+
+		filterMoments(chain.phiColor, chain.phiNormal);
+
+		// The kernel leaves the planes of channels it doesn't filter alone; give both buffers the pass-through values
+		Clock::time_point start = Clock::now();
+		illumToPlanar(pool, mMomentsDirect, mMomentsIndirect, mPlanarIllum[0]);
+		if (mPlanarIllum[1].getWidth() != mWidth || mPlanarIllum[1].getHeight() != mHeight)
+			mPlanarIllum[1].resize(mWidth, mHeight, kIllumPlaneCount);
+
+		const uint32_t passThrough = kBothChannels & ~base.atrousChannels;
+		if (passThrough)
+		{
+			const size_t planeSize = size_t(mPlanarIllum[0].getStride()) * mHeight * sizeof(float);
+			for (uint32_t p = 0; p < kIllumPlaneCount; p++)
+			{
+				const bool direct = p <= kDirectVar || p == kDirectLum;
+				if (passThrough & (direct ? kDirectChannel : kIndirectChannel))
+					std::memcpy(mPlanarIllum[1].getPlane(p), mPlanarIllum[0].getPlane(p), planeSize);
+			}
+		}
+		recordTime(mToPlanarTime, start);
+
+		AtrousSimdFunc kernel = getAtrousSimdKernel(base.simdIsa);
+
+		AtrousSimdArgs args;
+		args.pGeometry    = &mPlanarGeometry;
+		args.phiColor     = chain.phiColor;
+		args.phiNormal    = chain.phiNormal;
+		args.channels     = base.atrousChannels;
+		args.radius       = base.atrousRadius;
+		args.pAlbedo      = mInputTex.dirAlbedo;
+		args.pIndirAlbedo = mInputTex.indirAlbedo;
+
+		if (int32_t(mAtrousTime.size()) < chain.iterations)
+		{
+			mAtrousTime.resize(chain.iterations);
+			mModulatingAtrousTime.resize(chain.iterations);
+		}
+
+		for (int i = 0; i < chain.iterations; i++)
+		{
+			// Like the last iteration of the candidates that end here, if there are any
+			const std::vector<uint32_t> *pEnding = i + 1 < int(chain.candidatesByCount.size()) ? &chain.candidatesByCount[i + 1] : nullptr;
+			const uint32_t candidate = pEnding && !pEnding->empty() ? pEnding->front() : kNoCandidate;
+
+			args.pIn        = &mPlanarIllum[0];
+			args.pOut       = &mPlanarIllum[1];
+			args.stepSize   = 1 << i;
+			args.pModulated = candidate != kNoCandidate ? &mOutput : nullptr;
+
+			start = Clock::now();
+			forEachRowBand(pool, mHeight, kBandHeight, [&](int y0, int y1)
+			{
+				AtrousSimdArgs band = args;
+				band.y0 = y0;
+				band.y1 = y1;
+				kernel(band);
+			});
+
+			// Iterations that others follow round-trip through the ping-pong storage format; feedback taps are always
+			//    before the candidate's last iteration, so the fed back color is rounded too
+			if (i < chain.iterations - 1)
+				quantizeIllum(pool, base.storageFormat, mPlanarIllum[1]);
+			recordTime((candidate != kNoCandidate ? mModulatingAtrousTime : mAtrousTime)[i], start);
+			mStageCounts.atrous++;
+
+			if (i == history.feedbackTap)
+			{
+				start = Clock::now();
+				planarToIllum(pool, mPlanarIllum[1], history.filteredPastDirect, history.filteredPastIndirect);
+				recordTime(mFeedbackTime, start);
+			}
+
+			// The last warm-up frame is only evaluated for the flicker of the first measured one.  The candidates
+			//    ending here only differ in phi normal, so they have the same output, measured once.
+			if (candidate != kNoCandidate && evaluate)
+			{
+				FrameMetrics metrics;
+				mpEvaluator->evaluate(mOutput, mReference, mCandidates[candidate].sequence, metrics);
+				for (uint32_t index = 0; mFrameCount >= mSettings.warmupFrames && index < pEnding->size(); index++)
+				{
+					Candidate &c = mCandidates[(*pEnding)[index]];
+					c.sums.rmse   += metrics.rmse;
+					c.sums.relMse += metrics.relMse;
+					c.sums.ssim   += metrics.ssim;
+					c.sums.flip   += metrics.flip;
+					c.frames++;
+					if (mFrameCount > 0)
+					{
+						c.sums.flicker += metrics.flicker;
+						c.flickerFrames++;
+					}
+				}
+			}
+
+			std::swap(mPlanarIllum[0], mPlanarIllum[1]);
+		}
+	}
+
+	bool ParameterTuner::addFrame(const FrameInputs &inputs, const ImageF4 &reference)
+	{
+		if (!inputs.isValid()) return false;
+
+		// Size ourselves to the first frame; history starts out cleared like CpuSVGFFilter's
+		if (mWidth == 0 || mHeight == 0)
+		{
+			mWidth  = inputs.directIllum->getWidth();
+			mHeight = inputs.directIllum->getHeight();
+			for (History &history : mHistories)
+			{
+				for (ImageF4 *pImage : { &history.filteredPastDirect, &history.filteredPastIndirect, &history.moments })
+				{
+					pImage->resize(mWidth, mHeight);
+					pImage->fill(float4(0.0f));
+				}
+				history.historyLength.resize(mWidth, mHeight);
+				history.historyLength.fill(0.0f);
+			}
+			for (ImageF4 *pImage : { &mCurReproj.direct, &mCurReproj.indirect, &mCurReproj.moments, &mMomentsDirect, &mMomentsIndirect, &mOutput })
+				pImage->resize(mWidth, mHeight);
+			mCurReproj.historyLength.resize(mWidth, mHeight);
+			mPrevLinearZ.resize(mWidth, mHeight);
+			mPrevLinearZ.fill(float4(0.f, 0.f, 0.f, 1.f));
+		}
+
+		for (const ImageF4 *pImage : { inputs.directIllum, inputs.indirectIllum, inputs.linearZ, inputs.motionVecs,
+		                               inputs.miscBuf, inputs.dirAlbedo, inputs.indirAlbedo, &reference })
+		{
+			if (pImage->getWidth() != mWidth || pImage->getHeight() != mHeight) return false;
+		}
+
+		mInputTex = inputs;
+		mStageCounts = TuningStageCounts();
+
+		const bool evaluate = mFrameCount + 1 >= mSettings.warmupFrames;
+		if (evaluate) mpEvaluator->prepareReference(reference, mReference);
+
+		Clock::time_point start = Clock::now();
+		geometryToPlanar(*mpThreadPool, *inputs.miscBuf, mPlanarGeometry);
+		recordTime(mGeometryTime, start);
+
+		for (History &history : mHistories)
+		{
+			reproject(history);
+			for (const AtrousChain &chain : history.chains)
+				filterChain(history, chain, evaluate);
+
+			// Without a feedback tap, next frame reprojects this frame's reprojected color
+			if (history.feedbackTap < 0)
+			{
+				start = Clock::now();
+				history.filteredPastDirect   = mCurReproj.direct;
+				history.filteredPastIndirect = mCurReproj.indirect;
+				recordTime(mPastCopyTime, start);
+			}
+			std::swap(history.moments, mCurReproj.moments);
+			std::swap(history.historyLength, mCurReproj.historyLength);
+		}
+
+		start = Clock::now();
+		mPrevLinearZ = *inputs.linearZ;
+		recordTime(mLinearZCopyTime, start);
+
+		for (const Candidate &candidate : mCandidates)
+		{
+			mStageCounts.reprojectionNaive++;
+			mStageCounts.momentsNaive++;
+			mStageCounts.atrousNaive += uint32_t(candidate.settings.filterIterations);
+		}
+
+		mFrameCount++;
+		return true;
+	}
+
+	double ParameterTuner::getCostMs(const CpuSVGFFilter::Settings &settings) const
+	{
+		double cost = mReprojectionTime.getMean() + mMomentsTime.getMean() + mGeometryTime.getMean() + mToPlanarTime.getMean();
+
+		// An iteration that always ran modulating (because some candidate always ended on it) stands in for itself
+		//    not modulating
+		const int32_t iterations = settings.filterIterations;
+		for (int32_t i = 0; i < iterations && i < int32_t(mAtrousTime.size()); i++)
+		{
+			const bool last = i == iterations - 1;
+			const StageTime &time = (last || mAtrousTime[i].count == 0) ? mModulatingAtrousTime[i] : mAtrousTime[i];
+			cost += time.getMean();
+		}
+
+		if (settings.feedbackTap >= 0)    cost += mFeedbackTime.getMean();
+		else if (!settings.blitFree)      cost += mPastCopyTime.getMean();
+		if (!settings.blitFree)           cost += mLinearZCopyTime.getMean();
+		return cost;
+	}
+
+	std::vector<TuningResult> ParameterTuner::getResults() const
+	{
+		std::vector<TuningResult> results;
+		results.reserve(mCandidates.size());
+		for (const Candidate &candidate : mCandidates)
+		{
+			TuningResult result;
+			result.settings = candidate.settings;
+			if (candidate.frames > 0)
+			{
+				const double frames = double(candidate.frames);
+				result.metrics.rmse    = candidate.sums.rmse / frames;
+				result.metrics.relMse  = candidate.sums.relMse / frames;
+				result.metrics.ssim    = candidate.sums.ssim / frames;
+				result.metrics.flip    = candidate.sums.flip / frames;
+				result.metrics.flicker = candidate.flickerFrames ? candidate.sums.flicker / candidate.flickerFrames : 0.0;
+			}
+			result.error  = getObjective(mSettings.objective, result.metrics);
+			result.costMs = getCostMs(candidate.settings);
+			results.push_back(result);
+		}
+
+		std::stable_sort(results.begin(), results.end(), [](const TuningResult &a, const TuningResult &b)
+		{
+			return a.costMs != b.costMs ? a.costMs < b.costMs : a.error < b.error;
+		});
+
+		// Cheapest first, so a result is on the front if it beats everything before it
+		double bestError = std::numeric_limits<double>::infinity();
+		for (TuningResult &result : results)
+		{
+			result.paretoOptimal = result.error < bestError;
+			bestError = std::min(bestError, result.error);
+		}
+		return results;
+	}
+
+	const TuningResult *ParameterTuner::pickResult(const std::vector<TuningResult> &results, double budgetMs)
+	{
+		const TuningResult *pBest = nullptr;
+		for (const TuningResult &result : results)
+		{
+			if (!result.paretoOptimal || (budgetMs > 0.0 && result.costMs > budgetMs)) continue;
+			if (!pBest || result.error < pBest->error) pBest = &result;
+		}
+		return pBest;
+	}
+}
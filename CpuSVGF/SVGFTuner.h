@@ -0,0 +1,235 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Searches the SVGFPass settings for the best quality at each cost on a sequence of frames with references
+
+#pragma once
+#include "CpuSVGFFilter.h"
+#include "SVGFMetrics.h"
+#include "SVGFPreset.h"
+#include <chrono>
+
+namespace CpuSVGF
+{
+	/** The values ParameterTuner tries for each setting.  Every combination is a candidate, except feedback taps past
+	    the second-to-last iteration, which the SVGFPass GUI doesn't allow either.  Phi normal has no effect while
+	    normalDistanceCos() keeps the normal weight disabled, as SVGFEdgeStoppingFunctions.h does, so one value is tried.
+	*/
+	struct TuningSpace
+	{
+		std::vector<int32_t> filterIterations = { 2, 3, 4, 5 };
+		std::vector<int32_t> feedbackTaps     = { -1, 0, 1 };
+		std::vector<float>   phiColors        = { 2.5f, 5.0f, 10.0f, 20.0f };
+		std::vector<float>   phiNormals       = { 128.0f };
+		std::vector<float>   alphas           = { 0.05f, 0.1f, 0.2f };
+		std::vector<float>   momentsAlphas    = { 0.2f };
+	};
+
+	/** The FrameMetrics a candidate's error is measured with
+	*/
+	enum class TuningObjective : uint32_t
+	{
+		Flip,      ///< FrameMetrics::flip
+		RelMse,    ///< FrameMetrics::relMse
+		Rmse,      ///< FrameMetrics::rmse
+		Ssim,      ///< 1 - FrameMetrics::ssim
+		Flicker,   ///< FrameMetrics::flicker
+		Count
+	};
+
+	/** "flip", "relmse", "rmse", "ssim" or "flicker"
+	*/
+	const char *getTuningObjectiveName(TuningObjective objective);
+
+	/** How well one candidate did
+	*/
+	struct TuningResult
+	{
+		CpuSVGFFilter::Settings settings;
+		FrameMetrics            metrics;                 ///< Means over the measured frames (flicker over those after the first)
+		double                  error         = 0.0;     ///< The objective's value of metrics
+		double                  costMs        = 0.0;     ///< Filter time per frame, from the times of the stages it runs
+		bool                    paretoOptimal = false;   ///< No other candidate is both cheaper (or as cheap) and better
+	};
+
+	/** Stage runs of the last addFrame(), and how many filtering every candidate on its own would take
+	*/
+	struct TuningStageCounts
+	{
+		uint32_t reprojection = 0, reprojectionNaive = 0;
+		uint32_t moments      = 0, momentsNaive      = 0;
+		uint32_t atrous       = 0, atrousNaive       = 0;
+	};
+
+	/** Filters a sequence with every combination of the settings in a TuningSpace and measures the error and cost of
+	    each, to find the best settings for a scene and a frame time budget.
+
+	    Candidates share work wherever a setting doesn't affect a stage.  Reprojection only depends on alpha, moments
+	    alpha and, through the filtered past, on the settings of the iterations up to the feedback tap:  candidates
+	    that agree on those share their history and reproject once (without feedback, phi color doesn't matter
+	    either).  Candidates that also agree on phi color share the moment filter and the a-trous iterations, which
+	    run once for the largest iteration count; each iteration count takes its output from the iteration it ends on,
+	    which modulates like the last iteration of CpuSVGFFilter.  Phi normal is ignored by every stage (see
+	    normalDistanceCos()), so candidates that differ only in it are filtered and measured once.  The output of every
+	    candidate is identical to CpuSVGFFilter's with its settings.
+
+	    A candidate's cost is the sum of the average times of the stages CpuSVGFFilter runs for it, as timed here:  it
+	    only depends on the iteration count and whether there is a feedback tap.
+	*/
+	class ParameterTuner
+	{
+	public:
+		using SharedPtr = std::shared_ptr<ParameterTuner>;
+
+		struct Settings
+		{
+			/** Everything that isn't searched over.  The tuner always runs the vectorized a-trous at full resolution
+			    without adaptive iterations or the geometry weight cache, and turns those options off in the results.
+			    Fused reprojection and blit-free don't change the output and are kept.
+			*/
+			CpuSVGFFilter::Settings    base;
+			TuningSpace                space;
+			TuningObjective            objective    = TuningObjective::Flip;
+			MetricsEvaluator::Settings metrics;
+			uint32_t                   warmupFrames = 4;   ///< Frames filtered but not measured, while history builds up
+		};
+
+		/** Runs on pThreadPool, or on a pool of its own if it's nullptr
+		*/
+		static SharedPtr create(const Settings &settings, CpuThreadPool::SharedPtr pThreadPool = nullptr);
+
+		const Settings &getSettings() const { return mSettings; }
+		uint32_t getCandidateCount() const  { return uint32_t(mCandidates.size()); }
+
+		/** Filter the next frame of the sequence with every candidate and measure it against reference.  Returns false
+		    if the inputs are incomplete, or reference or the inputs don't have the size of the first frame.
+		*/
+		bool addFrame(const FrameInputs &inputs, const ImageF4 &reference);
+
+		uint32_t getFrameCount() const { return mFrameCount; }
+		const TuningStageCounts &getLastStageCounts() const { return mStageCounts; }
+
+		/** Every candidate, cheapest first and equally expensive ones best first, with the Pareto front marked
+		*/
+		std::vector<TuningResult> getResults() const;
+
+		/** The Pareto optimal result with the least error that costs at most budgetMs (any cost if it's 0 or less),
+		    or nullptr if there is none
+		*/
+		static const TuningResult *pickResult(const std::vector<TuningResult> &results, double budgetMs = 0.0);
+
+	private:
+		ParameterTuner(const Settings &settings, CpuThreadPool::SharedPtr pThreadPool);
+
+		/** One phi color and the iteration counts that filter with it.  Candidates with the same history and phi
+		    color share the a-trous iterations.
+		*/
+		struct AtrousChain
+		{
+			float                              phiColor, phiNormal;   ///< phiNormal is the first candidate's; it has no effect
+			int32_t                            iterations = 0;        ///< The largest iteration count of the candidates
+			std::vector<std::vector<uint32_t>> candidatesByCount;     ///< Indexed by iteration count; one per phi normal
+		};
+
+		/** Temporal state shared by candidates with the same alpha, moments alpha and feedback tap (and the same phi
+		    color when there is a feedback tap)
+		*/
+		struct History
+		{
+			float                    alpha, momentsAlpha;
+			int32_t                  feedbackTap;
+			std::vector<AtrousChain> chains;
+
+			ImageF4                  filteredPastDirect, filteredPastIndirect;   // Reprojected color without feedback
+			ImageF4                  moments;
+			ImageF                   historyLength;
+		};
+
+		/** Per candidate sums over the measured frames
+		*/
+		struct Candidate
+		{
+			CpuSVGFFilter::Settings settings;
+			MetricsSequence         sequence;
+			FrameMetrics            sums;
+			uint32_t                frames = 0, flickerFrames = 0;
+		};
+
+		/** Running average of one stage's time
+		*/
+		struct StageTime
+		{
+			double   sumMs = 0.0;
+			uint32_t count = 0;
+
+			void   add(double ms)   { sumMs += ms; count++; }
+			double getMean() const  { return count ? sumMs / count : 0.0; }
+		};
+
+		// Each stage of CpuSVGFFilter for one history, as it does it
+		void reproject(History &history);
+		void filterMoments(float phiColor, float phiNormal);
+		void filterChain(History &history, const AtrousChain &chain, bool evaluate);
+
+		// Add the time since start to a stage's average, unless history is still warming up (which makes the moment
+		//    filter much slower)
+		void recordTime(StageTime &time, std::chrono::steady_clock::time_point start);
+
+		// Estimated filter time of a candidate
+		double getCostMs(const CpuSVGFFilter::Settings &settings) const;
+
+		Settings                       mSettings;
+		CpuThreadPool::SharedPtr       mpThreadPool;
+		MetricsEvaluator::SharedPtr    mpEvaluator;
+		std::vector<Candidate>         mCandidates;
+		std::vector<History>           mHistories;
+		uint32_t                       mWidth = 0, mHeight = 0;
+		uint32_t                       mFrameCount = 0;
+		TuningStageCounts              mStageCounts;
+
+		// This frame's inputs and reference, and last frame's linear z
+		FrameInputs                    mInputTex;
+		MetricsReference               mReference;
+		ImageF4                        mPrevLinearZ;
+
+		// Scratch buffers, shared by every history:  the reprojection output (swapped into the history when it's
+		//    done), the moment filter output, the planar a-trous buffers and the modulated output
+		struct
+		{
+			ImageF4                    direct, indirect, moments;
+			ImageF                     historyLength;
+		}                              mCurReproj;
+		ImageF4                        mMomentsDirect, mMomentsIndirect;
+		PlanarImage                    mPlanarIllum[2];
+		PlanarImage                    mPlanarGeometry;
+		ImageF4                        mOutput;
+
+		// Stage times, for the cost estimates
+		StageTime                      mReprojectionTime, mMomentsTime, mToPlanarTime, mGeometryTime;
+		StageTime                      mFeedbackTime, mPastCopyTime, mLinearZCopyTime;   // Planar to filtered past, reprojected color to it
+		std::vector<StageTime>         mAtrousTime, mModulatingAtrousTime;   // Indexed by iteration
+	};
+
+	/** The preset of a filter's settings
+	*/
+	FilterPreset getPreset(const CpuSVGFFilter::Settings &settings);
+
+	/** Set the preset's settings in settings, leaving the others alone
+	*/
+	void applyPreset(const FilterPreset &preset, CpuSVGFFilter::Settings &settings);
+}
@@ -23,6 +23,21 @@ __import Shading;
 #include "SVGFCommon.h"
 #include "SVGFEdgeStoppingFunctions.h"
 #include "SVGFPackNormal.h"
+#include "SVGFStorage.h"
+
+// Compile-time variant, picked by SVGFPass::getAtrousVariant().  Without these defines the kernel filters both channels
+//    with the 5x5 kernel and reads gPerformModulation at run time.
+//    ATROUS_CHANNELS   1:  direct only, 2:  indirect only, 3:  both.  A channel left out passes through unfiltered.
+//    ATROUS_MODULATE   0 or 1:  whether this iteration modulates its result with the albedo
+//    ATROUS_RADIUS     1 (3x3 taps) or 2 (5x5 taps)
+#ifndef ATROUS_CHANNELS
+#define ATROUS_CHANNELS 3
+#endif
+#ifndef ATROUS_RADIUS
+#define ATROUS_RADIUS 2
+#endif
+#define FILTER_DIRECT   ((ATROUS_CHANNELS & 1) != 0)
+#define FILTER_INDIRECT ((ATROUS_CHANNELS & 2) != 0)
 
 cbuffer PerImageCB : register(b0)
 {
@@ -32,15 +47,18 @@ cbuffer PerImageCB : register(b0)
     Texture2D   gHistoryLength;
     Texture2D   gAlbedo;
 	Texture2D   gIndirAlbedo;
+    Texture2D   gDirectVar;         // Compact storage only
+    Texture2D   gIndirectVar;
     int         gStepSize;
     float       gPhiColor;
     float       gPhiNormal;
     bool        gPerformModulation;
+    bool        gCompactStorage;
 };
 
 // computes a 3x3 gaussian blur of the variance, centered around
 // the current pixel
-float2 computeVarianceCenter(int2 ipos, Texture2D sDirect, Texture2D sIndirect)
+float2 computeVarianceCenter(int2 ipos, int2 screenSize, Texture2D sDirect, Texture2D sIndirect, Texture2D sDirectVar, Texture2D sIndirectVar)
 {
     float2 sum = float2(0.0, 0.0);
 
@@ -56,10 +74,13 @@ float2 computeVarianceCenter(int2 ipos, Texture2D sDirect, Texture2D sIndirect)
         {
             int2 p = ipos + int2(xx, yy);
 
+            // Taps off the screen count as 0; pooled targets can hold stale texels there
+            if (any(lessThan(p, int2(0, 0))) || any(greaterThanEqual(p, screenSize))) continue;
+
             float k = kernel[abs(xx)][abs(yy)];
 
-            sum.r += sDirect.Load(int3(p, 0)).a * k;
-            sum.g += sIndirect.Load(int3(p, 0)).a * k;
+            if (FILTER_DIRECT)   sum.r += loadIllum(sDirect, sDirectVar, p, gCompactStorage).a * k;
+            if (FILTER_INDIRECT) sum.g += loadIllum(sIndirect, sIndirectVar, p, gCompactStorage).a * k;
         }
     }
 
@@ -70,6 +91,10 @@ struct PS_OUT
 {
     float4 OutDirect    : SV_TARGET0;
     float4 OutIndirect  : SV_TARGET1;
+
+    // Compact storage only, see SVGFStorage.h
+    float OutDirectVar   : SV_TARGET2;
+    float OutIndirectVar : SV_TARGET3;
 };
 
 PS_OUT main(FullScreenPassVsOut vsOut)
@@ -77,20 +102,24 @@ PS_OUT main(FullScreenPassVsOut vsOut)
 
     float4 fragCoord = vsOut.posH;
     const int2 ipos       = int2(fragCoord.xy);
-    const int2 screenSize = getTextureDims(gDirect, 0);
+    const int2 screenSize = getTextureDims(gCompactNormDepth, 0);   // Our own targets can be larger than the screen
 
     const float epsVariance      = 1e-10;
+#if ATROUS_RADIUS == 1
+    const float kernelWeights[2] = { 1.0, 1.0 / 2.0 };
+#else
     const float kernelWeights[3] = { 1.0, 2.0 / 3.0, 1.0 / 6.0 };
+#endif
 
     // constant samplers to prevent the compiler from generating code which
     // fetches the sampler descriptor from memory for each texture access
-    const float4  directCenter    = gDirect.Load(int3(ipos, 0));
-    const float4  indirectCenter  = gIndirect.Load(int3(ipos, 0));
+    const float4  directCenter    = loadIllum(gDirect, gDirectVar, ipos, gCompactStorage);
+    const float4  indirectCenter  = loadIllum(gIndirect, gIndirectVar, ipos, gCompactStorage);
     const float lDirectCenter   = luminance(directCenter.rgb);
     const float lIndirectCenter = luminance(indirectCenter.rgb);
 
     // variance for direct and indirect, filtered using 3x3 gaussin blur
-    const float2 var = computeVarianceCenter(ipos, gDirect, gIndirect);
+    const float2 var = computeVarianceCenter(ipos, screenSize, gDirect, gIndirect, gDirectVar, gIndirectVar);
 
     // number of temporally integrated pixels
     const float historyLength = gHistoryLength.Load(int3(ipos, 0)).r;
@@ -104,8 +133,10 @@ PS_OUT main(FullScreenPassVsOut vsOut)
     if (zCenter.x < 0)
     {
         // not a valid depth => must be envmap => do not filter
-        psOut.OutDirect   = directCenter;
-        psOut.OutIndirect = indirectCenter;
+        psOut.OutDirect      = directCenter;
+        psOut.OutIndirect    = indirectCenter;
+        psOut.OutDirectVar   = directCenter.a;
+        psOut.OutIndirectVar = indirectCenter.a;
         return psOut;
     }
 
@@ -120,9 +151,11 @@ PS_OUT main(FullScreenPassVsOut vsOut)
     float4  sumDirect    = directCenter;
     float4  sumIndirect  = indirectCenter;
 
-    for (int yy = -2; yy <= 2; yy++)
+    [unroll]
+    for (int yy = -ATROUS_RADIUS; yy <= ATROUS_RADIUS; yy++)
     {
-        for (int xx = -2; xx <= 2; xx++)
+        [unroll]
+        for (int xx = -ATROUS_RADIUS; xx <= ATROUS_RADIUS; xx++)
         {
             const int2 p     = ipos + int2(xx, yy) * gStepSize;
             const bool inside = all(greaterThanEqual(p, int2(0,0))) && all(lessThan(p, screenSize));
@@ -131,8 +164,8 @@ PS_OUT main(FullScreenPassVsOut vsOut)
 
             if (inside && (xx != 0 || yy != 0)) // skip center pixel, it is already accumulated
             {
-                const float4 directP     = gDirect.Load(int3(p, 0));
-                const float4 indirectP   = gIndirect.Load(int3(p, 0));
+                const float4 directP     = FILTER_DIRECT   ? loadIllum(gDirect, gDirectVar, p, gCompactStorage)     : float4(0, 0, 0, 0);
+                const float4 indirectP   = FILTER_INDIRECT ? loadIllum(gIndirect, gIndirectVar, p, gCompactStorage) : float4(0, 0, 0, 0);
 
                 float3 normalP;
                 float2 zP;
@@ -151,21 +184,33 @@ PS_OUT main(FullScreenPassVsOut vsOut)
                 const float wIndirect = w.y * kernel;
 
                 // alpha channel contains the variance, therefore the weights need to be squared, see paper for the formula
-                sumWDirect  += wDirect;
-                sumDirect   += float4(wDirect.xxx, wDirect * wDirect) * directP;
-
-                sumWIndirect  += wIndirect;
-                sumIndirect   += float4(wIndirect.xxx, wIndirect * wIndirect) * indirectP;
+                if (FILTER_DIRECT)
+                {
+                    sumWDirect  += wDirect;
+                    sumDirect   += float4(wDirect.xxx, wDirect * wDirect) * directP;
+                }
+                if (FILTER_INDIRECT)
+                {
+                    sumWIndirect  += wIndirect;
+                    sumIndirect   += float4(wIndirect.xxx, wIndirect * wIndirect) * indirectP;
+                }
             }
         }
     }
 
-    // renormalization is different for variance, check paper for the formula
+    // renormalization is different for variance, check paper for the formula.  The sums of a channel left out are
+    //    its center with weight 1, so it passes through.
     psOut.OutDirect   = float4(sumDirect   / float4(sumWDirect.xxx,   sumWDirect   * sumWDirect  ));
     psOut.OutIndirect = float4(sumIndirect / float4(sumWIndirect.xxx, sumWIndirect * sumWIndirect));
+    psOut.OutDirectVar   = psOut.OutDirect.a;
+    psOut.OutIndirectVar = psOut.OutIndirect.a;
 
     // do the demodulation in the last iteration to save memory bandwidth
-    if(gPerformModulation)
+#ifdef ATROUS_MODULATE
+    if (ATROUS_MODULATE)
+#else
+    if (gPerformModulation)
+#endif
     {
         psOut.OutDirect = (psOut.OutDirect * gAlbedo[ipos] + psOut.OutIndirect * gIndirAlbedo[ipos]);
     }
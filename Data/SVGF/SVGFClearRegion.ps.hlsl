@@ -0,0 +1,55 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Clears the filter region of an FBO.  SVGFPass' targets come from a pool and can be larger than the screen, so
+//     rather than clearing them whole it renders this over the region with the viewport set to it.
+
+__import Helpers;
+__import ShaderCommon;
+
+cbuffer PerImageCB : register(b0)
+{
+    float4 gClearColor;      // Attachments 0 to 6
+    float4 gClearLinearZ;    // Attachment 7, linear z history in blit-free mode
+};
+
+struct PS_OUT
+{
+    float4 target0 : SV_TARGET0;
+    float4 target1 : SV_TARGET1;
+    float4 target2 : SV_TARGET2;
+    float4 target3 : SV_TARGET3;
+    float4 target4 : SV_TARGET4;
+    float4 target5 : SV_TARGET5;
+    float4 target6 : SV_TARGET6;
+    float4 target7 : SV_TARGET7;
+};
+
+PS_OUT main(FullScreenPassVsOut vsOut)
+{
+    PS_OUT ret;
+    ret.target0 = gClearColor;
+    ret.target1 = gClearColor;
+    ret.target2 = gClearColor;
+    ret.target3 = gClearColor;
+    ret.target4 = gClearColor;
+    ret.target5 = gClearColor;
+    ret.target6 = gClearColor;
+    ret.target7 = gClearLinearZ;
+    return ret;
+}
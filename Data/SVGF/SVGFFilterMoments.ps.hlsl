@@ -23,6 +23,7 @@ __import Shading;
 #include "SVGFCommon.h"
 #include "SVGFEdgeStoppingFunctions.h"
 #include "SVGFPackNormal.h"
+#include "SVGFStorage.h"
 
 cbuffer PerImageCB : register(b0)
 {
@@ -31,24 +32,42 @@ cbuffer PerImageCB : register(b0)
     Texture2D   gMoments;
     Texture2D   gHistoryLength;
     Texture2D   gCompactNormDepth;
+    Texture2D   gDirectVar;         // Compact storage only
+    Texture2D   gIndirectVar;
+    Texture2D   gMomentsIndirect;
     float       gPhiColor;
     float       gPhiNormal;
+    bool        gCompactStorage;
 };
 
 struct PS_OUT
 {
     float4 OutDirect   : SV_TARGET0;
     float4 OutIndirect : SV_TARGET1;
+
+    // Compact storage only, see SVGFStorage.h
+    float OutDirectVar   : SV_TARGET2;
+    float OutIndirectVar : SV_TARGET3;
 };
 
+PS_OUT makeOutput(float4 direct, float4 indirect)
+{
+    PS_OUT psOut;
+    psOut.OutDirect      = direct;
+    psOut.OutIndirect    = indirect;
+    psOut.OutDirectVar   = direct.a;
+    psOut.OutIndirectVar = indirect.a;
+    return psOut;
+}
+
 PS_OUT main(FullScreenPassVsOut vsOut)
 {
 
     float4 fragCoord = vsOut.posH;
     int2 ipos = int2(fragCoord.xy);
 
-	float h = gHistoryLength[ipos].r;
-    int2 screenSize = getTextureDims(gHistoryLength, 0);
+	float h = loadHistoryLength(gHistoryLength, ipos, gCompactStorage);
+    int2 screenSize = getTextureDims(gCompactNormDepth, 0);   // Our own targets can be larger than the screen
 
     if (h < 4.0) // not enough temporal history available
     {
@@ -58,8 +77,8 @@ PS_OUT main(FullScreenPassVsOut vsOut)
         float3  sumIndirect  = float3(0.0, 0.0, 0.0);
         float4  sumMoments   = float4(0.0, 0.0, 0.0, 0.0);
 
-        const float4  directCenter    = gDirect[ipos];
-        const float4  indirectCenter  = gIndirect[ipos];
+        const float4  directCenter    = loadIllum(gDirect, gDirectVar, ipos, gCompactStorage);
+        const float4  indirectCenter  = loadIllum(gIndirect, gIndirectVar, ipos, gCompactStorage);
 		const float lDirectCenter     = luminance(directCenter.rgb);
         const float lIndirectCenter   = luminance(indirectCenter.rgb);
 
@@ -67,14 +86,10 @@ PS_OUT main(FullScreenPassVsOut vsOut)
         float2 zCenter;
         fetchNormalAndLinearZ(gCompactNormDepth, ipos, normalCenter, zCenter);
 
-        PS_OUT psOut;
-
         if (zCenter.x < 0)
         {
             // current pixel does not a valid depth => must be envmap => do nothing
-            psOut.OutDirect   = directCenter;
-            psOut.OutIndirect = indirectCenter;
-            return psOut;
+            return makeOutput(directCenter, indirectCenter);
         }
 
         const float phiLDirect   = gPhiColor;
@@ -99,7 +114,7 @@ PS_OUT main(FullScreenPassVsOut vsOut)
 
                     const float3 directP     = gDirect[p].rgb;
                     const float3 indirectP   = gIndirect[p].rgb;
-                    const float4 momentsP    = gMoments[p];
+                    const float4 momentsP    = loadMoments(gMoments, gMomentsIndirect, p, gCompactStorage);
 
                     const float lDirectP   = luminance(directP.rgb);
                     const float lIndirectP = luminance(indirectP.rgb);
@@ -142,19 +157,12 @@ PS_OUT main(FullScreenPassVsOut vsOut)
         // give the variance a boost for the first frames
         variance *= 4.0 / h;
 
-        psOut.OutDirect = float4(sumDirect, variance.r);
-        psOut.OutIndirect = float4(sumIndirect, variance.g);
-
-        return psOut;
+        return makeOutput(float4(sumDirect, variance.r), float4(sumIndirect, variance.g));
     }
     else
     {
         // do nothing, pass data unmodified
-        PS_OUT psOut;
-
-        psOut.OutDirect = gDirect[ipos];
-        psOut.OutIndirect = gIndirect[ipos];
-
-        return psOut;
+        return makeOutput(loadIllum(gDirect, gDirectVar, ipos, gCompactStorage),
+                          loadIllum(gIndirect, gIndirectVar, ipos, gCompactStorage));
     }
 }
\ No newline at end of file
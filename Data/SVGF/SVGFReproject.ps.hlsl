@@ -23,6 +23,7 @@ __import Shading;
 #include "SVGFCommon.h"
 #include "SVGFPackNormal.h"
 #include "SVGFEdgeStoppingFunctions.h"
+#include "SVGFStorage.h"
 
 cbuffer PerImageCB : register(b0)
 {
@@ -33,6 +34,7 @@ cbuffer PerImageCB : register(b0)
     Texture2D   gPrevDirect;
     Texture2D   gPrevIndirect;
     Texture2D   gPrevMoments;
+    Texture2D   gPrevMomentsIndirect;   // Compact storage only
     //Texture2D   gAlbedo;
 
     Texture2D   gLinearZ;
@@ -42,6 +44,7 @@ cbuffer PerImageCB : register(b0)
 
     float       gAlpha;
     float       gMomentsAlpha;
+    bool        gCompactStorage;
     //bool        gPerformDemodulation;
 };
 
@@ -75,6 +78,12 @@ bool isReprjValid(int2 coord, float Z, float Zprev, float fwidthZ, float3 normal
     return true;
 }
 
+// Our previous-frame targets can be larger than the screen, and what lies outside it is never cleared
+bool isTapInside(int2 p, int2 imageDim)
+{
+    return all(greaterThanEqual(p, int2(0,0))) && all(lessThan(p, imageDim));
+}
+
 bool loadPrevData(float2 fragCoord, out float4 prevDirect, out float4 prevIndirect, out float4 prevMoments, out float historyLength)
 {
     const int2 ipos = fragCoord;
@@ -103,6 +112,9 @@ bool loadPrevData(float2 fragCoord, out float4 prevDirect, out float4 prevIndire
     for (int sampleIdx = 0; sampleIdx < 4; sampleIdx++)
     {
         int2 loc = int2(posPrev) + offset[sampleIdx];
+        v[sampleIdx] = false;
+        if (!isTapInside(loc, int2(imageDim))) continue;
+
         float4 depthPrev = gPrevLinearZ[loc];
         float3 normalPrev = octToDir(asuint(depthPrev.w));
 
@@ -135,7 +147,7 @@ bool loadPrevData(float2 fragCoord, out float4 prevDirect, out float4 prevIndire
             {
                 prevDirect   += w[sampleIdx] * gPrevDirect[loc];
                 prevIndirect += w[sampleIdx] * gPrevIndirect[loc];
-                prevMoments  += w[sampleIdx] * gPrevMoments[loc];
+                prevMoments  += w[sampleIdx] * loadMoments(gPrevMoments, gPrevMomentsIndirect, loc, gCompactStorage);
                 sumw         += w[sampleIdx];
             }
         }
@@ -158,6 +170,8 @@ bool loadPrevData(float2 fragCoord, out float4 prevDirect, out float4 prevIndire
             for (int xx = -radius; xx <= radius; xx++)
             {
                 int2 p = iposPrev + int2(xx, yy);
+                if (!isTapInside(p, int2(imageDim))) continue;
+
                 float4 depthFilter = gPrevLinearZ[p];
 				float3 normalFilter = octToDir(asuint(depthFilter.w));
 
@@ -165,7 +179,7 @@ bool loadPrevData(float2 fragCoord, out float4 prevDirect, out float4 prevIndire
                 {
 					prevDirect += gPrevDirect[p];
                     prevIndirect += gPrevIndirect[p];
-					prevMoments += gPrevMoments[p];
+					prevMoments += loadMoments(gPrevMoments, gPrevMomentsIndirect, p, gCompactStorage);
                     cnt += 1.0;
                 }
             }
@@ -183,7 +197,7 @@ bool loadPrevData(float2 fragCoord, out float4 prevDirect, out float4 prevIndire
     if (valid)
     {
         // crude, fixme
-        historyLength = gHistoryLength.Load(int3(iposPrev, 0)).r;
+        historyLength = loadHistoryLength(gHistoryLength, iposPrev, gCompactStorage);
     }
     else
     {
@@ -209,6 +223,14 @@ struct PS_OUT
     float4 OutIndirect      : SV_TARGET1;
     float4 OutMoments       : SV_TARGET2;
     float OutHistoryLength  : SV_TARGET3;
+
+    // Compact storage only, see SVGFStorage.h
+    float OutDirectVar       : SV_TARGET4;
+    float OutIndirectVar     : SV_TARGET5;
+    float2 OutMomentsIndirect : SV_TARGET6;
+
+    // Blit-free mode only:  this frame's linear z, read back as gPrevLinearZ once the reprojection buffers are swapped
+    float4 OutLinearZ        : SV_TARGET7;
 };
 
 PS_OUT main(FullScreenPassVsOut vsOut)
@@ -242,7 +264,9 @@ PS_OUT main(FullScreenPassVsOut vsOut)
     PS_OUT psOut;
 
     psOut.OutMoments = moments;
-    psOut.OutHistoryLength = historyLength;
+    psOut.OutHistoryLength = packHistoryLength(historyLength, gCompactStorage);
+    psOut.OutMomentsIndirect = moments.ba;
+    psOut.OutLinearZ = gLinearZ[ipos];
 
     float2 variance = max(float2(0,0), moments.ga - moments.rb * moments.rb);
 
@@ -255,6 +279,8 @@ PS_OUT main(FullScreenPassVsOut vsOut)
     // variance is propagated through the alpha channel
     psOut.OutDirect.a = variance.r;
     psOut.OutIndirect.a = variance.g;
+    psOut.OutDirectVar = variance.r;
+    psOut.OutIndirectVar = variance.g;
 
     return psOut;
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#ifndef SVGF_STORAGE_H
+#define SVGF_STORAGE_H
+
+// Helpers to read and write the intermediate buffers in any of SVGFPass' storage formats.  The compact format
+//     stores illumination color in R11G11B10F, which has no alpha, so the variance moves to a separate R16F
+//     target; the luminance moments are split into two RG16F targets (direct, indirect), and the history length
+//     (an integer in [1, 32]) is stored in R8Unorm divided by 255.
+
+static const float kCompactHistoryScale = 255.0;
+
+float4 loadIllum(Texture2D color, Texture2D variance, int2 ipos, bool compact)
+{
+    float4 v = color.Load(int3(ipos, 0));
+    if (compact) v.a = variance.Load(int3(ipos, 0)).r;
+    return v;
+}
+
+float4 loadMoments(Texture2D moments, Texture2D momentsIndirect, int2 ipos, bool compact)
+{
+    float4 m = moments.Load(int3(ipos, 0));
+    if (compact) m.ba = momentsIndirect.Load(int3(ipos, 0)).rg;
+    return m;
+}
+
+float loadHistoryLength(Texture2D historyLength, int2 ipos, bool compact)
+{
+    float h = historyLength.Load(int3(ipos, 0)).r;
+    return compact ? h * kCompactHistoryScale : h;
+}
+
+float packHistoryLength(float historyLength, bool compact)
+{
+    return compact ? historyLength / kCompactHistoryScale : historyLength;
+}
+
+#endif
@@ -0,0 +1,114 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Temporal anti-aliasing after SVGF:  blends this frame's filtered color into the previous frame's output, reprojected
+//     with SVGF_MotionVecs.  The history is clamped to the bounding box of the pixel's 3x3 neighborhood in YCoCg, so
+//     colors the current frame doesn't support around the pixel (disocclusions, moving shading) are rejected instead
+//     of smearing.  What's left is a running average that evens out the low-frequency flicker the a-trous filter
+//     leaves behind.  CpuSVGF::TemporalAA runs the same per-pixel code on the CPU (see SVGFKernels.h).
+
+__import Helpers;
+__import ShaderCommon;
+
+#include "SVGFCommon.h"
+
+cbuffer PerImageCB : register(b0)
+{
+    Texture2D   gColor;         // This frame, SVGF's output
+    Texture2D   gMotion;        // SVGF_MotionVecs
+    Texture2D   gHistory;       // Last frame's output
+
+    float       gAlpha;         // Weight of this frame in the result
+    bool        gHasHistory;    // False on the first frame and after resizing
+};
+
+struct PS_OUT
+{
+    float4 color   : SV_TARGET0;
+    float4 history : SV_TARGET1;
+};
+
+float3 rgbToYCoCg(float3 c)
+{
+    return float3( 0.25 * c.r + 0.5 * c.g + 0.25 * c.b,
+                   0.5  * c.r             - 0.5  * c.b,
+                  -0.25 * c.r + 0.5 * c.g - 0.25 * c.b);
+}
+
+float3 yCoCgToRgb(float3 c)
+{
+    return float3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+}
+
+int2 clampToScreen(int2 p, int2 imageDim)
+{
+    return clamp(p, int2(0, 0), imageDim - int2(1, 1));
+}
+
+// Bilinear fetch of the history at posPrev (in pixels, texel centers at integers), taps clamped to the screen
+float3 loadHistory(float2 posPrev, int2 imageDim)
+{
+    const float2 p0 = floor(posPrev);
+    const float2 f  = posPrev - p0;
+    const int2   ip = int2(p0);
+
+    const float3 h00 = gHistory[clampToScreen(ip,               imageDim)].rgb;
+    const float3 h10 = gHistory[clampToScreen(ip + int2(1, 0), imageDim)].rgb;
+    const float3 h01 = gHistory[clampToScreen(ip + int2(0, 1), imageDim)].rgb;
+    const float3 h11 = gHistory[clampToScreen(ip + int2(1, 1), imageDim)].rgb;
+
+    const float3 top    = h00 + (h10 - h00) * f.x;
+    const float3 bottom = h01 + (h11 - h01) * f.x;
+    return top + (bottom - top) * f.y;
+}
+
+PS_OUT main(FullScreenPassVsOut vsOut)
+{
+    const int2 ipos     = int2(vsOut.posH.xy);
+    const int2 imageDim = getTextureDims(gColor, 0);
+
+    const float4 color   = gColor[ipos];
+    const float3 current = rgbToYCoCg(color.rgb);
+
+    // Bounding box of the 3x3 neighborhood, edge pixels repeated past the border
+    float3 boxMin = current;
+    float3 boxMax = current;
+    for (int yy = -1; yy <= 1; yy++)
+    {
+        for (int xx = -1; xx <= 1; xx++)
+        {
+            const float3 c = rgbToYCoCg(gColor[clampToScreen(ipos + int2(xx, yy), imageDim)].rgb);
+            boxMin = min(boxMin, c);
+            boxMax = max(boxMax, c);
+        }
+    }
+
+    // Where this pixel was last frame, as in SVGFReproject.ps.hlsl.  History from off screen is dropped.
+    const float2 posPrev  = float2(ipos) + gMotion[ipos].xy * float2(imageDim);
+    const bool   onScreen = all(greaterThan(posPrev, float2(-0.5, -0.5))) && all(lessThan(posPrev, float2(imageDim) - float2(0.5, 0.5)));
+    const bool   valid    = gHasHistory && onScreen;
+
+    const float3 history = valid ? clamp(rgbToYCoCg(loadHistory(posPrev, imageDim)), boxMin, boxMax) : current;
+    const float  alpha   = valid ? gAlpha : 1.0;
+    const float3 result  = history + (current - history) * alpha;
+
+    PS_OUT ret;
+    ret.color   = float4(yCoCgToRgb(result), color.a);
+    ret.history = ret.color;
+    return ret;
+}
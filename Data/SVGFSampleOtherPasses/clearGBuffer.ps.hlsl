@@ -24,7 +24,16 @@ Texture2D<float4> gEnvMap;
 
 // What's in our output G-buffer structure?  This is extremely fat and probably could be cut down, except
 //    our research / prototype SVGF filter and simple path tracer uses a bunch of these outputs as full
-//    floats.  There's serious room here for G-buffer compression.
+//    floats.  There's serious room here for G-buffer compression.  Keep in sync with gBufferSVGF.ps.hlsl.
+#ifdef COMPACT_GBUFFER
+struct GBuffer
+{
+	float4 svgfLinZ    : SV_Target0;
+	float4 svgfMoVec   : SV_Target1;
+	float4 svgfCompact : SV_Target2;   // .w = 0 marks a background pixel
+	uint2  matPacked   : SV_Target3;
+};
+#else
 struct GBuffer
 {
 	float4 wsPos       : SV_Target0;   // World space position.  .w component = 0 if a background pixel
@@ -35,6 +44,7 @@ struct GBuffer
 	float4 svgfMoVec   : SV_Target5;   // SVGF-specific buffer containing motion vector and fwidth of pos & normal
 	float4 svgfCompact : SV_Target6;   // SVGF-specific buffer containing duplicate data that allows reducing memory traffic in some passes
 };
+#endif
 
 // Define pi
 #define M_1_PI  0.318309886183790671538
@@ -54,6 +64,15 @@ GBuffer main(float2 texC : TEXCOORD, float4 pos : SV_Position)
 	float2 ndc = float2(2, -2) * texC + float2(-1, 1);
 	float3 rayDir = ndc.x * gCamera.cameraU + ndc.y * gCamera.cameraV + gCamera.cameraW;
 
+#ifdef COMPACT_GBUFFER
+	// The packed material can't hold an HDR color; the ray tracing pass looks the background up in the env. map itself
+	GBuffer gBufOut;
+	gBufOut.svgfLinZ = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	gBufOut.svgfMoVec = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	gBufOut.svgfCompact = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	gBufOut.matPacked = uint2(0, 0);
+	return gBufOut;
+#else
 	// Load a color from our background environment map
 	float2 dims;
 	gEnvMap.GetDimensions(dims.x, dims.y);
@@ -68,5 +87,7 @@ GBuffer main(float2 texC : TEXCOORD, float4 pos : SV_Position)
 	gBufOut.matSpec = float4(0.0f, 0.0f, 0.0f, 0.0f);
 	gBufOut.svgfLinZ = float4(0.0f, 0.0f, 0.0f, 0.0f);
 	gBufOut.svgfMoVec = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	gBufOut.svgfCompact = float4(0.0f, 0.0f, 0.0f, 0.0f);
     return gBufOut;
+#endif
 }
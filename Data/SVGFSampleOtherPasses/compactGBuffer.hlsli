@@ -0,0 +1,61 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Packing helpers for the compact G-buffer layout (GBufferLayout::Compact in Passes/GBufferForSVGF.h).  That layout
+//    drops WorldPosition, WorldNormal, MaterialDiffuse and MaterialSpecRough:  the normal is only stored once, as the
+//    octahedral normal already in SVGF_CompactNormDepth, whose otherwise unused .w holds the distance from the camera
+//    so world position can be rebuilt along the primary ray, and both material colors go to one RG32Uint target.
+//    CpuSVGF/SVGFGBufferLayout.h has a C++ port of everything here.
+
+// Material colors are stored with a square root curve, which spends more of the 8 bits on dark albedos
+uint packMaterialColor(float3 color, float alpha)
+{
+	uint4 q = uint4(round(saturate(float4(sqrt(saturate(color)), alpha)) * 255.0f));
+	return q.x | (q.y << 8) | (q.z << 16) | (q.w << 24);
+}
+
+float4 unpackMaterialColor(uint packed)
+{
+	float4 v = float4(packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF, packed >> 24) * (1.0f / 255.0f);
+	return float4(v.rgb * v.rgb, v.a);
+}
+
+// The inverse of dirToOct() in gBufferSVGF.ps.hlsl (the same as octToDir() in SVGF/SVGFPackNormal.h)
+float3 compactOctToDir(uint octo)
+{
+	float2 e = float2( f16tof32(octo & 0xFFFF), f16tof32((octo>>16) & 0xFFFF) );
+	float3 v = float3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0)
+		v.xy = (1.0 - abs(v.yx)) * (step(0.0, v.xy)*2.0 - (float2)(1.0));
+	return normalize(v);
+}
+
+// Direction of the primary ray the rasterizer sampled at a pixel center.  The raster pass renders with a jittered
+//    projection; undo the jitter the same way the motion vectors in gBufferSVGF.ps.hlsl do.
+float3 getPrimaryRayDir(uint2 pixel, uint2 dims)
+{
+	float2 texC = (float2(pixel) + 0.5f) / float2(dims) - float2(gCamera.jitterX, -gCamera.jitterY);
+	float2 ndc  = float2(2, -2) * texC + float2(-1, 1);
+	return normalize(ndc.x * gCamera.cameraU + ndc.y * gCamera.cameraV + gCamera.cameraW);
+}
+
+// World position from the camera distance in SVGF_CompactNormDepth.w; .w of the result is 0 for background pixels
+float4 reconstructWorldPos(float3 primaryRayDir, float hitDist)
+{
+	return float4(gCamera.posW + primaryRayDir * hitDist, hitDist > 0.0f ? 1.0f : 0.0f);
+}
@@ -0,0 +1,98 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Importance sampling of the lat-long environment map for indirect rays; a port of CpuSVGF::EnvMapSampler
+//    (CpuSVGF/SVGFEnvMapSampler.h), whose tables GGXGlobalIlluminationPass builds on the CPU and uploads.  A texel is
+//    picked in proportion to its luminance times its solid angle from a marginal CDF over rows and a conditional CDF
+//    within its row, then a point is picked uniformly in the texel.
+//
+//    Needs wsVectorToLatLong() from ggxGlobalIlluminationUtils.hlsli.
+
+// Probability with which an indirect ray samples the map instead of the BRDF (CpuSVGF::kEnvMapSampleProbability)
+#define ENV_MAP_SAMPLE_PROBABILITY 0.5f
+
+// Inclusive CDFs (entry i sums weights 0 .. i, the last is 1):  over rows (height x 1), and within each row (width x height)
+Texture2D<float> gEnvMarginalCdf;
+Texture2D<float> gEnvConditionalCdf;
+
+// Index of the first entry of row `row` of an inclusive CDF above u, and where u falls within that entry in [0, 1)
+uint findEnvMapInterval(Texture2D<float> cdf, uint row, uint count, float u, out float offset)
+{
+	uint lo = 0, hi = count - 1;
+	while (lo < hi)
+	{
+		uint mid = (lo + hi) / 2;
+		if (cdf[uint2(mid, row)] > u) hi = mid;
+		else lo = mid + 1;
+	}
+	float below = lo > 0 ? cdf[uint2(lo - 1, row)] : 0.0f;
+	float width = cdf[uint2(lo, row)] - below;
+	offset = width > 0.0f ? clamp((u - below) / width, 0.0f, 0.99999994f) : 0.5f;
+	return lo;
+}
+
+// Probability of picking texel (x, y)
+float getEnvMapTexelProbability(uint x, uint y)
+{
+	float py = gEnvMarginalCdf[uint2(y, 0)] - (y > 0 ? gEnvMarginalCdf[uint2(y - 1, 0)] : 0.0f);
+	float px = gEnvConditionalCdf[uint2(x, y)] - (x > 0 ? gEnvConditionalCdf[uint2(x - 1, y)] : 0.0f);
+	return py * px;
+}
+
+// Inverse of wsVectorToLatLong()
+float3 latLongToWsVector(float2 uv)
+{
+	float phi = (2.0f * uv.x - 1.0f) * M_PI;
+	float theta = uv.y * M_PI;
+	float sinTheta = sin(theta);
+	return float3(sinTheta * sin(phi), cos(theta), -sinTheta * cos(phi));
+}
+
+// Density per unit solid angle of a point in texel (x, y) at latitude v:  uniform in (u, v) within the texel, which
+//    spans 2 pi^2 sin(theta) / (width * height) steradians per unit area
+float getEnvMapPdf(uint x, uint y, float v, uint2 dims)
+{
+	float sinTheta = sin(v * M_PI);
+	return sinTheta > 0.0f ? getEnvMapTexelProbability(x, y) * float(dims.x) * float(dims.y) / (2.0f * M_PI * M_PI * sinTheta) : 0.0f;
+}
+
+// A direction toward a bright part of the environment, and its probability density per unit solid angle
+float3 sampleEnvMap(float2 randVal, out float pdf)
+{
+	uint2 dims;
+	gEnvConditionalCdf.GetDimensions(dims.x, dims.y);
+
+	float fy, fx;
+	uint y = findEnvMapInterval(gEnvMarginalCdf, 0, dims.y, randVal.x, fy);
+	uint x = findEnvMapInterval(gEnvConditionalCdf, y, dims.x, randVal.y, fx);
+	float2 uv = float2((float(x) + fx) / float(dims.x), (float(y) + fy) / float(dims.y));
+	pdf = getEnvMapPdf(x, y, uv.y, dims);
+	return latLongToWsVector(uv);
+}
+
+// Probability density per unit solid angle with which sampleEnvMap() returns dir
+float evalEnvMapPdf(float3 dir)
+{
+	uint2 dims;
+	gEnvConditionalCdf.GetDimensions(dims.x, dims.y);
+
+	float2 uv = wsVectorToLatLong(dir);
+	uint x = min(uint(uv.x * float(dims.x)), dims.x - 1);
+	uint y = min(uint(uv.y * float(dims.y)), dims.y - 1);
+	return getEnvMapPdf(x, y, uv.y, dims);
+}
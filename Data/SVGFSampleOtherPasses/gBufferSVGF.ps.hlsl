@@ -30,7 +30,17 @@ cbuffer GBufCB
 
 // What's in our output G-buffer structure?  This is extremely fat and probably could be cut down, except
 //    our research / prototype SVGF filter and simple path tracer uses a bunch of these outputs as full
-//    floats.  There's serious room here for G-buffer compression.
+//    floats.  There's serious room here for G-buffer compression; COMPACT_GBUFFER selects a layout that
+//    drops the position, normal and material targets (see compactGBuffer.hlsli).
+#ifdef COMPACT_GBUFFER
+struct GBuffer
+{
+	float4 svgfLinZ    : SV_Target0;   // SVGF-specific buffer containing linear z, max z-derivs, last frame's z, obj-space normal
+	float4 svgfMoVec   : SV_Target1;   // SVGF-specific buffer containing motion vector and fwidth of pos & normal
+	float4 svgfCompact : SV_Target2;   // Octahedral normal, linear z, max z-deriv, distance from camera (0 if background)
+	uint2  matPacked   : SV_Target3;   // Diffuse color + opacity and specular color + roughness, 8 bits each
+};
+#else
 struct GBuffer
 {
 	float4 wsPos       : SV_Target0;   // World space position.  .w component = 0 if a background pixel
@@ -41,6 +51,9 @@ struct GBuffer
 	float4 svgfMoVec   : SV_Target5;   // SVGF-specific buffer containing motion vector and fwidth of pos & normal
 	float4 svgfCompact : SV_Target6;   // SVGF-specific buffer containing duplicate data that allows reducing memory traffic in some passes
 };
+#endif
+
+#include "compactGBuffer.hlsli"
 
 // A simple utility to convert a float to a 2-component octohedral representation packed into one uint
 uint dirToOct(float3 normal)
@@ -83,16 +96,21 @@ GBuffer main(GBufVertexOut vsOut, uint primID : SV_PrimitiveID, float4 pos : SV_
 	float4 svgfMotionVecOut = float4(svgfMotionVec, posNormFWidth);
 
 	// Dump out our G buffer channels
+	float hitDist = length(hitPt.posW - gCamera.posW);
 	GBuffer gBufOut;
+#ifdef COMPACT_GBUFFER
+	gBufOut.matPacked = uint2(packMaterialColor(hitPt.diffuse, hitPt.opacity), packMaterialColor(hitPt.specular, hitPt.linearRoughness));
+#else
 	gBufOut.wsPos     = float4(hitPt.posW, 1.f);
-	gBufOut.wsNorm    = float4(hitPt.N, length(hitPt.posW - gCamera.posW) );
+	gBufOut.wsNorm    = float4(hitPt.N, hitDist );
 	gBufOut.matDif    = float4(hitPt.diffuse, hitPt.opacity);
 	gBufOut.matSpec   = float4(hitPt.specular, hitPt.linearRoughness);
+#endif
 	gBufOut.svgfLinZ  = svgfLinearZOut;
 	gBufOut.svgfMoVec = svgfMotionVecOut;
 
-	// A compacted buffer containing discretizied normal, depth, depth derivative
-	gBufOut.svgfCompact = float4( asfloat(dirToOct(hitPt.N)), linearZ, maxChangeZ, 0.0f );
+	// A compacted buffer containing discretizied normal, depth, depth derivative and distance from the camera
+	gBufOut.svgfCompact = float4( asfloat(dirToOct(hitPt.N)), linearZ, maxChangeZ, hitDist );
 
 	return gBufOut;
 }
@@ -29,24 +29,43 @@ import Lights;                       // Light structures for our current scene
 // A separate file with some simple utility functions: getPerpendicularVector(), initRand(), nextRand()
 #include "ggxGlobalIlluminationUtils.hlsli"
 
+// Where the random numbers come from:  white noise, blue noise or Sobol
+#include "sampleSequence.hlsli"
+
+// How the light for direct lighting is picked:  uniformly or by power
+#include "lightSelection.hlsli"
+
+// Importance sampling of the environment map for indirect rays
+#include "envMapSampling.hlsli"
+
 // Include shader entries, data structures, and utility functions to spawn rays
 #include "standardShadowRay.hlsli"
 #include "indirectRay.hlsli"
+#include "compactGBuffer.hlsli"
 
 // A constant buffer we'll populate from our C++ code  (used for our ray generation shader)
 cbuffer RayGenCB
 {
 	float gMinT;           // Min distance to start a ray to avoid self-occlusion
 	uint  gFrameCount;     // An integer changing every frame to update the random number
+	uint  gSampleIndex;    // Frames since the pass started; the index into the blue noise and Sobol sequences
+	uint  gSampler;        // SAMPLER_WHITE_NOISE, SAMPLER_BLUE_NOISE or SAMPLER_SOBOL
+	uint  gLightSelection; // LIGHT_SELECTION_UNIFORM or LIGHT_SELECTION_POWER
+	bool  gSampleEnvMap;   // Combine BRDF sampling of indirect rays with sampling gEnvMarginalCdf / gEnvConditionalCdf
 	bool  gDoIndirectGI;   // A boolean determining if we should shoot indirect GI rays
 	bool  gDoDirectGI;     // A boolean determining if we should compute direct lighting
 }
 
 // Input textures that need to be set by the C++ code (for the ray gen shader)
+#ifdef COMPACT_GBUFFER
+Texture2D<float4> gCompactNormDepth;
+Texture2D<uint2>  gPackedMatl;
+#else
 Texture2D<float4> gPos;
 Texture2D<float4> gNorm;
 Texture2D<float4> gDiffuseMatl;
 Texture2D<float4> gSpecMatl;
+#endif
 
 // Output textures that need to be set by the C++ code (for the ray gen shader)
 RWTexture2D<float4> gDirectOut;
@@ -65,10 +84,27 @@ void SimpleDiffuseGIRayGen()
 	uint2 launchDim      = DispatchRaysDimensions().xy;
 
 	// Load g-buffer data
+#ifdef COMPACT_GBUFFER
+	// Rebuild position along the primary ray; the background color isn't stored, so fetch it from the env. map
+	float4 normDepth     = gCompactNormDepth[launchIndex];
+	uint2  packedMatl    = gPackedMatl[launchIndex];
+	float3 primaryDir    = getPrimaryRayDir(launchIndex, launchDim);
+	float4 worldPos      = reconstructWorldPos(primaryDir, normDepth.w);
+	float4 worldNorm     = float4(compactOctToDir(asuint(normDepth.x)), normDepth.w);
+	float4 difMatlColor  = unpackMaterialColor(packedMatl.x);
+	float4 specMatlColor = unpackMaterialColor(packedMatl.y);
+	if (worldPos.w == 0.0f)
+	{
+		float2 dims;
+		gEnvMap.GetDimensions(dims.x, dims.y);
+		difMatlColor = float4(gEnvMap[uint2(wsVectorToLatLong(primaryDir) * dims)].rgb, 0.0f);
+	}
+#else
 	float4 worldPos      = gPos[launchIndex];
 	float4 worldNorm     = gNorm[launchIndex];
 	float4 difMatlColor  = gDiffuseMatl[launchIndex];
 	float4 specMatlColor = gSpecMatl[launchIndex];
+#endif
 
 	// Does this g-buffer pixel contain a valid piece of geometry?  (0 in pos.w for invalid)
 	bool isGeometryValid = (worldPos.w != 0.0f);
@@ -81,7 +117,7 @@ void SimpleDiffuseGIRayGen()
 	float NdotV = dot(worldNorm.xyz, toCamera);
 
 	// Initialize our random number generator
-	uint randSeed = initRand(launchIndex.x + launchIndex.y * launchDim.x, gFrameCount, 16);
+	SampleSequence sampleSeq = initSampleSequence(gSampler, launchIndex, launchDim, gFrameCount, gSampleIndex);
 
 	// Do shading, if we have geoemtry here (otherwise, output the background color)
 	if (isGeometryValid)
@@ -90,7 +126,8 @@ void SimpleDiffuseGIRayGen()
 		if (gDoDirectGI)
 		{
 			// Pick a random light from our scene to sample for direct lighting
-			int lightToSample = min(int(nextRand(randSeed) * gLightsCount), gLightsCount - 1);
+			float lightInvPdf;
+			int lightToSample = selectLight(gLightSelection, nextSample(sampleSeq), lightInvPdf);
 
 			// We need to query our scene to find info about the current light
 			float distToLight;
@@ -102,7 +139,7 @@ void SimpleDiffuseGIRayGen()
 			float NdotL = saturate(dot(worldNorm.xyz, toLight));
 
 			// Shoot our ray for our direct lighting
-			float shadowMult = float(gLightsCount) * shadowRayVisibility(worldPos.xyz, toLight, gMinT, distToLight);
+			float shadowMult = lightInvPdf * shadowRayVisibility(worldPos.xyz, toLight, gMinT, distToLight);
 
 			// Compute our GGX color
 			float3 ggxTerm = getGGXColor(toCamera, toLight, worldNorm.xyz, NdotV, specMatlColor.rgb, roughness, true);
@@ -120,20 +157,35 @@ void SimpleDiffuseGIRayGen()
 		{
 			// We have to decide whether we sample our diffuse or specular lobe.
 			float probDiffuse   = probabilityToSampleDiffuse(difMatlColor.rgb, specMatlColor.rgb);
-			float chooseDiffuse = (nextRand(randSeed) < probDiffuse);
+
+			// With environment sampling, the same number first picks between the environment map and the BRDF
+			float lobe = nextSample(sampleSeq);
+			bool chooseEnvMap = gSampleEnvMap && lobe < ENV_MAP_SAMPLE_PROBABILITY;
+			if (gSampleEnvMap && !chooseEnvMap) lobe = (lobe - ENV_MAP_SAMPLE_PROBABILITY) / (1.0f - ENV_MAP_SAMPLE_PROBABILITY);
+			float chooseDiffuse = (lobe < probDiffuse);
+
+			// Two numbers for the bounce direction, drawn in order
+			float2 randVal;
+			randVal.x = nextSample(sampleSeq);
+			randVal.y = nextSample(sampleSeq);
 
 			float3 bounceDir;
-			if (chooseDiffuse)
+			if (chooseEnvMap)
+			{   // Bounce toward a bright part of the environment
+				float envPdf;
+				bounceDir = sampleEnvMap(randVal, envPdf);
+			}
+			else if (chooseDiffuse)
 			{   // Randomly select to bounce in our diffuse lobe
-				bounceDir = getCosHemisphereSample(randSeed, worldNorm.xyz);
+				bounceDir = getCosHemisphereSample(randVal, worldNorm.xyz);
 			}
 			else
 			{   // Randomyl select to bounce in our GGX lobe
-				bounceDir = getGGXSampleDir(randSeed, roughness, worldNorm.xyz, toCamera);
+				bounceDir = getGGXSampleDir(randVal, roughness, worldNorm.xyz, toCamera);
 			}
 
 			// Shoot our indirect color ray
-			float3 bounceColor = shootIndirectRay(worldPos.xyz, bounceDir, gMinT, 0, randSeed);
+			float3 bounceColor = shootIndirectRay(worldPos.xyz, bounceDir, gMinT, 0, sampleSeq.seed);
 
 			// Compute diffuse, ggx shading terms
 			float  NdotL = saturate(dot(worldNorm.xyz, bounceDir));
@@ -141,9 +193,23 @@ void SimpleDiffuseGIRayGen()
 			float3 ggxTerm = NdotL * getGGXColor(toCamera, bounceDir, worldNorm.xyz, NdotV, specMatlColor.rgb, roughness, false);
 
 			// Split into an incoming light and "indirect albedo" term to help filter illumination despite sampling 2 different lobes
-			float3 difFinal = float3(1.0f) / probDiffuse;                    // Has been divided by difTerm.  Multiplied back post-SVGF
-			float3 ggxFinal = ggxTerm / (difTerm * (1.0f - probDiffuse));    // Has been divided by difTerm.  Multiplied back post-SVGF
-			float3 shadeColor = bounceColor * (chooseDiffuse ? difFinal : ggxFinal);
+			float3 shadeColor;
+			if (gSampleEnvMap)
+			{
+				// One sample MIS (balance heuristic):  both lobes' terms over the density of the mixture of environment,
+				//    diffuse and GGX sampling, whichever of the three picked the direction.  Also divided by difTerm.
+				float ggxPdf = getGGXSamplePdf(toCamera, bounceDir, worldNorm.xyz, roughness);
+				float pdf = ENV_MAP_SAMPLE_PROBABILITY * evalEnvMapPdf(bounceDir) +
+				            (1.0f - ENV_MAP_SAMPLE_PROBABILITY) * (probDiffuse * NdotL / M_PI + (1.0f - probDiffuse) * ggxPdf);
+				float3 integrand = NdotL / M_PI + ggxTerm * ggxPdf / difTerm;
+				shadeColor = pdf > 0.0f ? bounceColor * integrand / pdf : float3(0, 0, 0);
+			}
+			else
+			{
+				float3 difFinal = float3(1.0f) / probDiffuse;                    // Has been divided by difTerm.  Multiplied back post-SVGF
+				float3 ggxFinal = ggxTerm / (difTerm * (1.0f - probDiffuse));    // Has been divided by difTerm.  Multiplied back post-SVGF
+				shadeColor = bounceColor * (chooseDiffuse ? difFinal : ggxFinal);
+			}
 
 			bool colorsNan = any(isnan(shadeColor));
 			gIndirectOut[launchIndex] = float4(colorsNan ? float3(0, 0, 0) : shadeColor, 1.0f);
@@ -171,12 +171,9 @@ float nextRand(inout uint s)
 	return float(s & 0x00FFFFFF) / float(0x01000000);
 }
 
-// Get a cosine-weighted random vector centered around a specified normal direction.
-float3 getCosHemisphereSample(inout uint randSeed, float3 hitNorm)
+// Get a cosine-weighted random vector centered around a specified normal direction, from 2 uniform random numbers
+float3 getCosHemisphereSample(float2 randVal, float3 hitNorm)
 {
-	// Get 2 random numbers to select our sample with
-	float2 randVal = float2(nextRand(randSeed), nextRand(randSeed));
-
 	// Cosine weighted hemisphere sample from RNG
 	float3 bitangent = getPerpendicularVector(hitNorm);
 	float3 tangent = cross(bitangent, hitNorm);
@@ -187,6 +184,15 @@ float3 getCosHemisphereSample(inout uint randSeed, float3 hitNorm)
 	return tangent * (r * cos(phi).x) + bitangent * (r * sin(phi)) + hitNorm.xyz * sqrt(max(0.0, 1.0f - randVal.x));
 }
 
+// As above, taking the 2 random numbers from our LCG
+float3 getCosHemisphereSample(inout uint randSeed, float3 hitNorm)
+{
+	float2 randVal;
+	randVal.x = nextRand(randSeed);
+	randVal.y = nextRand(randSeed);
+	return getCosHemisphereSample(randVal, hitNorm);
+}
+
 // This function tests if the alpha test fails, given the attributes of the current hit.
 //   -> Can legally be called in a DXR any-hit shader or a DXR closest-hit shader, and
 //      accesses Falcor helpers and data structures to extract and perform the alpha test.
@@ -253,11 +259,8 @@ float3 getGGXColor(float3 V, float3 L, float3 N, float NdotV, float3 specColor,
 	return (NdotV * NdotL * LdotH <= 0.0f) ? float3(0, 0, 0) : outColor;
 }
 
-float3 getGGXSampleDir(inout uint randSeed, float roughness, float3 hitNorm, float3 inVec)
+float3 getGGXSampleDir(float2 randVal, float roughness, float3 hitNorm, float3 inVec)
 {
-	// Get our uniform random numbers
-	float2 randVal = float2(nextRand(randSeed), nextRand(randSeed));
-
 	// Get an orthonormal basis from the normal
 	float3 B = getPerpendicularVector(hitNorm);
 	float3 T = cross(B, hitNorm);
@@ -275,6 +278,24 @@ float3 getGGXSampleDir(inout uint randSeed, float roughness, float3 hitNorm, flo
 	return normalize(2.f * dot(inVec, H) * H - inVec);
 }
 
+// As above, taking our uniform random numbers from our LCG
+float3 getGGXSampleDir(inout uint randSeed, float roughness, float3 hitNorm, float3 inVec)
+{
+	float2 randVal;
+	randVal.x = nextRand(randSeed);
+	randVal.y = nextRand(randSeed);
+	return getGGXSampleDir(randVal, roughness, hitNorm, inVec);
+}
+
+// Probability density (per unit solid angle) with which getGGXSampleDir() returns L:  D(H) (N.H) / (4 (L.H))
+float getGGXSamplePdf(float3 V, float3 L, float3 N, float roughness)
+{
+	float3 H = normalize(V + L);
+	float NdotH = saturate(dot(N, H));
+	float LdotH = saturate(dot(L, H));
+	return LdotH > 0.0f ? ggxNormalDistribution(NdotH, roughness) * NdotH / (4.0f * LdotH) : 0.0f;
+}
+
 float probabilityToSampleDiffuse(float3 difColor, float3 specColor)
 {
 	float lumDiffuse = max(0.01f, luminance(difColor.rgb));
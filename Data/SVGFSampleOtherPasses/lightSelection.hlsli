@@ -0,0 +1,48 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Picks the light the GI pass samples for direct lighting, selected by LIGHT_SELECTION_* (CpuSVGF::LightSelection).
+//    Uniform picks every light equally often.  Power reads an alias table built on the CPU from each light's
+//    intensity (CpuSVGF::LightAliasTable, in CpuSVGF/SVGFLightSampler.h), so it picks lights in proportion to their
+//    brightness from one random number.
+//
+//    Needs gLightsCount from Falcor's Lights module.
+
+#define LIGHT_SELECTION_UNIFORM  0
+#define LIGHT_SELECTION_POWER    1
+
+// One texel per light, a CpuSVGF::LightAliasEntry:  x = asuint(threshold), y = alias, z = asuint(1 / probability)
+Texture2D<uint4> gLightAliasTable;
+
+// Returns the light for the random number u in [0, 1) and the reciprocal of the probability it was picked with
+int selectLight(uint selection, float u, out float invPdf)
+{
+	float scaled = u * float(gLightsCount);
+	int light = min(int(scaled), gLightsCount - 1);
+	if (selection != LIGHT_SELECTION_POWER)
+	{
+		invPdf = float(gLightsCount);
+		return light;
+	}
+
+	// Keep the light or take its alias, then weigh by the probability of the one taken
+	uint4 entry = gLightAliasTable[uint2(light, 0)];
+	if (scaled - float(light) >= asfloat(entry.x)) light = int(entry.y);
+	invPdf = asfloat(gLightAliasTable[uint2(light, 0)].z);
+	return light;
+}
@@ -0,0 +1,136 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Per-pixel random sequences for the GI pass, selected by SAMPLER_* (CpuSVGF::SamplerType).  White noise is the
+//    original initRand() / nextRand() LCG.  Blue noise reads a 64x64 void and cluster tile, shifted by an R2 step per
+//    dimension, and adds the golden ratio times the sample index so each pixel's values stratify over time.  Sobol
+//    uses Owen scrambled Sobol points (Burley 2020), shuffled and scrambled per pixel.  Everything is integer math,
+//    so CpuSVGF/SVGFSampler.cpp, the C++ port, draws exactly the same numbers.
+//
+//    Needs initRand() and nextRand() from ggxGlobalIlluminationUtils.hlsli.
+
+#define SAMPLER_WHITE_NOISE  0
+#define SAMPLER_BLUE_NOISE   1
+#define SAMPLER_SOBOL        2
+
+#define BLUE_NOISE_TILE_SIZE 64
+
+// Ranks 0 .. 4095 of the blue noise tile (CpuSVGF::getBlueNoiseTile())
+Texture2D<uint> gBlueNoise;
+
+// Direction numbers of the first four Sobol dimensions (Joe and Kuo)
+static const uint kSobolDirections[4 * 32] =
+{
+	0x80000000, 0x40000000, 0x20000000, 0x10000000, 0x08000000, 0x04000000, 0x02000000, 0x01000000,
+	0x00800000, 0x00400000, 0x00200000, 0x00100000, 0x00080000, 0x00040000, 0x00020000, 0x00010000,
+	0x00008000, 0x00004000, 0x00002000, 0x00001000, 0x00000800, 0x00000400, 0x00000200, 0x00000100,
+	0x00000080, 0x00000040, 0x00000020, 0x00000010, 0x00000008, 0x00000004, 0x00000002, 0x00000001,
+	0x80000000, 0xc0000000, 0xa0000000, 0xf0000000, 0x88000000, 0xcc000000, 0xaa000000, 0xff000000,
+	0x80800000, 0xc0c00000, 0xa0a00000, 0xf0f00000, 0x88880000, 0xcccc0000, 0xaaaa0000, 0xffff0000,
+	0x80008000, 0xc000c000, 0xa000a000, 0xf000f000, 0x88008800, 0xcc00cc00, 0xaa00aa00, 0xff00ff00,
+	0x80808080, 0xc0c0c0c0, 0xa0a0a0a0, 0xf0f0f0f0, 0x88888888, 0xcccccccc, 0xaaaaaaaa, 0xffffffff,
+	0x80000000, 0xc0000000, 0x60000000, 0x90000000, 0xe8000000, 0x5c000000, 0x8e000000, 0xc5000000,
+	0x68800000, 0x9cc00000, 0xee600000, 0x55900000, 0x80680000, 0xc09c0000, 0x60ee0000, 0x90550000,
+	0xe8808000, 0x5cc0c000, 0x8e606000, 0xc5909000, 0x6868e800, 0x9c9c5c00, 0xeeee8e00, 0x5555c500,
+	0x8000e880, 0xc0005cc0, 0x60008e60, 0x9000c590, 0xe8006868, 0x5c009c9c, 0x8e00eeee, 0xc5005555,
+	0x80000000, 0xc0000000, 0x20000000, 0x50000000, 0xf8000000, 0x74000000, 0xa2000000, 0x93000000,
+	0xd8800000, 0x25400000, 0x59e00000, 0xe6d00000, 0x78080000, 0xb40c0000, 0x82020000, 0xc3050000,
+	0x208f8000, 0x51474000, 0xfbea2000, 0x75d93000, 0xa0858800, 0x914e5400, 0xdbe79e00, 0x25db6d00,
+	0x58800080, 0xe54000c0, 0x79e00020, 0xb6d00050, 0x800800f8, 0xc00c0074, 0x200200a2, 0x50050093,
+};
+
+struct SampleSequence
+{
+	uint  type;
+	uint2 pixel;
+	uint  index;   // Sample index; shuffled for Sobol
+	uint  seed;    // LCG state for white noise, per-pixel scramble seed for Sobol
+	uint  dim;
+};
+
+// A nested uniform scramble of the bits of x (Burley, "Practical Hash-based Owen Scrambling")
+uint owenScramble(uint x, uint seed)
+{
+	x = reversebits(x);
+	x += seed;
+	x ^= x * 0x6c50b47c;
+	x ^= x * 0xb82f1e52;
+	x ^= x * 0xc7afe638;
+	x ^= x * 0x8d22f6e6;
+	return reversebits(x);
+}
+
+uint hashCombine(uint seed, uint v)
+{
+	return seed ^ (v + (seed << 6) + (seed >> 2));
+}
+
+uint sobol(uint index, uint dim)
+{
+	uint x = 0;
+	for (uint bit = 0; index != 0; bit++, index >>= 1)
+	{
+		if (index & 1) x ^= kSobolDirections[dim * 32 + bit];
+	}
+	return x;
+}
+
+// 32 bit fixed point to [0, 1), keeping the 24 bits a float holds
+float toUnitFloat(uint x)
+{
+	return float(x >> 8) / float(0x01000000);
+}
+
+// frameCount seeds the white noise sequence as before; sampleIndex counts samples from the first frame
+SampleSequence initSampleSequence(uint type, uint2 pixel, uint2 dims, uint frameCount, uint sampleIndex)
+{
+	SampleSequence s;
+	s.type  = type;
+	s.pixel = pixel;
+	s.index = sampleIndex;
+	s.seed  = 0;
+	s.dim   = 0;
+	if (type == SAMPLER_WHITE_NOISE)
+	{
+		s.seed = initRand(pixel.x + pixel.y * dims.x, frameCount, 16);
+	}
+	else if (type == SAMPLER_SOBOL)
+	{
+		s.seed  = initRand(pixel.x + pixel.y * dims.x, 0, 16);
+		s.index = owenScramble(sampleIndex, s.seed);
+	}
+	return s;
+}
+
+// The next number of the sequence, in [0, 1)
+float nextSample(inout SampleSequence s)
+{
+	uint dim = s.dim++;
+	if (s.type == SAMPLER_BLUE_NOISE)
+	{
+		uint2 shift = uint2((dim * 0xc13fa9a9) >> 26, (dim * 0x91e10da5) >> 26);
+		uint  rank  = gBlueNoise[(s.pixel + shift) & (BLUE_NOISE_TILE_SIZE - 1)];
+		return toUnitFloat((rank << 20) + s.index * 0x9e3779b9);
+	}
+	if (s.type == SAMPLER_SOBOL)
+	{
+		uint x = (dim < 4) ? sobol(s.index, dim) : s.index;
+		return toUnitFloat(owenScramble(x, hashCombine(s.seed, dim)));
+	}
+	return nextRand(s.seed);
+}
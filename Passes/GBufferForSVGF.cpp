@@ -30,11 +30,19 @@ bool GBufferForSVGF::initialize(RenderContext* pRenderContext, ResourceManager::
 	// Stash a copy of our resource manager so we can get rendering resources
 	mpResManager = pResManager;
 
-	// We write these texture; tell our resource manager that we expect these channels to exist
-	mpResManager->requestTextureResource("WorldPosition", ResourceFormat::RGBA32Float);
-	mpResManager->requestTextureResource("WorldNormal", ResourceFormat::RGBA16Float);
-	mpResManager->requestTextureResource("MaterialDiffuse", ResourceFormat::RGBA16Float);
-	mpResManager->requestTextureResource("MaterialSpecRough", ResourceFormat::RGBA16Float);
+	// We write these texture; tell our resource manager that we expect these channels to exist.  The compact layout
+	//    drops position, normal and material targets for one packed material target (see compactGBuffer.hlsli)
+	if (mLayout == CpuSVGF::GBufferLayout::Compact)
+	{
+		mpResManager->requestTextureResource("SVGF_PackedMaterial", ResourceFormat::RG32Uint);
+	}
+	else
+	{
+		mpResManager->requestTextureResource("WorldPosition", ResourceFormat::RGBA32Float);
+		mpResManager->requestTextureResource("WorldNormal", ResourceFormat::RGBA16Float);
+		mpResManager->requestTextureResource("MaterialDiffuse", ResourceFormat::RGBA16Float);
+		mpResManager->requestTextureResource("MaterialSpecRough", ResourceFormat::RGBA16Float);
+	}
 	mpResManager->requestTextureResource("SVGF_LinearZ");
 	mpResManager->requestTextureResource("SVGF_MotionVecs", ResourceFormat::RGBA16Float);
 	mpResManager->requestTextureResource("SVGF_CompactNormDepth");
@@ -61,6 +69,12 @@ bool GBufferForSVGF::initialize(RenderContext* pRenderContext, ResourceManager::
 	// Create our wrapper for a full-screen raster pass to clear the g-buffer
 	mpClearGBuf = FullscreenLaunch::create(kClearToEnvMap);
 
+	if (mLayout == CpuSVGF::GBufferLayout::Compact)
+	{
+		mpRaster->addDefine("COMPACT_GBUFFER");
+		mpClearGBuf->addDefine("COMPACT_GBUFFER");
+	}
+
     return true;
 }
 
@@ -75,12 +89,23 @@ void GBufferForSVGF::initScene(RenderContext* pRenderContext, Scene::SharedPtr p
 		mpRaster->setScene(mpScene);
 }
 
+void GBufferForSVGF::renderGui(Gui* pGui)
+{
+	// The layout can't change at runtime; just say which one we write and what it costs
+	char line[128];
+	snprintf(line, sizeof(line), "Layout: %s, %u bytes/pixel", CpuSVGF::getGBufferLayoutName(mLayout), CpuSVGF::getGBufferBytesPerPixel(mLayout));
+	pGui->addText(line);
+}
+
 void GBufferForSVGF::execute(RenderContext* pRenderContext)
 {
 	// Create a framebuffer for rendering.  (Creating once per frame is for simplicity, not performance).
-	Fbo::SharedPtr outputFbo = mpResManager->createManagedFbo(
-		{"WorldPosition","WorldNormal","MaterialDiffuse","MaterialSpecRough","SVGF_LinearZ","SVGF_MotionVecs","SVGF_CompactNormDepth"},
-		"Z-Buffer" );
+	//    Target order must match the GBuffer struct in gBufferSVGF.ps.hlsl.
+	Fbo::SharedPtr outputFbo = (mLayout == CpuSVGF::GBufferLayout::Compact)
+		? mpResManager->createManagedFbo({"SVGF_LinearZ","SVGF_MotionVecs","SVGF_CompactNormDepth","SVGF_PackedMaterial"}, "Z-Buffer")
+		: mpResManager->createManagedFbo(
+			{"WorldPosition","WorldNormal","MaterialDiffuse","MaterialSpecRough","SVGF_LinearZ","SVGF_MotionVecs","SVGF_CompactNormDepth"},
+			"Z-Buffer" );
 
     // Failed to create a valid FBO?  We're done.
     if (!outputFbo) return;
@@ -20,6 +20,7 @@
 #include "../SharedUtils/RenderPass.h"
 #include "../SharedUtils/RasterLaunch.h"
 #include "../SharedUtils/FullscreenLaunch.h"
+#include "../CpuSVGF/SVGFGBufferLayout.h"
 
 class GBufferForSVGF : public ::RenderPass, inherit_shared_from_this<::RenderPass, GBufferForSVGF>
 {
@@ -27,16 +28,17 @@ public:
     using SharedPtr = std::shared_ptr<GBufferForSVGF>;
     using SharedConstPtr = std::shared_ptr<const GBufferForSVGF>;
 
-    static SharedPtr create() { return SharedPtr(new GBufferForSVGF()); }
+    static SharedPtr create(CpuSVGF::GBufferLayout layout = CpuSVGF::GBufferLayout::Full) { return SharedPtr(new GBufferForSVGF(layout)); }
     virtual ~GBufferForSVGF() = default;
 
 protected:
-	GBufferForSVGF() : RenderPass("Create G-Buffer", "G-Buffer Options") {}
+	GBufferForSVGF(CpuSVGF::GBufferLayout layout) : RenderPass("Create G-Buffer", "G-Buffer Options"), mLayout(layout) {}
 
     // Implementation of RenderPass interface
     bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager) override;
     void execute(RenderContext* pRenderContext) override;
 	void initScene(RenderContext* pRenderContext, Scene::SharedPtr pScene) override;
+	void renderGui(Gui* pGui) override;
 
 	// Override some functions that provide information to the RenderPipeline class
 	bool requiresScene() override     { return true; }
@@ -49,6 +51,9 @@ protected:
 	RasterLaunch::SharedPtr     mpRaster;               ///< A wrapper managing the shader for our g-buffer creation
 	FullscreenLaunch::SharedPtr mpClearGBuf;            ///< A wrapper over the shader to clear our g-buffer to the env map
 
+	// Which targets do we write?  Fixed at creation, since the passes reading them compile their shaders to match
+	CpuSVGF::GBufferLayout      mLayout;
+
 	// What's our "background" color?
 	vec3                        mBgColor = vec3(0.5f, 0.5f, 1.0f);  ///<  Color stored into our diffuse G-buffer channel if we hit no geometry
 };
@@ -17,6 +17,8 @@
 **********************************************************************************************************************/
 
 #include "GGXGlobalIllumination.h"
+#include "glm/gtc/packing.hpp"
+#include <cstring>
 
 namespace {
 	// Where is our shaders located?
@@ -24,16 +26,18 @@ namespace {
 };
 
 
-GGXGlobalIlluminationPass::SharedPtr GGXGlobalIlluminationPass::create(const std::string &directOut, const std::string &indirectOut)
+GGXGlobalIlluminationPass::SharedPtr GGXGlobalIlluminationPass::create(const std::string &directOut, const std::string &indirectOut,
+                                                                       CpuSVGF::GBufferLayout gBufferLayout)
 {
-	return SharedPtr(new GGXGlobalIlluminationPass(directOut, indirectOut));
+	return SharedPtr(new GGXGlobalIlluminationPass(directOut, indirectOut, gBufferLayout));
 }
 
-GGXGlobalIlluminationPass::GGXGlobalIlluminationPass(const std::string &directOut, const std::string &indirectOut)
+GGXGlobalIlluminationPass::GGXGlobalIlluminationPass(const std::string &directOut, const std::string &indirectOut, CpuSVGF::GBufferLayout gBufferLayout)
 	: RenderPass("Shoot Global Illumination Rays", "Global Illumination Options")
 {
 	mDirectOutName = directOut;
 	mIndirectOutName = indirectOut;
+	mGBufferLayout = gBufferLayout;
 }
 
 bool GGXGlobalIlluminationPass::initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager)
@@ -42,10 +46,18 @@ bool GGXGlobalIlluminationPass::initialize(RenderContext* pRenderContext, Resour
 	mpResManager = pResManager;
 
 	// Let our resource manager know that we expect some input buffers
-	mpResManager->requestTextureResource("WorldPosition");     // Our fragment position, from G-buffer pass
-	mpResManager->requestTextureResource("WorldNormal");       // Our fragment normal, from G-buffer pass
-	mpResManager->requestTextureResource("MaterialDiffuse");   // Our fragment diffuse color, from G-buffer pass
-	mpResManager->requestTextureResource("MaterialSpecRough"); // Our fragment specular color, from G-buffer pass
+	if (mGBufferLayout == CpuSVGF::GBufferLayout::Compact)
+	{
+		mpResManager->requestTextureResource("SVGF_CompactNormDepth");                      // Normal and camera distance, from G-buffer pass
+		mpResManager->requestTextureResource("SVGF_PackedMaterial", ResourceFormat::RG32Uint); // Diffuse and specular color, from G-buffer pass
+	}
+	else
+	{
+		mpResManager->requestTextureResource("WorldPosition");     // Our fragment position, from G-buffer pass
+		mpResManager->requestTextureResource("WorldNormal");       // Our fragment normal, from G-buffer pass
+		mpResManager->requestTextureResource("MaterialDiffuse");   // Our fragment diffuse color, from G-buffer pass
+		mpResManager->requestTextureResource("MaterialSpecRough"); // Our fragment specular color, from G-buffer pass
+	}
 	mpResManager->requestTextureResource(ResourceManager::kEnvironmentMap);  // Our environment map
 
 	// We'll be creating some output buffers.  We store illumination and albedo separately, so we can just
@@ -57,6 +69,8 @@ bool GGXGlobalIlluminationPass::initialize(RenderContext* pRenderContext, Resour
 
 	// Create our wrapper around a ray tracing pass; specify the entry point for our ray generation shader
 	mpRays = RayLaunch::create(kFileRayTrace, "SimpleDiffuseGIRayGen");
+	if (mGBufferLayout == CpuSVGF::GBufferLayout::Compact)
+		mpRays->addDefine("COMPACT_GBUFFER");
 
 	// Add ray type 0 (in this case, our shadow ray)
 	mpRays->addMissShader(kFileRayTrace, "ShadowMiss");
@@ -66,6 +80,10 @@ bool GGXGlobalIlluminationPass::initialize(RenderContext* pRenderContext, Resour
 	mpRays->addMissShader(kFileRayTrace, "IndirectMiss");
 	mpRays->addHitShader(kFileRayTrace, "IndirectClosestHit", "IndirectAnyHit");
 
+	// The blue noise sampler's tile of ranks, built on the CPU so CpuSVGF::SampleSequence reads the same one
+	mpBlueNoise = Texture::create2D(CpuSVGF::kBlueNoiseTileSize, CpuSVGF::kBlueNoiseTileSize, ResourceFormat::R16Uint, 1, 1,
+	                                CpuSVGF::getBlueNoiseTile(), Resource::BindFlags::ShaderResource);
+
 	// Now that we've passed all our shaders in, compile and (if available) setup the scene
 	mpRays->compileRayProgram();
 	if (mpScene) mpRays->setScene(mpScene);
@@ -88,9 +106,92 @@ void GGXGlobalIlluminationPass::renderGui(Gui* pGui)
 	dirty |= (int)pGui->addCheckBox(mDoDirectGI ? "Compute direct light" : "Skipping direct light", mDoDirectGI);
 	dirty |= (int)pGui->addCheckBox(mDoIndirectGI ? "Computing indirect light" : "Skipping indirect light", mDoIndirectGI);
 
+	Gui::DropdownList samplers;
+	for (uint32_t i = 0; i < uint32_t(CpuSVGF::SamplerType::Count); i++) samplers.push_back({ i, CpuSVGF::getSamplerTypeName(CpuSVGF::SamplerType(i)) });
+	dirty |= (int)pGui->addDropdown("Sampler", samplers, mSampler);
+
+	Gui::DropdownList selections;
+	for (uint32_t i = 0; i < uint32_t(CpuSVGF::LightSelection::Count); i++) selections.push_back({ i, CpuSVGF::getLightSelectionName(CpuSVGF::LightSelection(i)) });
+	dirty |= (int)pGui->addDropdown("Light selection", selections, mLightSelection);
+	dirty |= (int)pGui->addCheckBox("Sample environment map", mSampleEnvMap);
+
 	if (dirty) setRefreshFlag();
 }
 
+void GGXGlobalIlluminationPass::updateLightTable()
+{
+	// Weights from the lights' current intensity, so the table follows lights edited in the GUI or animated
+	std::vector<float> weights(mpScene->getLightCount());
+	for (uint32_t i = 0; i < mpScene->getLightCount(); i++)
+	{
+		const LightData &data = mpScene->getLight(i)->getData();
+		weights[i] = CpuSVGF::getLightPower(data.type == LightDirectional, CpuSVGF::float3(data.intensity.x, data.intensity.y, data.intensity.z),
+		                                    data.openingAngle);
+	}
+	if (!mLightTable.update(weights) && mpLightAliasTable) return;
+
+	// One row of texels; more lights than a texture is wide fall back to uniform selection in execute()
+	const std::vector<CpuSVGF::LightAliasEntry> &entries = mLightTable.getEntries();
+	mpLightAliasTable = (entries.empty() || entries.size() > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION) ? nullptr
+	                  : Texture::create2D(uint32_t(entries.size()), 1, ResourceFormat::RGBA32Uint, 1, 1, entries.data(), Resource::BindFlags::ShaderResource);
+}
+
+void GGXGlobalIlluminationPass::updateEnvMapSampler(RenderContext* pRenderContext, const Texture::SharedPtr &pEnvMap)
+{
+	if (pEnvMap == mpEnvSamplerSource) return;
+	mpEnvSamplerSource = pEnvMap;
+	mpEnvSampler = nullptr;
+	mpEnvMarginalCdf = nullptr;
+	mpEnvConditionalCdf = nullptr;
+	if (!pEnvMap) return;
+
+	// Copy the top mip back to the CPU as floats; formats other than 8-bit and float RGBA aren't sampled
+	const uint32_t width = pEnvMap->getWidth(), height = pEnvMap->getHeight();
+	const ResourceFormat format = pEnvMap->getFormat();
+	const std::vector<uint8_t> texels = pRenderContext->readTextureSubresource(pEnvMap.get(), 0);
+	CpuSVGF::ImageF4 envMap(width, height);
+	const size_t texelCount = size_t(width) * height;
+	auto srgbToLinear = [](float c) { return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f); };
+	if (format == ResourceFormat::RGBA32Float && texels.size() >= texelCount * 16)
+	{
+		std::memcpy(envMap.getData(), texels.data(), texelCount * 16);
+	}
+	else if (format == ResourceFormat::RGBA16Float && texels.size() >= texelCount * 8)
+	{
+		const uint16_t *pHalves = reinterpret_cast<const uint16_t *>(texels.data());
+		for (size_t i = 0; i < texelCount; i++)
+		{
+			const uint16_t *h = pHalves + 4 * i;
+			envMap.getData()[i] = CpuSVGF::float4(glm::unpackHalf1x16(h[0]), glm::unpackHalf1x16(h[1]), glm::unpackHalf1x16(h[2]), 1.0f);
+		}
+	}
+	else if ((format == ResourceFormat::RGBA8Unorm || format == ResourceFormat::RGBA8UnormSrgb ||
+	          format == ResourceFormat::BGRA8Unorm || format == ResourceFormat::BGRA8UnormSrgb) && texels.size() >= texelCount * 4)
+	{
+		const bool srgb = isSrgbFormat(format);
+		const bool bgra = format == ResourceFormat::BGRA8Unorm || format == ResourceFormat::BGRA8UnormSrgb;
+		for (size_t i = 0; i < texelCount; i++)
+		{
+			float c[3];
+			for (int k = 0; k < 3; k++)
+			{
+				c[k] = float(texels[4 * i + k]) / 255.0f;
+				if (srgb) c[k] = srgbToLinear(c[k]);
+			}
+			envMap.getData()[i] = bgra ? CpuSVGF::float4(c[2], c[1], c[0], 1.0f) : CpuSVGF::float4(c[0], c[1], c[2], 1.0f);
+		}
+	}
+	else
+	{
+		return;   // No tables; indirect rays sample the BRDF alone
+	}
+
+	mpEnvSampler = CpuSVGF::EnvMapSampler::createCached(envMap, mEnvMapCacheDir);
+	if (!mpEnvSampler) return;
+	mpEnvMarginalCdf    = Texture::create2D(height, 1, ResourceFormat::R32Float, 1, 1, mpEnvSampler->getMarginalCdf(), Resource::BindFlags::ShaderResource);
+	mpEnvConditionalCdf = Texture::create2D(width, height, ResourceFormat::R32Float, 1, 1, mpEnvSampler->getConditionalCdf(), Resource::BindFlags::ShaderResource);
+}
+
 void GGXGlobalIlluminationPass::execute(RenderContext* pRenderContext)
 {
 	// Get explicit pointers to the output buffers we're writing into.   (And clear them before returning the pointers.)
@@ -106,12 +207,46 @@ void GGXGlobalIlluminationPass::execute(RenderContext* pRenderContext)
 	auto rayGenVars = mpRays->getRayGenVars();
 	rayGenVars["RayGenCB"]["gMinT"]         = mpResManager->getMinTDist();
 	rayGenVars["RayGenCB"]["gFrameCount"]   = mFrameCount++;
+	rayGenVars["RayGenCB"]["gSampleIndex"]  = mSampleIndex++;
+	rayGenVars["RayGenCB"]["gSampler"]      = mSampler;
+	rayGenVars["gBlueNoise"]                = mpBlueNoise;
+
+	// The alias table only has to be current when it is read
+	uint32_t lightSelection = uint32_t(CpuSVGF::LightSelection::Uniform);
+	if (mpScene && mDoDirectGI && mLightSelection == uint32_t(CpuSVGF::LightSelection::Power))
+	{
+		updateLightTable();
+		if (mpLightAliasTable) lightSelection = mLightSelection;
+	}
+	rayGenVars["RayGenCB"]["gLightSelection"] = lightSelection;
+	rayGenVars["gLightAliasTable"]          = mpLightAliasTable;
+
+	// Likewise the environment map's sampling tables
+	Texture::SharedPtr pEnvMap = mpResManager->getTexture(ResourceManager::kEnvironmentMap);
+	bool sampleEnvMap = false;
+	if (mDoIndirectGI && mSampleEnvMap)
+	{
+		updateEnvMapSampler(pRenderContext, pEnvMap);
+		sampleEnvMap = mpEnvSampler != nullptr;
+	}
+	rayGenVars["RayGenCB"]["gSampleEnvMap"] = sampleEnvMap;
+	rayGenVars["gEnvMarginalCdf"]           = mpEnvMarginalCdf;
+	rayGenVars["gEnvConditionalCdf"]        = mpEnvConditionalCdf;
 	rayGenVars["RayGenCB"]["gDoIndirectGI"] = mDoIndirectGI;
 	rayGenVars["RayGenCB"]["gDoDirectGI"]   = mDoDirectGI;
-	rayGenVars["gPos"]         = mpResManager->getTexture("WorldPosition");
-	rayGenVars["gNorm"]        = mpResManager->getTexture("WorldNormal");
-	rayGenVars["gDiffuseMatl"] = mpResManager->getTexture("MaterialDiffuse");
-	rayGenVars["gSpecMatl"]    = mpResManager->getTexture("MaterialSpecRough");
+	if (mGBufferLayout == CpuSVGF::GBufferLayout::Compact)
+	{
+		rayGenVars["gCompactNormDepth"] = mpResManager->getTexture("SVGF_CompactNormDepth");
+		rayGenVars["gPackedMatl"]       = mpResManager->getTexture("SVGF_PackedMaterial");
+		rayGenVars["gEnvMap"]           = mpResManager->getTexture(ResourceManager::kEnvironmentMap);   // Background color
+	}
+	else
+	{
+		rayGenVars["gPos"]         = mpResManager->getTexture("WorldPosition");
+		rayGenVars["gNorm"]        = mpResManager->getTexture("WorldNormal");
+		rayGenVars["gDiffuseMatl"] = mpResManager->getTexture("MaterialDiffuse");
+		rayGenVars["gSpecMatl"]    = mpResManager->getTexture("MaterialSpecRough");
+	}
 	rayGenVars["gDirectOut"]   = pDirectDstTex;
 	rayGenVars["gIndirectOut"] = pIndirectDstTex;
 	rayGenVars["gOutAlbedo"]   = pOutAlbedoTex;
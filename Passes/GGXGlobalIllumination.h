@@ -20,6 +20,10 @@
 #include "../SharedUtils/RenderPass.h"
 #include "../SharedUtils/SimpleVars.h"
 #include "../SharedUtils/RayLaunch.h"
+#include "../CpuSVGF/SVGFEnvMapSampler.h"
+#include "../CpuSVGF/SVGFGBufferLayout.h"
+#include "../CpuSVGF/SVGFLightSampler.h"
+#include "../CpuSVGF/SVGFSampler.h"
 
 class GGXGlobalIlluminationPass : public ::RenderPass, inherit_shared_from_this<::RenderPass, GGXGlobalIlluminationPass>
 {
@@ -27,11 +31,12 @@ public:
     using SharedPtr = std::shared_ptr<GGXGlobalIlluminationPass>;
     using SharedConstPtr = std::shared_ptr<const GGXGlobalIlluminationPass>;
 
-	static SharedPtr create(const std::string &directOut, const std::string &indirectOut);
+	static SharedPtr create(const std::string &directOut, const std::string &indirectOut,
+	                        CpuSVGF::GBufferLayout gBufferLayout = CpuSVGF::GBufferLayout::Full);
     virtual ~GGXGlobalIlluminationPass() = default;
 
 protected:
-	GGXGlobalIlluminationPass(const std::string &directOut, const std::string &indirectOut);
+	GGXGlobalIlluminationPass(const std::string &directOut, const std::string &indirectOut, CpuSVGF::GBufferLayout gBufferLayout);
 
     // Implementation of RenderPass interface
     bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager) override;
@@ -56,6 +61,33 @@ protected:
 	std::string                             mDirectOutName;
 	std::string                             mIndirectOutName;
 
+	// Which G-buffer layout do we read?  Must match the layout GBufferForSVGF was created with
+	CpuSVGF::GBufferLayout                  mGBufferLayout;
+
+	// Where the random numbers come from (a CpuSVGF::SamplerType), and the blue noise tile that sampler reads
+	uint32_t                                mSampler = uint32_t(CpuSVGF::SamplerType::WhiteNoise);
+	Texture::SharedPtr                      mpBlueNoise;
+
+	// How the light for direct lighting is picked (a CpuSVGF::LightSelection), and the alias table of the lights'
+	//     power, rebuilt and uploaded only when the lights change
+	uint32_t                                mLightSelection = uint32_t(CpuSVGF::LightSelection::Power);
+	CpuSVGF::LightAliasTable                mLightTable;
+	Texture::SharedPtr                      mpLightAliasTable;
+
+	void updateLightTable();
+
+	// Importance sampling of the environment map for indirect rays.  The tables are built on the CPU from a copy of
+	//     the map, or loaded from mEnvMapCacheDir, whenever the environment map texture changes.
+	bool                                    mSampleEnvMap = true;
+	std::string                             mEnvMapCacheDir;          ///< Empty:  the working directory
+	Texture::SharedPtr                      mpEnvSamplerSource;       ///< The environment map the tables below are for
+	CpuSVGF::EnvMapSampler::SharedPtr       mpEnvSampler;             ///< nullptr if the map is black or in a format we can't read
+	Texture::SharedPtr                      mpEnvMarginalCdf;
+	Texture::SharedPtr                      mpEnvConditionalCdf;
+
+	void updateEnvMapSampler(RenderContext* pRenderContext, const Texture::SharedPtr &pEnvMap);
+
 	// Various internal parameters
 	uint32_t                                mFrameCount = 0x1337u;  ///< A frame counter to vary random numbers over time
+	uint32_t                                mSampleIndex = 0;       ///< Frames since the first, to index the blue noise and Sobol sequences
 };
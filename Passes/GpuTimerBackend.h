@@ -0,0 +1,65 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include "Falcor.h"
+#include "../CpuSVGF/SVGFStageTimer.h"
+
+/** Times StageTimer stages with GPU timestamp queries.  Like Falcor's profiler, each stage alternates between two
+    GpuTimers, so results are read back the frame after they were recorded and never stall the GPU.  A stage
+    may only be timed once per frame.  Shared by the passes that time their stages (SVGFPass, TemporalAAPass).
+*/
+class GpuTimerBackend : public CpuSVGF::TimerBackend
+{
+public:
+	void begin(uint32_t stage) override
+	{
+		if (stage >= mStages.size()) mStages.resize(stage + 1);
+		Stage &s = mStages[stage];
+		if (!s.timers[mFrame & 1]) s.timers[mFrame & 1] = GpuTimer::create();
+		s.timers[mFrame & 1]->begin();
+	}
+
+	void end(uint32_t stage) override
+	{
+		if (stage >= mStages.size() || !mStages[stage].timers[mFrame & 1]) return;
+		mStages[stage].timers[mFrame & 1]->end();
+		mStages[stage].recorded[mFrame & 1] = true;
+	}
+
+	bool resolve(uint32_t stage, double &ms) override
+	{
+		const uint32_t previous = (mFrame & 1) ^ 1;
+		if (stage >= mStages.size() || !mStages[stage].recorded[previous]) return false;
+		ms = mStages[stage].timers[previous]->getElapsedTime();
+		mStages[stage].recorded[previous] = false;
+		return true;
+	}
+
+	void endFrame() override { mFrame++; }
+
+private:
+	struct Stage
+	{
+		GpuTimer::SharedPtr timers[2];
+		bool                recorded[2] = { false, false };
+	};
+
+	std::vector<Stage> mStages;
+	uint64_t           mFrame = 0;
+};
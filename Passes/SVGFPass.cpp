@@ -20,6 +20,7 @@
 //       http://research.nvidia.com/publication/2017-07_Spatiotemporal-Variance-Guided-Filtering%3A
 
 #include "SVGFPass.h"
+#include "GpuTimerBackend.h"
 
 namespace {
 	// Where is our shaders located?
@@ -28,6 +29,32 @@ namespace {
 	const char *kModulateShader          = "SVGF\\SVGFModulate.ps.hlsl";
 	const char *kFilterMomentShader      = "SVGF\\SVGFFilterMoments.ps.hlsl";
 	const char *kCombineUnfilteredShader = "SVGF\\SVGFCombineUnfiltered.ps.hlsl";
+	const char *kClearRegionShader       = "SVGF\\SVGFClearRegion.ps.hlsl";
+
+	// Render target formats for each SVGFPass::StorageFormat.  A format of Unknown means the target isn't used.
+	struct StorageFormatDesc
+	{
+		const char     *name;
+		ResourceFormat  color;          // illumination color, with the variance in alpha unless variance is used
+		ResourceFormat  variance;       // separate variance target when the color has no alpha
+		ResourceFormat  moments;        // luminance moments; both pairs, or the direct pair if momentsIndirect is used
+		ResourceFormat  momentsIndirect;
+		ResourceFormat  historyLength;
+		uint32_t        colorBytes, varianceBytes, momentsBytes, historyBytes;
+	};
+
+	const StorageFormatDesc kStorageFormats[] =
+	{
+		{ "Full (RGBA32F)",       ResourceFormat::RGBA32Float,    ResourceFormat::Unknown,  ResourceFormat::RGBA32Float, ResourceFormat::Unknown,   ResourceFormat::R16Float, 16, 0, 16, 2 },
+		{ "Half (RGBA16F)",       ResourceFormat::RGBA16Float,    ResourceFormat::Unknown,  ResourceFormat::RGBA16Float, ResourceFormat::Unknown,   ResourceFormat::R16Float,  8, 0,  8, 2 },
+		{ "Compact (R11G11B10F)", ResourceFormat::R11G11B10Float, ResourceFormat::R16Float, ResourceFormat::RG16Float,   ResourceFormat::RG16Float, ResourceFormat::R8Unorm,   4, 2,  8, 1 },
+	};
+
+	// Our intermediate render targets, keyed by format in the target pool
+	Texture::SharedPtr createTarget(uint32_t format, uint32_t width, uint32_t height)
+	{
+		return Texture::create2D(width, height, ResourceFormat(format), 1, 1, nullptr, Resource::BindFlags::ShaderResource | Resource::BindFlags::RenderTarget);
+	}
 };
 
 SVGFPass::SharedPtr SVGFPass::create(const std::string &directIn, const std::string &indirectIn, const std::string &outChannel)
@@ -36,7 +63,7 @@ SVGFPass::SharedPtr SVGFPass::create(const std::string &directIn, const std::str
 }
 
 SVGFPass::SVGFPass(const std::string &directIn, const std::string &indirectIn, const std::string &outChannel)
-	: RenderPass( "Spatiotemporal Filter (SVGF)", "SVGF Options" )
+	: RenderPass( "Spatiotemporal Filter (SVGF)", "SVGF Options" ), mTargetPool(createTarget)
 {
 	mDirectInTexName   = directIn;
 	mIndirectInTexName = indirectIn;
@@ -49,8 +76,8 @@ bool SVGFPass::initialize(RenderContext* pRenderContext, ResourceManager::Shared
 	mpResManager = pResManager;
 
 	// Set our input textures / resources.  These are managed by our resource manager, and are
-	//    created each frame by earlier render passes.
-	mpResManager->requestTextureResource("WorldPosition");
+	//    created each frame by earlier render passes.  Only the SVGF_* G-buffer targets are read, so this works
+	//    with either G-buffer layout (see CpuSVGF::GBufferLayout).
 	mpResManager->requestTextureResource(mDirectInTexName);
 	mpResManager->requestTextureResource(mIndirectInTexName);
 	mpResManager->requestTextureResource("SVGF_LinearZ");
@@ -67,10 +94,22 @@ bool SVGFPass::initialize(RenderContext* pRenderContext, ResourceManager::Shared
 
 	// Setup our filter shaders
 	mpReprojection      = FullscreenLaunch::create(kReprojectShader);
-	mpAtrous            = FullscreenLaunch::create(kAtrousShader);
 	mpModulate          = FullscreenLaunch::create(kModulateShader);
 	mpFilterMoments     = FullscreenLaunch::create(kFilterMomentShader);
 	mpCombineUnfiltered = FullscreenLaunch::create(kCombineUnfilteredShader);
+	mpClearRegion       = FullscreenLaunch::create(kClearRegionShader);
+
+	// Time each stage on the GPU.  Register them in pipeline order so the GUI lists them that way.
+	mpStageTimer = CpuSVGF::StageTimer::create(std::make_shared<GpuTimerBackend>());
+	mStageIds.reprojection      = mpStageTimer->getStageId("reprojection");
+	mStageIds.filterMoments     = mpStageTimer->getStageId("filter moments");
+	for (int i = 0; i < mFilterIterations; i++) getAtrousStageId(i);
+	mStageIds.feedbackBlit      = mpStageTimer->getStageId("feedback blit");
+	mStageIds.modulation        = mpStageTimer->getStageId("modulation");
+	mStageIds.outputBlit        = mpStageTimer->getStageId("output blit");
+	mStageIds.linearZCopy       = mpStageTimer->getStageId("linear z copy");
+	mStageIds.combineUnfiltered = mpStageTimer->getStageId("combine unfiltered");
+	mStageIds.total             = mpStageTimer->getStageId("total");
 
 	// Our GUI needs more space than other passes, so enlarge the GUI window.
 	setGuiSize(ivec2(250, 350));
@@ -83,56 +122,137 @@ void SVGFPass::resize(uint32_t width, uint32_t height)
 	// Skip if we're resizing to 0 width or height.
 	if (width <= 0 || height <= 0) return;
 
+	mWidth        = width;
+	mHeight       = height;
+	mNeedFboClear = true;
+
+	// Keep our targets while they are a good fit for the new size (see CpuSVGF::isGoodFit); only the region changes
+	const uint32_t layout = mStorageFormat | (mBlitFree ? 0x100u : 0u);
+	bool keep = !mTargets.empty() && layout == mTargetLayout;
+	for (const TargetPool::Allocation &target : mTargets)
+		keep = keep && CpuSVGF::isGoodFit(target.width, target.height, width, height);
+	if (keep) return;
+
+	// Hand our targets back to the pool; the ones below reuse any of the same format and size class
+	for (TargetPool::Allocation &target : mTargets) mTargetPool.release(target);
+	mTargets.clear();
+	mTargetLayout = layout;
+
 	// Have 3 different types of framebuffers and resources.  Reallocate them whenever screen resolution changes.
 
-	{   // Type 1, Screen-size FBOs with 2 RGBA32F MRTs
-		Fbo::Desc desc;
-		desc.setSampleCount(0);
-		desc.setColorTarget(0, ResourceFormat::RGBA32Float);
-		desc.setColorTarget(1, ResourceFormat::RGBA32Float);
-		mpPingPongFbo[0]  = FboHelper::create2D(width, height, desc);
-		mpPingPongFbo[1]  = FboHelper::create2D(width, height, desc);
-		mpFilteredPastFbo = FboHelper::create2D(width, height, desc);
+	const StorageFormatDesc &format = kStorageFormats[mStorageFormat];
+	const bool compact = (format.variance != ResourceFormat::Unknown);
+	const ResourceFormat variance = compact ? format.variance : ResourceFormat::Unknown;
+
+	{   // Type 1, Screen-size FBOs with 2 MRTs (RGBA32F by default), plus 2 for the variance in compact storage
+		if (!mBlitFree)
+			mpFilteredPastFbo = createPooledFbo(width, height, { format.color, format.color });   // Reprojection never reads its variance
+
+		mpPingPongFbo[0]  = createPooledFbo(width, height, { format.color, format.color, variance, variance });
+		mpPingPongFbo[1]  = createPooledFbo(width, height, { format.color, format.color, variance, variance });
+
+		// Blit-free, the feedback iteration renders into the filtered past and the next iteration reads all of it
+		if (mBlitFree)
+			mpFilteredPastFbo = createPooledFbo(width, height, { format.color, format.color, variance, variance });
 	}
 
-	{   // Type 2, Screen-size FBOs with 4 MRTs, 3 that are RGBA32F, one that is R16F
-		Fbo::Desc desc;
-		desc.setSampleCount(0);
-		desc.setColorTarget(0, Falcor::ResourceFormat::RGBA32Float); // direct
-		desc.setColorTarget(1, Falcor::ResourceFormat::RGBA32Float); // indirect
-		desc.setColorTarget(2, Falcor::ResourceFormat::RGBA32Float); // moments
-		desc.setColorTarget(3, Falcor::ResourceFormat::R16Float);    // history length
-		mpCurReprojFbo  = FboHelper::create2D(width, height, desc);
-		mpPrevReprojFbo = FboHelper::create2D(width, height, desc);
+	{   // Type 2, Screen-size FBOs with 4 MRTs (by default 3 that are RGBA32F, one that is R16F), 7 in compact storage
+		const std::vector<ResourceFormat> formats =
+		{
+			format.color,                                                        // direct
+			format.color,                                                        // indirect
+			format.moments,                                                      // moments
+			format.historyLength,                                                // history length
+			variance,                                                            // direct variance
+			variance,                                                            // indirect variance
+			compact ? format.momentsIndirect : ResourceFormat::Unknown,          // indirect moments
+			mBlitFree ? ResourceFormat::RGBA32Float : ResourceFormat::Unknown,   // linear z, the previous frame's once swapped
+		};
+		mpCurReprojFbo  = createPooledFbo(width, height, formats);
+		mpPrevReprojFbo = createPooledFbo(width, height, formats);
 	}
 
-	{   // Type 3, Screen-size FBOs with 1 RGBA32F buffer
-		Fbo::Desc desc;
-		desc.setColorTarget(0, Falcor::ResourceFormat::RGBA32Float);
-		mpOutputFbo = FboHelper::create2D(width, height, desc);
+	{   // Type 3, Screen-size FBOs with 1 RGBA32F buffer.  Blit-free, we render straight into our output channel.
+		mpOutputFbo = mBlitFree ? nullptr : createPooledFbo(width, height, { ResourceFormat::RGBA32Float });
 	}
 
 	// We're manually keeping a copy of our linear Z G-buffers from frame N for use in rendering frame N+1
-	mInputTex.prevLinearZ = Texture::create2D(width, height, ResourceFormat::RGBA32Float, 1, 1, nullptr, Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess | Resource::BindFlags::RenderTarget);
+	//    (blit-free, the reprojection FBOs hold it instead)
+	mpPrevLinearZFbo      = mBlitFree ? nullptr : createPooledFbo(width, height, { ResourceFormat::RGBA32Float });
+	mInputTex.prevLinearZ = mBlitFree ? nullptr : mpPrevLinearZFbo->getColorTexture(0);
 
-	mNeedFboClear = true;
+	// Keep released targets for going back to an earlier size, but no more than our largest set, so size classes
+	//    left for good don't pile up
+	mTargetPool.trim(mTargetPool.getStats().liveHighWaterBytes);
+}
+
+Fbo::SharedPtr SVGFPass::createPooledFbo(uint32_t width, uint32_t height, const std::vector<ResourceFormat> &formats)
+{
+	Fbo::SharedPtr pFbo = Fbo::create();
+	for (uint32_t i = 0; i < uint32_t(formats.size()); i++)
+	{
+		if (formats[i] == ResourceFormat::Unknown) continue;
+		mTargets.push_back(mTargetPool.acquire(uint32_t(formats[i]), getFormatBytesPerBlock(formats[i]), width, height));
+		pFbo->attachColorTarget(mTargets.back().resource, i);
+	}
+	return pFbo;
+}
+
+void SVGFPass::setTargetFbo(const Fbo::SharedPtr &pFbo)
+{
+	mpSvgfState->setFbo(pFbo);
+	mpSvgfState->setViewport(0, GraphicsState::Viewport(0.0f, 0.0f, float(mWidth), float(mHeight), 0.0f, 1.0f), true);
+}
+
+void SVGFPass::clearRegion(RenderContext* pCtx, const Fbo::SharedPtr &pFbo, const vec4 &color, const vec4 &linearZ)
+{
+	auto clearVars = mpClearRegion->getVars();
+	clearVars["PerImageCB"]["gClearColor"]   = color;
+	clearVars["PerImageCB"]["gClearLinearZ"] = linearZ;
+	setTargetFbo(pFbo);
+	mpClearRegion->execute(pCtx, mpSvgfState);
 }
 
 void SVGFPass::clearFbos(RenderContext* pCtx)
 {
-	// Clear our FBOs
-	pCtx->clearFbo(mpPrevReprojFbo.get(), glm::vec4(0), 1.0f, 0, FboAttachmentType::All);
-	pCtx->clearFbo(mpCurReprojFbo.get(), glm::vec4(0), 1.0f, 0, FboAttachmentType::All);
-	pCtx->clearFbo(mpFilteredPastFbo.get(), glm::vec4(0), 1.0f, 0, FboAttachmentType::All);
-	pCtx->clearFbo(mpPingPongFbo[0].get(), glm::vec4(0), 1.0f, 0, FboAttachmentType::All);
-	pCtx->clearFbo(mpPingPongFbo[1].get(), glm::vec4(0), 1.0f, 0, FboAttachmentType::All);
+	// Clear the filter region of our FBOs.  The pooled targets can be larger, and the shaders skip every tap outside
+	//    the region, so what lies beyond it is never read.
+	for (const Fbo::SharedPtr &pFbo : { mpPrevReprojFbo, mpCurReprojFbo, mpFilteredPastFbo, mpPingPongFbo[0], mpPingPongFbo[1] })
+		clearRegion(pCtx, pFbo, vec4(0.f), vec4(0.f, 0.f, 0.f, 1.f));
 
-	// Clear our history textures
-	pCtx->clearUAV(mInputTex.prevLinearZ->getUAV().get(), vec4(0.f, 0.f, 0.f, 1.f));
+	// Clear our history textures (blit-free, linear z is attachment 7 of the reprojection FBOs, cleared above)
+	if (!mBlitFree)
+		clearRegion(pCtx, mpPrevLinearZFbo, vec4(0.f, 0.f, 0.f, 1.f), vec4(0.f, 0.f, 0.f, 1.f));
+	mFilteredPastInReproj = false;
 
 	mNeedFboClear = false;
 }
 
+uint32_t SVGFPass::getFilterStateBytesPerPixel() const
+{
+	const StorageFormatDesc &format = kStorageFormats[mStorageFormat];
+	const uint32_t illum = format.colorBytes + format.varianceBytes;
+
+	if (mBlitFree)
+	{
+		return 2 * 2 * illum                                                    // ping-pong
+		     + 2 * illum                                                        // filtered past, with variance
+		     + 2 * (2 * illum + format.momentsBytes + format.historyBytes + 16); // current and previous reprojection, with linear z
+	}
+
+	return 2 * 2 * illum                                                        // ping-pong
+	     + 2 * format.colorBytes                                                // filtered past
+	     + 2 * (2 * illum + format.momentsBytes + format.historyBytes)          // current and previous reprojection
+	     + 16 + 16;                                                             // previous linear z and output
+}
+
+uint32_t SVGFPass::getAtrousStageId(int i)
+{
+	while (int(mStageIds.atrous.size()) <= i)
+		mStageIds.atrous.push_back(mpStageTimer->getStageId("a-trous " + std::to_string(mStageIds.atrous.size())));
+	return mStageIds.atrous[i];
+}
+
 void SVGFPass::renderGui(Gui* pGui)
 {
 	// Commented out GUI fields don't currently work with the current SVGF implementation
@@ -162,6 +282,68 @@ void SVGFPass::renderGui(Gui* pGui)
 	dirty |= (int)pGui->addFloatVar("Alpha", mAlpha, 0.0f, 1.0f, 0.001f);
 	dirty |= (int)pGui->addFloatVar("Moments Alpha", mMomentsAlpha, 0.0f, 1.0f, 0.001f);
 
+	pGui->addText("");
+	pGui->addText("Parameters tuned offline (SVGFCli tune)");
+	std::string presetPath;
+	if (pGui->addButton("Load preset") && openFileDialog("SVGF presets\0*.txt;*.svgfpreset\0All files\0*.*\0\0", presetPath))
+		dirty |= (int)loadPreset(presetPath);
+
+	pGui->addText("");
+	pGui->addText("Storage for history and ping-pong buffers");
+	Gui::DropdownList formats;
+	for (uint32_t i = 0; i < arraysize(kStorageFormats); i++) formats.push_back({ i, kStorageFormats[i].name });
+	if (pGui->addDropdown("Storage", formats, mStorageFormat) && mpPingPongFbo[0])
+	{
+		// Reallocate our buffers in the new format; this also drops the temporal history
+		resize(mWidth, mHeight);
+		dirty = 1;
+	}
+
+	if (pGui->addCheckBox("Blit-free output & feedback", mBlitFree) && mpPingPongFbo[0])
+	{
+		// Our attachments change; this also drops the temporal history
+		resize(mWidth, mHeight);
+		dirty = 1;
+	}
+
+	pGui->addText("");
+	pGui->addText("Which channels does the a-trous filter,");
+	pGui->addText("    and with how many taps?");
+	Gui::DropdownList atrousChannels = { { 3, "Direct & indirect" }, { 1, "Direct only" }, { 2, "Indirect only" } };
+	Gui::DropdownList atrousRadii    = { { 2, "5x5" }, { 1, "3x3" } };
+	dirty |= (int)pGui->addDropdown("Filtered", atrousChannels, mAtrousChannels);
+	dirty |= (int)pGui->addDropdown("Kernel", atrousRadii, mAtrousRadius);
+
+	if (mpPingPongFbo[0])
+	{
+		const uint32_t bytesPerPixel = getFilterStateBytesPerPixel();
+		const double   megabytes     = double(bytesPerPixel) * mWidth * mHeight / (1024.0 * 1024.0);
+		pGui->addText((std::string("    ") + std::to_string(bytesPerPixel) + " bytes/pixel, " + std::to_string(int(megabytes + 0.5)) + " MB").c_str());
+
+		const CpuSVGF::ResourcePoolStats &pool = mTargetPool.getStats();
+		char line[128];
+		snprintf(line, sizeof(line), "    pool: %.0f MB in use, %.0f MB free, peak %.0f MB", pool.liveBytes / (1024.0 * 1024.0),
+		         pool.freeBytes / (1024.0 * 1024.0), pool.highWaterBytes / (1024.0 * 1024.0));
+		pGui->addText(line);
+		snprintf(line, sizeof(line), "    %llu allocations, %llu reuses", (unsigned long long)pool.allocations, (unsigned long long)pool.reuses);
+		pGui->addText(line);
+	}
+
+	pGui->addText("");
+	pGui->addCheckBox("Show stage timings", mShowStageTimings);
+	if (mShowStageTimings && mpStageTimer)
+	{
+		pGui->addText("    GPU ms:       avg     min     p99");
+		for (uint32_t i = 0; i < mpStageTimer->getStageCount(); i++)
+		{
+			if (!mpStageTimer->isActive(i)) continue;
+			CpuSVGF::StageTimer::Stats stats = mpStageTimer->getStats(i);
+			char line[128];
+			snprintf(line, sizeof(line), "    %-18s %7.3f %7.3f %7.3f", mpStageTimer->getStageName(i).c_str(), stats.avgMs, stats.minMs, stats.p99Ms);
+			pGui->addText(line);
+		}
+	}
+
 	if (dirty)
 	{
         // Flag to the renderer that options that affect the rendering have changed.
@@ -169,6 +351,34 @@ void SVGFPass::renderGui(Gui* pGui)
 	}
 }
 
+bool SVGFPass::loadPreset(const std::string &path)
+{
+	CpuSVGF::FilterPreset preset;
+	preset.filterIterations = mFilterIterations;
+	preset.feedbackTap      = mFeedbackTap;
+	preset.phiColor         = mPhiColor;
+	preset.phiNormal        = mPhiNormal;
+	preset.alpha            = mAlpha;
+	preset.momentsAlpha     = mMomentsAlpha;
+
+	std::string error;
+	if (!CpuSVGF::loadPreset(path, preset, error))
+	{
+		logWarning("SVGFPass:  " + error);
+		return false;
+	}
+
+	// Keep to the ranges of the GUI sliders
+	mFilterIterations = glm::clamp(preset.filterIterations, 2, 10);
+	mFeedbackTap      = glm::clamp(preset.feedbackTap, -1, mFilterIterations - 2);
+	mPhiColor         = glm::clamp(preset.phiColor, 0.0f, 10000.0f);
+	mPhiNormal        = glm::max(preset.phiNormal, 0.001f);
+	mAlpha            = glm::clamp(preset.alpha, 0.0f, 1.0f);
+	mMomentsAlpha     = glm::clamp(preset.momentsAlpha, 0.0f, 1.0f);
+	setRefreshFlag();
+	return true;
+}
+
 void SVGFPass::execute(RenderContext* pRenderContext)
 {
 	// Ensure we have received information about our rendering state, or we can't render.
@@ -178,6 +388,8 @@ void SVGFPass::execute(RenderContext* pRenderContext)
 	Texture::SharedPtr pDst = mpResManager->getTexture(mOutTexName);
 	if (!pDst) return;
 
+	mpStageTimer->begin(mStageIds.total);
+
 	// Do we need to clear our internal framebuffers?  If so, do it.
 	if (mNeedFboClear) clearFbos(pRenderContext);
 
@@ -193,6 +405,9 @@ void SVGFPass::execute(RenderContext* pRenderContext)
 
 	if (mFilterEnabled)
 	{
+		// Where the last iteration (or modulation) renders.  Blit-free, that's our output channel.
+		mpFinalFbo = mBlitFree ? mpResManager->createManagedFbo({ mOutTexName }) : mpOutputFbo;
+
 		// Perform the major passes in SVGF filtering
 		computeReprojection(pRenderContext);
 		computeVarianceEstimate(pRenderContext);
@@ -203,26 +418,41 @@ void SVGFPass::execute(RenderContext* pRenderContext)
 			computeModulation(pRenderContext);
 
 		// Output the result of SVGF to the expected output buffer for subsequent passes.
-		pRenderContext->blit(mpOutputFbo->getColorTexture(0)->getSRV(), pDst->getRTV());
+		if (!mBlitFree)
+		{
+			mpStageTimer->begin(mStageIds.outputBlit);
+			pRenderContext->blit(mpOutputFbo->getColorTexture(0)->getSRV(), pDst->getRTV(), getRegionRect(), getRegionRect());
+			mpStageTimer->end(mStageIds.outputBlit);
+		}
 
 		// Swap resources so we're ready for next frame.
 		std::swap(mpCurReprojFbo, mpPrevReprojFbo);
-		pRenderContext->blit(mInputTex.linearZ->getSRV(), mInputTex.prevLinearZ->getRTV());
+		if (mBlitFree)
+		{
+			// Without a feedback tap, the reprojected color we just swapped out is next frame's filtered past
+			mFilteredPastInReproj = (mFeedbackTap < 0 || mFilterIterations <= 0);
+		}
+		else
+		{
+			mpStageTimer->begin(mStageIds.linearZCopy);
+			pRenderContext->blit(mInputTex.linearZ->getSRV(), mInputTex.prevLinearZ->getRTV(), getRegionRect(), getRegionRect());
+			mpStageTimer->end(mStageIds.linearZCopy);
+		}
 
 		// jfgagnon
 		switch (mShowIntermediateBuffer)
 		{
 		// temporal reprojection direct
-		case 0: pRenderContext->blit(mpCurReprojFbo->getColorTexture(0)->getSRV(), pDst->getRTV()); break;
+		case 0: pRenderContext->blit(mpCurReprojFbo->getColorTexture(0)->getSRV(), pDst->getRTV(), getRegionRect(), getRegionRect()); break;
 
 		// temporal reprojection indirect
-		case 1: pRenderContext->blit(mpCurReprojFbo->getColorTexture(1)->getSRV(), pDst->getRTV()); break;
+		case 1: pRenderContext->blit(mpCurReprojFbo->getColorTexture(1)->getSRV(), pDst->getRTV(), getRegionRect(), getRegionRect()); break;
 
 		// temporal reprojection moments
-		case 2: pRenderContext->blit(mpCurReprojFbo->getColorTexture(2)->getSRV(), pDst->getRTV()); break;
+		case 2: pRenderContext->blit(mpCurReprojFbo->getColorTexture(2)->getSRV(), pDst->getRTV(), getRegionRect(), getRegionRect()); break;
 
 		// temporal reprojection history length
-		case 3: pRenderContext->blit(mpCurReprojFbo->getColorTexture(3)->getSRV(), pDst->getRTV()); break;
+		case 3: pRenderContext->blit(mpCurReprojFbo->getColorTexture(3)->getSRV(), pDst->getRTV(), getRegionRect(), getRegionRect()); break;
 
 		// nothing to do
 		default: break;
@@ -238,9 +468,13 @@ void SVGFPass::execute(RenderContext* pRenderContext)
 		vars["gIndirect"]    = mInputTex.indirectIllum;
 		vars["gDirAlbedo"]   = mInputTex.dirAlbedo;
 		vars["gIndirAlbedo"] = mInputTex.indirAlbedo;
-		mpSvgfState->setFbo(mpResManager->createManagedFbo({ mOutTexName }));
+		setTargetFbo(mpResManager->createManagedFbo({ mOutTexName }));
+		CpuSVGF::StageTimer::Scope scope(mpStageTimer.get(), mStageIds.combineUnfiltered);
 		mpCombineUnfiltered->execute(pRenderContext, mpSvgfState);
 	}
+
+	mpStageTimer->end(mStageIds.total);
+	mpStageTimer->endFrame();
 }
 
 
@@ -250,21 +484,24 @@ void SVGFPass::computeReprojection(RenderContext* pRenderContext)
 	// Setup textures for our reprojection shader pass
 	auto reproVars = mpReprojection->getVars();
 	reproVars["gLinearZ"]       = mInputTex.linearZ;
-	reproVars["gPrevLinearZ"]   = mInputTex.prevLinearZ;
+	reproVars["gPrevLinearZ"]   = mBlitFree ? mpPrevReprojFbo->getColorTexture(7) : mInputTex.prevLinearZ;
 	reproVars["gMotion"]        = mInputTex.motionVecs;
 	reproVars["gPrevMoments"]   = mpPrevReprojFbo->getColorTexture(2);
+	reproVars["gPrevMomentsIndirect"] = mpPrevReprojFbo->getColorTexture(6);
 	reproVars["gHistoryLength"] = mpPrevReprojFbo->getColorTexture(3);
-	reproVars["gPrevDirect"]    = mpFilteredPastFbo->getColorTexture(0);
-	reproVars["gPrevIndirect"]  = mpFilteredPastFbo->getColorTexture(1);
+	reproVars["gPrevDirect"]    = (mFilteredPastInReproj ? mpPrevReprojFbo : mpFilteredPastFbo)->getColorTexture(0);
+	reproVars["gPrevIndirect"]  = (mFilteredPastInReproj ? mpPrevReprojFbo : mpFilteredPastFbo)->getColorTexture(1);
 	reproVars["gDirect"]        = mInputTex.directIllum;
 	reproVars["gIndirect"]      = mInputTex.indirectIllum;
 
 	// Setup variables for our reprojection pass
 	reproVars["PerImageCB"]["gAlpha"] = mAlpha;
 	reproVars["PerImageCB"]["gMomentsAlpha"] = mMomentsAlpha;
+	reproVars["PerImageCB"]["gCompactStorage"] = (mStorageFormat == uint32_t(StorageFormat::Compact));
 
 	// Execute the reprojection pass
-	mpSvgfState->setFbo(mpCurReprojFbo);
+	setTargetFbo(mpCurReprojFbo);
+	CpuSVGF::StageTimer::Scope scope(mpStageTimer.get(), mStageIds.reprojection);
 	mpReprojection->execute(pRenderContext, mpSvgfState);
 }
 
@@ -276,58 +513,92 @@ void SVGFPass::computeVarianceEstimate(RenderContext* pRenderContext)
 	filterVars["gMoments"]          = mpCurReprojFbo->getColorTexture(2);
 	filterVars["gHistoryLength"]    = mpCurReprojFbo->getColorTexture(3);
 	filterVars["gCompactNormDepth"] = mInputTex.miscBuf;
+	filterVars["gDirectVar"]        = mpCurReprojFbo->getColorTexture(4);
+	filterVars["gIndirectVar"]      = mpCurReprojFbo->getColorTexture(5);
+	filterVars["gMomentsIndirect"]  = mpCurReprojFbo->getColorTexture(6);
 
 	filterVars["PerImageCB"]["gPhiColor"]  = mPhiColor;
 	filterVars["PerImageCB"]["gPhiNormal"] = mPhiNormal;
+	filterVars["PerImageCB"]["gCompactStorage"] = (mStorageFormat == uint32_t(StorageFormat::Compact));
 
-	mpSvgfState->setFbo(mpPingPongFbo[0]);
+	setTargetFbo(mpPingPongFbo[0]);
+	CpuSVGF::StageTimer::Scope scope(mpStageTimer.get(), mStageIds.filterMoments);
 	mpFilterMoments->execute(pRenderContext, mpSvgfState);
 }
 
 void SVGFPass::computeAtrousDecomposition(RenderContext* pRenderContext)
 {
-	auto aTrousVars = mpAtrous->getVars();
-	aTrousVars["PerImageCB"]["gPhiColor"]  = mPhiColor;
-	aTrousVars["PerImageCB"]["gPhiNormal"] = mPhiNormal;
-	aTrousVars["gHistoryLength"]           = mpCurReprojFbo->getColorTexture(3);
-	aTrousVars["gCompactNormDepth"]        = mInputTex.miscBuf;
-
-
+	Fbo::SharedPtr curSourceFbo = mpPingPongFbo[0];
 	for (int i = 0; i < mFilterIterations; i++) {
 		bool performModulation = (i == mFilterIterations - 1);
-		Fbo::SharedPtr curTargetFbo = performModulation ? mpOutputFbo : mpPingPongFbo[1];
+
+		// The last iteration modulates in-shader; it runs a variant of its own
+		FullscreenLaunch::SharedPtr pAtrous = getAtrousVariant(performModulation);
+		auto aTrousVars = pAtrous->getVars();
+		aTrousVars["PerImageCB"]["gPhiColor"]  = mPhiColor;
+		aTrousVars["PerImageCB"]["gPhiNormal"] = mPhiNormal;
+		aTrousVars["gHistoryLength"]           = mpCurReprojFbo->getColorTexture(3);
+		aTrousVars["gCompactNormDepth"]        = mInputTex.miscBuf;
+		aTrousVars["PerImageCB"]["gCompactStorage"] = (mStorageFormat == uint32_t(StorageFormat::Compact));
+		bool feedback = (i == std::min(mFeedbackTap, mFilterIterations - 1));
+
+		// Blit-free, the feedback iteration renders straight into the filtered past, which the next iteration reads
+		bool intoHistory = mBlitFree && feedback && !performModulation;
+		Fbo::SharedPtr curTargetFbo = performModulation ? mpFinalFbo
+		                            : intoHistory       ? mpFilteredPastFbo
+		                            : (curSourceFbo == mpPingPongFbo[1] ? mpPingPongFbo[0] : mpPingPongFbo[1]);
 
 		// Send down our input images
-		aTrousVars["gDirect"] = mpPingPongFbo[0]->getColorTexture(0);
-		aTrousVars["gIndirect"] = mpPingPongFbo[0]->getColorTexture(1);
+		aTrousVars["gDirect"] = curSourceFbo->getColorTexture(0);
+		aTrousVars["gIndirect"] = curSourceFbo->getColorTexture(1);
+		aTrousVars["gDirectVar"] = curSourceFbo->getColorTexture(2);
+		aTrousVars["gIndirectVar"] = curSourceFbo->getColorTexture(3);
 		aTrousVars["PerImageCB"]["gStepSize"] = 1 << i;
 
-		// perform modulation in-shader if needed
-		aTrousVars["PerImageCB"]["gPerformModulation"] = performModulation;
 		aTrousVars["gAlbedo"]      = mInputTex.dirAlbedo;
 		aTrousVars["gIndirAlbedo"] = mInputTex.indirAlbedo;
 
-		mpSvgfState->setFbo(curTargetFbo);
-		mpAtrous->execute(pRenderContext, mpSvgfState);
+		setTargetFbo(curTargetFbo);
+		mpStageTimer->begin(getAtrousStageId(i));
+		pAtrous->execute(pRenderContext, mpSvgfState);
+		mpStageTimer->end(getAtrousStageId(i));
 
 		// store the filtered color for the feedback path
-		if (i == std::min(mFeedbackTap, mFilterIterations - 1))
+		if (feedback && !intoHistory)
 		{
-			pRenderContext->blit(curTargetFbo->getColorTexture(0)->getSRV(), mpFilteredPastFbo->getRenderTargetView(0));
-			pRenderContext->blit(curTargetFbo->getColorTexture(1)->getSRV(), mpFilteredPastFbo->getRenderTargetView(1));
+			CpuSVGF::StageTimer::Scope scope(mpStageTimer.get(), mStageIds.feedbackBlit);
+			pRenderContext->blit(curTargetFbo->getColorTexture(0)->getSRV(), mpFilteredPastFbo->getRenderTargetView(0), getRegionRect(), getRegionRect());
+			pRenderContext->blit(curTargetFbo->getColorTexture(1)->getSRV(), mpFilteredPastFbo->getRenderTargetView(1), getRegionRect(), getRegionRect());
 		}
 
-		std::swap(mpPingPongFbo[0], mpPingPongFbo[1]);
+		curSourceFbo = curTargetFbo;
 	}
 
-	if (mFeedbackTap < 0 || mFilterIterations <= 0)
+	// Blit-free, next frame's reprojection reads the reprojected color in place
+	if ((mFeedbackTap < 0 || mFilterIterations <= 0) && !mBlitFree)
 	{
-		pRenderContext->blit(mpCurReprojFbo->getColorTexture(0)->getSRV(), mpFilteredPastFbo->getRenderTargetView(0));
-		pRenderContext->blit(mpCurReprojFbo->getColorTexture(1)->getSRV(), mpFilteredPastFbo->getRenderTargetView(1));
+		CpuSVGF::StageTimer::Scope scope(mpStageTimer.get(), mStageIds.feedbackBlit);
+		pRenderContext->blit(mpCurReprojFbo->getColorTexture(0)->getSRV(), mpFilteredPastFbo->getRenderTargetView(0), getRegionRect(), getRegionRect());
+		pRenderContext->blit(mpCurReprojFbo->getColorTexture(1)->getSRV(), mpFilteredPastFbo->getRenderTargetView(1), getRegionRect(), getRegionRect());
 	}
 
 }
 
+FullscreenLaunch::SharedPtr SVGFPass::getAtrousVariant(bool modulate)
+{
+	const uint32_t channels = mAtrousChannels & 3;
+	const uint32_t radius   = mAtrousRadius == 1 ? 1 : 2;
+	FullscreenLaunch::SharedPtr &pVariant = mpAtrousVariants[channels][modulate ? 1 : 0][radius - 1];
+	if (!pVariant)
+	{
+		pVariant = FullscreenLaunch::create(kAtrousShader);
+		pVariant->addDefine("ATROUS_CHANNELS", std::to_string(channels));
+		pVariant->addDefine("ATROUS_MODULATE", modulate ? "1" : "0");
+		pVariant->addDefine("ATROUS_RADIUS", std::to_string(radius));
+	}
+	return pVariant;
+}
+
 void SVGFPass::computeModulation(RenderContext* pRenderContext)
 {
 	auto modulateVars = mpModulate->getVars();
@@ -337,7 +608,8 @@ void SVGFPass::computeModulation(RenderContext* pRenderContext)
 	modulateVars["gIndirAlbedo"] = mInputTex.indirAlbedo;
 
 	// Run the modulation pass
-	mpSvgfState->setFbo(mpOutputFbo);
+	setTargetFbo(mpFinalFbo);
+	CpuSVGF::StageTimer::Scope scope(mpStageTimer.get(), mStageIds.modulation);
 	mpModulate->execute(pRenderContext, mpSvgfState);
 }
 
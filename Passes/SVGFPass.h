@@ -20,6 +20,9 @@
 #include "../SharedUtils/RenderPass.h"
 #include "../SharedUtils/SimpleVars.h"
 #include "../SharedUtils/FullscreenLaunch.h"
+#include "../CpuSVGF/SVGFResourcePool.h"
+#include "../CpuSVGF/SVGFStageTimer.h"
+#include "../CpuSVGF/SVGFPreset.h"
 
 /** This pass implements Spatiotemporal Variance-Guided Filtering from HPG 2017
 */
@@ -32,6 +35,17 @@ public:
 	static SharedPtr create(const std::string &directIn, const std::string &indirectIn, const std::string &outChannel);
     virtual ~SVGFPass() = default;
 
+	// GPU time of each stage ("reprojection", "filter moments", "a-trous <i>", "feedback blit", "modulation",
+	//    "output blit", "linear z copy", "combine unfiltered" and "total") over the last frames.  Results lag a frame.
+	CpuSVGF::StageTimer::SharedPtr getStageTimer() const { return mpStageTimer; }
+
+	// Allocations, reuses and the high-water mark of the pool our intermediate render targets come from
+	const CpuSVGF::ResourcePoolStats &getTargetPoolStats() const { return mTargetPool.getStats(); }
+
+	// Set the filter parameters from a preset file, such as one SVGFCli tune writes (see CpuSVGF/SVGFPreset.h).
+	//    Parameters the file doesn't set keep their values.  Returns false, logging why, if it can't be loaded.
+	bool loadPreset(const std::string &path);
+
 protected:
 	SVGFPass(const std::string &directIn, const std::string &indirectIn, const std::string &outChannel);
 
@@ -61,19 +75,52 @@ protected:
 	// jfgagnon
 	int32_t mShowIntermediateBuffer = -1;
 
+	// Precision of the ping-pong, filtered past and reprojection buffers.  Compact halves the filter state
+	//    compared to Full; see SVGFStorage.h for how the shaders read and write it.
+	enum class StorageFormat : uint32_t
+	{
+		Full = 0,    // RGBA32F illumination and moments, R16F history length
+		Half,        // RGBA16F illumination and moments, R16F history length
+		Compact,     // R11G11B10F color + R16F variance, 2x RG16F moments, R8 history length
+	};
+	uint32_t mStorageFormat = uint32_t(StorageFormat::Full);
+
+	// Skip the bookkeeping blits:  the feedback iteration renders straight into mpFilteredPastFbo, the last iteration
+	//    into the output channel, and linear z history rides along in the reprojection FBOs (attachment 7), which are
+	//    swapped rather than copied.  Without a feedback tap, reprojection reads last frame's reprojected color in place.
+	//    The output is bit-identical; CpuSVGFFilter::Settings::blitFree mirrors this for comparison.
+	bool mBlitFree = false;
+
+	// A-trous kernel:  the channels it filters (1 = direct, 2 = indirect, 3 = both; a channel left out keeps its
+	//    temporally accumulated value) and its radius (1 = 3x3, 2 = 5x5 taps).  Each combination is compiled separately.
+	uint32_t mAtrousChannels = 3;
+	uint32_t mAtrousRadius   = 2;
+
 	// SVGF passes
 	FullscreenLaunch::SharedPtr         mpReprojection;
-	FullscreenLaunch::SharedPtr         mpAtrous;
+	FullscreenLaunch::SharedPtr         mpAtrousVariants[4][2][2];   // [channels][modulate][radius - 1], see getAtrousVariant()
 	FullscreenLaunch::SharedPtr         mpModulate;
 	FullscreenLaunch::SharedPtr         mpFilterMoments;
 	FullscreenLaunch::SharedPtr         mpCombineUnfiltered;
+	FullscreenLaunch::SharedPtr         mpClearRegion;
 
 	// Intermediate framebuffers
 	Fbo::SharedPtr            mpPingPongFbo[2];
 	Fbo::SharedPtr            mpFilteredPastFbo;
 	Fbo::SharedPtr            mpCurReprojFbo;
 	Fbo::SharedPtr            mpPrevReprojFbo;
-	Fbo::SharedPtr            mpOutputFbo;
+	Fbo::SharedPtr            mpOutputFbo;         // Not allocated in blit-free mode
+	Fbo::SharedPtr            mpFinalFbo;          // This frame's target for the last iteration / modulation
+	Fbo::SharedPtr            mpPrevLinearZFbo;    // mInputTex.prevLinearZ, to clear it
+
+	// The filter region.  Our render targets come from a pool in size classes and can be larger than it; every pass
+	//    renders, and every blit copies, only the region.  resize() keeps the targets while the new size fits them.
+	uint32_t                  mWidth  = 0;
+	uint32_t                  mHeight = 0;
+	using TargetPool = CpuSVGF::ResourcePool<Texture::SharedPtr>;
+	TargetPool                mTargetPool;
+	std::vector<TargetPool::Allocation> mTargets;  // Everything the FBOs above attach
+	uint32_t                  mTargetLayout = ~0u; // Storage format and blit-free mode mTargets were made for
 
 	// Textures expected by SVGF code
 	struct {
@@ -90,11 +137,42 @@ protected:
 	// Some internal state
 	bool mNeedFboClear = true;
 	bool mFilterEnabled = true;
+	bool mFilteredPastInReproj = false;   // Blit-free with no feedback tap:  last frame's filtered past is mpPrevReprojFbo
+
+	// Per-stage GPU timings, and the ids of our stages in it
+	CpuSVGF::StageTimer::SharedPtr mpStageTimer;
+	struct {
+		uint32_t              total = 0, reprojection = 0, filterMoments = 0, feedbackBlit = 0, modulation = 0;
+		uint32_t              outputBlit = 0, linearZCopy = 0, combineUnfiltered = 0;
+		std::vector<uint32_t> atrous;
+	} mStageIds;
+	bool mShowStageTimings = false;
 
 private:
 	// After resizing or creating framebuffers, make sure to initialize them
 	void clearFbos(RenderContext* pCtx);
 
+	// Bytes per pixel of everything resize() allocates, with the current storage format
+	uint32_t getFilterStateBytesPerPixel() const;
+
+	// An FBO attaching pooled targets of the given formats (Unknown leaves an attachment out)
+	Fbo::SharedPtr createPooledFbo(uint32_t width, uint32_t height, const std::vector<ResourceFormat> &formats);
+
+	// Bind an FBO to our graphics state with the viewport and scissor set to the filter region
+	void setTargetFbo(const Fbo::SharedPtr &pFbo);
+
+	// The filter region as a blit rectangle
+	uvec4 getRegionRect() const { return uvec4(0, 0, mWidth, mHeight); }
+
+	// Clear the filter region of an FBO; attachment 7 gets linearZ
+	void clearRegion(RenderContext* pCtx, const Fbo::SharedPtr &pFbo, const vec4 &color, const vec4 &linearZ);
+
+	// Timer stage of a-trous iteration i, registered on first use
+	uint32_t getAtrousStageId(int i);
+
+	// SVGFAtrous.ps.hlsl specialized for the current channels and radius, modulating or not; compiled on first use
+	FullscreenLaunch::SharedPtr getAtrousVariant(bool modulate);
+
 	// Encapsulate each of the passes in its own method
 	void computeReprojection(RenderContext* pRenderContext);
 	void computeVarianceEstimate(RenderContext* pRenderContext);
@@ -0,0 +1,141 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#include "TemporalAAPass.h"
+#include "GpuTimerBackend.h"
+
+namespace {
+	// Where is our shader located?
+	const char *kTemporalAAShader = "SVGF\\SVGFTemporalAA.ps.hlsl";
+};
+
+TemporalAAPass::SharedPtr TemporalAAPass::create(const std::string &inChannel, const std::string &outChannel)
+{
+	return SharedPtr(new TemporalAAPass(inChannel, outChannel));
+}
+
+TemporalAAPass::TemporalAAPass(const std::string &inChannel, const std::string &outChannel)
+	: ::RenderPass("Temporal Anti-Aliasing", "TAA Options"), mInChannel(inChannel), mOutChannel(outChannel)
+{
+}
+
+bool TemporalAAPass::initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager)
+{
+	if (!pResManager) return false;
+
+	// Stash our resource manager; ask for our input & output, and the motion vectors of the SVGF G-buffer
+	mpResManager = pResManager;
+	mpResManager->requestTextureResources({ mInChannel, mOutChannel, "SVGF_MotionVecs" });
+
+	mpState   = GraphicsState::create();
+	mpResolve = FullscreenLaunch::create(kTemporalAAShader);
+
+	mpStageTimer  = CpuSVGF::StageTimer::create(std::make_shared<GpuTimerBackend>());
+	mResolveStage = mpStageTimer->getStageId("temporal AA");
+	mCopyStage    = mpStageTimer->getStageId("copy");
+	return true;
+}
+
+void TemporalAAPass::resize(uint32_t width, uint32_t height)
+{
+	// Skip if we're resizing to 0 width or height.
+	if (width <= 0 || height <= 0) return;
+
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		mpHistory[i] = Texture::create2D(width, height, ResourceFormat::RGBA32Float, 1, 1, nullptr, Resource::BindFlags::ShaderResource | Resource::BindFlags::RenderTarget);
+		mpResolveFbo[i] = Fbo::create();
+		mpResolveFbo[i]->attachColorTarget(mpHistory[i], 1);
+	}
+
+	// The old history doesn't line up with the new size
+	mHasHistory = false;
+}
+
+void TemporalAAPass::renderGui(Gui* pGui)
+{
+	int dirty = 0;
+	dirty |= (int)pGui->addCheckBox(mEnabled ? "TAA enabled" : "TAA disabled", mEnabled);
+
+	pGui->addText("How much of each frame goes into the result?");
+	pGui->addText("    (alpha; 1 = no history)");
+	dirty |= (int)pGui->addFloatVar("Alpha", mAlpha, 0.01f, 1.0f, 0.001f);
+
+	pGui->addText("");
+	pGui->addCheckBox("Show stage timings", mShowStageTimings);
+	if (mShowStageTimings && mpStageTimer)
+	{
+		pGui->addText("    GPU ms:       avg     min     p99");
+		for (uint32_t i = 0; i < mpStageTimer->getStageCount(); i++)
+		{
+			if (!mpStageTimer->isActive(i)) continue;
+			CpuSVGF::StageTimer::Stats stats = mpStageTimer->getStats(i);
+			char line[128];
+			snprintf(line, sizeof(line), "    %-18s %7.3f %7.3f %7.3f", mpStageTimer->getStageName(i).c_str(), stats.avgMs, stats.minMs, stats.p99Ms);
+			pGui->addText(line);
+		}
+	}
+
+	if (dirty)
+	{
+		// Flag to the renderer that options that affect the rendering have changed.
+		setRefreshFlag();
+	}
+}
+
+void TemporalAAPass::execute(RenderContext* pRenderContext)
+{
+	if (!mpResManager) return;
+
+	// Grab our input and output textures.  Make sure they exist
+	Texture::SharedPtr pSrc = mpResManager->getTexture(mInChannel);
+	Texture::SharedPtr pDst = mpResManager->getTexture(mOutChannel);
+	if (!pSrc || !pDst) return;
+
+	if (!mEnabled || !mpHistory[0])
+	{
+		// No TAA.  Copy our input to our output, and start over once enabled again
+		{
+			CpuSVGF::StageTimer::Scope scope(mpStageTimer.get(), mCopyStage);
+			pRenderContext->blit(pSrc->getSRV(), pDst->getRTV());
+		}
+		mHasHistory = false;
+		mpStageTimer->endFrame();
+		return;
+	}
+
+	auto resolveVars = mpResolve->getVars();
+	resolveVars["gColor"]   = pSrc;
+	resolveVars["gMotion"]  = mpResManager->getTexture("SVGF_MotionVecs");
+	resolveVars["gHistory"] = mpHistory[mCurrent];
+	resolveVars["PerImageCB"]["gAlpha"]      = mAlpha;
+	resolveVars["PerImageCB"]["gHasHistory"] = mHasHistory;
+
+	// Render the output and next frame's history together
+	Fbo::SharedPtr pFbo = mpResolveFbo[mCurrent ^ 1];
+	pFbo->attachColorTarget(pDst, 0);
+	mpState->setFbo(pFbo);
+	{
+		CpuSVGF::StageTimer::Scope scope(mpStageTimer.get(), mResolveStage);
+		mpResolve->execute(pRenderContext, mpState);
+	}
+
+	mCurrent   ^= 1;
+	mHasHistory = true;
+	mpStageTimer->endFrame();
+}
@@ -0,0 +1,74 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+#pragma once
+#include "../SharedUtils/RenderPass.h"
+#include "../SharedUtils/SimpleVars.h"
+#include "../SharedUtils/FullscreenLaunch.h"
+#include "../CpuSVGF/SVGFStageTimer.h"
+
+/** Temporal anti-aliasing after SVGF (see SVGFTemporalAA.ps.hlsl).  Blends each frame into the previous output,
+    reprojected with SVGF_MotionVecs and clamped to the pixel's 3x3 neighborhood in YCoCg, which evens out the
+    flicker the a-trous iterations leave.  CpuSVGF::TemporalAA is the CPU counterpart.
+*/
+class TemporalAAPass : public ::RenderPass, inherit_shared_from_this<::RenderPass, TemporalAAPass>
+{
+public:
+    using SharedPtr = std::shared_ptr<TemporalAAPass>;
+    using SharedConstPtr = std::shared_ptr<const TemporalAAPass>;
+
+	static SharedPtr create(const std::string &inChannel, const std::string &outChannel);
+    virtual ~TemporalAAPass() = default;
+
+	// GPU time of the "temporal AA" stage (or "copy" while disabled) over the last frames; compare it with SVGFPass'
+	//    "a-trous <i>" stages.  Results lag a frame.
+	CpuSVGF::StageTimer::SharedPtr getStageTimer() const { return mpStageTimer; }
+
+protected:
+	TemporalAAPass(const std::string &inChannel, const std::string &outChannel);
+
+    // Implementation of RenderPass interface
+	bool initialize(RenderContext* pRenderContext, ResourceManager::SharedPtr pResManager) override;
+	void execute(RenderContext* pRenderContext) override;
+	void renderGui(Gui* pGui) override;
+	void resize(uint32_t width, uint32_t height) override;
+
+	// Which texture inputs are we reading and writing to?
+	std::string                 mInChannel;
+	std::string                 mOutChannel;
+
+	// TAA parameters; CpuSVGF::TemporalAA::Settings has the same defaults
+	bool                        mEnabled = true;
+	float                       mAlpha   = 0.1f;   ///< Weight of the current frame
+
+	GraphicsState::SharedPtr    mpState;
+	FullscreenLaunch::SharedPtr mpResolve;
+
+	// The shader writes our output channel and the history together.  mpHistory[mCurrent] holds last frame's output
+	//    and mpResolveFbo[i] attaches mpHistory[i] as target 1; the output channel is attached as target 0 each frame.
+	Texture::SharedPtr          mpHistory[2];
+	Fbo::SharedPtr              mpResolveFbo[2];
+	uint32_t                    mCurrent    = 0;
+	bool                        mHasHistory = false;
+
+	// GPU timings, and the ids of our stages in it
+	CpuSVGF::StageTimer::SharedPtr mpStageTimer;
+	uint32_t                    mResolveStage = 0;
+	uint32_t                    mCopyStage    = 0;
+	bool                        mShowStageTimings = false;
+};
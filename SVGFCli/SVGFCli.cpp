@@ -0,0 +1,3782 @@
+/**********************************************************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+# following conditions are met:
+#  * Redistributions of code must retain the copyright notice, this list of conditions and the following disclaimer.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its contributors may be used to endorse or promote products
+#    derived from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT
+# SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********************************************************************************************************************/
+
+// Command line front-end for the headless CPU SVGF filter (see CpuSVGF/CpuSVGFFilter.h).
+//
+//   SVGFCli filter [options]
+//       --input <dir>          Read frames from <dir>/<Channel>.<NNNN>.sfb (or .pfm), one file per SVGFPass input
+//       --capture <file>       ... or from a frame capture (.svgfcap, see CpuSVGF/SVGFCapture.h)
+//       --synthetic <WxH>      ... or render procedural frames of the given size instead
+//       --scene <file>         ... or path trace an .fscene / .obj (or test-room) on the CPU, at --size <WxH> (default
+//                              640x360) and --spp <n> samples per pixel (default 1)
+//       --bvh-cache <dir>      Load the scene's BVH from <dir> if it was saved there before, else build and save it
+//       --pan <units>          Camera translation per synthetic or traced frame (default 0, a static camera)
+//       --frames <n>           Number of frames to filter (default 1, or every frame of a capture)
+//       --first <n>            Index of the first frame (default 0)
+//       --output <dir>         Write the filtered result to <dir>/HDRColorOutput.<NNNN>.pfm
+//       --threads <n>          Worker threads (default: all hardware threads)
+//       --tile <n>             Tile size in pixels (default 32)
+//       --iterations <n>, --feedback <n>, --phi-color <f>, --phi-normal <f>, --alpha <f>, --moments-alpha <f>
+//                              Same meaning and defaults as the SVGFPass GUI
+//       --preset <file>        Start from the settings of a preset (see tune); the options above override it
+//       --no-filter            Combine the unfiltered inputs, like unchecking "SVGF enabled"
+//       --scalar-atrous        Use the per-pixel a-trous port instead of the vectorized planar kernel
+//       --isa <name>           Force the vectorized kernel to scalar, sse4.1, avx2 or avx512 (default: best supported)
+//       --fused                Run reprojection and the moment filter as one tile pass (see Settings::fusedReprojection)
+//       --storage <format>     Emulate SVGFPass' storage format for history and ping-pong buffers:  full, half or compact
+//       --blit-free            Keep the feedback and linear z history without copies (see Settings::blitFree)
+//       --adaptive             Skip converged tiles in later a-trous iterations (see Settings::adaptiveAtrous), tuned by
+//                              --adaptive-first <n>, --adaptive-min-history <frames> and --adaptive-threshold <rel. std dev>
+//       --indirect-scale <n>   Filter indirect illumination at 1/n resolution, n = 1, 2 or 4 (see Settings::indirectScale)
+//       --geometry-cache       Compute the a-trous depth weights once per frame (see Settings::geometryWeightCache)
+//       --channels <set>       Channels the a-trous filters:  both (default), direct or indirect; the other passes through
+//       --radius <n>           A-trous kernel radius, 1 (3x3) or 2 (5x5, default)
+//
+//   SVGFCli replay --capture <file> [options]
+//                              Same as filter, streaming the capture through the filter (all frames by default)
+//       --loop <n>             Play the sequence n times (default 1); history carries over between loops
+//
+//   SVGFCli stream [options]
+//       --input <dir>, --capture <file> or --synthetic <WxH>, --pan <units>, --first <n>   Frames to filter, as for filter
+//       --frames <n>           Number of frames (default 16, or every frame of a capture)
+//       --output <dir>         Write the filtered frames to <dir>/HDRColorOutput.<NNNN>.<format> (default: filter only)
+//       --format <ext>         pfm or sfb (default pfm)
+//       --queue-depth <n>      Frames in flight between stages (default 2); 0 runs read, filter and write one after
+//                              the other on one thread
+//       --threads <n>, --iterations <n>, ...   As for filter
+//                              Reads frame N+1 and writes frame N-1 on their own threads while frame N is filtered,
+//                              and reports frames/s and how long each stage worked and stalled.
+//
+//   SVGFCli capture --output <file> [options]
+//       --input <dir>, --synthetic <WxH>, --pan <units>, --frames <n>, --first <n>   Frames to record, as for filter
+//       --compress             Store each channel with the lossless delta + run-length codec when it is smaller
+//
+//   SVGFCli compare-storage [options]
+//       --synthetic <WxH>      Size of the procedural frames (default 640x360)
+//       --frames <n>, --pan <units>, --threads <n>, --iterations <n>, ...   As for filter (default 16 frames, pan 0.02)
+//                              Filters the same frames with every storage format and reports the filter state
+//                              memory and the error of each format against full precision.
+//
+//   SVGFCli compare-blit-free [options]
+//       --synthetic <WxH>      Size of the procedural frames (default 320x180)
+//       --frames <n>, --pan <units>, --threads <n>, --iterations <n>, --storage <format>, ...   As for filter
+//                              (default 8 frames, pan 0.02).  Filters the same frames with and without blit-free
+//                              bookkeeping for the reference, vectorized and adaptive a-trous, feedback on and off,
+//                              separate and fused reprojection, and checks the outputs are bit-identical.
+//
+//   SVGFCli compare-indirect [options]
+//       --input <dir>, --capture <file> or --synthetic <WxH>   Frames to filter (default: synthetic 960x540)
+//       --frames <n>           Frames to filter (default 32, or every frame of a capture); the first 8 warm up history
+//       --pan <units>, --threads <n>, --iterations <n>, ...   As for filter
+//       --exposure <f>, --ppd <f>  As for metrics
+//                              Filters the sequence with indirect at full, half and quarter resolution and reports the
+//                              time of each stage and the error (RMSE, relMSE, SSIM, FLIP and flicker, measured by
+//                              MetricsEvaluator) against full resolution.
+//
+//   SVGFCli bench-adaptive [options]
+//       --input <dir>, --capture <file> or --synthetic <WxH>   Frames to filter (default: synthetic 960x540, static camera)
+//       --frames <n>           Frames to filter (default 64, or every frame of a capture); the first half warms up history
+//       --threads <n>, --iterations <n>, --adaptive-threshold <f>, ...   As for filter
+//                              Filters the sequence with every tile and with adaptive a-trous, and reports the tiles
+//                              filtered per iteration, the a-trous time of both and the difference between their outputs.
+//
+//   SVGFCli bench-geometry-cache [options]
+//       --input <dir>, --capture <file> or --synthetic <WxH>   Frames to filter (default: synthetic 960x540)
+//       --frames <n>           Frames to filter (default 16, or every frame of a capture); the first half warms up history
+//       --pan <units>, --threads <n>, --isa <name>, ...   As for filter
+//                              Filters the sequence with 4 and 5 a-trous iterations, with and without the geometry
+//                              weight cache, and reports the a-trous time of both (and of the pre-pass), the memory
+//                              of the cache and the difference between the outputs.
+//
+//   SVGFCli bench-batch [options]
+//       --viewport <WxH>       Resolution of each stream (default 160x90)
+//       --streams <n>          Largest batch (default 64); batches of 1, 2, 4, ... streams up to n are timed
+//       --frames <n>           Frames per batch size (default 8); the first half warms up history
+//       --mixed                Cycle the streams through the full, 3/4 and 1/2 viewport with different filter settings
+//       --pan <units>, --threads <n>, --iterations <n>, ...   As for filter (default pan 0.02)
+//                              Filters every stream with a CpuSVGFFilter of its own and with one CpuSVGFBatchFilter,
+//                              reports the time of both per batch size and checks the outputs match.  Then replaces
+//                              every other stream of the largest batch and checks the others kept their history.
+//
+//   SVGFCli bench-atrous [options]
+//       --sizes <WxH,...>      Resolutions to benchmark (default 1920x1080,3840x2160)
+//       --repeat <n>           Timed frames per variant (default 5)
+//       --threads <n>, --iterations <n>, --phi-color <f>, ...   As for filter
+//                              Times the a-trous stage of the per-pixel reference against the planar kernel built
+//                              for each supported instruction set, and reports the error against the reference.
+//
+//   SVGFCli bench-variants [options]
+//       --synthetic <WxH>      Size of the procedural frame (default 1920x1080)
+//       --repeat <n>           Timed runs per variant (default 5)
+//       --threads <n>, --iterations <n>, --isa <name>, ...   As for filter
+//                              Times every compiled a-trous variant (channel set, modulating or not, 3x3 or 5x5) of
+//                              the per-pixel reference and the vectorized kernel, per iteration, on the same frame.
+//
+//   SVGFCli check-pool [options]
+//       --size <WxH>           Full resolution (default 1920x1080)
+//                              Drives the render target pool the way SVGFPass::resize() does through dynamic
+//                              resolution sequences and reports allocations, reuses and the memory high-water mark.
+//
+//   SVGFCli check-timers
+//                              Drives StageTimer with a manual clock and checks its statistics against known durations
+//
+//   SVGFCli check-gbuffer [options]
+//       --size <WxH>           Number of random G-buffer samples, one per pixel of a jittered camera (default 640x360)
+//                              Encodes and decodes every sample with the compact G-buffer packing, checks the error of
+//                              position, normal and material against bounds, and lists the bytes per pixel of each layout.
+//
+//   SVGFCli trace [options]
+//       --scene <file>         Falcor .fscene or Wavefront .obj to render (default test-room, see Scene::createTestRoom())
+//       --size <WxH>           Resolution (default 640x360)
+//       --spp <n>              Samples per pixel (default 1); a large count renders a converged reference
+//       --frames <n>, --first <n>, --pan <units>, --threads <n>, --bvh-cache <dir>   As for filter (default 1 frame,
+//                              static camera); the BVH cache directory also caches the environment map's sampling tables
+//       --texture-cache <dir>  Where to save and map the decoded textures of the scene's materials (default: the directory
+//                              of the scene file)
+//       --no-textures          Shade with the materials' constant colors instead of loading their textures
+//       --no-direct, --no-indirect   Skip the shadow or the indirect rays, like the GI pass' checkboxes
+//       --scalar-traversal     Trace one ray at a time instead of in packets (see Settings::packetTraversal); same image
+//       --isa <name>           Packet width:  scalar, sse4.1, avx2 or avx512 (default: best supported)
+//       --alpha-test <name>    Make the named material fail the alpha test (see bench-traversal)
+//       --sampler <name>       Random numbers:  white (default), blue-noise or sobol, like the GI pass' "Sampler" dropdown
+//       --light-selection <name>   uniform or power (default), like the GI pass' "Light selection" dropdown
+//       --extra-lights <n>     Add n point lights of random position and intensity to the scene
+//       --env <file>           Environment map (lat-long), or "sky" for a procedural sky with a small, bright sun
+//       --no-env-sampling      Sample indirect rays from the BRDF only, not the environment map (see Settings::envMapSampling)
+//       --output <dir>         Write the seven SVGFPass inputs to <dir>/<Channel>.<NNNN>.sfb (readable by filter --input)
+//                              and their modulated sum to <dir>/Reference.<NNNN>.pfm
+//                              Path traces the scene on the CPU the way GBufferForSVGF and GGXGlobalIlluminationPass do
+//                              and reports the BVH build time and the rays and rays/s of each frame.
+//
+//   SVGFCli bench-bvh [options]
+//       --scene <file>         Scene to build over, as for trace (default test-room)
+//       --bvh-cache <dir>      Where to save and load the BVH (default: the current directory)
+//       --rays <n>             Rays per traversal test (default 1000000)
+//       --threads <n>          Worker threads (default: all hardware threads)
+//                              Builds the BVH on one thread and on all of them, saves it, loads the saved file, checks
+//                              the loaded tree gives the same hits, and reports build and load times and the closest
+//                              hit and any hit throughput of camera, diffuse bounce and shadow rays.
+//
+//   SVGFCli bench-traversal [options]
+//       --scene <file>, --bvh-cache <dir>, --threads <n>   As for trace
+//       --size <WxH>           Camera rays (default 1280x720), in 16x16 tiles like the path tracer's
+//       --batch <n>            Rays per batch of the scattered bounces (default 65536)
+//       --alpha-test <name>    Make the named material fail the alpha test, so every traversal runs it
+//                              Traces the camera rays, a shadow ray to a random light and a diffuse bounce from each
+//                              hit, then the bounces shuffled across the frame ("scatter"), one at a time, in packets
+//                              of each supported instruction set and (for bounces) as a direction sorted stream, and
+//                              reports Mrays/s and any hit that differs from single rays.
+//
+//   SVGFCli compare-samplers [options]
+//       --scene <file>, --bvh-cache <dir>, --threads <n>, --no-direct, --no-indirect   As for trace
+//       --size <WxH>           Resolution (default 320x180)
+//       --frames <n>           Frames of a static camera at 1 spp (default 16)
+//       --reference-spp <n>    Samples per pixel of the reference (default 256)
+//       --iterations <n>, --phi-color <f>, ...   As for filter; --iterations is the count the others are matched against
+//                              Renders the frames with each sampler and reports the relMSE against the reference of
+//                              the raw frames, of the frames after a 5x5 low-pass, of their mean, and of the filtered
+//                              frames with 0 to 5 a-trous iterations, and how many iterations blue noise and Sobol
+//                              need to match white noise.
+//
+//   SVGFCli compare-lights [options]
+//       --scene <file>, --extra-lights <n>, --bvh-cache <dir>, --threads <n>   As for trace
+//       --size <WxH>           Resolution (default 320x180)
+//       --frames <n>           Frames of a static camera at 1 spp (default 8)
+//       --reference-spp <n>    Samples per pixel of the reference (default 256)
+//       --iterations <n>, --phi-color <f>, ...   As for filter
+//                              Times building the light alias table for 16 to 1M lights and checks its probabilities,
+//                              then renders direct light with uniform and power light selection and reports the error
+//                              against the reference before and after filtering, at the same number of shadow rays.
+//
+//   SVGFCli bench-envmap [options]
+//       --env <file>           Environment map to sample (default sky, see trace)
+//       --bvh-cache <dir>      Where to save and load the sampling tables (default: the current directory)
+//       --samples <n>          Directions drawn to check sampling (default 1048576)
+//       --scene <file>, --size <WxH>, --frames <n>, --reference-spp <n>, --threads <n>, ...   As for compare-lights
+//                              Times hashing the map and building, saving and loading its sampling tables, checks the
+//                              densities of sample() and evalPdf() agree and the variance of estimating the map's
+//                              integral, then renders indirect light with BRDF sampling alone and combined with
+//                              environment sampling and reports the error against the reference before and after filtering.
+//
+//   SVGFCli bench-textures [options]
+//       --scene <file>         Load the textures of the scene's materials (default Data/pink_room/pink_room.fscene).  If
+//                              it can't be loaded (its model isn't an .obj) or has none, every .png and .jpg in the
+//                              textures directory next to it.  Textures named *Specular* are linear, the others sRGB.
+//       --texture-cache <dir>  Where to save and map the decoded textures (default: the directory of the scene file)
+//       --threads <n>          As for filter
+//                              Times three startups:  decoding each texture and building its mips in turn on one thread,
+//                              a cold start that decodes on the thread pool and fills the cache, and a warm start that
+//                              maps the cache.  Checks all three produce the same mips.
+//
+//   SVGFCli metrics [options]
+//       --test <dir>           Frames to measure:  <dir>/HDRColorOutput.<NNNN>.pfm (or .sfb), as filter --output writes them,
+//                              from --first on until one is missing.  Without it, filters --input, --capture, --synthetic or
+//                              --scene (default synthetic 3840x2160) with the options of filter and measures the output.
+//       --reference <dir>      Reference frames:  <dir>/Reference.<NNNN>.pfm (as trace --output writes them) or
+//                              HDRColorOutput.<NNNN>.pfm / .sfb.  Without it, the filtered frames are compared with the same
+//                              frames unfiltered, which mostly serves to time the metrics.
+//       --frames <n>, --first <n>   Frames to measure (default 8 filtered frames, or every frame of a capture)
+//       --exposure <f>         Scale applied before clamping the colors for display (default 1)
+//       --ppd <f>              Pixels per degree of visual angle, for FLIP (default 67)
+//       --csv <file>, --json <file>   Write the metrics of every frame (and for JSON their mean) to a file
+//       --threads <n>, --isa <name>, --iterations <n>, ...   As for filter
+//                              Reports RMSE, relMSE, SSIM, FLIP-style error and flicker per frame (see
+//                              CpuSVGF/SVGFMetrics.h) and how long the metrics took.
+//
+//   SVGFCli tune [options]
+//       --input <dir>, --capture <file>, --scene <file> or --synthetic <WxH>   Sequence to tune on (default: synthetic
+//                              320x180; --scene renders at --size, default 320x180)
+//       --reference <dir>      Reference frames, as for metrics.  Without it, a scene is rendered again at
+//                              --reference-spp <n> samples per pixel (default 256), once for a static camera and per
+//                              frame with --pan, and static synthetic frames use the mean of --reference-spp frames.
+//       --frames <n>, --first <n>   Frames to filter (default 16, or every frame of a capture)
+//       --warmup <n>           Frames filtered before measuring, while history builds up (default 4)
+//       --iterations <list>, --feedback <list>, --phi-color <list>, --phi-normal <list>, --alpha <list>, --moments-alpha <list>
+//                              Comma separated values to try (defaults 2,3,4,5; -1,0,1; 2.5,5,10,20; 128;
+//                              0.05,0.1,0.2 and 0.2); every combination is a candidate.  Phi normal has no effect (see
+//                              normalDistanceCos()); candidates that differ only in it are filtered once.
+//       --objective <name>     Error to minimize:  flip (default), relmse, rmse, ssim (1 - SSIM) or flicker
+//       --budget <ms>          Pick the best candidate estimated to filter a frame in this time (default: the best)
+//       --output <file>        Write the picked settings as a preset for SVGFPass and filter --preset
+//       --csv <file>           Write every candidate's settings, cost and metrics
+//       --no-verify            Don't filter the Pareto front again with CpuSVGFFilter
+//       --exposure <f>, --ppd <f>, --threads <n>, --isa <name>, --storage <format>, --radius <n>, --channels <set>, ...
+//                              As for metrics and filter
+//                              Filters the sequence with every candidate, sharing the stages the settings they differ
+//                              in don't affect (see CpuSVGF/SVGFTuner.h), and prints the Pareto front of error against
+//                              estimated filter time.  Each point is filtered again with CpuSVGFFilter to check its
+//                              metrics are the same and to time it.
+//
+//   SVGFCli bench-taa [options]
+//       --input <dir>, --capture <file>, --scene <file> or --synthetic <WxH>   Sequence to filter (default: synthetic 640x360)
+//       --reference <dir>, --reference-spp <n>   Reference frames, as for tune
+//       --frames <n>, --first <n>   Frames to filter (default 24, or every frame of a capture)
+//       --warmup <n>           Frames filtered before measuring (default 8)
+//       --iterations <n>       A-trous iterations to compare with one less (default 4, at least 2)
+//       --taa-alpha <f>        Weight of the current frame in the temporal AA history (default 0.1)
+//       --exposure <f>, --ppd <f>, --threads <n>, --isa <name>, ...   As for metrics and filter
+//                              Filters the sequence with n and n - 1 iterations and runs temporal AA (see
+//                              CpuSVGF/SVGFTemporalAA.h) after each.  Times temporal AA with the per-pixel port and
+//                              each supported instruction set against one a-trous iteration, checks they all give the
+//                              same output, and prints the quality and filter time of the four combinations.
+
+#include "CpuSVGF/CpuSVGFBatchFilter.h"
+#include "CpuSVGF/CpuSVGFFilter.h"
+#include "CpuSVGF/SVGFBoundedQueue.h"
+#include "CpuSVGF/SVGFCapture.h"
+#include "CpuSVGF/SVGFGBufferLayout.h"
+#include "CpuSVGF/SVGFImageIO.h"
+#include "CpuSVGF/SVGFKernels.h"
+#include "CpuSVGF/SVGFMetrics.h"
+#include "CpuSVGF/SVGFPathTracer.h"
+#include "CpuSVGF/SVGFResourcePool.h"
+#include "CpuSVGF/SVGFSyntheticFrames.h"
+#include "CpuSVGF/SVGFTemporalAA.h"
+#include "CpuSVGF/SVGFTexture.h"
+#include "CpuSVGF/SVGFTuner.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+using namespace CpuSVGF;
+
+namespace {
+	const char *kOutputChannel  = "HDRColorOutput";
+
+	/** Minimal "--name value" / "--flag" parser
+	*/
+	class Options
+	{
+	public:
+		Options(int argc, char **argv, int first)
+		{
+			for (int i = first; i < argc; i++)
+			{
+				if (std::strncmp(argv[i], "--", 2) != 0) { mBad.push_back(argv[i]); continue; }
+				std::string name = argv[i] + 2;
+				bool hasValue = (i + 1 < argc) && std::strncmp(argv[i + 1], "--", 2) != 0;
+				mValues[name] = hasValue ? argv[++i] : "";
+			}
+		}
+
+		bool has(const char *name) const { return mValues.count(name) != 0; }
+		std::string getString(const char *name, const std::string &def = "") const { auto it = mValues.find(name); return it == mValues.end() ? def : it->second; }
+		int   getInt(const char *name, int def) const     { return has(name) ? std::atoi(getString(name).c_str()) : def; }
+		float getFloat(const char *name, float def) const { return has(name) ? float(std::atof(getString(name).c_str())) : def; }
+		const std::vector<std::string> &getUnparsed() const { return mBad; }
+		void set(const char *name, const std::string &value) { mValues[name] = value; }
+
+	private:
+		std::map<std::string, std::string> mValues;
+		std::vector<std::string>           mBad;
+	};
+
+	std::string framePath(const std::string &dir, const char *channel, uint32_t frame, const char *ext)
+	{
+		char name[256];
+		std::snprintf(name, sizeof(name), "%s.%04u%s", channel, frame, ext);
+		return dir + "/" + name;
+	}
+
+	/** Holds one frame's worth of inputs loaded from disk
+	*/
+	struct LoadedFrame
+	{
+		ImageF4     images[kCaptureChannelCount];
+		FrameInputs inputs;
+
+		bool load(const std::string &dir, uint32_t frame)
+		{
+			// Files are named after the resource manager channels SVGFPass reads, in capture channel order
+			for (uint32_t i = 0; i < kCaptureChannelCount; i++)
+			{
+				const char *channel = getCaptureChannelName(i);
+				if (!loadImage(framePath(dir, channel, frame, ".sfb"), images[i]) &&
+				    !loadImage(framePath(dir, channel, frame, ".pfm"), images[i]))
+				{
+					std::fprintf(stderr, "Cannot read channel %s of frame %u from %s\n", channel, frame, dir.c_str());
+					return false;
+				}
+			}
+			bindInputs();
+			return true;
+		}
+
+		/** Copy frame inputs owned by someone else
+		*/
+		void copy(const FrameInputs &other)
+		{
+			images[kCaptureDirectIllum]      = *other.directIllum;
+			images[kCaptureIndirectIllum]    = *other.indirectIllum;
+			images[kCaptureLinearZ]          = *other.linearZ;
+			images[kCaptureMotionVecs]       = *other.motionVecs;
+			images[kCaptureCompactNormDepth] = *other.miscBuf;
+			images[kCaptureDirAlbedo]        = *other.dirAlbedo;
+			images[kCaptureIndirAlbedo]      = *other.indirAlbedo;
+			bindInputs();
+		}
+
+		void bindInputs()
+		{
+			inputs.directIllum   = &images[kCaptureDirectIllum];
+			inputs.indirectIllum = &images[kCaptureIndirectIllum];
+			inputs.linearZ       = &images[kCaptureLinearZ];
+			inputs.motionVecs    = &images[kCaptureMotionVecs];
+			inputs.miscBuf       = &images[kCaptureCompactNormDepth];
+			inputs.dirAlbedo     = &images[kCaptureDirAlbedo];
+			inputs.indirAlbedo   = &images[kCaptureIndirAlbedo];
+		}
+	};
+
+	/** Where FrameSource::readFrame() puts a frame, so that several frames can be in flight at once
+	*/
+	struct FrameStorage
+	{
+		LoadedFrame        loaded;              ///< --input, or a copy of a synthetic frame
+		CaptureFrame       captured;            ///< --capture; raw channels wrap the file mapping
+		const FrameInputs *pInputs = nullptr;   ///< Points into one of the above
+	};
+
+	/** Running min / average / max of one stage's timings
+	*/
+	struct StageStats
+	{
+		double minMs = 1e30, maxMs = 0.0, sumMs = 0.0;
+		uint32_t count = 0;
+
+		void add(double ms) { minMs = std::min(minMs, ms); maxMs = std::max(maxMs, ms); sumMs += ms; count++; }
+		void print(const char *name) const
+		{
+			if (count == 0) return;
+			std::printf("  %-18s avg %9.3f ms   min %9.3f ms   max %9.3f ms\n", name, sumMs / count, minMs, maxMs);
+		}
+	};
+
+	/** One line per stage that ran, in registration order
+	*/
+	void printStageTimer(const StageTimer &timer)
+	{
+		for (uint32_t i = 0; i < timer.getStageCount(); i++)
+		{
+			StageTimer::Stats stats = timer.getStats(i);
+			if (stats.count == 0) continue;
+			std::printf("  %-18s avg %9.3f ms   min %9.3f ms   p99 %9.3f ms   max %9.3f ms\n", timer.getStageName(i).c_str(),
+			            stats.avgMs, stats.minMs, stats.p99Ms, stats.maxMs);
+		}
+	}
+
+	bool parseSize(const std::string &s, uint32_t &width, uint32_t &height)
+	{
+		return std::sscanf(s.c_str(), "%ux%u", &width, &height) == 2 && width > 0 && height > 0;
+	}
+
+	/** --isa, or defaultIsa if it's not given
+	*/
+	SimdIsa readSimdIsa(const Options &opts, SimdIsa defaultIsa)
+	{
+		if (!opts.has("isa")) return defaultIsa;
+
+		SimdIsa isa = defaultIsa;
+		const std::string name = opts.getString("isa");
+		for (uint32_t i = 0; i < uint32_t(SimdIsa::Count); i++)
+		{
+			if (name == getSimdIsaName(SimdIsa(i))) isa = SimdIsa(i);
+		}
+		if (!isSimdIsaSupported(isa))
+			std::fprintf(stderr, "%s is not supported on this machine, using the scalar kernel\n", name.c_str());
+		return isa;
+	}
+
+	/** --scene:  a scene file, or the built-in test room.  --alpha-test <material> makes that material fail the alpha
+	    test everywhere, to exercise the any-hit path.  --extra-lights <n> adds n point lights at random places in the
+	    scene's bounds, with intensities spread log-uniformly over three orders of magnitude.  --env <file> sets the
+	    environment map, or --env sky a procedural sky with a small bright sun where the first directional light comes
+	    from.  Prints the problem and returns nullptr on failure.
+	*/
+	Scene::SharedPtr loadScene(const Options &opts, CpuThreadPool::SharedPtr pPool)
+	{
+		const std::string path = opts.getString("scene", "test-room");
+		Scene::SharedPtr pScene;
+		if (path == "test-room")
+		{
+			pScene = Scene::createTestRoom();
+		}
+		else
+		{
+			std::string error;
+			pScene = Scene::load(path, error);
+			if (!pScene)
+			{
+				std::fprintf(stderr, "Cannot load scene %s: %s\n", path.c_str(), error.c_str());
+				return nullptr;
+			}
+		}
+
+		if (!opts.has("no-textures"))
+		{
+			const std::string cacheDir = opts.getString("texture-cache", pScene->getDirectory());
+			TextureLoadStats stats;
+			if (!pScene->loadTextures(cacheDir, pPool, &stats))
+				std::fprintf(stderr, "%u of %u textures failed to load; their materials keep their constant colors\n", stats.failedCount, stats.textureCount);
+			if (stats.textureCount > 0 && !cacheDir.empty())
+				std::printf("Loaded %u textures in %.2f ms (%u mapped from the cache in %s, %u decoded)\n", stats.textureCount, stats.totalMs,
+				            stats.mappedCount, cacheDir.c_str(), stats.decodedCount);
+			else if (stats.textureCount > 0)
+				std::printf("Loaded %u textures in %.2f ms\n", stats.textureCount, stats.totalMs);
+		}
+
+		if (opts.has("alpha-test"))
+		{
+			const std::string name = opts.getString("alpha-test");
+			bool found = false;
+			for (uint32_t i = 0; i < pScene->getMaterialCount(); i++)
+			{
+				SceneMaterial &material = pScene->getMaterial(i);
+				if (material.name != name) continue;
+				material.opacity = 0.0f;
+				found = true;
+			}
+			if (!found)
+			{
+				std::fprintf(stderr, "The scene has no material named %s\n", name.c_str());
+				return nullptr;
+			}
+		}
+
+		const uint32_t extraLights = uint32_t(std::max(0, opts.getInt("extra-lights", 0)));
+		if (extraLights > 0 && pScene->getTriangleCount() > 0)
+		{
+			float3 lo(1e30f), hi(-1e30f);
+			for (uint32_t t = 0; t < pScene->getTriangleCount(); t++)
+			{
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					const float3 &p = pScene->getPositions(t)[k];
+					lo = float3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+					hi = float3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+				}
+			}
+			uint32_t seed = initRand(extraLights, 0x11647u);
+			for (uint32_t i = 0; i < extraLights; i++)
+			{
+				SceneLight light;
+				light.name = "extraLight";
+				light.posW = float3(lo.x + (0.1f + 0.8f * nextRand(seed)) * (hi.x - lo.x), lo.y + (0.1f + 0.8f * nextRand(seed)) * (hi.y - lo.y),
+				                    lo.z + (0.1f + 0.8f * nextRand(seed)) * (hi.z - lo.z));
+				light.intensity = float3(std::pow(10.0f, -3.0f * nextRand(seed)));
+				pScene->addLight(light);
+			}
+		}
+
+		const std::string env = opts.getString("env");
+		if (env == "sky")
+		{
+			float3 toSun = normalize(float3(0.3f, 0.8f, -0.5f));
+			for (const SceneLight &light : pScene->getLights())
+			{
+				if (light.type == SceneLightType::Directional) { toSun = normalize(-light.dirW); break; }
+			}
+			ImageF4 sky(1024, 512);
+			for (uint32_t y = 0; y < sky.getHeight(); y++)
+			{
+				for (uint32_t x = 0; x < sky.getWidth(); x++)
+				{
+					const float3 dir = latLongToWsVector(float2((float(x) + 0.5f) / sky.getWidth(), (float(y) + 0.5f) / sky.getHeight()));
+					float3 color = dir.y > 0.0f ? float3(0.25f, 0.4f, 0.8f) * (1.0f - 0.6f * dir.y) : float3(0.15f, 0.13f, 0.1f);
+					if (dot(dir, toSun) > 0.9994f) color = float3(2000.0f, 1900.0f, 1700.0f);   // About 2 degrees across
+					sky.at(x, y) = float4(color.x, color.y, color.z, 1.0f);
+				}
+			}
+			pScene->setEnvironmentMap(sky);
+		}
+		else if (!env.empty())
+		{
+			ImageF4 envMap;
+			if (!loadImage(env, envMap))
+			{
+				std::fprintf(stderr, "Cannot read environment map %s\n", env.c_str());
+				return nullptr;
+			}
+			pScene->setEnvironmentMap(envMap);
+		}
+		return pScene;
+	}
+
+	/** Path tracer for --scene / --size / --spp / --pan / --sampler / --light-selection and the GI pass checkboxes;
+	    nullptr (after printing why) on failure
+	*/
+	CpuPathTracer::SharedPtr createPathTracer(const Options &opts, CpuThreadPool::SharedPtr pPool, const char *defaultSize = "640x360")
+	{
+		uint32_t width, height;
+		if (!parseSize(opts.getString("size", defaultSize), width, height))
+		{
+			std::fprintf(stderr, "--size expects a size such as 640x360\n");
+			return nullptr;
+		}
+
+		LightSelection lightSelection = LightSelection::Count;
+		const std::string selectionName = opts.getString("light-selection", getLightSelectionName(LightSelection::Power));
+		for (uint32_t i = 0; i < uint32_t(LightSelection::Count); i++)
+		{
+			if (selectionName == getLightSelectionName(LightSelection(i))) lightSelection = LightSelection(i);
+		}
+		if (lightSelection == LightSelection::Count)
+		{
+			std::fprintf(stderr, "--light-selection expects uniform or power\n");
+			return nullptr;
+		}
+
+		SamplerType sampler = SamplerType::Count;
+		const std::string samplerName = opts.getString("sampler", getSamplerTypeName(SamplerType::WhiteNoise));
+		for (uint32_t i = 0; i < uint32_t(SamplerType::Count); i++)
+		{
+			if (samplerName == getSamplerTypeName(SamplerType(i))) sampler = SamplerType(i);
+		}
+		if (sampler == SamplerType::Count)
+		{
+			std::fprintf(stderr, "--sampler expects white, blue-noise or sobol\n");
+			return nullptr;
+		}
+
+		Scene::SharedPtr pScene = loadScene(opts, pPool);
+		if (!pScene) return nullptr;
+
+		bool loaded = false;
+		TriangleBvh::SharedPtr pBvh = opts.has("bvh-cache") ? TriangleBvh::buildCached(pScene, opts.getString("bvh-cache"), pPool, &loaded)
+		                                                    : TriangleBvh::build(pScene, pPool);
+		if (loaded) std::printf("Loaded the BVH from %s\n", TriangleBvh::getCachePath(*pScene, opts.getString("bvh-cache")).c_str());
+
+		CpuPathTracer::SharedPtr pTracer = CpuPathTracer::create(pBvh, width, height, pPool);
+		CpuPathTracer::Settings settings;
+		settings.samplesPerPixel = uint32_t(std::max(1, opts.getInt("spp", 1)));
+		settings.doDirectGI      = !opts.has("no-direct");
+		settings.doIndirectGI    = !opts.has("no-indirect");
+		settings.cameraPan       = opts.getFloat("pan", 0.0f);
+		settings.packetTraversal = !opts.has("scalar-traversal");
+		settings.simdIsa         = readSimdIsa(opts, settings.simdIsa);
+		settings.sampler         = sampler;
+		settings.lightSelection  = lightSelection;
+		settings.envMapSampling  = !opts.has("no-env-sampling");
+		pTracer->setSettings(settings);
+
+		// The environment map's sampling tables are cached next to the BVH
+		if (settings.envMapSampling && settings.doIndirectGI && opts.has("bvh-cache") && pScene->getEnvironmentMap().getWidth() > 0)
+		{
+			pTracer->setEnvMapSampler(EnvMapSampler::createCached(pScene->getEnvironmentMap(), opts.getString("bvh-cache"), pPool, &loaded));
+			if (loaded) std::printf("Loaded the environment map tables from %s\n", EnvMapSampler::getCachePath(pScene->getEnvironmentMap(), opts.getString("bvh-cache")).c_str());
+		}
+		return pTracer;
+	}
+
+	/** Frames from --input, --capture, --synthetic or --scene
+	*/
+	class FrameSource
+	{
+	public:
+		/** Prints the problem and returns false if the options don't name a usable source
+		*/
+		bool open(const Options &opts, CpuThreadPool::SharedPtr pPool, const char *defaultSynthetic = nullptr)
+		{
+			mInputDir = opts.getString("input");
+
+			uint32_t synthWidth = 0, synthHeight = 0;
+			const std::string synthetic = opts.getString("synthetic", (defaultSynthetic && mInputDir.empty()) ? defaultSynthetic : "");
+			if (!synthetic.empty() && !parseSize(synthetic, synthWidth, synthHeight))
+			{
+				std::fprintf(stderr, "--synthetic expects a size such as 1920x1080\n");
+				return false;
+			}
+
+			if (opts.has("capture"))
+			{
+				mpCapture = CaptureReader::open(opts.getString("capture"));
+				if (!mpCapture)
+				{
+					std::fprintf(stderr, "Cannot open capture %s\n", opts.getString("capture").c_str());
+					return false;
+				}
+			}
+			else if (opts.has("scene"))
+			{
+				mpTracer = createPathTracer(opts, pPool);
+				if (!mpTracer) return false;
+			}
+			else if (synthWidth > 0)
+			{
+				mpSynth = SyntheticFrameSource::create(synthWidth, synthHeight, opts.getFloat("pan", 0.0f), pPool);
+			}
+			else if (mInputDir.empty())
+			{
+				std::fprintf(stderr, "Specify one of --input <dir>, --capture <file>, --synthetic <WxH> or --scene <file>\n");
+				return false;
+			}
+			return true;
+		}
+
+		/** Frames in a capture, 0 for the other (unbounded) sources
+		*/
+		uint32_t getFrameCount() const { return mpCapture ? mpCapture->getFrameCount() : 0; }
+
+		/** Returns nullptr (after printing why) if the frame can't be read
+		*/
+		const FrameInputs *getFrame(uint32_t frame)
+		{
+			if (mpSynth) return &mpSynth->renderFrame(frame);
+			if (mpTracer) return &mpTracer->renderFrame(frame);
+			return readFrame(frame, mStorage) ? mStorage.pInputs : nullptr;
+		}
+
+		/** Read a frame into storage the caller owns, so frames read into different storage stay valid together
+		*/
+		bool readFrame(uint32_t frame, FrameStorage &storage)
+		{
+			storage.pInputs = nullptr;
+			if (mpSynth)
+			{
+				storage.loaded.copy(mpSynth->renderFrame(frame));
+				storage.pInputs = &storage.loaded.inputs;
+			}
+			else if (mpTracer)
+			{
+				storage.loaded.copy(mpTracer->renderFrame(frame));
+				storage.pInputs = &storage.loaded.inputs;
+			}
+			else if (mpCapture)
+			{
+				if (!mpCapture->readFrame(frame, storage.captured))
+				{
+					std::fprintf(stderr, "Cannot read frame %u of the capture (%u frames)\n", frame, mpCapture->getFrameCount());
+					return false;
+				}
+				storage.pInputs = &storage.captured.inputs;
+			}
+			else if (storage.loaded.load(mInputDir, frame))
+			{
+				storage.pInputs = &storage.loaded.inputs;
+			}
+			return storage.pInputs != nullptr;
+		}
+
+	private:
+		std::string                     mInputDir;
+		SyntheticFrameSource::SharedPtr mpSynth;
+		CpuPathTracer::SharedPtr        mpTracer;
+		CaptureReader::SharedPtr        mpCapture;
+		FrameStorage                    mStorage;
+	};
+
+	CpuSVGFFilter::Settings readSettings(const Options &opts)
+	{
+		// A preset sets the sliders; options given next to it override them
+		CpuSVGFFilter::Settings settings;
+		if (opts.has("preset"))
+		{
+			FilterPreset preset = getPreset(settings);
+			std::string error;
+			if (loadPreset(opts.getString("preset"), preset, error)) applyPreset(preset, settings);
+			else std::fprintf(stderr, "Cannot load the preset, using the defaults:  %s\n", error.c_str());
+		}
+		settings.filterIterations  = opts.getInt("iterations", settings.filterIterations);
+		settings.feedbackTap       = opts.getInt("feedback", settings.feedbackTap);
+		settings.phiColor          = opts.getFloat("phi-color", settings.phiColor);
+		settings.phiNormal         = opts.getFloat("phi-normal", settings.phiNormal);
+		settings.alpha             = opts.getFloat("alpha", settings.alpha);
+		settings.momentsAlpha      = opts.getFloat("moments-alpha", settings.momentsAlpha);
+		settings.filterEnabled     = !opts.has("no-filter");
+		settings.simdAtrous        = !opts.has("scalar-atrous");
+		settings.fusedReprojection = opts.has("fused");
+		settings.blitFree          = opts.has("blit-free");
+		settings.adaptiveAtrous         = opts.has("adaptive");
+		settings.adaptiveFirstIteration = opts.getInt("adaptive-first", settings.adaptiveFirstIteration);
+		settings.adaptiveMinHistory     = opts.getFloat("adaptive-min-history", settings.adaptiveMinHistory);
+		settings.adaptiveNoiseThreshold = opts.getFloat("adaptive-threshold", settings.adaptiveNoiseThreshold);
+		settings.indirectScale          = opts.getInt("indirect-scale", settings.indirectScale);
+		settings.geometryWeightCache    = opts.has("geometry-cache");
+		settings.atrousRadius           = opts.getInt("radius", settings.atrousRadius) == 1 ? 1 : 2;
+
+		const std::string channels = opts.getString("channels", "both");
+		settings.atrousChannels = channels == "direct" ? kDirectChannel : channels == "indirect" ? kIndirectChannel : kBothChannels;
+
+		if (opts.has("storage"))
+		{
+			const std::string name = opts.getString("storage");
+			for (uint32_t i = 0; i < uint32_t(StorageFormat::Count); i++)
+			{
+				if (name == getStorageFormatName(StorageFormat(i))) settings.storageFormat = StorageFormat(i);
+			}
+		}
+
+		settings.simdIsa = readSimdIsa(opts, settings.simdIsa);
+		return settings;
+	}
+
+	int runFilter(const Options &opts)
+	{
+		const std::string outputDir = opts.getString("output");
+		const uint32_t firstFrame   = uint32_t(std::max(0, opts.getInt("first", 0)));
+		const uint32_t loopCount    = uint32_t(std::max(1, opts.getInt("loop", 1)));
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		FrameSource source;
+		if (!source.open(opts, pPool)) return 1;
+
+		// A capture plays to its end by default
+		const uint32_t available  = source.getFrameCount() > firstFrame ? source.getFrameCount() - firstFrame : 1;
+		const uint32_t frameCount = uint32_t(std::max(1, opts.getInt("frames", source.getFrameCount() ? int(available) : 1)));
+
+		CpuSVGFFilter::SharedPtr pFilter = CpuSVGFFilter::create(pPool);
+		pFilter->setSettings(readSettings(opts));
+		pFilter->setTileSize(uint32_t(std::max(8, opts.getInt("tile", 32))));
+
+		std::printf("Filtering %u frame(s) on %u thread(s)\n", frameCount * loopCount, pPool->getThreadCount());
+
+		// Keep every frame's timings, so the percentiles cover the whole run
+		StageTimer::SharedPtr pTimer = StageTimer::create(nullptr, frameCount * loopCount);
+		const uint32_t readStage = pTimer->getStageId("read inputs");
+		pFilter->setStageTimer(pTimer);
+
+		StageTraffic traffic;
+		ImageF4 output;
+		auto sequenceStart = std::chrono::steady_clock::now();
+
+		for (uint32_t n = 0; n < frameCount * loopCount; n++)
+		{
+			const uint32_t f = firstFrame + n % frameCount;
+
+			// Resolved with the filter's stages when execute() ends the timer frame
+			pTimer->begin(readStage);
+			const FrameInputs *pInputs = source.getFrame(f);
+			pTimer->end(readStage);
+			if (!pInputs) return 1;
+
+			if (!pFilter->execute(*pInputs, output))
+			{
+				std::fprintf(stderr, "Frame %u: inputs are incomplete or do not all have the same size\n", f);
+				return 1;
+			}
+
+			traffic.bytesRead    += pFilter->getLastTraffic().bytesRead;
+			traffic.bytesWritten += pFilter->getLastTraffic().bytesWritten;
+
+			if (!outputDir.empty())
+			{
+				std::string path = framePath(outputDir, kOutputChannel, f, ".pfm");
+				if (!saveImage(path, output))
+				{
+					std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+					return 1;
+				}
+			}
+		}
+
+		const double sequenceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sequenceStart).count();
+
+		const uint32_t framesRun = frameCount * loopCount;
+		std::printf("Per-stage wall time over %u frame(s) at %ux%u:\n", framesRun, pFilter->getWidth(), pFilter->getHeight());
+		printStageTimer(*pTimer);
+
+		const double mb = 1024.0 * 1024.0 * framesRun;
+		std::printf("Reprojection + moment filter traffic (%s):  %.1f MB read, %.1f MB written per frame\n",
+		            pFilter->getSettings().fusedReprojection ? "fused tile pass" : "separate passes",
+		            traffic.bytesRead / mb, traffic.bytesWritten / mb);
+		std::printf("%.2f frames/s end to end\n", framesRun / sequenceSeconds);
+
+		const AdaptiveStats &adaptive = pFilter->getLastAdaptiveStats();
+		if (!adaptive.activeTiles.empty())
+		{
+			std::printf("Adaptive a-trous, tiles filtered per iteration in the last frame:");
+			for (uint32_t active : adaptive.activeTiles) std::printf(" %.1f%%", 100.0 * active / adaptive.tileCount);
+			std::printf("\n");
+		}
+		return 0;
+	}
+
+	/** Time one stage of the stream pipeline spent working, waiting for its input (starved) and waiting for room
+	    downstream (blocked by backpressure)
+	*/
+	struct StreamStageStats
+	{
+		double   busyMs = 0.0, starvedMs = 0.0, blockedMs = 0.0;
+		uint32_t frames = 0;
+
+		void print(const char *name) const
+		{
+			const double n = std::max(1u, frames);
+			std::printf("  %-8s %8u %12.3f %12.1f %12.3f %12.1f %12.3f\n", name, frames, busyMs / n,
+			            starvedMs, starvedMs / n, blockedMs, blockedMs / n);
+		}
+	};
+
+	int runStream(const Options &opts)
+	{
+		using Clock = std::chrono::steady_clock;
+		auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+
+		const std::string outputDir  = opts.getString("output");
+		const std::string extension  = "." + opts.getString("format", "pfm");
+		const uint32_t    firstFrame = uint32_t(std::max(0, opts.getInt("first", 0)));
+		const uint32_t    depth      = uint32_t(std::max(0, opts.getInt("queue-depth", 2)));
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		FrameSource source;
+		if (!source.open(opts, pPool)) return 1;
+
+		const uint32_t available  = source.getFrameCount() > firstFrame ? source.getFrameCount() - firstFrame : 1;
+		const uint32_t frameCount = uint32_t(std::max(1, opts.getInt("frames", source.getFrameCount() ? int(available) : 16)));
+
+		CpuSVGFFilter::SharedPtr pFilter = CpuSVGFFilter::create(pPool);
+		pFilter->setSettings(readSettings(opts));
+		pFilter->setTileSize(uint32_t(std::max(8, opts.getInt("tile", 32))));
+
+		auto writeFrame = [&](uint32_t frame, const ImageF4 &image)
+		{
+			if (outputDir.empty()) return true;
+			const std::string path = framePath(outputDir, kOutputChannel, frame, extension.c_str());
+			if (saveImage(path, image)) return true;
+			std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+			return false;
+		};
+
+		StreamStageStats read, filter, write;
+		bool failed = false;
+		const Clock::time_point start = Clock::now();
+
+		if (depth == 0)
+		{
+			// The naive loop, for comparison
+			FrameStorage storage;
+			ImageF4 output;
+			for (uint32_t n = 0; n < frameCount && !failed; n++)
+			{
+				const uint32_t f = firstFrame + n;
+				const Clock::time_point t0 = Clock::now();
+				failed = !source.readFrame(f, storage);
+				const Clock::time_point t1 = Clock::now();
+				failed = failed || !pFilter->execute(*storage.pInputs, output);
+				const Clock::time_point t2 = Clock::now();
+				failed = failed || !writeFrame(f, output);
+				const Clock::time_point t3 = Clock::now();
+
+				read.busyMs   += ms(t0, t1);  read.frames++;
+				filter.busyMs += ms(t1, t2);  filter.frames++;
+				write.busyMs  += ms(t2, t3);  write.frames++;
+			}
+		}
+		else
+		{
+			// Slots cycle from a free list through the stages and back; a stage that runs ahead waits on the free
+			//    list of the stage after it, which bounds the frames in flight to depth on each side of the filter.
+			struct InputSlot  { uint32_t frame = 0; FrameStorage storage; };
+			struct OutputSlot { uint32_t frame = 0; ImageF4 image; };
+			std::vector<InputSlot>    inputSlots(depth);
+			std::vector<OutputSlot>   outputSlots(depth);
+			BoundedQueue<InputSlot *>  freeInputs(depth), toFilter(depth);
+			BoundedQueue<OutputSlot *> freeOutputs(depth), toWrite(depth);
+			for (InputSlot &slot : inputSlots)   freeInputs.push(&slot);
+			for (OutputSlot &slot : outputSlots) freeOutputs.push(&slot);
+
+			std::atomic<bool> aborted(false);
+			auto abort = [&]()
+			{
+				aborted = true;
+				freeInputs.close();
+				toFilter.close();
+				freeOutputs.close();
+				toWrite.close();
+			};
+
+			std::thread reader([&]()
+			{
+				for (uint32_t n = 0; n < frameCount; n++)
+				{
+					InputSlot *pSlot = nullptr;
+					const Clock::time_point t0 = Clock::now();
+					if (!freeInputs.pop(pSlot)) break;
+					const Clock::time_point t1 = Clock::now();
+					pSlot->frame = firstFrame + n;
+					if (!source.readFrame(pSlot->frame, pSlot->storage)) { abort(); break; }
+					read.blockedMs += ms(t0, t1);
+					read.busyMs    += ms(t1, Clock::now());
+					read.frames++;
+					if (!toFilter.push(pSlot)) break;
+				}
+				toFilter.close();
+			});
+
+			std::thread writer([&]()
+			{
+				for (;;)
+				{
+					OutputSlot *pSlot = nullptr;
+					const Clock::time_point t0 = Clock::now();
+					if (!toWrite.pop(pSlot)) break;
+					const Clock::time_point t1 = Clock::now();
+					if (!writeFrame(pSlot->frame, pSlot->image)) { abort(); break; }
+					write.starvedMs += ms(t0, t1);
+					write.busyMs    += ms(t1, Clock::now());
+					write.frames++;
+					freeOutputs.push(pSlot);
+				}
+			});
+
+			// Filter on this thread.  Frames arrive in order, so the temporal history carries over exactly as in filter.
+			for (;;)
+			{
+				InputSlot  *pIn  = nullptr;
+				OutputSlot *pOut = nullptr;
+				const Clock::time_point t0 = Clock::now();
+				if (!toFilter.pop(pIn)) break;
+				const Clock::time_point t1 = Clock::now();
+				if (!freeOutputs.pop(pOut)) break;
+				const Clock::time_point t2 = Clock::now();
+				if (!pFilter->execute(*pIn->storage.pInputs, pOut->image))
+				{
+					std::fprintf(stderr, "Frame %u: inputs are incomplete or do not all have the same size\n", pIn->frame);
+					abort();
+					break;
+				}
+				pOut->frame = pIn->frame;
+				const Clock::time_point t3 = Clock::now();
+				freeInputs.push(pIn);
+				toWrite.push(pOut);
+
+				filter.starvedMs += ms(t0, t1);
+				filter.blockedMs += ms(t1, t2);
+				filter.busyMs    += ms(t2, t3);
+				filter.frames++;
+			}
+			toWrite.close();
+
+			reader.join();
+			writer.join();
+			failed = aborted;
+		}
+
+		const double seconds = ms(start, Clock::now()) / 1000.0;
+		if (failed) return 1;
+
+		std::printf("Streamed %u frame(s) at %ux%u on %u thread(s), %s:  %.2f frames/s\n", frameCount, pFilter->getWidth(),
+		            pFilter->getHeight(), pPool->getThreadCount(), depth ? (std::to_string(depth) + " frame(s) in flight per queue").c_str() : "one stage at a time",
+		            frameCount / seconds);
+		std::printf("  %-8s %8s %12s %12s %12s %12s %12s\n", "stage", "frames", "busy ms/f", "starved ms", "starved ms/f", "blocked ms", "blocked ms/f");
+		read.print("read");
+		filter.print("filter");
+		write.print("write");
+		return 0;
+	}
+
+	int runReplay(const Options &opts)
+	{
+		if (!opts.has("capture"))
+		{
+			std::fprintf(stderr, "replay needs --capture <file>\n");
+			return 1;
+		}
+		return runFilter(opts);
+	}
+
+	int runCapture(const Options &opts)
+	{
+		const std::string path    = opts.getString("output");
+		const uint32_t frameCount = uint32_t(std::max(1, opts.getInt("frames", 1)));
+		const uint32_t firstFrame = uint32_t(std::max(0, opts.getInt("first", 0)));
+		if (path.empty())
+		{
+			std::fprintf(stderr, "capture needs --output <file>\n");
+			return 1;
+		}
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		FrameSource source;
+		if (!source.open(opts, pPool)) return 1;
+
+		CaptureWriter::SharedPtr pWriter;
+		for (uint32_t f = firstFrame; f < firstFrame + frameCount; f++)
+		{
+			const FrameInputs *pInputs = source.getFrame(f);
+			if (!pInputs) return 1;
+
+			// Size the capture after the first frame
+			if (!pWriter)
+			{
+				pWriter = CaptureWriter::create(path, pInputs->directIllum->getWidth(), pInputs->directIllum->getHeight(), opts.has("compress"));
+				if (!pWriter)
+				{
+					std::fprintf(stderr, "Cannot create %s\n", path.c_str());
+					return 1;
+				}
+			}
+
+			if (!pWriter->addFrame(*pInputs))
+			{
+				std::fprintf(stderr, "Frame %u: inputs are incomplete, mis-sized, or the write failed\n", f);
+				return 1;
+			}
+		}
+
+		if (!pWriter->close())
+		{
+			std::fprintf(stderr, "Cannot finish writing %s\n", path.c_str());
+			return 1;
+		}
+
+		const double mb = 1024.0 * 1024.0;
+		std::printf("Captured %u frame(s) to %s:  %.1f MB of texels stored in %.1f MB (%.2fx)\n", pWriter->getFrameCount(), path.c_str(),
+		            pWriter->getRawBytes() / mb, pWriter->getStoredBytes() / mb, double(pWriter->getRawBytes()) / double(std::max<uint64_t>(1, pWriter->getStoredBytes())));
+		return 0;
+	}
+
+	/** Largest absolute and relative (to the reference value) difference over the rgb channels
+	*/
+	void compareImages(const ImageF4 &image, const ImageF4 &reference, double &maxAbs, double &maxRel)
+	{
+		maxAbs = maxRel = 0.0;
+		for (uint32_t y = 0; y < reference.getHeight(); y++)
+		{
+			for (uint32_t x = 0; x < reference.getWidth(); x++)
+			{
+				const float4 &a = image.at(x, y), &b = reference.at(x, y);
+				for (float d : { a.x - b.x, a.y - b.y, a.z - b.z })
+					maxAbs = std::max(maxAbs, double(std::abs(d)));
+				for (float2 v : { float2(a.x, b.x), float2(a.y, b.y), float2(a.z, b.z) })
+					maxRel = std::max(maxRel, double(std::abs(v.x - v.y) / std::max(std::abs(v.y), 1e-3f)));
+			}
+		}
+	}
+
+	int runCompareStorage(const Options &opts)
+	{
+		uint32_t width = 640, height = 360;
+		if (opts.has("synthetic") && !parseSize(opts.getString("synthetic"), width, height))
+		{
+			std::fprintf(stderr, "--synthetic expects a size such as 1920x1080\n");
+			return 1;
+		}
+		const uint32_t frameCount = uint32_t(std::max(1, opts.getInt("frames", 16)));
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		SyntheticFrameSource::SharedPtr pSynth = SyntheticFrameSource::create(width, height, opts.getFloat("pan", 0.02f), pPool);
+
+		// One filter per format, all fed the same frames.  The first one is the full precision reference.
+		const uint32_t formatCount = uint32_t(StorageFormat::Count);
+		std::vector<CpuSVGFFilter::SharedPtr> filters;
+		std::vector<ImageF4> outputs(formatCount);
+		std::vector<StageStats> rmse(formatCount);
+		std::vector<double> maxRel(formatCount, 0.0);
+		for (uint32_t i = 0; i < formatCount; i++)
+		{
+			CpuSVGFFilter::Settings settings = readSettings(opts);
+			settings.storageFormat = StorageFormat(i);
+			filters.push_back(CpuSVGFFilter::create(pPool));
+			filters.back()->setSettings(settings);
+		}
+
+		for (uint32_t f = 0; f < frameCount; f++)
+		{
+			const FrameInputs &inputs = pSynth->renderFrame(f);
+			for (uint32_t i = 0; i < formatCount; i++)
+			{
+				if (!filters[i]->execute(inputs, outputs[i])) return 1;
+			}
+
+			for (uint32_t i = 1; i < formatCount; i++)
+			{
+				double sumSq = 0.0;
+				for (uint32_t y = 0; y < height; y++)
+				{
+					for (uint32_t x = 0; x < width; x++)
+					{
+						const float4 &a = outputs[i].at(x, y), &b = outputs[0].at(x, y);
+						for (float2 v : { float2(a.x, b.x), float2(a.y, b.y), float2(a.z, b.z) })
+						{
+							sumSq += double(v.x - v.y) * double(v.x - v.y);
+							maxRel[i] = std::max(maxRel[i], double(std::abs(v.x - v.y) / std::max(std::abs(v.y), 1e-2f)));
+						}
+					}
+				}
+				rmse[i].add(std::sqrt(sumSq / (3.0 * width * height)));
+			}
+		}
+
+		std::printf("Storage formats over %u frame(s) at %ux%u, error against full precision\n", frameCount, width, height);
+		std::printf("  %-8s %12s %12s %12s %12s %12s %12s\n", "format", "bytes/pixel", "MB here", "MB at 4K", "avg RMSE", "max RMSE", "max rel err");
+		for (uint32_t i = 0; i < formatCount; i++)
+		{
+			const uint32_t bpp = getFilterStateBytesPerPixel(StorageFormat(i));
+			std::printf("  %-8s %12u %12.1f %12.1f", getStorageFormatName(StorageFormat(i)), bpp,
+			            double(bpp) * width * height / (1024.0 * 1024.0), double(bpp) * 3840.0 * 2160.0 / (1024.0 * 1024.0));
+			if (i == 0) std::printf(" %12s %12s %12s\n", "-", "-", "-");
+			else        std::printf(" %12.3e %12.3e %12.3e\n", rmse[i].sumMs / rmse[i].count, rmse[i].maxMs, maxRel[i]);
+		}
+		return 0;
+	}
+
+	int runCompareBlitFree(const Options &opts)
+	{
+		uint32_t width = 320, height = 180;
+		if (opts.has("synthetic") && !parseSize(opts.getString("synthetic"), width, height))
+		{
+			std::fprintf(stderr, "--synthetic expects a size such as 1920x1080\n");
+			return 1;
+		}
+		const uint32_t frameCount = uint32_t(std::max(1, opts.getInt("frames", 8)));
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		SyntheticFrameSource::SharedPtr pSynth = SyntheticFrameSource::create(width, height, opts.getFloat("pan", 0.02f), pPool);
+
+		std::printf("Blit-free against copying bookkeeping over %u frame(s) at %ux%u\n", frameCount, width, height);
+		std::printf("  %-10s %-9s %-9s %16s %16s %s\n", "a-trous", "feedback", "reproj", "copied MB/frame", "blit-free MB", "output");
+
+		int mismatches = 0;
+		const CpuSVGFFilter::Settings base = readSettings(opts);
+		for (int config = 0; config < 16; config++)
+		{
+			// Adaptive a-trous only exists on the vectorized path
+			if ((config & 8) && !(config & 1)) continue;
+
+			CpuSVGFFilter::Settings settings = base;
+			settings.simdAtrous        = (config & 1) != 0;
+			settings.adaptiveAtrous    = (config & 8) != 0;
+			settings.feedbackTap       = (config & 2) ? -1 : base.feedbackTap;
+			settings.fusedReprojection = (config & 4) != 0;
+
+			CpuSVGFFilter::SharedPtr pFilters[2];
+			ImageF4 outputs[2];
+			uint64_t copied[2] = { 0, 0 };
+			for (int i = 0; i < 2; i++)
+			{
+				settings.blitFree = (i == 1);
+				pFilters[i] = CpuSVGFFilter::create(pPool);
+				pFilters[i]->setSettings(settings);
+			}
+
+			uint32_t firstMismatch = frameCount;
+			for (uint32_t f = 0; f < frameCount; f++)
+			{
+				const FrameInputs &inputs = pSynth->renderFrame(f);
+				for (int i = 0; i < 2; i++)
+				{
+					if (!pFilters[i]->execute(inputs, outputs[i])) return 1;
+					copied[i] += pFilters[i]->getLastTraffic().bytesCopied;
+				}
+				if (firstMismatch == frameCount && std::memcmp(outputs[0].getData(), outputs[1].getData(), outputs[0].getByteSize()) != 0)
+					firstMismatch = f;
+			}
+
+			const double mb = 1024.0 * 1024.0 * frameCount;
+			std::printf("  %-10s %-9s %-9s %16.2f %16.2f ", settings.adaptiveAtrous ? "adaptive" : settings.simdAtrous ? "vectorized" : "reference",
+			            (config & 2) ? "off" : "on", settings.fusedReprojection ? "fused" : "separate", copied[0] / mb, copied[1] / mb);
+			if (firstMismatch == frameCount) std::printf("identical\n");
+			else                             std::printf("DIFFERS from frame %u\n", firstMismatch);
+			mismatches += (firstMismatch == frameCount) ? 0 : 1;
+		}
+
+		std::printf(mismatches ? "%d configuration(s) differ\n" : "All outputs are bit-identical\n", mismatches);
+		return mismatches ? 1 : 0;
+	}
+
+	/** Squared and relative squared error of image against reference over the rgb channels, accumulated over frames
+	*/
+	struct ErrorSums
+	{
+		double   sumSq    = 0.0;
+		double   sumRelSq = 0.0;
+		double   maxRel   = 0.0;
+		uint64_t count    = 0;
+
+		void add(const ImageF4 &image, const ImageF4 &reference)
+		{
+			for (uint32_t y = 0; y < reference.getHeight(); y++)
+			{
+				for (uint32_t x = 0; x < reference.getWidth(); x++)
+				{
+					const float4 &a = image.at(x, y), &b = reference.at(x, y);
+					for (float2 v : { float2(a.x, b.x), float2(a.y, b.y), float2(a.z, b.z) })
+					{
+						const double d = double(v.x) - double(v.y);
+						sumSq    += d * d;
+						sumRelSq += d * d / (double(v.y) * double(v.y) + 1e-2);
+						maxRel    = std::max(maxRel, std::abs(d) / std::max(std::abs(double(v.y)), 1e-2));
+					}
+					count += 3;
+				}
+			}
+		}
+
+		double rmse() const   { return count ? std::sqrt(sumSq / count) : 0.0; }
+		double relMse() const { return count ? sumRelSq / count : 0.0; }
+	};
+
+	int runCompareIndirect(const Options &opts)
+	{
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		FrameSource source;
+		if (!source.open(opts, pPool, "960x540")) return 1;
+
+		const uint32_t frameCount  = uint32_t(std::max(2, opts.getInt("frames", source.getFrameCount() ? int(source.getFrameCount()) : 32)));
+		const uint32_t warmupCount = std::min(8u, frameCount / 2);
+
+		// Full resolution first; it is the reference for the others
+		const int32_t scales[] = { 1, 2, 4 };
+		const uint32_t count = uint32_t(sizeof(scales) / sizeof(scales[0]));
+		CpuSVGFFilter::SharedPtr pFilters[count];
+		ImageF4 outputs[count];
+		StageTimings timings[count];
+		for (uint32_t i = 0; i < count; i++)
+		{
+			CpuSVGFFilter::Settings settings = readSettings(opts);
+			settings.indirectScale = scales[i];
+			pFilters[i] = CpuSVGFFilter::create(pPool);
+			pFilters[i]->setSettings(settings);
+		}
+
+		MetricsEvaluator::Settings metricsSettings;
+		metricsSettings.exposure        = opts.getFloat("exposure", metricsSettings.exposure);
+		metricsSettings.pixelsPerDegree = opts.getFloat("ppd", metricsSettings.pixelsPerDegree);
+		metricsSettings.simdIsa         = readSimdIsa(opts, metricsSettings.simdIsa);
+		MetricsEvaluator::SharedPtr pMetrics = MetricsEvaluator::create(metricsSettings, pPool);
+		MetricsReference reference;
+		MetricsSequence sequences[count];
+		FrameMetrics errors[count];
+		for (FrameMetrics &e : errors) e.ssim = 0.0;
+		uint32_t flickerFrames = 0;
+
+		for (uint32_t f = 0; f < frameCount; f++)
+		{
+			const FrameInputs *pInputs = source.getFrame(f);
+			if (!pInputs) return 1;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (!pFilters[i]->execute(*pInputs, outputs[i])) return 1;
+			}
+
+			// Flicker needs the frame before the first measured one
+			if (f + 1 < warmupCount) continue;
+			pMetrics->prepareReference(outputs[0], reference);
+			for (uint32_t i = 1; i < count; i++)
+			{
+				FrameMetrics metrics;
+				pMetrics->evaluate(outputs[i], reference, sequences[i], metrics);
+				if (f < warmupCount) continue;
+				errors[i].rmse    += metrics.rmse;
+				errors[i].relMse  += metrics.relMse;
+				errors[i].ssim    += metrics.ssim;
+				errors[i].flip    += metrics.flip;
+				errors[i].flicker += metrics.flicker;
+			}
+			if (f < warmupCount) continue;
+			if (f > 0) flickerFrames++;
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const StageTimings &t = pFilters[i]->getLastTimings();
+				timings[i].reprojection     += t.reprojection + t.varianceEstimate;
+				timings[i].atrous           += t.atrous + t.modulation;
+				timings[i].lowResIndirect   += t.lowResIndirect;
+				timings[i].upsample         += t.upsample;
+				timings[i].total            += t.total;
+			}
+		}
+
+		const double timed = double(frameCount - warmupCount);
+		std::printf("Indirect resolution over frames %u..%u at %ux%u, average ms per frame and error against full resolution\n",
+		            warmupCount, frameCount - 1, pFilters[0]->getWidth(), pFilters[0]->getHeight());
+		std::printf("  %-6s %13s %13s %13s %13s %10s %8s %11s %11s %8s %8s %9s\n", "scale", "reproj+moms", "a-trous+mod",
+		            "low-res ind.", "upsample", "total", "speedup", "RMSE", "relMSE", "SSIM", "FLIP", "flicker");
+		for (uint32_t i = 0; i < count; i++)
+		{
+			std::printf("  1/%-4d %13.3f %13.3f %13.3f %13.3f %10.3f %7.2fx", scales[i], timings[i].reprojection / timed,
+			            timings[i].atrous / timed, timings[i].lowResIndirect / timed, timings[i].upsample / timed,
+			            timings[i].total / timed, timings[0].total / timings[i].total);
+			if (i == 0) std::printf(" %11s %11s %8s %8s %9s\n", "-", "-", "-", "-", "-");
+			else        std::printf(" %11.3e %11.3e %8.5f %8.5f %9.5f\n", errors[i].rmse / timed, errors[i].relMse / timed, errors[i].ssim / timed,
+			                        errors[i].flip / timed, flickerFrames ? errors[i].flicker / flickerFrames : 0.0);
+		}
+		return 0;
+	}
+
+	int runBenchAdaptive(const Options &opts)
+	{
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		FrameSource source;
+		if (!source.open(opts, pPool, "960x540")) return 1;
+
+		const uint32_t frameCount  = uint32_t(std::max(2, opts.getInt("frames", source.getFrameCount() ? int(source.getFrameCount()) : 64)));
+		const uint32_t warmupCount = frameCount / 2;
+
+		// The same settings, with and without culling
+		CpuSVGFFilter::Settings settings = readSettings(opts);
+		CpuSVGFFilter::SharedPtr pFilters[2];
+		ImageF4 outputs[2];
+		for (int i = 0; i < 2; i++)
+		{
+			settings.adaptiveAtrous = (i == 1);
+			pFilters[i] = CpuSVGFFilter::create(pPool);
+			pFilters[i]->setSettings(settings);
+		}
+
+		double atrousMs[2] = { 0.0, 0.0 }, totalMs[2] = { 0.0, 0.0 };
+		std::vector<double> activeFraction;
+		double sumSq = 0.0, maxRel = 0.0;
+		uint32_t tileCount = 0;
+
+		for (uint32_t f = 0; f < frameCount; f++)
+		{
+			const FrameInputs *pInputs = source.getFrame(f);
+			if (!pInputs) return 1;
+			for (int i = 0; i < 2; i++)
+			{
+				if (!pFilters[i]->execute(*pInputs, outputs[i])) return 1;
+			}
+			if (f < warmupCount) continue;
+
+			for (int i = 0; i < 2; i++)
+			{
+				atrousMs[i] += pFilters[i]->getLastTimings().atrous;
+				totalMs[i]  += pFilters[i]->getLastTimings().total;
+			}
+
+			const AdaptiveStats &stats = pFilters[1]->getLastAdaptiveStats();
+			tileCount = stats.tileCount;
+			activeFraction.resize(stats.activeTiles.size(), 0.0);
+			for (size_t k = 0; k < stats.activeTiles.size(); k++) activeFraction[k] += double(stats.activeTiles[k]) / stats.tileCount;
+
+			for (uint32_t y = 0; y < outputs[0].getHeight(); y++)
+			{
+				for (uint32_t x = 0; x < outputs[0].getWidth(); x++)
+				{
+					const float4 &a = outputs[1].at(x, y), &b = outputs[0].at(x, y);
+					for (float2 v : { float2(a.x, b.x), float2(a.y, b.y), float2(a.z, b.z) })
+					{
+						sumSq += double(v.x - v.y) * double(v.x - v.y);
+						maxRel = std::max(maxRel, double(std::abs(v.x - v.y) / std::max(std::abs(v.y), 1e-2f)));
+					}
+				}
+			}
+		}
+
+		const uint32_t timed = frameCount - warmupCount;
+		const double   pixels = double(outputs[0].getWidth()) * outputs[0].getHeight();
+		std::printf("Adaptive a-trous over frames %u..%u at %ux%u (%u tiles of %ux%u, threshold %.3f, min history %.1f)\n",
+		            warmupCount, frameCount - 1, outputs[0].getWidth(), outputs[0].getHeight(), tileCount,
+		            CpuSVGFFilter::kAdaptiveTileSize, CpuSVGFFilter::kAdaptiveTileSize, settings.adaptiveNoiseThreshold, settings.adaptiveMinHistory);
+		std::printf("  tiles filtered per iteration:");
+		for (double fraction : activeFraction) std::printf(" %.1f%%", 100.0 * fraction / timed);
+		std::printf("\n");
+		std::printf("  a-trous   every tile %9.3f ms   adaptive %9.3f ms   speedup %.2fx\n", atrousMs[0] / timed, atrousMs[1] / timed, atrousMs[0] / atrousMs[1]);
+		std::printf("  frame     every tile %9.3f ms   adaptive %9.3f ms   speedup %.2fx\n", totalMs[0] / timed, totalMs[1] / timed, totalMs[0] / totalMs[1]);
+		std::printf("  adaptive against every tile:  RMSE %.3e, max rel err %.3e\n", std::sqrt(sumSq / (3.0 * pixels * timed)), maxRel);
+		return 0;
+	}
+
+	int runBenchGeometryCache(const Options &opts)
+	{
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		FrameSource source;
+		if (!source.open(opts, pPool, "960x540")) return 1;
+
+		const uint32_t frameCount  = uint32_t(std::max(2, opts.getInt("frames", source.getFrameCount() ? int(source.getFrameCount()) : 16)));
+		const uint32_t warmupCount = frameCount / 2;
+		const uint32_t timed       = frameCount - warmupCount;
+
+		CpuSVGFFilter::Settings settings = readSettings(opts);
+		std::printf("Geometry weight cache over frames %u..%u (%s kernel)\n", warmupCount, frameCount - 1, getSimdIsaName(settings.simdIsa));
+		std::printf("  %-10s %12s %12s %12s %8s %10s %11s %11s\n", "iterations", "a-trous", "cached", "(pre-pass)",
+		            "speedup", "cache MB", "RMSE", "max rel err");
+
+		for (int32_t iterations : { 4, 5 })
+		{
+			// The same settings, with and without the cache
+			CpuSVGFFilter::SharedPtr pFilters[2];
+			ImageF4 outputs[2];
+			for (int i = 0; i < 2; i++)
+			{
+				settings.filterIterations    = iterations;
+				settings.geometryWeightCache = (i == 1);
+				pFilters[i] = CpuSVGFFilter::create(pPool);
+				pFilters[i]->setSettings(settings);
+			}
+
+			double atrousMs[2] = { 0.0, 0.0 }, prePassMs = 0.0;
+			double sumSq = 0.0, maxRel = 0.0;
+			for (uint32_t f = 0; f < frameCount; f++)
+			{
+				const FrameInputs *pInputs = source.getFrame(f);
+				if (!pInputs) return 1;
+				for (int i = 0; i < 2; i++)
+				{
+					if (!pFilters[i]->execute(*pInputs, outputs[i])) return 1;
+				}
+				if (f < warmupCount) continue;
+
+				for (int i = 0; i < 2; i++) atrousMs[i] += pFilters[i]->getLastTimings().atrous;
+				prePassMs += pFilters[1]->getLastTimings().geometryWeights;
+
+				for (uint32_t y = 0; y < outputs[0].getHeight(); y++)
+				{
+					for (uint32_t x = 0; x < outputs[0].getWidth(); x++)
+					{
+						const float4 &a = outputs[1].at(x, y), &b = outputs[0].at(x, y);
+						for (float2 v : { float2(a.x, b.x), float2(a.y, b.y), float2(a.z, b.z) })
+						{
+							sumSq += double(v.x - v.y) * double(v.x - v.y);
+							maxRel = std::max(maxRel, double(std::abs(v.x - v.y) / std::max(std::abs(v.y), 1e-2f)));
+						}
+					}
+				}
+			}
+
+			const double pixels  = double(outputs[0].getWidth()) * outputs[0].getHeight();
+			const double cacheMB = double(iterations) * kAtrousTapCount * getGeometryWeightPlaneSize(outputs[0].getWidth(), outputs[0].getHeight()) / (1024.0 * 1024.0);
+			std::printf("  %-10d %9.3f ms %9.3f ms %9.3f ms %7.2fx %10.1f %11.3e %11.3e\n", iterations, atrousMs[0] / timed,
+			            atrousMs[1] / timed, prePassMs / timed, atrousMs[0] / atrousMs[1], cacheMB,
+			            std::sqrt(sumSq / (3.0 * pixels * timed)), maxRel);
+		}
+		return 0;
+	}
+
+	int runBenchBatch(const Options &opts)
+	{
+		uint32_t width, height;
+		if (!parseSize(opts.getString("viewport", "160x90"), width, height))
+		{
+			std::fprintf(stderr, "--viewport expects a size such as 160x90\n");
+			return 1;
+		}
+		const uint32_t maxStreams  = uint32_t(std::min(std::max(1, opts.getInt("streams", 64)), 1024));
+		const uint32_t frameCount  = uint32_t(std::max(2, opts.getInt("frames", 8)));
+		const uint32_t warmupCount = frameCount / 2;
+		const bool     mixed       = opts.has("mixed");
+		const uint32_t tileSize    = uint32_t(std::max(8, opts.getInt("tile", 32)));
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+
+		// Stream s gets variant s % 3 of the viewport and settings when mixed, the first one otherwise
+		const uint32_t variantCount = mixed ? 3 : 1;
+		const CpuSVGFFilter::Settings base = readSettings(opts);
+		auto getSettings = [&](uint32_t variant)
+		{
+			CpuSVGFFilter::Settings settings = base;
+			settings.phiColor        *= 1.0f + 0.5f * variant;
+			settings.filterIterations = std::max(1, base.filterIterations + int(variant) - int(variantCount / 2));
+			return settings;
+		};
+
+		// A few frames per viewport, rendered up front so the benchmark only times filtering.  Stream s starts s
+		//    frames into the sequence, so streams of the same size still see different frames.
+		const uint32_t kRenderedFrames = 4;
+		std::vector<LoadedFrame> frames(variantCount * kRenderedFrames);
+		for (uint32_t v = 0; v < variantCount; v++)
+		{
+			const uint32_t w = std::max(8u, width * (4 - v) / 4), h = std::max(8u, height * (4 - v) / 4);
+			SyntheticFrameSource::SharedPtr pSource = SyntheticFrameSource::create(w, h, opts.getFloat("pan", 0.02f), pPool);
+			for (uint32_t f = 0; f < kRenderedFrames; f++) frames[v * kRenderedFrames + f].copy(pSource->renderFrame(f));
+		}
+		auto getInputs = [&](uint32_t variant, uint32_t stream, uint32_t frame) -> const FrameInputs &
+		{
+			return frames[variant * kRenderedFrames + (frame + stream) % kRenderedFrames].inputs;
+		};
+
+		// One filter per stream and the batch, run on the same frames
+		struct StreamState
+		{
+			uint32_t                           variant = 0;
+			CpuSVGFFilter::SharedPtr           pFilter;
+			CpuSVGFBatchFilter::StreamId       id = CpuSVGFBatchFilter::kInvalidStream;
+			ImageF4                            separate, batched;
+		};
+		std::vector<StreamState> streams;
+		CpuSVGFBatchFilter::SharedPtr pBatch;
+
+		auto addStream = [&](StreamState &state, uint32_t variant)
+		{
+			const FrameInputs &inputs = getInputs(variant, 0, 0);
+			state.variant = variant;
+			state.pFilter = CpuSVGFFilter::create(pPool);
+			state.pFilter->setSettings(getSettings(variant));
+			state.pFilter->setTileSize(tileSize);
+			state.id = pBatch->addStream(inputs.directIllum->getWidth(), inputs.directIllum->getHeight(), getSettings(variant));
+		};
+
+		// Filter frameCount frames both ways; returns false on failure
+		double separateMs = 0.0, batchedMs = 0.0;
+		float  maxDiff = 0.0f;
+		auto run = [&]()
+		{
+			using Clock = std::chrono::steady_clock;
+			separateMs = batchedMs = 0.0;
+			maxDiff    = 0.0f;
+			std::vector<CpuSVGFBatchFilter::BatchItem> items(streams.size());
+			for (uint32_t f = 0; f < frameCount; f++)
+			{
+				Clock::time_point start = Clock::now();
+				for (uint32_t s = 0; s < streams.size(); s++)
+				{
+					if (!streams[s].pFilter->execute(getInputs(streams[s].variant, s, f), streams[s].separate)) return false;
+				}
+				Clock::time_point split = Clock::now();
+				for (uint32_t s = 0; s < streams.size(); s++)
+				{
+					items[s].stream  = streams[s].id;
+					items[s].inputs  = getInputs(streams[s].variant, s, f);
+					items[s].pOutput = &streams[s].batched;
+				}
+				if (!pBatch->execute(items)) return false;
+				Clock::time_point end = Clock::now();
+
+				if (f >= warmupCount)
+				{
+					separateMs += std::chrono::duration<double, std::milli>(split - start).count();
+					batchedMs  += std::chrono::duration<double, std::milli>(end - split).count();
+				}
+				for (const StreamState &state : streams)
+				{
+					for (size_t i = 0; i < state.separate.getPixelCount(); i++)
+					{
+						const float4 &a = state.separate.getData()[i], &b = state.batched.getData()[i];
+						maxDiff = std::max({ maxDiff, std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z) });
+					}
+				}
+			}
+			separateMs /= frameCount - warmupCount;
+			batchedMs  /= frameCount - warmupCount;
+			return true;
+		};
+
+		std::printf("Batched filtering of %ux%u%s views over frames %u..%u on %u thread(s)\n", width, height,
+		            mixed ? " (and 3/4, 1/2 size)" : "", warmupCount, frameCount - 1, pPool->getThreadCount());
+		std::printf("  %7s %10s %14s %14s %9s %12s %10s\n", "streams", "Mpixels", "separate ms", "batched ms", "speedup", "pool MB", "max diff");
+		for (uint32_t count = 1;; count = std::min(count * 2, maxStreams))
+		{
+			pBatch = CpuSVGFBatchFilter::create(pPool);
+			pBatch->setTileSize(tileSize);
+			streams = std::vector<StreamState>(count);
+			for (uint32_t s = 0; s < count; s++) addStream(streams[s], s % variantCount);
+			if (!run()) return 1;
+
+			double pixels = 0.0;
+			for (const StreamState &state : streams) pixels += double(state.separate.getPixelCount());
+			std::printf("  %7u %10.2f %14.3f %14.3f %8.2fx %12.1f %10.3g\n", count, pixels * 1e-6, separateMs, batchedMs,
+			            separateMs / batchedMs, pBatch->getHistoryPool().getReservedBytes() / double(1 << 20), maxDiff);
+			if (maxDiff != 0.0f)
+			{
+				std::fprintf(stderr, "Batched output differs from separate filters\n");
+				return 1;
+			}
+			if (count == maxStreams) break;
+		}
+
+		// Replace every other stream with one of the next variant; the rest must keep filtering with their history
+		const HistoryPool &pool = pBatch->getHistoryPool();
+		const size_t reservedBefore = pool.getReservedBytes();
+		for (uint32_t s = 1; s < streams.size(); s += 2)
+		{
+			pBatch->removeStream(streams[s].id);
+			streams[s] = StreamState();
+		}
+		for (uint32_t s = 1; s < streams.size(); s += 2) addStream(streams[s], (s + 1) % variantCount);
+		if (!run()) return 1;
+
+		std::printf("Replaced %u of %u streams:  pool %.1f MB reserved before, %.1f MB after (%u block(s), %.1f MB in use), max diff %.3g\n",
+		            uint32_t(streams.size() / 2), uint32_t(streams.size()), reservedBefore / double(1 << 20),
+		            pool.getReservedBytes() / double(1 << 20), pool.getBlockCount(), pool.getUsedBytes() / double(1 << 20), maxDiff);
+		return maxDiff == 0.0f ? 0 : 1;
+	}
+
+	int runBenchAtrous(const Options &opts)
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> sizes;
+		std::string sizeList = opts.getString("sizes", "1920x1080,3840x2160");
+		for (size_t pos = 0; pos <= sizeList.size();)
+		{
+			size_t end = sizeList.find(',', pos);
+			if (end == std::string::npos) end = sizeList.size();
+			uint32_t w, h;
+			if (!parseSize(sizeList.substr(pos, end - pos), w, h))
+			{
+				std::fprintf(stderr, "--sizes expects a comma separated list such as 1920x1080,3840x2160\n");
+				return 1;
+			}
+			sizes.push_back({ w, h });
+			pos = end + 1;
+		}
+		const uint32_t repeat = uint32_t(std::max(1, opts.getInt("repeat", 5)));
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		const CpuSVGFFilter::Settings baseSettings = readSettings(opts);
+
+		// The per-pixel AoS reference first, then the planar kernel for every instruction set this machine runs
+		struct Variant { const char *name; bool simd; SimdIsa isa; };
+		std::vector<Variant> variants = { { "reference (AoS)", false, SimdIsa::Scalar } };
+		for (uint32_t i = 0; i < uint32_t(SimdIsa::Count); i++)
+		{
+			if (isSimdIsaSupported(SimdIsa(i))) variants.push_back({ getSimdIsaName(SimdIsa(i)), true, SimdIsa(i) });
+		}
+
+		std::printf("A-trous benchmark, %d iteration(s), %u thread(s), best of %u frame(s)\n", baseSettings.filterIterations, pPool->getThreadCount(), repeat);
+
+		for (const auto &size : sizes)
+		{
+			// One static frame, filtered repeatedly:  every variant sees the exact same sequence of inputs
+			SyntheticFrameSource::SharedPtr pSynth = SyntheticFrameSource::create(size.first, size.second, 0.0f, pPool);
+			const FrameInputs &inputs = pSynth->renderFrame(0);
+
+			CpuSVGFFilter::SharedPtr pFilter = CpuSVGFFilter::create(pPool);
+			ImageF4 reference, output;
+			double referenceMs = 0.0;
+
+			std::printf("\n%ux%u\n  %-16s %10s %10s %10s %9s %12s %12s\n", size.first, size.second, "variant", "min ms", "avg ms", "Mpix/s", "speedup", "max abs err", "max rel err");
+			for (const Variant &v : variants)
+			{
+				CpuSVGFFilter::Settings settings = baseSettings;
+				settings.simdAtrous = v.simd;
+				settings.simdIsa    = v.isa;
+				pFilter->setSettings(settings);
+				pFilter->reset();
+
+				StageStats atrous;
+				for (uint32_t r = 0; r < repeat; r++)
+				{
+					if (!pFilter->execute(inputs, output)) return 1;
+					atrous.add(pFilter->getLastTimings().atrous);
+				}
+
+				const double avgMs = atrous.sumMs / atrous.count;
+				const double mpix  = double(size.first) * size.second * std::max(1, settings.filterIterations) / (atrous.minMs * 1e3);
+				if (!v.simd)
+				{
+					reference   = output;
+					referenceMs = atrous.minMs;
+					std::printf("  %-16s %10.2f %10.2f %10.1f %9s %12s %12s\n", v.name, atrous.minMs, avgMs, mpix, "1.00x", "-", "-");
+					continue;
+				}
+
+				double maxAbs, maxRel;
+				compareImages(output, reference, maxAbs, maxRel);
+				std::printf("  %-16s %10.2f %10.2f %10.1f %8.2fx %12.3e %12.3e\n", v.name, atrous.minMs, avgMs, mpix, referenceMs / atrous.minMs, maxAbs, maxRel);
+			}
+		}
+		return 0;
+	}
+
+	int runBenchVariants(const Options &opts)
+	{
+		using Clock = std::chrono::steady_clock;
+		auto elapsedMs = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+		uint32_t width, height;
+		if (!parseSize(opts.getString("synthetic", "1920x1080"), width, height))
+		{
+			std::fprintf(stderr, "--synthetic expects a size such as 1920x1080\n");
+			return 1;
+		}
+		const uint32_t repeat   = uint32_t(std::max(1, opts.getInt("repeat", 5)));
+		const CpuSVGFFilter::Settings settings = readSettings(opts);
+		const int32_t iterations = std::max(1, settings.filterIterations);
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		CpuThreadPool &pool = *pPool;
+		SyntheticFrameSource::SharedPtr pSynth = SyntheticFrameSource::create(width, height, 0.0f, pPool);
+		const FrameInputs &inputs = pSynth->renderFrame(0);
+
+		// Every variant filters the same input:  each iteration reads it and writes the other buffer
+		PlanarImage illum[2], geometry;
+		illumToPlanar(pool, *inputs.directIllum, *inputs.indirectIllum, illum[0]);
+		illum[1].resize(width, height, kIllumPlaneCount);
+		geometryToPlanar(pool, *inputs.miscBuf, geometry);
+		ImageF4 outDirect(width, height), outIndirect(width, height), modulated(width, height);
+		const AtrousSimdFunc kernel = getAtrousSimdKernel(settings.simdIsa);
+
+		// Best of repeat for all iterations, divided by the iteration count
+		auto timeIterations = [&](const std::function<void(int)> &iteration)
+		{
+			double best = 1e30;
+			for (uint32_t r = 0; r < repeat; r++)
+			{
+				Clock::time_point start = Clock::now();
+				for (int i = 0; i < iterations; i++) iteration(i);
+				best = std::min(best, elapsedMs(start));
+			}
+			return best / iterations;
+		};
+
+		auto runReference = [&](uint32_t channels, bool modulate, int radius)
+		{
+			const AtrousPixelFunc filterPixel = getAtrousPixelVariant(channels, modulate, radius);
+			AtrousSources src;
+			src.pDirect           = inputs.directIllum;
+			src.pIndirect         = inputs.indirectIllum;
+			src.pCompactNormDepth = inputs.miscBuf;
+			src.pHistoryLength    = nullptr;
+			src.pAlbedo           = inputs.dirAlbedo;
+			src.pIndirAlbedo      = inputs.indirAlbedo;
+			src.phiColor          = settings.phiColor;
+			src.phiNormal         = settings.phiNormal;
+			return timeIterations([&](int i)
+			{
+				src.stepSize = 1 << i;
+				pool.forEachTile(width, height, 32, [&](const TileRect &tile)
+				{
+					for (int y = tile.y0; y < tile.y1; y++)
+					{
+						for (int x = tile.x0; x < tile.x1; x++)
+						{
+							float4 direct, indirect;
+							filterPixel(src, x, y, direct, indirect);
+							if (modulate) modulated.at(x, y) = direct;
+							else { outDirect.at(x, y) = direct; outIndirect.at(x, y) = indirect; }
+						}
+					}
+				});
+			});
+		};
+
+		// With separateModulation the kernel doesn't modulate; a second sweep does, like before the variants existed
+		auto runSimd = [&](uint32_t channels, bool modulate, int radius, bool separateModulation)
+		{
+			AtrousSimdArgs args;
+			args.pIn       = &illum[0];
+			args.pOut      = &illum[1];
+			args.pGeometry = &geometry;
+			args.phiColor  = settings.phiColor;
+			args.phiNormal = settings.phiNormal;
+			args.channels  = channels;
+			args.radius    = radius;
+			if (modulate && !separateModulation)
+			{
+				args.pModulated   = &modulated;
+				args.pAlbedo      = inputs.dirAlbedo;
+				args.pIndirAlbedo = inputs.indirAlbedo;
+			}
+			return timeIterations([&](int i)
+			{
+				args.stepSize = 1 << i;
+				forEachRowBand(pool, height, 8, [&](int y0, int y1)
+				{
+					AtrousSimdArgs band = args;
+					band.y0 = y0;
+					band.y1 = y1;
+					kernel(band);
+					if (!separateModulation) return;
+
+					const size_t stride = illum[1].getStride();
+					for (int y = y0; y < y1; y++)
+					{
+						for (int x = 0; x < int(width); x++)
+						{
+							const size_t j = size_t(y) * stride + x;
+							float4 direct   = float4(illum[1].getPlane(kDirectR)[j],   illum[1].getPlane(kDirectG)[j],   illum[1].getPlane(kDirectB)[j],   illum[1].getPlane(kDirectVar)[j]);
+							float4 indirect = float4(illum[1].getPlane(kIndirectR)[j], illum[1].getPlane(kIndirectG)[j], illum[1].getPlane(kIndirectB)[j], illum[1].getPlane(kIndirectVar)[j]);
+							modulated.at(x, y) = direct * inputs.dirAlbedo->at(x, y) + indirect * inputs.indirAlbedo->at(x, y);
+						}
+					}
+				});
+			});
+		};
+
+		std::printf("A-trous variants at %ux%u, %d iteration(s), %u thread(s), best of %u, ms per iteration\n", width, height,
+		            iterations, pPool->getThreadCount(), repeat);
+		std::printf("  %-9s %-6s %-22s %12s %12s %9s\n", "channels", "kernel", "modulation", "reference", getSimdIsaName(settings.simdIsa), "speedup");
+
+		const std::pair<uint32_t, const char *> channelSets[] = { { kBothChannels, "both" }, { kDirectChannel, "direct" }, { kIndirectChannel, "indirect" } };
+		for (int radius : { 2, 1 })
+		{
+			for (const auto &channels : channelSets)
+			{
+				for (int modulation = 0; modulation < 3; modulation++)
+				{
+					// The separate sweep only for the default kernel, as the baseline the fused modulation replaces
+					const bool modulate = modulation > 0, separate = modulation == 2;
+					if (separate && (radius != 2 || channels.first != kBothChannels)) continue;
+
+					const double referenceMs = separate ? 0.0 : runReference(channels.first, modulate, radius);
+					const double simdMs      = runSimd(channels.first, modulate, radius, separate);
+					const char  *name        = !modulate ? "none" : separate ? "separate sweep (before)" : "in kernel";
+					if (separate) std::printf("  %-9s %-6s %-22s %12s %12.3f %9s\n", channels.second, "5x5", name, "-", simdMs, "-");
+					else          std::printf("  %-9s %-6s %-22s %12.3f %12.3f %8.2fx\n", channels.second, radius == 1 ? "3x3" : "5x5", name,
+					                          referenceMs, simdMs, referenceMs / simdMs);
+				}
+			}
+		}
+		return 0;
+	}
+
+	/** Feeds StageTimer scripted durations through a manual clock.  Returns the number of failed checks.
+	*/
+	int runCheckPool(const Options &opts)
+	{
+		// Bytes per pixel of the targets SVGFPass allocates with full precision storage:  filtered past, ping-pong,
+		//    current and previous reprojection, output and previous linear z.  Formats are told apart by size here.
+		const std::vector<uint32_t> targetBytes = { 16, 16,  16, 16, 16, 16,  16, 16, 16, 2,  16, 16, 16, 2,  16,  16 };
+
+		uint32_t fullWidth, fullHeight;
+		if (!parseSize(opts.getString("size", "1920x1080"), fullWidth, fullHeight))
+		{
+			std::fprintf(stderr, "--size expects a size such as 1920x1080\n");
+			return 1;
+		}
+
+		int failures = 0;
+		auto check = [&](const char *what, bool ok)
+		{
+			if (!ok) std::printf("  %s  FAILED\n", what);
+			failures += ok ? 0 : 1;
+		};
+
+		// What SVGFPass::resize() does with its targets, with resources that are just serial numbers
+		struct Targets
+		{
+			using Pool = ResourcePool<uint32_t>;
+			uint32_t                       created = 0;
+			Pool                           pool = Pool([this](uint32_t, uint32_t, uint32_t) { return created++; });
+			std::vector<Pool::Allocation>  live;
+			uint32_t                       resizes = 0, kept = 0;
+			uint64_t                       regionBytes = 0, targetBytes = 0;
+
+			void resize(const std::vector<uint32_t> &bytes, uint32_t width, uint32_t height)
+			{
+				resizes++;
+				bool keep = !live.empty();
+				for (const Pool::Allocation &target : live) keep = keep && isGoodFit(target.width, target.height, width, height);
+				if (keep)
+				{
+					kept++;
+				}
+				else
+				{
+					for (Pool::Allocation &target : live) pool.release(target);
+					live.clear();
+					for (uint32_t b : bytes) live.push_back(pool.acquire(b, b, width, height));
+					pool.trim(pool.getStats().liveHighWaterBytes);
+				}
+
+				// Clearing touches the region only, not the whole targets
+				for (const Pool::Allocation &target : live)
+				{
+					regionBytes += uint64_t(width) * height * target.key;
+					targetBytes += target.bytes;
+				}
+			}
+		};
+
+		auto scaled = [](uint32_t extent, double scale) { return std::max(8u, uint32_t(extent * scale + 0.5)); };
+
+		std::printf("Render target pool for dynamic resolution up to %ux%u (%u targets):\n", fullWidth, fullHeight, uint32_t(targetBytes.size()));
+		std::printf("  %-10s %8s %8s %8s %8s %12s %12s %10s %10s\n", "scenario", "resizes", "kept", "allocs", "reuses",
+		            "recreating", "peak MB", "live MB", "clear");
+		uint32_t seed = 1;
+		for (const char *scenario : { "ramp", "oscillate", "random" })
+		{
+			Targets targets;
+			uint64_t allocationsAfterWarmup = 0;
+			for (uint32_t frame = 0;; frame++)
+			{
+				// ramp:  100% down to 50% and back in 1% steps;  oscillate:  100% and 70% on alternate frames;
+				//    random:  a new scale in [50%, 100%] every frame
+				double scale;
+				if (std::strcmp(scenario, "ramp") == 0)
+				{
+					if (frame > 100) break;
+					scale = 1.0 - 0.01 * (frame <= 50 ? frame : 100 - frame);
+				}
+				else if (std::strcmp(scenario, "oscillate") == 0)
+				{
+					if (frame >= 100) break;
+					scale = (frame & 1) ? 0.7 : 1.0;
+				}
+				else
+				{
+					if (frame >= 500) break;
+					seed = seed * 1664525u + 1013904223u;
+					scale = 0.5 + 0.5 * (seed >> 8) / double(1 << 24);
+				}
+
+				const uint32_t width = scaled(fullWidth, scale), height = scaled(fullHeight, scale);
+				const uint64_t before = targets.pool.getStats().allocations;
+				targets.resize(targetBytes, width, height);
+				if (frame >= 2) allocationsAfterWarmup += targets.pool.getStats().allocations - before;
+
+				bool fits = true;
+				for (const auto &target : targets.live)
+					fits = fits && target.width >= width && target.height >= height && target.width == targets.live[0].width && target.height == targets.live[0].height;
+				check("every target covers the region, all targets share one extent", fits);
+			}
+
+			const ResourcePoolStats &stats = targets.pool.getStats();
+			std::printf("  %-10s %8u %8u %8llu %8llu %12u %12.1f %10.1f %9.0f%%\n", scenario, targets.resizes, targets.kept,
+			            (unsigned long long)stats.allocations, (unsigned long long)stats.reuses, targets.resizes * uint32_t(targetBytes.size()),
+			            stats.highWaterBytes / 1048576.0, stats.liveHighWaterBytes / 1048576.0, 100.0 * targets.regionBytes / targets.targetBytes);
+
+			check("live and released targets never exceed three times the largest live set", stats.highWaterBytes <= 3 * stats.liveHighWaterBytes);
+			if (std::strcmp(scenario, "oscillate") == 0)
+				check("no allocations once both sizes have been seen", allocationsAfterWarmup == 0);
+		}
+		std::printf("  (recreating:  allocations without the pool, one per target per resize;  clear:  region cleared against\n"
+		            "   the whole pooled targets)\n");
+		std::printf(failures ? "%d check(s) FAILED\n" : "All checks passed\n", failures);
+		return failures ? 1 : 0;
+	}
+
+	int runCheckTimers(const Options &)
+	{
+		int failures = 0;
+		auto check = [&](const char *what, double value, double expected)
+		{
+			const bool ok = std::abs(value - expected) < 1e-9;
+			std::printf("  %-40s %10.3f (expected %10.3f)  %s\n", what, value, expected, ok ? "ok" : "FAILED");
+			failures += ok ? 0 : 1;
+		};
+
+		ManualClock::SharedPtr pClock = ManualClock::create();
+		StageTimer::SharedPtr  pTimer = StageTimer::create(ClockTimerBackend::create(ManualClock::bind(pClock)), 64);
+		const uint32_t outer = pTimer->getStageId("outer");
+		const uint32_t inner = pTimer->getStageId("inner");
+		const uint32_t twice = pTimer->getStageId("twice");
+		const uint32_t odd   = pTimer->getStageId("odd frames");
+
+		// Frame f:  inner takes f ms, twice runs for 1 then 2 ms, odd frames run for 0.25 ms on odd frames only, and
+		//    outer spans all of them plus 0.5 ms
+		for (int f = 1; f <= 100; f++)
+		{
+			{
+				StageTimer::Scope outerScope(pTimer.get(), outer);
+				{
+					StageTimer::Scope innerScope(pTimer.get(), inner);
+					pClock->advance(double(f));
+				}
+				pClock->advance(0.5);
+				for (int i = 1; i <= 2; i++)
+				{
+					StageTimer::Scope twiceScope(pTimer.get(), twice);
+					pClock->advance(double(i));
+				}
+				if (f & 1)
+				{
+					StageTimer::Scope oddScope(pTimer.get(), odd);
+					pClock->advance(0.25);
+				}
+			}
+			pTimer->endFrame();
+		}
+
+		std::printf("StageTimer with a 64 frame history:\n");
+		StageTimer::Stats s = pTimer->getStats(inner);
+		check("inner:  samples kept",         s.count, 64);
+		check("inner:  min (frames 37..100)", s.minMs, 37.0);
+		check("inner:  avg",                  s.avgMs, 68.5);
+		check("inner:  p99",                  s.p99Ms, 100.0);
+		check("inner:  last",                 s.lastMs, 100.0);
+		s = pTimer->getStats(outer);
+		check("outer:  min (frame 37)",       s.minMs, 37.0 + 3.5 + 0.25);
+		check("outer:  max (frame 100)",      s.maxMs, 100.0 + 3.5);
+		s = pTimer->getStats(twice);
+		check("twice:  runs summed per frame", s.avgMs, 3.0);
+		s = pTimer->getStats(odd);
+		check("odd frames:  samples kept",    s.count, 50);
+		check("odd frames:  avg",             s.avgMs, 0.25);
+		check("odd frames:  inactive after an even frame", pTimer->isActive(odd) ? 1.0 : 0.0, 0.0);
+		check("inner:  active",               pTimer->isActive(inner) ? 1.0 : 0.0, 1.0);
+
+		pTimer->reset();
+		check("reset:  samples kept",         pTimer->getStats(inner).count, 0);
+
+		std::printf(failures ? "%d check(s) failed\n" : "All checks passed\n", failures);
+		return failures ? 1 : 0;
+	}
+
+	int runCheckGBuffer(const Options &opts)
+	{
+		uint32_t width, height;
+		if (!parseSize(opts.getString("size", "640x360"), width, height))
+		{
+			std::fprintf(stderr, "--size expects a size such as 640x360\n");
+			return 1;
+		}
+
+		int failures = 0;
+		auto check = [&](const char *what, double value, double bound)
+		{
+			const bool ok = value <= bound;
+			std::printf("  %-40s %12.3g (bound %10.3g)  %s\n", what, value, bound, ok ? "ok" : "FAILED");
+			failures += ok ? 0 : 1;
+		};
+
+		std::printf("G-buffer bytes per pixel:\n");
+		for (uint32_t l = 0; l < uint32_t(GBufferLayout::Count); l++)
+		{
+			const GBufferLayout layout = GBufferLayout(l);
+			std::printf("  %s:\n", getGBufferLayoutName(layout));
+			for (const GBufferTarget &target : getGBufferTargets(layout))
+				std::printf("    %-24s %-8s %3u\n", target.name, target.format, target.bytesPerPixel);
+			std::printf("    %-24s %-8s %3u  (%.1f MB at %ux%u)\n", "total", "", getGBufferBytesPerPixel(layout),
+			            getGBufferBytesPerPixel(layout) * double(width) * height / 1048576.0, width, height);
+		}
+
+		// A camera away from the origin, so position precision is tested where it is worst, with a 16:9 frustum
+		GBufferCamera camera;
+		camera.posW    = float3(12.5f, 3.0f, -40.0f);
+		camera.cameraU = float3(0.6f * 16.0f / 9.0f, 0.0f, 0.0f);
+		camera.cameraV = float3(0.0f, 0.6f, 0.0f);
+		camera.cameraW = float3(0.0f, 0.0f, 1.0f);
+		camera.jitterX = 0.3f / width;
+		camera.jitterY = -0.2f / height;
+
+		uint32_t seed = 1;
+		auto rnd = [&]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / float(1 << 24); };
+
+		double maxPosErr = 0.0, maxNormalErr = 0.0, maxColorErr = 0.0, maxScalarErr = 0.0;
+		uint32_t badValidity = 0;
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				// One in eight pixels is background; the rest hit at a random distance between 0.05 and 500
+				GBufferSample in;
+				in.valid = rnd() >= 0.125f;
+				const float dist = 0.05f * std::pow(10000.0f, rnd());
+				in.posW   = camera.posW + getPrimaryRayDir(camera, x, y, width, height) * dist;
+				in.normal = normalize(float3(2.0f * rnd() - 1.0f, 2.0f * rnd() - 1.0f, 2.0f * rnd() - 1.0f) + float3(1e-4f));
+				in.diffuse  = float3(rnd(), rnd(), rnd());
+				in.opacity  = rnd();
+				in.specular = float3(rnd(), rnd(), rnd());
+				in.linearRoughness = rnd();
+
+				const GBufferSample out = decodeCompactGBuffer(encodeCompactGBuffer(in, camera), camera, x, y, width, height);
+				if (out.valid != in.valid) badValidity++;
+				if (!in.valid) continue;
+
+				maxPosErr    = std::max(maxPosErr, double(distance(out.posW, in.posW)) / std::max(dist, length(camera.posW)));
+				maxNormalErr = std::max(maxNormalErr, std::acos(std::min(1.0, double(dot(out.normal, in.normal)))) * 180.0 / 3.14159265358979);
+				for (float e : { out.diffuse.x - in.diffuse.x, out.diffuse.y - in.diffuse.y, out.diffuse.z - in.diffuse.z,
+				                 out.specular.x - in.specular.x, out.specular.y - in.specular.y, out.specular.z - in.specular.z })
+					maxColorErr = std::max(maxColorErr, double(std::abs(e)));
+				maxScalarErr = std::max(maxScalarErr, double(std::max(std::abs(out.opacity - in.opacity), std::abs(out.linearRoughness - in.linearRoughness))));
+			}
+		}
+
+		std::printf("Compact G-buffer round trip of %u samples:\n", width * height);
+		check("position error / max(distance, |camera|)", maxPosErr, 1e-6);
+		check("normal error (degrees, same as full)", maxNormalErr, 0.1);
+		check("color error (sqrt curve, 8 bits)", maxColorErr, 1.0 / 255.0 + 1e-6);
+		check("opacity and roughness error", maxScalarErr, 0.5 / 255.0 + 1e-6);
+		check("background / geometry mismatches", badValidity, 0);
+		check("compact bytes / full bytes", double(getGBufferBytesPerPixel(GBufferLayout::Compact)) / getGBufferBytesPerPixel(GBufferLayout::Full), 0.75);
+
+		std::printf(failures ? "%d check(s) failed\n" : "All checks passed\n", failures);
+		return failures ? 1 : 0;
+	}
+
+	/** What SVGFPass outputs with filtering off:  both illumination terms remodulated by their albedo
+	*/
+	void remodulate(const FrameInputs &inputs, ImageF4 &color)
+	{
+		color.resize(inputs.directIllum->getWidth(), inputs.directIllum->getHeight());
+		for (uint32_t y = 0; y < color.getHeight(); y++)
+		{
+			for (uint32_t x = 0; x < color.getWidth(); x++)
+			{
+				float4 c = inputs.directIllum->at(x, y) * inputs.dirAlbedo->at(x, y) + inputs.indirectIllum->at(x, y) * inputs.indirAlbedo->at(x, y);
+				color.at(x, y) = float4(c.x, c.y, c.z, 1.0f);
+			}
+		}
+	}
+
+	int runTrace(const Options &opts)
+	{
+		const std::string outputDir = opts.getString("output");
+		const uint32_t firstFrame   = uint32_t(std::max(0, opts.getInt("first", 0)));
+		const uint32_t frameCount   = uint32_t(std::max(1, opts.getInt("frames", 1)));
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+
+		auto buildStart = std::chrono::steady_clock::now();
+		CpuPathTracer::SharedPtr pTracer = createPathTracer(opts, pPool);
+		if (!pTracer) return 1;
+		const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+		const CpuPathTracer::Settings &settings = pTracer->getSettings();
+		std::printf("Tracing %u frame(s) of %ux%u at %u spp on %u thread(s); scene load and BVH build %.1f ms\n", frameCount,
+		            pTracer->getWidth(), pTracer->getHeight(), settings.samplesPerPixel, pPool->getThreadCount(), buildMs);
+
+		uint64_t totalRays = 0;
+		double totalMs = 0.0;
+		for (uint32_t f = firstFrame; f < firstFrame + frameCount; f++)
+		{
+			const FrameInputs &inputs = pTracer->renderFrame(f);
+			const CpuPathTracer::Stats &stats = pTracer->getStats();
+			totalRays += stats.getRayCount();
+			totalMs   += stats.milliseconds;
+			std::printf("  frame %4u  %9.2f ms  %9llu primary  %9llu shadow  %9llu indirect  %7.2f Mrays/s\n", f, stats.milliseconds,
+			            (unsigned long long)stats.primaryRays, (unsigned long long)stats.shadowRays,
+			            (unsigned long long)stats.indirectRays, stats.getRaysPerSecond() * 1e-6);
+
+			if (outputDir.empty()) continue;
+
+			LoadedFrame frame;
+			frame.copy(inputs);
+			ImageF4 reference;
+			remodulate(inputs, reference);
+
+			for (uint32_t i = 0; i <= kCaptureChannelCount; i++)
+			{
+				const bool isReference = (i == kCaptureChannelCount);
+				const std::string path = isReference ? framePath(outputDir, "Reference", f, ".pfm") : framePath(outputDir, getCaptureChannelName(i), f, ".sfb");
+				if (!saveImage(path, isReference ? reference : frame.images[i]))
+				{
+					std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+					return 1;
+				}
+			}
+		}
+
+		std::printf("Average %.2f ms per frame, %.2f Mrays/s\n", totalMs / frameCount, totalMs > 0.0 ? double(totalRays) * 1e-3 / totalMs : 0.0);
+		return 0;
+	}
+
+	int runBenchBvh(const Options &opts)
+	{
+		const std::string cacheDir = opts.getString("bvh-cache", ".");
+		const uint32_t rayCount    = uint32_t(std::max(1, opts.getInt("rays", 1000000)));
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		Scene::SharedPtr pScene = loadScene(opts, pPool);
+		if (!pScene) return 1;
+		if (pScene->getTriangleCount() == 0)
+		{
+			std::fprintf(stderr, "The scene has no triangles\n");
+			return 1;
+		}
+
+		using Clock = std::chrono::steady_clock;
+		auto msSince = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+		Clock::time_point start = Clock::now();
+		const uint64_t hash = pScene->getGeometryHash();
+		const double hashMs = msSince(start);
+
+		start = Clock::now();
+		TriangleBvh::SharedPtr pSerial = TriangleBvh::build(pScene, CpuThreadPool::create(1));
+		const double serialMs = msSince(start);
+
+		start = Clock::now();
+		TriangleBvh::SharedPtr pBuilt = TriangleBvh::build(pScene, pPool);
+		const double parallelMs = msSince(start);
+
+		const std::string path = TriangleBvh::getCachePath(*pScene, cacheDir);
+		start = Clock::now();
+		if (!pBuilt->save(path))
+		{
+			std::fprintf(stderr, "Cannot write %s\n", path.c_str());
+			return 1;
+		}
+		const double saveMs = msSince(start);
+
+		start = Clock::now();
+		TriangleBvh::SharedPtr pLoaded = TriangleBvh::load(pScene, path);
+		const double loadMs = msSince(start);
+		if (!pLoaded)
+		{
+			std::fprintf(stderr, "Cannot load %s back\n", path.c_str());
+			return 1;
+		}
+
+		std::printf("%u triangles, %u nodes (%.1f MB), SAH cost %.2f, geometry hash %016llx (%.2f ms)\n", pScene->getTriangleCount(),
+		            pBuilt->getNodeCount(), pBuilt->getMemorySize() / 1048576.0, pBuilt->getSahCost(), (unsigned long long)hash, hashMs);
+		std::printf("  build, 1 thread     %9.2f ms\n", serialMs);
+		std::printf("  build, %2u threads   %9.2f ms\n", pPool->getThreadCount(), parallelMs);
+		std::printf("  save                %9.2f ms  (%s)\n", saveMs, path.c_str());
+		std::printf("  load (mapped)       %9.2f ms, hash included\n", loadMs);
+
+		// Rays like the tracer's:  camera rays, cosine distributed bounces off surface points and shadow rays to the lights
+		const SceneCamera &camera = pScene->getCamera();
+		float3 camU, camV, camW;
+		camera.getBasis(16.0f / 9.0f, camU, camV, camW);
+		const uint32_t lightCount = uint32_t(pScene->getLights().size());
+
+		uint32_t seed = 1;
+		auto rnd = [&]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / float(1 << 24); };
+		auto randomSurfacePoint = [&](float3 &normal)
+		{
+			const uint32_t tri = std::min(uint32_t(rnd() * pScene->getTriangleCount()), pScene->getTriangleCount() - 1);
+			const float3 *p = pScene->getPositions(tri);
+			float u = rnd(), v = rnd();
+			if (u + v > 1.0f) { u = 1.0f - u; v = 1.0f - v; }
+			normal = normalize(cross(p[1] - p[0], p[2] - p[0]));
+			return p[0] + (p[1] - p[0]) * u + (p[2] - p[0]) * v;
+		};
+
+		const char *kRayKinds[3] = { "camera", "bounce", "shadow" };
+		std::vector<Ray> rays[3];
+		for (std::vector<Ray> &r : rays) r.resize(rayCount);
+		for (uint32_t i = 0; i < rayCount; i++)
+		{
+			rays[0][i].origin = camera.posW;
+			rays[0][i].dir = normalize(camU * (2.0f * rnd() - 1.0f) + camV * (2.0f * rnd() - 1.0f) + camW);
+
+			float3 n;
+			const float3 p = randomSurfacePoint(n);
+			const float r1 = rnd(), r2 = rnd(), r = std::sqrt(r1), phi = 2.0f * 3.14159265f * r2;
+			const float3 b = normalize(std::abs(n.y) < 0.9f ? cross(n, float3(0.0f, 1.0f, 0.0f)) : cross(n, float3(1.0f, 0.0f, 0.0f)));
+			const float3 t = cross(b, n);
+			const float3 side = rnd() < 0.5f ? n : -n;   // Either side, as double-sided materials bounce off both
+			rays[1][i].origin = p;
+			rays[1][i].dir = normalize(t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + side * std::sqrt(std::max(0.0f, 1.0f - r1)));
+			rays[1][i].tMin = 1e-4f;
+
+			float3 target = lightCount ? pScene->getLights()[i % lightCount].posW : p + n;
+			const bool directional = lightCount && pScene->getLights()[i % lightCount].type == SceneLightType::Directional;
+			const float3 toLight = directional ? -pScene->getLights()[i % lightCount].dirW : target - p;
+			rays[2][i].origin = p;
+			rays[2][i].dir = normalize(toLight);
+			rays[2][i].tMin = 1e-4f;
+			rays[2][i].tMax = directional ? 1e30f : length(toLight);
+		}
+
+		// The mapped tree must find the same hits as the one just built
+		uint32_t mismatches = 0;
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			for (uint32_t i = 0; i < std::min(rayCount, 100000u); i++)
+			{
+				RayHit a, b;
+				const bool hitA = pBuilt->intersect(rays[k][i], a), hitB = pLoaded->intersect(rays[k][i], b);
+				if (hitA != hitB || (hitA && (a.triangle != b.triangle || a.t != b.t))) mismatches++;
+			}
+		}
+		std::printf("  loaded vs built:  %u mismatching hits\n", mismatches);
+
+		std::printf("Traversal on %u thread(s), %u rays each:\n", pPool->getThreadCount(), rayCount);
+		const uint32_t chunkCount = pPool->getThreadCount() * 16;
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			double msByQuery[2];
+			uint64_t hits[2];
+			for (uint32_t anyHit = 0; anyHit < 2; anyHit++)
+			{
+				std::atomic<uint64_t> hitCount(0);
+				start = Clock::now();
+				pPool->parallelFor(chunkCount, [&](uint32_t c)
+				{
+					uint64_t chunkHits = 0;
+					for (uint32_t i = uint32_t(uint64_t(rayCount) * c / chunkCount); i < uint32_t(uint64_t(rayCount) * (c + 1) / chunkCount); i++)
+					{
+						RayHit hit;
+						chunkHits += (anyHit ? pLoaded->occluded(rays[k][i]) : pLoaded->intersect(rays[k][i], hit)) ? 1 : 0;
+					}
+					hitCount += chunkHits;
+				});
+				msByQuery[anyHit] = msSince(start);
+				hits[anyHit] = hitCount;
+			}
+			std::printf("  %-8s closest hit %8.2f Mrays/s   any hit %8.2f Mrays/s   (%5.1f%% hit)\n", kRayKinds[k],
+			            rayCount * 1e-3 / msByQuery[0], rayCount * 1e-3 / msByQuery[1], 100.0 * hits[0] / rayCount);
+			if (hits[0] != hits[1]) mismatches++;
+		}
+
+		return mismatches ? 1 : 0;
+	}
+
+	int runBenchTraversal(const Options &opts)
+	{
+		uint32_t width, height;
+		if (!parseSize(opts.getString("size", "1280x720"), width, height))
+		{
+			std::fprintf(stderr, "--size expects a size such as 1280x720\n");
+			return 1;
+		}
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		Scene::SharedPtr pScene = loadScene(opts, pPool);
+		if (!pScene) return 1;
+		TriangleBvh::SharedPtr pBvh = opts.has("bvh-cache") ? TriangleBvh::buildCached(pScene, opts.getString("bvh-cache"), pPool)
+		                                                    : TriangleBvh::build(pScene, pPool);
+		const TriangleBvh &bvh = *pBvh;
+
+		// Rays in the path tracer's order:  the camera rays of 16x16 tiles, then a shadow ray to a random light and a
+		//    cosine distributed bounce from each hit
+		const uint32_t kTile = 16;
+		const SceneCamera &camera = pScene->getCamera();
+		float3 camU, camV, camW;
+		camera.getBasis(float(width) / float(height), camU, camV, camW);
+
+		std::vector<Ray> rays[4];
+		for (uint32_t ty = 0; ty < height; ty += kTile)
+		{
+			for (uint32_t tx = 0; tx < width; tx += kTile)
+			{
+				for (uint32_t y = ty; y < std::min(height, ty + kTile); y++)
+				{
+					for (uint32_t x = tx; x < std::min(width, tx + kTile); x++)
+					{
+						Ray ray;
+						ray.origin = camera.posW;
+						ray.dir = normalize(camU * (2.0f * (x + 0.5f) / width - 1.0f) + camV * (1.0f - 2.0f * (y + 0.5f) / height) + camW);
+						rays[0].push_back(ray);
+					}
+				}
+			}
+		}
+
+		const std::vector<SceneLight> &lights = pScene->getLights();
+		uint32_t seed = 1;
+		auto rnd = [&]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / float(1 << 24); };
+		for (const Ray &cameraRay : rays[0])
+		{
+			RayHit hit;
+			if (!bvh.intersect(cameraRay, hit)) continue;
+
+			const float3 *p = pScene->getPositions(hit.triangle);
+			const float3 pos = p[0] * (1.0f - hit.u - hit.v) + p[1] * hit.u + p[2] * hit.v;
+			float3 n = normalize(cross(p[1] - p[0], p[2] - p[0]));
+			if (dot(n, cameraRay.dir) > 0.0f) n = -n;
+
+			Ray shadow;
+			shadow.origin = pos;
+			shadow.tMin = 1e-4f;
+			const SceneLight *pLight = lights.empty() ? nullptr : &lights[std::min(size_t(rnd() * lights.size()), lights.size() - 1)];
+			if (pLight && pLight->type == SceneLightType::Directional)
+			{
+				shadow.dir = normalize(-pLight->dirW);
+				shadow.tMax = 1e30f;
+			}
+			else
+			{
+				const float3 toLight = pLight ? pLight->posW - pos : n;
+				shadow.dir = normalize(toLight);
+				shadow.tMax = length(toLight);
+			}
+			rays[1].push_back(shadow);
+
+			const float r1 = rnd(), r2 = rnd(), r = std::sqrt(r1), phi = 2.0f * 3.14159265f * r2;
+			const float3 b = normalize(std::abs(n.y) < 0.9f ? cross(n, float3(0.0f, 1.0f, 0.0f)) : cross(n, float3(1.0f, 0.0f, 0.0f)));
+			const float3 t = cross(b, n);
+			Ray bounce;
+			bounce.origin = pos;
+			bounce.dir = normalize(t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * std::sqrt(std::max(0.0f, 1.0f - r1)));
+			bounce.tMin = 1e-4f;
+			rays[2].push_back(bounce);
+		}
+
+		// The same bounces shuffled across the frame, as a wavefront tracer would collect them
+		rays[3] = rays[2];
+		for (size_t i = rays[3].size(); i > 1; i--) std::swap(rays[3][i - 1], rays[3][size_t(rnd() * i) % i]);
+		const uint32_t batchSize = uint32_t(std::max(1, opts.getInt("batch", 65536)));
+
+		// Single rays first:  their hits are what the packets must reproduce
+		enum class Mode { Single, Packet, Stream };
+		struct Result { std::vector<RayHit> hits; std::vector<uint8_t> found; };
+		auto run = [&](uint32_t kind, Mode mode, SimdIsa isa, Result &result)
+		{
+			const std::vector<Ray> &r = rays[kind];
+			const uint32_t count = uint32_t(r.size());
+			const uint32_t chunk = kind == 3 ? batchSize : kTile * kTile;
+			const bool anyHit = (kind == 1);
+			result.hits.assign(count, RayHit());
+			result.found.assign(count, 0);
+
+			auto start = std::chrono::steady_clock::now();
+			pPool->parallelFor((count + chunk - 1) / chunk, [&](uint32_t c)
+			{
+				const uint32_t first = c * chunk, n = std::min(chunk, count - first);
+				const Ray *pRays = &r[first];
+				RayHit *pHits = &result.hits[first];
+				uint8_t *pFound = &result.found[first];
+				if (mode == Mode::Single)
+				{
+					for (uint32_t i = 0; i < n; i++) pFound[i] = (anyHit ? bvh.occluded(pRays[i]) : bvh.intersect(pRays[i], pHits[i])) ? 1 : 0;
+				}
+				else if (anyHit)               bvh.occludedPacket(pRays, n, pFound, isa);
+				else if (mode == Mode::Packet) bvh.intersectPacket(pRays, n, pHits, pFound, isa);
+				else                           bvh.intersectStream(pRays, n, pHits, pFound, isa);
+			});
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		};
+
+		std::printf("%u triangles%s, %ux%u camera rays in %ux%u tiles, %u thread(s)\n", pScene->getTriangleCount(),
+		            pScene->hasAlphaTest() ? " (alpha tested)" : "", width, height, kTile, kTile, pPool->getThreadCount());
+		std::printf("  %-8s %-16s %12s %9s %11s\n", "rays", "traversal", "Mrays/s", "speedup", "mismatches");
+
+		const char *kKinds[4] = { "camera", "shadow", "bounce", "scatter" };
+		uint32_t totalMismatches = 0;
+		for (uint32_t kind = 0; kind < 4; kind++)
+		{
+			const uint32_t count = uint32_t(rays[kind].size());
+			if (count == 0) continue;
+
+			Result reference;
+			const double singleMs = run(kind, Mode::Single, SimdIsa::Scalar, reference);
+			std::printf("  %-8s %-16s %12.2f %9s %11s\n", kKinds[kind], kind == 1 ? "single (any)" : "single", count * 1e-3 / singleMs, "1.00x", "-");
+
+			for (uint32_t m = 0; m < 2; m++)
+			{
+				const Mode mode = m == 0 ? Mode::Packet : Mode::Stream;
+				if (kind < 2 && mode == Mode::Stream) continue;   // Sorting is for bounces
+				for (uint32_t i = 0; i < uint32_t(SimdIsa::Count); i++)
+				{
+					const SimdIsa isa = SimdIsa(i);
+					if (!isSimdIsaSupported(isa)) continue;
+
+					Result result;
+					const double ms = run(kind, mode, isa, result);
+					uint32_t mismatches = 0;
+					for (uint32_t r = 0; r < count; r++)
+					{
+						if (result.found[r] != reference.found[r]) mismatches++;
+						else if (kind != 1 && result.found[r] && (result.hits[r].triangle != reference.hits[r].triangle || result.hits[r].t != reference.hits[r].t)) mismatches++;
+					}
+					totalMismatches += mismatches;
+
+					const std::string name = std::string(mode == Mode::Packet ? "packet " : "stream ") + getSimdIsaName(isa);
+					std::printf("  %-8s %-16s %12.2f %8.2fx %11u\n", kKinds[kind], name.c_str(), count * 1e-3 / ms, singleMs / ms, mismatches);
+				}
+			}
+		}
+
+		return totalMismatches ? 1 : 0;
+	}
+
+	/** image blurred with a 5x5 binomial kernel, clamped at the borders.  The error that is left after it is the low
+	    frequency part, which is what the eye and the filter's wide a-trous taps see; blue noise moves its error out of it.
+	*/
+	void lowPass(const ImageF4 &image, ImageF4 &result)
+	{
+		static const float kWeights[5] = { 1.0f / 16.0f, 4.0f / 16.0f, 6.0f / 16.0f, 4.0f / 16.0f, 1.0f / 16.0f };
+		const int32_t width = int32_t(image.getWidth()), height = int32_t(image.getHeight());
+		ImageF4 rows(image.getWidth(), image.getHeight());
+		result.resize(image.getWidth(), image.getHeight());
+		for (int32_t y = 0; y < height; y++)
+		{
+			for (int32_t x = 0; x < width; x++)
+			{
+				float4 sum(0.0f);
+				for (int32_t i = -2; i <= 2; i++) sum += image.at(uint32_t(std::min(std::max(x + i, 0), width - 1)), uint32_t(y)) * kWeights[i + 2];
+				rows.at(uint32_t(x), uint32_t(y)) = sum;
+			}
+		}
+		for (int32_t y = 0; y < height; y++)
+		{
+			for (int32_t x = 0; x < width; x++)
+			{
+				float4 sum(0.0f);
+				for (int32_t i = -2; i <= 2; i++) sum += rows.at(uint32_t(x), uint32_t(std::min(std::max(y + i, 0), height - 1))) * kWeights[i + 2];
+				result.at(uint32_t(x), uint32_t(y)) = sum;
+			}
+		}
+	}
+
+	int runCompareSamplers(const Options &opts)
+	{
+		const uint32_t frameCount    = uint32_t(std::max(2, opts.getInt("frames", 16)));
+		const uint32_t referenceSpp  = uint32_t(std::max(1, opts.getInt("reference-spp", 256)));
+		const int32_t  maxIterations = 5;
+		const CpuSVGFFilter::Settings base = readSettings(opts);
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		CpuPathTracer::SharedPtr pTracer = createPathTracer(opts, pPool, "320x180");
+		if (!pTracer) return 1;
+		CpuPathTracer::Settings settings = pTracer->getSettings();
+
+		// Sobol converges fastest; its sample indices start past the ones the 1 spp frames use, so they share no samples
+		settings.sampler         = SamplerType::Sobol;
+		settings.samplesPerPixel = referenceSpp;
+		pTracer->setSettings(settings);
+		std::printf("Rendering a %u spp reference at %ux%u...\n", referenceSpp, pTracer->getWidth(), pTracer->getHeight());
+		ImageF4 reference, referenceLowPass;
+		remodulate(pTracer->renderFrame(frameCount), reference);
+		lowPass(reference, referenceLowPass);
+
+		const uint32_t samplerCount = uint32_t(SamplerType::Count);
+		ErrorSums raw[samplerCount], lowPassed[samplerCount], mean[samplerCount], filtered[samplerCount][maxIterations + 1];
+		for (uint32_t s = 0; s < samplerCount; s++)
+		{
+			settings.sampler         = SamplerType(s);
+			settings.samplesPerPixel = 1;
+			pTracer->setSettings(settings);
+
+			CpuSVGFFilter::SharedPtr pFilters[maxIterations + 1];
+			for (int32_t k = 0; k <= maxIterations; k++)
+			{
+				CpuSVGFFilter::Settings filterSettings = base;
+				filterSettings.filterIterations = k;
+				pFilters[k] = CpuSVGFFilter::create(pPool);
+				pFilters[k]->setSettings(filterSettings);
+			}
+
+			ImageF4 color, blurred, output, sum(pTracer->getWidth(), pTracer->getHeight(), float4(0.0f));
+			for (uint32_t f = 0; f < frameCount; f++)
+			{
+				const FrameInputs &inputs = pTracer->renderFrame(f);
+				remodulate(inputs, color);
+				lowPass(color, blurred);
+				raw[s].add(color, reference);
+				lowPassed[s].add(blurred, referenceLowPass);
+				for (uint32_t i = 0; i < sum.getWidth() * sum.getHeight(); i++) sum.getData()[i] += color.getData()[i];
+
+				// Only the second half is measured, once the filter's history holds several samples
+				for (int32_t k = 0; k <= maxIterations; k++)
+				{
+					if (!pFilters[k]->execute(inputs, output)) return 1;
+					if (f >= frameCount / 2) filtered[s][k].add(output, reference);
+				}
+			}
+			for (uint32_t i = 0; i < sum.getWidth() * sum.getHeight(); i++) sum.getData()[i] = sum.getData()[i] * (1.0f / float(frameCount));
+			mean[s].add(sum, reference);
+		}
+
+		std::printf("relMSE against the reference, 1 spp per frame over %u frames; filtered over frames %u..%u\n", frameCount, frameCount / 2, frameCount - 1);
+		std::printf("  %-11s %10s %10s %10s", "sampler", "1 spp", "low-pass", "mean");
+		for (int32_t k = 0; k <= maxIterations; k++) std::printf(" %9d it", k);
+		std::printf("\n");
+		for (uint32_t s = 0; s < samplerCount; s++)
+		{
+			std::printf("  %-11s %10.4f %10.4f %10.4f", getSamplerTypeName(SamplerType(s)), raw[s].relMse(), lowPassed[s].relMse(), mean[s].relMse());
+			for (int32_t k = 0; k <= maxIterations; k++) std::printf(" %12.4f", filtered[s][k].relMse());
+			std::printf("\n");
+		}
+
+		// How many a-trous iterations each sampler needs to reach white noise's error at the configured count
+		const int32_t target = std::min(std::max(base.filterIterations, 0), maxIterations);
+		const double targetError = filtered[uint32_t(SamplerType::WhiteNoise)][target].relMse();
+		std::printf("Against white noise (relMSE %.4f at %d iterations):\n", targetError, target);
+		for (uint32_t s = 0; s < samplerCount; s++)
+		{
+			const SamplerType type = SamplerType(s);
+			if (type == SamplerType::WhiteNoise) continue;
+
+			int32_t needed = -1;
+			for (int32_t k = maxIterations; k >= 0 && filtered[s][k].relMse() <= targetError; k--) needed = k;
+			std::printf("  %-11s 1 spp variance %.2fx, low-pass %.2fx, mean %.2fx of white noise; ", getSamplerTypeName(type),
+			            raw[s].relMse() / raw[0].relMse(), lowPassed[s].relMse() / lowPassed[0].relMse(), mean[s].relMse() / mean[0].relMse());
+			if (needed < 0) std::printf("no iteration count up to %d reaches the same error\n", maxIterations);
+			else            std::printf("%d iteration(s) reach the same error\n", needed);
+		}
+		return 0;
+	}
+
+	int runCompareLights(const Options &opts)
+	{
+		int failures = 0;
+
+		// The table on its own:  O(n) builds, free updates when nothing changed, and the exact selection probabilities
+		std::printf("Alias table build over n lights of log-uniform weights\n");
+		std::printf("  %9s %12s %12s %14s %14s\n", "lights", "build ms", "ns / light", "unchanged ms", "max prob. err");
+		for (uint32_t count : { 16u, 1024u, 65536u, 1048576u })
+		{
+			std::vector<float> weights(count);
+			uint32_t seed = initRand(count, 0);
+			for (float &w : weights) w = std::pow(10.0f, -3.0f * nextRand(seed));
+			weights[count / 2] = 0.0f;   // A light that is off must never be picked
+
+			LightAliasTable table;
+			auto start = std::chrono::steady_clock::now();
+			table.update(weights);
+			const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			start = std::chrono::steady_clock::now();
+			const bool rebuilt = table.update(weights);
+			const double unchangedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			weights[0] *= 2.0f;
+			if (rebuilt || !table.update(weights) || table.getBuildCount() != 2)
+			{
+				std::printf("  FAILED:  the table did not rebuild exactly when the weights changed\n");
+				failures++;
+			}
+
+			// Each entry sends threshold / n of the probability to its own light and the rest to its alias
+			const std::vector<LightAliasEntry> &entries = table.getEntries();
+			std::vector<double> probability(count, 0.0);
+			double sum = 0.0, maxError = 0.0;
+			for (float w : weights) sum += double(w);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				probability[i]                += double(entries[i].threshold) / count;
+				probability[entries[i].alias] += (1.0 - double(entries[i].threshold)) / count;
+			}
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const double expected = double(weights[i]) / sum;
+				maxError = std::max(maxError, std::abs(probability[i] - expected) / std::max(expected, 1.0 / count));
+				if (weights[i] > 0.0f) maxError = std::max(maxError, std::abs(1.0 / double(entries[i].invPdf) - expected) / expected);
+			}
+			if (maxError > 1e-3)
+			{
+				std::printf("  FAILED:  selection probabilities are off by up to %.2e\n", maxError);
+				failures++;
+			}
+			std::printf("  %9u %12.3f %12.2f %14.4f %14.2e\n", count, buildMs, buildMs * 1e6 / count, unchangedMs, maxError);
+		}
+
+		// Direct lighting only, where the light is picked, at equal rays per pixel
+		const uint32_t frameCount   = uint32_t(std::max(2, opts.getInt("frames", 8)));
+		const uint32_t referenceSpp = uint32_t(std::max(1, opts.getInt("reference-spp", 256)));
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		CpuPathTracer::SharedPtr pTracer = createPathTracer(opts, pPool, "320x180");
+		if (!pTracer) return 1;
+		CpuPathTracer::Settings settings = pTracer->getSettings();
+		settings.doIndirectGI = false;
+
+		settings.lightSelection  = LightSelection::Power;
+		settings.samplesPerPixel = referenceSpp;
+		pTracer->setSettings(settings);
+		std::printf("Rendering a %u spp reference of direct light at %ux%u...\n", referenceSpp, pTracer->getWidth(), pTracer->getHeight());
+		ImageF4 reference;
+		remodulate(pTracer->renderFrame(frameCount), reference);
+
+		const uint32_t selectionCount = uint32_t(LightSelection::Count);
+		ErrorSums raw[selectionCount], filtered[selectionCount];
+		uint64_t shadowRays[selectionCount] = {};
+		for (uint32_t s = 0; s < selectionCount; s++)
+		{
+			settings.lightSelection  = LightSelection(s);
+			settings.samplesPerPixel = 1;
+			pTracer->setSettings(settings);
+
+			CpuSVGFFilter::SharedPtr pFilter = CpuSVGFFilter::create(pPool);
+			pFilter->setSettings(readSettings(opts));
+			ImageF4 color, output;
+			for (uint32_t f = 0; f < frameCount; f++)
+			{
+				const FrameInputs &inputs = pTracer->renderFrame(f);
+				shadowRays[s] += pTracer->getStats().shadowRays;
+				remodulate(inputs, color);
+				raw[s].add(color, reference);
+				if (!pFilter->execute(inputs, output)) return 1;
+				if (f >= frameCount / 2) filtered[s].add(output, reference);
+			}
+		}
+
+		std::printf("Direct light of %u light(s), 1 spp over %u frames; filtered over frames %u..%u\n",
+		            uint32_t(pTracer->getBvh()->getScene()->getLights().size()), frameCount, frameCount / 2, frameCount - 1);
+		std::printf("  %-9s %13s %12s %12s %12s %12s\n", "selection", "shadow rays", "RMSE", "relMSE", "filt. RMSE", "filt. relMSE");
+		for (uint32_t s = 0; s < selectionCount; s++)
+		{
+			std::printf("  %-9s %13llu %12.4e %12.4e %12.4e %12.4e\n", getLightSelectionName(LightSelection(s)), (unsigned long long)shadowRays[s],
+			            raw[s].rmse(), raw[s].relMse(), filtered[s].rmse(), filtered[s].relMse());
+		}
+		const uint32_t uniform = uint32_t(LightSelection::Uniform), power = uint32_t(LightSelection::Power);
+		std::printf("Power selection:  %.2fx the relMSE of uniform selection before filtering, %.2fx after\n",
+		            raw[power].relMse() / raw[uniform].relMse(), filtered[power].relMse() / filtered[uniform].relMse());
+
+		std::printf(failures ? "%d check(s) failed\n" : "All checks passed\n", failures);
+		return failures ? 1 : 0;
+	}
+
+	int runBenchEnvMap(const Options &opts)
+	{
+		int failures = 0;
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		Options sceneOpts = opts;
+		if (!opts.has("env")) sceneOpts.set("env", "sky");
+		Scene::SharedPtr pScene = loadScene(sceneOpts, pPool);
+		if (!pScene) return 1;
+		const ImageF4 &envMap = pScene->getEnvironmentMap();
+		const std::string cacheDir = opts.getString("bvh-cache", ".");
+		const std::string cachePath = EnvMapSampler::getCachePath(envMap, cacheDir);
+		std::remove(cachePath.c_str());
+
+		// Building, saving and loading the tables
+		auto time = [](const std::function<void()> &task)
+		{
+			auto start = std::chrono::steady_clock::now();
+			task();
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		};
+		EnvMapSampler::SharedPtr pBuilt, pSerialBuilt, pLoaded;
+		bool loaded = false, saved = false;
+		const double hashMs   = time([&]() { EnvMapSampler::getHash(envMap); });
+		const double serialMs = time([&]() { pSerialBuilt = EnvMapSampler::create(envMap); });
+		const double buildMs  = time([&]() { pBuilt = EnvMapSampler::create(envMap, pPool); });
+		if (!pBuilt || !pSerialBuilt)
+		{
+			std::fprintf(stderr, "The environment map is black; there is nothing to sample\n");
+			return 1;
+		}
+		const double saveMs   = time([&]() { saved = pBuilt->save(cachePath); });
+		const double loadMs   = time([&]() { pLoaded = EnvMapSampler::createCached(envMap, cacheDir, pPool, &loaded); });
+
+		const uint32_t width = pBuilt->getWidth(), height = pBuilt->getHeight();
+		std::printf("Environment map %ux%u, tables %.1f KB\n", width, height, (width + 1.0) * height * sizeof(float) / 1024.0);
+		std::printf("  hash %.2f ms, build %.2f ms on 1 thread and %.2f ms on %u, save %.2f ms, hash and map the cache %.2f ms\n",
+		            hashMs, serialMs, buildMs, pPool->getThreadCount(), saveMs, loadMs);
+		if (!saved || !loaded || !pLoaded->isMapped() ||
+		    std::memcmp(pLoaded->getMarginalCdf(), pBuilt->getMarginalCdf(), height * sizeof(float)) != 0 ||
+		    std::memcmp(pLoaded->getConditionalCdf(), pBuilt->getConditionalCdf(), size_t(width) * height * sizeof(float)) != 0 ||
+		    std::memcmp(pSerialBuilt->getConditionalCdf(), pBuilt->getConditionalCdf(), size_t(width) * height * sizeof(float)) != 0)
+		{
+			std::printf("  FAILED:  the cached or single threaded tables differ from the built ones\n");
+			failures++;
+		}
+
+		// sample() against evalPdf(), and the radiance integral estimated with uniform and with importance sampling
+		const uint32_t sampleCount = uint32_t(std::max(1, opts.getInt("samples", 1 << 20)));
+		const float kPi = 3.14159265f;
+		double exact = 0.0;
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const double solidAngle = 2.0 * kPi * kPi * std::sin((y + 0.5) / height * kPi) / (double(width) * height);
+			for (uint32_t x = 0; x < width; x++) exact += luminance(envMap.at(x, y).rgb()) * solidAngle;
+		}
+		double sumUniform = 0.0, sumSqUniform = 0.0, sumImportance = 0.0, sumSqImportance = 0.0;
+		uint32_t pdfMismatches = 0;
+		uint32_t seed = initRand(sampleCount, 7);
+		for (uint32_t i = 0; i < sampleCount; i++)
+		{
+			const float2 randVal((float(i) + nextRand(seed)) / float(sampleCount), nextRand(seed));
+			float pdf;
+			const float3 dir = pBuilt->sample(randVal, pdf);
+			const float evalPdf = pBuilt->evalPdf(dir);
+			if (pdf > 0.0f && std::abs(evalPdf - pdf) > 1e-3f * pdf) pdfMismatches++;
+			const double importance = pdf > 0.0f ? double(luminance(pScene->evalEnvironment(dir))) / pdf : 0.0;
+			sumImportance += importance;
+			sumSqImportance += importance * importance;
+
+			const float z = 1.0f - 2.0f * randVal.x, r = std::sqrt(std::max(0.0f, 1.0f - z * z)), phi = 2.0f * kPi * randVal.y;
+			const double uniform = double(luminance(pScene->evalEnvironment(float3(r * std::cos(phi), z, r * std::sin(phi))))) * 4.0 * kPi;
+			sumUniform += uniform;
+			sumSqUniform += uniform * uniform;
+		}
+		const double meanUniform = sumUniform / sampleCount, meanImportance = sumImportance / sampleCount;
+		const double varUniform = sumSqUniform / sampleCount - meanUniform * meanUniform;
+		const double varImportance = sumSqImportance / sampleCount - meanImportance * meanImportance;
+		std::printf("  %u samples:  pdf of sample() and evalPdf() differ for %u (texel edges); integral of luminance %.4f\n", sampleCount, pdfMismatches, exact);
+		std::printf("  uniform sphere sampling:  estimate %.4f, variance %.4e per sample\n", meanUniform, varUniform);
+		std::printf("  importance sampling:      estimate %.4f, variance %.4e per sample (%.1fx less)\n", meanImportance, varImportance,
+		            varImportance > 0.0 ? varUniform / varImportance : 0.0);
+		if (pdfMismatches > sampleCount / 1000 || std::abs(meanImportance - exact) > 1e-2 * exact)
+		{
+			std::printf("  FAILED:  importance sampling does not match the map\n");
+			failures++;
+		}
+
+		// Indirect light at 1 spp with and without environment sampling, against a reference that uses it
+		const uint32_t frameCount   = uint32_t(std::max(2, opts.getInt("frames", 8)));
+		const uint32_t referenceSpp = uint32_t(std::max(1, opts.getInt("reference-spp", 256)));
+		CpuPathTracer::SharedPtr pTracer = createPathTracer(sceneOpts, pPool, "320x180");
+		if (!pTracer) return 1;
+		CpuPathTracer::Settings settings = pTracer->getSettings();
+		settings.doDirectGI      = false;
+		settings.envMapSampling  = true;
+		settings.samplesPerPixel = referenceSpp;
+		pTracer->setSettings(settings);
+		std::printf("Rendering a %u spp reference of indirect light at %ux%u...\n", referenceSpp, pTracer->getWidth(), pTracer->getHeight());
+		ImageF4 reference;
+		remodulate(pTracer->renderFrame(frameCount), reference);
+
+		ErrorSums raw[2], filtered[2];
+		uint64_t rays[2] = {};
+		for (uint32_t m = 0; m < 2; m++)
+		{
+			settings.envMapSampling  = m == 1;
+			settings.samplesPerPixel = 1;
+			pTracer->setSettings(settings);
+
+			CpuSVGFFilter::SharedPtr pFilter = CpuSVGFFilter::create(pPool);
+			pFilter->setSettings(readSettings(opts));
+			ImageF4 color, output;
+			for (uint32_t f = 0; f < frameCount; f++)
+			{
+				const FrameInputs &inputs = pTracer->renderFrame(f);
+				rays[m] += pTracer->getStats().indirectRays;
+				remodulate(inputs, color);
+				raw[m].add(color, reference);
+				if (!pFilter->execute(inputs, output)) return 1;
+				if (f >= frameCount / 2) filtered[m].add(output, reference);
+			}
+		}
+		std::printf("Indirect light, 1 spp over %u frames; filtered over frames %u..%u\n", frameCount, frameCount / 2, frameCount - 1);
+		std::printf("  %-13s %13s %12s %12s %12s %12s\n", "sampling", "bounce rays", "RMSE", "relMSE", "filt. RMSE", "filt. relMSE");
+		for (uint32_t m = 0; m < 2; m++)
+		{
+			std::printf("  %-13s %13llu %12.4e %12.4e %12.4e %12.4e\n", m ? "BRDF + env" : "BRDF", (unsigned long long)rays[m],
+			            raw[m].rmse(), raw[m].relMse(), filtered[m].rmse(), filtered[m].relMse());
+		}
+		std::printf("Environment sampling:  %.2fx the relMSE of BRDF sampling before filtering, %.2fx after\n",
+		            raw[1].relMse() / raw[0].relMse(), filtered[1].relMse() / filtered[0].relMse());
+
+		std::printf(failures ? "%d check(s) failed\n" : "All checks passed\n", failures);
+		return failures ? 1 : 0;
+	}
+
+	/** Names of the .png and .jpg files in dir, sorted
+	*/
+	std::vector<std::string> listImageFiles(const std::string &dir)
+	{
+		std::vector<std::string> names;
+		auto add = [&](const std::string &name)
+		{
+			std::string ext = name.substr(name.find_last_of('.') == std::string::npos ? name.size() : name.find_last_of('.'));
+			for (char &c : ext) c = char(std::tolower((unsigned char)c));
+			if (ext == ".png" || ext == ".jpg" || ext == ".jpeg") names.push_back(name);
+		};
+#ifdef _WIN32
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA((dir + "/*").c_str(), &data);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do { if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) add(data.cFileName); } while (FindNextFileA(find, &data));
+			FindClose(find);
+		}
+#else
+		if (DIR *pDir = opendir(dir.c_str()))
+		{
+			while (dirent *pEntry = readdir(pDir)) add(pEntry->d_name);
+			closedir(pDir);
+		}
+#endif
+		std::sort(names.begin(), names.end());
+		return names;
+	}
+
+	int runBenchTextures(const Options &opts)
+	{
+		int failures = 0;
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		const std::string scenePath = opts.getString("scene", "Data/pink_room/pink_room.fscene");
+		const size_t slash = scenePath.find_last_of("/\\");
+		const std::string sceneDir = slash == std::string::npos ? std::string(".") : scenePath.substr(0, slash);
+		const std::string cacheDir = opts.getString("texture-cache", sceneDir);
+
+		// The textures of the scene's materials, or of the directory its textures are kept in
+		std::vector<TextureDesc> descs;
+		std::string error;
+		Scene::SharedPtr pScene = Scene::load(scenePath, error);
+		for (uint32_t i = 0; pScene && i < pScene->getMaterialCount(); i++)
+		{
+			const SceneMaterial &material = pScene->getMaterial(i);
+			TextureDesc desc;
+			if (!material.diffuseTexture.empty()) { desc.path = material.diffuseTexture; desc.srgb = true; descs.push_back(desc); }
+			if (!material.specularTexture.empty()) { desc.path = material.specularTexture; desc.srgb = false; descs.push_back(desc); }
+		}
+		if (descs.empty())
+		{
+			const std::string dir = sceneDir + "/textures";
+			for (const std::string &name : listImageFiles(dir))
+			{
+				TextureDesc desc;
+				desc.path = dir + "/" + name;
+				desc.srgb = name.find("Specular") == std::string::npos;
+				descs.push_back(desc);
+			}
+			std::printf("%s has no material textures to load%s%s; loading the images in %s\n", scenePath.c_str(),
+			            pScene ? "" : ": ", pScene ? "" : error.c_str(), dir.c_str());
+		}
+		if (descs.empty())
+		{
+			std::fprintf(stderr, "No textures found\n");
+			return 1;
+		}
+
+		auto time = [](const std::function<void()> &task)
+		{
+			auto start = std::chrono::steady_clock::now();
+			task();
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		};
+
+		// One texture after the other, on one thread and without the cache
+		std::vector<CpuTexture::SharedPtr> serial(descs.size());
+		const double serialMs = time([&]()
+		{
+			for (size_t i = 0; i < descs.size(); i++) serial[i] = CpuTexture::create(descs[i]);
+		});
+
+		for (const TextureDesc &desc : descs) std::remove(CpuTexture::getCachePath(desc, cacheDir).c_str());
+		TextureLoadStats cold, warm;
+		const std::vector<CpuTexture::SharedPtr> coldTextures = CpuTexture::loadAllCached(descs, cacheDir, pPool, &cold);
+		const std::vector<CpuTexture::SharedPtr> warmTextures = CpuTexture::loadAllCached(descs, cacheDir, pPool, &warm);
+
+		std::printf("%u textures, %.1f MB of files, %.1f MB of texels with mips\n", cold.textureCount, cold.sourceBytes / 1048576.0,
+		            cold.texelBytes / 1048576.0);
+		std::printf("  %-26s %10s %10s %10s %10s %8s %8s %8s\n", "startup", "read (ms)", "mips (ms)", "save (ms)", "total (ms)",
+		            "decoded", "mapped", "failed");
+		std::printf("  %-26s %10s %10s %10s %10.2f\n", "serial, 1 thread", "", "", "", serialMs);
+		const TextureLoadStats *pRuns[2] = { &cold, &warm };
+		for (uint32_t r = 0; r < 2; r++)
+		{
+			const TextureLoadStats &s = *pRuns[r];
+			char label[64];
+			std::snprintf(label, sizeof(label), "%s, %u thread%s", r ? "warm" : "cold", pPool->getThreadCount(), pPool->getThreadCount() > 1 ? "s" : "");
+			std::printf("  %-26s %10.2f %10.2f %10.2f %10.2f %8u %8u %8u\n", label, s.readMs, s.mipMs, s.saveMs, s.totalMs,
+			            s.decodedCount, s.mappedCount, s.failedCount);
+		}
+
+		// Mapping only reserves the pages; the first read of each faults it in
+		uint32_t checksum = 0;
+		const double touchMs = time([&]()
+		{
+			for (const CpuTexture::SharedPtr &pTexture : warmTextures)
+				for (uint32_t level = 0; pTexture && level < pTexture->getMipCount(); level++)
+					for (size_t t = 0; t < pTexture->getMip(level).getPixelCount(); t++) checksum += pTexture->getMip(level).getData()[t];
+		});
+		std::printf("  %-26s %10.2f   (reading every texel of the warm start once, checksum %08x)\n", "first touch", touchMs, checksum);
+		std::printf("Cold start %.2fx the time of the serial one; warm start %.0fx faster than it, %.1fx counting the first touch\n",
+		            cold.totalMs / serialMs, serialMs / warm.totalMs, serialMs / (warm.totalMs + touchMs));
+
+		for (size_t i = 0; i < descs.size(); i++)
+		{
+			const CpuTexture::SharedPtr &pSerial = serial[i], &pCold = coldTextures[i], &pWarm = warmTextures[i];
+			if (!pSerial || !pCold || !pWarm)
+			{
+				std::printf("FAIL: %s didn't load%s\n", descs[i].path.c_str(), pSerial ? " from the cache" : "");
+				failures++;
+				continue;
+			}
+			bool same = pWarm->isMapped() && pSerial->getMipCount() == pCold->getMipCount() && pCold->getMipCount() == pWarm->getMipCount();
+			for (uint32_t level = 0; same && level < pCold->getMipCount(); level++)
+			{
+				const ImageRGBA8 &a = pSerial->getMip(level), &b = pCold->getMip(level), &c = pWarm->getMip(level);
+				same = a.getWidth() == b.getWidth() && a.getHeight() == b.getHeight() && b.getWidth() == c.getWidth() && b.getHeight() == c.getHeight() &&
+				       std::memcmp(a.getData(), b.getData(), a.getByteSize()) == 0 && std::memcmp(b.getData(), c.getData(), b.getByteSize()) == 0;
+			}
+			if (!same)
+			{
+				std::printf("FAIL: %s has different mips serially, cold and warm\n", descs[i].path.c_str());
+				failures++;
+			}
+		}
+
+		std::printf(failures ? "%d check(s) failed\n" : "All checks passed\n", failures);
+		return failures ? 1 : 0;
+	}
+
+	/** <dir>/<channel>.<NNNN>.pfm or .sfb for the first of channels that has the frame
+	*/
+	bool loadFrameImage(const std::string &dir, const std::vector<const char *> &channels, uint32_t frame, ImageF4 &image)
+	{
+		for (const char *channel : channels)
+		{
+			if (loadImage(framePath(dir, channel, frame, ".pfm"), image) || loadImage(framePath(dir, channel, frame, ".sfb"), image)) return true;
+		}
+		return false;
+	}
+
+	/** Per-frame metrics of a sequence, written as CSV and JSON
+	*/
+	struct MetricsLog
+	{
+		struct Entry
+		{
+			uint32_t     frame;
+			FrameMetrics metrics;
+			double       ms;
+		};
+		std::vector<Entry> entries;
+
+		FrameMetrics getMean() const
+		{
+			FrameMetrics mean;
+			mean.ssim = 0.0;
+			for (const Entry &e : entries)
+			{
+				mean.rmse    += e.metrics.rmse;
+				mean.relMse  += e.metrics.relMse;
+				mean.ssim    += e.metrics.ssim;
+				mean.flip    += e.metrics.flip;
+				mean.flicker += e.metrics.flicker;
+			}
+			const double n = double(std::max<size_t>(entries.size(), 1));
+			mean.rmse /= n;
+			mean.relMse /= n;
+			mean.ssim /= n;
+			mean.flip /= n;
+			mean.flicker /= std::max(n - 1.0, 1.0);   // The first frame has no flicker
+			return mean;
+		}
+
+		bool writeCsv(const std::string &path) const
+		{
+			FILE *pFile = std::fopen(path.c_str(), "w");
+			if (!pFile) return false;
+			std::fprintf(pFile, "frame,rmse,relmse,ssim,flip,flicker,ms\n");
+			for (const Entry &e : entries)
+			{
+				std::fprintf(pFile, "%u,%.9g,%.9g,%.9g,%.9g,%.9g,%.3f\n", e.frame, e.metrics.rmse, e.metrics.relMse, e.metrics.ssim,
+				             e.metrics.flip, e.metrics.flicker, e.ms);
+			}
+			return std::fclose(pFile) == 0;
+		}
+
+		bool writeJson(const std::string &path, uint32_t width, uint32_t height, const MetricsEvaluator::Settings &settings) const
+		{
+			FILE *pFile = std::fopen(path.c_str(), "w");
+			if (!pFile) return false;
+			auto printMetrics = [&](const FrameMetrics &m)
+			{
+				std::fprintf(pFile, "\"rmse\": %.9g, \"relmse\": %.9g, \"ssim\": %.9g, \"flip\": %.9g, \"flicker\": %.9g", m.rmse, m.relMse, m.ssim, m.flip, m.flicker);
+			};
+			std::fprintf(pFile, "{\n  \"width\": %u, \"height\": %u, \"exposure\": %g, \"pixelsPerDegree\": %g,\n  \"frames\": [\n",
+			             width, height, settings.exposure, settings.pixelsPerDegree);
+			for (size_t i = 0; i < entries.size(); i++)
+			{
+				std::fprintf(pFile, "    { \"frame\": %u, ", entries[i].frame);
+				printMetrics(entries[i].metrics);
+				std::fprintf(pFile, ", \"ms\": %.3f }%s\n", entries[i].ms, i + 1 < entries.size() ? "," : "");
+			}
+			std::fprintf(pFile, "  ],\n  \"mean\": { ");
+			printMetrics(getMean());
+			std::fprintf(pFile, " }\n}\n");
+			return std::fclose(pFile) == 0;
+		}
+	};
+
+	int runMetrics(const Options &opts)
+	{
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		const std::string testDir = opts.getString("test"), referenceDir = opts.getString("reference");
+		const uint32_t firstFrame = uint32_t(std::max(0, opts.getInt("first", 0)));
+		if (!testDir.empty() && referenceDir.empty())
+		{
+			std::fprintf(stderr, "--test needs --reference\n");
+			return 1;
+		}
+
+		// Without --test, the frames are filtered here, and compared with the same frames unfiltered unless there is
+		//    a reference sequence
+		FrameSource source;
+		CpuSVGFFilter::SharedPtr pFilter;
+		if (testDir.empty())
+		{
+			if (!source.open(opts, pPool, "3840x2160")) return 1;
+			pFilter = CpuSVGFFilter::create(pPool);
+			pFilter->setSettings(readSettings(opts));
+		}
+		const uint32_t available = source.getFrameCount() > firstFrame ? source.getFrameCount() - firstFrame : 0;
+		const uint32_t frameCount = opts.has("frames") ? uint32_t(std::max(1, opts.getInt("frames", 1)))
+		                          : testDir.empty() ? (available ? available : 8) : UINT32_MAX;
+
+		MetricsEvaluator::Settings settings;
+		settings.exposure        = opts.getFloat("exposure", settings.exposure);
+		settings.pixelsPerDegree = opts.getFloat("ppd", settings.pixelsPerDegree);
+		settings.simdIsa         = readSimdIsa(opts, settings.simdIsa);
+		MetricsEvaluator::SharedPtr pMetrics = MetricsEvaluator::create(settings, pPool);
+
+		std::printf("Measuring with the %s kernels on %u thread(s)\n", getSimdIsaName(settings.simdIsa), pPool->getThreadCount());
+		std::printf("  %6s %12s %12s %10s %10s %10s %10s %10s\n", "frame", "rmse", "relmse", "ssim", "flip", "flicker", "ref ms", "eval ms");
+
+		MetricsLog log;
+		MetricsReference reference;
+		ImageF4 test, referenceImage;
+		StageStats readStats, prepareStats, evaluateStats;
+		for (uint32_t n = 0; n < frameCount; n++)
+		{
+			const uint32_t f = firstFrame + n;
+			auto readStart = std::chrono::steady_clock::now();
+			if (testDir.empty())
+			{
+				const FrameInputs *pInputs = source.getFrame(f);
+				if (!pInputs) return 1;
+				if (!pFilter->execute(*pInputs, test))
+				{
+					std::fprintf(stderr, "Frame %u: inputs are incomplete or do not all have the same size\n", f);
+					return 1;
+				}
+				if (referenceDir.empty())
+				{
+					// What the filter outputs with "SVGF enabled" unchecked
+					referenceImage.resize(test.getWidth(), test.getHeight());
+					pPool->forEachTile(test.getWidth(), test.getHeight(), 32, [&](const TileRect &tile)
+					{
+						for (int y = tile.y0; y < tile.y1; y++)
+							for (int x = tile.x0; x < tile.x1; x++)
+								referenceImage.at(x, y) = modulatePixel(*pInputs->directIllum, *pInputs->indirectIllum, *pInputs->dirAlbedo, *pInputs->indirAlbedo, x, y);
+					});
+				}
+			}
+			else if (!loadFrameImage(testDir, { kOutputChannel }, f, test))
+			{
+				// A sequence in files ends at the first missing frame
+				if (opts.has("frames") || n == 0)
+				{
+					std::fprintf(stderr, "Cannot read frame %u from %s\n", f, testDir.c_str());
+					return 1;
+				}
+				break;
+			}
+			if (!referenceDir.empty() && !loadFrameImage(referenceDir, { "Reference", kOutputChannel }, f, referenceImage))
+			{
+				std::fprintf(stderr, "Cannot read reference frame %u from %s\n", f, referenceDir.c_str());
+				return 1;
+			}
+			if (!testDir.empty()) readStats.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - readStart).count());
+
+			auto start = std::chrono::steady_clock::now();
+			pMetrics->prepareReference(referenceImage, reference);
+			auto prepared = std::chrono::steady_clock::now();
+			FrameMetrics metrics;
+			if (!pMetrics->evaluate(test, reference, metrics))
+			{
+				std::fprintf(stderr, "Frame %u is %ux%u, its reference %ux%u\n", f, test.getWidth(), test.getHeight(), referenceImage.getWidth(), referenceImage.getHeight());
+				return 1;
+			}
+			auto done = std::chrono::steady_clock::now();
+
+			const double prepareMs  = std::chrono::duration<double, std::milli>(prepared - start).count();
+			const double evaluateMs = std::chrono::duration<double, std::milli>(done - prepared).count();
+			prepareStats.add(prepareMs);
+			evaluateStats.add(evaluateMs);
+			log.entries.push_back({ f, metrics, prepareMs + evaluateMs });
+			std::printf("  %6u %12.5e %12.5e %10.5f %10.5f %10.5f %10.2f %10.2f\n", f, metrics.rmse, metrics.relMse, metrics.ssim, metrics.flip,
+			            metrics.flicker, prepareMs, evaluateMs);
+		}
+
+		const FrameMetrics mean = log.getMean();
+		std::printf("  %6s %12.5e %12.5e %10.5f %10.5f %10.5f\n", "mean", mean.rmse, mean.relMse, mean.ssim, mean.flip, mean.flicker);
+
+		std::printf("Wall time per frame at %ux%u:\n", test.getWidth(), test.getHeight());
+		readStats.print("read frames");
+		prepareStats.print("prepare reference");
+		evaluateStats.print("evaluate");
+		const double metricsMs = (prepareStats.sumMs + evaluateStats.sumMs) / std::max(1u, evaluateStats.count);
+		std::printf("%.2f frames/s (%.2f against a prepared reference), metrics only\n", 1000.0 / metricsMs,
+		            1000.0 * evaluateStats.count / std::max(evaluateStats.sumMs, 1e-9));
+
+		if (opts.has("csv") && !log.writeCsv(opts.getString("csv")))
+		{
+			std::fprintf(stderr, "Cannot write %s\n", opts.getString("csv").c_str());
+			return 1;
+		}
+		if (opts.has("json") && !log.writeJson(opts.getString("json"), test.getWidth(), test.getHeight(), settings))
+		{
+			std::fprintf(stderr, "Cannot write %s\n", opts.getString("json").c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	/** Comma separated values of a --name option into values; values is left alone if the option isn't given.
+	    Returns false (after printing why) if a value doesn't parse.
+	*/
+	/** Reference frames for a sequence from a FrameSource:  files from --reference, a render of --scene at
+	    --reference-spp samples per pixel, or (static camera only) the mean of --reference-spp synthetic frames past
+	    the sequence.  A static camera renders or averages a single one.
+	*/
+	class ReferenceSource
+	{
+	public:
+		/** Prints the problem and returns false if the options give no way to get references
+		*/
+		bool open(const Options &opts, CpuThreadPool::SharedPtr pPool, FrameSource &source, uint32_t firstFrame, uint32_t frameCount)
+		{
+			mpSource      = &source;
+			mFirstFrame   = firstFrame;
+			mFrameCount   = frameCount;
+			mDir          = opts.getString("reference");
+			mStaticCamera = opts.getFloat("pan", 0.0f) == 0.0f;
+			mSpp          = uint32_t(std::max(1, opts.getInt("reference-spp", 256)));
+			if (!mDir.empty()) return true;
+
+			if (opts.has("scene"))
+			{
+				mpTracer = createPathTracer(opts, pPool);
+				if (!mpTracer) return false;
+				CpuPathTracer::Settings tracerSettings = mpTracer->getSettings();
+				tracerSettings.sampler         = SamplerType::Sobol;
+				tracerSettings.samplesPerPixel = mSpp;
+				mpTracer->setSettings(tracerSettings);
+			}
+			else if (!opts.has("synthetic") && (opts.has("input") || opts.has("capture")))
+			{
+				std::fprintf(stderr, "Frames from --input or --capture need --reference\n");
+				return false;
+			}
+			else if (!mStaticCamera)
+			{
+				std::fprintf(stderr, "Synthetic frames only have a reference with a static camera (no --pan)\n");
+				return false;
+			}
+			return true;
+		}
+
+		/** The reference of frame n of the sequence, or nullptr (after printing why) if it can't be had
+		*/
+		const ImageF4 *get(uint32_t n)
+		{
+			const uint32_t f = mFirstFrame + n;
+			if (n < mReferences.size()) return &mReferences[n];
+			if (!mReferences.empty() && mStaticCamera && mDir.empty()) return &mReferences[0];
+
+			mReferences.emplace_back();
+			ImageF4 &reference = mReferences.back();
+			if (!mDir.empty())
+			{
+				if (!loadFrameImage(mDir, { "Reference", kOutputChannel }, f, reference))
+				{
+					std::fprintf(stderr, "Cannot read reference frame %u from %s\n", f, mDir.c_str());
+					return nullptr;
+				}
+			}
+			else if (mpTracer)
+			{
+				std::printf("Rendering a %u spp reference...\n", mSpp);
+				remodulate(mpTracer->renderFrame(f), reference);
+			}
+			else
+			{
+				// Synthetic frames past the sequence, averaged
+				std::printf("Averaging %u synthetic frames for the reference...\n", mSpp);
+				ImageF4 color;
+				for (uint32_t i = 0; i < mSpp; i++)
+				{
+					const FrameInputs *pInputs = mpSource->getFrame(mFirstFrame + mFrameCount + i);
+					if (!pInputs) return nullptr;
+					remodulate(*pInputs, color);
+					if (i == 0) reference = color;
+					else for (uint32_t p = 0; p < color.getPixelCount(); p++) reference.getData()[p] += color.getData()[p];
+				}
+				for (uint32_t p = 0; p < reference.getPixelCount(); p++) reference.getData()[p] = reference.getData()[p] / float(mSpp);
+			}
+			return &reference;
+		}
+
+	private:
+		FrameSource              *mpSource = nullptr;
+		uint32_t                  mFirstFrame = 0, mFrameCount = 0;
+		std::string               mDir;
+		bool                      mStaticCamera = true;
+		uint32_t                  mSpp = 256;
+		CpuPathTracer::SharedPtr  mpTracer;
+		std::vector<ImageF4>      mReferences;
+	};
+
+	template <typename T>
+	bool readList(const Options &opts, const char *name, std::vector<T> &values)
+	{
+		if (!opts.has(name)) return true;
+
+		std::vector<T> parsed;
+		const std::string list = opts.getString(name);
+		for (size_t begin = 0; begin <= list.size();)
+		{
+			size_t end = list.find(',', begin);
+			if (end == std::string::npos) end = list.size();
+			const std::string item = list.substr(begin, end - begin);
+			char *pEnd = nullptr;
+			const double value = std::strtod(item.c_str(), &pEnd);
+			if (item.empty() || *pEnd != '\0')
+			{
+				std::fprintf(stderr, "--%s expects comma separated numbers, such as 1,2,4\n", name);
+				return false;
+			}
+			parsed.push_back(T(value));
+			begin = end + 1;
+		}
+		values = parsed;
+		return true;
+	}
+
+	int runTune(const Options &commandOpts)
+	{
+		// Tuning filters every candidate on every frame; a small viewport keeps that quick
+		Options opts = commandOpts;
+		if (!opts.has("size")) opts.set("size", "320x180");
+
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		FrameSource source;
+		if (!source.open(opts, pPool, "320x180")) return 1;
+
+		const uint32_t firstFrame = uint32_t(std::max(0, opts.getInt("first", 0)));
+		const uint32_t available  = source.getFrameCount() > firstFrame ? source.getFrameCount() - firstFrame : 0;
+		const uint32_t frameCount = uint32_t(std::max(1, opts.getInt("frames", available ? int(available) : 16)));
+		ParameterTuner::Settings settings;
+		settings.base         = readSettings(opts);
+		settings.warmupFrames = uint32_t(std::max(0, opts.getInt("warmup", int(settings.warmupFrames))));
+		if (settings.warmupFrames >= frameCount)
+		{
+			std::fprintf(stderr, "--warmup must leave frames to measure (%u frames)\n", frameCount);
+			return 1;
+		}
+
+		TuningSpace &space = settings.space;
+		if (!readList(opts, "iterations", space.filterIterations) || !readList(opts, "feedback", space.feedbackTaps) ||
+		    !readList(opts, "phi-color", space.phiColors) || !readList(opts, "phi-normal", space.phiNormals) ||
+		    !readList(opts, "alpha", space.alphas) || !readList(opts, "moments-alpha", space.momentsAlphas))
+			return 1;
+
+		settings.objective = TuningObjective::Count;
+		const std::string objectiveName = opts.getString("objective", getTuningObjectiveName(TuningObjective::Flip));
+		for (uint32_t i = 0; i < uint32_t(TuningObjective::Count); i++)
+		{
+			if (objectiveName == getTuningObjectiveName(TuningObjective(i))) settings.objective = TuningObjective(i);
+		}
+		if (settings.objective == TuningObjective::Count)
+		{
+			std::fprintf(stderr, "--objective expects flip, relmse, rmse, ssim or flicker\n");
+			return 1;
+		}
+
+		settings.metrics.exposure        = opts.getFloat("exposure", settings.metrics.exposure);
+		settings.metrics.pixelsPerDegree = opts.getFloat("ppd", settings.metrics.pixelsPerDegree);
+		settings.metrics.simdIsa         = readSimdIsa(opts, settings.metrics.simdIsa);
+
+		ParameterTuner::SharedPtr pTuner = ParameterTuner::create(settings, pPool);
+		if (pTuner->getCandidateCount() == 0)
+		{
+			std::fprintf(stderr, "No valid combination of settings to try\n");
+			return 1;
+		}
+
+		ReferenceSource references;
+		if (!references.open(opts, pPool, source, firstFrame, frameCount)) return 1;
+
+		std::printf("Tuning %u candidate(s) for %s on %u frame(s) (%u warm-up) on %u thread(s)\n", pTuner->getCandidateCount(),
+		            getTuningObjectiveName(settings.objective), frameCount, settings.warmupFrames, pPool->getThreadCount());
+
+		StageStats frameStats;
+		for (uint32_t n = 0; n < frameCount; n++)
+		{
+			const ImageF4 *pReference = references.get(n);
+			const FrameInputs *pInputs = pReference ? source.getFrame(firstFrame + n) : nullptr;
+			if (!pInputs) return 1;
+
+			auto start = std::chrono::steady_clock::now();
+			if (!pTuner->addFrame(*pInputs, *pReference))
+			{
+				std::fprintf(stderr, "Frame %u: inputs are incomplete or do not all have the size of the reference and the first frame\n", firstFrame + n);
+				return 1;
+			}
+			frameStats.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+			if (n == 0)
+			{
+				const TuningStageCounts &counts = pTuner->getLastStageCounts();
+				std::printf("Stage runs per frame, shared between candidates (filtering each on its own):\n");
+				std::printf("  reprojection %6u (%u)\n  moments      %6u (%u)\n  a-trous      %6u (%u)\n", counts.reprojection, counts.reprojectionNaive,
+				            counts.moments, counts.momentsNaive, counts.atrous, counts.atrousNaive);
+			}
+		}
+		frameStats.print("tuning per frame");
+
+		const std::vector<TuningResult> results = pTuner->getResults();
+		const uint32_t width = references.get(0)->getWidth(), height = references.get(0)->getHeight();
+
+		if (opts.has("csv"))
+		{
+			FILE *pFile = std::fopen(opts.getString("csv").c_str(), "w");
+			if (!pFile)
+			{
+				std::fprintf(stderr, "Cannot write %s\n", opts.getString("csv").c_str());
+				return 1;
+			}
+			std::fprintf(pFile, "iterations,feedback,phi_color,phi_normal,alpha,moments_alpha,cost_ms,rmse,relmse,ssim,flip,flicker,pareto\n");
+			for (const TuningResult &r : results)
+			{
+				const CpuSVGFFilter::Settings &s = r.settings;
+				std::fprintf(pFile, "%d,%d,%g,%g,%g,%g,%.4f,%.9g,%.9g,%.9g,%.9g,%.9g,%d\n", s.filterIterations, s.feedbackTap, s.phiColor, s.phiNormal,
+				             s.alpha, s.momentsAlpha, r.costMs, r.metrics.rmse, r.metrics.relMse, r.metrics.ssim, r.metrics.flip, r.metrics.flicker, r.paretoOptimal ? 1 : 0);
+			}
+			std::fclose(pFile);
+		}
+
+		// The front, each point filtered again with CpuSVGFFilter:  it must measure the same, and its time checks the
+		//    estimate
+		const bool verify = !opts.has("no-verify");
+		CpuSVGFFilter::SharedPtr    pFilter  = CpuSVGFFilter::create(pPool);
+		MetricsEvaluator::SharedPtr pMetrics = MetricsEvaluator::create(settings.metrics, pPool);
+		MetricsReference reference;
+		ImageF4 output;
+		uint32_t frontSize = 0, mismatches = 0;
+
+		std::printf("Pareto front of %s against the estimated filter time per frame at %ux%u%s:\n", getTuningObjectiveName(settings.objective),
+		            width, height, verify ? ", checked with CpuSVGFFilter" : "");
+		std::printf("  %5s %5s %8s %8s %6s %6s %9s %9s %11s %8s %8s %10s %9s\n", "iters", "tap", "phiColor", "phiNorm", "alpha", "mAlpha",
+		            "est. ms", "flip", "relmse", "ssim", "flicker", verify ? "filter ms" : "", verify ? "diff" : "");
+		for (const TuningResult &r : results)
+		{
+			if (!r.paretoOptimal) continue;
+			frontSize++;
+
+			char check[64] = "";
+			if (verify)
+			{
+				pFilter->setSettings(r.settings);
+				pFilter->reset();
+				pMetrics->resetSequence();
+
+				FrameMetrics sums;
+				sums.ssim = 0.0;
+				uint32_t measured = 0, flickerFrames = 0;
+				double filterMs = 0.0;
+				for (uint32_t n = 0; n < frameCount; n++)
+				{
+					const FrameInputs *pInputs = source.getFrame(firstFrame + n);
+					if (!pInputs || !pFilter->execute(*pInputs, output)) return 1;
+					if (n + 1 < settings.warmupFrames) continue;
+
+					FrameMetrics metrics;
+					pMetrics->prepareReference(*references.get(n), reference);
+					pMetrics->evaluate(output, reference, metrics);
+					if (n < settings.warmupFrames) continue;
+
+					filterMs     += pFilter->getLastTimings().total;
+					sums.rmse    += metrics.rmse;
+					sums.relMse  += metrics.relMse;
+					sums.ssim    += metrics.ssim;
+					sums.flip    += metrics.flip;
+					measured++;
+					if (n > 0)
+					{
+						sums.flicker += metrics.flicker;
+						flickerFrames++;
+					}
+				}
+
+				const double difference = std::max({ std::abs(sums.rmse / measured - r.metrics.rmse), std::abs(sums.relMse / measured - r.metrics.relMse),
+				                                     std::abs(sums.ssim / measured - r.metrics.ssim), std::abs(sums.flip / measured - r.metrics.flip),
+				                                     std::abs((flickerFrames ? sums.flicker / flickerFrames : 0.0) - r.metrics.flicker) });
+				if (difference > 1e-9) mismatches++;
+				std::snprintf(check, sizeof(check), "%10.3f %9.2e", filterMs / measured, difference);
+			}
+
+			const CpuSVGFFilter::Settings &s = r.settings;
+			std::printf("  %5d %5d %8g %8g %6g %6g %9.3f %9.5f %11.4e %8.5f %8.5f %s\n", s.filterIterations, s.feedbackTap, s.phiColor, s.phiNormal,
+			            s.alpha, s.momentsAlpha, r.costMs, r.metrics.flip, r.metrics.relMse, r.metrics.ssim, r.metrics.flicker, check);
+		}
+		std::printf("%u of %u candidates on the front\n", frontSize, uint32_t(results.size()));
+		if (mismatches) std::printf("%u point(s) of the front measure differently when filtered by CpuSVGFFilter\n", mismatches);
+
+		const double budgetMs = opts.getFloat("budget", 0.0f);
+		const TuningResult *pChoice = ParameterTuner::pickResult(results, budgetMs);
+		if (!pChoice)
+		{
+			std::fprintf(stderr, "Nothing on the front takes %g ms or less\n", budgetMs);
+			return 1;
+		}
+
+		const CpuSVGFFilter::Settings &s = pChoice->settings;
+		std::printf("Preset:  --iterations %d --feedback %d --phi-color %g --phi-normal %g --alpha %g --moments-alpha %g\n", s.filterIterations,
+		            s.feedbackTap, s.phiColor, s.phiNormal, s.alpha, s.momentsAlpha);
+		std::printf("         %s %.5f, estimated %.3f ms per frame at %ux%u\n", getTuningObjectiveName(settings.objective), pChoice->error,
+		            pChoice->costMs, width, height);
+
+		if (opts.has("output"))
+		{
+			char comment[512];
+			std::snprintf(comment, sizeof(comment), "SVGF preset written by SVGFCli tune:  %s %.5f at an estimated %.3f ms per frame at %ux%u\n"
+			              "Load it with SVGFPass' \"Load preset\" button or -svgfPreset, or with SVGFCli filter --preset",
+			              getTuningObjectiveName(settings.objective), pChoice->error, pChoice->costMs, width, height);
+			if (!savePreset(opts.getString("output"), getPreset(s), comment))
+			{
+				std::fprintf(stderr, "Cannot write %s\n", opts.getString("output").c_str());
+				return 1;
+			}
+			std::printf("Wrote %s\n", opts.getString("output").c_str());
+		}
+		return mismatches ? 1 : 0;
+	}
+
+	int runBenchTaa(const Options &opts)
+	{
+		CpuThreadPool::SharedPtr pPool = CpuThreadPool::create(uint32_t(std::max(0, opts.getInt("threads", 0))));
+		FrameSource source;
+		if (!source.open(opts, pPool, "640x360")) return 1;
+
+		const uint32_t firstFrame  = uint32_t(std::max(0, opts.getInt("first", 0)));
+		const uint32_t available   = source.getFrameCount() > firstFrame ? source.getFrameCount() - firstFrame : 0;
+		const uint32_t frameCount  = uint32_t(std::max(2, opts.getInt("frames", available ? int(available) : 24)));
+		const uint32_t warmupCount = uint32_t(std::max(0, opts.getInt("warmup", 8)));
+		if (warmupCount + 1 >= frameCount)
+		{
+			std::fprintf(stderr, "--warmup must leave at least 2 frames to measure (%u frames)\n", frameCount);
+			return 1;
+		}
+
+		ReferenceSource references;
+		if (!references.open(opts, pPool, source, firstFrame, frameCount)) return 1;
+
+		// The settings as given, and with one iteration less
+		CpuSVGFFilter::Settings settings = readSettings(opts);
+		const int32_t iterations = settings.filterIterations;
+		if (iterations < 2)
+		{
+			std::fprintf(stderr, "--iterations must be at least 2, to compare with one iteration less\n");
+			return 1;
+		}
+
+		CpuSVGFFilter::SharedPtr pFilters[2];
+		ImageF4 filtered[2];
+		for (int i = 0; i < 2; i++)
+		{
+			pFilters[i] = CpuSVGFFilter::create(pPool);
+			pFilters[i]->setSettings(settings);
+			pFilters[i]->getSettings().filterIterations = iterations - i;
+		}
+
+		TemporalAA::Settings taaSettings;
+		taaSettings.alpha = opts.getFloat("taa-alpha", taaSettings.alpha);
+
+		// TAA after each filter, and the per-pixel port and every supported kernel after the one with fewer iterations:
+		//    they must all give the same output
+		struct TaaVariant
+		{
+			std::string           name;
+			TemporalAA::SharedPtr pTaa;
+			ImageF4               output;
+			double                ms = 0.0;
+			uint32_t              mismatches = 0;
+		};
+		std::vector<TaaVariant> variants;
+		auto addVariant = [&](const std::string &name, bool simd, SimdIsa isa)
+		{
+			variants.emplace_back();
+			variants.back().name = name;
+			variants.back().pTaa = TemporalAA::create(pPool);
+			TemporalAA::Settings variantSettings = taaSettings;
+			variantSettings.simd    = simd;
+			variantSettings.simdIsa = isa;
+			variants.back().pTaa->setSettings(variantSettings);
+		};
+		addVariant("per-pixel", false, SimdIsa::Scalar);
+		for (uint32_t isa = 0; isa < uint32_t(SimdIsa::Count); isa++)
+		{
+			if (isSimdIsaSupported(SimdIsa(isa))) addVariant(getSimdIsaName(SimdIsa(isa)), true, SimdIsa(isa));
+		}
+		TemporalAA::SharedPtr pTaaFull = TemporalAA::create(pPool);
+		pTaaFull->setSettings(taaSettings);
+		ImageF4 fullTaaOutput;
+
+		// Quality of n iterations, n - 1, and both followed by TAA (with the kernel TemporalAA picks by default)
+		const TaaVariant &defaultVariant = variants.back();
+		char configNames[4][48];
+		std::snprintf(configNames[0], sizeof(configNames[0]), "%d iterations", iterations);
+		std::snprintf(configNames[1], sizeof(configNames[1]), "%d iterations", iterations - 1);
+		std::snprintf(configNames[2], sizeof(configNames[2]), "%d iterations + TAA", iterations - 1);
+		std::snprintf(configNames[3], sizeof(configNames[3]), "%d iterations + TAA", iterations);
+
+		MetricsEvaluator::Settings metricsSettings;
+		metricsSettings.exposure        = opts.getFloat("exposure", metricsSettings.exposure);
+		metricsSettings.pixelsPerDegree = opts.getFloat("ppd", metricsSettings.pixelsPerDegree);
+		metricsSettings.simdIsa         = readSimdIsa(opts, metricsSettings.simdIsa);
+		MetricsEvaluator::SharedPtr pMetrics = MetricsEvaluator::create(metricsSettings, pPool);
+		MetricsReference reference;
+		MetricsSequence sequences[4];
+		FrameMetrics sums[4];
+		uint32_t flickerFrames = 0;
+		for (FrameMetrics &sum : sums) sum.ssim = 0.0;
+		double filterMs[2] = { 0.0, 0.0 }, atrousMs = 0.0;
+
+		for (uint32_t n = 0; n < frameCount; n++)
+		{
+			const FrameInputs *pInputs = source.getFrame(firstFrame + n);
+			if (!pInputs) return 1;
+			for (int i = 0; i < 2; i++)
+			{
+				if (!pFilters[i]->execute(*pInputs, filtered[i])) return 1;
+			}
+			for (TaaVariant &variant : variants)
+			{
+				if (!variant.pTaa->execute(filtered[1], *pInputs->motionVecs, variant.output)) return 1;
+			}
+			if (!pTaaFull->execute(filtered[0], *pInputs->motionVecs, fullTaaOutput)) return 1;
+
+			// Flicker needs the frame before the first measured one
+			if (n + 1 < warmupCount) continue;
+			const ImageF4 *pReference = references.get(n);
+			if (!pReference) return 1;
+			pMetrics->prepareReference(*pReference, reference);
+
+			const ImageF4 *pOutputs[4] = { &filtered[0], &filtered[1], &defaultVariant.output, &fullTaaOutput };
+			for (int i = 0; i < 4; i++)
+			{
+				FrameMetrics metrics;
+				if (!pMetrics->evaluate(*pOutputs[i], reference, sequences[i], metrics))
+				{
+					std::fprintf(stderr, "Frame %u: the reference is %ux%u, the output %ux%u\n", firstFrame + n, pReference->getWidth(),
+					             pReference->getHeight(), pOutputs[i]->getWidth(), pOutputs[i]->getHeight());
+					return 1;
+				}
+				if (n < warmupCount) continue;
+				sums[i].rmse    += metrics.rmse;
+				sums[i].relMse  += metrics.relMse;
+				sums[i].ssim    += metrics.ssim;
+				sums[i].flip    += metrics.flip;
+				sums[i].flicker += metrics.flicker;
+			}
+			if (n < warmupCount) continue;
+			if (n > 0) flickerFrames++;
+
+			for (int i = 0; i < 2; i++) filterMs[i] += pFilters[i]->getLastTimings().total;
+			atrousMs += pFilters[0]->getLastTimings().atrous;
+			for (TaaVariant &variant : variants)
+			{
+				variant.ms += variant.pTaa->getLastTimeMs();
+				const float4 *pA = variant.output.getData(), *pB = variants[0].output.getData();
+				for (size_t p = 0; p < variant.output.getPixelCount(); p++)
+				{
+					if (pA[p].x != pB[p].x || pA[p].y != pB[p].y || pA[p].z != pB[p].z || pA[p].w != pB[p].w)
+					{
+						variant.mismatches++;
+						break;
+					}
+				}
+			}
+		}
+
+		const uint32_t timed = frameCount - warmupCount;
+		const double iterationMs = atrousMs / timed / iterations;
+		std::printf("Temporal AA (alpha %g) against an a-trous iteration over frames %u..%u at %ux%u on %u thread(s)\n", taaSettings.alpha,
+		            firstFrame + warmupCount, firstFrame + frameCount - 1, filtered[0].getWidth(), filtered[0].getHeight(), pPool->getThreadCount());
+		std::printf("  %-24s %9.3f ms   (%s kernel, mean of %d)\n", "a-trous iteration", iterationMs, settings.simdAtrous ? getSimdIsaName(settings.simdIsa) : "per-pixel", iterations);
+		uint32_t mismatches = 0;
+		for (const TaaVariant &variant : variants)
+		{
+			std::printf("  %-24s %9.3f ms   %5.2fx an iteration   %s\n", ("temporal AA, " + variant.name).c_str(), variant.ms / timed,
+			            variant.ms / timed / iterationMs, variant.mismatches ? "differs from per-pixel" : "same output");
+			mismatches += variant.mismatches;
+		}
+
+		std::printf("Quality against the reference (frames %u..%u):\n", firstFrame + warmupCount, firstFrame + frameCount - 1);
+		std::printf("  %-24s %9s %11s %8s %9s %11s\n", "", "flip", "relmse", "ssim", "flicker", "ms/frame");
+		const double configMs[4] = { filterMs[0] / timed, filterMs[1] / timed, (filterMs[1] + defaultVariant.ms) / timed, (filterMs[0] + defaultVariant.ms) / timed };
+		for (int i = 0; i < 4; i++)
+		{
+			std::printf("  %-24s %9.5f %11.4e %8.5f %9.5f %11.3f\n", configNames[i], sums[i].flip / timed, sums[i].relMse / timed,
+			            sums[i].ssim / timed, flickerFrames ? sums[i].flicker / flickerFrames : 0.0, configMs[i]);
+		}
+		std::printf("Dropping an iteration for TAA:  flicker %+.1f%%, FLIP %+.1f%%, %+.3f ms per frame\n",
+		            100.0 * (sums[2].flicker / sums[0].flicker - 1.0), 100.0 * (sums[2].flip / sums[0].flip - 1.0), configMs[2] - configMs[0]);
+		if (mismatches) std::printf("The temporal AA kernels differ from the per-pixel port on %u frame(s)\n", mismatches);
+		return mismatches ? 1 : 0;
+	}
+
+	void printUsage()
+	{
+		std::printf("Usage: SVGFCli <command> [options]\n"
+		            "Commands:\n"
+		            "  filter             Run the CPU SVGF filter over a frame sequence and report per-stage timings\n"
+		            "  replay             Stream a frame capture through the filter\n"
+		            "  stream             Filter a sequence with reading, filtering and writing pipelined on their own threads\n"
+		            "  capture            Record frames from a directory or the synthetic scene into a frame capture\n"
+		            "  compare-storage    Compare the error and memory of the history / ping-pong storage formats\n"
+		            "  compare-blit-free  Check the blit-free bookkeeping gives bit-identical output\n"
+		            "  compare-indirect   Compare filtering indirect at full, half and quarter resolution\n"
+		            "  bench-adaptive     Compare adaptive a-trous against filtering every tile on a static sequence\n"
+		            "  bench-geometry-cache  Compare the a-trous stage with and without the geometry weight cache\n"
+		            "  bench-batch        Compare one batched filter against a filter per stream for 1 to 64 small views\n"
+		            "  bench-atrous       Compare the a-trous stage of the reference and vectorized kernels\n"
+		            "  bench-variants     Time every compiled a-trous variant of the reference and vectorized kernels\n"
+		            "  check-pool         Check SVGFPass' render target pool through dynamic resolution changes\n"
+		            "  check-timers       Check the per-stage timer statistics against a manual clock\n"
+		            "  check-gbuffer      Check the compact G-buffer packing round trip and list the bytes of each layout\n"
+		            "  trace              Path trace a scene on the CPU into SVGFPass inputs or a converged reference\n"
+		            "  bench-bvh          Time building, caching and loading the tracer's BVH and its traversal throughput\n"
+		            "  bench-traversal    Compare single ray, packet and sorted stream traversal of camera, shadow and bounce rays\n"
+		            "  compare-samplers   Compare the white noise, blue noise and Sobol samplers' error at 1 spp, raw and filtered\n"
+		            "  compare-lights     Check the light alias table and compare uniform and power light selection\n"
+		            "  bench-envmap       Time and check the environment map sampling tables and compare indirect light with and without them\n"
+		            "  bench-textures     Time loading a scene's textures serially, in parallel and from the texture cache\n"
+		            "  metrics            Measure RMSE, relMSE, SSIM, FLIP and flicker of a sequence against a reference, per frame\n"
+		            "  tune               Search the filter settings for the best quality at each cost and write a preset for SVGFPass\n"
+		            "  bench-taa          Time temporal AA against an a-trous iteration and compare n iterations with n - 1 plus temporal AA\n"
+		            "See the comment at the top of SVGFCli.cpp for the options of each command.\n");
+	}
+};
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) { printUsage(); return 1; }
+
+	Options opts(argc, argv, 2);
+	if (!opts.getUnparsed().empty())
+	{
+		std::fprintf(stderr, "Unexpected argument: %s\n", opts.getUnparsed()[0].c_str());
+		return 1;
+	}
+
+	if (std::strcmp(argv[1], "filter") == 0)          return runFilter(opts);
+	if (std::strcmp(argv[1], "replay") == 0)          return runReplay(opts);
+	if (std::strcmp(argv[1], "stream") == 0)          return runStream(opts);
+	if (std::strcmp(argv[1], "capture") == 0)         return runCapture(opts);
+	if (std::strcmp(argv[1], "compare-storage") == 0) return runCompareStorage(opts);
+	if (std::strcmp(argv[1], "compare-blit-free") == 0) return runCompareBlitFree(opts);
+	if (std::strcmp(argv[1], "compare-indirect") == 0)  return runCompareIndirect(opts);
+	if (std::strcmp(argv[1], "bench-adaptive") == 0)  return runBenchAdaptive(opts);
+	if (std::strcmp(argv[1], "bench-geometry-cache") == 0) return runBenchGeometryCache(opts);
+	if (std::strcmp(argv[1], "bench-batch") == 0)     return runBenchBatch(opts);
+	if (std::strcmp(argv[1], "bench-atrous") == 0)    return runBenchAtrous(opts);
+	if (std::strcmp(argv[1], "bench-variants") == 0)  return runBenchVariants(opts);
+	if (std::strcmp(argv[1], "check-pool") == 0)      return runCheckPool(opts);
+	if (std::strcmp(argv[1], "check-timers") == 0)    return runCheckTimers(opts);
+	if (std::strcmp(argv[1], "check-gbuffer") == 0)   return runCheckGBuffer(opts);
+	if (std::strcmp(argv[1], "trace") == 0)           return runTrace(opts);
+	if (std::strcmp(argv[1], "bench-bvh") == 0)       return runBenchBvh(opts);
+	if (std::strcmp(argv[1], "bench-traversal") == 0) return runBenchTraversal(opts);
+	if (std::strcmp(argv[1], "compare-samplers") == 0) return runCompareSamplers(opts);
+	if (std::strcmp(argv[1], "compare-lights") == 0)  return runCompareLights(opts);
+	if (std::strcmp(argv[1], "bench-envmap") == 0)    return runBenchEnvMap(opts);
+	if (std::strcmp(argv[1], "bench-textures") == 0)  return runBenchTextures(opts);
+	if (std::strcmp(argv[1], "metrics") == 0)         return runMetrics(opts);
+	if (std::strcmp(argv[1], "tune") == 0)            return runTune(opts);
+	if (std::strcmp(argv[1], "bench-taa") == 0)       return runBenchTaa(opts);
+
+	printUsage();
+	return 1;
+}
@@ -22,6 +22,7 @@
 #include "Passes/SVGFPass.h"
 #include "Passes/GGXGlobalIllumination.h"
 #include "Passes/SimpleToneMappingPass.h"
+#include "Passes/TemporalAAPass.h"
 
 int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPSTR lpCmdLine, _In_ int nShowCmd)
 {
@@ -31,20 +32,38 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 	// Next, we add passes into our rendering pipeline.  These passes contain the most relevant
 	//    details for the rendering in this sample.
 
+	// "-compactGBuffer" on the command line selects the compact G-buffer layout.  The G-buffer and GI passes must agree on it
+	CpuSVGF::GBufferLayout gBufferLayout = (lpCmdLine && strstr(lpCmdLine, "-compactGBuffer")) ? CpuSVGF::GBufferLayout::Compact
+	                                                                                           : CpuSVGF::GBufferLayout::Full;
+
     // Create a G-buffer in the usual way, though the format is specific to our SVGF implementation
-	pipeline->setPass(0, GBufferForSVGF::create() );
+	pipeline->setPass(0, GBufferForSVGF::create(gBufferLayout) );
 
 	// A global illumination pass that renders GGX-based one bounce GI into 2 output buffers
 	//     (named "DirectAccum" and "IndirectAccum").  This is a fairly standard GI pass
-	pipeline->setPass(1, GGXGlobalIlluminationPass::create("DirectAccum", "IndirectAccum"));
+	pipeline->setPass(1, GGXGlobalIlluminationPass::create("DirectAccum", "IndirectAccum", gBufferLayout));
 
 	// Apply the SVGF filter separately on the direct and indirect 1spp buffers, and save the
 	//      filtered output into a buffer named "HDRColorOutput"
-	pipeline->setPass(2, SVGFPass::create("DirectAccum", "IndirectAccum", "HDRColorOutput"));
+	SVGFPass::SharedPtr pSvgf = SVGFPass::create("DirectAccum", "IndirectAccum", "HDRColorOutput");
+	pipeline->setPass(2, pSvgf);
+
+	// "-svgfPreset <file>" starts SVGF with the parameters of a preset, e.g. one written by "SVGFCli tune"
+	const char *pPresetArg = lpCmdLine ? strstr(lpCmdLine, "-svgfPreset ") : nullptr;
+	if (pPresetArg)
+	{
+		std::string path = pPresetArg + strlen("-svgfPreset ");
+		path = path.substr(0, path.find(' '));
+		pSvgf->loadPreset(path);
+	}
+
+	// Temporal anti-aliasing on the filtered output, as in the SVGF paper, to even out the flicker the filter leaves.
+	//      It reuses SVGF's motion vectors and writes "HDRColorTAA"; its GUI can turn it off.
+	pipeline->setPass(3, TemporalAAPass::create("HDRColorOutput", "HDRColorTAA"));
 
-	// Take the (HDR) filtered output and apply a tone mapping pass to generate the final output color.
+	// Take the (HDR) anti-aliased output and apply a tone mapping pass to generate the final output color.
 	//      (By default, this pass applies no tonemapping, but the UI provides other options)
-	pipeline->setPass(3, SimpleToneMappingPass::create("HDRColorOutput", ResourceManager::kOutputChannel));
+	pipeline->setPass(4, SimpleToneMappingPass::create("HDRColorTAA", ResourceManager::kOutputChannel));
 
 	// Define a set of config / window parameters for our program
     SampleConfig config;